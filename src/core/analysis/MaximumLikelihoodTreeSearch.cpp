@@ -0,0 +1,668 @@
+#include <stddef.h>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "AbstractHomologousDiscreteCharacterData.h"
+#include "BranchLengthLikelihoodEvaluator.h"
+#include "DagNode.h"
+#include "MaximumLikelihoodTreeSearch.h"
+#include "Model.h"
+#include "RbConstants.h"
+#include "RbException.h"
+#include "RbMathLogic.h"
+#include "RbOrderedSet.h"
+#include "StochasticNode.h"
+#include "TopologyNode.h"
+#include "Tree.h"
+
+
+using namespace RevBayesCore;
+
+
+// the bounds and the convergence tolerance for the branch lengths
+static const double MIN_BRANCH_LENGTH       = 1E-8;
+static const double MAX_BRANCH_LENGTH       = 100.0;
+static const double BRANCH_LENGTH_TOLERANCE = 1E-6;
+
+
+/**
+ * Constructor. We create an independent copy of the model and thus of all DAG nodes,
+ * so that the search does not change the model of the user.
+ *
+ * \param[in]    m    The model containing all DAG nodes.
+ * \param[in]    n    The name of the tree variable.
+ */
+MaximumLikelihoodTreeSearch::MaximumLikelihoodTreeSearch(const Model &m, const std::string &n) : Cloneable( ), Parallelizable( ),
+    model( m.clone() ),
+    tree_name( n ),
+    tree_node( NULL ),
+    current_ln_likelihood( RbConstants::Double::neginf )
+{
+
+    initialize();
+
+}
+
+
+MaximumLikelihoodTreeSearch::MaximumLikelihoodTreeSearch(const MaximumLikelihoodTreeSearch &t) : Cloneable( t ), Parallelizable( t ),
+    model( t.model->clone() ),
+    tree_name( t.tree_name ),
+    tree_node( NULL ),
+    current_ln_likelihood( t.current_ln_likelihood )
+{
+
+    initialize();
+
+}
+
+
+MaximumLikelihoodTreeSearch::~MaximumLikelihoodTreeSearch(void)
+{
+
+    delete model;
+
+}
+
+
+/**
+ * Overloaded assignment operator.
+ * We need to find the tree and the likelihoods in our new copy of the model.
+ */
+MaximumLikelihoodTreeSearch& MaximumLikelihoodTreeSearch::operator=(const MaximumLikelihoodTreeSearch &t)
+{
+    Parallelizable::operator=( t );
+
+    if ( this != &t )
+    {
+
+        delete model;
+
+        model                   = t.model->clone();
+        tree_name               = t.tree_name;
+        current_ln_likelihood   = t.current_ln_likelihood;
+
+        initialize();
+    }
+
+    return *this;
+}
+
+
+/**
+ * Compute the maximum likelihood trees of bootstrapped data sets.
+ * Every replicate works on its own copy of the model, starting from the current tree, and resamples the sites of all character data.
+ *
+ * \return The maximum likelihood tree of each replicate.
+ */
+std::vector<Tree> MaximumLikelihoodTreeSearch::bootstrap(size_t n, double e, size_t max_rounds, size_t radius, bool verbose)
+{
+
+    std::vector<Tree> trees;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if ( verbose == true && process_active == true )
+        {
+            std::cout << "Bootstrap replicate " << (i+1) << " / " << n << std::endl;
+        }
+
+        MaximumLikelihoodTreeSearch replicate = MaximumLikelihoodTreeSearch( *this );
+        for (size_t j = 0; j < replicate.likelihood_nodes.size(); ++j)
+        {
+            replicate.likelihood_nodes[j]->bootstrap();
+        }
+
+        replicate.run(e, max_rounds, radius, false);
+        trees.push_back( replicate.getTree() );
+    }
+
+    return trees;
+}
+
+
+MaximumLikelihoodTreeSearch* MaximumLikelihoodTreeSearch::clone( void ) const
+{
+
+    return new MaximumLikelihoodTreeSearch( *this );
+}
+
+
+/**
+ * The ln likelihood of all character data on the tree.
+ * The tree must have been touched before, and the caller needs to keep or restore the tree afterwards.
+ */
+double MaximumLikelihoodTreeSearch::computeLnLikelihood( void )
+{
+
+    double ln = 0.0;
+    for (size_t i = 0; i < likelihood_nodes.size(); ++i)
+    {
+        ln += likelihood_nodes[i]->getLnProbability();
+    }
+
+    return ln;
+}
+
+
+double MaximumLikelihoodTreeSearch::getLnLikelihood( void ) const
+{
+
+    return current_ln_likelihood;
+}
+
+
+const Tree& MaximumLikelihoodTreeSearch::getTree( void ) const
+{
+
+    return tree_node->getValue();
+}
+
+
+/**
+ * Find the tree variable in our copy of the model and the character data that depend on it.
+ * The tree needs to be a stochastic variable with free branch lengths and all nodes affected by it need to be
+ * clamped character data whose likelihood can optimize single branch lengths.
+ */
+void MaximumLikelihoodTreeSearch::initialize( void )
+{
+
+    tree_node = NULL;
+    likelihood_nodes.clear();
+    evaluators.clear();
+
+    const std::vector<DagNode*> &nodes = model->getDagNodes();
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        if ( nodes[i]->getName() == tree_name )
+        {
+            tree_node = dynamic_cast<StochasticNode<Tree>* >( nodes[i] );
+            break;
+        }
+    }
+
+    if ( tree_node == NULL )
+    {
+        throw RbException("The model does not contain a stochastic tree variable with name '" + tree_name + "'.");
+    }
+    if ( RbMath::isFinite( tree_node->getValue().getRoot().getAge() ) == true )
+    {
+        throw RbException("The maximum likelihood tree search needs a tree with free branch lengths and not a time tree.");
+    }
+
+    RbOrderedSet<DagNode*> affected;
+    tree_node->initiateGetAffectedNodes( affected );
+    for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+    {
+        StochasticNode<AbstractHomologousDiscreteCharacterData> *n = dynamic_cast<StochasticNode<AbstractHomologousDiscreteCharacterData>* >( *it );
+        BranchLengthLikelihoodEvaluator *evaluator = ( n != NULL ? dynamic_cast<BranchLengthLikelihoodEvaluator*>( &n->getDistribution() ) : NULL );
+        if ( evaluator == NULL || n->isClamped() == false )
+        {
+            throw RbException("The maximum likelihood tree search only supports clamped phylogenetic CTMCs depending on the tree '" + tree_name + "', but '" + (*it)->getName() + "' is not one.");
+        }
+        likelihood_nodes.push_back( n );
+        evaluators.push_back( evaluator );
+    }
+
+    if ( likelihood_nodes.empty() == true )
+    {
+        throw RbException("There is no character data depending on the tree '" + tree_name + "'.");
+    }
+
+}
+
+
+/**
+ * Optimize the length of the branch above the node and keep the new value in the tree.
+ *
+ * \return The ln likelihood with the new branch length.
+ */
+double MaximumLikelihoodTreeSearch::optimizeBranchLength(TopologyNode &n, double ln_likelihood, size_t max_iterations)
+{
+
+    double branch_length = optimizeNewton(n, max_iterations);
+    if ( branch_length == n.getBranchLength() )
+    {
+        return ln_likelihood;
+    }
+
+    n.setBranchLength( branch_length );
+    tree_node->touch();
+    double ln_new = computeLnLikelihood();
+    tree_node->keep();
+
+    return ln_new;
+}
+
+
+/**
+ * Optimize every branch length once, in pre-order so that the branches close to the root come first.
+ *
+ * \return The ln likelihood with the new branch lengths.
+ */
+double MaximumLikelihoodTreeSearch::optimizeBranchLengths(double ln_likelihood)
+{
+
+    std::vector<TopologyNode*> stack = std::vector<TopologyNode*>( 1, &tree_node->getValue().getRoot() );
+    while ( stack.empty() == false )
+    {
+        TopologyNode *n = stack.back();
+        stack.pop_back();
+
+        if ( n->isRoot() == false )
+        {
+            ln_likelihood = optimizeBranchLength( *n, ln_likelihood, 10 );
+        }
+
+        for (size_t i = 0; i < n->getNumberOfChildren(); ++i)
+        {
+            stack.push_back( &n->getChild( i ) );
+        }
+    }
+
+    return ln_likelihood;
+}
+
+
+/**
+ * Find the maximum likelihood length of the branch above the node by Newton-Raphson, keeping all other branches fixed.
+ * If the second derivative is not negative, the Newton step does not point to a maximum and we double or halve the length
+ * in the direction of the first derivative instead. A step that decreases the likelihood, or makes it non-finite, is halved until it does not.
+ * The tree is not changed.
+ *
+ * \return The optimal branch length.
+ */
+double MaximumLikelihoodTreeSearch::optimizeNewton(const TopologyNode &n, size_t max_iterations)
+{
+
+    for (size_t i = 0; i < evaluators.size(); ++i)
+    {
+        if ( evaluators[i]->prepareBranchLengthOptimization( n ) == false )
+        {
+            throw RbException("The likelihood of '" + likelihood_nodes[i]->getName() + "' cannot optimize single branch lengths.");
+        }
+    }
+
+    double t = n.getBranchLength();
+    t = ( t < MIN_BRANCH_LENGTH ? MIN_BRANCH_LENGTH : ( t > MAX_BRANCH_LENGTH ? MAX_BRANCH_LENGTH : t ) );
+
+    double ln = 0.0, first = 0.0, second = 0.0;
+    for (size_t i = 0; i < evaluators.size(); ++i)
+    {
+        double a = 0.0, b = 0.0, c = 0.0;
+        evaluators[i]->computeBranchLengthDerivatives(t, a, b, c);
+        ln += a;
+        first += b;
+        second += c;
+    }
+
+    for (size_t iteration = 0; iteration < max_iterations; ++iteration)
+    {
+        double t_new = ( second < 0.0 ? t - first / second : ( first > 0.0 ? 2.0 * t : 0.5 * t ) );
+        t_new = ( t_new < MIN_BRANCH_LENGTH ? MIN_BRANCH_LENGTH : ( t_new > MAX_BRANCH_LENGTH ? MAX_BRANCH_LENGTH : t_new ) );
+
+        double ln_new = RbConstants::Double::neginf, first_new = 0.0, second_new = 0.0;
+        for (size_t halvings = 0; halvings < 20; ++halvings)
+        {
+            ln_new = 0.0;
+            first_new = 0.0;
+            second_new = 0.0;
+            for (size_t i = 0; i < evaluators.size(); ++i)
+            {
+                double a = 0.0, b = 0.0, c = 0.0;
+                evaluators[i]->computeBranchLengthDerivatives(t_new, a, b, c);
+                ln_new += a;
+                first_new += b;
+                second_new += c;
+            }
+
+            // a step into a region where the likelihood cannot be computed is halved as well
+            if ( RbMath::isFinite(ln_new) == true && ln_new >= ln )
+            {
+                break;
+            }
+            t_new = 0.5 * (t + t_new);
+        }
+
+        if ( RbMath::isFinite(ln_new) == false || ln_new < ln )
+        {
+            break;
+        }
+
+        bool converged = ( fabs(t_new - t) < BRANCH_LENGTH_TOLERANCE );
+        t = t_new;
+        ln = ln_new;
+        first = first_new;
+        second = second_new;
+
+        if ( converged == true )
+        {
+            break;
+        }
+    }
+
+    return t;
+}
+
+
+/**
+ * Move the node p, together with its other child, from the branch above b to the branch above x.
+ * Only the topology is changed; the caller sets the branch lengths.
+ */
+void MaximumLikelihoodTreeSearch::regraft(TopologyNode &p, TopologyNode &b, TopologyNode &x)
+{
+
+    // prune
+    TopologyNode &g = p.getParent();
+    g.removeChild( &p );
+    p.removeChild( &b );
+    g.addChild( &b );
+    b.setParent( &g );
+
+    // regraft
+    TopologyNode &h = x.getParent();
+    h.removeChild( &x );
+    h.addChild( &p );
+    p.setParent( &h );
+    p.addChild( &x );
+    x.setParent( &p );
+
+}
+
+
+/**
+ * Search for the maximum likelihood tree.
+ * We first optimize the branch lengths and then alternate rounds of NNI, lazy SPR and branch length optimization
+ * until a round improves the ln likelihood by less than e or we reach the maximum number of rounds.
+ *
+ * \param[in]    e              The minimum improvement of the ln likelihood per round.
+ * \param[in]    max_rounds     The maximum number of rounds.
+ * \param[in]    radius         The maximum number of branches between the old and the new position of a subtree in the SPR rounds.
+ * \param[in]    verbose        Print the ln likelihood after each round.
+ *
+ * \return The ln likelihood of the final tree.
+ */
+double MaximumLikelihoodTreeSearch::run(double e, size_t max_rounds, size_t radius, bool verbose)
+{
+
+    // we need the partial likelihoods of the last state to reuse them
+    std::vector<DagNode*> &nodes = model->getDagNodes();
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        nodes[i]->setMcmcMode( true );
+        nodes[i]->setPriorOnly( false );
+        nodes[i]->touch();
+    }
+    double ln_likelihood = computeLnLikelihood();
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        nodes[i]->keep();
+    }
+
+    if ( RbMath::isFinite( ln_likelihood ) == false )
+    {
+        throw RbException("The ln likelihood of the starting tree is not finite.");
+    }
+
+    if ( verbose == true && process_active == true )
+    {
+        std::cout << std::endl;
+        std::cout << "Running maximum likelihood tree search ..." << std::endl;
+        std::cout << "Starting tree:\tlnL = " << ln_likelihood << std::endl;
+    }
+
+    ln_likelihood = optimizeBranchLengths( ln_likelihood );
+
+    for (size_t round = 1; round <= max_rounds; ++round)
+    {
+        double ln_before = ln_likelihood;
+
+        size_t num_nni = 0;
+        size_t num_spr = 0;
+        ln_likelihood = runNNIRound( ln_likelihood, e, num_nni );
+        if ( radius > 0 )
+        {
+            ln_likelihood = runSPRRound( ln_likelihood, e, radius, num_spr );
+        }
+        ln_likelihood = optimizeBranchLengths( ln_likelihood );
+
+        if ( verbose == true && process_active == true )
+        {
+            std::cout << "Round " << round << ":\tlnL = " << ln_likelihood << "\t(" << num_nni << " NNI, " << num_spr << " SPR)" << std::endl;
+        }
+
+        if ( ln_likelihood - ln_before < e )
+        {
+            break;
+        }
+    }
+
+    current_ln_likelihood = ln_likelihood;
+
+    return ln_likelihood;
+}
+
+
+/**
+ * Try the nearest-neighbor interchanges around every internal branch, i.e., exchange either child of the node
+ * with each sibling of the node. There are two siblings if the parent is a multifurcating root.
+ * The length of the branch is optimized for the new topology, and we keep the first interchange that improves the
+ * ln likelihood by at least e.
+ *
+ * \return The ln likelihood after the round.
+ */
+double MaximumLikelihoodTreeSearch::runNNIRound(double ln_likelihood, double e, size_t &num_improvements)
+{
+
+    Tree &tau = tree_node->getValue();
+    for (size_t i = 0; i < tau.getNumberOfNodes(); ++i)
+    {
+        TopologyNode &v = tau.getNode( i );
+        if ( v.isTip() == true || v.isRoot() == true || v.getNumberOfChildren() != 2 )
+        {
+            continue;
+        }
+
+        // the siblings of v, which we exchange with either child of v
+        TopologyNode &p = v.getParent();
+        std::vector<TopologyNode*> siblings;
+        for (size_t j = 0; j < p.getNumberOfChildren(); ++j)
+        {
+            if ( &p.getChild( j ) != &v )
+            {
+                siblings.push_back( &p.getChild( j ) );
+            }
+        }
+
+        // the children change their order when we swap, so we need to remember them
+        std::vector<TopologyNode*> children = v.getChildren();
+        bool improved = false;
+        for (size_t j = 0; j < siblings.size() && improved == false; ++j)
+        {
+            TopologyNode &s = *siblings[j];
+            for (size_t k = 0; k < children.size(); ++k)
+            {
+                TopologyNode &a = *children[k];
+                double branch_length = v.getBranchLength();
+
+                swapSubtrees( a, s );
+                tree_node->touch();
+
+                v.setBranchLength( optimizeNewton( v, 5 ) );
+                tree_node->touch();
+                double ln_new = computeLnLikelihood();
+
+                if ( ln_new > ln_likelihood + e )
+                {
+                    tree_node->keep();
+                    ln_likelihood = ln_new;
+                    ++num_improvements;
+                    improved = true;
+                    break;
+                }
+                else
+                {
+                    swapSubtrees( s, a );
+                    v.setBranchLength( branch_length );
+                    tree_node->restore();
+                }
+            }
+        }
+    }
+
+    return ln_likelihood;
+}
+
+
+/**
+ * Prune every subtree and regraft it at all branches within the given radius of its current position.
+ * The regraft points are evaluated lazily, i.e., the subtree keeps its branch length, the branch of the regraft point
+ * is split in half and the two branches at the old position are merged, without optimizing any branch length.
+ * If the best regraft point improves the ln likelihood by at least e, we move the subtree there
+ * and optimize the branch lengths around the new position.
+ *
+ * \return The ln likelihood after the round.
+ */
+double MaximumLikelihoodTreeSearch::runSPRRound(double ln_likelihood, double e, size_t radius, size_t &num_improvements)
+{
+
+    Tree &tau = tree_node->getValue();
+    for (size_t i = 0; i < tau.getNumberOfNodes(); ++i)
+    {
+        TopologyNode &s = tau.getNode( i );
+        if ( s.isRoot() == true || s.getParent().isRoot() == true || s.getParent().getNumberOfChildren() != 2 )
+        {
+            continue;
+        }
+
+        TopologyNode &p = s.getParent();
+        TopologyNode &g = p.getParent();
+        TopologyNode &b = ( &p.getChild( 0 ) == &s ? p.getChild( 1 ) : p.getChild( 0 ) );
+
+        // collect the branches within the radius in the tree without the subtree,
+        // where the branches are identified by the node below them
+        std::vector<TopologyNode*> candidates;
+        std::set<TopologyNode*> visited;
+        std::vector<TopologyNode*> current = std::vector<TopologyNode*>( 1, &b );
+        visited.insert( &b );
+        for (size_t distance = 1; distance <= radius && current.empty() == false; ++distance)
+        {
+            std::vector<TopologyNode*> next;
+            for (size_t j = 0; j < current.size(); ++j)
+            {
+                TopologyNode *n = current[j];
+
+                // the neighbors in the tree without the subtree: p is skipped, so b and g are connected directly
+                std::vector<TopologyNode*> neighbors;
+                if ( n->isRoot() == false )
+                {
+                    neighbors.push_back( n == &b ? &g : &n->getParent() );
+                }
+                for (size_t k = 0; k < n->getNumberOfChildren(); ++k)
+                {
+                    TopologyNode *child = &n->getChild( k );
+                    neighbors.push_back( child == &p ? &b : child );
+                }
+
+                for (size_t k = 0; k < neighbors.size(); ++k)
+                {
+                    TopologyNode *m = neighbors[k];
+                    if ( visited.insert( m ).second == true )
+                    {
+                        next.push_back( m );
+                        if ( m->isRoot() == false )
+                        {
+                            candidates.push_back( m );
+                        }
+                    }
+                }
+            }
+            current = next;
+        }
+
+        // evaluate all regraft points
+        double branch_length_p = p.getBranchLength();
+        double branch_length_b = b.getBranchLength();
+        double best_ln_likelihood = ln_likelihood;
+        TopologyNode *best = NULL;
+        for (size_t j = 0; j < candidates.size(); ++j)
+        {
+            TopologyNode &x = *candidates[j];
+            double branch_length_x = x.getBranchLength();
+
+            regraft( p, b, x );
+            b.setBranchLength( branch_length_b + branch_length_p );
+            p.setBranchLength( 0.5 * branch_length_x );
+            x.setBranchLength( 0.5 * branch_length_x );
+            tree_node->touch();
+            double ln_new = computeLnLikelihood();
+
+            regraft( p, x, b );
+            b.setBranchLength( branch_length_b );
+            p.setBranchLength( branch_length_p );
+            x.setBranchLength( branch_length_x );
+            tree_node->restore();
+
+            if ( ln_new > best_ln_likelihood )
+            {
+                best_ln_likelihood = ln_new;
+                best = &x;
+            }
+        }
+
+        if ( best != NULL && best_ln_likelihood > ln_likelihood + e )
+        {
+            double branch_length_x = best->getBranchLength();
+            regraft( p, b, *best );
+            b.setBranchLength( branch_length_b + branch_length_p );
+            p.setBranchLength( 0.5 * branch_length_x );
+            best->setBranchLength( 0.5 * branch_length_x );
+            tree_node->touch();
+            ln_likelihood = computeLnLikelihood();
+            tree_node->keep();
+
+            // optimize the branches around the new position
+            ln_likelihood = optimizeBranchLength( p, ln_likelihood, 10 );
+            ln_likelihood = optimizeBranchLength( *best, ln_likelihood, 10 );
+            ln_likelihood = optimizeBranchLength( s, ln_likelihood, 10 );
+            ++num_improvements;
+        }
+    }
+
+    return ln_likelihood;
+}
+
+
+void MaximumLikelihoodTreeSearch::setActivePIDSpecialized(size_t a, size_t n)
+{
+
+    model->setActivePID( a, n );
+
+}
+
+
+void MaximumLikelihoodTreeSearch::setNumberOfThreadsSpecialized(size_t n)
+{
+
+    model->setNumberOfThreads( n );
+
+}
+
+
+/**
+ * Exchange the parents of the nodes a and b, i.e., the subtrees below a and b change places.
+ */
+void MaximumLikelihoodTreeSearch::swapSubtrees(TopologyNode &a, TopologyNode &b)
+{
+
+    TopologyNode &parent_a = a.getParent();
+    TopologyNode &parent_b = b.getParent();
+
+    parent_a.removeChild( &a );
+    parent_b.removeChild( &b );
+    parent_a.addChild( &b );
+    b.setParent( &parent_a );
+    parent_b.addChild( &a );
+    a.setParent( &parent_b );
+
+}
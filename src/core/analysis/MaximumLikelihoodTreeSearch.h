@@ -0,0 +1,89 @@
+#ifndef MaximumLikelihoodTreeSearch_H
+#define MaximumLikelihoodTreeSearch_H
+
+#include "Cloneable.h"
+#include "Parallelizable.h"
+
+#include <string>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class AbstractHomologousDiscreteCharacterData;
+    class BranchLengthLikelihoodEvaluator;
+    class Model;
+    class TopologyNode;
+    class Tree;
+    template <class valueType> class StochasticNode;
+
+    /**
+     * @brief Maximum likelihood estimation of a tree with free branch lengths.
+     *
+     * Instead of proposing random changes and accepting only improvements, as the HillClimber does with the MCMC moves,
+     * we search the tree space directly:
+     * (1) All branch lengths are optimized one at a time by Newton-Raphson, using the analytic first and second derivatives
+     *     of the likelihood with respect to a single branch (see BranchLengthLikelihoodEvaluator).
+     * (2) In a round of nearest-neighbor interchanges (NNI), we try both alternative topologies around each internal branch,
+     *     optimize the length of that branch and keep the first improvement.
+     * (3) In a round of lazy subtree prune-and-regraft (SPR), we prune every subtree and regraft it at all branches within a
+     *     given distance, without optimizing the branch lengths. Only the best regraft point, if it improves the likelihood,
+     *     is applied and the branches around it are optimized.
+     * These rounds are repeated until the improvement of the ln likelihood is less than epsilon.
+     *
+     * Every change of the tree is evaluated by the DAG, i.e., the likelihood only recomputes the partial likelihoods
+     * along the path to the root that were affected by the change.
+     * We maximize the likelihood of the character data on the tree only; the prior of the tree and all other parameters
+     * are fixed at their current values. We work on our own copy of the model, so the original model is never changed.
+     *
+     * The search can be repeated on bootstrapped data, starting from the current tree, to obtain bootstrap trees.
+     *
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     *
+     */
+    class MaximumLikelihoodTreeSearch : public Cloneable, public Parallelizable {
+
+    public:
+        MaximumLikelihoodTreeSearch(const Model &m, const std::string &n);
+        MaximumLikelihoodTreeSearch(const MaximumLikelihoodTreeSearch &t);
+        virtual                                            ~MaximumLikelihoodTreeSearch(void);                                     //!< Virtual destructor
+
+        MaximumLikelihoodTreeSearch&                        operator=(const MaximumLikelihoodTreeSearch &t);
+
+        // public methods
+        std::vector<Tree>                                   bootstrap(size_t n, double e, size_t max_rounds, size_t radius, bool verbose);  //!< The maximum likelihood trees of bootstrapped data sets
+        MaximumLikelihoodTreeSearch*                        clone(void) const;                                                      //!< Clone function. This is similar to the copy constructor but useful in inheritance.
+        double                                              getLnLikelihood(void) const;                                            //!< The ln likelihood of the current tree
+        const Tree&                                         getTree(void) const;                                                    //!< The current tree
+        double                                              run(double e, size_t max_rounds, size_t radius, bool verbose=true);     //!< Search for the maximum likelihood tree
+
+    protected:
+        void                                                setActivePIDSpecialized(size_t i, size_t n);                            //!< Set the number of processes for this class.
+        void                                                setNumberOfThreadsSpecialized(size_t n);                                //!< Set the number of threads for this class.
+
+    private:
+
+        double                                              computeLnLikelihood(void);                                              //!< The ln likelihood of the data after the tree was touched
+        void                                                initialize(void);                                                       //!< Find the tree and the likelihoods in the model
+        double                                              optimizeBranchLength(TopologyNode &n, double ln_likelihood, size_t max_iterations);    //!< Optimize a single branch length and keep the new value
+        double                                              optimizeBranchLengths(double ln_likelihood);                           //!< Optimize all branch lengths once
+        double                                              optimizeNewton(const TopologyNode &n, size_t max_iterations);           //!< The optimal length of the branch above the node
+        void                                                regraft(TopologyNode &p, TopologyNode &b, TopologyNode &x);             //!< Move the node p from the branch above b to the branch above x
+        double                                              runNNIRound(double ln_likelihood, double e, size_t &num_improvements);  //!< Try all nearest-neighbor interchanges once
+        double                                              runSPRRound(double ln_likelihood, double e, size_t radius, size_t &num_improvements);  //!< Try to prune and regraft every subtree once
+        void                                                swapSubtrees(TopologyNode &a, TopologyNode &b);                         //!< Exchange the parents of two nodes
+
+        Model*                                                                  model;                                          //!< Our copy of the model
+        std::string                                                             tree_name;                                      //!< The name of the tree variable
+        StochasticNode<Tree>*                                                   tree_node;                                      //!< The tree variable in our copy of the model
+        std::vector<StochasticNode<AbstractHomologousDiscreteCharacterData>* >  likelihood_nodes;                               //!< The character data depending on the tree
+        std::vector<BranchLengthLikelihoodEvaluator*>                           evaluators;                                     //!< The likelihoods of the character data
+        double                                                                  current_ln_likelihood;                          //!< The ln likelihood of the current tree
+
+    };
+
+}
+
+#endif
@@ -358,6 +358,26 @@ void Model::setActivePIDSpecialized(size_t a, size_t n)
 }
 
 
+/**
+ * Set the number of threads of this specific model object.
+ *
+ * @param n new number of threads
+ */
+void Model::setNumberOfThreadsSpecialized(size_t n)
+{
+    
+    // delegate the call to each DAG node
+    for (std::vector<DagNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        
+        DagNode *the_node = *it;
+        the_node->setNumberOfThreads( num_threads );
+        
+    }
+    
+}
+
+
 std::ostream& RevBayesCore::operator<<(std::ostream& o, const Model& m)
 {
     
@@ -50,6 +50,7 @@ namespace RevBayesCore {
         
     protected:
         void                                                        setActivePIDSpecialized(size_t i, size_t n);   //!< Set the active PID and number of processes for this model.
+        void                                                        setNumberOfThreadsSpecialized(size_t n);       //!< Set the number of threads for this model.
 
         
     private:
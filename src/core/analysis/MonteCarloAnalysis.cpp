@@ -1,7 +1,12 @@
 #include <cmath>
+#include <cstring>
 #include <cstddef>
 #include <cstdlib>
+#include <iostream>
+#include <map>
 #include <ostream>
+#include <set>
+#include <sstream>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -13,6 +18,7 @@
 #include "MonteCarloAnalysis.h"
 #include "MonteCarloSampler.h"
 #include "MpiUtilities.h"
+#include "Profiler.h"
 #include "ProgressBar.h"
 #include "RlUserInterface.h"
 #include "Cloneable.h"
@@ -25,6 +31,7 @@
 #include "RbVector.h"
 #include "RbVectorImpl.h"
 #include "StoppingRule.h"
+#include "StringUtilities.h"
 #include "Trace.h"
 
 
@@ -209,6 +216,17 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
     }
     
     
+    // the moves may adapt to the burnin cycles
+    for (size_t i=0; i<replicates; ++i)
+    {
+        
+        if ( runs[i] != NULL )
+        {
+            runs[i]->setAdaptation( true );
+        }
+        
+    }
+    
     // Run the chain
     for (size_t k=1; k<=generations; ++k)
     {
@@ -237,6 +255,16 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
         
     }
     
+    for (size_t i=0; i<replicates; ++i)
+    {
+        
+        if ( runs[i] != NULL )
+        {
+            runs[i]->setAdaptation( false );
+        }
+        
+    }
+    
 #ifdef RB_MPI
     MPI_Barrier(MPI_COMM_WORLD);
 #endif
@@ -254,6 +282,42 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
 
 
 
+/**
+ * Write the checkpoints of all replicates of this process and then the state of the random number generator.
+ * The replicates share the random number generator, so we store its state once, after all replicates finished this iteration.
+ */
+void MonteCarloAnalysis::checkpoint(const std::string &checkpoint_file, size_t gen) const
+{
+    
+    bool has_runs = false;
+    for (size_t i=0; i<replicates; ++i)
+    {
+        
+        if ( runs[i] != NULL )
+        {
+            runs[i]->checkpoint();
+            has_runs = true;
+        }
+        
+    }
+    
+    if ( has_runs == true )
+    {
+        std::stringstream out_stream;
+        out_stream << "iter = " << gen << std::endl;
+        out_stream << "rng = " << GLOBAL_RNG->getState() << std::endl;
+        
+        std::string rng_checkpoint_file = getRandomNumberGeneratorCheckpointFile( checkpoint_file );
+        RbFileManager fm = RbFileManager( rng_checkpoint_file );
+        if ( fm.writeFile( out_stream.str(), true ) == false )
+        {
+            throw RbException("Could not write the checkpoint file \"" + rng_checkpoint_file + "\".");
+        }
+    }
+    
+}
+
+
 MonteCarloAnalysis* MonteCarloAnalysis::clone( void ) const
 {
     
@@ -295,6 +359,25 @@ size_t MonteCarloAnalysis::getCurrentGeneration( void ) const
 }
 
 
+/**
+ * Get the name of the file with the state of the random number generator.
+ * Every process has its own random number generator, so the file is per process if there are several.
+ */
+std::string MonteCarloAnalysis::getRandomNumberGeneratorCheckpointFile(const std::string &checkpoint_file) const
+{
+    
+    std::stringstream ss;
+    ss << "_rng";
+    if ( num_processes > 1 )
+    {
+        ss << "_process_" << pid;
+    }
+    
+    RbFileManager fm = RbFileManager(checkpoint_file);
+    return fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + ss.str() + "." + fm.getFileExtension();
+}
+
+
 const Model& MonteCarloAnalysis::getModel( void ) const
 {
     
@@ -312,6 +395,31 @@ const Model& MonteCarloAnalysis::getModel( void ) const
 }
 
 
+/**
+ * Get the monitors of all replicates that this process runs.
+ */
+std::vector<const Monitor*> MonteCarloAnalysis::getMonitors( void ) const
+{
+    
+    std::vector<const Monitor*> m;
+    for (size_t i=0; i<replicates; ++i)
+    {
+        
+        if ( runs[i] != NULL )
+        {
+            const RbVector<Monitor> &replicate_monitors = runs[i]->getMonitors();
+            for (size_t j=0; j<replicate_monitors.size(); ++j)
+            {
+                m.push_back( &replicate_monitors[j] );
+            }
+        }
+        
+    }
+    
+    return m;
+}
+
+
 void MonteCarloAnalysis::initializeFromCheckpoint(const std::string &checkpoint_file)
 {
     
@@ -339,9 +447,61 @@ void MonteCarloAnalysis::initializeFromCheckpoint(const std::string &checkpoint_
             
         }
         
+    }
+    
+    // if we crashed while writing a checkpoint, we continue from the previous one
+    if ( checkpoint_file != "" )
+    {
+        restoreCompleteCheckpoint( checkpoint_file );
+    }
+    
+    for (size_t i = 0; i < replicates; ++i)
+    {
         // then, initialize the sample for that replicate
         runs[i]->initializeSamplerFromCheckpoint();
     }
+    
+    // the replicates must continue from the same iteration, otherwise the checkpoints are from different times
+    for (size_t i = 1; i < replicates; ++i)
+    {
+        if ( runs[i]->getCurrentGeneration() != runs[0]->getCurrentGeneration() )
+        {
+            throw RbException("The checkpoints of the replicates are from different iterations.");
+        }
+    }
+    
+    // finally, we continue with the random numbers of the checkpointed run
+    // (older checkpoints don't have this file and each replicate restored the state itself)
+    std::string rng_checkpoint_file = getRandomNumberGeneratorCheckpointFile( checkpoint_file );
+    RbFileManager fm = RbFileManager( rng_checkpoint_file );
+    if ( checkpoint_file != "" && fm.isFile() == true )
+    {
+        std::string buffer;
+        if ( fm.readFile( buffer ) == false )
+        {
+            throw RbException("Could not read the checkpoint file \"" + rng_checkpoint_file + "\".");
+        }
+        
+        std::map<std::string, std::string> pars;
+        std::vector<std::string> lines;
+        StringUtilities::stringSplit( buffer, "\n", lines );
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            std::vector<std::string> key_value;
+            StringUtilities::stringSplit( lines[i], " = ", key_value );
+            if ( key_value.size() == 2 )
+            {
+                pars[ key_value[0] ] = key_value[1];
+            }
+        }
+        
+        if ( pars.find( "iter" ) == pars.end() || pars.find( "rng" ) == pars.end() || size_t( StringUtilities::asIntegerNumber( pars["iter"] ) ) != runs[0]->getCurrentGeneration() )
+        {
+            throw RbException("The checkpoint file \"" + rng_checkpoint_file + "\" is incomplete or from a different iteration than the checkpoints of the replicates.");
+        }
+        GLOBAL_RNG->setState( pars["rng"] );
+    }
+    
 }
 
 
@@ -395,8 +555,10 @@ void MonteCarloAnalysis::initializeFromTrace( RbVector<ModelTrace> traces )
 
 /**
  * Print out a summary of the current performance.
+ * If profiling is enabled, we also print the time spent per move, variable and likelihood phase in this process,
+ * and write it as a table to the profile file (if one is given).
  */
-void MonteCarloAnalysis::printPerformanceSummary( bool current_period ) const
+void MonteCarloAnalysis::printPerformanceSummary( bool current_period, const std::string &profile_file ) const
 {
     
 #ifdef RB_MPI
@@ -408,6 +570,18 @@ void MonteCarloAnalysis::printPerformanceSummary( bool current_period ) const
         runs[0]->printOperatorSummary( current_period );
     }
     
+    const Profiler &profiler = Profiler::globalProfiler();
+    if ( process_active == true && profiler.isEnabled() == true )
+    {
+        profiler.printSummary( std::cout );
+        std::cout.flush();
+        
+        if ( profile_file != "" )
+        {
+            profiler.writeTable( profile_file );
+        }
+    }
+    
 #ifdef RB_MPI
     MPI_Barrier(MPI_COMM_WORLD);
 #endif
@@ -415,6 +589,55 @@ void MonteCarloAnalysis::printPerformanceSummary( bool current_period ) const
 }
 
 
+/**
+ * Read the iteration that a checkpoint file records in its first line ("iter = g" or "# iter = g")
+ * or, for the binary values, in its header (see Mcmc::getBinaryCheckpoint).
+ * Returns false if the file doesn't exist or doesn't record the iteration (files written by older versions).
+ */
+bool MonteCarloAnalysis::readCheckpointIteration(const std::string &file_name, size_t &g) const
+{
+    
+    RbFileManager fm = RbFileManager( file_name );
+    std::string buffer;
+    if ( fm.isFile() == false || fm.readFile( buffer ) == false )
+    {
+        return false;
+    }
+    
+    if ( buffer.compare( 0, 6, "RBCKPT" ) == 0 )
+    {
+        // the magic string, the version and, since version 2, the iteration
+        uint32_t version = 0;
+        uint64_t iteration = 0;
+        if ( buffer.size() < 6 + sizeof(version) + sizeof(iteration) )
+        {
+            return false;
+        }
+        std::memcpy( &version, buffer.data() + 6, sizeof(version) );
+        std::memcpy( &iteration, buffer.data() + 6 + sizeof(version), sizeof(iteration) );
+        g = iteration;
+        
+        return version >= 2;
+    }
+    
+    std::string line = buffer.substr( 0, buffer.find( '\n' ) );
+    if ( line.empty() == false && line[line.size()-1] == '\r' )
+    {
+        line.erase( line.size()-1 );
+    }
+    
+    std::vector<std::string> key_value;
+    StringUtilities::stringSplit( line, " = ", key_value );
+    if ( key_value.size() == 2 && ( key_value[0] == "iter" || key_value[0] == "# iter" ) )
+    {
+        g = StringUtilities::asIntegerNumber( key_value[1] );
+        return true;
+    }
+    
+    return false;
+}
+
+
 /**
  * Remove the monitors.
  */
@@ -522,6 +745,7 @@ void MonteCarloAnalysis::resetReplicates( void )
             }
             
             runs[i]->setActivePID( replicate_pid_start, number_processes_per_replicate );
+            runs[i]->setNumberOfThreads( num_threads );
             //            runs[i]->setMasterSampler( i == 0 );
         }
         
@@ -601,6 +825,92 @@ void MonteCarloAnalysis::resetReplicates( void )
 }
 
 
+/**
+ * Make the files of the last complete checkpoint the current checkpoint files.
+ * Every checkpoint file keeps the file of the previous checkpoint (see RbFileManager::writeFile). If we crashed
+ * while checkpointing, some files are already from the new checkpoint while the others only exist for the previous one.
+ * Then we restore the previous versions, so that all replicates and the random number generator continue from the previous checkpoint.
+ */
+void MonteCarloAnalysis::restoreCompleteCheckpoint(const std::string &checkpoint_file)
+{
+    
+    std::vector<std::string> files;
+    for (size_t i = 0; i < replicates; ++i)
+    {
+        
+        if ( runs[i] != NULL )
+        {
+            std::vector<std::string> run_files = runs[i]->getCheckpointFiles();
+            files.insert( files.end(), run_files.begin(), run_files.end() );
+        }
+        
+    }
+    files.push_back( getRandomNumberGeneratorCheckpointFile( checkpoint_file ) );
+    
+    // the iterations of the current and the previous version of every file
+    std::vector<std::set<size_t> > file_iterations( files.size() );
+    std::set<size_t> iterations;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        RbFileManager fm = RbFileManager( files[i] );
+        
+        size_t g = 0;
+        if ( readCheckpointIteration( files[i], g ) == true )
+        {
+            file_iterations[i].insert( g );
+            iterations.insert( g );
+        }
+        if ( readCheckpointIteration( fm.getPreviousFileName(), g ) == true )
+        {
+            file_iterations[i].insert( g );
+            iterations.insert( g );
+        }
+    }
+    
+    // checkpoints of older versions don't record the iteration
+    if ( iterations.empty() == true )
+    {
+        return;
+    }
+    
+    // we continue from the last iteration for which all files exist
+    // (files that don't record the iteration are not checked, e.g., older checkpoints don't have the binary values)
+    bool found = false;
+    size_t last_iteration = 0;
+    for (std::set<size_t>::const_reverse_iterator it = iterations.rbegin(); it != iterations.rend() && found == false; ++it)
+    {
+        found = true;
+        last_iteration = *it;
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            if ( file_iterations[i].empty() == false && file_iterations[i].find( last_iteration ) == file_iterations[i].end() )
+            {
+                found = false;
+                break;
+            }
+        }
+    }
+    
+    if ( found == false )
+    {
+        throw RbException("The checkpoint files are from different checkpoints and none of these checkpoints is complete.");
+    }
+    
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        size_t g = 0;
+        if ( file_iterations[i].empty() == false && ( readCheckpointIteration( files[i], g ) == false || g != last_iteration ) )
+        {
+            RbFileManager fm = RbFileManager( files[i] );
+            if ( fm.restorePreviousFile() == false )
+            {
+                throw RbException("Could not restore the checkpoint file \"" + files[i] + "\" of the previous checkpoint.");
+            }
+        }
+    }
+    
+}
+
 
 #ifdef RB_MPI
 void MonteCarloAnalysis::run( size_t kIterations, RbVector<StoppingRule> rules, const MPI_Comm &analysis_comm, size_t tuning_interval, const std::string &checkpoint_file, size_t checkpoint_interval, bool verbose )
@@ -757,18 +1067,16 @@ void MonteCarloAnalysis::run( size_t kIterations, RbVector<StoppingRule> rules,
                     
                 }
                 
-                // check for autotuning
-                if ( checkpoint_interval != 0 && (gen % checkpoint_interval) == 0 )
-                {
-                    
-                    runs[i]->checkpoint();
-                    
-                }
-                
             }
             
         }
         
+        // write the checkpoints after all replicates finished this iteration
+        if ( checkpoint_interval != 0 && (gen % checkpoint_interval) == 0 )
+        {
+            checkpoint( checkpoint_file, gen );
+        }
+        
         converged = true;
         size_t numConvergenceRules = 0;
         // do the stopping test
@@ -1029,6 +1337,26 @@ void MonteCarloAnalysis::setActivePIDSpecialized(size_t a, size_t n)
 }
 
 
+/**
+ * Set the number of threads of this specific Monte Carlo analysis.
+ * Each replicate of this process may use all threads for its likelihood computations.
+ */
+void MonteCarloAnalysis::setNumberOfThreadsSpecialized(size_t n)
+{
+    
+    for (size_t i = 0; i < replicates; ++i)
+    {
+        
+        if ( runs[i] != NULL )
+        {
+            runs[i]->setNumberOfThreads( num_threads );
+        }
+        
+    }
+    
+}
+
+
 /**
  * Set the model by delegating the model to the Monte Carlo samplers (replicates).
  */
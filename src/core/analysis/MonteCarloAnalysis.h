@@ -18,6 +18,7 @@
 namespace RevBayesCore {
     
     class Model;
+    class Monitor;
     class MonteCarloSampler;
     
     /**
@@ -54,9 +55,10 @@ namespace RevBayesCore {
         void                                                disableScreenMonitors(bool all);
         size_t                                              getCurrentGeneration(void) const;                               //!< Get the current generations number
         const Model&                                        getModel(void) const;
+        std::vector<const Monitor*>                         getMonitors(void) const;                                        //!< The monitors of all replicates of this process
         void                                                initializeFromCheckpoint( const std::string &f );
         void                                                initializeFromTrace( RbVector<ModelTrace> traces );
-        void                                                printPerformanceSummary(bool current_period = false) const;
+        void                                                printPerformanceSummary(bool current_period = false, const std::string &profile_file = "") const;   //!< Print the operator summary and the profile (if profiling is enabled)
         void                                                removeMonitors(void);                                           //!< Remove all monitors
 #ifdef RB_MPI
         void                                                run(size_t k, RbVector<StoppingRule> r, const MPI_Comm &c, size_t ti, const std::string &cp_file, size_t ci=0, bool verbose=true);
@@ -71,7 +73,12 @@ namespace RevBayesCore {
 #endif
         
     protected:
+        void                                                checkpoint(const std::string &f, size_t g) const;               //!< Write the checkpoints of all replicates and the state of the random number generator
+        std::string                                         getRandomNumberGeneratorCheckpointFile(const std::string &f) const;     //!< The file with the state of the random number generator of this process
+        bool                                                readCheckpointIteration(const std::string &f, size_t &g) const; //!< Read the iteration recorded by a checkpoint file
+        void                                                restoreCompleteCheckpoint(const std::string &f);                //!< Make the files of the last complete checkpoint the current ones
         void                                                setActivePIDSpecialized(size_t i, size_t n);                    //!< Set the number of processes for this class.
+        void                                                setNumberOfThreadsSpecialized(size_t n);                        //!< Set the number of threads for this class.
 #ifdef RB_MPI
         void                                                resetReplicates(const MPI_Comm &c);
 #else
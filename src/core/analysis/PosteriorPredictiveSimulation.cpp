@@ -2,8 +2,10 @@
 #include <typeinfo>
 #include <algorithm>
 #include <cstddef>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -14,19 +16,30 @@
 #include "RbFileManager.h"
 #include "AbstractHomologousDiscreteCharacterData.h"
 #include "Cloneable.h"
+#include "DiscreteCharacterState.h"
 #include "DiscreteTaxonData.h"
+#include "MemberObject.h"
 #include "Model.h"
 #include "NaturalNumbersState.h"
 #include "Parallelizable.h"
+#include "RandomNumberFactory.h"
+#include "RandomNumberGenerator.h"
+#include "RbConstants.h"
 #include "RbException.h"
 #include "RbVector.h"
 #include "RbVectorImpl.h"
+#include "StochasticNode.h"
 #include "StringUtilities.h"
 #include "Taxon.h"
+#include "ThreadPool.h"
 #include "Trace.h"
 #include "Tree.h"
 #include "TreeDiscreteCharacterData.h"
 
+#ifdef RB_MPI
+#include <mpi.h>
+#endif
+
 using namespace RevBayesCore;
 
 PosteriorPredictiveSimulation::PosteriorPredictiveSimulation( const Model &m, const std::string &dir, const RbVector<ModelTrace> &t) : Cloneable(), Parallelizable(),
@@ -66,145 +79,456 @@ PosteriorPredictiveSimulation* PosteriorPredictiveSimulation::clone() const
 }
 
 
+/**
+ * Append the test statistics of the character data of the node to the values.
+ * The ln likelihoods use the current values of the parameters of the model.
+ */
+void PosteriorPredictiveSimulation::computeStatistics(StochasticNode<AbstractHomologousDiscreteCharacterData> &n, const std::vector<std::string> &statistics, std::vector<double> &values) const
+{
+    
+    const AbstractHomologousDiscreteCharacterData &data = n.getValue();
+    
+    for (size_t i = 0; i < statistics.size(); ++i)
+    {
+        const std::string &stat = statistics[i];
+        
+        if ( stat == "lnL" )
+        {
+            values.push_back( n.getLnProbability() );
+        }
+        else if ( stat == "siteLnL" )
+        {
+            const MemberObject< RbVector<double> > *mo = dynamic_cast< const MemberObject< RbVector<double> >* >( &n.getDistribution() );
+            if ( mo == NULL )
+            {
+                throw RbException("The distribution of variable '" + n.getName() + "' does not provide site likelihoods.");
+            }
+            RbVector<double> site_ln_likelihoods;
+            mo->executeMethod( "siteLikelihoods", std::vector<const DagNode*>(), site_ln_likelihoods );
+            for (size_t j = 0; j < site_ln_likelihoods.size(); ++j)
+            {
+                values.push_back( site_ln_likelihoods[j] );
+            }
+        }
+        else if ( stat == "multinomial" )
+        {
+            values.push_back( data.computeMultinomialProfileLikelihood() );
+        }
+        else if ( stat == "entropy" )
+        {
+            // the mean entropy of the observed states over all included sites (gaps, missing and ambiguous states are ignored)
+            std::vector<size_t> site_indices = data.getIncludedSiteIndices();
+            size_t num_taxa = data.getNumberOfTaxa();
+            std::vector<double> counts = std::vector<double>( data.getNumberOfStates(), 0.0 );
+            double entropy = 0.0;
+            for (size_t j = 0; j < site_indices.size(); ++j)
+            {
+                std::fill( counts.begin(), counts.end(), 0.0 );
+                double total = 0.0;
+                for (size_t k = 0; k < num_taxa; ++k)
+                {
+                    const DiscreteCharacterState &c = data.getCharacter( k, site_indices[j] );
+                    if ( c.isGapState() == false && c.isMissingState() == false && c.isAmbiguous() == false )
+                    {
+                        ++counts[ c.getStateIndex() ];
+                        ++total;
+                    }
+                }
+                for (size_t k = 0; k < counts.size(); ++k)
+                {
+                    if ( counts[k] > 0.0 )
+                    {
+                        double p = counts[k] / total;
+                        entropy -= p * log( p );
+                    }
+                }
+            }
+            values.push_back( site_indices.size() > 0 ? entropy / site_indices.size() : 0.0 );
+        }
+        
+    }
+    
+}
+
+
 void RevBayesCore::PosteriorPredictiveSimulation::run( int thinning )
 {
     
+    run( thinning, std::vector<std::string>(), true );
+}
+
+
+void RevBayesCore::PosteriorPredictiveSimulation::run( int thinning, const std::vector<std::string> &statistics, bool write_data )
+{
+    
+    for (size_t i = 0; i < statistics.size(); ++i)
+    {
+        if ( statistics[i] != "lnL" && statistics[i] != "siteLnL" && statistics[i] != "multinomial" && statistics[i] != "entropy" )
+        {
+            throw RbException("Unknown posterior predictive statistic '" + statistics[i] + "'. Available statistics are 'lnL', 'siteLnL', 'multinomial' and 'entropy'.");
+        }
+    }
+    
+    if ( statistics.empty() == true && write_data == false )
+    {
+        throw RbException("Posterior predictive simulations without test statistics need to write the simulated data.");
+    }
+    
     // some general constant variables
     RbFileManager fm = RbFileManager( directory );
     const std::string path_separator = fm.getPathSeparator();
     
-    // this is where we need to implement the posterior predictive simulation
-    
     size_t n_samples = traces[0].size();
-    size_t n_traces = traces.size();
-        
-    // build a map for the ancestral state trace labels -> tip indices
-    std::map<std::string, size_t> ancestral_state_traces_lookup;
-    if (condition_on_tips == true)
+    size_t n_simulations = (n_samples + thinning - 1) / thinning;
+    
+    // draw a seed for every simulation of all processes, so that the simulations do not depend on the number of processes or threads
+    std::vector<unsigned int> seeds = std::vector<unsigned int>( n_simulations, 0 );
+    RandomNumberGenerator *rng = GLOBAL_RNG;
+    for (size_t i = 0; i < n_simulations; ++i)
     {
-        for (size_t z = 0; z < ancestral_state_traces.size(); z++)
-        {
-            ancestral_state_traces_lookup[ ancestral_state_traces[z].getParameterName() ] = z;
-        }
+        seeds[i] = (unsigned int)( rng->uniform01() * RbConstants::Integer::max );
     }
-
     
-    std::vector<DagNode*> nodes = model.getDagNodes();
-
+    // the samples of this process
     size_t sim_pid_start = size_t(floor( (double(pid) / num_processes * n_samples ) ) );
     size_t sim_pid_end   = std::max( int(sim_pid_start), int(floor( (double(pid+1) / num_processes * n_samples ) ) - 1) );
     
     size_t index_sample = sim_pid_start;
     while ( index_sample % thinning > 0 ) ++index_sample;
-    size_t current_pp_sim = size_t( floor( index_sample / thinning ) );
     
+    std::vector<size_t> sample_indices;
+    for ( ; index_sample <= sim_pid_end && index_sample < n_samples; index_sample += thinning)
+    {
+        sample_indices.push_back( index_sample );
+    }
+    size_t n_local = sample_indices.size();
     
-    for ( ; index_sample <= sim_pid_end; ++current_pp_sim, index_sample += thinning)
+    // the observed character data, for which we compute the statistics, and the names of the columns of the statistics table
+    std::vector<const AbstractHomologousDiscreteCharacterData*> observed_data;
+    std::vector<std::string> column_names;
+    std::vector<DagNode*> nodes = model.getDagNodes();
+    for ( std::vector<DagNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it )
     {
+        StochasticNode<AbstractHomologousDiscreteCharacterData> *n = dynamic_cast<StochasticNode<AbstractHomologousDiscreteCharacterData>* >( *it );
+        if ( n == NULL || n->isClamped() == false )
+        {
+            observed_data.push_back( NULL );
+            continue;
+        }
+        observed_data.push_back( &n->getValue() );
         
-        
-        // create a new directory name for this simulation
-        std::stringstream s;
-        s << directory << path_separator << "posterior_predictive_sim_" << (current_pp_sim + 1);
-        std::string sim_directory_name = s.str();
-        
-        // now for the numerical parameters
-        for ( size_t j=0; j<n_traces; ++j )
+        for (size_t k = 0; k < 2; ++k)
         {
-            std::string parameter_name = traces[j].getParameterName();
-            
-            // iterate over all DAG nodes (variables)
-            for ( std::vector<DagNode*>::iterator it = nodes.begin(); it!=nodes.end(); ++it )
+            std::string suffix = ( k == 0 ? "_observed" : "_simulated" );
+            for (size_t i = 0; i < statistics.size(); ++i)
             {
-                DagNode *the_node = *it;
+                if ( statistics[i] == "siteLnL" )
+                {
+                    size_t num_sites = n->getValue().getNumberOfIncludedCharacters();
+                    for (size_t j = 0; j < num_sites; ++j)
+                    {
+                        column_names.push_back( n->getName() + "_siteLnL[" + StringUtilities::toString(j+1) + "]" + suffix );
+                    }
+                }
+                else
+                {
+                    column_names.push_back( n->getName() + "_" + statistics[i] + suffix );
+                }
+            }
+        }
+    }
+    
+    // we run the simulations in chunks, one chunk per thread, and every chunk works on its own copy of the model
+    // the copies are created here because copying the DAG is not thread-safe
+    size_t n_threads = std::max( size_t(1), std::min( getNumberOfThreads(), n_local ) );
+    size_t chunk_size = ( n_local + n_threads - 1 ) / n_threads;
+    size_t n_chunks = ( chunk_size > 0 ? ( n_local + chunk_size - 1 ) / chunk_size : 0 );
+    std::vector<Model*> models = std::vector<Model*>( n_chunks, NULL );
+    for (size_t c = 0; c < n_chunks; ++c)
+    {
+        models[c] = new Model( model );
+    }
+    
+    std::vector<std::vector<double> > values = std::vector<std::vector<double> >( n_local );
+    parallelFor(0, n_chunks, [&](size_t first_chunk, size_t last_chunk)
+    {
+        for (size_t c = first_chunk; c < last_chunk; ++c)
+        {
+            size_t end = std::min( n_local, (c+1) * chunk_size );
+            for (size_t i = c * chunk_size; i < end; ++i)
+            {
+                size_t current_pp_sim = sample_indices[i] / thinning;
+                
+                // create a new directory name for this simulation
+                std::stringstream s;
+                s << directory << path_separator << "posterior_predictive_sim_" << (current_pp_sim + 1);
                 
-                if ( the_node->getName() == parameter_name )
+                // this simulation draws from its own random number stream
+                // we restore the previous generator, because the thread may run this task while waiting for another one
+                RandomNumberFactory &rnf = RandomNumberFactory::randomNumberFactoryInstance();
+                RandomNumberGenerator *previous_rng = rnf.getThreadRandomNumberGenerator();
+                RandomNumberGenerator sim_rng;
+                sim_rng.setSeed( seeds[current_pp_sim] );
+                rnf.setThreadRandomNumberGenerator( &sim_rng );
+                try
                 {
-                    // set the value for the variable with the i-th sample
-                    the_node->setValueFromString( traces[j].objectAt( index_sample ) );
+                    simulate( *models[c], sample_indices[i], s.str(), observed_data, statistics, write_data, values[i] );
                 }
-            
+                catch (...)
+                {
+                    rnf.setThreadRandomNumberGenerator( previous_rng );
+                    throw;
+                }
+                rnf.setThreadRandomNumberGenerator( previous_rng );
             }
+        }
+    }, 1, ThreadPool::globalThreadPool());
+    
+    for (size_t c = 0; c < n_chunks; ++c)
+    {
+        delete models[c];
+    }
+    
+    if ( statistics.empty() == true )
+    {
+        return;
+    }
+    
+    // failed simulations are reported as NaN
+    size_t n_columns = column_names.size();
+    std::vector<double> table;
+    for (size_t i = 0; i < n_local; ++i)
+    {
+        table.push_back( double(sample_indices[i] / thinning + 1) );
+        if ( values[i].size() == n_columns )
+        {
+            table.insert( table.end(), values[i].begin(), values[i].end() );
+        }
+        else
+        {
+            table.insert( table.end(), n_columns, RbConstants::Double::nan );
+        }
+    }
+    
+#ifdef RB_MPI
+    
+    if ( pid == active_PID )
+    {
+        // receive the rows of the other processes
+        for (int i = 0; i < num_processes; ++i)
+        {
+            if ( i == int(active_PID) )
+            {
+                continue;
+            }
+            MPI_Status status;
+            int n_values = 0;
+            MPI_Recv(&n_values, 1, MPI_INT, i, 0, MPI_COMM_WORLD, &status);
+            std::vector<double> received = std::vector<double>( n_values, 0.0 );
+            if ( n_values > 0 )
+            {
+                MPI_Recv(&received[0], n_values, MPI_DOUBLE, i, 0, MPI_COMM_WORLD, &status);
+            }
+            table.insert( table.end(), received.begin(), received.end() );
+        }
+    }
+    else
+    {
+        // send our rows
+        int n_values = int( table.size() );
+        MPI_Send(&n_values, 1, MPI_INT, (int)active_PID, 0, MPI_COMM_WORLD);
+        if ( n_values > 0 )
+        {
+            MPI_Send(&table[0], n_values, MPI_DOUBLE, (int)active_PID, 0, MPI_COMM_WORLD);
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    
+#endif
+    
+    if ( process_active == true )
+    {
+        // sort the rows by the simulation index
+        size_t row_size = n_columns + 1;
+        size_t n_rows = table.size() / row_size;
+        std::vector<std::pair<double, size_t> > order;
+        for (size_t i = 0; i < n_rows; ++i)
+        {
+            order.push_back( std::make_pair( table[i*row_size], i ) );
+        }
+        std::sort( order.begin(), order.end() );
+        
+        RbFileManager f = RbFileManager( directory, "posterior_predictive_statistics.txt" );
+        f.createDirectoryForFile();
+        
+        std::fstream out_stream;
+        out_stream.open( f.getFullFileName().c_str(), std::fstream::out );
+        out_stream << "Iteration";
+        for (size_t j = 0; j < n_columns; ++j)
+        {
+            out_stream << "\t" << column_names[j];
+        }
+        out_stream << std::endl;
         
+        for (size_t i = 0; i < n_rows; ++i)
+        {
+            const double *row = &table[ order[i].second * row_size ];
+            out_stream << size_t( row[0] );
+            for (size_t j = 1; j < row_size; ++j)
+            {
+                out_stream << "\t" << row[j];
+            }
+            out_stream << std::endl;
+        }
+        out_stream.close();
+    }
+    
+}
+
+
+/**
+ * Perform the posterior predictive simulation for a single sample of the trace in the model m.
+ * We set the parameters to the values of the sample and redraw all clamped variables.
+ * If statistics were requested, we append the statistics of the observed and the simulated data of every
+ * clamped character data variable to the values.
+ */
+void RevBayesCore::PosteriorPredictiveSimulation::simulate( Model &m, size_t index_sample, const std::string &sim_directory_name, const std::vector<const AbstractHomologousDiscreteCharacterData*> &observed_data, const std::vector<std::string> &statistics, bool write_data, std::vector<double> &values )
+{
+    
+    size_t n_traces = traces.size();
+    
+    // build a map for the ancestral state trace labels -> tip indices
+    std::map<std::string, size_t> ancestral_state_traces_lookup;
+    if (condition_on_tips == true)
+    {
+        for (size_t z = 0; z < ancestral_state_traces.size(); z++)
+        {
+            ancestral_state_traces_lookup[ ancestral_state_traces[z].getParameterName() ] = z;
         }
+    }
+
+    
+    std::vector<DagNode*> nodes = m.getDagNodes();
+    
+    // now for the numerical parameters
+    for ( size_t j=0; j<n_traces; ++j )
+    {
+        std::string parameter_name = traces[j].getParameterName();
         
-        // next we need to simulate the data and store it
         // iterate over all DAG nodes (variables)
         for ( std::vector<DagNode*>::iterator it = nodes.begin(); it!=nodes.end(); ++it )
         {
             DagNode *the_node = *it;
             
-            if ( the_node->isClamped() == true )
+            if ( the_node->getName() == parameter_name )
+            {
+                // set the value for the variable with the i-th sample
+                the_node->setValueFromString( traces[j].objectAt( index_sample ) );
+            }
+        
+        }
+    
+    }
+    
+    // next we need to simulate the data and store it
+    // iterate over all DAG nodes (variables)
+    for ( std::vector<DagNode*>::iterator it = nodes.begin(); it!=nodes.end(); ++it )
+    {
+        DagNode *the_node = *it;
+        
+        if ( the_node->isClamped() == true )
+        {
+            // check if the PP simulation must condition on sampled tip states
+            if (condition_on_tips == true && typeid(the_node->getDistribution()) == typeid(StateDependentSpeciationExtinctionProcess))
             {
-                // check if the PP simulation must condition on sampled tip states
-                if (condition_on_tips == true && typeid(the_node->getDistribution()) == typeid(StateDependentSpeciationExtinctionProcess))
+                // set the tip states to the values sampled during this iteration
+                AncestralStateTrace* tip_state_trace;
+                StateDependentSpeciationExtinctionProcess* sse = static_cast<StateDependentSpeciationExtinctionProcess*>( &the_node->getDistribution() );
+                std::vector<std::string> tips = sse->getValue().getTipNames();
+                size_t num_states = static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->getCharacterData().getNumberOfStates();
+                HomologousDiscreteCharacterData<NaturalNumbersState> *tip_data = new HomologousDiscreteCharacterData<NaturalNumbersState>();
+
+                // read the ancestral state trace
+                for (size_t i = 0; i < tips.size(); ++i)
                 {
-                    // set the tip states to the values sampled during this iteration
-                    AncestralStateTrace* tip_state_trace;
-                    StateDependentSpeciationExtinctionProcess* sse = static_cast<StateDependentSpeciationExtinctionProcess*>( &the_node->getDistribution() );
-                    std::vector<std::string> tips = sse->getValue().getTipNames();
-                    size_t num_states = static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->getCharacterData().getNumberOfStates();
-                    HomologousDiscreteCharacterData<NaturalNumbersState> *tip_data = new HomologousDiscreteCharacterData<NaturalNumbersState>();
-
-                    // read the ancestral state trace
-                    for (size_t i = 0; i < tips.size(); ++i)
-                    {
-                        size_t tip_index = sse->getValue().getTipIndex(tips[i]);
-                        std::string tip_index_anc_str = StringUtilities::toString(tip_index + 1);
-                        std::string tip_index_end_str = "end_" + StringUtilities::toString(tip_index + 1);
-  
-                        if (ancestral_state_traces_lookup.find(tip_index_anc_str) != ancestral_state_traces_lookup.end())
-                        {
-                            size_t idx = ancestral_state_traces_lookup[tip_index_anc_str];
-                            tip_state_trace = &ancestral_state_traces[idx];
-                        }
-                        else if (ancestral_state_traces_lookup.find(tip_index_end_str) != ancestral_state_traces_lookup.end())
-                        {
-                            size_t idx = ancestral_state_traces_lookup[tip_index_end_str];
-                            tip_state_trace = &ancestral_state_traces[idx];
-                        }
-                        else
-                            throw RbException("Can't find tip_state_trace!");
-                        const std::vector<std::string>& tip_state_vector = tip_state_trace->getValues();
-                        std::string state_str = tip_state_vector[index_sample];
+                    size_t tip_index = sse->getValue().getTipIndex(tips[i]);
+                    std::string tip_index_anc_str = StringUtilities::toString(tip_index + 1);
+                    std::string tip_index_end_str = "end_" + StringUtilities::toString(tip_index + 1);
   
-                        // create a taxon data object for each tip
-                        DiscreteTaxonData<NaturalNumbersState> this_tip_data = DiscreteTaxonData<NaturalNumbersState>(tips[tip_index]);
-                        NaturalNumbersState state = NaturalNumbersState(0, num_states);
-                        state.setState(state_str);
-                        this_tip_data.addCharacter(state);
-                        tip_data->addTaxonData(this_tip_data);
+                    if (ancestral_state_traces_lookup.find(tip_index_anc_str) != ancestral_state_traces_lookup.end())
+                    {
+                        size_t idx = ancestral_state_traces_lookup[tip_index_anc_str];
+                        tip_state_trace = &ancestral_state_traces[idx];
                     }
-                   
-                    // finally set the tip data to the sampled values
-                    static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->setCharacterData(tip_data);
+                    else if (ancestral_state_traces_lookup.find(tip_index_end_str) != ancestral_state_traces_lookup.end())
+                    {
+                        size_t idx = ancestral_state_traces_lookup[tip_index_end_str];
+                        tip_state_trace = &ancestral_state_traces[idx];
+                    }
+                    else
+                        throw RbException("Can't find tip_state_trace!");
+                    const std::vector<std::string>& tip_state_vector = tip_state_trace->getValues();
+                    std::string state_str = tip_state_vector[index_sample];
+  
+                    // create a taxon data object for each tip
+                    DiscreteTaxonData<NaturalNumbersState> this_tip_data = DiscreteTaxonData<NaturalNumbersState>(tips[tip_index]);
+                    NaturalNumbersState state = NaturalNumbersState(0, num_states);
+                    state.setState(state_str);
+                    this_tip_data.addCharacter(state);
+                    tip_data->addTaxonData(this_tip_data);
                 }
                
-                try 
+                // finally set the tip data to the sampled values
+                static_cast<TreeDiscreteCharacterData*>( &sse->getValue() )->setCharacterData(tip_data);
+            }
+           
+            StochasticNode<AbstractHomologousDiscreteCharacterData> *data_node = NULL;
+            if ( statistics.empty() == false && observed_data[it - nodes.begin()] != NULL )
+            {
+                data_node = static_cast<StochasticNode<AbstractHomologousDiscreteCharacterData>* >( the_node );
+            }
+            
+            try 
+            {
+                // compute the statistics of the observed data, which a previous simulation may have replaced
+                std::vector<double> observed_values;
+                if ( data_node != NULL )
                 {
-                    // redraw new values
-                    the_node->redraw();
-                
-                    // we need to store the new simulated data
-                    the_node->writeToFile(sim_directory_name);
+                    data_node->setValue( observed_data[it - nodes.begin()]->clone() );
+                    computeStatistics( *data_node, statistics, observed_values );
                 }
-                catch (RbException &e)
+                
+                // redraw new values
+                the_node->redraw();
+            
+                // we need to store the new simulated data
+                if ( write_data == true )
                 {
-                    
-                    std::cerr << "Problem in Posterior Predictive Simulation:" << std::endl;
-                    std::cerr << e.getMessage() << std::endl;
-                    // skip this simulation
+                    the_node->writeToFile(sim_directory_name);
                 }
-                catch (...)
+                
+                // compute the statistics directly on the simulated data
+                if ( data_node != NULL )
                 {
-                    
-                    std::cerr << "Problem occurred." << std::endl;
-                    // skip this simulation
+                    values.insert( values.end(), observed_values.begin(), observed_values.end() );
+                    computeStatistics( *data_node, statistics, values );
                 }
             }
-            
+            catch (RbException &e)
+            {
+                
+                std::cerr << "Problem in Posterior Predictive Simulation:" << std::endl;
+                std::cerr << e.getMessage() << std::endl;
+                // skip this simulation
+            }
+            catch (...)
+            {
+                
+                std::cerr << "Problem occurred." << std::endl;
+                // skip this simulation
+            }
         }
         
-    } // end for over all samples
+    }
     
 }
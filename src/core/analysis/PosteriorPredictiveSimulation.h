@@ -7,8 +7,14 @@
 #include "RbVector.h"
 #include "Trace.h"
 
+#include <string>
+#include <vector>
+
 namespace RevBayesCore {
     
+    class AbstractHomologousDiscreteCharacterData;
+    template <class valueType> class StochasticNode;
+    
     /**
      * @brief Posterior predictive simulation from a posterior sample trace.
      *
@@ -21,6 +27,18 @@ namespace RevBayesCore {
      * values are written into a file per variable. We also create a directory per iteration, that is,
      * the j-th posterior predictive simulation will be written into the directory sim_j.
      *
+     * Alternatively, we compute a set of test statistics directly on the simulated character data,
+     * without writing the data to disk (writing is still optional). The statistics are
+     *   - "lnL":          the ln likelihood of the data given the sampled parameters,
+     *   - "siteLnL":      the ln likelihood of every site given the sampled parameters,
+     *   - "multinomial":  the multinomial likelihood of the site patterns,
+     *   - "entropy":      the mean entropy of the state frequencies of the sites.
+     * Each statistic is computed for the simulated and the observed data and all values are written
+     * into a single table (posterior_predictive_statistics.txt), one row per simulation.
+     * The simulations run in parallel on threads, each working on its own copy of the model.
+     * Every simulation draws from its own random number stream seeded from the global one,
+     * so the results do not depend on the number of threads or processes.
+     *
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna and Lyndon Coghill)
@@ -39,10 +57,14 @@ namespace RevBayesCore {
         
         // public methods
         PosteriorPredictiveSimulation*                      clone(void) const;
-        void                                                run(int thinning);
+        void                                                run(int thinning);                                                               //!< Simulate and write the data into one directory per simulation
+        void                                                run(int thinning, const std::vector<std::string> &statistics, bool write_data);   //!< Simulate and compute the test statistics, optionally writing the data
         
     private:
         
+        void                                                computeStatistics(StochasticNode<AbstractHomologousDiscreteCharacterData> &n, const std::vector<std::string> &statistics, std::vector<double> &values) const;  //!< Append the test statistics of the current value of the node
+        void                                                simulate(Model &m, size_t index_sample, const std::string &sim_directory_name, const std::vector<const AbstractHomologousDiscreteCharacterData*> &observed_data, const std::vector<std::string> &statistics, bool write_data, std::vector<double> &values);  //!< Perform a single posterior predictive simulation
+        
         Model                                               model;
         std::string                                         directory;
         RbVector<ModelTrace>                                traces;
@@ -108,7 +108,8 @@ void PowerPosteriorAnalysis::burnin(size_t generations, size_t tuningInterval)
     }
     
     
-    // Run the chain
+    // Run the chain, the moves may adapt to these cycles
+    sampler->setAdaptation( true );
     for (size_t k=1; k<=generations; k++)
     {
         if ( process_active == true )
@@ -127,6 +128,7 @@ void PowerPosteriorAnalysis::burnin(size_t generations, size_t tuningInterval)
         }
         
     }
+    sampler->setAdaptation( false );
     
     
     if ( process_active == true )
@@ -376,6 +378,17 @@ void PowerPosteriorAnalysis::summarizeStones( void )
 }
 
 
+/**
+ * Set the number of threads used for the likelihood of each stone.
+ * Together with procPerLikelihood=1 this allows one MPI process per machine, which runs its stones one after the other
+ * and computes each likelihood with all cores of the machine.
+ */
+void PowerPosteriorAnalysis::setNumberOfThreadsSpecialized(size_t n)
+{
+    sampler->setNumberOfThreads( num_threads );
+}
+
+
 void PowerPosteriorAnalysis::setPowers(const std::vector<double> &p)
 {
     powers = p;
@@ -40,6 +40,10 @@ namespace RevBayesCore {
         void                                    setPowers(const std::vector<double> &p);
         void                                    setSampleFreq(size_t sf);
         
+    protected:
+        
+        void                                    setNumberOfThreadsSpecialized(size_t n);                                        //!< Set the number of threads for this class.
+        
     private:
         
         void                                    initMPI(void);
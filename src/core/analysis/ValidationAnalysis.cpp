@@ -1,7 +1,11 @@
 #include <stddef.h>
 #include <cmath>
 #include <algorithm>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -13,11 +17,14 @@
 #include "ProgressBar.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
+#include "RankStatisticMonitor.h"
+#include "RbConstants.h"
 #include "RlUserInterface.h"
-#include "StochasticVariableMonitor.h"
+#include "ThreadPool.h"
 #include "Trace.h"
 #include "TraceReader.h"
 #include "ValidationAnalysis.h"
+#include "VariableMonitor.h"
 #include "Cloneable.h"
 #include "Model.h"
 #include "Parallelizable.h"
@@ -31,7 +38,8 @@
 using namespace RevBayesCore;
 
 ValidationAnalysis::ValidationAnalysis( const MonteCarloAnalysis &m, size_t n ) : Cloneable( ), Parallelizable( ),
-    num_runs( n )
+    num_runs( n ),
+    use_file_monitor( false )
 {
     
     std::string directory = "output";
@@ -43,18 +51,18 @@ ValidationAnalysis::ValidationAnalysis( const MonteCarloAnalysis &m, size_t n )
     MonteCarloAnalysis *sampler = m.clone();
     sampler->removeMonitors();
     
-    StochasticVariableMonitor mntr = StochasticVariableMonitor(10, "output/posterior_samples.var", "\t");
-    sampler->addMonitor( mntr );
-    
     size_t run_block_start = size_t(floor( (double(pid)   / num_processes ) * num_runs) );
     size_t run_block_end   = std::max( int(run_block_start), int(floor( (double(pid+1) / num_processes ) * num_runs) ) - 1);
     int number_processes_per_run = ceil( double(num_processes) / num_runs );
     
-    // we need to change the random number generator when using MPI so that they are not synchronized anymore
-    for ( size_t i=0; i<pid; ++i )
+    // every run gets its own random number generator, seeded independently of the process that runs it
+    std::vector<unsigned int> seeds = std::vector<unsigned int>(num_runs, 0);
+    for ( size_t i=0; i<num_runs; ++i )
     {
-        GLOBAL_RNG->setSeed( int(floor( GLOBAL_RNG->uniform01()*1E5 )) );
+        seeds[i] = (unsigned int)( GLOBAL_RNG->uniform01() * RbConstants::Integer::max );
     }
+    RandomNumberFactory &rnf = RandomNumberFactory::randomNumberFactoryInstance();
+    RandomNumberGenerator *previous_rng = rnf.getThreadRandomNumberGenerator();
     
 #ifdef RB_MPI
 //    size_t active_proc = floor( pid / double(processors_per_likelihood) ) * processors_per_likelihood;
@@ -65,12 +73,18 @@ ValidationAnalysis::ValidationAnalysis( const MonteCarloAnalysis &m, size_t n )
     
     runs = std::vector<MonteCarloAnalysis*>(num_runs,NULL);
     simulation_values = std::vector<Model*>(num_runs,NULL);
+    rngs = std::vector<RandomNumberGenerator*>(num_runs,NULL);
     for ( size_t i = 0; i < num_runs; ++i)
     {
         
         if ( i >= run_block_start && i <= run_block_end)
         {
             
+            // the simulation already draws from the generator of this run
+            rngs[i] = new RandomNumberGenerator();
+            rngs[i]->setSeed( seeds[i] );
+            rnf.setThreadRandomNumberGenerator( rngs[i] );
+            
             // create a new directory name for this simulation
             std::stringstream s;
             s << directory << path_separator << "Validation_Sim_" << i;
@@ -99,6 +113,36 @@ ValidationAnalysis::ValidationAnalysis( const MonteCarloAnalysis &m, size_t n )
                 }
             
             }
+            
+            // we compare the samples of numeric variables directly with the simulated values
+            // and write only the other variables to a file
+            std::vector<DagNode*> numeric_nodes;
+            std::vector<DagNode*> other_nodes;
+            const std::vector<DagNode*> &current_nodes = current_model->getDagNodes();
+            for (size_t j = 0; j < current_nodes.size(); ++j)
+            {
+                DagNode *the_node = current_nodes[j];
+                if ( the_node->isClamped() == false && the_node->isStochastic() == true && the_node->isHidden() == false )
+                {
+                    std::vector<double> v;
+                    if ( RankStatisticMonitor::getNumericValues( the_node, v ) == true )
+                    {
+                        numeric_nodes.push_back( the_node );
+                    }
+                    else
+                    {
+                        other_nodes.push_back( the_node );
+                    }
+                }
+            }
+            current_analysis->addMonitor( RankStatisticMonitor(10, numeric_nodes) );
+            if ( other_nodes.empty() == false )
+            {
+                current_analysis->addMonitor( VariableMonitor(other_nodes, 10, "output/posterior_samples.var", "\t", false, false, false) );
+                use_file_monitor = true;
+            }
+            
+            rnf.setThreadRandomNumberGenerator( previous_rng );
         
             // now set the model of the current analysis
 #ifdef RB_MPI
@@ -130,11 +174,16 @@ ValidationAnalysis::ValidationAnalysis( const MonteCarloAnalysis &m, size_t n )
 
 
 ValidationAnalysis::ValidationAnalysis(const ValidationAnalysis &a) : Cloneable( a ), Parallelizable( a ),
-    num_runs( a.num_runs )
+    num_runs( a.num_runs ),
+    use_file_monitor( a.use_file_monitor ),
+    coverage_count( a.coverage_count ),
+    rank_names( a.rank_names ),
+    ranks( a.ranks )
 {
     
     runs = std::vector<MonteCarloAnalysis*>(num_runs,NULL);
     simulation_values = std::vector<Model*>(num_runs,NULL);
+    rngs = std::vector<RandomNumberGenerator*>(num_runs,NULL);
     // create replicate Monte Carlo samplers
     for (size_t i=0; i < num_runs; ++i)
     {
@@ -142,7 +191,8 @@ ValidationAnalysis::ValidationAnalysis(const ValidationAnalysis &a) : Cloneable(
         if ( a.runs[i] != NULL )
         {
             runs[i]                 = a.runs[i]->clone();
-            simulation_values[i]    = runs[i]->getModel().clone() ;
+            simulation_values[i]    = a.simulation_values[i]->clone();
+            rngs[i]                 = new RandomNumberGenerator( *a.rngs[i] );
         }
         
     }
@@ -160,6 +210,8 @@ ValidationAnalysis::~ValidationAnalysis(void)
         
         Model *m = simulation_values[i];
         delete m;
+        
+        delete rngs[i];
     }
     
 }
@@ -184,16 +236,24 @@ ValidationAnalysis& ValidationAnalysis::operator=(const ValidationAnalysis &a)
             
             Model *m = simulation_values[i];
             delete m;
+            
+            delete rngs[i];
         }
         runs.clear();
         simulation_values.clear();
+        rngs.clear();
         
         num_runs                    = a.num_runs;
+        use_file_monitor            = a.use_file_monitor;
+        coverage_count              = a.coverage_count;
+        rank_names                  = a.rank_names;
+        ranks                       = a.ranks;
 //        credible_interval_size      = a.credible_interval_size;
         
         
         runs = std::vector<MonteCarloAnalysis*>(num_runs,NULL);
         simulation_values = std::vector<Model*>(num_runs,NULL);
+        rngs = std::vector<RandomNumberGenerator*>(num_runs,NULL);
         
         // create replicate Monte Carlo samplers
         for (size_t i=0; i < num_runs; ++i)
@@ -202,7 +262,8 @@ ValidationAnalysis& ValidationAnalysis::operator=(const ValidationAnalysis &a)
             if ( a.runs[i] != NULL )
             {
                 runs[i]                 = a.runs[i]->clone();
-                simulation_values[i]    = runs[i]->getModel().clone() ;
+                simulation_values[i]    = a.simulation_values[i]->clone();
+                rngs[i]                 = new RandomNumberGenerator( *a.rngs[i] );
             }
             
         }
@@ -236,12 +297,10 @@ void ValidationAnalysis::burnin(size_t generations, size_t tuningInterval)
         progress.start();
     }
     
-    // compute which block of the data this process needs to compute
-    size_t run_block_start = size_t(floor( (double(pid)   / num_processes ) * num_runs) );
-    size_t run_block_end   = std::max( int(run_block_start), int(floor( (double(pid+1) / num_processes ) * num_runs) ) - 1);
-    
-    // Run the chain
-    for (size_t i = run_block_start; i <= run_block_end; ++i)
+    // Run the chains
+    std::mutex progress_mutex;
+    size_t num_finished = 0;
+    runBlock( [&](size_t i)
     {
         if ( runs[i] == NULL ) std::cerr << "Runing bad burnin (pid=" << pid <<", run="<< i << ") of runs.size()=" << runs.size() << "." << std::endl;
         // run the i-th analyses
@@ -252,12 +311,12 @@ void ValidationAnalysis::burnin(size_t generations, size_t tuningInterval)
 #endif
         if ( process_active == true )
         {
-            progress.update( i );
+            std::lock_guard<std::mutex> lock( progress_mutex );
+            progress.update( num_finished++ );
             
         }
         
-        
-    }
+    } );
     
     if ( process_active == true )
     {
@@ -288,18 +347,65 @@ void ValidationAnalysis::runAll(size_t gen)
         std::cout << "Running validation analysis ..." << std::endl;
     }
     
+    // Run the chains
+    runBlock( [&](size_t i)
+    {
+        
+        // run the i-th analysis
+        runSim(i, gen);
+        
+    } );
+    
+}
+
+
+/** Apply a function to all runs of this process
+ *
+ * Without MPI, the runs are executed in parallel on the threads of the thread pool.
+ * With MPI, the analyses communicate through MPI and are executed one after the other.
+ * Each run draws from its own random number generator.
+ *
+ * @param f function applied to the index of a run
+ **/
+void ValidationAnalysis::runBlock(const std::function<void(size_t)> &f)
+{
+    
     // compute which block of the runs this process needs to compute
     size_t run_block_start = size_t(floor( (double(pid)   / num_processes ) * num_runs) );
     size_t run_block_end   = std::max( int(run_block_start), int(floor( (double(pid+1) / num_processes ) * num_runs) ) - 1);
     
-    // Run the chain
+    std::function<void(size_t)> run_with_rng = [&](size_t i)
+    {
+        // we restore the previous generator, because the thread may run this task while waiting for another one
+        RandomNumberFactory &rnf = RandomNumberFactory::randomNumberFactoryInstance();
+        RandomNumberGenerator *previous_rng = rnf.getThreadRandomNumberGenerator();
+        rnf.setThreadRandomNumberGenerator( rngs[i] );
+        try
+        {
+            f(i);
+        }
+        catch (...)
+        {
+            rnf.setThreadRandomNumberGenerator( previous_rng );
+            throw;
+        }
+        rnf.setThreadRandomNumberGenerator( previous_rng );
+    };
+    
+#ifdef RB_MPI
     for (size_t i = run_block_start; i <= run_block_end; ++i)
     {
-        
-        // run the i-th stone
-        runSim(i, gen);
-        
-    }    
+        run_with_rng(i);
+    }
+#else
+    parallelFor(run_block_start, run_block_end+1, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            run_with_rng(i);
+        }
+    }, 1, ThreadPool::globalThreadPool());
+#endif
     
 }
 
@@ -349,7 +455,7 @@ void ValidationAnalysis::runSim(size_t idx, size_t gen)
  *
  * @param credible_interval_size size of the interval used to calculate coverage (e.g. 0.9 = 90% HPD)
  **/
-void ValidationAnalysis::summarizeAll( double credible_interval_size )
+void ValidationAnalysis::summarizeAll( double credible_interval_size, const std::string &rank_file )
 {
     
     // print some information to the screen but only if we are the active process
@@ -361,6 +467,8 @@ void ValidationAnalysis::summarizeAll( double credible_interval_size )
     
     // reset the counter
     coverage_count = std::map<std::string, int>();
+    rank_names.clear();
+    ranks = std::vector<std::vector<double> >(num_runs);
     
     // compute which block of the runs this process needs to compute
     size_t run_block_start = size_t(floor( (double(pid)   / num_processes ) * num_runs) );
@@ -422,6 +530,31 @@ void ValidationAnalysis::summarizeAll( double credible_interval_size )
         std::cout << std::endl;
     }
     
+    if ( rank_file != "" )
+    {
+        writeRankStatistics( rank_file );
+    }
+    
+}
+
+
+/** Set the number of threads of each analysis
+ *
+ * @param n number of threads
+ **/
+void ValidationAnalysis::setNumberOfThreadsSpecialized(size_t n)
+{
+    
+    for (size_t i = 0; i < num_runs; ++i)
+    {
+        
+        if ( runs[i] != NULL )
+        {
+            runs[i]->setNumberOfThreads( num_threads );
+        }
+        
+    }
+    
 }
 
 
@@ -433,6 +566,89 @@ void ValidationAnalysis::summarizeAll( double credible_interval_size )
 void ValidationAnalysis::summarizeSim(double credible_interval_size, size_t idx)
 {
     
+    double lower = (1.0 - credible_interval_size) / 2.0;
+    double upper = 1.0 - lower;
+    
+    // the numeric variables were compared with the simulated values while sampling
+    std::vector<const Monitor*> monitors = runs[idx]->getMonitors();
+    std::vector<const RankStatisticMonitor*> rank_monitors;
+    for (size_t i = 0; i < monitors.size(); ++i)
+    {
+        const RankStatisticMonitor *m = dynamic_cast<const RankStatisticMonitor*>( monitors[i] );
+        if ( m != NULL )
+        {
+            rank_monitors.push_back( m );
+        }
+    }
+    
+    if ( rank_monitors.empty() == false )
+    {
+        // we combine the samples of all replicates of the analysis
+        const RankStatisticMonitor &first = *rank_monitors[0];
+        const std::vector<DagNode*> &rank_nodes = first.getDagNodes();
+        double num_samples = 0.0;
+        for (size_t k = 0; k < rank_monitors.size(); ++k)
+        {
+            num_samples += rank_monitors[k]->getNumberOfSamples();
+        }
+        
+        std::vector<std::string> names;
+        std::vector<double> run_ranks;
+        run_ranks.push_back( num_samples );
+        for (size_t j = 0; j < rank_nodes.size(); ++j)
+        {
+            const std::string &parameter_name = rank_nodes[j]->getName();
+            std::vector<double> smaller = first.getNumberOfSmallerValues(j);
+            std::vector<double> equal   = first.getNumberOfEqualValues(j);
+            for (size_t k = 1; k < rank_monitors.size(); ++k)
+            {
+                for (size_t l = 0; l < smaller.size(); ++l)
+                {
+                    smaller[l]  += rank_monitors[k]->getNumberOfSmallerValues(j)[l];
+                    equal[l]    += rank_monitors[k]->getNumberOfEqualValues(j)[l];
+                }
+            }
+            
+            double num_covered = 0.0;
+            for (size_t l = 0; l < smaller.size(); ++l)
+            {
+                // the quantile of the simulated value as computed from a trace of the samples
+                double quantile = (smaller[l] + 0.5*equal[l]) / num_samples;
+                if ( quantile >= lower && quantile <= upper )
+                {
+                    ++num_covered;
+                }
+                
+                // the rank of the simulated value, where ties are broken at random
+                run_ranks.push_back( smaller[l] + floor( rngs[idx]->uniform01() * (equal[l] + 1.0) ) );
+                names.push_back( smaller.size() > 1 ? parameter_name + "[" + StringUtilities::toString(l+1) + "]" : parameter_name );
+            }
+            
+            // vectors are covered with the probability of the fraction of covered elements
+            bool cov = ( smaller.size() == 1 ? num_covered == 1.0 : num_covered / smaller.size() > GLOBAL_RNG->uniform01() );
+            if ( coverage_count.find(parameter_name) == coverage_count.end() )
+            {
+                coverage_count.insert( std::pair<std::string,int>(parameter_name,0) );
+            }
+            if ( cov == true )
+            {
+                coverage_count[ parameter_name ]++;
+            }
+        }
+        
+        if ( rank_names.empty() == true )
+        {
+            rank_names = names;
+        }
+        ranks[idx] = run_ranks;
+    }
+    
+    // the other variables were written to a file
+    if ( use_file_monitor == false )
+    {
+        return;
+    }
+    
     std::stringstream ss;
     ss << "output/Validation_Sim_" << idx << "/" << "posterior_samples.var";
     std::string fn = ss.str();
@@ -517,3 +733,113 @@ void ValidationAnalysis::summarizeSim(double credible_interval_size, size_t idx)
     
 }
 
+
+
+/** Write the rank statistics of all simulations to a file
+ *
+ * Each row contains the index of the simulation, the number of samples and the rank of the simulated value
+ * of every numeric parameter among the samples. For a calibrated analysis, the ranks are uniformly distributed
+ * between 0 and the number of samples (simulation-based calibration).
+ *
+ * @param fn name of the file
+ **/
+void ValidationAnalysis::writeRankStatistics(const std::string &fn)
+{
+    
+#ifdef RB_MPI
+    
+    // compute which block of the runs this process needs to compute
+    size_t run_block_start = size_t(floor( (double(pid)   / num_processes ) * num_runs) );
+    size_t run_block_end   = std::max( int(run_block_start), int(floor( (double(pid+1) / num_processes ) * num_runs) ) - 1);
+    
+    if ( pid == active_PID )
+    {
+        // receive the ranks of the other processes
+        for (size_t i = 0; i < num_runs; ++i)
+        {
+            if ( i >= run_block_start && i <= run_block_end )
+            {
+                continue;
+            }
+            
+            int sender = 0;
+            for (int p = 0; p < num_processes; ++p)
+            {
+                size_t start = size_t(floor( (double(p) / num_processes ) * num_runs) );
+                size_t end   = std::max( int(start), int(floor( (double(p+1) / num_processes ) * num_runs) ) - 1);
+                if ( i >= start && i <= end )
+                {
+                    sender = p;
+                    break;
+                }
+            }
+            
+            MPI_Status status;
+            int n = 0;
+            MPI_Recv(&n, 1, MPI_INT, sender, 0, MPI_COMM_WORLD, &status);
+            ranks[i] = std::vector<double>(n, 0.0);
+            if ( n > 0 )
+            {
+                MPI_Recv(&ranks[i][0], n, MPI_DOUBLE, sender, 0, MPI_COMM_WORLD, &status);
+            }
+        }
+    }
+    else
+    {
+        // send the ranks of our simulations
+        for (size_t i = run_block_start; i <= run_block_end; ++i)
+        {
+            int n = int( ranks[i].size() );
+            MPI_Send(&n, 1, MPI_INT, (int)active_PID, 0, MPI_COMM_WORLD);
+            if ( n > 0 )
+            {
+                MPI_Send(&ranks[i][0], n, MPI_DOUBLE, (int)active_PID, 0, MPI_COMM_WORLD);
+            }
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    
+#endif
+    
+    if ( process_active == false )
+    {
+        return;
+    }
+    
+    RbFileManager fm = RbFileManager( fn );
+    fm.createDirectoryForFile();
+    
+    std::ofstream out_stream;
+    out_stream.open( fm.getFullFileName().c_str(), std::fstream::out );
+    
+    out_stream << "Simulation\tSamples";
+    for (size_t j = 0; j < rank_names.size(); ++j)
+    {
+        out_stream << "\t" << rank_names[j];
+    }
+    out_stream << std::endl;
+    
+    for (size_t i = 0; i < num_runs; ++i)
+    {
+        out_stream << (i+1);
+        if ( ranks[i].size() == rank_names.size() + 1 )
+        {
+            for (size_t j = 0; j < ranks[i].size(); ++j)
+            {
+                out_stream << "\t" << ranks[i][j];
+            }
+        }
+        else
+        {
+            // the parameters of this simulation could not be ranked
+            for (size_t j = 0; j <= rank_names.size(); ++j)
+            {
+                out_stream << "\tNA";
+            }
+        }
+        out_stream << std::endl;
+    }
+    
+    out_stream.close();
+    
+}
@@ -5,12 +5,16 @@
 #include "Parallelizable.h"
 #include "RbVector.h"
 
+#include <functional>
 #include <map>
+#include <string>
+#include <vector>
 
 namespace RevBayesCore {
     
     class MonteCarloAnalysis;
     class Model;
+    class RandomNumberGenerator;
     
     /**
      * @brief Analysis class used to run validation tests
@@ -20,6 +24,15 @@ namespace RevBayesCore {
      * whether the initial draw of the parameter is present in the credible
      * interval sampled in that run), along with the expected value of that coverage.
      *
+     * The runs of a process are executed in parallel on the threads of the thread pool.
+     * Every run draws from its own random number generator, seeded from the global one
+     * when the analysis is created, so that the results depend neither on the number of threads
+     * nor on the number of processes.
+     * The samples of numeric variables are not written to files but compared to the simulated values
+     * while the runs proceed (see RankStatisticMonitor). Besides the coverage, this gives the rank of the
+     * simulated value among the samples, which can be written out for simulation-based calibration (SBC).
+     * Other variables, e.g., trees, are still written to a file per run and summarized from there.
+     *
      */
     class ValidationAnalysis : public Cloneable, public Parallelizable {
         
@@ -35,17 +48,27 @@ namespace RevBayesCore {
         void                                    burnin(size_t g, size_t ti);  //!< Perform burnin steps for all analyses.
         void                                    runAll(size_t g);  //!< Run all analyses.
         void                                    runSim(size_t idx, size_t g);  //!< Run a specific analysis.
-        void                                    summarizeAll(double c);  //!< Print summary of all analyses.
-        void                                    summarizeSim(double c, size_t idx);  //!< Calculate coverage counts for a specific analysis.
+        void                                    summarizeAll(double c, const std::string &rank_file = "");  //!< Print summary of all analyses and optionally write the rank statistics.
+        void                                    summarizeSim(double c, size_t idx);  //!< Calculate coverage counts and rank statistics for a specific analysis.
+        
+    protected:
+        void                                    setNumberOfThreadsSpecialized(size_t n);  //!< Set the number of threads of each analysis.
         
     private:
-                
+        
+        void                                    runBlock(const std::function<void(size_t)> &f);  //!< Apply f to the runs of this process in parallel, each with its own random number generator
+        void                                    writeRankStatistics(const std::string &fn);  //!< Write the rank statistics of all analyses into a file.
+        
         // members
         size_t                                  num_runs;  //!< number of analyses to run
         std::vector<MonteCarloAnalysis*>        runs;  //!< vector of analyses
         std::vector<Model*>                     simulation_values;  //!< vector of initial values of the models
+        std::vector<RandomNumberGenerator*>     rngs;  //!< the random number generator of each analysis
+        bool                                    use_file_monitor;  //!< are some variables (e.g., trees) written to a file?
 
         std::map<std::string, int>              coverage_count; //!< coverage counts, indexed by parameter names
+        std::vector<std::string>                rank_names; //!< names of the elements with rank statistics
+        std::vector<std::vector<double> >       ranks; //!< rank statistics of each analysis, the first value is the number of samples
     };
     
 }
@@ -1,12 +1,18 @@
 #include <stdlib.h>
+#include <stdint.h>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "AdaptiveMoveSchedule.h"
 #include "DagNode.h"
 #include "Mcmc.h"
 #include "MoveSchedule.h"
@@ -22,14 +28,18 @@
 #include "Monitor.h"
 #include "MonteCarloAnalysisOptions.h"
 #include "MonteCarloSampler.h"
+#include "Profiler.h"
 #include "Move.h"
 #include "RbConstIterator.h"
 #include "RbConstIteratorImpl.h"
 #include "RbFileManager.h"
 #include "RbIterator.h"
 #include "RbIteratorImpl.h"
+#include "RandomNumberFactory.h"
+#include "RandomNumberGenerator.h"
 #include "RbVector.h"
 #include "RbVectorImpl.h"
+#include "StochasticNode.h"
 #include "StringUtilities.h"
 
 #ifdef RB_MPI
@@ -198,6 +208,17 @@ Mcmc* Mcmc::clone( void ) const
 }
 
 
+/**
+ * Write the checkpoint files: the values of the variables (as text and, for numeric variables, also in binary
+ * to restore them exactly), the move information including what the moves learned while adapting, and the MCMC information
+ * with the iteration and the sizes of the monitor files.
+ * Each file is first written completely to a temporary file which then replaces the previous checkpoint file,
+ * so that a crash while checkpointing never leaves a truncated checkpoint behind.
+ * Every file records the iteration and we keep the file of the previous checkpoint next to it (see RbFileManager::writeFile).
+ * Thus, if we crashed between two files, all files of the previous checkpoint still exist and the analysis
+ * resumes from it (see MonteCarloAnalysis::initializeFromCheckpoint).
+ * The state of the random number generator is shared by all replicates, so it is written by the analysis (see MonteCarloAnalysis::run).
+ */
 void Mcmc::checkpoint( void ) const
 {
     // initialize variables
@@ -207,11 +228,9 @@ void Mcmc::checkpoint( void ) const
     RbFileManager fm = RbFileManager(checkpoint_file_name);
     fm.createDirectoryForFile();
     
-    // open the stream to the file
-    std::fstream out_stream;
-    out_stream.open( fm.getFullFileName().c_str(), std::fstream::out);
+    std::stringstream out_stream;
+    out_stream << "# iter = " << generation << std::endl;
     
-
     // first, we write the names of the variables
     for (std::vector<DagNode *>::const_iterator it=variable_nodes.begin(); it!=variable_nodes.end(); ++it)
     {
@@ -253,29 +272,15 @@ void Mcmc::checkpoint( void ) const
         node->printValue(out_stream, separator, -1, false, false, flatten);
     }
     
-    
-    // clean up
-    out_stream.close();
+    writeCheckpointFile( fm.getFullFileName(), out_stream.str() );
     
     
     /////////
-    // Now we also write the MCMC information into a file
+    // The text values are rounded, so we also write the numeric values in binary
     /////////
-
-    // assemble the new filename
-    std::string mcmc_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_mcmc." + fm.getFileExtension();
-    
-    RbFileManager fm_mcmc = RbFileManager(mcmc_checkpoint_file_name);
-    fm_mcmc.createDirectoryForFile();
-    
-    // open the stream to the file
-    std::fstream out_stream_mcmc;
-    out_stream_mcmc.open( fm_mcmc.getFullFileName().c_str(), std::fstream::out);
     
-    out_stream_mcmc << "iter = " << generation << std::endl;
-    
-    // clean up
-    out_stream_mcmc.close();
+    std::string values_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_values.bin";
+    writeCheckpointFile( values_checkpoint_file_name, getBinaryCheckpoint() );
     
     
     /////////
@@ -285,12 +290,9 @@ void Mcmc::checkpoint( void ) const
     // assemble the new filename
     std::string moves_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_moves." + fm.getFileExtension();
     
-    RbFileManager fm_moves = RbFileManager(moves_checkpoint_file_name);
-    fm_moves.createDirectoryForFile();
-    
-    // open the stream to the file
-    std::fstream out_stream_moves;
-    out_stream_moves.open( fm_moves.getFullFileName().c_str(), std::fstream::out);
+    std::stringstream out_stream_moves;
+    out_stream_moves.precision( std::numeric_limits<double>::max_digits10 );
+    out_stream_moves << "# iter = " << generation << std::endl;
     
     for (size_t i = 0; i < moves.size(); ++i)
     {
@@ -301,11 +303,77 @@ void Mcmc::checkpoint( void ) const
         out_stream_moves << ",num_accepted_current="    << moves[i].getNumberAcceptedCurrentPeriod();
         out_stream_moves << ",num_accepted_total="      << moves[i].getNumberAcceptedTotal();
         out_stream_moves << ",tuning_value="            << moves[i].getMoveTuningParameter();
+        
+        std::vector<double> adaptation_state = moves[i].getAdaptationState();
+        if ( adaptation_state.empty() == false )
+        {
+            out_stream_moves << ",adaptation=";
+            for (size_t j = 0; j < adaptation_state.size(); ++j)
+            {
+                out_stream_moves << ( j > 0 ? " " : "" ) << adaptation_state[j];
+            }
+        }
         out_stream_moves << ")" << std::endl;
     }
     
-    // clean up
-    out_stream_moves.close();
+    writeCheckpointFile( moves_checkpoint_file_name, out_stream_moves.str() );
+    
+    
+    /////////
+    // Finally we write the MCMC information into a file, which completes the checkpoint
+    /////////
+    
+    // assemble the new filename
+    std::string mcmc_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_mcmc." + fm.getFileExtension();
+    
+    std::stringstream out_stream_mcmc;
+    out_stream_mcmc.precision( std::numeric_limits<double>::max_digits10 );
+    out_stream_mcmc << "iter = " << generation << std::endl;
+    
+    // what the move schedule learned while adapting (e.g., the weights of the adaptive schedule)
+    std::vector<double> schedule_state = schedule->getAdaptationState();
+    if ( schedule_state.empty() == false )
+    {
+        out_stream_mcmc << "schedule =";
+        for (size_t i = 0; i < schedule_state.size(); ++i)
+        {
+            out_stream_mcmc << " " << schedule_state[i];
+        }
+        out_stream_mcmc << std::endl;
+    }
+    
+    // the sizes of the monitor files, so that we can remove the samples written after this checkpoint
+    for (size_t i = 0; i < monitors.size(); ++i)
+    {
+        const AbstractFileMonitor* m = dynamic_cast< const AbstractFileMonitor *>( &monitors[i] );
+        if ( m != NULL && monitors[i].isFileMonitor() == true )
+        {
+            long size = m->getFileSize();
+            if ( size >= 0 )
+            {
+                out_stream_mcmc << "monitor_" << i << " = " << size << std::endl;
+            }
+        }
+    }
+    
+    writeCheckpointFile( mcmc_checkpoint_file_name, out_stream_mcmc.str() );
+}
+
+
+/**
+ * Check that the line "# iter = g" of a checkpoint file states the iteration of the checkpoint.
+ * Other comment lines are ignored.
+ */
+void Mcmc::checkCheckpointIteration(const std::string &line, const std::string &file_name, size_t g) const
+{
+    
+    std::vector<std::string> key_value;
+    StringUtilities::stringSplit( line, " = ", key_value );
+    if ( key_value.size() == 2 && key_value[0] == "# iter" && size_t( StringUtilities::asIntegerNumber( key_value[1] ) ) != g )
+    {
+        throw RbException( "The checkpoint file \"" + file_name + "\" is from iteration " + key_value[1] + " but the checkpoint is from iteration " + StringUtilities::to_string( g ) + ". The checkpoint files are from different checkpoints." );
+    }
+    
 }
 
 
@@ -363,6 +431,87 @@ void Mcmc::finishMonitors( size_t n_reps, MonteCarloAnalysisOptions::TraceCombin
 }
 
 
+/**
+ * Get the values of the numeric variables (reals, integers and vectors of them) in binary.
+ * The format is the magic string "RBCKPT", a version number, the iteration and the number of variables, followed by
+ * the name, a type tag, the number of elements and the raw elements of every variable.
+ * Restoring these values gives exactly the same state, unlike the rounded text values.
+ */
+std::string Mcmc::getBinaryCheckpoint( void ) const
+{
+    
+    std::vector<std::string> names;
+    std::vector<unsigned char> types;
+    std::vector<std::vector<double> > real_values;
+    std::vector<std::vector<int64_t> > integer_values;
+    
+    for (size_t i = 0; i < variable_nodes.size(); ++i)
+    {
+        const DagNode *node = variable_nodes[i];
+        
+        if ( const StochasticNode<double> *n = dynamic_cast<const StochasticNode<double>* >( node ) )
+        {
+            types.push_back( 0 );
+            real_values.push_back( std::vector<double>(1, n->getValue()) );
+            integer_values.push_back( std::vector<int64_t>() );
+        }
+        else if ( const StochasticNode<RbVector<double> > *n = dynamic_cast<const StochasticNode<RbVector<double> >* >( node ) )
+        {
+            types.push_back( 1 );
+            real_values.push_back( static_cast<const std::vector<double>&>( n->getValue() ) );
+            integer_values.push_back( std::vector<int64_t>() );
+        }
+        else if ( const StochasticNode<long> *n = dynamic_cast<const StochasticNode<long>* >( node ) )
+        {
+            types.push_back( 2 );
+            real_values.push_back( std::vector<double>() );
+            integer_values.push_back( std::vector<int64_t>(1, n->getValue()) );
+        }
+        else if ( const StochasticNode<RbVector<long> > *n = dynamic_cast<const StochasticNode<RbVector<long> >* >( node ) )
+        {
+            types.push_back( 3 );
+            real_values.push_back( std::vector<double>() );
+            const std::vector<long> &v = n->getValue();
+            integer_values.push_back( std::vector<int64_t>( v.begin(), v.end() ) );
+        }
+        else
+        {
+            // all other values are only stored as text
+            continue;
+        }
+        names.push_back( node->getName() );
+    }
+    
+    std::string buffer = "RBCKPT";
+    uint32_t version = 2;
+    uint64_t iteration = generation;
+    uint64_t num_variables = names.size();
+    buffer.append( reinterpret_cast<const char*>(&version), sizeof(version) );
+    buffer.append( reinterpret_cast<const char*>(&iteration), sizeof(iteration) );
+    buffer.append( reinterpret_cast<const char*>(&num_variables), sizeof(num_variables) );
+    
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        uint64_t name_length = names[i].size();
+        uint64_t num_elements = ( types[i] < 2 ? real_values[i].size() : integer_values[i].size() );
+        buffer.append( reinterpret_cast<const char*>(&name_length), sizeof(name_length) );
+        buffer.append( names[i] );
+        buffer.append( reinterpret_cast<const char*>(&types[i]), sizeof(types[i]) );
+        buffer.append( reinterpret_cast<const char*>(&num_elements), sizeof(num_elements) );
+        if ( num_elements > 0 && types[i] < 2 )
+        {
+            buffer.append( reinterpret_cast<const char*>(&real_values[i][0]), num_elements * sizeof(double) );
+        }
+        else if ( num_elements > 0 )
+        {
+            buffer.append( reinterpret_cast<const char*>(&integer_values[i][0]), num_elements * sizeof(int64_t) );
+        }
+    }
+    
+    return buffer;
+}
+
+
 /**
  * Get the heat of the likelihood of this chain.
  */
@@ -408,6 +557,25 @@ bool Mcmc::isChainActive(void)
 }
 
 
+/**
+ * Get the names of the files written by checkpoint().
+ */
+std::vector<std::string> Mcmc::getCheckpointFiles( void ) const
+{
+    
+    RbFileManager fm = RbFileManager(checkpoint_file_name);
+    std::string base_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension();
+    
+    std::vector<std::string> files;
+    files.push_back( fm.getFullFileName() );
+    files.push_back( base_name + "_values.bin" );
+    files.push_back( base_name + "_moves." + fm.getFileExtension() );
+    files.push_back( base_name + "_mcmc." + fm.getFileExtension() );
+    
+    return files;
+}
+
+
 /**
  * Get the model instance.
  */
@@ -426,18 +594,16 @@ double Mcmc::getModelLnProbability(bool likelihood_only)
 {
     double pp = 0.0;
     
+    // the evaluator may compute the probabilities of expensive nodes concurrently
     const std::vector<DagNode*> &n = model->getDagNodes();
-    for (std::vector<DagNode*>::const_iterator it = n.begin(); it != n.end(); ++it)
+    ln_probability_evaluator.computeLnProbabilities( n, false, false, ln_probabilities );
+    
+    for (size_t i = 0; i < n.size(); ++i)
     {
         
-        DagNode *the_node = *it;
-        if (likelihood_only == false)
+        if (likelihood_only == false || n[i]->isClamped() == true )
         {
-            pp += the_node->getLnProbability();
-        }
-        else if (the_node->isClamped() == true )
-        {
-            pp += the_node->getLnProbability();
+            pp += ln_probabilities[i];
         }
 
     }
@@ -539,6 +705,11 @@ std::string Mcmc::getStrategyDescription( void ) const
     {
         stream << "The simulator uses " << moves.size() << " different moves in a sequential move schedule with " << schedule->getNumberMovesPerIteration() << " moves per iteration" << std::endl;
     }
+    else if ( schedule_type == "adaptive" )
+    {
+        stream << "The simulator uses " << moves.size() << " different moves in an adaptive move schedule with " << schedule->getNumberMovesPerIteration() << " moves per iteration" << std::endl;
+        stream << "The move weights are adapted during burnin to maximize the effective samples per second and fixed afterwards" << std::endl;
+    }
     description = stream.str();
 
     return description;
@@ -607,10 +778,17 @@ void Mcmc::initializeSampler( bool prior_only )
         ln_probability = 0.0;
         for (std::vector<DagNode *>::iterator i=dag_nodes.begin(); i!=dag_nodes.end(); ++i)
         {
-            DagNode* the_node = (*i);
-            the_node->touch();
-            
-            double ln_prob = the_node->getLnProbability();
+            (*i)->touch();
+        }
+        
+        // the evaluator may compute the probabilities of expensive nodes concurrently
+        // and stops at the first non-computable probability of the cheap nodes
+        ln_probability_evaluator.computeLnProbabilities( dag_nodes, false, true, ln_probabilities );
+        
+        for (size_t i = 0; i < dag_nodes.size(); ++i)
+        {
+            DagNode* the_node = dag_nodes[i];
+            double ln_prob = ln_probabilities[i];
             
             if ( RbMath::isAComputableNumber(ln_prob) == false )
             {
@@ -680,18 +858,7 @@ void Mcmc::initializeSampler( bool prior_only )
     }
     
     // Create the move scheduler
-    if ( schedule_type == "sequential" )
-    {
-        schedule = new SequentialMoveSchedule( &moves );
-    }
-    else if ( schedule_type == "single" )
-    {
-        schedule = new SingleRandomMoveSchedule( &moves );
-    }
-    else
-    {
-        schedule = new RandomMoveSchedule( &moves );
-    }
+    initializeSchedule();
     
     generation = 0;
     
@@ -699,12 +866,15 @@ void Mcmc::initializeSampler( bool prior_only )
 }
 
 
+/**
+ * Initialize the sampler from the checkpoint files written by checkpoint().
+ * We first read the MCMC file, which is written last, and then check that all other files are from the same iteration.
+ * The samples that the file monitors wrote after the checkpoint are removed when the monitors are opened again.
+ */
 void Mcmc::initializeSamplerFromCheckpoint( void )
 {
     
-    //    size_t n_samples = traces[0].size();
     size_t last_generation = 0;
-    //    size_t n_traces = traces.size();
     
     std::vector<std::string> parameter_names;
     std::vector<std::string> parameter_values;
@@ -719,6 +889,72 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
         throw( RbException(errorStr) );
     }
     
+    
+    /////////
+    // First we read the MCMC information, which completes a checkpoint
+    /////////
+    
+    // assemble the new filename
+    std::string mcmc_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_mcmc." + fm.getFileExtension();
+    
+    RbFileManager fm_mcmc = RbFileManager(mcmc_checkpoint_file_name);
+    
+    // Open file
+    std::ifstream in_file_mcmc( fm_mcmc.getFullFileName().c_str() );
+    
+    std::string line_mcmc;
+    std::map<std::string, std::string> mcmc_pars;
+    // Command-processing loop
+    while ( in_file_mcmc.good() )
+    {
+        
+        // Read a line
+        fm_mcmc.safeGetline( in_file_mcmc, line_mcmc );
+        
+        if ( line_mcmc != "" )
+        {
+            std::vector<std::string> key_value;
+            StringUtilities::stringSplit(line_mcmc, " = ", key_value);
+            
+            mcmc_pars.insert( std::pair<std::string, std::string>(key_value[0],key_value[1]) );
+        }
+        
+    }
+    
+    // clean up
+    in_file_mcmc.close();
+    
+    if ( mcmc_pars.find( "iter" ) == mcmc_pars.end() )
+    {
+        throw RbException( "The checkpoint file \"" + mcmc_checkpoint_file_name + "\" is missing or incomplete." );
+    }
+    last_generation = StringUtilities::asIntegerNumber( mcmc_pars["iter"] );
+    
+    if ( mcmc_pars.find( "schedule" ) != mcmc_pars.end() )
+    {
+        std::vector<std::string> state_values;
+        StringUtilities::stringSplit( mcmc_pars["schedule"], " ", state_values );
+        
+        std::vector<double> schedule_state;
+        for (size_t i = 0; i < state_values.size(); ++i)
+        {
+            schedule_state.push_back( atof( state_values[i].c_str() ) );
+        }
+        schedule->setAdaptationState( schedule_state );
+    }
+    
+    // older checkpoints stored the state of the random number generator per replicate
+    // (newer ones store it once for the analysis, see MonteCarloAnalysis::initializeFromCheckpoint)
+    if ( mcmc_pars.find( "rng" ) != mcmc_pars.end() )
+    {
+        GLOBAL_RNG->setState( mcmc_pars["rng"] );
+    }
+    
+    
+    /////////
+    // Next we read the values of the variables
+    /////////
+    
     // Open file
     std::ifstream inFile( fm.getFullFileName().c_str() );
     
@@ -749,9 +985,10 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
         }
         
         
-        // removing comments
+        // removing comments, but checking the iteration (not written by older versions)
         if (line[0] == '#')
         {
+            checkCheckpointIteration( line, checkpoint_file_name, last_generation );
             continue;
         }
         
@@ -793,37 +1030,18 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
         }
     }
     
-    // assemble the new filename
-    std::string mcmc_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_mcmc." + fm.getFileExtension();
-    
-    RbFileManager fm_mcmc = RbFileManager(mcmc_checkpoint_file_name);
-    fm_mcmc.createDirectoryForFile();
-    
-    // Open file
-    std::ifstream in_file_mcmc( fm_mcmc.getFullFileName().c_str() );
-
-    std::string line_mcmc;
-    std::map<std::string, std::string> mcmc_pars;
-    // Command-processing loop
-    while ( in_file_mcmc.good() )
+    // the numeric values are also stored exactly in binary (but not in checkpoints written by older versions)
+    std::string values_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_values.bin";
+    RbFileManager fm_values = RbFileManager(values_checkpoint_file_name);
+    if ( fm_values.isFile() == true )
     {
-        
-        // Read a line
-        fm_mcmc.safeGetline( in_file_mcmc, line_mcmc );
-        
-        if ( line_mcmc != "" )
+        std::string buffer;
+        if ( fm_values.readFile( buffer ) == false )
         {
-            std::vector<std::string> key_value;
-            StringUtilities::stringSplit(line_mcmc, " = ", key_value);
-
-            mcmc_pars.insert( std::pair<std::string, std::string>(key_value[0],key_value[1]) );
+            throw RbException( "Could not read the checkpoint file \"" + values_checkpoint_file_name + "\"." );
         }
-        
+        setValuesFromBinaryCheckpoint( buffer, last_generation );
     }
-    last_generation = StringUtilities::asIntegerNumber( mcmc_pars["iter"] );
-    
-    // clean up
-    in_file_mcmc.close();
     
     
     // we also need to tell our monitors to append after the last sample
@@ -837,13 +1055,20 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
             // set file monitors to append
             AbstractFileMonitor* m = dynamic_cast< AbstractFileMonitor *>( &monitors[j] );
             m->setAppend(true);
+            
+            // and to remove the samples after the checkpoint (if the checkpoint has the size)
+            std::map<std::string, std::string>::const_iterator it = mcmc_pars.find( "monitor_" + StringUtilities::to_string( j ) );
+            if ( it != mcmc_pars.end() )
+            {
+                m->setAppendOffset( atol( it->second.c_str() ) );
+            }
         }
     }
     
     
     
     /////////
-    // Next we also write the moves information into a file
+    // Next we also read the moves information from a file
     /////////
     std::string moves_checkpoint_file_name = fm.getFilePath() + fm.getPathSeparator() + fm.getFileNameWithoutExtension() + "_moves." + fm.getFileExtension();
     
@@ -862,7 +1087,11 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
         // Read a line
         fm_moves.safeGetline( in_file_moves, line_moves );
         
-        if ( line_moves != "" )
+        if ( line_moves != "" && line_moves[0] == '#' )
+        {
+            checkCheckpointIteration( line_moves, moves_checkpoint_file_name, last_generation );
+        }
+        else if ( line_moves != "" )
         {
             stored_move_info.push_back( line_moves );
         }
@@ -915,6 +1144,23 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
         StringUtilities::stringSplit( values[5], "=", key_value);
         moves[i].setMoveTuningParameter( atof(key_value[1].c_str()) );
         
+        // what the move learned while adapting (not written by older versions)
+        if ( values.size() > 6 )
+        {
+            key_value.clear();
+            StringUtilities::stringSplit( values[6], "=", key_value);
+            
+            std::vector<std::string> state_values;
+            StringUtilities::stringSplit( key_value[1], " ", state_values);
+            
+            std::vector<double> adaptation_state;
+            for (size_t j = 0; j < state_values.size(); ++j)
+            {
+                adaptation_state.push_back( atof(state_values[j].c_str()) );
+            }
+            moves[i].setAdaptationState( adaptation_state );
+        }
+        
     }
     
     // clean up
@@ -923,6 +1169,34 @@ void Mcmc::initializeSamplerFromCheckpoint( void )
 }
 
 
+/**
+ * Create the move schedule of the current schedule type, replacing the previous schedule.
+ */
+void Mcmc::initializeSchedule( void )
+{
+    
+    delete schedule;
+    
+    if ( schedule_type == "sequential" )
+    {
+        schedule = new SequentialMoveSchedule( &moves );
+    }
+    else if ( schedule_type == "single" )
+    {
+        schedule = new SingleRandomMoveSchedule( &moves );
+    }
+    else if ( schedule_type == "adaptive" )
+    {
+        schedule = new AdaptiveMoveSchedule( &moves );
+    }
+    else
+    {
+        schedule = new RandomMoveSchedule( &moves );
+    }
+    
+}
+
+
 void Mcmc::initializeMonitors(void)
 {
     
@@ -964,7 +1238,22 @@ void Mcmc::nextCycle(bool advance_cycle)
         Move& the_move = schedule->nextMove( generation );
 
         // Perform the move
-        the_move.performMcmcStep( chain_prior_heat, chain_likelihood_heat, chain_posterior_heat );
+        if ( Profiler::globalProfiler().isEnabled() == true )
+        {
+            // the moves are listed like in the operator summary, by their name and their first variable
+            const std::vector<DagNode*> &move_nodes = the_move.getDagNodes();
+            std::string label = the_move.getMoveName() + "(" + ( move_nodes.empty() == true ? "" : move_nodes[0]->getName() ) + ")";
+            
+            Profiler::Timer timer( Profiler::MOVE, label.c_str() );
+            timer.addTouchedNodes( move_nodes.size() + the_move.getAffectedNodes().size() );
+            the_move.performMcmcStep( chain_prior_heat, chain_likelihood_heat, chain_posterior_heat );
+        }
+        else
+        {
+            the_move.performMcmcStep( chain_prior_heat, chain_likelihood_heat, chain_posterior_heat );
+        }
+        
+        schedule->moveFinished();
         
     }
     
@@ -1226,6 +1515,19 @@ void Mcmc::setActivePIDSpecialized(size_t a, size_t n)
 }
 
 
+/**
+ * Set the number of threads of this specific MCMC simulation.
+ * The threads are used by the model to compute the likelihood.
+ */
+void Mcmc::setNumberOfThreadsSpecialized(size_t n)
+{
+    
+    // delegate the call to the model
+    model->setNumberOfThreads( num_threads );
+    
+}
+
+
 /**
  * Set if the current chain is the active chain.
  * Only active chains print to the monitors.
@@ -1248,6 +1550,25 @@ void Mcmc::setChainLikelihoodHeat(double h)
 }
 
 
+/**
+ * Start or stop the adaptation phase (burnin) of the moves and the move schedule.
+ */
+void Mcmc::setAdaptation(bool tf)
+{
+    
+    for (RbIterator<Move> it=moves.begin(); it!=moves.end(); ++it)
+    {
+        it->setAdaptation( tf );
+    }
+    
+    if ( schedule != NULL )
+    {
+        schedule->setAdaptive( tf );
+    }
+    
+}
+
+
 void Mcmc::setCheckpointFile(const std::string &f)
 {
     checkpoint_file_name = f;
@@ -1301,6 +1622,7 @@ void Mcmc::setModel( Model *m, bool redraw )
     Model * old_model = model;
     
     model = m;
+    model->setNumberOfThreads( num_threads );
     
     // we also need to replace the DAG nodes of our moves and monitors.
     RbVector<Move> tmp_moves = moves;
@@ -1360,10 +1682,148 @@ void Mcmc::setMovesTuningInfo(const std::vector<tuningInfo> &mvs_ti)
 }
 
 
+/**
+ * Set the type of the move schedule.
+ * If the sampler is already initialized, we replace its schedule, e.g., before we restore a checkpoint of an adaptive schedule.
+ */
 void Mcmc::setScheduleType(const std::string &s)
 {
     
+    bool changed = ( schedule_type != s );
     schedule_type = s;
+    
+    if ( schedule != NULL && changed == true )
+    {
+        initializeSchedule();
+    }
+    
+}
+
+
+/**
+ * Set the values of the numeric variables from a binary checkpoint (see getBinaryCheckpoint).
+ * The checkpoint must be from iteration g (version 1 files don't record the iteration).
+ * Variables that don't exist in this model or have a different type are skipped, so that the text values are used for them.
+ */
+void Mcmc::setValuesFromBinaryCheckpoint(const std::string &buffer, size_t g)
+{
+    
+    size_t pos = 0;
+    const char *data = buffer.data();
+    
+    uint32_t version = 0;
+    uint64_t iteration = 0;
+    uint64_t num_variables = 0;
+    if ( buffer.size() < 6 + sizeof(version) + sizeof(num_variables) || buffer.compare(0, 6, "RBCKPT") != 0 )
+    {
+        throw RbException("The binary checkpoint file is not a RevBayes checkpoint.");
+    }
+    pos += 6;
+    std::memcpy( &version, data+pos, sizeof(version) );
+    pos += sizeof(version);
+    if ( version != 1 && version != 2 )
+    {
+        throw RbException("The binary checkpoint file was written by an unknown version of RevBayes.");
+    }
+    if ( version == 2 )
+    {
+        if ( pos + sizeof(iteration) + sizeof(num_variables) > buffer.size() )
+        {
+            throw RbException("The binary checkpoint file is truncated.");
+        }
+        std::memcpy( &iteration, data+pos, sizeof(iteration) );
+        pos += sizeof(iteration);
+        if ( iteration != g )
+        {
+            throw RbException("The binary checkpoint file is from iteration " + StringUtilities::to_string( iteration ) + " but the checkpoint is from iteration " + StringUtilities::to_string( g ) + ".");
+        }
+    }
+    std::memcpy( &num_variables, data+pos, sizeof(num_variables) );
+    pos += sizeof(num_variables);
+    
+    const std::vector<DagNode*> &nodes = getModel().getDagNodes();
+    
+    for (size_t i = 0; i < num_variables; ++i)
+    {
+        uint64_t name_length = 0;
+        unsigned char type = 0;
+        uint64_t num_elements = 0;
+        
+        if ( pos + sizeof(name_length) > buffer.size() )
+        {
+            throw RbException("The binary checkpoint file is truncated.");
+        }
+        std::memcpy( &name_length, data+pos, sizeof(name_length) );
+        pos += sizeof(name_length);
+        if ( pos + name_length + sizeof(type) + sizeof(num_elements) > buffer.size() )
+        {
+            throw RbException("The binary checkpoint file is truncated.");
+        }
+        std::string name = buffer.substr( pos, name_length );
+        pos += name_length;
+        std::memcpy( &type, data+pos, sizeof(type) );
+        pos += sizeof(type);
+        std::memcpy( &num_elements, data+pos, sizeof(num_elements) );
+        pos += sizeof(num_elements);
+        
+        size_t element_size = ( type < 2 ? sizeof(double) : sizeof(int64_t) );
+        if ( type > 3 || pos + num_elements * element_size > buffer.size() )
+        {
+            throw RbException("The binary checkpoint file is corrupt.");
+        }
+        std::vector<double> real_values( type < 2 ? num_elements : 0 );
+        std::vector<int64_t> integer_values( type < 2 ? 0 : num_elements );
+        if ( num_elements > 0 && type < 2 )
+        {
+            std::memcpy( &real_values[0], data+pos, num_elements * element_size );
+        }
+        else if ( num_elements > 0 )
+        {
+            std::memcpy( &integer_values[0], data+pos, num_elements * element_size );
+        }
+        pos += num_elements * element_size;
+        
+        for (size_t j = 0; j < nodes.size(); ++j)
+        {
+            if ( nodes[j]->getName() != name )
+            {
+                continue;
+            }
+            
+            bool found = true;
+            if ( StochasticNode<double> *n = dynamic_cast<StochasticNode<double>* >( nodes[j] ) )
+            {
+                found = ( type == 0 && num_elements == 1 );
+                if ( found == true ) n->setValue( new double( real_values[0] ) );
+            }
+            else if ( StochasticNode<RbVector<double> > *n = dynamic_cast<StochasticNode<RbVector<double> >* >( nodes[j] ) )
+            {
+                found = ( type == 1 && num_elements == n->getValue().size() );
+                if ( found == true ) n->setValue( new RbVector<double>( real_values ) );
+            }
+            else if ( StochasticNode<long> *n = dynamic_cast<StochasticNode<long>* >( nodes[j] ) )
+            {
+                found = ( type == 2 && num_elements == 1 );
+                if ( found == true ) n->setValue( new long( integer_values[0] ) );
+            }
+            else if ( StochasticNode<RbVector<long> > *n = dynamic_cast<StochasticNode<RbVector<long> >* >( nodes[j] ) )
+            {
+                found = ( type == 3 && num_elements == n->getValue().size() );
+                if ( found == true ) n->setValue( new RbVector<long>( std::vector<long>( integer_values.begin(), integer_values.end() ) ) );
+            }
+            else
+            {
+                found = false;
+            }
+            
+            if ( found == true )
+            {
+                nodes[j]->keep();
+            }
+            break;
+        }
+    }
+    
 }
 
 
@@ -1412,6 +1872,22 @@ void Mcmc::writeMonitorHeaders( bool screen_monitor_only )
 }
 
 
+/**
+ * Replace a checkpoint file atomically by the given content and keep the old file as the previous version (see RbFileManager::writeFile).
+ * Thus, the checkpoint file always is either the complete old or the complete new file.
+ */
+void Mcmc::writeCheckpointFile(const std::string &file_name, const std::string &content) const
+{
+    
+    RbFileManager fm = RbFileManager( file_name );
+    if ( fm.writeFile( content, true ) == false )
+    {
+        throw RbException("Could not write the checkpoint file \"" + file_name + "\".");
+    }
+    
+}
+
+
 /**
  * Tune the sampler.
  * Here we just tune all the moves.
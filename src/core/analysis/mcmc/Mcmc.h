@@ -1,6 +1,7 @@
 #ifndef Mcmc_H
 #define Mcmc_H
 
+#include "LnProbabilityEvaluator.h"
 #include "MonteCarloSampler.h"
 
 namespace RevBayesCore {
@@ -47,6 +48,7 @@ namespace RevBayesCore {
         double                                              getChainLikelihoodHeat(void) const;                                                     //!< Get the heat for this chain
         double                                              getChainPosteriorHeat(void) const;                                                      //!< Get the heat for this chain
         double                                              getChainPriorHeat(void) const;
+        std::vector<std::string>                            getCheckpointFiles(void) const;                                                         //!< Get the names of the checkpoint files
         size_t                                              getChainIndex(void) const;                                                              //!< Get the index of this chain
         const Model&                                        getModel(void) const;
         double                                              getModelLnProbability(bool like_only);
@@ -66,6 +68,7 @@ namespace RevBayesCore {
         void                                                redrawStartingValues(void);                                                             //!< Redraw the starting values.
         void                                                removeMonitors(void);
         void                                                reset(void);                                                                            //!< Reset the sampler and set all the counters back to 0.
+        void                                                setAdaptation(bool tf);                                                                 //!< Start or stop the adaptation phase (burnin) of the moves
         void                                                setChainActive(bool tf);
         void                                                setChainLikelihoodHeat(double v);                                                       //!< Set the heating temparature of the likelihood of the chain
         void                                                setChainPosteriorHeat(double v);                                                        //!< Set the heating temparature of the posterior of the chain
@@ -83,10 +86,16 @@ namespace RevBayesCore {
         
         
     protected:
+        void                                                checkCheckpointIteration(const std::string &l, const std::string &fn, size_t g) const;  //!< Check the iteration line of a checkpoint file
+        std::string                                         getBinaryCheckpoint(void) const;                                                        //!< The exact values of the numeric variables in binary
         void                                                resetVariableDagNodes(void);                                                //!< Extract the variable to be monitored again.
         void                                                initializeMonitors(void);                                                               //!< Assign model and mcmc ptrs to monitors
+        void                                                initializeSchedule(void);                                                               //!< Create the move schedule of the schedule type
         void                                                replaceDag(const RbVector<Move> &mvs, const RbVector<Monitor> &mons);
         void                                                setActivePIDSpecialized(size_t a, size_t n);                                            //!< Set the number of processes for this class.
+        void                                                setNumberOfThreadsSpecialized(size_t n);                                                //!< Set the number of threads for this class.
+        void                                                setValuesFromBinaryCheckpoint(const std::string &b, size_t g);                          //!< Set the numeric variables from a binary checkpoint of iteration g
+        void                                                writeCheckpointFile(const std::string &fn, const std::string &c) const;                 //!< Replace a checkpoint file atomically
 
         
         bool                                                chain_active;
@@ -95,6 +104,8 @@ namespace RevBayesCore {
         double                                              chain_prior_heat;
         size_t                                              chain_idx;
         std::string                                         checkpoint_file_name;
+        LnProbabilityEvaluator                              ln_probability_evaluator;                                                                //!< Computes the probabilities of the nodes, possibly concurrently
+        std::vector<double>                                 ln_probabilities;                                                                        //!< Work space for the probabilities of the nodes
         Model*                                              model;
         RbVector<Monitor>                                   monitors;
         RbVector<Move>                                      moves;
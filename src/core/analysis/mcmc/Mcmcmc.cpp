@@ -246,6 +246,28 @@ void Mcmcmc::finishMonitors( size_t n_reps, MonteCarloAnalysisOptions::TraceComb
 /**
  * Get the model instance.
  */
+/**
+ * Get the names of the checkpoint files of all chains of this process.
+ */
+std::vector<std::string> Mcmcmc::getCheckpointFiles( void ) const
+{
+    
+    std::vector<std::string> files;
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        
+        if ( chains[i] != NULL )
+        {
+            std::vector<std::string> chain_files = chains[i]->getCheckpointFiles();
+            files.insert( files.end(), chain_files.begin(), chain_files.end() );
+        }
+        
+    }
+    
+    return files;
+}
+
+
 const Model& Mcmcmc::getModel( void ) const
 {
     
@@ -358,6 +380,7 @@ void Mcmcmc::initializeChains(void)
             oneChain->setChainPosteriorHeat( chain_heats[i] );
             oneChain->setChainIndex( i );
             oneChain->setActivePID( active_pid_for_chain, num_processer_for_chain );
+            oneChain->setNumberOfThreads( num_threads );
             chains[i] = oneChain;
         }
         else
@@ -1042,6 +1065,28 @@ void Mcmcmc::setActivePIDSpecialized(size_t i, size_t n)
 }
 
 
+/**
+ * Set the number of threads for each chain of this process.
+ * The chains of a process run one after the other, so every chain may use all threads for its likelihood.
+ */
+void Mcmcmc::setNumberOfThreadsSpecialized(size_t n)
+{
+    
+    base_chain->setNumberOfThreads( num_threads );
+    
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        
+        if ( chains[i] != NULL )
+        {
+            chains[i]->setNumberOfThreads( num_threads );
+        }
+        
+    }
+    
+}
+
+
 /**
  * Start the monitors at the beginning of a run which will simply delegate this call to each chain.
  */
@@ -1062,6 +1107,24 @@ void Mcmcmc::startMonitors(size_t num_cycles, bool reopen)
 }
 
 
+/**
+ * Start or stop the adaptation phase, i.e., burnin, of the moves by delegating to the chains.
+ */
+void Mcmcmc::setAdaptation(bool tf)
+{
+    
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        if (chains[i] != NULL)
+        {
+            chains[i]->setAdaptation( tf );
+        }
+        
+    }
+    
+}
+
+
 void Mcmcmc::setCheckpointFile(const std::string &f)
 {
     RbFileManager fm = RbFileManager(f);
@@ -38,6 +38,7 @@ namespace RevBayesCore {
         Mcmcmc*                                 clone(void) const;
         void                                    checkpoint(void) const;
         void                                    finishMonitors(size_t n, MonteCarloAnalysisOptions::TraceCombinationTypes ct);  //!< Finish the monitors
+        std::vector<std::string>                getCheckpointFiles(void) const;                                                 //!< Get the names of the checkpoint files of all chains
         const Model&                            getModel(void) const;
         double                                  getModelLnProbability(bool likelihood_only);
         RbVector<Monitor>&                      getMonitors( void );
@@ -54,6 +55,7 @@ namespace RevBayesCore {
         void                                    removeMonitors(void);
         void                                    reset(void);                                                                    //!< Reset the sampler for a new run.
         void                                    resetCounters(void);                                                            //!< Reset the counters.
+        void                                    setAdaptation(bool tf);                                                         //!< Start or stop the adaptation phase (burnin) of the moves
         void                                    setCheckpointFile(const std::string &f);
         void                                    setHeatsInitial(const std::vector<double> &ht);
         void                                    setSwapInterval2(const size_t &si2);
@@ -67,6 +69,7 @@ namespace RevBayesCore {
         
     protected:
         void                                    setActivePIDSpecialized(size_t i, size_t n);                                    //!< Set the number of processes for this class.
+        void                                    setNumberOfThreadsSpecialized(size_t n);                                        //!< Set the number of threads for this class.
 
         
     private:
@@ -48,6 +48,7 @@ namespace RevBayesCore {
         virtual void                            checkpoint(void) const = 0;                                 //!< Perform checkpointing by writing the current values to a file.
 //        virtual void                            run(size_t g) = 0;
         virtual void                            finishMonitors(size_t n, MonteCarloAnalysisOptions::TraceCombinationTypes ct) = 0; //!< Finish the monitors
+        virtual std::vector<std::string>        getCheckpointFiles(void) const = 0;                         //!< Get the names of the files written by checkpoint()
         virtual const Model&                    getModel(void) const = 0;
         virtual double                          getModelLnProbability(bool like_only) = 0;
         virtual RbVector<Monitor>&              getMonitors() = 0;
@@ -60,6 +61,7 @@ namespace RevBayesCore {
         virtual void                            redrawStartingValues(void) = 0;                             //!< Redraw the starting values.
         virtual void                            removeMonitors(void) = 0;
         virtual void                            reset(void) = 0;                                            //!< Reset the sampler for a new run.
+        virtual void                            setAdaptation(bool tf) = 0;                                 //!< Start or stop the adaptation phase (burnin) of the moves
         virtual void                            setCheckpointFile(const std::string &f) = 0;
         virtual void                            setLikelihoodHeat(double v) = 0;                            //!< Set the heating temparature of the likelihood of the chain
 //        virtual void                            setMasterSampler(bool tf) = 0;                            //!< Set whether this one is the master.
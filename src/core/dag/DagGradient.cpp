@@ -0,0 +1,196 @@
+#include "DagGradient.h"
+
+#include <stddef.h>
+#include <map>
+
+#include "DagNode.h"
+
+using namespace RevBayesCore;
+
+
+DagGradient::DagGradient( void )
+{
+
+}
+
+
+/**
+ * Constructor. We collect the nodes depending on the variables.
+ */
+DagGradient::DagGradient(const std::vector<DagNode*> &v) :
+    variables( v )
+{
+
+    std::set<const DagNode*> visited;
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        subgraph.insert( variables[i] );
+    }
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( visited.find( variables[i] ) == visited.end() )
+        {
+            visited.insert( variables[i] );
+            stochastic_nodes.push_back( variables[i] );
+        }
+        collectNodes( variables[i], visited );
+    }
+
+}
+
+
+/**
+ * Depth-first search through the children of the node.
+ * A deterministic node is appended after all its (deterministic) descendants,
+ * so that the list of deterministic nodes is in reverse topological order.
+ */
+void DagGradient::collectNodes(DagNode *n, std::set<const DagNode*> &visited)
+{
+
+    const std::vector<DagNode*> &children = n->getChildren();
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        DagNode *child = children[i];
+        if ( visited.find( child ) != visited.end() )
+        {
+            continue;
+        }
+        visited.insert( child );
+
+        if ( child->getDagNodeType() == DagNode::DETERMINISTIC )
+        {
+            subgraph.insert( child );
+            collectNodes( child, visited );
+            deterministic_nodes.push_back( child );
+        }
+        else if ( child->isStochastic() == true )
+        {
+            stochastic_nodes.push_back( child );
+        }
+    }
+
+}
+
+
+/**
+ * Compute the gradient of the heated ln posterior, pHeat * (lHeat * ln likelihood + prHeat * ln prior),
+ * with respect to the variables. The current values of the DAG are used.
+ * A variable which does not have any node depending on it gets an empty gradient (i.e., zero).
+ *
+ * \param[out]   g            The gradient for each variable.
+ * \param[out]   available    Flags whether the gradient of each variable could be computed.
+ * \return True if the gradients of all variables are available.
+ */
+bool DagGradient::computeGradient(double prHeat, double lHeat, double pHeat, std::vector<std::vector<double> > &g, std::vector<bool> &available) const
+{
+
+    std::map<const DagNode*, std::vector<double> > adjoints;
+    std::set<const DagNode*> unavailable;
+
+    // the gradient of the ln probabilities of the stochastic nodes
+    for (size_t i = 0; i < stochastic_nodes.size(); ++i)
+    {
+        DagNode *s = stochastic_nodes[i];
+        double heat = pHeat * ( s->isClamped() == true ? lHeat : prHeat );
+
+        std::set<const DagNode*> targets;
+        if ( subgraph.find( s ) != subgraph.end() )
+        {
+            targets.insert( s );
+        }
+        std::vector<const DagNode*> parents = s->getParents();
+        for (size_t j = 0; j < parents.size(); ++j)
+        {
+            if ( subgraph.find( parents[j] ) != subgraph.end() )
+            {
+                targets.insert( parents[j] );
+            }
+        }
+
+        for (std::set<const DagNode*>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+        {
+            std::vector<double> s_g;
+            std::vector<double> &a = adjoints[*it];
+            if ( s->getLnProbabilityGradient( *it, s_g ) == false || (a.size() > 0 && a.size() != s_g.size()) )
+            {
+                unavailable.insert( *it );
+                continue;
+            }
+
+            a.resize( s_g.size(), 0.0 );
+            for (size_t k = 0; k < s_g.size(); ++k)
+            {
+                a[k] += heat * s_g[k];
+            }
+        }
+    }
+
+    // the backward sweep through the deterministic nodes
+    for (size_t i = 0; i < deterministic_nodes.size(); ++i)
+    {
+        DagNode *d = deterministic_nodes[i];
+        bool d_available = ( unavailable.find( d ) == unavailable.end() );
+
+        std::map<const DagNode*, std::vector<double> >::const_iterator d_adjoint = adjoints.find( d );
+        if ( d_available == true && d_adjoint == adjoints.end() )
+        {
+            // nothing depends on this node
+            continue;
+        }
+
+        std::vector<const DagNode*> parents = d->getParents();
+        std::set<const DagNode*> targets;
+        for (size_t j = 0; j < parents.size(); ++j)
+        {
+            if ( subgraph.find( parents[j] ) != subgraph.end() )
+            {
+                targets.insert( parents[j] );
+            }
+        }
+
+        for (std::set<const DagNode*>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+        {
+            std::vector<double> d_g;
+            if ( d_available == false || d->getVectorJacobianProduct( *it, d_adjoint->second, d_g ) == false )
+            {
+                unavailable.insert( *it );
+                continue;
+            }
+
+            std::vector<double> &a = adjoints[*it];
+            if ( a.size() > 0 && a.size() != d_g.size() )
+            {
+                unavailable.insert( *it );
+                continue;
+            }
+
+            a.resize( d_g.size(), 0.0 );
+            for (size_t k = 0; k < d_g.size(); ++k)
+            {
+                a[k] += d_g[k];
+            }
+        }
+    }
+
+    bool all_available = true;
+    g.assign( variables.size(), std::vector<double>() );
+    available.assign( variables.size(), true );
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( unavailable.find( variables[i] ) != unavailable.end() )
+        {
+            available[i] = false;
+            all_available = false;
+        }
+        else
+        {
+            std::map<const DagNode*, std::vector<double> >::const_iterator it = adjoints.find( variables[i] );
+            if ( it != adjoints.end() )
+            {
+                g[i] = it->second;
+            }
+        }
+    }
+
+    return all_available;
+}
@@ -0,0 +1,54 @@
+#ifndef DagGradient_H
+#define DagGradient_H
+
+#include <set>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class DagNode;
+
+    /**
+     * @brief Reverse-mode differentiation of the ln posterior through the DAG.
+     *
+     * Given a set of continuous variables, we collect the deterministic nodes that depend on them
+     * and the stochastic nodes that depend on them (directly or through deterministic nodes).
+     * The gradient of the heated ln posterior with respect to the variables is then computed in one backward sweep:
+     * (1) every stochastic node gives the gradient of its ln probability with respect to its parents in the subgraph
+     *     (see DagNode::getLnProbabilityGradient),
+     * (2) the deterministic nodes are visited in reverse topological order and pass their accumulated gradient (adjoint)
+     *     on to their parents (see DagNode::getVectorJacobianProduct).
+     *
+     * Nodes are flattened into vectors of reals: a real number has one element, vectors and simplices have one element per entry
+     * and rate matrices have n*n elements in row-major order.
+     * If any node on the path from a variable to a stochastic node cannot provide its gradient, the gradient of that variable is
+     * flagged as unavailable and the caller needs to fall back to, e.g., numerical differentiation.
+     *
+     * The collected subgraph is only valid as long as the DAG structure does not change.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class DagGradient {
+
+    public:
+        DagGradient(void);                                                                                              //!< Default constructor (no variables)
+        DagGradient(const std::vector<DagNode*> &v);                                                                    //!< Constructor
+
+        bool                                    computeGradient(double prHeat, double lHeat, double pHeat, std::vector<std::vector<double> > &g, std::vector<bool> &available) const;  //!< Compute the gradient of the heated ln posterior for each variable
+
+    private:
+
+        void                                    collectNodes(DagNode *n, std::set<const DagNode*> &visited);          //!< Depth-first search through the children
+
+        std::vector<DagNode*>                   variables;                                                              //!< The variables we differentiate with respect to
+        std::vector<DagNode*>                   deterministic_nodes;                                                    //!< The deterministic nodes depending on the variables in reverse topological order
+        std::vector<DagNode*>                   stochastic_nodes;                                                       //!< The stochastic nodes depending on the variables, including the variables
+        std::set<const DagNode*>                subgraph;                                                               //!< The variables and the deterministic nodes
+
+    };
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "DagNode.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <ostream>
 #include <string>
@@ -12,6 +13,18 @@
 
 using namespace RevBayesCore;
 
+
+namespace {
+
+    // changes whenever a child is added or removed anywhere, which invalidates all propagation orders
+    std::atomic<size_t> dag_structure_version( 1 );
+
+    // every keep() and restore() gets a new stamp, so that each node is kept or restored once per call
+    std::atomic<size_t> next_visit_stamp( 1 );
+
+}
+
+
 /**
  * Construct an empty DAG node, potentially
  * with a name (default is "").
@@ -26,7 +39,11 @@ DagNode::DagNode( const std::string &n ) : Parallelizable(),
     prior_only( false ),
     touched_elements(),
     ref_count( 0 ),
-    visit_flags( std::vector<bool>(5, false) )
+    visit_flags( std::vector<bool>(5, false) ),
+    propagation_order(),
+    propagation_order_version( 0 ),
+    keep_stamp( 0 ),
+    restore_stamp( 0 )
 {
 
 }
@@ -50,7 +67,11 @@ DagNode::DagNode( const DagNode &n ) : Parallelizable( n ),
     prior_only( n.prior_only ),
     touched_elements( n.touched_elements ),
     ref_count( 0 ),
-    visit_flags( n.visit_flags )
+    visit_flags( n.visit_flags ),
+    propagation_order(),
+    propagation_order_version( 0 ),
+    keep_stamp( 0 ),
+    restore_stamp( 0 )
 {
 
 }
@@ -116,6 +137,7 @@ void DagNode::addChild(DagNode *child) const
         if ( pos == children.end() )
         {
             children.push_back( child );
+            ++dag_structure_version;
         }
 
     }
@@ -178,22 +200,25 @@ void DagNode::addTouchedElementIndex(size_t i)
 }
 
 
+/**
+ * Clear the designated flag from this node and all descendants that were reached through flagged nodes.
+ * This is called after every keep and restore, i.e., after every move, so we clear the flags while
+ * we walk down instead of collecting the descendants in a set first.
+ * A node whose flag is already cleared has been visited, so every node is visited at most once.
+ */
 void DagNode::clearVisitFlag( const size_t& flagType )
 {
 
-    RbOrderedSet<DagNode*> descendants;
-    findUniqueDescendantsWithFlag(descendants, flagType);
+    visit_flags[flagType] = false;
 
-    // Clear the designated flagType from all descedants (including node calling this)
-    // Also clear the flags we just flagged to keep descedant searching fast
-    for (auto d: descendants)
+    for (auto child: children)
     {
-        d->visit_flags[FIND_FLAG] = false;
-        d->visit_flags[flagType] = false;
+        if ( child->visit_flags[flagType] == true )
+        {
+            child->clearVisitFlag( flagType );
+        }
     }
 
-
-    return;
 }
 
 
@@ -230,6 +255,59 @@ DagNode* DagNode::cloneDownstreamDag( std::map<const DagNode*, DagNode* >& newNo
 }
 
 
+/**
+ * Compute the order in which touch, keep and restore reach the descendants of this node.
+ * The calls pass through deterministic nodes to their children and stop at all other nodes.
+ * We visit the reached nodes in a depth-first search without recursion and sort them topologically,
+ * i.e., every node comes after all its reached parents. Then we list for each reached node, in this order,
+ * its children together with the node itself as the parent that passes on the call.
+ * Hence a node appears once per reached parent, and after the entries of all its parents.
+ */
+void DagNode::computePropagationOrder( void ) const
+{
+
+    std::set<const DagNode*> visited;
+    visited.insert( this );
+
+    // the reached deterministic nodes, each after all its descendants
+    std::vector<const DagNode*> post_order;
+    std::vector<std::pair<const DagNode*, size_t> > stack( 1, std::make_pair( this, size_t(0) ) );
+    while ( stack.empty() == false )
+    {
+        const DagNode *n = stack.back().first;
+        size_t i = stack.back().second;
+        if ( i < n->children.size() )
+        {
+            ++stack.back().second;
+
+            DagNode *child = n->children[i];
+            if ( child->type == DETERMINISTIC && visited.insert( child ).second == true )
+            {
+                stack.push_back( std::make_pair( child, size_t(0) ) );
+            }
+        }
+        else
+        {
+            post_order.push_back( n );
+            stack.pop_back();
+        }
+    }
+
+    propagation_order.clear();
+    for (std::vector<const DagNode*>::reverse_iterator it = post_order.rbegin(); it != post_order.rend(); ++it)
+    {
+        const std::vector<DagNode*> &c = (*it)->children;
+        for (size_t i = 0; i < c.size(); ++i)
+        {
+            propagation_order.push_back( std::make_pair( c[i], const_cast<DagNode*>( *it ) ) );
+        }
+    }
+
+    propagation_order_version = dag_structure_version;
+
+}
+
+
 /**
  * Decrement the reference count and return it.
  */
@@ -356,6 +434,26 @@ Distribution& DagNode::getDistribution( void )
 }
 
 
+/**
+ * Get the gradient of the ln probability of this node with respect to the node p.
+ * Only stochastic nodes have a probability and thus we return false, i.e., there is no gradient available.
+ */
+bool DagNode::getLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+    return false;
+}
+
+
+/**
+ * Propagate the gradient (adjoint) with respect to the value of this node back to the parent p.
+ * Only deterministic nodes can compute this from their function and thus we return false here.
+ */
+bool DagNode::getVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+    return false;
+}
+
+
 /**
  * Get the first child of this node.
  * Here we simply return a pointer to the first element stored in the set of children.
@@ -418,6 +516,22 @@ std::vector<const DagNode*> DagNode::getParents( void ) const
 }
 
 
+/**
+ * Get the nodes reached by touch, keep and restore of this node, each with the parent that passes on the call.
+ * The order is computed once for the current structure of the DAG and recomputed after any child was added or removed.
+ */
+const std::vector<std::pair<DagNode*, DagNode*> >& DagNode::getPropagationOrder( void ) const
+{
+
+    if ( propagation_order_version != dag_structure_version )
+    {
+        computePropagationOrder();
+    }
+
+    return propagation_order;
+}
+
+
 /**
  * Get the printable children by filling the set of DAG nodes with the printable children.
  * This method will skip hidden variables and instead replace the hidden variables by their children,
@@ -591,6 +705,13 @@ bool DagNode::isHidden( void ) const
 }
 
 
+bool DagNode::isPriorOnly( void ) const
+{
+
+    return prior_only;
+}
+
+
 /**
  * Is this variable a simple numeric variable?
  * This is asked for example by the model monitor that only wants to monitor simple numeric variable
@@ -614,32 +735,33 @@ bool DagNode::isStochastic( void ) const
 void DagNode::keep(void)
 {
 
+    keep_stamp = next_visit_stamp++;
+
     // keep myself first
     keepMe( this );
 
     // next, keep all my children
     keepAffected();
 
-    // clear visit flags
-    const size_t &flag_type = KEEP_FLAG;
-    clearVisitFlag(flag_type);
-
 }
 
 
 /**
  * Tell affected variable nodes to keep the current value.
+ * We walk through the propagation order, and a node that several parents reach is kept only once per keep().
+ * Distributions may call this for their own node while it is kept, then the nodes get the stamp of that keep().
  */
 void DagNode::keepAffected()
 {
-    visit_flags[KEEP_FLAG] = true;
 
-    // keep all my children
-    for (auto child: children)
+    const std::vector<std::pair<DagNode*, DagNode*> > &order = getPropagationOrder();
+    for (size_t i = 0; i < order.size(); ++i)
     {
-        if (child->visit_flags[KEEP_FLAG] == false)
+        DagNode *n = order[i].first;
+        if ( n->keep_stamp != keep_stamp )
         {
-            child->keepMe( this );
+            n->keep_stamp = keep_stamp;
+            n->keepMe( order[i].second );
         }
     }
 
@@ -847,6 +969,7 @@ void DagNode::removeChild(DagNode *child) const
     if ( it != children.end() )
     {
         children.erase( it );
+        ++dag_structure_version;
 
         // we do not own our children! See addChildNode for explanation
 
@@ -933,42 +1056,41 @@ void DagNode::replace( DagNode *n )
 
 /**
  * Restore this DAGNode.
- * This means we call restoreMe() and restoreAffected(). There is a default implementation of restoreAffected()
- * which call restoreMe() of all children of this node. restoreMe() is pure virtual.
+ * This means we call restoreMe() and restoreAffected(), which calls restoreMe() of the affected nodes.
+ * restoreMe() is pure virtual.
  */
 void DagNode::restore(void)
 {
 
+    restore_stamp = next_visit_stamp++;
+
     // first restore myself
     restoreMe( this );
 
     // next, restore all my children
     restoreAffected();
 
-    // clear visit flags
-    const size_t &flag_type = RESTORE_FLAG;
-    clearVisitFlag(flag_type);
-
 }
 
 
 /**
  * Restore all affected nodes this DAGNode.
- * This means we call restoreMe() of all children. restoreMe() is pure virtual.
+ * This means we call restoreMe() of the nodes in the propagation order, once per node and restore().
  */
 void DagNode::restoreAffected(void)
 {
 
-    visit_flags[RESTORE_FLAG] = true;
-
-    // keep all my children
-    for (auto child: children)
+    const std::vector<std::pair<DagNode*, DagNode*> > &order = getPropagationOrder();
+    for (size_t i = 0; i < order.size(); ++i)
     {
-        if (child->visit_flags[RESTORE_FLAG] == false)
+        DagNode *n = order[i].first;
+        if ( n->restore_stamp != restore_stamp )
         {
-            child->restoreMe( this );
+            n->restore_stamp = restore_stamp;
+            n->restoreMe( order[i].second );
         }
     }
+
 }
 
 
@@ -1055,12 +1177,36 @@ void DagNode::touch(bool touchAll)
 
 /**
  * Tell affected variable nodes to touch themselves (i.e. that they've been touched).
+ * A node is touched once by each of its parents in the propagation order, so that functions learn all touched parameters.
  */
 void DagNode::touchAffected(bool touchAll)
 {
-    // touch all my children
-    for (auto child: children)
+
+    const std::vector<std::pair<DagNode*, DagNode*> > &order = getPropagationOrder();
+    for (size_t i = 0; i < order.size(); ++i)
     {
-        child->touchMe( this, touchAll );
+        order[i].first->touchMe( order[i].second, touchAll );
     }
+
+}
+
+
+/**
+ * Prepare the concurrent computation of the ln probability.
+ * Only stochastic nodes have a ln probability, so there is nothing to do here.
+ */
+void DagNode::prepareLnProbability(void)
+{
+
+}
+
+
+/**
+ * Bring the value up to date if it is computed lazily.
+ * Only deterministic nodes compute their value lazily, so there is nothing to do here.
+ * Calling this before reading the value from several threads makes sure that the value isn't computed concurrently.
+ */
+void DagNode::updateValue(void) const
+{
+
 }
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <map>
 #include <set>
+#include <utility>
 #include <vector>
 #include <iosfwd>
 
@@ -72,14 +73,17 @@ template <class valueType> class RbOrderedSet;
         DagNodeTypes                                                getDagNodeType(void) const;
         virtual Distribution&                                       getDistribution(void);
         virtual const Distribution&                                 getDistribution(void) const;
+        virtual bool                                                getLnProbabilityGradient(const DagNode *p, std::vector<double> &g);                         //!< Get the gradient of the ln probability with respect to the parent (or this node), if available
         DagNode*                                                    getFirstChild(void) const;                                                                  //!< Get the first child from a our set
         const std::vector<Monitor*>&                                getMonitors(void) const;                                                                    //!< Get the set of monitors
         const std::vector<Move*>&                                   getMoves(void) const;                                                                       //!< Get the set of moves
         const std::string&                                          getName(void) const;                                                                        //!< Get the of the node
         size_t                                                      getNumberOfChildren(void) const;                                                            //!< Get the number of children for this node
         virtual std::vector<const DagNode*>                         getParents(void) const;                                                                     //!< Get the set of parents (empty set here)
+        const std::vector<std::pair<DagNode*, DagNode*> >&          getPropagationOrder(void) const;                                                            //!< The nodes reached by touch, keep and restore with their parent, in topological order
         size_t                                                      getReferenceCount(void) const;                                                              //!< Get the reference count for reference counting in smart pointers
         const std::set<size_t>&                                     getTouchedElementIndices(void) const;                                                       //!< Get the indices of the touches elements. If the set is empty, then all elements might have changed.
+        virtual bool                                                getVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);  //!< Propagate the gradient with respect to this value back to the parent p, if available
         bool                                                        getVisitFlag(const size_t flagType) const;
         void                                                        incrementReferenceCount(void) const;                                                        //!< Increment the reference count for reference counting in smart pointers
         void                                                        initiateGetAffectedNodes(RbOrderedSet<DagNode *>& affected);                                        //!< get affected nodes
@@ -89,11 +93,13 @@ template <class valueType> class RbOrderedSet;
         virtual bool                                                isConstant(void) const;                                                                     //!< Is this DAG node constant?
         virtual bool                                                isElementVariable(void) const;                                                              //!< Is this DAG node hidden from the autogenerated graphviz model graph? (true for Element-lookup and Type-converter nodes)
         virtual bool                                                isHidden(void) const;                                                                       //!< Is this DAG node hidden from the autogenerated graphviz model graph? (true for Element-lookup and Type-converter nodes)
+        bool                                                        isPriorOnly(void) const;                                                                    //!< Do we only want the probability of the prior?
         virtual bool                                                isSimpleNumeric(void) const;                                                                //!< Is this variable a simple numeric variable? Currently only integer and real number are.
         virtual bool                                                isStochastic(void) const;                                                                   //!< Is this DAG node stochastic?
         void                                                        keep(void);
         virtual void                                                keepAffected(void);                                                                         //!< Keep value of affected nodes
         void                                                        keepVector(std::vector<DagNode *>& nodes);
+        virtual void                                                prepareLnProbability(void);                                                                 //!< Bring shared state up to date before the ln probability is computed concurrently (only stochastic nodes have one)
         virtual void                                                reInitialized(void);                                                                        //!< The DAG was re-initialized so maybe you want to reset some stuff
         virtual void                                                reInitializeAffected(void);                                                                 //!< The DAG was re-initialized so maybe you want to reset some stuff
         virtual void                                                reInitializeMe(void);                                                                       //!< The DAG was re-initialized so maybe you want to reset some stuff
@@ -114,6 +120,7 @@ template <class valueType> class RbOrderedSet;
         virtual void                                                swapParent(const DagNode *oldP, const DagNode *newP);                                       //!< Exchange the parent node which includes setting myself as a child of the new parent and removing myself from my old parents children list
         void                                                        touch(bool touchAll=false);
         virtual void                                                touchAffected(bool touchAll=false);                                                         //!< Touch affected nodes (flag for recalculation)
+        virtual void                                                updateValue(void) const;                                                                    //!< Bring a lazily computed value up to date (only deterministic nodes compute lazily)
 
     protected:
                                                                     DagNode(const std::string &n);                                                              //!< Constructor
@@ -146,8 +153,14 @@ template <class valueType> class RbOrderedSet;
 
     private:
 
+        void                                                        computePropagationOrder(void) const;                                                        //!< Recompute the propagation order for the current DAG structure
+
         mutable size_t                                              ref_count;
         std::vector<bool>                                           visit_flags; // in order: affected, find, keep, reinitialize, restore
+        mutable std::vector<std::pair<DagNode*, DagNode*> >         propagation_order;                                                                          //!< Pairs of a node and the parent passing on the call, in topological order
+        mutable size_t                                              propagation_order_version;                                                                  //!< The version of the DAG structure of the propagation order
+        size_t                                                      keep_stamp;                                                                                 //!< The stamp of the last keep() that reached this node
+        size_t                                                      restore_stamp;                                                                              //!< The stamp of the last restore() that reached this node
     };
 
 }
@@ -25,6 +25,7 @@ namespace RevBayesCore {
         double                                              getLnProbabilityRatio(void);
         valueType&                                          getValue(void);
         const valueType&                                    getValue(void) const;
+        virtual bool                                        getVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);  //!< Propagate the gradient back to the parent p (delegate to the function)
         bool                                                isConstant(void) const;                                                     //!< Is this DAG node constant?
         virtual void                                        printStructureInfo(std::ostream &o, bool verbose=false) const;              //!< Print the structural information (e.g. name, value-type, distribution/function, children, parents, etc.)
         void                                                redraw(void);
@@ -32,6 +33,7 @@ namespace RevBayesCore {
         void                                                setMcmcMode(bool tf);                                                       //!< Set the modus of the DAG node to MCMC mode.
         void                                                setValueFromFile(const std::string &dir);                                   //!< Set value from string.
         void                                                setValueFromString(const std::string &v);                                   //!< Set value from string.
+        void                                                updateValue(void) const;                                                    //!< Compute the value now if it needs an update
 
         // Parent DAG nodes management functions
         virtual std::vector<const DagNode*>                 getParents(void) const;                                                     //!< Get the set of parents
@@ -282,6 +284,20 @@ const valueType& RevBayesCore::DeterministicNode<valueType>::getValue( void ) co
 }
 
 
+/**
+ * Propagate the gradient with respect to our value back to the parent p.
+ * We make sure that the value is up-to-date, because the function may use it, and then delegate to the function.
+ */
+template<class valueType>
+bool RevBayesCore::DeterministicNode<valueType>::getVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    getValue();
+
+    return function->computeVectorJacobianProduct(p, adjoint, g);
+}
+
+
 template<class valueType>
 bool RevBayesCore::DeterministicNode<valueType>::isConstant( void ) const
 {
@@ -302,7 +318,7 @@ bool RevBayesCore::DeterministicNode<valueType>::isConstant( void ) const
 
 /**
  * Keep the current value of the node.
- * At this point, we just delegate to the children.
+ * The node that started the keep passes it on to our children (see DagNode::keepAffected).
  */
 template<class valueType>
 void RevBayesCore::DeterministicNode<valueType>::keepMe( DagNode* affecter )
@@ -315,9 +331,6 @@ void RevBayesCore::DeterministicNode<valueType>::keepMe( DagNode* affecter )
     // allow specialized recovery in functions
     function->keep( affecter );
 
-    // delegate call
-    this->keepAffected();
-
     // clear the list of touched element indices
     this->touched_elements.clear();
 
@@ -388,9 +401,6 @@ void RevBayesCore::DeterministicNode<valueType>::restoreMe( DagNode *restorer )
     // clear the list of touched element indices
     this->touched_elements.clear();
 
-    // delegate call
-    this->restoreAffected();
-
 }
 
 
@@ -460,11 +470,6 @@ template<class valueType>
 void RevBayesCore::DeterministicNode<valueType>::touchMe( DagNode *toucher, bool touchAll )
 {
 
-    // store if the state of the variable was dirty (needed an update)
-    bool needed_update = needs_update;
-    bool was_touched = this->touched;
-
-
     // delegate call to base class
     // this will set the touched flag if it wasn't set already
     DynamicNode<valueType>::touchMe( toucher, touchAll );
@@ -480,12 +485,19 @@ void RevBayesCore::DeterministicNode<valueType>::touchMe( DagNode *toucher, bool
     // mark for update
     needs_update = true;
 
-    // only if this function did not need an update we delegate the touch affected
-    if ( needed_update == false || was_touched == false || true )
-    {
-        // Dispatch the touch message to downstream nodes
-        this->touchAffected( touchAll );
-    }
+    // the node that started the touch dispatches it to the downstream nodes (see DagNode::touchAffected)
+
+}
+
+
+/**
+ * Compute the value now if it needs an update, so that later reads from several threads don't trigger the lazy evaluation concurrently.
+ */
+template<class valueType>
+void RevBayesCore::DeterministicNode<valueType>::updateValue( void ) const
+{
+
+    getValue();
 
 }
 
@@ -0,0 +1,157 @@
+#include "LnProbabilityEvaluator.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "DagNode.h"
+#include "RbMathLogic.h"
+#include "ThreadPool.h"
+
+using namespace RevBayesCore;
+
+
+LnProbabilityEvaluator::LnProbabilityEvaluator( void ) :
+    min_task_cost( 2E-5 )
+{
+
+}
+
+
+/**
+ * Compute the ln probabilities (or the ln probability ratios if ratio is true) of the nodes.
+ * The cheap nodes are computed first and in the order of the nodes. If stop_early is true, we stop as soon
+ * as one of them has a non-computable ln probability, e.g., because a parameter is out of its bounds,
+ * and don't compute the (expensive) rest at all.
+ *
+ * \param[in]    n              The nodes.
+ * \param[in]    ratio          Compute the ln probability ratios instead of the ln probabilities?
+ * \param[in]    stop_early     Stop at the first non-computable ln probability?
+ * \param[out]   ln_probs       The ln probability of each node (0 for the nodes we didn't compute).
+ *
+ * \return False if we stopped early.
+ */
+bool LnProbabilityEvaluator::computeLnProbabilities(const std::vector<DagNode*> &n, bool ratio, bool stop_early, std::vector<double> &ln_probs)
+{
+
+    // before we measured a node, we guess that only clamped nodes (the likelihoods) are expensive
+    if ( n != nodes )
+    {
+        nodes = n;
+        costs.resize( nodes.size() );
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            costs[i] = ( nodes[i]->isClamped() == true ? min_task_cost : -1.0 );
+        }
+    }
+    ln_probs.assign( nodes.size(), 0.0 );
+
+    ThreadPool &pool = ThreadPool::globalThreadPool();
+    size_t num_threads = pool.getNumberOfThreads();
+    bool measure = ( num_threads > 1 );
+
+    cheap_nodes.clear();
+    expensive_nodes.clear();
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        if ( num_threads > 1 && costs[i] >= min_task_cost )
+        {
+            expensive_nodes.push_back( i );
+        }
+        else
+        {
+            cheap_nodes.push_back( i );
+        }
+    }
+
+    // a single expensive node is computed in this thread (it may still use the thread pool itself)
+    if ( expensive_nodes.size() < 2 )
+    {
+        cheap_nodes.insert( cheap_nodes.end(), expensive_nodes.begin(), expensive_nodes.end() );
+        std::sort( cheap_nodes.begin(), cheap_nodes.end() );
+        expensive_nodes.clear();
+    }
+
+    for (size_t k = 0; k < cheap_nodes.size(); ++k)
+    {
+        size_t i = cheap_nodes[k];
+        ln_probs[i] = computeLnProbability( i, ratio, measure );
+        if ( stop_early == true && RbMath::isAComputableNumber( ln_probs[i] ) == false )
+        {
+            return false;
+        }
+    }
+
+    if ( expensive_nodes.empty() == true )
+    {
+        return true;
+    }
+
+    // compute the values that the expensive nodes share and prepare their shared state now and in this thread
+    for (size_t k = 0; k < expensive_nodes.size(); ++k)
+    {
+        std::vector<const DagNode*> parents = nodes[ expensive_nodes[k] ]->getParents();
+        for (size_t j = 0; j < parents.size(); ++j)
+        {
+            parents[j]->updateValue();
+        }
+        nodes[ expensive_nodes[k] ]->prepareLnProbability();
+    }
+
+    // the most expensive node goes to the group with the smallest total cost
+    std::stable_sort( expensive_nodes.begin(), expensive_nodes.end(), [this](size_t a, size_t b) { return costs[a] > costs[b]; } );
+    size_t num_groups = std::min( num_threads, expensive_nodes.size() );
+    groups.resize( num_groups );
+    group_costs.assign( num_groups, 0.0 );
+    for (size_t g = 0; g < num_groups; ++g)
+    {
+        groups[g].clear();
+    }
+    for (size_t k = 0; k < expensive_nodes.size(); ++k)
+    {
+        size_t g = std::min_element( group_costs.begin(), group_costs.end() ) - group_costs.begin();
+        groups[g].push_back( expensive_nodes[k] );
+        group_costs[g] += costs[ expensive_nodes[k] ];
+    }
+
+    // the first group is computed by this thread while it waits for the others
+    TaskGroup tasks( pool );
+    for (size_t g = 1; g < num_groups; ++g)
+    {
+        tasks.run( [this, g, ratio, measure, &ln_probs]()
+        {
+            for (size_t k = 0; k < groups[g].size(); ++k)
+            {
+                ln_probs[ groups[g][k] ] = computeLnProbability( groups[g][k], ratio, measure );
+            }
+        } );
+    }
+    for (size_t k = 0; k < groups[0].size(); ++k)
+    {
+        ln_probs[ groups[0][k] ] = computeLnProbability( groups[0][k], ratio, measure );
+    }
+    tasks.wait();
+
+    return true;
+}
+
+
+/**
+ * Compute the ln probability (ratio) of the i-th node and, if we measure, update its cost.
+ * The cost is a running average of the measured times, so that a single slow evaluation doesn't dominate.
+ */
+double LnProbabilityEvaluator::computeLnProbability(size_t i, bool ratio, bool measure)
+{
+
+    if ( measure == false )
+    {
+        return ( ratio == true ? nodes[i]->getLnProbabilityRatio() : nodes[i]->getLnProbability() );
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double ln_prob = ( ratio == true ? nodes[i]->getLnProbabilityRatio() : nodes[i]->getLnProbability() );
+    double time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    costs[i] = ( costs[i] < 0.0 ? time : 0.5 * (costs[i] + time) );
+
+    return ln_prob;
+}
@@ -0,0 +1,59 @@
+#ifndef LnProbabilityEvaluator_H
+#define LnProbabilityEvaluator_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class DagNode;
+
+    /**
+     * @brief Evaluation of the ln probabilities of a set of DAG nodes using the thread pool.
+     *
+     * The ln probabilities (or ln probability ratios) of independent stochastic nodes, e.g., the nodes affected by a move
+     * or all nodes of a model, can be computed concurrently.
+     * Most nodes are cheap (a prior on a single parameter) and are not worth a task, while a few are expensive (a likelihood).
+     * Hence we measure the time each node needs and use this as the cost of the node for the next evaluation of the same nodes.
+     * Before the first measurement, only clamped nodes (usually the likelihoods) are assumed to be expensive.
+     * The cheap nodes are computed first in the calling thread.
+     * If at least two nodes are expensive, these are distributed over as many groups as there are threads,
+     * always adding the next most expensive node to the group with the smallest total cost,
+     * and every group is computed by one task. Otherwise all nodes are computed in the calling thread.
+     *
+     * Before the expensive nodes are computed concurrently, the values of their parents are brought up to date
+     * (see DagNode::updateValue), so that deterministic nodes shared by several of them are not computed concurrently,
+     * and the nodes prepare shared state they would otherwise initialize lazily (see Distribution::prepareLnProbability).
+     * With a single thread, nothing is computed concurrently and we don't measure the nodes.
+     * The nodes must be distinct and must not draw random numbers when computing their probability.
+     * The ln probabilities are returned per node, so that the caller can sum them in a fixed order and
+     * the result doesn't depend on the number of threads.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class LnProbabilityEvaluator {
+
+    public:
+        LnProbabilityEvaluator(void);                                                                                   //!< Default constructor
+
+        bool                                    computeLnProbabilities(const std::vector<DagNode*> &n, bool ratio, bool stop_early, std::vector<double> &ln_probs);  //!< Compute the ln probabilities (or ratios) of the nodes
+
+    private:
+
+        double                                  computeLnProbability(size_t i, bool ratio, bool measure);               //!< Compute (and time) the ln probability of the i-th node
+
+        std::vector<DagNode*>                   nodes;                                                                  //!< The nodes of the last evaluation
+        double                                  min_task_cost;                                                          //!< Nodes below this time in seconds are not worth a task of their own
+        std::vector<double>                     costs;                                                                  //!< The measured time per node in seconds (negative if unknown)
+        std::vector<size_t>                     cheap_nodes;                                                            //!< Work space for the indices of the cheap nodes
+        std::vector<size_t>                     expensive_nodes;                                                        //!< Work space for the indices of the expensive nodes
+        std::vector<std::vector<size_t> >       groups;                                                                 //!< Work space for the indices of the expensive nodes per task
+        std::vector<double>                     group_costs;                                                            //!< Work space for the total cost per task
+
+    };
+
+}
+
+#endif
@@ -31,11 +31,13 @@ namespace RevBayesCore {
         virtual TypedDistribution<valueType>&               getDistribution(void);
         virtual const TypedDistribution<valueType>&         getDistribution(void) const;
         virtual double                                      getLnProbability(void);
+        virtual bool                                        getLnProbabilityGradient(const DagNode *p, std::vector<double> &g);        //!< Get the gradient of the ln probability from the distribution
         virtual double                                      getLnProbabilityRatio(void);
         valueType&                                          getValue(void);
         const valueType&                                    getValue(void) const;
         bool                                                isClamped(void) const;                                                      //!< Is this DAG node clamped?
         bool                                                isStochastic(void) const;                                                   //!< Is this DAG node stochastic?
+        virtual void                                        prepareLnProbability(void);                                                 //!< Prepare the concurrent computation of the ln probability (delegate to distribution)
         virtual void                                        printStructureInfo(std::ostream &o, bool verbose=false) const;              //!< Print the structural information (e.g. name, value-type, distribution/function, children, parents, etc.)
         void                                                redraw(void);                                                               //!< Redraw the current value of the node (applies only to stochastic nodes)
         virtual void                                        reInitializeMe(void);                                                       //!< The DAG was re-initialized so maybe you want to reset some stuff (delegate to distribution)
@@ -57,6 +59,7 @@ namespace RevBayesCore {
         virtual void                                        keepMe(DagNode* affecter);                                                  //!< Keep value of this and affected nodes
         virtual void                                        restoreMe(DagNode *restorer);                                               //!< Restore value of this nodes
         virtual void                                        setActivePIDSpecialized(size_t i, size_t n);                                          //!< Set the number of processes for this class.
+        virtual void                                        setNumberOfThreadsSpecialized(size_t n);                                              //!< Set the number of threads for this class.
         virtual void                                        touchMe(DagNode *toucher, bool touchAll);                                   //!< Tell affected nodes value is reset
         
         // protected members
@@ -71,6 +74,9 @@ namespace RevBayesCore {
 }
 
 
+#include <algorithm>
+
+#include "Profiler.h"
 #include "RbConstants.h"
 #include "RbOptions.h"
 #include "RbMathLogic.h"
@@ -287,6 +293,7 @@ double RevBayesCore::StochasticNode<valueType>::getLnProbability( void )
         // compute and store log-probability
         if ( this->prior_only == false || this->clamped == false )
         {
+            Profiler::Timer timer( Profiler::VARIABLE, this->name.c_str() );
             lnProb = distribution->computeLnProbability();
         }
         else
@@ -302,6 +309,25 @@ double RevBayesCore::StochasticNode<valueType>::getLnProbability( void )
 }
 
 
+/**
+ * Get the gradient of the ln probability with respect to the node p (a parameter or this node).
+ * We delegate to the distribution. If we only sample from the prior, clamped nodes contribute nothing.
+ */
+template<class valueType>
+bool RevBayesCore::StochasticNode<valueType>::getLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+    
+    bool available = distribution->computeLnProbabilityGradient(p, g);
+    
+    if ( available == true && this->prior_only == true && this->clamped == true )
+    {
+        std::fill(g.begin(), g.end(), 0.0);
+    }
+    
+    return available;
+}
+
+
 template<class valueType>
 double RevBayesCore::StochasticNode<valueType>::getLnProbabilityRatio( void )
 {
@@ -439,6 +465,15 @@ void RevBayesCore::StochasticNode<valueType>::redraw( void )
 }
 
 
+template<class valueType>
+void RevBayesCore::StochasticNode<valueType>::prepareLnProbability( void )
+{
+    
+    distribution->prepareLnProbability();
+    
+}
+
+
 template<class valueType>
 void RevBayesCore::StochasticNode<valueType>::reInitializeMe( void )
 {
@@ -490,6 +525,22 @@ void RevBayesCore::StochasticNode<valueType>::setActivePIDSpecialized(size_t a,
 }
 
 
+/**
+ * Set the number of threads of this specific DAG node object.
+ * The distribution, e.g., a phylogenetic CTMC, uses the threads to compute its likelihood.
+ */
+template <class valueType>
+void RevBayesCore::StochasticNode<valueType>::setNumberOfThreadsSpecialized(size_t n)
+{
+    
+    if ( distribution != NULL )
+    {
+        distribution->setNumberOfThreads( this->num_threads );
+    }
+    
+}
+
+
 /**
  * Set directly the flag whether this node is clamped.
  * The caller needs to be responsible enough to know that we will assume
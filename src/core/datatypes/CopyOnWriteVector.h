@@ -0,0 +1,160 @@
+#ifndef CopyOnWriteVector_H
+#define CopyOnWriteVector_H
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Vector whose elements are shared between copies until one of them is changed.
+     *
+     * Copying a copy-on-write vector only copies a reference-counted pointer to the elements.
+     * The const interface reads the shared elements, while modify() first makes a private copy of the elements
+     * if they are shared with another vector.
+     * Hence, read-only data such as clamped character data and the compressed site patterns of a likelihood
+     * exist only once, no matter how often the model holding them is cloned (replicates, heated chains, stones, ...).
+     *
+     * The reference count is thread-safe, so copies may be used and changed in different threads.
+     * The vector returned by modify() must only be used right away and not be kept.
+     * A reference to a single element, obtained from modify(i), may be kept like a reference into a std::vector.
+     * To make this safe, a vector that handed out such a reference never shares its elements with later copies,
+     * so that a write through the reference can neither reach a copy nor be lost to a private copy made later.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    template <class valueType>
+    class CopyOnWriteVector {
+
+    public:
+        typedef typename std::vector<valueType>::const_iterator         const_iterator;
+        typedef typename std::vector<valueType>::const_reference        const_reference;
+
+        CopyOnWriteVector(void) : elements( new std::vector<valueType>() ), shareable( true ) {}                        //!< Empty vector
+        CopyOnWriteVector(const std::vector<valueType> &v) : elements( new std::vector<valueType>(v) ), shareable( true ) {}   //!< Copy of the elements of v
+        CopyOnWriteVector(const CopyOnWriteVector &v);                                                                  //!< Share the elements of v (if allowed)
+
+        CopyOnWriteVector&                      operator=(const CopyOnWriteVector &v);                                  //!< Share the elements of v (if allowed)
+        CopyOnWriteVector&                      operator=(const std::vector<valueType> &v);                             //!< Replace the elements
+        CopyOnWriteVector&                      operator=(std::vector<valueType> &&v);                                  //!< Replace the elements (without copying them)
+        const_reference                         operator[](size_t i) const              { return (*elements)[i]; }
+
+        const_iterator                          begin(void) const                       { return elements->begin(); }
+        void                                    clear(void);                                                            //!< Remove all elements (without copying them first)
+        bool                                    empty(void) const                       { return elements->empty(); }
+        const_iterator                          end(void) const                         { return elements->end(); }
+        const std::vector<valueType>&           getValue(void) const                    { return *elements; }
+        bool                                    isShared(void) const                    { return elements.use_count() > 1; }
+        std::vector<valueType>&                 modify(void);                                                           //!< Get the elements for changing them right away (copying them first if shared)
+        valueType&                              modify(size_t i);                                                       //!< Get a lasting reference to the i-th element (stops sharing)
+        size_t                                  size(void) const                        { return elements->size(); }
+
+    private:
+
+        std::shared_ptr<std::vector<valueType> > elements;
+        bool                                    shareable;                                                              //!< May copies share the elements, i.e., did we never hand out a reference to an element?
+    };
+
+}
+
+
+template <class valueType>
+RevBayesCore::CopyOnWriteVector<valueType>::CopyOnWriteVector(const CopyOnWriteVector<valueType> &v) :
+    elements( v.shareable == true ? v.elements : std::shared_ptr<std::vector<valueType> >( new std::vector<valueType>( *v.elements ) ) ),
+    shareable( true )
+{
+
+}
+
+
+template <class valueType>
+RevBayesCore::CopyOnWriteVector<valueType>& RevBayesCore::CopyOnWriteVector<valueType>::operator=(const CopyOnWriteVector<valueType> &v)
+{
+
+    if ( this != &v )
+    {
+        elements  = ( v.shareable == true ? v.elements : std::shared_ptr<std::vector<valueType> >( new std::vector<valueType>( *v.elements ) ) );
+        shareable = true;
+    }
+
+    return *this;
+}
+
+
+template <class valueType>
+RevBayesCore::CopyOnWriteVector<valueType>& RevBayesCore::CopyOnWriteVector<valueType>::operator=(const std::vector<valueType> &v)
+{
+
+    // we may not overwrite elements that other vectors are still using
+    if ( isShared() == true )
+    {
+        elements = std::shared_ptr<std::vector<valueType> >( new std::vector<valueType>(v) );
+    }
+    else
+    {
+        *elements = v;
+    }
+
+    return *this;
+}
+
+
+template <class valueType>
+RevBayesCore::CopyOnWriteVector<valueType>& RevBayesCore::CopyOnWriteVector<valueType>::operator=(std::vector<valueType> &&v)
+{
+
+    // we may not overwrite elements that other vectors are still using
+    if ( isShared() == true )
+    {
+        elements = std::shared_ptr<std::vector<valueType> >( new std::vector<valueType>() );
+    }
+    elements->swap( v );
+
+    return *this;
+}
+
+
+template <class valueType>
+void RevBayesCore::CopyOnWriteVector<valueType>::clear( void )
+{
+
+    if ( isShared() == true )
+    {
+        elements = std::shared_ptr<std::vector<valueType> >( new std::vector<valueType>() );
+    }
+    else
+    {
+        elements->clear();
+    }
+
+}
+
+
+template <class valueType>
+std::vector<valueType>& RevBayesCore::CopyOnWriteVector<valueType>::modify( void )
+{
+
+    if ( isShared() == true )
+    {
+        elements = std::shared_ptr<std::vector<valueType> >( new std::vector<valueType>( *elements ) );
+    }
+
+    return *elements;
+}
+
+
+template <class valueType>
+valueType& RevBayesCore::CopyOnWriteVector<valueType>::modify( size_t i )
+{
+
+    std::vector<valueType> &v = modify();
+    shareable = false;
+
+    return v[i];
+}
+
+
+#endif
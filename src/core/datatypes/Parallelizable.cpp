@@ -1,5 +1,6 @@
 #include "Parallelizable.h"
 
+#include "ThreadPool.h"
 
 #ifdef RB_MPI
 #include <mpi.h>
@@ -17,7 +18,8 @@ Parallelizable::Parallelizable() :
     active_PID( 0 ),
     num_processes( 1 ),
     pid( 0 ),
-    process_active( true )
+    process_active( true ),
+    num_threads( 0 )
 {
     
     
@@ -38,7 +40,8 @@ Parallelizable::Parallelizable( const Parallelizable &p ) :
     active_PID( p.active_PID ),
     num_processes( p.num_processes ),
     pid( p.pid ),
-    process_active( p.process_active )
+    process_active( p.process_active ),
+    num_threads( p.num_threads )
 {
     
 }
@@ -57,6 +60,7 @@ Parallelizable& Parallelizable::operator=(const Parallelizable &p)
         num_processes   = p.num_processes;
         pid             = p.pid;
         process_active  = p.process_active;
+        num_threads     = p.num_threads;
     }
     
     // return reference to myself
@@ -80,6 +84,18 @@ size_t Parallelizable::getNumberOfProcesses( void ) const
 }
 
 
+/**
+ * Public method for getting the number of threads this object may use.
+ * We never use more threads than the global thread pool has.
+ */
+size_t Parallelizable::getNumberOfThreads( void ) const
+{
+    size_t available = ThreadPool::globalThreadPool().getNumberOfThreads();
+
+    return ( num_threads == 0 || num_threads > available ? available : num_threads );
+}
+
+
 /**
  * Public method for setting the active PID for this object.
  */
@@ -103,3 +119,26 @@ void Parallelizable::setActivePIDSpecialized(size_t a, size_t n )
     
     // nothing done here.
 }
+
+
+/**
+ * Public method for setting the number of threads for this object.
+ */
+void Parallelizable::setNumberOfThreads(size_t n)
+{
+
+    num_threads = n;
+
+    // delegate call for derived classes
+    setNumberOfThreadsSpecialized( getNumberOfThreads() );
+}
+
+
+/**
+ * Dummy implementation which derived classes can overwrite.
+ */
+void Parallelizable::setNumberOfThreadsSpecialized(size_t n)
+{
+
+    // nothing done here.
+}
@@ -10,6 +10,9 @@ namespace RevBayesCore {
      * Interace for Parallelizable classes.
      *
      * The Parallelizable interface provides a mechanism for code parallelization.
+     * Objects can be distributed among MPI processes (active PID and number of processes),
+     * and, independently, can use several threads of the ThreadPool within their process.
+     * The number of threads defaults to the user setting "numThreads".
      *
      *
      * @copyright Copyright 2009-
@@ -23,7 +26,9 @@ namespace RevBayesCore {
         
         size_t                          getActivePID(void) const;                                               //!< Get the ID of the active process.
         size_t                          getNumberOfProcesses(void) const;                                       //!< Get the ID of the active process.
+        size_t                          getNumberOfThreads(void) const;                                         //!< Get the number of threads this object may use within its process.
         void                            setActivePID(size_t i, size_t n);                                       //!< Set the active process id and the number of processes.
+        void                            setNumberOfThreads(size_t n);                                           //!< Set the number of threads (0 means the user setting).
         
     protected:
         
@@ -36,6 +41,7 @@ namespace RevBayesCore {
         
         // protected methods that derived classes can overwrite
         virtual void                    setActivePIDSpecialized(size_t a, size_t n);                            //!< Set the active PID in a specialized way for derived classes.
+        virtual void                    setNumberOfThreadsSpecialized(size_t n);                                //!< Set the number of threads in a specialized way for derived classes.
         
         
         // protected members available for derived classes
@@ -43,6 +49,7 @@ namespace RevBayesCore {
         int                             num_processes;
         int                             pid;
         bool                            process_active;
+        size_t                          num_threads;                                                            //!< The requested number of threads (0 means the user setting)
         
         
     };
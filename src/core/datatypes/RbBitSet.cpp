@@ -1,5 +1,6 @@
 #include "RbBitSet.h"
 
+#include <functional>
 #include <string>
 #include <sstream> // IWYU pragma: keep
 
@@ -192,6 +193,13 @@ size_t RbBitSet::getNumberSetBits( void ) const
 }
 
 
+size_t RbBitSet::hash( void ) const
+{
+    // delegate to the standard library hash of the underlying bit vector
+    return std::hash< std::vector<bool> >()( value );
+}
+
+
 bool RbBitSet::isSet(size_t i) const
 {
     // get the internal value
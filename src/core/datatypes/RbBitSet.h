@@ -43,6 +43,7 @@ namespace RevBayesCore {
         void                            flip(size_t i);
         size_t                          getNumberSetBits(void) const;                                           //!< Get the number of bits set.
         size_t                          getFirstSetBit(void) const;                                             //!< Get the number of bits set.
+        size_t                          hash(void) const;                                                       //!< Get a hash value of the bits (for unordered containers).
         bool                            isSet(size_t i) const;
         void                            resize(size_t size);
         void                            set(size_t i);
@@ -59,6 +60,13 @@ namespace RevBayesCore {
         
     };
     
+    /**
+     * Hash functor so that bit sets can be used as keys of unordered containers.
+     */
+    struct RbBitSetHash {
+        size_t                          operator()(const RbBitSet &bs) const { return bs.hash(); }
+    };
+
     // Global functions using the class
     std::ostream&                               operator<<(std::ostream& o, const RbBitSet& x);                    //!< Overloaded output operator
     
@@ -2,6 +2,7 @@
 #define DiscreteTaxonData_H
 
 #include "AbstractDiscreteTaxonData.h"
+#include "CopyOnWriteVector.h"
 #include "DiscreteCharacterState.h"
 #include "RbOptions.h"
 
@@ -17,7 +18,7 @@ namespace RevBayesCore {
     public:
                                                         DiscreteTaxonData(const Taxon &t);                                  //!< Set type spec of container from type of elements
 
-        charType&                                       operator[](size_t i);                                               //!< Index op allowing change
+        charType&                                       operator[](size_t i);                                               //!< Index op allowing change (the characters are not shared with later copies anymore)
         const charType&                                 operator[](size_t i) const;                                         //!< Const index op
 
         // implemented methods of the Cloneable interface
@@ -36,7 +37,7 @@ namespace RevBayesCore {
         void                                            concatenate(const AbstractDiscreteTaxonData &d);                    //!< Concatenate sequences
         void                                            concatenate(const DiscreteTaxonData &d);                            //!< Concatenate sequences
         const charType&                                 getCharacter(size_t index) const;                                   //!< Get the character at position index
-        charType&                                       getCharacter(size_t index);                                         //!< Get the character at position index (non-const to return non-const character)
+        charType&                                       getCharacter(size_t index);                                         //!< Get the character at position index (non-const, the characters are not shared with later copies anymore)
         std::string                                     getJsonRepresentation(void) const;
         size_t                                          getNumberOfCharacters(void) const;                                  //!< How many characters
         double                                          getPercentageMissing(void) const;                                   //!< Returns the percentage of missing data for this sequence
@@ -49,8 +50,8 @@ namespace RevBayesCore {
         
     private:
 
-        std::vector<charType>                           sequence;
-        std::vector<bool>                               is_resolved;
+        CopyOnWriteVector<charType>                     sequence;                                                           //!< The characters (shared between copies until changed)
+        CopyOnWriteVector<bool>                         is_resolved;
 
     };
 
@@ -94,7 +95,7 @@ charType& RevBayesCore::DiscreteTaxonData<charType>::operator[](size_t i)
         throw RbException("Index out of bounds");
     }
 
-    return sequence[i];
+    return sequence.modify( i );
 }
 
 
@@ -252,7 +253,8 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::concatenate(const DiscreteTaxonData<charType> &obsd)
 {
 
-    sequence.insert( sequence.end(), obsd.sequence.begin(), obsd.sequence.end() );
+    std::vector<charType> &s = sequence.modify();
+    s.insert( s.end(), obsd.sequence.begin(), obsd.sequence.end() );
 
 }
 
@@ -308,8 +310,8 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::addCharacter( const charType &newChar )
 {
 
-    sequence.push_back( newChar );
-    is_resolved.push_back(true);
+    sequence.modify().push_back( newChar );
+    is_resolved.modify().push_back(true);
 }
 
 
@@ -363,8 +365,8 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::addCharacter( const charType &newChar, bool tf )
 {
 
-    sequence.push_back( newChar );
-    is_resolved.push_back(tf);
+    sequence.modify().push_back( newChar );
+    is_resolved.modify().push_back(tf);
 }
 
 
@@ -382,7 +384,7 @@ charType& RevBayesCore::DiscreteTaxonData<charType>::getCharacter(size_t index)
         throw RbException("Index out of bounds");
     }
 
-    return sequence[index];
+    return sequence.modify( index );
 }
 
 
@@ -566,9 +568,10 @@ template<class charType>
 void RevBayesCore::DiscreteTaxonData<charType>::setAllCharactersMissing( void )
 {
 
-    for (size_t i = 0; i < sequence.size(); ++i)
+    std::vector<charType> &s = sequence.modify();
+    for (size_t i = 0; i < s.size(); ++i)
     {
-        sequence[i].setMissingState( true );
+        s[i].setMissingState( true );
     }
 
 }
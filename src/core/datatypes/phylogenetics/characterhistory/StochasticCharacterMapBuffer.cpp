@@ -0,0 +1,186 @@
+#include "StochasticCharacterMapBuffer.h"
+
+#include <sstream>
+
+#include "RbException.h"
+
+using namespace RevBayesCore;
+
+
+StochasticCharacterMapBuffer::StochasticCharacterMapBuffer(void) :
+    num_nodes( 0 ),
+    root_node( 0 )
+{
+
+}
+
+
+/**
+ * Store the history of a branch. The states and durations are ordered from the parent end of the branch towards the child end.
+ */
+void StochasticCharacterMapBuffer::addBranchHistory(size_t site_idx, size_t node_idx, const std::vector<size_t> &states, const std::vector<double> &durations)
+{
+
+    if ( states.size() != durations.size() || states.empty() == true )
+    {
+        throw RbException("A branch history needs the same (non-zero) number of states and durations.");
+    }
+
+    size_t b = branchIndex( site_idx, node_idx );
+    branch_first_segment[b] = segment_states.size();
+    branch_num_segments[b]  = states.size();
+
+    segment_states.insert( segment_states.end(), states.begin(), states.end() );
+    segment_durations.insert( segment_durations.end(), durations.begin(), durations.end() );
+
+}
+
+
+/**
+ * Store the state of the root as a single segment. The root is written with the label of its state instead of the state index.
+ */
+void StochasticCharacterMapBuffer::addRootHistory(size_t site_idx, size_t node_idx, size_t state, const std::string &label, double duration)
+{
+
+    addBranchHistory( site_idx, node_idx, std::vector<size_t>(1, state), std::vector<double>(1, duration) );
+
+    root_node = node_idx;
+    root_labels[site_idx] = label;
+
+}
+
+
+size_t StochasticCharacterMapBuffer::branchIndex(size_t site_idx, size_t node_idx) const
+{
+
+    if ( site_idx >= sites.size() || node_idx >= num_nodes )
+    {
+        throw RbException("Index out of bounds in stochastic character map.");
+    }
+
+    return site_idx * num_nodes + node_idx;
+}
+
+
+size_t StochasticCharacterMapBuffer::getEndState(size_t site_idx, size_t node_idx) const
+{
+
+    size_t b = branchIndex( site_idx, node_idx );
+
+    return segment_states[ branch_first_segment[b] + branch_num_segments[b] - 1 ];
+}
+
+
+size_t StochasticCharacterMapBuffer::getNumberOfNodes(void) const
+{
+
+    return num_nodes;
+}
+
+
+size_t StochasticCharacterMapBuffer::getNumberOfSegments(size_t site_idx, size_t node_idx) const
+{
+
+    return branch_num_segments[ branchIndex( site_idx, node_idx ) ];
+}
+
+
+size_t StochasticCharacterMapBuffer::getNumberOfSites(void) const
+{
+
+    return sites.size();
+}
+
+
+double StochasticCharacterMapBuffer::getSegmentDuration(size_t site_idx, size_t node_idx, size_t k) const
+{
+
+    return segment_durations[ branch_first_segment[ branchIndex( site_idx, node_idx ) ] + k ];
+}
+
+
+size_t StochasticCharacterMapBuffer::getSegmentState(size_t site_idx, size_t node_idx, size_t k) const
+{
+
+    return segment_states[ branch_first_segment[ branchIndex( site_idx, node_idx ) ] + k ];
+}
+
+
+std::string StochasticCharacterMapBuffer::getSimmapString(size_t site_idx, size_t node_idx, bool use_simmap_default) const
+{
+
+    std::stringstream ss;
+    writeSimmap( ss, site_idx, node_idx, use_simmap_default );
+
+    return ss.str();
+}
+
+
+const std::vector<size_t>& StochasticCharacterMapBuffer::getSites(void) const
+{
+
+    return sites;
+}
+
+
+size_t StochasticCharacterMapBuffer::getStartState(size_t site_idx, size_t node_idx) const
+{
+
+    return segment_states[ branch_first_segment[ branchIndex( site_idx, node_idx ) ] ];
+}
+
+
+/**
+ * Remove all histories but keep the allocated memory for the next draw.
+ */
+void StochasticCharacterMapBuffer::reset(size_t n, const std::vector<size_t> &s)
+{
+
+    num_nodes = n;
+    sites     = s;
+
+    branch_first_segment.assign( num_nodes * sites.size(), 0 );
+    branch_num_segments.assign( num_nodes * sites.size(), 0 );
+    segment_states.clear();
+    segment_durations.clear();
+    root_node = num_nodes;
+    root_labels.assign( sites.size(), "" );
+
+}
+
+
+/**
+ * Write the history of this branch in the format used by SIMMAP and phytools, e.g., {0,0.2:1,0.3}.
+ * By default, SIMMAP lists the segments from the child end of the branch towards the parent end.
+ */
+void StochasticCharacterMapBuffer::writeSimmap(std::ostream &o, size_t site_idx, size_t node_idx, bool use_simmap_default) const
+{
+
+    size_t b     = branchIndex( site_idx, node_idx );
+    size_t first = branch_first_segment[b];
+    size_t n     = branch_num_segments[b];
+
+    std::streamsize previous_precision = o.precision( 6 );
+
+    if ( node_idx == root_node )
+    {
+        o << "{" << root_labels[site_idx] << "," << segment_durations[first] << "}";
+        o.precision( previous_precision );
+        return;
+    }
+
+    o << "{";
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t k = ( use_simmap_default == true ? first + n - 1 - i : first + i );
+        if ( i != 0 )
+        {
+            o << ":";
+        }
+        o << segment_states[k] << "," << segment_durations[k];
+    }
+    o << "}";
+
+    o.precision( previous_precision );
+
+}
@@ -0,0 +1,66 @@
+#ifndef StochasticCharacterMapBuffer_H
+#define StochasticCharacterMapBuffer_H
+
+#include <stddef.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Flat storage for sampled stochastic character maps.
+     *
+     * The buffer holds the character histories of a set of sites along all branches of a tree.
+     * Each history is a sequence of segments (state, duration) ordered from the parent end
+     * of the branch towards the child end. All segments of all branches and sites are stored in
+     * two flat vectors, so that repeated draws reuse the same memory and no strings are
+     * needed until the histories are printed.
+     *
+     * Histories are addressed by the position of the site in the vector of mapped sites
+     * and by the node index of the branch.
+     * The root has no branch history; its state is written with the state label (e.g., "A") as it has always been.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class StochasticCharacterMapBuffer {
+
+    public:
+        StochasticCharacterMapBuffer(void);                                                                                     //!< Default constructor
+
+        // public methods
+        void                                addBranchHistory(size_t site_idx, size_t node_idx, const std::vector<size_t> &states, const std::vector<double> &durations);   //!< Store the history of a branch
+        void                                addRootHistory(size_t site_idx, size_t node_idx, size_t state, const std::string &label, double duration);     //!< Store the state of the root
+        size_t                              getEndState(size_t site_idx, size_t node_idx) const;                                //!< The state at the child end of the branch
+        size_t                              getNumberOfNodes(void) const;
+        size_t                              getNumberOfSegments(size_t site_idx, size_t node_idx) const;
+        size_t                              getNumberOfSites(void) const;
+        double                              getSegmentDuration(size_t site_idx, size_t node_idx, size_t k) const;
+        size_t                              getSegmentState(size_t site_idx, size_t node_idx, size_t k) const;
+        std::string                         getSimmapString(size_t site_idx, size_t node_idx, bool use_simmap_default) const;   //!< The SIMMAP string of a branch
+        const std::vector<size_t>&          getSites(void) const;                                                               //!< The indices of the mapped sites
+        size_t                              getStartState(size_t site_idx, size_t node_idx) const;                              //!< The state at the parent end of the branch
+        void                                reset(size_t n, const std::vector<size_t> &s);                                      //!< Remove all histories and set the dimensions
+        void                                writeSimmap(std::ostream &o, size_t site_idx, size_t node_idx, bool use_simmap_default) const;  //!< Write the SIMMAP string of a branch
+
+    private:
+
+        size_t                              branchIndex(size_t site_idx, size_t node_idx) const;
+
+        // members
+        size_t                              num_nodes;
+        std::vector<size_t>                 sites;
+        std::vector<size_t>                 branch_first_segment;                                                               //!< Offset of the first segment of each (site,branch)
+        std::vector<size_t>                 branch_num_segments;                                                                //!< Number of segments of each (site,branch)
+        std::vector<size_t>                 segment_states;
+        std::vector<double>                 segment_durations;
+        size_t                              root_node;                                                                          //!< The node index of the root (num_nodes if not set)
+        std::vector<std::string>            root_labels;                                                                        //!< The label of the root state per site
+
+    };
+
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include "RbConstants.h"
 #include "RbException.h"
 #include "RbMathMatrix.h"
+#include "RbSettings.h"
 #include "DistributionPoisson.h"
 #include "TransitionProbabilityMatrix.h"
 #include "Cloneable.h"
@@ -60,6 +61,7 @@ AbstractRateMatrix& AbstractRateMatrix::operator=(const AbstractRateMatrix &r)
 
         the_rate_matrix       = new MatrixReal( *r.the_rate_matrix );
         needs_update         = true;
+        uniformization_powers.invalidate();
 
     }
 
@@ -245,20 +247,13 @@ bool AbstractRateMatrix::checkTimeReversibity(double tolerance)
 
 double AbstractRateMatrix::getDominatingRate(void) const
 {
-    return dominating_rate;
+    return getUniformizationMatrixPowers().getDominatingRate();
 }
 
 void AbstractRateMatrix::computeDominatingRate(void)
 {
-    dominating_rate = 0.0;
-    for (size_t i = 0; i < num_states; i++)
-    {
-        double r = -(*the_rate_matrix)[i][i];
-        if ( r > dominating_rate)
-        {
-            dominating_rate = r;
-        }
-    }
+    // the dominating rate is computed together with the powers of the uniformized matrix
+    getUniformizationMatrixPowers();
 }
 
 double AbstractRateMatrix::getRate(size_t from, size_t to, double rate) const
@@ -288,55 +283,28 @@ MatrixReal AbstractRateMatrix::getRateMatrix() const
     return *the_rate_matrix;
 }
 
-MatrixReal AbstractRateMatrix::getStochasticMatrix(size_t n)
+const MatrixReal& AbstractRateMatrix::getStochasticMatrix(size_t n)
 {
-    if (n >= stochastic_matrix.size())
-    {
-        std::stringstream ss;
-        ss << "Cannot access stochastic matrix R^" << n;
-        throw RbException(ss.str());
-    }
-    return stochastic_matrix[n];
+    return getUniformizationMatrixPowers().getPower(n);
 }
 
 void AbstractRateMatrix::computeStochasticMatrix(size_t n)
 {
-    MatrixReal r;
-    if (n == 0) {
-        // identity matrix, R^0
-        r = MatrixReal(num_states, num_states);
-        for (size_t i = 0; i < num_states; i++) {
-            r[i][i] = 1.0;
-        }
-    }
-    else if (n == 1) {
-        // stochastic matrix, R^1
-        r = (*the_rate_matrix) * (1.0/dominating_rate) + stochastic_matrix[0];
-    }
-    else {
-        // stochastic matrix, R^n = R^(n-1) * R^1
-        MatrixReal r_n_minus_1 = stochastic_matrix[n-1];
-
-        // helps manage machine precision error/underflow for large R^n
-        double smallest_non_zero = 1.0; //RbConstants::Double::inf;
-        for (size_t i = 0; i < this->num_states; i++)
-        {
-            if (r_n_minus_1[i][i] < smallest_non_zero && r_n_minus_1[i][i] > 0.0)
-            {
-                smallest_non_zero = r_n_minus_1[i][i];
-            }
-        }
-        r_n_minus_1 *= (1.0 / smallest_non_zero);
-
-//        r = stochastic_matrix[n-1] * stochastic_matrix[1];
-        r = r_n_minus_1 * stochastic_matrix[1];
-        r *= smallest_non_zero;
+    // the powers are computed lazily when they are accessed
+    getUniformizationMatrixPowers().getPower(n);
+}
 
-    }
+/**
+ * Get the powers of the uniformized matrix for the current rates.
+ * The powers are kept between calls and are only recomputed after the rates have changed,
+ * i.e., after update() or the methods that change the rates invalidated them,
+ * so that stochastic mapping and uniformization over many branches share the same matrix products.
+ */
+UniformizationMatrixPowers& AbstractRateMatrix::getUniformizationMatrixPowers(void) const
+{
+    uniformization_powers.validate( *the_rate_matrix, RbSettings::userSettings().getTolerance() );
 
-    if (stochastic_matrix.size() <= n) {
-        stochastic_matrix.push_back(r);
-    }
+    return uniformization_powers;
 }
 
 /** Rescale the rates such that the average rate is r */
@@ -355,6 +323,7 @@ void AbstractRateMatrix::rescaleToAverageRate(double r)
 
     // set flags
     needs_update = true;
+    uniformization_powers.invalidate();
 
 }
 
@@ -376,10 +345,10 @@ bool AbstractRateMatrix::simulateStochasticMapping(double startAge, double endAg
     TransitionProbabilityMatrix P(num_states);
     calculateTransitionProbabilitiesForStochasticMapping(startAge, endAge, rate, P);
 //    exponentiateMatrixByScalingAndSquaring(branch_length * rate, P);
-    stochastic_matrix = std::vector<MatrixReal>();
 
-    // dominating rate
-    computeDominatingRate();
+    // dominating rate and the powers of the stochastic matrix (only recomputed if the rates changed)
+    UniformizationMatrixPowers &powers = getUniformizationMatrixPowers();
+    double dominating_rate = powers.getDominatingRate();
 
     // sample number of events
     size_t num_events = 0;
@@ -400,11 +369,8 @@ bool AbstractRateMatrix::simulateStochasticMapping(double startAge, double endAg
         double prob_num_events = RbStatistics::Poisson::pdf(lambda, (int)num_events);
         prob_num_events_sum += prob_num_events;
 
-        // add the R^n stochastic matrix
-        computeStochasticMatrix(num_events);
-
         // probability of start_state -> end_state after num_events
-        const MatrixReal& R_n = getStochasticMatrix(num_events);
+        const MatrixReal& R_n = powers.getPower(num_events);
         double prob_transition_dtmc = R_n[start_state][end_state];
 
         // update sampling prob
@@ -466,8 +432,8 @@ bool AbstractRateMatrix::simulateStochasticMapping(double startAge, double endAg
         size_t prev_state = transition_states[n];
         size_t num_events_left = num_events - n - 1;
 
-        const MatrixReal& R_1 = getStochasticMatrix(1);
-        const MatrixReal& R_n = getStochasticMatrix(num_events_left);
+        const MatrixReal& R_1 = powers.getPower(1);
+        const MatrixReal& R_n = powers.getPower(num_events_left);
 
         // get the normalization constant for sampling
         double p_sum = 0.0;
@@ -630,6 +596,7 @@ void AbstractRateMatrix::setDiagonal(void)
 
     // set flags
     needs_update = true;
+    uniformization_powers.invalidate();
 }
 
 std::vector<int> AbstractRateMatrix::get_emitted_letters() const
@@ -6,6 +6,7 @@
 
 #include "MatrixReal.h"
 #include "RateMatrix.h"
+#include "UniformizationMatrixPowers.h"
 
 
 namespace RevBayesCore {
@@ -56,7 +57,7 @@ namespace RevBayesCore {
         virtual std::vector<double>         getStationaryFrequencies(void) const = 0;                                                   //!< Return the stationary frequencies
         MatrixReal                          getRateMatrix(void) const;
         virtual void                        update(void) = 0;                                                                           //!< Update the rate entries of the matrix (is needed if stationarity freqs or similar have changed)
-        virtual MatrixReal                  getStochasticMatrix(size_t n);
+        virtual const MatrixReal&           getStochasticMatrix(size_t n);
         virtual double                      getDominatingRate(void) const;
         virtual bool                        simulateStochasticMapping(double startAge, double endAge, double rate,std::vector<size_t>& transition_states, std::vector<double>& transition_times);
         
@@ -72,6 +73,7 @@ namespace RevBayesCore {
         bool                                checkTimeReversibity(double tolerance);
         virtual void                        computeStochasticMatrix(size_t n);
         virtual void                        computeDominatingRate(void);
+        UniformizationMatrixPowers&         getUniformizationMatrixPowers(void) const;                                                  //!< Get the cached powers of the uniformized matrix for the current rates
         virtual void                        exponentiateMatrixByScalingAndSquaring(double t,  TransitionProbabilityMatrix& p) const;
         virtual void                        multiplyMatrices(TransitionProbabilityMatrix& p,  TransitionProbabilityMatrix& q,  TransitionProbabilityMatrix& r) const;
         
@@ -80,8 +82,7 @@ namespace RevBayesCore {
         bool                                needs_update;
         
         // stochastic matrix
-        double                              dominating_rate;
-        std::vector<MatrixReal>             stochastic_matrix;                                                                          //!< Stochastic matrix raised to the power of n
+        mutable UniformizationMatrixPowers  uniformization_powers;                                                                      //!< Stochastic matrix raised to the power of n
         
     };
     
@@ -93,6 +93,7 @@ void GeneralRateMatrix::update( void )
 //        updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
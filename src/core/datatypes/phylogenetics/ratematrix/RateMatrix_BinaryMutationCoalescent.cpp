@@ -194,6 +194,7 @@ void RateMatrix_BinaryMutationCoalescent::update( void )
     {
         buildRateMatrix();
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
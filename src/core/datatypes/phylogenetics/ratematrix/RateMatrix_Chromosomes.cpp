@@ -257,6 +257,7 @@ void RateMatrix_Chromosomes::update( void ) {
     {
         buildRateMatrix();
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
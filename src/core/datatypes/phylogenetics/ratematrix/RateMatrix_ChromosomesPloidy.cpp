@@ -378,6 +378,7 @@ void RateMatrix_ChromosomesPloidy::update( void ) {
     {
         buildRateMatrix();
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
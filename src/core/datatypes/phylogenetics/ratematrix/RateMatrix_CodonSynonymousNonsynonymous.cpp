@@ -374,6 +374,7 @@ void RateMatrix_CodonSynonymousNonsynonymous::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -462,6 +462,7 @@ void RateMatrix_CodonSynonymousNonsynonymousHKY::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
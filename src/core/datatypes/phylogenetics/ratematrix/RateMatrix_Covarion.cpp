@@ -472,6 +472,7 @@ void RateMatrix_Covarion::update( void )
         //        updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
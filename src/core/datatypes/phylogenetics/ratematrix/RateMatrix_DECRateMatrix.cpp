@@ -754,6 +754,7 @@ void RateMatrix_DECRateMatrix::update( void ) {
         accessedTransitionProbabilities = std::list<double>();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
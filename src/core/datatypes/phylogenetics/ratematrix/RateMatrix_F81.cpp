@@ -100,6 +100,7 @@ void RateMatrix_F81::update( void )
         rescaleToAverageRate( 1.0 );
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
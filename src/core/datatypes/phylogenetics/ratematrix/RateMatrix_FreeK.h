@@ -66,8 +66,6 @@ namespace RevBayesCore {
         void                                tiProbsUniformization(double t, TransitionProbabilityMatrix& P) const;              //!< Calculate transition probabilities with uniformization
         void                                tiProbsScalingAndSquaring(double t, TransitionProbabilityMatrix& P) const;          //!< Calculate transition probabilities with scaling and squaring
         void                                updateEigenSystem(void);                                                            //!< Update the system of eigenvalues and eigenvectors
-        void                                updateUniformization(void);                                                         //!< Update the system for uniformization
-        void                                expandUniformization(int truncation, double tolerance) const;
         void                                expMatrixTaylor(MatrixReal &A, MatrixReal &F, double tolerance) const;
         void                                checkMatrixIrreducible(double tolerance, TransitionProbabilityMatrix& P) const;
         void                                checkMatrixDiff(MatrixReal x, double tolerance, bool& diff) const;
@@ -77,11 +75,6 @@ namespace RevBayesCore {
         void                                exponentiateMatrixByScalingAndSquaring(double t,  TransitionProbabilityMatrix& p) const;
         inline void                         multiplyMatrices(TransitionProbabilityMatrix& p,  TransitionProbabilityMatrix& q,  TransitionProbabilityMatrix& r) const;
         
-        // members for uniformization
-        MatrixReal                          singleStepMatrix;
-        std::vector<MatrixReal>*            matrixProducts;
-        double                              maxRate;
-        
         // the eigensystem
         EigenSystem*                        theEigenSystem;                                                                     //!< Holds the eigen system
         std::vector<double>                 c_ijk;                                                                              //!< Vector of precalculated product of eigenvectors and their inverse
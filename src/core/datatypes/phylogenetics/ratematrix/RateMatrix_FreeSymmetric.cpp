@@ -15,6 +15,7 @@
 #include "RbMathMatrix.h"
 #include "RbSettings.h"
 #include "TransitionProbabilityMatrix.h"
+#include "UniformizationMatrixPowers.h"
 #include "Assignable.h"
 #include "GeneralRateMatrix.h"
 #include "RbVector.h"
@@ -39,8 +40,6 @@ RateMatrix_FreeSymmetric::RateMatrix_FreeSymmetric(size_t n) : GeneralRateMatrix
     c_ijk.resize(num_states * num_states * num_states);
     cc_ijk.resize(num_states * num_states * num_states);
     
-    matrixProducts = new std::vector<MatrixReal>();
-    
     update();
 }
 
@@ -62,8 +61,6 @@ RateMatrix_FreeSymmetric::RateMatrix_FreeSymmetric(size_t n, bool r) : GeneralRa
     c_ijk.resize(num_states * num_states * num_states);
     cc_ijk.resize(num_states * num_states * num_states);
     
-    matrixProducts = new std::vector<MatrixReal>();
-    
     update();
 }
 
@@ -110,24 +107,17 @@ RateMatrix_FreeSymmetric::RateMatrix_FreeSymmetric(size_t n, bool r, std::string
     c_ijk.resize(num_states * num_states * num_states);
     cc_ijk.resize(num_states * num_states * num_states);
     
-    matrixProducts = new std::vector<MatrixReal>();
-    
     update();
 }
 
 
 /** Copy constructor */
-RateMatrix_FreeSymmetric::RateMatrix_FreeSymmetric(const RateMatrix_FreeSymmetric& m) : GeneralRateMatrix( m ),
-    singleStepMatrix(num_states)
+RateMatrix_FreeSymmetric::RateMatrix_FreeSymmetric(const RateMatrix_FreeSymmetric& m) : GeneralRateMatrix( m )
 {
     
     rescale               = m.rescale;
     my_method             = m.my_method;
     
-    matrixProducts        = new std::vector<MatrixReal>( *m.matrixProducts );
-    singleStepMatrix      = m.singleStepMatrix;
-    maxRate               = m.maxRate;
-    
     theEigenSystem        = new EigenSystem( *m.theEigenSystem );
     c_ijk                 = m.c_ijk;
     cc_ijk                = m.cc_ijk;
@@ -141,7 +131,6 @@ RateMatrix_FreeSymmetric::~RateMatrix_FreeSymmetric(void)
 {
     
     delete theEigenSystem;
-    delete matrixProducts;
 }
 
 
@@ -162,15 +151,10 @@ RateMatrix_FreeSymmetric& RateMatrix_FreeSymmetric::operator=(const RateMatrix_F
         GeneralRateMatrix::operator=( r );
         
         delete theEigenSystem;
-        delete matrixProducts;
         
         rescale               = r.rescale;
         my_method             = r.my_method;
         
-        matrixProducts        = new std::vector<MatrixReal>( *r.matrixProducts );
-        singleStepMatrix      = r.singleStepMatrix;
-        maxRate               = r.maxRate;
-        
         theEigenSystem       = new EigenSystem( *r.theEigenSystem );
         c_ijk                = r.c_ijk;
         cc_ijk               = r.cc_ijk;
@@ -358,39 +342,6 @@ RateMatrix_FreeSymmetric* RateMatrix_FreeSymmetric::clone( void ) const
 }
 
 
-void RateMatrix_FreeSymmetric::expandUniformization(int truncation, double tolerance) const
-{
-
-    int n = (int)matrixProducts->size();
-    int d = truncation - n;
-    int i = 0;
-    
-    for (; i < d; ++i)
-    {
-        // add terms of the power series to matrix products until the difference between the last two terms is smaller than the tolerance
-        MatrixReal diffMatrix = matrixProducts->at(n - 1 + i) - matrixProducts->at(n - 2 + i);
-        
-        bool diff = true;
-        checkMatrixDiff(diffMatrix, tolerance, diff);
-        if (diff == true)
-        {
-            break;
-        }
-
-        MatrixReal m = singleStepMatrix * matrixProducts->at(n - 1 + i);
-        matrixProducts->push_back(m);
-    }
-    
-    // if the current size of the matrix products is still smaller than the truncation, fill all the remaining terms with the same converged matrix
-    MatrixReal m = matrixProducts->at(n - 1 + i);
-    for (int j = i; j < d; ++j)
-    {
-        matrixProducts->push_back(m);
-    }
-    
-}
-
-
 /**
  *  Scaling and squaring a matrix via a Taylor series
  *
@@ -735,44 +686,54 @@ void RateMatrix_FreeSymmetric::tiProbsUniformization(double t, TransitionProbabi
     // which seems to be pretty generous in most cases, so it should be sufficient for now
     // if not, a larger number should be considered
     // Jiansi Gao 09/07/2017
-    MatrixReal result(num_states);
-    double tol = RbSettings::userSettings().getTolerance();
+    UniformizationMatrixPowers &powers = getUniformizationMatrixPowers();
+    double dominating_rate = powers.getDominatingRate();
+
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            P[i][j] = 0.0;
+        }
+    }
     
     // check if the Q matrix is irreducible
     // if that is not the case, directly fill in the P matrix with all zeros
     // as otherwise the following loop which expands the power series of the uniformized matrix may not be finite
     // here we assume that all the states in the Q matrix exist in the observed data
-    if ((RbMath::isNan(maxRate) || maxRate >= 0.0) == false)
+    if ( RbMath::isNan(dominating_rate) == false && dominating_rate > 0.0 )
     {
-        double lambda = -maxRate * t;
+        double lambda = dominating_rate * t;
         int truncation = std::ceil(4 + 6 * sqrt(lambda) + lambda);
         
-        // update the matrix poisson products sum vector if necessary
-        expandUniformization(truncation, tol);
-        
         // compute the transition probability by weighted average
-        for (size_t i = 0; i < truncation; ++i)
+        // the powers of the uniformized matrix are shared between all branches
+        for (size_t k = 0; k < truncation; ++k)
         {
             
             // compute the poisson probability
-            double p = RbStatistics::Poisson::pdf(lambda, (int)i);
+            double p = RbStatistics::Poisson::pdf(lambda, (int)k);
             
-            // add the weighted terms of taylor series until a given term is smaller than the tolerance
-            result += matrixProducts->at(i) * p;
+            const MatrixReal &R_k = powers.getConvergedPower(k);
+            for (size_t i = 0; i < num_states; ++i)
+            {
+                for (size_t j = 0; j < num_states; ++j)
+                {
+                    P[i][j] += R_k[i][j] * p;
+                }
+            }
             
         }
     }
     
-    // fill in P from result
+    // truncate negative values
     for (size_t i = 0; i < num_states; ++i)
     {
         for (size_t j = 0; j < num_states; ++j)
         {
-            P[i][j] = (result[i][j] < 0.0) ? 0.0 : result[i][j];
+            P[i][j] = (P[i][j] < 0.0) ? 0.0 : P[i][j];
         }
     }
-
-//    checkMatrixIrreducible(tol, P);
     
 }
 
@@ -787,49 +748,6 @@ void RateMatrix_FreeSymmetric::updateEigenSystem(void)
 }
 
 
-void RateMatrix_FreeSymmetric::updateUniformization(void)
-{
-    
-    // we need to fill in the single-step transition probability matrix
-    
-    // find the diagonial element of the matrix with the maximal value
-    MatrixReal m = *the_rate_matrix;
-    maxRate = m[0][0];
-    for (size_t i = 1; i < num_states; ++i)
-    {
-        if (m[i][i] < maxRate )
-        {
-            maxRate = m[i][i];
-        }
-    }
-    
-    // for the given max rate, fill in the single-step transition probability matrix
-    singleStepMatrix = MatrixReal(num_states);
-    for (size_t i = 0; i < num_states; ++i)
-    {
-        singleStepMatrix[i][i] = 1 - m[i][i] / maxRate;
-        for (size_t j = i + 1; j < num_states; ++j)
-        {
-            singleStepMatrix[i][j] = -m[i][j] / maxRate;
-            singleStepMatrix[j][i] = -m[j][i] / maxRate;
-        }
-    }
-    
-    // finally, clear the vector of matrix products
-    matrixProducts->clear();
-    
-    // add the identity matrix (the first one) and the singleStepMatrix (the second one)
-    MatrixReal identity_matrix(num_states);
-    for (size_t i = 0; i < num_states; ++i)
-    {
-        identity_matrix[i][i] = 1.0;
-    }
-    matrixProducts->push_back(identity_matrix);
-    matrixProducts->push_back(singleStepMatrix);
-
-}
-
-
 void RateMatrix_FreeSymmetric::update( void )
 {
     
@@ -844,11 +762,9 @@ void RateMatrix_FreeSymmetric::update( void )
             rescaleToAverageRate( 1.0 );
         }
 
-        // update the uniformization system if necessary
-        if (my_method == UNIFORMIZATION)
-        {
-            updateUniformization();
-        }
+        // the powers of the uniformized matrix are recomputed lazily for the new rates
+        uniformization_powers.invalidate();
+
         // update the eigensystem if necessary
         if (my_method == EIGEN)
         {
@@ -56,19 +56,12 @@ namespace RevBayesCore {
         void                                tiProbsUniformization(double t, TransitionProbabilityMatrix& P) const;              //!< Calculate transition probabilities with uniformization
         void                                tiProbsScalingAndSquaring(double t, TransitionProbabilityMatrix& P) const;          //!< Calculate transition probabilities with scaling and squaring
         void                                updateEigenSystem(void);                                                            //!< Update the system of eigenvalues and eigenvectors
-        void                                updateUniformization(void);                                                         //!< Update the system for uniformization
-        void                                expandUniformization(int truncation, double tolerance) const;                       //!< Expand a matrix via uniformization
         void                                expMatrixTaylor(MatrixReal &A, MatrixReal &F, double tolerance) const;              //!< Exponentaite a matrix via Taylor series
         void                                checkMatrixDiff(MatrixReal x, double tolerance, bool& diff) const;
         void                                checkMatrixIrreducible(double tolerance, TransitionProbabilityMatrix& P) const;
         
         bool                                rescale;                                                                          //!< A boolean for whether the matrix is rescaled such that the average rate is 1
         
-        // members for uniformization
-        MatrixReal                          singleStepMatrix;
-        std::vector<MatrixReal>*            matrixProducts;
-        double                              maxRate;                                                                           //!< The max rate of the matrix
-
         void                                exponentiateMatrixByScalingAndSquaring(double t,  TransitionProbabilityMatrix& p) const; //!< Exponentiate the matrix by sqauring and scaling
         inline void                         multiplyMatrices(TransitionProbabilityMatrix& p,  TransitionProbabilityMatrix& q,  TransitionProbabilityMatrix& r) const;  //!< Perform matrix multiplication on two matrices
         
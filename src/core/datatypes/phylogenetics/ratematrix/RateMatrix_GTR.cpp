@@ -306,6 +306,7 @@ void RateMatrix_GTR::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
@@ -165,6 +165,7 @@ void RateMatrix_HKY::update( void )
         rescaleToAverageRate( 1.0 );
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
@@ -153,6 +153,7 @@ void RateMatrix_Kimura80::update( void )
         rescaleToAverageRate( 1.0 );
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
@@ -268,6 +268,7 @@ void RateMatrix_Kimura81::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
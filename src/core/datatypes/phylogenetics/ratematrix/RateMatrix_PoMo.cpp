@@ -449,6 +449,7 @@ void RateMatrix_PoMo::update( void )
     {
         buildRateMatrix();
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -362,6 +362,7 @@ void RateMatrix_PoMo2N::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -445,6 +445,7 @@ void RateMatrix_PoMo4::update( void )
     {
         buildRateMatrix();
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
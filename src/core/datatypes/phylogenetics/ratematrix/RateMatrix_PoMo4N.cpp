@@ -472,6 +472,7 @@ void RateMatrix_PoMo4N::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
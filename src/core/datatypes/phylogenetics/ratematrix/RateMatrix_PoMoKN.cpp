@@ -389,6 +389,7 @@ void RateMatrix_PoMoKN::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -468,6 +468,7 @@ void RateMatrix_ReversiblePoMo::update( void )
         //rescaleToAverageRate( 1.0 );
 
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -429,6 +429,7 @@ void RateMatrix_Senca::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -170,6 +170,7 @@ void RateMatrix_Tamura92::update( void ) {
         rescaleToAverageRate( 1.0 );
 
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
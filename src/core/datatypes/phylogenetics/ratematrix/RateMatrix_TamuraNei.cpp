@@ -256,6 +256,7 @@ void RateMatrix_TamuraNei::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
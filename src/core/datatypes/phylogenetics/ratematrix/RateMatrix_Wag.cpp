@@ -316,6 +316,7 @@ void RateMatrix_Wag::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
     
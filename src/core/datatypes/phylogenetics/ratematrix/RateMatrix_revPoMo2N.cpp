@@ -371,6 +371,7 @@ void RateMatrix_revPoMo2N::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
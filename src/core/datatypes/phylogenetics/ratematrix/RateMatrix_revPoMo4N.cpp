@@ -481,6 +481,7 @@ void RateMatrix_revPoMo4N::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
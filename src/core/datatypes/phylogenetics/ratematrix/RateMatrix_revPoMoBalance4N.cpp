@@ -533,6 +533,7 @@ void RateMatrix_revPoMoBalance4N::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
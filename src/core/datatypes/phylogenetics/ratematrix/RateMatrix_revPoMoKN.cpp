@@ -399,6 +399,7 @@ void RateMatrix_revPoMoKN::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -449,6 +449,7 @@ void RateMatrix_revPoMoThree4N::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
@@ -364,6 +364,7 @@ void RateMatrix_revPoMoTwo4N::update( void )
         updateEigenSystem();
         
         // clean flags
+        uniformization_powers.invalidate();
         needs_update = false;
     }
 }
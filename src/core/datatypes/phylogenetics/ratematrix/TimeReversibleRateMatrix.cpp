@@ -59,6 +59,76 @@ double TimeReversibleRateMatrix::averageRate(void) const
 }
 
 
+/**
+ * Compute the gradient with respect to the exchangeability rates er and the stationary frequencies f,
+ * given the gradient (adjoint) with respect to the rates of this matrix (n*n in row-major order).
+ * The rates are q_ij = er_ij f_j / beta for i != j and q_ii = -sum_j q_ij, where beta = sum_i f_i sum_j er_ij f_j
+ * rescales the matrix to an average rate of one. The matrix must be up-to-date for the given er and f.
+ * We pass the exchangeability rates explicitly because some matrices (e.g., HKY) do not store them.
+ */
+void TimeReversibleRateMatrix::computeRateGradient(const std::vector<double> &er, const std::vector<double> &adjoint, std::vector<double> &er_gradient, std::vector<double> &f_gradient) const
+{
+
+    const MatrixReal& m = *the_rate_matrix;
+    const std::vector<double> &f = stationary_freqs;
+
+    // the unscaled off-diagonal rates
+    MatrixReal u = MatrixReal(num_states, num_states, 0.0);
+    for (size_t i=0, k=0; i<num_states; ++i)
+    {
+        for (size_t j=i+1; j<num_states; ++j)
+        {
+            u[i][j] = er[k] * f[j];
+            u[j][i] = er[k] * f[i];
+            k++;
+        }
+    }
+
+    double beta = 0.0;
+    double adjoint_beta = 0.0;
+    for (size_t i=0; i<num_states; ++i)
+    {
+        for (size_t j=0; j<num_states; ++j)
+        {
+            if ( i != j )
+            {
+                beta += f[i] * u[i][j];
+            }
+            adjoint_beta += adjoint[i*num_states + j] * m[i][j];
+        }
+    }
+    adjoint_beta /= -beta;
+
+    // the gradient with respect to the unscaled rates, including the diagonal and the scaling factor
+    f_gradient = std::vector<double>(num_states, 0.0);
+    MatrixReal adjoint_u = MatrixReal(num_states, num_states, 0.0);
+    for (size_t i=0; i<num_states; ++i)
+    {
+        for (size_t j=0; j<num_states; ++j)
+        {
+            if ( i != j )
+            {
+                adjoint_u[i][j] = (adjoint[i*num_states + j] - adjoint[i*num_states + i]) / beta + adjoint_beta * f[i];
+                f_gradient[i] += adjoint_beta * u[i][j];
+            }
+        }
+    }
+
+    er_gradient = std::vector<double>(er.size(), 0.0);
+    for (size_t i=0, k=0; i<num_states; ++i)
+    {
+        for (size_t j=i+1; j<num_states; ++j)
+        {
+            er_gradient[k] = adjoint_u[i][j] * f[j] + adjoint_u[j][i] * f[i];
+            f_gradient[j] += adjoint_u[i][j] * er[k];
+            f_gradient[i] += adjoint_u[j][i] * er[k];
+            k++;
+        }
+    }
+
+}
+
+
 void TimeReversibleRateMatrix::computeOffDiagonal( void )
 {
     
@@ -23,6 +23,7 @@ namespace RevBayesCore {
 
         // public methods
         double                              averageRate(void) const;                                                                    //!< Calculate the average rate
+        void                                computeRateGradient(const std::vector<double> &er, const std::vector<double> &adjoint, std::vector<double> &er_gradient, std::vector<double> &f_gradient) const;    //!< Gradient with respect to the exchangeability rates and stationary frequencies
         void                                computeOffDiagonal(void);
         const std::vector<double>&          getExchangeabilityRates(void) const;
         virtual std::vector<double>         getStationaryFrequencies(void) const;                                                       //!< Return the stationary frequencies
@@ -0,0 +1,219 @@
+#include "UniformizationMatrixPowers.h"
+
+#include <cmath>
+
+#include "RbException.h"
+#include "RbVector.h"
+#include "RbVectorImpl.h"
+
+using namespace RevBayesCore;
+
+
+UniformizationMatrixPowers::UniformizationMatrixPowers(void) :
+    valid( false ),
+    dominating_rate( 0.0 ),
+    tolerance( 0.0 ),
+    converged_power( 0 )
+{
+
+}
+
+
+/**
+ * Compute the powers R^k = R^(k-1) * R up to R^n.
+ * If we may stop at convergence, then we do not compute powers beyond the converged power.
+ */
+void UniformizationMatrixPowers::expand(size_t n, bool stop_at_convergence)
+{
+
+    size_t num_states = powers[0].getNumberOfRows();
+
+    while ( powers.size() <= n && ( stop_at_convergence == false || converged_power == 0 ) )
+    {
+        size_t k = powers.size();
+
+        // helps manage machine precision error/underflow for large R^n
+        MatrixReal r_k_minus_1 = powers[k-1];
+        double smallest_non_zero = 1.0;
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            if (r_k_minus_1[i][i] < smallest_non_zero && r_k_minus_1[i][i] > 0.0)
+            {
+                smallest_non_zero = r_k_minus_1[i][i];
+            }
+        }
+        r_k_minus_1 *= (1.0 / smallest_non_zero);
+
+        MatrixReal r = r_k_minus_1 * powers[1];
+        r *= smallest_non_zero;
+
+        powers.push_back( r );
+
+        // check if the powers have converged
+        if ( tolerance > 0.0 && converged_power == 0 )
+        {
+            const MatrixReal &previous = powers[k-1];
+            bool converged = true;
+            for (size_t i = 0; i < num_states && converged == true; ++i)
+            {
+                for (size_t j = 0; j < num_states; ++j)
+                {
+                    if ( std::fabs( r[i][j] - previous[i][j] ) >= tolerance )
+                    {
+                        converged = false;
+                        break;
+                    }
+                }
+            }
+
+            if ( converged == true )
+            {
+                converged_power = k;
+            }
+        }
+
+    }
+
+}
+
+
+double UniformizationMatrixPowers::getDominatingRate(void) const
+{
+
+    return dominating_rate;
+}
+
+
+size_t UniformizationMatrixPowers::getNumberOfPowers(void) const
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    return powers.size();
+}
+
+
+const MatrixReal& UniformizationMatrixPowers::getConvergedPower(size_t n)
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    if ( valid == false )
+    {
+        throw RbException("Cannot access the powers of the uniformized matrix before they are initialized.");
+    }
+
+    expand( n, true );
+
+    if ( converged_power > 0 && n >= converged_power )
+    {
+        return powers[converged_power];
+    }
+
+    return powers[n];
+}
+
+
+const MatrixReal& UniformizationMatrixPowers::getPower(size_t n)
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    if ( valid == false )
+    {
+        throw RbException("Cannot access the powers of the uniformized matrix before they are initialized.");
+    }
+
+    expand( n, false );
+
+    return powers[n];
+}
+
+
+void UniformizationMatrixPowers::invalidate(void)
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    valid = false;
+    powers.clear();
+
+}
+
+
+bool UniformizationMatrixPowers::isValid(void) const
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    return valid;
+}
+
+
+/**
+ * Initialize R^0 and R^1 for the rate matrix q.
+ */
+void UniformizationMatrixPowers::reset(const MatrixReal &q, double tol)
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+    resetPowers( q, tol );
+
+}
+
+
+void UniformizationMatrixPowers::resetPowers(const MatrixReal &q, double tol)
+{
+
+    size_t num_states = q.getNumberOfRows();
+
+    tolerance       = tol;
+    converged_power = 0;
+
+    // the dominating rate is the largest rate of leaving a state
+    dominating_rate = 0.0;
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        if ( -q[i][i] > dominating_rate )
+        {
+            dominating_rate = -q[i][i];
+        }
+    }
+
+    // identity matrix, R^0
+    MatrixReal identity_matrix(num_states);
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        identity_matrix[i][i] = 1.0;
+    }
+
+    // stochastic matrix, R^1
+    MatrixReal r = identity_matrix;
+    if ( dominating_rate > 0.0 )
+    {
+        r += q * (1.0 / dominating_rate);
+    }
+
+    powers.clear();
+    powers.push_back( identity_matrix );
+    powers.push_back( r );
+
+    valid = true;
+
+}
+
+
+/**
+ * Initialize R^0 and R^1 for the rate matrix q unless the powers are valid.
+ * Unlike checking isValid() and then calling reset(), this is safe if several threads share the powers.
+ */
+void UniformizationMatrixPowers::validate(const MatrixReal &q, double tol)
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+    if ( valid == false )
+    {
+        resetPowers( q, tol );
+    }
+
+}
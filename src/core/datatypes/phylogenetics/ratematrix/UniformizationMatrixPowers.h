@@ -0,0 +1,71 @@
+#ifndef UniformizationMatrixPowers_H
+#define UniformizationMatrixPowers_H
+
+#include <stddef.h>
+#include <deque>
+#include <mutex>
+
+#include "MatrixReal.h"
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Cache of the powers of a uniformized rate matrix.
+     *
+     * Uniformization writes a rate matrix Q as a Poisson mixture of a discrete Markov chain
+     * with the stochastic matrix R = I + Q / mu, where mu is the dominating rate, i.e., the largest
+     * rate of leaving a state. Both the transition probabilities P(t) = sum_k Pois(k; mu*t) R^k
+     * and endpoint-conditioned path sampling need the powers R^k.
+     *
+     * This class computes the powers lazily up to the largest power requested so far and keeps them
+     * until the owner invalidates them because the rate matrix changed. Thus, repeated calls for many
+     * branches reuse the same matrix products. getPower() always returns the exact power, as needed for
+     * sampling paths. If a tolerance is given, getConvergedPower() stops multiplying once two successive
+     * powers differ by less than the tolerance in every element and returns the converged power for all
+     * higher powers, which is sufficient for the transition probabilities.
+     *
+     * Several likelihoods may share a rate matrix and compute their transition probabilities concurrently.
+     * Hence validating and expanding the powers is serialized by a mutex, and the powers are kept in a deque,
+     * so that the references returned to one thread stay valid while another thread appends powers.
+     * Invalidating the powers must not happen concurrently with reading them.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class UniformizationMatrixPowers {
+
+    public:
+        UniformizationMatrixPowers(void);                                                                       //!< Default constructor
+
+        // public methods
+        double                              getDominatingRate(void) const;                                      //!< Get the dominating rate mu
+        size_t                              getNumberOfPowers(void) const;                                      //!< Get the number of powers computed so far
+        const MatrixReal&                   getConvergedPower(size_t n);                                        //!< Get R^n, or the converged power if n is larger
+        const MatrixReal&                   getPower(size_t n);                                                 //!< Get R^n, computing it if necessary
+        void                                invalidate(void);                                                   //!< Discard all powers
+        bool                                isValid(void) const;                                                //!< Are the powers computed for the current rate matrix?
+        void                                reset(const MatrixReal &q, double tol);                             //!< Start the powers for a new rate matrix
+        void                                validate(const MatrixReal &q, double tol);                          //!< Start the powers for the rate matrix unless they are valid
+
+    private:
+
+        UniformizationMatrixPowers(const UniformizationMatrixPowers &p);                                        //!< Prevent copy
+        UniformizationMatrixPowers&         operator=(const UniformizationMatrixPowers &p);                     //!< Prevent assignment
+
+        void                                expand(size_t n, bool stop_at_convergence);                         //!< Compute all powers up to R^n (the caller holds the mutex)
+        void                                resetPowers(const MatrixReal &q, double tol);                       //!< Start the powers (the caller holds the mutex)
+
+        // members
+        bool                                valid;                                                              //!< Are the powers up-to-date?
+        double                              dominating_rate;                                                    //!< The dominating rate mu
+        double                              tolerance;                                                          //!< The tolerance for convergence of the powers (0 means exact)
+        size_t                              converged_power;                                                    //!< The power after which all powers are identical
+        std::deque<MatrixReal>              powers;                                                             //!< The powers R^0, R^1, ...
+        mutable std::mutex                  mutex;                                                              //!< Serializes the changes of the powers
+
+    };
+
+}
+
+#endif
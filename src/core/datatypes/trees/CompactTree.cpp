@@ -0,0 +1,294 @@
+#include "CompactTree.h"
+
+#include <algorithm>
+
+#include "RbException.h"
+#include "TopologyNode.h"
+#include "Tree.h"
+
+using namespace RevBayesCore;
+
+
+/** Empty tree */
+CompactTree::CompactTree( void ) :
+    root_index( 0 ),
+    num_tips( 0 ),
+    rooted( false ),
+    negative_constraint( false ),
+    has_annotations( false )
+{
+
+    child_offsets.push_back( 0 );
+}
+
+
+/** Compact copy of the tree t. Without annotations only the structure, ages and branch lengths are stored. */
+CompactTree::CompactTree( const Tree &t, bool annotations ) :
+    root_index( 0 ),
+    num_tips( 0 ),
+    rooted( false ),
+    negative_constraint( false ),
+    has_annotations( false )
+{
+
+    assign( t, annotations );
+}
+
+
+/**
+ * Rebuild the compact tree from the tree t.
+ * We only iterate over the node vector of the tree, so this is a single pass without recursion.
+ * The traversals are computed afterwards on the index arrays using an explicit stack.
+ */
+void CompactTree::assign( const Tree &t, bool annotations )
+{
+
+    const std::vector<TopologyNode*> &nodes = t.getNodes();
+    size_t num_nodes = nodes.size();
+
+    rooted              = t.isRooted();
+    negative_constraint = t.isNegativeConstraint();
+    has_annotations     = annotations;
+    num_tips            = 0;
+    root_index          = 0;
+
+    parents.resize( num_nodes );
+    child_offsets.assign( num_nodes+1, 0 );
+    ages.resize( num_nodes );
+    branch_lengths.resize( num_nodes );
+    sampled_ancestors.resize( num_nodes );
+    taxon_indices.clear();
+    taxa.clear();
+    node_parameters.clear();
+    branch_parameters.clear();
+
+    // first we store the values and count the children of each node
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        const TopologyNode &n = *nodes[i];
+        size_t index = n.getIndex();
+        if ( index >= num_nodes )
+        {
+            throw RbException("Cannot create a compact tree because a node has an index larger than the number of nodes.");
+        }
+
+        parents[index]              = ( n.isRoot() == true ? -1 : long(n.getParent().getIndex()) );
+        child_offsets[index+1]      = n.getNumberOfChildren();
+        ages[index]                 = n.getAge();
+        branch_lengths[index]       = n.getBranchLength();
+        sampled_ancestors[index]    = n.isSampledAncestor();
+
+        if ( n.isRoot() == true )
+        {
+            root_index = index;
+        }
+        if ( n.isTip() == true )
+        {
+            ++num_tips;
+        }
+    }
+
+    // the offsets are the cumulative number of children
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        child_offsets[i+1] += child_offsets[i];
+    }
+    children.resize( child_offsets[num_nodes] );
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        const TopologyNode &n = *nodes[i];
+        size_t offset = child_offsets[ n.getIndex() ];
+        for (size_t j = 0; j < n.getNumberOfChildren(); ++j)
+        {
+            children[offset+j] = n.getChild(j).getIndex();
+        }
+    }
+
+    // the side tables
+    if ( annotations == true )
+    {
+        taxon_indices.assign( num_nodes, -1 );
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            const TopologyNode &n = *nodes[i];
+            size_t index = n.getIndex();
+            if ( n.getTaxon().getName() != "" )
+            {
+                taxon_indices[index] = long(taxa.size());
+                taxa.push_back( n.getTaxon() );
+            }
+            if ( n.getNodeParameters().empty() == false )
+            {
+                node_parameters[index] = n.getNodeParameters();
+            }
+            if ( n.getBranchParameters().empty() == false )
+            {
+                branch_parameters[index] = n.getBranchParameters();
+            }
+        }
+    }
+
+    // the pre-order traversal visits the children from left to right
+    pre_order.clear();
+    stack.clear();
+    if ( num_nodes > 0 )
+    {
+        stack.push_back( root_index );
+    }
+    while ( stack.empty() == false )
+    {
+        size_t n = stack.back();
+        stack.pop_back();
+        pre_order.push_back( n );
+        for (size_t j = child_offsets[n+1]; j > child_offsets[n]; --j)
+        {
+            stack.push_back( children[j-1] );
+        }
+    }
+
+    // the post-order traversal is the reverse of the pre-order traversal visiting the children from right to left
+    post_order.clear();
+    if ( num_nodes > 0 )
+    {
+        stack.push_back( root_index );
+    }
+    while ( stack.empty() == false )
+    {
+        size_t n = stack.back();
+        stack.pop_back();
+        post_order.push_back( n );
+        for (size_t j = child_offsets[n]; j < child_offsets[n+1]; ++j)
+        {
+            stack.push_back( children[j] );
+        }
+    }
+    std::reverse( post_order.begin(), post_order.end() );
+
+    if ( pre_order.size() != num_nodes )
+    {
+        throw RbException("Cannot create a compact tree because not all nodes are connected to the root.");
+    }
+
+}
+
+
+/**
+ * Convert the compact tree back into a tree with its own TopologyNode objects.
+ * The node indices are kept.
+ */
+Tree* CompactTree::toTree( void ) const
+{
+
+    if ( has_annotations == false )
+    {
+        throw RbException("Cannot convert a compact tree without taxa back into a tree.");
+    }
+
+    size_t num_nodes = parents.size();
+    if ( num_nodes == 0 )
+    {
+        return new Tree();
+    }
+
+    std::vector<TopologyNode*> nodes( num_nodes, NULL );
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        nodes[i] = new TopologyNode( i );
+        if ( taxon_indices[i] >= 0 )
+        {
+            nodes[i]->setTaxon( taxa[ taxon_indices[i] ] );
+        }
+    }
+
+    // connect the nodes in pre-order so that the children keep their order
+    for (size_t k = 0; k < pre_order.size(); ++k)
+    {
+        size_t i = pre_order[k];
+        for (size_t j = child_offsets[i]; j < child_offsets[i+1]; ++j)
+        {
+            nodes[i]->addChild( nodes[ children[j] ] );
+            nodes[ children[j] ]->setParent( nodes[i] );
+        }
+        nodes[i]->setSampledAncestor( sampled_ancestors[i] );
+    }
+
+    // the comments are copied as they are (not all of them have the form "name=value")
+    for (std::map<size_t, std::vector<std::string> >::const_iterator it = node_parameters.begin(); it != node_parameters.end(); ++it)
+    {
+        nodes[it->first]->setNodeParameters( it->second );
+    }
+    for (std::map<size_t, std::vector<std::string> >::const_iterator it = branch_parameters.begin(); it != branch_parameters.end(); ++it)
+    {
+        nodes[it->first]->setBranchParameters( it->second );
+    }
+
+    Tree *t = new Tree();
+    t->setRoot( nodes[root_index], false );
+    t->setRooted( rooted );
+    t->setNegativeConstraint( negative_constraint );
+
+    // first the ages, which also recompute the branch lengths, and then the stored branch lengths
+    for (size_t k = 0; k < pre_order.size(); ++k)
+    {
+        nodes[ pre_order[k] ]->setAge( ages[ pre_order[k] ], false );
+    }
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        nodes[i]->setBranchLength( branch_lengths[i], false );
+    }
+
+    return t;
+}
+
+
+const std::vector<std::string>& CompactTree::Node::getBranchParameters( void ) const
+{
+
+    static const std::vector<std::string> no_parameters;
+
+    std::map<size_t, std::vector<std::string> >::const_iterator it = tree->branch_parameters.find( index );
+    return ( it == tree->branch_parameters.end() ? no_parameters : it->second );
+}
+
+
+const std::string& CompactTree::Node::getName( void ) const
+{
+
+    return getTaxon().getName();
+}
+
+
+const std::vector<std::string>& CompactTree::Node::getNodeParameters( void ) const
+{
+
+    static const std::vector<std::string> no_parameters;
+
+    std::map<size_t, std::vector<std::string> >::const_iterator it = tree->node_parameters.find( index );
+    return ( it == tree->node_parameters.end() ? no_parameters : it->second );
+}
+
+
+CompactTree::Node CompactTree::Node::getParent( void ) const
+{
+
+    if ( tree->parents[index] < 0 )
+    {
+        throw RbException("The root of a compact tree has no parent.");
+    }
+
+    return Node( tree, size_t(tree->parents[index]) );
+}
+
+
+const Taxon& CompactTree::Node::getTaxon( void ) const
+{
+
+    static const Taxon no_taxon = Taxon("");
+
+    if ( tree->taxon_indices.empty() == true || tree->taxon_indices[index] < 0 )
+    {
+        return no_taxon;
+    }
+
+    return tree->taxa[ tree->taxon_indices[index] ];
+}
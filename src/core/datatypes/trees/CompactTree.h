@@ -0,0 +1,116 @@
+#ifndef CompactTree_H
+#define CompactTree_H
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Taxon.h"
+
+namespace RevBayesCore {
+
+    class Tree;
+
+    /**
+     * @brief Compact, index-based storage of a tree.
+     *
+     * The compact tree stores a tree as a structure of arrays indexed by the node indices:
+     * the parent index, the children (all in one array with an offset per node), the ages and branch lengths.
+     * Taxa, node and branch parameters are kept in side tables and only for the nodes that have them.
+     * Additionally, the post-order and pre-order traversals are precomputed as arrays of node indices.
+     *
+     * Hence, traversals don't need to chase pointers through individually allocated TopologyNode objects,
+     * and copies of a compact tree are just copies of a few vectors.
+     * The compact tree is a snapshot; it does not follow later changes of the tree it was built from,
+     * but it can be rebuilt with assign() reusing its memory.
+     * Nodes can be inspected through lightweight views (CompactTree::Node) with the read-only part of the
+     * TopologyNode interface, and toTree() converts the compact tree back into a Tree.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class CompactTree {
+
+    public:
+
+        /**
+         * @brief Lightweight view of a node of a compact tree.
+         *
+         * The view only stores the compact tree and the node index and is cheap to copy.
+         * It stays valid as long as the compact tree isn't changed.
+         */
+        class Node {
+
+        public:
+                                                    Node(const CompactTree *t, size_t i) : tree( t ), index( i ) {}
+
+            double                                  getAge(void) const                      { return tree->ages[index]; }
+            double                                  getBranchLength(void) const             { return tree->branch_lengths[index]; }
+            Node                                    getChild(size_t i) const                { return Node( tree, tree->getChildIndex(index, i) ); }
+            size_t                                  getIndex(void) const                    { return index; }
+            const std::string&                      getName(void) const;                                                    //!< The name of the taxon (or an empty string)
+            const std::vector<std::string>&         getBranchParameters(void) const;                                        //!< The branch comments
+            const std::vector<std::string>&         getNodeParameters(void) const;                                          //!< The node comments
+            size_t                                  getNumberOfChildren(void) const         { return tree->getNumberOfChildren(index); }
+            Node                                    getParent(void) const;                                                  //!< The parent (throws for the root)
+            const Taxon&                            getTaxon(void) const;                                                   //!< The taxon (an empty taxon if the node has none)
+            bool                                    isInternal(void) const                  { return tree->getNumberOfChildren(index) > 0; }
+            bool                                    isRoot(void) const                      { return tree->parents[index] < 0; }
+            bool                                    isSampledAncestor(void) const           { return tree->sampled_ancestors[index]; }
+            bool                                    isTip(void) const                       { return tree->getNumberOfChildren(index) == 0; }
+
+        private:
+            const CompactTree*                      tree;
+            size_t                                  index;
+        };
+
+        CompactTree(void);                                                                                                  //!< Empty tree
+        CompactTree(const Tree &t, bool annotations = true);                                                                //!< Compact copy of the tree
+
+        void                                        assign(const Tree &t, bool annotations = true);                         //!< Rebuild from the tree, reusing the memory
+        const std::vector<double>&                  getAges(void) const                     { return ages; }
+        const std::vector<double>&                  getBranchLengths(void) const            { return branch_lengths; }
+        size_t                                      getChildIndex(size_t n, size_t i) const { return children[ child_offsets[n] + i ]; }
+        Node                                        getNode(size_t i) const                 { return Node( this, i ); }
+        size_t                                      getNumberOfChildren(size_t n) const     { return child_offsets[n+1] - child_offsets[n]; }
+        size_t                                      getNumberOfNodes(void) const            { return parents.size(); }
+        size_t                                      getNumberOfTips(void) const             { return num_tips; }
+        long                                        getParentIndex(size_t n) const          { return parents[n]; }
+        const std::vector<size_t>&                  getPostOrder(void) const                { return post_order; }          //!< Children before their parents, the root is last
+        const std::vector<size_t>&                  getPreOrder(void) const                 { return pre_order; }           //!< Parents before their children, the root is first
+        Node                                        getRoot(void) const                     { return Node( this, root_index ); }
+        bool                                        hasAnnotations(void) const              { return has_annotations; }
+        bool                                        isRooted(void) const                    { return rooted; }
+        Tree*                                       toTree(void) const;                                                     //!< Convert back into a tree (needs the annotations)
+
+    private:
+
+        // structure and values, indexed by node index
+        std::vector<long>                           parents;                                                                //!< The index of the parent (-1 for the root)
+        std::vector<size_t>                         child_offsets;                                                          //!< The children of node i are children[child_offsets[i]] ... children[child_offsets[i+1]-1]
+        std::vector<size_t>                         children;                                                               //!< The children of all nodes
+        std::vector<double>                         ages;                                                                   //!< The ages of the nodes
+        std::vector<double>                         branch_lengths;                                                         //!< The branch lengths of the nodes
+        std::vector<bool>                           sampled_ancestors;                                                      //!< Is the node a sampled ancestor?
+        std::vector<size_t>                         post_order;                                                             //!< The node indices in post-order
+        std::vector<size_t>                         pre_order;                                                              //!< The node indices in pre-order
+        size_t                                      root_index;
+        size_t                                      num_tips;
+        bool                                        rooted;
+        bool                                        negative_constraint;
+
+        // side tables
+        bool                                        has_annotations;                                                        //!< Did we store the taxa and parameters?
+        std::vector<long>                           taxon_indices;                                                          //!< The index of the taxon of each node (-1 if it has none)
+        std::vector<Taxon>                          taxa;                                                                   //!< The taxa of the nodes that have one
+        std::map<size_t, std::vector<std::string> > node_parameters;                                                        //!< The node comments of the nodes that have some
+        std::map<size_t, std::vector<std::string> > branch_parameters;                                                      //!< The branch comments of the nodes that have some
+        std::vector<size_t>                         stack;                                                                  //!< Work space for the traversals
+
+    };
+
+}
+
+#endif
@@ -337,17 +337,34 @@ void TopologyNode::addNodeParameters(std::string const &n, const std::vector<std
 
 
 /*
- * Build newick string.
- * If simmap = true build a newick string compatible with SIMMAP and phytools.
+ * Append the digits of a number with 6 decimals (as std::fixed with precision 6) to the newick string.
  */
-std::string TopologyNode::buildNewickString( bool simmap = false )
+static void appendFixed(std::string &newick, double x)
 {
+    char buffer[64];
+    int n = snprintf( buffer, sizeof(buffer), "%.6f", x );
+    if ( n >= int(sizeof(buffer)) )
+    {
+        // very large numbers don't fit into the buffer
+        std::vector<char> large_buffer( n+1 );
+        snprintf( &large_buffer[0], large_buffer.size(), "%.6f", x );
+        newick.append( &large_buffer[0], n );
+    }
+    else if ( n > 0 )
+    {
+        newick.append( buffer, n );
+    }
+}
 
-    // create the newick string
-    std::stringstream o;
 
-    std::fixed(o);
-    o.precision( 6 );
+/*
+ * Append the newick string of the subtree rooted at this node.
+ * If simmap = true build a newick string compatible with SIMMAP and phytools.
+ * We append to a single string instead of concatenating the strings of the subtrees,
+ * so that writing a tree needs (almost) no memory allocations if the string is reused.
+ */
+void TopologyNode::appendNewickString( std::string &o, bool simmap )
+{
 
     std::vector<std::string> fossil_comments;
 
@@ -361,14 +378,14 @@ std::string TopologyNode::buildNewickString( bool simmap = false )
     if ( tip_node == true )
     {
         // this is a tip so we just return the name of the node
-        o << taxon.getName();
+        o += taxon.getName();
 
     }
     else
     {
         std::string fossil_name = "";
 
-        o << "(";
+        o += '(';
         size_t j = 0;
         for (size_t i=0; i< children.size(); i++)
         {
@@ -383,27 +400,30 @@ std::string TopologyNode::buildNewickString( bool simmap = false )
             {
                 if (j > 0)
                 {
-                    o << ",";
+                    o += ',';
                 }
                 j++;
-                o << children[i]->buildNewickString( simmap );
+                children[i]->appendNewickString( o, simmap );
             }
         }
 
-        o << ")" << fossil_name;
+        o += ')';
+        o += fossil_name;
 
     }
 
     if ( ( node_comments.size() + fossil_comments.size() > 0 || RbSettings::userSettings().getPrintNodeIndex() == true ) && simmap == false )
     {
-        o << "[&";
+        o += "[&";
 
         bool needsComma = false;
 
         // first let us print the node index, we must increment by 1 to match RevLanguage indexing
         if ( RbSettings::userSettings().getPrintNodeIndex() == true )
         {
-            o << "index=" << index+1;
+            char buffer[32];
+            int n = snprintf( buffer, sizeof(buffer), "index=%lu", (unsigned long)(index+1) );
+            o.append( buffer, n );
             needsComma = true;
         }
 
@@ -411,9 +431,9 @@ std::string TopologyNode::buildNewickString( bool simmap = false )
         {
             if ( needsComma == true )
             {
-                o << ",";
+                o += ',';
             }
-            o << node_comments[i];
+            o += node_comments[i];
             needsComma = true;
         }
 
@@ -421,20 +441,13 @@ std::string TopologyNode::buildNewickString( bool simmap = false )
         {
             if ( needsComma == true )
             {
-                o << ",";
+                o += ',';
             }
-            o << fossil_comments[i];
+            o += fossil_comments[i];
             needsComma = true;
         }
 
-        //Finally let's print the species name (always)
-//        if ( needsComma == true )
-//        {
-//            o << ",";
-//        }
-//        o << "&species=" << getSpeciesName();
-
-        o << "]";
+        o += ']';
     }
 
     if ( simmap == false )
@@ -443,7 +456,8 @@ std::string TopologyNode::buildNewickString( bool simmap = false )
 
         if( RevBayesCore::RbMath::isNan(br) == false )
         {
-            o << ":" << br;
+            o += ':';
+            appendFixed( o, br );
         }
     }
     else
@@ -453,9 +467,10 @@ std::string TopologyNode::buildNewickString( bool simmap = false )
             bool found = false;
             for (size_t i = 0; i < node_comments.size(); ++i)
             {
-                if ( node_comments[i].substr(0, 18) == "character_history=" )
+                if ( node_comments[i].compare(0, 18, "character_history=") == 0 )
                 {
-                    o << ":" << node_comments[i].substr(18, node_comments[i].length());
+                    o += ':';
+                    o.append( node_comments[i], 18, std::string::npos );
                     found = true;
                     break;
                 }
@@ -469,24 +484,37 @@ std::string TopologyNode::buildNewickString( bool simmap = false )
 
     if ( branch_comments.size() > 0 && simmap == false )
     {
-        o << "[&";
+        o += "[&";
         for (size_t i = 0; i < branch_comments.size(); ++i)
         {
             if ( i > 0 )
             {
-                o << ",";
+                o += ',';
             }
-            o << branch_comments[i];
+            o += branch_comments[i];
         }
-        o << "]";
+        o += ']';
     }
 
     if ( root_node == true )
     {
-        o << ";";
+        o += ';';
     }
 
-    return o.str();
+}
+
+
+/*
+ * Build newick string.
+ * If simmap = true build a newick string compatible with SIMMAP and phytools.
+ */
+std::string TopologyNode::buildNewickString( bool simmap = false )
+{
+
+    std::string newick;
+    appendNewickString( newick, simmap );
+
+    return newick;
 }
 
 
@@ -544,6 +572,15 @@ std::string TopologyNode::computeNewick( void )
 }
 
 
+/* Compute the newick string into the given string, reusing its memory */
+void TopologyNode::computeNewick( std::string &newick )
+{
+
+    newick.clear();
+    appendNewickString( newick, false );
+}
+
+
 /* Build newick string */
 std::string TopologyNode::computePlainNewick( void ) const
 {
@@ -1779,6 +1816,14 @@ void TopologyNode::setBranchLength(double b, bool flag_dirty)
 }
 
 
+void TopologyNode::setBranchParameters(const std::vector<std::string> &c)
+{
+
+    branch_comments = c;
+
+}
+
+
 void TopologyNode::setIndex( size_t idx)
 {
 
@@ -1795,6 +1840,13 @@ void TopologyNode::setName(std::string const &n)
 
 }
 
+void TopologyNode::setNodeParameters(const std::vector<std::string> &c)
+{
+
+    node_comments = c;
+
+}
+
 //SK
 void TopologyNode::setNodeType(bool tip, bool root, bool interior)
 {
@@ -80,6 +80,7 @@ namespace RevBayesCore {
         void                                        clearBranchParameters(void);
 		void                                        clearNodeParameters(void);
         virtual std::string                         computeNewick(void);                                                                //!< Compute the newick string for this clade
+        void                                        computeNewick(std::string &newick);                                                 //!< Compute the newick string for this clade into a reusable string
         std::string                                 computePlainNewick(void) const;                                                     //!< Compute the newick string for this clade as a plain string without branch length
         std::string                                 computeSimmapNewick(void);                                                          //!< Compute the newick string compatible with SIMMAP and phytools
         bool                                        containsClade(const TopologyNode* c, bool strict) const;
@@ -139,9 +140,11 @@ namespace RevBayesCore {
         void                                        removeTree(Tree *t);                                                                //!< Removes the tree pointer
         void                                        setAge(double a, bool propagate = true );                                           //!< Set the age of this node (should only be done for tips).
         void                                        setBranchLength(double b, bool flag_dirty=true);                                    //!< Set the length of the branch leading to this node.
+        void                                        setBranchParameters(const std::vector<std::string> &c);                             //!< Set the branch comments (e.g., "name=value") as they are
         void                                        setIndex(size_t idx);                                                               //!< Set the index of the node
 
         void                                        setName(const std::string& n);                                                      //!< Set the name of this node
+        void                                        setNodeParameters(const std::vector<std::string> &c);                               //!< Set the node comments (e.g., "name=value") as they are
   		void										setNodeType(bool tip, bool root, bool interior); //SK
         void                                        setParent(TopologyNode* p);                                                         //!< Sets the node's parent
         void                                        setSampledAncestor(bool tf);                                                        //!< Set if the node is a sampled ancestor
@@ -159,6 +162,7 @@ namespace RevBayesCore {
         
         // helper methods
         virtual std::string                         buildNewickString(bool simmap);                                                     //!< compute the newick string for a tree rooting at this node
+        void                                        appendNewickString(std::string &newick, bool simmap);                               //!< append the newick string for a tree rooting at this node
         
         // protected members
         bool                                        use_ages;
@@ -22,6 +22,7 @@
 #include "RbFileManager.h"
 #include "StringUtilities.h"
 #include "TaxonMap.h"
+#include "TreeBipartitionIndex.h"
 #include "TreeChangeEventHandler.h"
 
 namespace RevBayesCore { class AbstractHomologousDiscreteCharacterData; }
@@ -36,7 +37,8 @@ Tree::Tree(void) :
     rooted( false ),
     is_negative_constraint( false ),
     num_tips( 0 ),
-    num_nodes( 0 )
+    num_nodes( 0 ),
+    bipartition_index( NULL )
 {
 
 }
@@ -50,7 +52,8 @@ Tree::Tree(const Tree& t) :
     is_negative_constraint( t.is_negative_constraint ),
     num_tips( t.num_tips ),
     num_nodes( t.num_nodes ),
-    taxon_bitset_map( t.taxon_bitset_map )
+    taxon_bitset_map( t.taxon_bitset_map ),
+    bipartition_index( NULL )
 {
 
     // need to perform a deep copy of the BranchLengthTree nodes
@@ -77,6 +80,7 @@ Tree::~Tree(void)
         changeEventHandler.removeListener( *it );
     }
 
+    delete bipartition_index;
     delete root;
 
 }
@@ -641,6 +645,16 @@ const TopologyNode& Tree::getInteriorNode( size_t indx ) const
 TopologyNode& Tree::getMrca(const Clade &c)
 {
 
+    if ( bipartition_index != NULL && c.getBitRepresentation().size() == num_tips )
+    {
+        const TopologyNode *mrca = bipartition_index->getMrca( c, false );
+        if ( mrca == NULL )
+        {
+            throw RbException("Could not find the MRCA of the clade in the tree.");
+        }
+        return *nodes[ mrca->getIndex() ];
+    }
+
     return *(root->getMrca( c ));
 }
 
@@ -648,12 +662,22 @@ TopologyNode& Tree::getMrca(const Clade &c)
 const TopologyNode& Tree::getMrca(const Clade &c) const
 {
 
-    return *(root->getMrca( c ));
+    return getMrca( c, false );
 }
 
 const TopologyNode& Tree::getMrca(const Clade &c, bool strict) const
 {
 
+    if ( bipartition_index != NULL && c.getBitRepresentation().size() == num_tips )
+    {
+        const TopologyNode *mrca = bipartition_index->getMrca( c, strict );
+        if ( mrca == NULL )
+        {
+            throw RbException("Could not find the MRCA of the clade in the tree.");
+        }
+        return *mrca;
+    }
+
     return *(root->getMrca( c,strict ));
 }
 
@@ -672,6 +696,13 @@ std::string Tree::getNewickRepresentation() const
 }
 
 
+void Tree::getNewickRepresentation(std::string &newick) const
+{
+
+    root->computeNewick( newick );
+}
+
+
 
 TopologyNode& Tree::getNode(size_t idx)
 {
@@ -724,6 +755,23 @@ std::vector<RbBitSet> Tree::getNodesAsBitset(void) const
 }
 
 
+/**
+ * Get the clade index of this tree.
+ * The index is created on first use and from then on kept up-to-date incrementally by listening to the topology changes of this tree.
+ */
+TreeBipartitionIndex& Tree::getBipartitionIndex(void) const
+{
+
+    if ( bipartition_index == NULL )
+    {
+        bipartition_index = new TreeBipartitionIndex( this );
+        changeEventHandler.addListener( bipartition_index );
+    }
+
+    return *bipartition_index;
+}
+
+
 std::map<RbBitSet, TopologyNode*> Tree::getBitsetToNodeMap(void) const
 {
 
@@ -1054,6 +1102,12 @@ std::vector<TopologyNode*> Tree::getTipNodesWithSpeciesName( const std::string &
 double Tree::getTmrca(const Clade &c)
 {
 
+    if ( bipartition_index != NULL && c.getBitRepresentation().size() == num_tips )
+    {
+        const TopologyNode *mrca = bipartition_index->getMrca( c, false );
+        return ( mrca == NULL ? -1 : mrca->getAge() );
+    }
+
     return root->getTmrca( c );
 }
 
@@ -1710,6 +1764,11 @@ void Tree::setRoot( TopologyNode* r, bool reindex )
         delete old_root;
     }
 
+    if ( bipartition_index != NULL )
+    {
+        bipartition_index->invalidate();
+    }
+
 
 }
 
@@ -1743,6 +1802,11 @@ void Tree::setTaxonName(const std::string& current_name, const std::string& newN
     t.setName( newName );
     taxon_bitset_map.erase( current_name );
     taxon_bitset_map.insert( std::pair<std::string, size_t>( newName, node.getIndex() ) );
+
+    if ( bipartition_index != NULL )
+    {
+        bipartition_index->invalidate();
+    }
 }
 
 
@@ -1763,6 +1827,10 @@ void Tree::setTaxonObject(const std::string& current_name, const Taxon& new_taxo
     taxon_bitset_map.erase( current_name );
     taxon_bitset_map.insert( std::pair<std::string, size_t>( new_name, node.getIndex() ) );
 
+    if ( bipartition_index != NULL )
+    {
+        bipartition_index->invalidate();
+    }
 }
 
 
@@ -36,6 +36,7 @@
 namespace RevBayesCore {
 
     class TopologyNode;
+    class TreeBipartitionIndex;
 
     class Tree : public Cloneable, public MemberObject<double>, public MemberObject<long>, public MemberObject<Boolean>, public Serializable {
 
@@ -74,6 +75,7 @@ namespace RevBayesCore {
         void                                                executeMethod(const std::string &n, const std::vector<const DagNode*> &args, double &rv) const;     //!< Map the member methods to internal function calls
         void                                                executeMethod(const std::string &n, const std::vector<const DagNode*> &args, long &rv) const;       //!< Map the member methods to internal function calls
         void                                                executeMethod(const std::string &n, const std::vector<const DagNode*> &args, Boolean &rv) const;    //!< Map the member methods to internal function calls
+        TreeBipartitionIndex&                               getBipartitionIndex(void) const;                                                                    //!< Get the clade index of this tree (created on first use)
         std::map<RbBitSet, TopologyNode*>                   getBitsetToNodeMap(void) const;                                                                     //!< Get a map between node bitsets and nodes in the Tree
         std::vector<Taxon>                                  getFossilTaxa() const;                                                                              //!< Get all the taxa in the tree
         const TopologyNode&                                 getMrca(const TopologyNode &n) const;
@@ -81,6 +83,7 @@ namespace RevBayesCore {
         const TopologyNode&                                 getMrca(const Clade &c) const;
         const TopologyNode&                                 getMrca(const Clade &c, bool strict) const;
         std::string                                         getNewickRepresentation() const;                                                                    //!< Get the newick representation of this Tree
+        void                                                getNewickRepresentation(std::string &newick) const;                                                 //!< Get the newick representation of this Tree into a reusable string
         TopologyNode&                                       getNode(size_t idx);                                                                                //!< Get the node at index
         const TopologyNode&                                 getNode(size_t idx) const;                                                                          //!< Get the node at index
         const std::vector<TopologyNode*>&                   getNodes(void) const;                                                                               //!< Get a pointer to the nodes in the Tree
@@ -161,6 +164,7 @@ namespace RevBayesCore {
         size_t                                              num_tips;
         size_t                                              num_nodes;
         mutable std::map<std::string, size_t>               taxon_bitset_map;
+        mutable TreeBipartitionIndex*                       bipartition_index;                                                      //!< Optional clade index, NULL until requested
 
     };
 
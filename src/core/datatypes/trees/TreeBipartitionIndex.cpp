@@ -0,0 +1,379 @@
+#include "TreeBipartitionIndex.h"
+
+#include <map>
+#include <string>
+
+#include "Clade.h"
+#include "RbException.h"
+#include "TopologyNode.h"
+#include "Tree.h"
+#include "TreeChangeEventMessage.h"
+
+using namespace RevBayesCore;
+
+
+TreeBipartitionIndex::TreeBipartitionIndex(const Tree *t) :
+    tree( t ),
+    needs_rebuild( true ),
+    has_unary_nodes( false )
+{
+
+}
+
+
+TreeBipartitionIndex::~TreeBipartitionIndex( void )
+{
+
+}
+
+
+/**
+ * The tree has changed. For topology changes we only remember which node was touched.
+ * The bitsets are recomputed lazily for this node and its ancestors on the next query.
+ */
+void TreeBipartitionIndex::fireTreeChangeEvent(const TopologyNode &n, const unsigned& m)
+{
+
+    if ( m == TreeChangeEventMessage::DEFAULT || m == TreeChangeEventMessage::TOPOLOGY )
+    {
+
+        if ( needs_rebuild == false )
+        {
+            dirty_nodes.push_back( std::pair<const TopologyNode*, size_t>( &n, n.getIndex() ) );
+
+            // if basically the whole tree was touched, then a rebuild is cheaper
+            if ( dirty_nodes.size() > node_bitsets.size() )
+            {
+                invalidate();
+            }
+        }
+
+    }
+
+}
+
+
+const RbBitSet& TreeBipartitionIndex::getBitset(const TopologyNode &n)
+{
+
+    update();
+
+    return node_bitsets[ n.getIndex() ];
+}
+
+
+/**
+ * Get the most recent common ancestor, that is, the youngest node containing all taxa of the bitset.
+ * If several nodes have exactly this bitset, then the oldest of them is returned,
+ * which is the same node as returned by TopologyNode::getMrca().
+ */
+const TopologyNode* TreeBipartitionIndex::getMrca(const RbBitSet &b)
+{
+
+    update();
+
+    if ( isCompatible(b) == false )
+    {
+        throw RbException("Cannot retrieve a node because of a problem in bit representation of clades.");
+    }
+
+    // first try an exact match
+    std::unordered_map<RbBitSet, const TopologyNode*, RbBitSetHash>::const_iterator it = bitset_to_node.find( b );
+    if ( it != bitset_to_node.end() )
+    {
+        return it->second;
+    }
+
+    // collect the taxa of the clade
+    std::vector<size_t> taxa;
+    for (size_t i=0; i<b.size(); ++i)
+    {
+        if ( b.isSet(i) == true )
+        {
+            taxa.push_back( i );
+        }
+    }
+
+    if ( taxa.empty() == true )
+    {
+        return NULL;
+    }
+
+    // walk from one of the tips towards the root until we find a node containing all taxa
+    const TopologyNode *node = tip_for_bit[ taxa[0] ];
+    while ( node != NULL )
+    {
+        const RbBitSet &node_bitset = node_bitsets[ node->getIndex() ];
+
+        bool contains_all = true;
+        for (size_t i=1; i<taxa.size(); ++i)
+        {
+            if ( node_bitset.isSet( taxa[i] ) == false )
+            {
+                contains_all = false;
+                break;
+            }
+        }
+
+        if ( contains_all == true )
+        {
+            return node;
+        }
+
+        node = ( node->isRoot() ? NULL : &node->getParent() );
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Get the MRCA of the clade.
+ * By strict we mean that the clade has to be monophyletic, i.e., we need an exact match.
+ */
+const TopologyNode* TreeBipartitionIndex::getMrca(const Clade &c, bool strict)
+{
+
+    if ( strict == true )
+    {
+        update();
+
+        if ( isCompatible( c.getBitRepresentation() ) == false )
+        {
+            throw RbException("Cannot retrieve a node because of a problem in bit representation of clades.");
+        }
+
+        return getNode( c.getBitRepresentation() );
+    }
+    else
+    {
+        return getMrca( c.getBitRepresentation() );
+    }
+
+}
+
+
+const TopologyNode* TreeBipartitionIndex::getNode(const RbBitSet &b)
+{
+
+    update();
+
+    std::unordered_map<RbBitSet, const TopologyNode*, RbBitSetHash>::const_iterator it = bitset_to_node.find( b );
+
+    return ( it == bitset_to_node.end() ? NULL : it->second );
+}
+
+
+bool TreeBipartitionIndex::hasClade(const RbBitSet &b)
+{
+
+    return getNode( b ) != NULL;
+}
+
+
+void TreeBipartitionIndex::insertBitset(const TopologyNode *n)
+{
+
+    const RbBitSet &b = node_bitsets[ n->getIndex() ];
+
+    std::unordered_map<RbBitSet, const TopologyNode*, RbBitSetHash>::iterator it = bitset_to_node.find( b );
+    if ( it == bitset_to_node.end() )
+    {
+        bitset_to_node.insert( std::pair<RbBitSet, const TopologyNode*>( b, n ) );
+    }
+    else if ( it->second != n )
+    {
+        // several nodes with the same bitset only happen with nodes of degree two.
+        // we keep the oldest node of these.
+        has_unary_nodes = true;
+
+        const TopologyNode *ancestor = n;
+        bool other_is_ancestor = false;
+        while ( ancestor->isRoot() == false )
+        {
+            ancestor = &ancestor->getParent();
+            if ( ancestor == it->second )
+            {
+                other_is_ancestor = true;
+                break;
+            }
+        }
+
+        if ( other_is_ancestor == false )
+        {
+            it->second = n;
+        }
+
+    }
+
+}
+
+
+void TreeBipartitionIndex::invalidate( void )
+{
+
+    needs_rebuild = true;
+    dirty_nodes.clear();
+
+}
+
+
+bool TreeBipartitionIndex::isCompatible(const RbBitSet &b) const
+{
+
+    return b.size() == tip_for_bit.size();
+}
+
+
+void TreeBipartitionIndex::rebuild( void )
+{
+
+    const std::vector<TopologyNode*> &nodes = tree->getNodes();
+    size_t num_nodes = nodes.size();
+    size_t num_tips  = tree->getNumberOfTips();
+
+    for (size_t i=0; i<num_nodes; ++i)
+    {
+        if ( nodes[i]->getIndex() >= num_nodes )
+        {
+            throw RbException("Cannot build the clade index of a tree with invalid node indices.");
+        }
+    }
+
+    node_bitsets    = std::vector<RbBitSet>( num_nodes, RbBitSet( num_tips ) );
+    stale           = std::vector<bool>( num_nodes, false );
+    tip_for_bit     = std::vector<const TopologyNode*>( num_tips, NULL );
+    has_unary_nodes = false;
+    bitset_to_node.clear();
+
+    recursivelyUpdateBitsets( &tree->getRoot(), true );
+
+    for (size_t i=0; i<num_nodes; ++i)
+    {
+        insertBitset( nodes[i] );
+    }
+
+    dirty_nodes.clear();
+    needs_rebuild = false;
+
+}
+
+
+void TreeBipartitionIndex::recursivelyUpdateBitsets(const TopologyNode *n, bool full)
+{
+
+    size_t idx = n->getIndex();
+    if ( full == false && stale[idx] == false )
+    {
+        return;
+    }
+
+    RbBitSet b( tip_for_bit.size() );
+    if ( n->isTip() == true )
+    {
+        const std::map<std::string, size_t> &taxon_map = tree->getTaxonBitSetMap();
+        std::map<std::string, size_t>::const_iterator it = taxon_map.find( n->getName() );
+        if ( it == taxon_map.end() )
+        {
+            throw RbException("Could not find taxon with name '" + n->getName() + "'.");
+        }
+        b.set( it->second );
+        tip_for_bit[ it->second ] = n;
+    }
+    else
+    {
+        const std::vector<TopologyNode*> &children = n->getChildren();
+        for (size_t i=0; i<children.size(); ++i)
+        {
+            recursivelyUpdateBitsets( children[i], full );
+            b |= node_bitsets[ children[i]->getIndex() ];
+        }
+    }
+
+    node_bitsets[idx] = b;
+    stale[idx] = false;
+
+}
+
+
+/**
+ * Bring the index up-to-date with the current topology.
+ * We recompute only the nodes touched since the last update and their ancestors.
+ */
+void TreeBipartitionIndex::update( void )
+{
+
+    const std::vector<TopologyNode*> &nodes = tree->getNodes();
+
+    if ( needs_rebuild == true || node_bitsets.size() != nodes.size() || tip_for_bit.size() != tree->getNumberOfTips() )
+    {
+        rebuild();
+        return;
+    }
+
+    if ( dirty_nodes.empty() == true )
+    {
+        return;
+    }
+
+    if ( has_unary_nodes == true )
+    {
+        // the bookkeeping of identical bitsets is not incremental
+        rebuild();
+        return;
+    }
+
+    // flag the touched nodes and all their ancestors
+    std::vector<const TopologyNode*> stale_nodes;
+    for (size_t i=0; i<dirty_nodes.size(); ++i)
+    {
+        const TopologyNode *n = dirty_nodes[i].first;
+        size_t idx            = dirty_nodes[i].second;
+
+        // the node could have been removed from the tree or re-indexed
+        if ( idx >= nodes.size() || nodes[idx] != n || n->getIndex() != idx )
+        {
+            rebuild();
+            return;
+        }
+
+        while ( n != NULL && stale[ n->getIndex() ] == false )
+        {
+            stale[ n->getIndex() ] = true;
+            stale_nodes.push_back( n );
+            n = ( n->isRoot() ? NULL : &n->getParent() );
+        }
+    }
+    dirty_nodes.clear();
+
+    // remove the old bitsets of all stale nodes before adding the new ones
+    for (size_t i=0; i<stale_nodes.size(); ++i)
+    {
+        const TopologyNode *n = stale_nodes[i];
+        std::unordered_map<RbBitSet, const TopologyNode*, RbBitSetHash>::iterator it = bitset_to_node.find( node_bitsets[ n->getIndex() ] );
+        if ( it != bitset_to_node.end() && it->second == n )
+        {
+            bitset_to_node.erase( it );
+        }
+    }
+
+    // the root is an ancestor of every touched node, so it is stale too
+    recursivelyUpdateBitsets( &tree->getRoot(), false );
+
+    for (size_t i=0; i<stale_nodes.size(); ++i)
+    {
+        // a touched node that is not below the current root means that the tree was restructured
+        if ( stale[ stale_nodes[i]->getIndex() ] == true )
+        {
+            rebuild();
+            return;
+        }
+        insertBitset( stale_nodes[i] );
+    }
+
+    if ( has_unary_nodes == true )
+    {
+        rebuild();
+    }
+
+}
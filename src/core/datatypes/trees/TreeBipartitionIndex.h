@@ -0,0 +1,73 @@
+#ifndef TreeBipartitionIndex_H
+#define TreeBipartitionIndex_H
+
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+#include "RbBitSet.h"
+#include "TreeChangeEventListener.h"
+
+namespace RevBayesCore {
+
+    class Clade;
+    class TopologyNode;
+    class Tree;
+
+    /**
+     * @brief Persistent clade (bipartition) index of a tree.
+     *
+     * The index stores for every node of the tree the bitset of taxa descending from it,
+     * and a hash map from these bitsets back to the nodes. The bitsets use the same
+     * taxon ordering as Tree::getTaxonBitSetMap(), so clades initialized with
+     * Clade::resetTaxonBitset() can be queried directly.
+     *
+     * The index listens to the tree-change events of its tree. Topology events only record
+     * which nodes were touched; the bitsets of these nodes and of their ancestors are recomputed
+     * lazily on the next query. Hence, clade lookups after a local topology move (NNI, SPR, ...)
+     * only cost the length of the affected paths instead of a full scan of the tree.
+     *
+     * The index is owned by its tree and is created on first use by Tree::getBipartitionIndex().
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class TreeBipartitionIndex : public TreeChangeEventListener {
+
+    public:
+        TreeBipartitionIndex(const Tree *t);                                                                    //!< Constructor
+        virtual                                    ~TreeBipartitionIndex(void);                                 //!< Destructor
+
+        // public methods
+        void                                        fireTreeChangeEvent(const TopologyNode &n, const unsigned& m=0); //!< The tree has changed and we want to know which part
+        const RbBitSet&                             getBitset(const TopologyNode &n);                           //!< Get the taxon bitset of this node
+        const TopologyNode*                         getMrca(const RbBitSet &b);                                 //!< Get the youngest node containing all taxa of the bitset (or NULL)
+        const TopologyNode*                         getMrca(const Clade &c, bool strict);                       //!< Get the MRCA of the clade (or NULL)
+        const TopologyNode*                         getNode(const RbBitSet &b);                                 //!< Get the node with exactly this bitset (or NULL)
+        bool                                        hasClade(const RbBitSet &b);                                //!< Does the tree contain a node with exactly this bitset?
+        void                                        invalidate(void);                                           //!< Force a full rebuild on the next query
+        void                                        update(void);                                               //!< Bring the index up-to-date now instead of on the next query
+
+    private:
+
+        void                                        insertBitset(const TopologyNode *n);
+        bool                                        isCompatible(const RbBitSet &b) const;
+        void                                        rebuild(void);
+        void                                        recursivelyUpdateBitsets(const TopologyNode *n, bool full);
+
+        // members
+        const Tree*                                 tree;                                                       //!< The tree which owns this index
+        bool                                        needs_rebuild;                                              //!< Do we need to rebuild everything?
+        bool                                        has_unary_nodes;                                            //!< Are there several nodes with identical bitsets?
+        std::vector< std::pair<const TopologyNode*, size_t> >   dirty_nodes;                                    //!< Nodes touched by topology events (with their index at that time)
+        std::vector<bool>                           stale;                                                      //!< Flags for nodes whose bitsets need recomputation
+        std::vector<RbBitSet>                       node_bitsets;                                               //!< The bitset of each node, by node index
+        std::vector<const TopologyNode*>            tip_for_bit;                                                //!< The tip node of each bit position
+        std::unordered_map<RbBitSet, const TopologyNode*, RbBitSetHash>     bitset_to_node;                     //!< The node for each bitset
+
+    };
+
+}
+
+#endif
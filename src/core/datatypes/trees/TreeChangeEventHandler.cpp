@@ -45,6 +45,7 @@ TreeChangeEventHandler& TreeChangeEventHandler::operator=(const TreeChangeEventH
 void TreeChangeEventHandler::addListener(TreeChangeEventListener *l) 
 {
     
+    std::lock_guard<std::mutex> lock( mutex );
     listeners.insert( l );
     
 }
@@ -72,6 +73,8 @@ const std::set<TreeChangeEventListener*>& TreeChangeEventHandler::getListeners(
 bool TreeChangeEventHandler::isListening(TreeChangeEventListener *l) const
 {
     
+    std::lock_guard<std::mutex> lock( mutex );
+    
     // search the set of listeners
     std::set<TreeChangeEventListener*>::iterator pos = listeners.find( l );
     
@@ -81,6 +84,7 @@ bool TreeChangeEventHandler::isListening(TreeChangeEventListener *l) const
 
 void TreeChangeEventHandler::removeListener(TreeChangeEventListener *l) 
 {
+    std::lock_guard<std::mutex> lock( mutex );
     std::set<TreeChangeEventListener*>::iterator pos = listeners.find( l );
     if ( pos != listeners.end() ) 
     {
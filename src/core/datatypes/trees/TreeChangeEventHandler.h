@@ -20,6 +20,7 @@
 #ifndef TreeChangeEventHandler_H
 #define TreeChangeEventHandler_H
 
+#include <mutex>
 #include <set>
 
 #include "TopologyNode.h"
@@ -28,6 +29,11 @@ namespace RevBayesCore {
     
     class TreeChangeEventListener;
     
+    /**
+     * Adding, removing and looking up listeners is serialized by a mutex, because several likelihoods
+     * of the same tree check in their ln probability computation, which may run concurrently, whether
+     * they are still listening. Firing events must not happen concurrently with changing the listeners.
+     */
     class TreeChangeEventHandler {
         
     public:
@@ -47,6 +53,7 @@ namespace RevBayesCore {
         
     private:
         std::set<TreeChangeEventListener*>          listeners;
+        mutable std::mutex                          mutex;                                                          //!< Serializes changing and looking up the listeners
     };
 
 }
@@ -90,6 +90,19 @@ void Distribution::bootstrap( void )
 }
 
 
+/**
+ * Compute the gradient of the ln probability with respect to the parameter p.
+ * If p is the stochastic node holding this distribution, then the gradient is with respect to the value instead.
+ * Distributions that can compute the gradient analytically override this method, fill in g (one element
+ * per element of p) and return true. By default we return false so that callers fall back to numerical derivatives.
+ */
+bool Distribution::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+    // not implemented
+    return false;
+}
+
+
 /**
  * Add this parameter to our set of parameters.
  */
@@ -155,6 +168,18 @@ void Distribution::keepSpecialization( DagNode* affecter )
 }
 
 
+/**
+ * Prepare the computation of the ln probability.
+ * The ln probabilities of several nodes may be computed concurrently (see LnProbabilityEvaluator), and this is
+ * called for each of them in one thread beforehand. Distributions that lazily initialize state which they share
+ * with other distributions, e.g., event listeners or caches of their parameters, should do so here.
+ */
+void Distribution::prepareLnProbability( void )
+{
+    // do nothing
+}
+
+
 /* Method stub: override for specialized treatment. */
 void Distribution::reInitialized( void )
 {
@@ -43,10 +43,12 @@ namespace RevBayesCore {
         
         // public methods
         virtual void                                            bootstrap(void);                                                              //!< Draw a new random value from the distribution
+        virtual bool                                            computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);             //!< Compute the gradient of the ln probability with respect to a parameter or the value, if implemented
         virtual RevLanguage::RevPtr<RevLanguage::RevVariable>   executeProcedure(const std::string &n, const std::vector<DagNode*> args, bool &f);  //!< execute the procedure
         virtual void                                            getAffected(RbOrderedSet<DagNode *>& affected, DagNode* affecter);                  //!< get affected nodes
         const std::vector<const DagNode*>&                      getParameters(void) const;                                                          //!< get the parameters of the function
         void                                                    keep(DagNode* affecter);
+        virtual void                                            prepareLnProbability(void);                                                         //!< Bring shared state up to date before the ln probability is computed concurrently
         virtual void                                            reInitialized( void );                                                              //!< The model was re-initialized
         void                                                    restore(DagNode *restorer);
         virtual void                                            setMcmcMode(bool tf);                                                               //!< Change the likelihood computation to or from MCMC mode.
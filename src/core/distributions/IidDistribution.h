@@ -1,7 +1,13 @@
 #ifndef IidDistribution_H
 #define IidDistribution_H
 
+#include <stddef.h>
+#include <set>
+#include <utility>
+#include <vector>
+
 #include "RbVector.h"
+#include "StochasticNode.h"
 #include "TypedDagNode.h"
 #include "TypedDistribution.h"
 
@@ -9,13 +15,15 @@ namespace RevBayesCore {
     
     
     /**
-     * This class implements a generic mixture distribution between several possible values.
+     * This class implements a vector of independent and identically distributed values.
      *
-     * This mixture can be considered as a multinomial distribution. We specify a vector of probabilities
-     * and a vector of values. Then, a value drawn from this distribution takes each value corresponding to
-     * its probability.
-     * The values are already of the correct mixture type. You may want to apply a mixture allocation move
-     * to change between the current value. The values themselves change automatically when the input parameters change.
+     * All n values are drawn from the same distribution, so that n values (e.g., the rates of all branches)
+     * can be represented by a single vector-valued stochastic node instead of n scalar nodes.
+     * We store the ln probability of every element. If a move changed only some elements and
+     * told us which ones (DagNode::addTouchedElementIndex), then we only recompute these elements,
+     * so that the cost of a single-element move does not depend on the number of elements.
+     * If the parameters of the distribution changed, or the touched elements are unknown, we recompute all elements.
+     * The previous ln probabilities are kept for a restore.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -36,18 +44,29 @@ namespace RevBayesCore {
         
     protected:
         // Parameter management functions
+        void                                                keepSpecialization(DagNode* affecter);
+        void                                                restoreSpecialization(DagNode *restorer);
         void                                                swapParameterInternal(const DagNode *oldP, const DagNode *newP);                        //!< Swap a parameter
+        void                                                touchSpecialization(DagNode *toucher, bool touchAll);
         
         
     private:
         
         // helper methods
+        double                                              computeElementLnProbability(size_t i);                                              //!< The ln probability of the i-th value
         void                                                simulate();
         
         // private members
         long                                                n_samples;
         TypedDistribution<valueType>*                       value_prior;
         
+        std::vector<double>                                 element_ln_probs;                                                                   //!< The ln probability of each value
+        std::vector<double>                                 stored_element_ln_probs;                                                            //!< The ln probabilities before all of them were recomputed
+        std::vector<std::pair<size_t, double> >             stored_elements;                                                                    //!< The previous ln probabilities of the recomputed elements, in the order of recomputation
+        bool                                                stored_all;                                                                         //!< Did we store all ln probabilities?
+        std::vector<size_t>                                 dirty_elements;                                                                     //!< The elements that need to be recomputed
+        bool                                                all_dirty;                                                                          //!< Do all elements need to be recomputed?
+        
     };
     
 }
@@ -62,7 +81,9 @@ namespace RevBayesCore {
 template <class valueType>
 RevBayesCore::IidDistribution<valueType>::IidDistribution(long n, TypedDistribution<valueType> *vp) : TypedDistribution< RbVector<valueType> >( new RbVector<valueType>() ),
     n_samples( n ),
-    value_prior( vp )
+    value_prior( vp ),
+    stored_all( false ),
+    all_dirty( true )
 {
     // add the parameters to our set (in the base class)
     // in that way other class can easily access the set of our parameters
@@ -82,7 +103,13 @@ RevBayesCore::IidDistribution<valueType>::IidDistribution(long n, TypedDistribut
 template <class valueType>
 RevBayesCore::IidDistribution<valueType>::IidDistribution( const IidDistribution<valueType> &d ) : TypedDistribution< RbVector<valueType> >(d),
     n_samples( d.n_samples ),
-    value_prior( d.value_prior->clone() )
+    value_prior( d.value_prior->clone() ),
+    element_ln_probs( d.element_ln_probs ),
+    stored_element_ln_probs( d.stored_element_ln_probs ),
+    stored_elements( d.stored_elements ),
+    stored_all( d.stored_all ),
+    dirty_elements( d.dirty_elements ),
+    all_dirty( d.all_dirty )
 {
     
     // add the parameters of the distribution
@@ -106,28 +133,93 @@ RevBayesCore::IidDistribution<valueType>* RevBayesCore::IidDistribution<valueTyp
 
 
 
+/**
+ * Compute the ln probability of the vector, recomputing only the ln probabilities of the elements that changed.
+ * Before we overwrite an ln probability, we store the previous one for a restore.
+ */
 template <class valueType>
 double RevBayesCore::IidDistribution<valueType>::computeLnProbability( void )
 {
     
-    double ln_prob = 0.0;
+    size_t n = this->value->size();
     
-    for (int i = 0; i < n_samples; ++i)
+    if ( all_dirty == true || element_ln_probs.size() != n )
     {
         
-        // we also need to multiply with the probability of the value for this table
-        value_prior->setValue( Cloner<valueType, IsDerivedFrom<valueType, Cloneable>::Is >::createClone( this->value->operator[](i) ) );
-        ln_prob += value_prior->computeLnProbability();
+        // store the ln probabilities from before the first change
+        if ( stored_all == false )
+        {
+            stored_element_ln_probs = element_ln_probs;
+            for (size_t k = stored_elements.size(); k > 0; --k)
+            {
+                stored_element_ln_probs[ stored_elements[k-1].first ] = stored_elements[k-1].second;
+            }
+            stored_elements.clear();
+            stored_all = true;
+        }
+        
+        element_ln_probs.resize( n );
+        for (size_t i = 0; i < n; ++i)
+        {
+            element_ln_probs[i] = computeElementLnProbability( i );
+        }
+        
+    }
+    else
+    {
+        
+        for (size_t k = 0; k < dirty_elements.size(); ++k)
+        {
+            size_t i = dirty_elements[k];
+            if ( stored_all == false )
+            {
+                stored_elements.push_back( std::pair<size_t, double>( i, element_ln_probs[i] ) );
+            }
+            element_ln_probs[i] = computeElementLnProbability( i );
+        }
         
     }
     
+    all_dirty = false;
+    dirty_elements.clear();
+    
+    double ln_prob = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        ln_prob += element_ln_probs[i];
+    }
+    
     return ln_prob;
 }
 
 
+template <class valueType>
+double RevBayesCore::IidDistribution<valueType>::computeElementLnProbability( size_t i )
+{
+    
+    value_prior->setValue( Cloner<valueType, IsDerivedFrom<valueType, Cloneable>::Is >::createClone( this->value->operator[](i) ) );
+    
+    return value_prior->computeLnProbability();
+}
+
+
+template <class valueType>
+void RevBayesCore::IidDistribution<valueType>::keepSpecialization( DagNode *affecter )
+{
+    
+    stored_element_ln_probs.clear();
+    stored_elements.clear();
+    stored_all = false;
+    
+}
+
+
 template <class valueType>
 void RevBayesCore::IidDistribution<valueType>::simulate()
 {
+    
+    all_dirty = true;
+    
     // clear the current value
     this->value->clear();
     
@@ -152,6 +244,34 @@ void RevBayesCore::IidDistribution<valueType>::redrawValue( void )
 }
 
 
+/**
+ * Restore the ln probabilities from before the changes, together with the values.
+ */
+template <class valueType>
+void RevBayesCore::IidDistribution<valueType>::restoreSpecialization( DagNode *restorer )
+{
+    
+    if ( stored_all == true )
+    {
+        element_ln_probs.swap( stored_element_ln_probs );
+    }
+    else
+    {
+        for (size_t k = stored_elements.size(); k > 0; --k)
+        {
+            element_ln_probs[ stored_elements[k-1].first ] = stored_elements[k-1].second;
+        }
+    }
+    
+    stored_element_ln_probs.clear();
+    stored_elements.clear();
+    stored_all = false;
+    dirty_elements.clear();
+    all_dirty = ( element_ln_probs.size() != this->value->size() );
+    
+}
+
+
 /** Swap a parameter of the distribution */
 template <class valueType>
 void RevBayesCore::IidDistribution<valueType>::swapParameterInternal( const DagNode *oldP, const DagNode *newP )
@@ -161,5 +281,27 @@ void RevBayesCore::IidDistribution<valueType>::swapParameterInternal( const DagN
     
 }
 
+
+/**
+ * Mark the elements whose ln probability needs to be recomputed.
+ * If our own node was touched with a list of changed elements, then only these need to be recomputed,
+ * otherwise (a parameter changed or we don't know which elements changed) all elements.
+ */
+template <class valueType>
+void RevBayesCore::IidDistribution<valueType>::touchSpecialization( DagNode *toucher, bool touchAll )
+{
+    
+    if ( this->dag_node != NULL && toucher == this->dag_node && touchAll == false && this->dag_node->getTouchedElementIndices().empty() == false )
+    {
+        const std::set<size_t> &touched_indices = this->dag_node->getTouchedElementIndices();
+        dirty_elements.insert( dirty_elements.end(), touched_indices.begin(), touched_indices.end() );
+    }
+    else
+    {
+        all_dirty = true;
+    }
+    
+}
+
 #endif
 
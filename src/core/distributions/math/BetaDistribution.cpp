@@ -1,9 +1,13 @@
 #include "BetaDistribution.h"
 
+#include <cmath>
+
 #include "DistributionBeta.h"
 #include "RandomNumberFactory.h"
 #include "RbConstants.h"
+#include "RbMathFunctions.h"
 #include "Cloneable.h"
+#include "StochasticNode.h"
 #include "TypedDagNode.h"
 
 namespace RevBayesCore { class DagNode; }
@@ -61,6 +65,46 @@ double BetaDistribution::computeLnProbability( void )
 }
 
 
+/**
+ * The gradient of the ln density with respect to the value x or the shape parameters,
+ * i.e., (alpha-1)/x - (beta-1)/(1-x), ln(x) + digamma(alpha+beta) - digamma(alpha)
+ * and ln(1-x) + digamma(alpha+beta) - digamma(beta), respectively.
+ */
+bool BetaDistribution::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    if ( p != dag_node && p != alpha && p != beta )
+    {
+        return false;
+    }
+
+    double a = alpha->getValue();
+    double b = beta->getValue();
+    double v = *value;
+
+    g = std::vector<double>(1, 0.0);
+    if ( v < 0.0 || v > 1.0 )
+    {
+        return true;
+    }
+
+    if ( p == dag_node )
+    {
+        g[0] += (a - 1.0) / v - (b - 1.0) / (1.0 - v);
+    }
+    if ( p == alpha )
+    {
+        g[0] += log(v) + RbMath::digamma(a + b) - RbMath::digamma(a);
+    }
+    if ( p == beta )
+    {
+        g[0] += log1p(-v) + RbMath::digamma(a + b) - RbMath::digamma(b);
+    }
+
+    return true;
+}
+
+
 double BetaDistribution::getMax( void ) const
 {
     return 1.0;
@@ -26,6 +26,7 @@ template <class valueType> class TypedDagNode;
         double                                              cdf(void) const;                                                                  //!< Cumulative density function
         BetaDistribution*                                   clone(void) const;                                                          //!< Create an independent clone
         double                                              computeLnProbability(void);
+        bool                                                computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);    //!< Gradient with respect to the value or the shape parameters
         double                                              getMax(void) const;
         double                                              getMin(void) const;
         double                                              quantile(double p) const;
@@ -1,8 +1,12 @@
 #include "DirichletDistribution.h"
 
+#include <cmath>
+
 #include "DistributionDirichlet.h"
 #include "RandomNumberFactory.h"
+#include "RbMathFunctions.h"
 #include "RbVector.h"
+#include "StochasticNode.h"
 #include "TypedDagNode.h"
 
 namespace RevBayesCore { class DagNode; }
@@ -43,6 +47,63 @@ double DirichletDistribution::computeLnProbability( void )
 }
 
 
+/**
+ * The gradient of the ln density with respect to the value x or the concentration parameters,
+ * i.e., (alpha_i-1)/x_i and ln(x_i) + digamma(sum(alpha)) - digamma(alpha_i), respectively.
+ * The value can only change within the simplex, i.e., along directions whose elements sum to zero.
+ * Hence we project the gradient with respect to the value onto these directions by subtracting its mean.
+ */
+bool DirichletDistribution::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    if ( p != dag_node && p != alpha )
+    {
+        return false;
+    }
+
+    const RbVector<double> &a = alpha->getValue();
+    const Simplex &v = *value;
+    size_t n = v.size();
+
+    double sum_alpha = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        sum_alpha += a[i];
+    }
+    double digamma_sum = RbMath::digamma( sum_alpha );
+
+    g = std::vector<double>(n, 0.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if ( p == dag_node )
+        {
+            g[i] += (a[i] - 1.0) / v[i];
+        }
+        if ( p == alpha )
+        {
+            g[i] += log(v[i]) + digamma_sum - RbMath::digamma(a[i]);
+        }
+    }
+
+    if ( p == dag_node )
+    {
+        double mean = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            mean += (a[i] - 1.0) / v[i];
+        }
+        mean /= n;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            g[i] -= mean;
+        }
+    }
+
+    return true;
+}
+
+
 void DirichletDistribution::redrawValue( void )
 {
     *value = RbStatistics::Dirichlet::rv(alpha->getValue(), *GLOBAL_RNG);
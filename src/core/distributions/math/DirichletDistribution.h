@@ -26,6 +26,7 @@ template <class valueType> class TypedDagNode;
             virtual                                    ~DirichletDistribution(void);                                                //!< Virtual destructor
             DirichletDistribution*                      clone(void) const;                                                          //!< Create an independent clone
             double                                      computeLnProbability(void);                                                 //!< Natural log of the probability density
+            bool                                        computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);    //!< Gradient with respect to the value or the concentration parameters
             void                                        redrawValue(void);
             
         protected:
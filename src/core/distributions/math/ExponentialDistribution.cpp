@@ -6,6 +6,7 @@
 #include "RandomNumberFactory.h"
 #include "Cloneable.h"
 #include "RbConstants.h"
+#include "StochasticNode.h"
 #include "TypedDagNode.h"
 
 namespace RevBayesCore { class DagNode; }
@@ -62,6 +63,39 @@ double ExponentialDistribution::computeLnProbability( void )
 }
 
 
+/**
+ * The gradient of ln(lambda) - lambda*x with respect to the value x or the rate lambda.
+ */
+bool ExponentialDistribution::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    if ( p != dag_node && p != lambda )
+    {
+        return false;
+    }
+
+    double l = lambda->getValue();
+    double v = *value;
+
+    g = std::vector<double>(1, 0.0);
+    if ( v < 0.0 )
+    {
+        return true;
+    }
+
+    if ( p == dag_node )
+    {
+        g[0] += -l;
+    }
+    if ( p == lambda )
+    {
+        g[0] += 1.0 / l - v;
+    }
+
+    return true;
+}
+
+
 double ExponentialDistribution::getMax( void ) const 
 {
     return RbConstants::Double::inf;
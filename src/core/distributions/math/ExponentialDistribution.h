@@ -27,6 +27,7 @@ template <class valueType> class TypedDagNode;
         double                                              cdf(void) const;                                                            //!< Cummulative density function
         ExponentialDistribution*                            clone(void) const;                                                          //!< Create an independent clone
         double                                              computeLnProbability(void);
+        bool                                                computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);    //!< Gradient with respect to the value or the rate
         double                                              getMax(void) const;
         double                                              getMin(void) const;
         double                                              quantile(double p) const;                                                   //!< Qu
@@ -1,9 +1,13 @@
 #include "GammaDistribution.h"
 
+#include <cmath>
+
 #include "DistributionGamma.h"
 #include "RandomNumberFactory.h"
 #include "RbConstants.h"
+#include "RbMathFunctions.h"
 #include "Cloneable.h"
+#include "StochasticNode.h"
 #include "TypedDagNode.h"
 
 namespace RevBayesCore { class DagNode; }
@@ -63,6 +67,45 @@ double GammaDistribution::computeLnProbability( void )
 }
 
 
+/**
+ * The gradient of the ln density with respect to the value x, the shape alpha or the rate beta,
+ * i.e., (alpha-1)/x - beta, ln(beta) - digamma(alpha) + ln(x) and alpha/beta - x, respectively.
+ */
+bool GammaDistribution::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    if ( p != dag_node && p != shape && p != rate )
+    {
+        return false;
+    }
+
+    double a = shape->getValue();
+    double b = rate->getValue();
+    double v = *value;
+
+    g = std::vector<double>(1, 0.0);
+    if ( v < 0.0 )
+    {
+        return true;
+    }
+
+    if ( p == dag_node )
+    {
+        g[0] += (a - 1.0) / v - b;
+    }
+    if ( p == shape )
+    {
+        g[0] += log(b) - RbMath::digamma(a) + log(v);
+    }
+    if ( p == rate )
+    {
+        g[0] += a / b - v;
+    }
+
+    return true;
+}
+
+
 double GammaDistribution::getMax( void ) const {
     return RbConstants::Double::inf;
 }
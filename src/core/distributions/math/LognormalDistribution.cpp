@@ -1,9 +1,12 @@
 #include "LognormalDistribution.h"
 
+#include <cmath>
+
 #include "DistributionLognormal.h"
 #include "RandomNumberFactory.h"
 #include "RbConstants.h"
 #include "Cloneable.h"
+#include "StochasticNode.h"
 #include "TypedDagNode.h"
 
 namespace RevBayesCore { class DagNode; }
@@ -58,6 +61,45 @@ double LognormalDistribution::computeLnProbability( void )
 }
 
 
+/**
+ * The gradient of the ln density with respect to the value x, the mean mu (on the log scale) or the standard deviation sigma.
+ */
+bool LognormalDistribution::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    if ( p != dag_node && p != mean && p != sd )
+    {
+        return false;
+    }
+
+    double mu = mean->getValue();
+    double sigma = sd->getValue();
+    double v = *value;
+
+    g = std::vector<double>(1, 0.0);
+    if ( v <= 0.0 )
+    {
+        return true;
+    }
+
+    double z = (log(v) - mu) / sigma;
+    if ( p == dag_node )
+    {
+        g[0] += -1.0 / v - z / (sigma * v);
+    }
+    if ( p == mean )
+    {
+        g[0] += z / sigma;
+    }
+    if ( p == sd )
+    {
+        g[0] += -1.0 / sigma + z * z / sigma;
+    }
+
+    return true;
+}
+
+
 double LognormalDistribution::getMax( void ) const 
 {
     return RbConstants::Double::inf;
@@ -31,6 +31,7 @@ template <class valueType> class TypedDagNode;
             double                          cdf(void) const;                                                    //!< Cumulative density function
             LognormalDistribution*          clone(void) const;                                                  //!< Create an independent clone
             double                          computeLnProbability(void);                                         //!< Natural log of the probability density
+            bool                            computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);    //!< Gradient with respect to the value, mean or standard deviation
             double                          getMax(void) const;                                                 //!< Maximum value (@f$\infty@f$)
             double                          getMin(void) const;                                                 //!< Minimum value (0)
             double                          quantile(double p) const;                                           //!< Quantile function
@@ -6,6 +6,7 @@
 #include "RbConstants.h"
 #include "Cloneable.h"
 #include "RbException.h"
+#include "StochasticNode.h"
 #include "TypedDagNode.h"
 
 namespace RevBayesCore { class DagNode; }
@@ -67,6 +68,48 @@ double NormalDistribution::computeLnProbability( void )
 }
 
 
+/**
+ * The gradient of the ln density with respect to the value x, the mean mu or the standard deviation sigma.
+ * For a truncated normal distribution the normalizing constant depends on mu and sigma, so we only provide
+ * the gradient with respect to the value.
+ */
+bool NormalDistribution::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    bool truncated = ( min != NULL || max != NULL );
+    if ( p != dag_node && (truncated == true || (p != mean && p != stDev)) )
+    {
+        return false;
+    }
+
+    double mu = mean->getValue();
+    double sigma = stDev->getValue();
+    double v = *value;
+
+    g = std::vector<double>(1, 0.0);
+    if ( v < getMin() || v > getMax() )
+    {
+        return true;
+    }
+
+    double z = (v - mu) / sigma;
+    if ( p == dag_node )
+    {
+        g[0] += -z / sigma;
+    }
+    if ( p == mean )
+    {
+        g[0] += z / sigma;
+    }
+    if ( p == stDev )
+    {
+        g[0] += -1.0 / sigma + z * z / sigma;
+    }
+
+    return true;
+}
+
+
 double NormalDistribution::getMax( void ) const
 {
     if ( max != NULL )
@@ -39,6 +39,7 @@ template <class valueType> class TypedDagNode;
             double                          cdf(void) const;                                                    //!< Cumulative density function
             NormalDistribution*             clone(void) const;                                                  //!< Create an independent clone
             double                          computeLnProbability(void);                                         //!< Natural log of the probability density
+            bool                            computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);    //!< Gradient with respect to the value, mean or standard deviation
             double                          getMax(void) const;                                                 //!< Maximum value (can be set by user)
             double                          getMin(void) const;                                                 //!< Minimum value (can be set by user)
             double                          quantile(double p) const;                                           //!< Quantile function
@@ -11,6 +11,8 @@
 #include "AbstractPhyloBrownianProcess.h"
 #include "ContinuousCharacterData.h"
 #include "ContinuousTaxonData.h"
+#include "RbConstants.h"
+#include "ThreadPool.h"
 #include "Tree.h"
 #include "TreeChangeEventHandler.h"
 #include "TypedDagNode.h"
@@ -22,8 +24,8 @@ using namespace RevBayesCore;
 
 PhyloBrownianProcessREML::PhyloBrownianProcessREML(const TypedDagNode<Tree> *t, size_t ns) :
     AbstractPhyloBrownianProcess( t, ns ),
-    partial_likelihoods( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
-    contrasts( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
+    partial_likelihoods( std::vector<double>(2 * this->num_nodes * this->num_sites, 0) ),
+    contrasts( std::vector<double>(2 * this->num_nodes * this->num_sites, 0) ),
     contrast_uncertainty( std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) ) ),
     active_likelihood( std::vector<size_t>(this->num_nodes, 0) ),
     changed_nodes( std::vector<bool>(this->num_nodes, false) ),
@@ -89,7 +91,8 @@ double PhyloBrownianProcessREML::computeLnProbability( void )
     if ( this->dirty_nodes[rootIndex] )
     {
         
-        
+        // collect the contrast operations of all dirty nodes
+        contrast_operations.clear();
         recursiveComputeLnProbability( root, rootIndex );
         
         // start by filling the likelihood vector for the children of the root
@@ -119,6 +122,19 @@ double PhyloBrownianProcessREML::computeLnProbability( void )
             throw RbException("The root node has an unexpected number of children. Only 2 (for rooted trees) or 3 (for unrooted trees) are allowed.");
         }
         
+        // the site rates are the same for all nodes
+        ln_site_rates.resize( this->num_sites );
+        inverse_squared_site_rates.resize( this->num_sites );
+        for (size_t i = 0; i < this->num_sites; ++i)
+        {
+            double r = this->computeSiteRate(i);
+            ln_site_rates[i]              = log( r );
+            inverse_squared_site_rates[i] = 1.0 / (r*r);
+        }
+        
+        // compute the contrasts, in parallel for blocks of sites if there are many sites
+        size_t site_block_size = 256;
+        parallelFor(0, this->num_sites, [this](size_t first_site, size_t last_site) { computeContrasts(first_site, last_site); }, site_block_size);
         
         // sum the partials up
         this->ln_prob = sumRootLikelihood();
@@ -129,6 +145,56 @@ double PhyloBrownianProcessREML::computeLnProbability( void )
 
 
 
+/**
+ * Apply the contrast operations to the sites [first_site,last_site).
+ * The operations are in post-order, so the values of the children are computed before those of their parents.
+ * The ln density of a contrast with variance rate^2*t is computed as -ln(sqrt(2pi)) - ln(t)/2 - ln(rate) - contrast^2/(2*rate^2*t),
+ * where only the last two terms depend on the site, so that the loop over the sites doesn't call any function.
+ */
+void PhyloBrownianProcessREML::computeContrasts(size_t first_site, size_t last_site)
+{
+    
+    const double *ln_r   = ln_site_rates.data();
+    const double *inv_r2 = inverse_squared_site_rates.data();
+    
+    for (size_t k = 0; k < contrast_operations.size(); ++k)
+    {
+        const ContrastOperation &op = contrast_operations[k];
+        
+        // a multifurcating node is its own left child, hence the node and its left child may be the same
+        double       *p_node   = partial_likelihoods.data() + op.node;
+        double       *mu_node  = contrasts.data() + op.node;
+        const double *p_left   = partial_likelihoods.data() + op.left;
+        const double *p_right  = partial_likelihoods.data() + op.right;
+        const double *mu_left  = contrasts.data() + op.left;
+        const double *mu_right = contrasts.data() + op.right;
+        
+        double t_left         = op.t_left;
+        double t_right        = op.t_right;
+        double t_sum          = t_left + t_right;
+        double ln_norm        = - RbConstants::LN_SQRT_2PI - 0.5 * log(t_sum);
+        double half_precision = 0.5 / t_sum;
+        
+        for (size_t i = first_site; i < last_site; ++i)
+        {
+            // compute the contrasts for this site and node
+            double contrast = mu_left[i] - mu_right[i];
+            
+            // compute the probability for the contrasts at this node
+            double lnl_node = ln_norm - ln_r[i] - half_precision * contrast * contrast * inv_r2[i];
+            
+            // sum up the probabilities of the contrasts
+            p_node[i] = lnl_node + p_left[i] + p_right[i];
+            
+            // compute the estimate of mu for this site and node
+            mu_node[i] = (mu_left[i]*t_right + mu_right[i]*t_left) / t_sum;
+        }
+        
+    }
+    
+}
+
+
 void PhyloBrownianProcessREML::fireTreeChangeEvent( const TopologyNode &n, const unsigned& m )
 {
     
@@ -138,6 +204,13 @@ void PhyloBrownianProcessREML::fireTreeChangeEvent( const TopologyNode &n, const
 }
 
 
+size_t PhyloBrownianProcessREML::getBufferOffset(size_t node_index) const
+{
+    
+    return (this->active_likelihood[node_index] * this->num_nodes + node_index) * this->num_sites;
+}
+
+
 void PhyloBrownianProcessREML::keepSpecialization( DagNode* affecter )
 {
     
@@ -155,6 +228,10 @@ void PhyloBrownianProcessREML::keepSpecialization( DagNode* affecter )
 }
 
 
+/**
+ * Compute the propagated uncertainties and collect the contrast operations of all dirty nodes in post-order.
+ * The contrasts themselves are computed for all sites afterwards (see computeContrasts).
+ */
 void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode &node, size_t node_index )
 {
 
@@ -164,10 +241,6 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
         // mark as computed
         dirty_nodes[node_index] = false;
 
-        std::vector<double> &p_node  = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &mu_node  = this->contrasts[this->active_likelihood[node_index]][node_index];
-
-        
         // get the number of children
         size_t num_children = node.getNumberOfChildren();
         
@@ -187,13 +260,6 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
             size_t right_index = right.getIndex();
             recursiveComputeLnProbability( right, right_index );
 
-            const std::vector<double> &p_left  = this->partial_likelihoods[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &p_right = this->partial_likelihoods[this->active_likelihood[right_index]][right_index];
-
-            // get the per node and site contrasts
-            const std::vector<double> &mu_left  = this->contrasts[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &mu_right = this->contrasts[this->active_likelihood[right_index]][right_index];
-
             // get the propagated uncertainties
             double delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
             double delta_right = this->contrast_uncertainty[this->active_likelihood[right_index]][right_index];
@@ -213,25 +279,13 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
             // set delta_node = (t_l*t_r)/(t_l+t_r);
             this->contrast_uncertainty[this->active_likelihood[node_index]][node_index] = (t_left*t_right) / (t_left+t_right);
 
-            double stdev = sqrt(t_left+t_right);
-            for (int i=0; i<this->num_sites; i++)
-            {
-                // get the site specific rate of evolution
-                double standDev = this->computeSiteRate(i) * stdev;
-
-                // compute the contrasts for this site and node
-                double contrast = mu_left[i] - mu_right[i];
-
-                // compute the probability for the contrasts at this node
-                double lnl_node = RbStatistics::Normal::lnPdf(0, standDev, contrast);
-
-                // sum up the probabilities of the contrasts
-                p_node[i] = lnl_node + p_left[i] + p_right[i];
-
-                // compute the estimate of mu for this site and node
-                mu_node[i] = (mu_left[i]*t_right + mu_right[i]*t_left) / (t_left+t_right);
-
-            } // end for-loop over all sites
+            ContrastOperation op;
+            op.node    = getBufferOffset( node_index );
+            op.left    = getBufferOffset( left_index );
+            op.right   = getBufferOffset( right_index );
+            op.t_left  = t_left;
+            op.t_right = t_right;
+            contrast_operations.push_back( op );
 
         } // end for-loop over all children
         
@@ -275,8 +329,8 @@ void PhyloBrownianProcessREML::resetValue( void )
 {
     
     // check if the vectors need to be resized
-    partial_likelihoods = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
-    contrasts = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
+    partial_likelihoods = std::vector<double>(2 * this->num_nodes * this->num_sites, 0);
+    contrasts = std::vector<double>(2 * this->num_nodes * this->num_sites, 0);
     contrast_uncertainty = std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) );
     
     // create a vector with the correct site indices
@@ -307,8 +361,8 @@ void PhyloBrownianProcessREML::resetValue( void )
             {
                 ContinuousTaxonData& taxon = this->value->getTaxonData( (*it)->getName() );
                 double &c = taxon.getCharacter(site_indices[site]);
-                contrasts[0][(*it)->getIndex()][site] = c;
-                contrasts[1][(*it)->getIndex()][site] = c;
+                contrasts[((*it)->getIndex()) * this->num_sites + site] = c;
+                contrasts[(this->num_nodes + (*it)->getIndex()) * this->num_sites + site] = c;
                 contrast_uncertainty[0][(*it)->getIndex()] = 0;
                 contrast_uncertainty[1][(*it)->getIndex()] = 0;
             }
@@ -380,7 +434,7 @@ double PhyloBrownianProcessREML::sumRootLikelihood( void )
     size_t node_index = root.getIndex();
     
     // get the pointers to the partial likelihoods of the left and right subtree
-    std::vector<double> &p_node = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
+    const double *p_node = this->partial_likelihoods.data() + getBufferOffset( node_index );
     
     // sum the log-likelihoods for all sites together
     double sum_partial_probs = 0.0;
@@ -9,7 +9,11 @@ namespace RevBayesCore {
     /**
      * @brief Homogeneous distribution of character state evolution along a tree class (PhyloCTMC).
      *
-     *
+     * The partial likelihoods and contrasts are stored in flat buffers as [active][node][site],
+     * so that the values of all sites (traits) of a node are contiguous in memory.
+     * A likelihood computation first traverses the tree and collects the contrast operations of all dirty nodes,
+     * and then applies these operations to blocks of sites in a simple loop over the sites that the compiler can vectorize.
+     * Large numbers of sites are split into blocks that are computed in parallel by the thread pool.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -34,7 +38,7 @@ namespace RevBayesCore {
         
         // virtual methods that may be overwritten, but then the derived class should call this methods
         virtual void                                                        keepSpecialization(DagNode* affecter);
-        void                                                                recursiveComputeLnProbability( const TopologyNode &node, size_t node_index );
+        void                                                                recursiveComputeLnProbability( const TopologyNode &node, size_t node_index );  //!< Collect the contrast operations of the dirty nodes
         void                                                                recursivelyFlagNodeDirty(const TopologyNode& n);
         void                                                                resetValue( void );
         virtual void                                                        restoreSpecialization(DagNode *restorer);
@@ -45,9 +49,9 @@ namespace RevBayesCore {
         // Parameter management functions.
         virtual void                                                        swapParameterInternal(const DagNode *oldP, const DagNode *newP);                         //!< Swap a parameter
 
-        // the likelihoods
-        std::vector<std::vector<std::vector<double> > >                     partial_likelihoods;
-        std::vector<std::vector<std::vector<double> > >                     contrasts;
+        // the likelihoods, stored as [active][node][site]
+        std::vector<double>                                                 partial_likelihoods;
+        std::vector<double>                                                 contrasts;
         std::vector<std::vector<double> >                                   contrast_uncertainty;
         std::vector<size_t>                                                 active_likelihood;
         
@@ -56,7 +60,26 @@ namespace RevBayesCore {
         std::vector<bool>                                                   dirty_nodes;
 
     private:
-                
+
+        /**
+         * The contrast between the left and right child of a node.
+         * A multifurcating node has more than one contrast operation and uses itself as the left child of all but the first.
+         */
+        struct ContrastOperation {
+            size_t                                                          node;                                                                                   //!< The offset of the node in the flat buffers
+            size_t                                                          left;                                                                                   //!< The offset of the left child in the flat buffers
+            size_t                                                          right;                                                                                  //!< The offset of the right child in the flat buffers
+            double                                                          t_left;                                                                                 //!< The branch time of the left child plus its propagated uncertainty
+            double                                                          t_right;                                                                                //!< The branch time of the right child plus its propagated uncertainty
+        };
+
+        void                                                                computeContrasts(size_t first_site, size_t last_site);                                  //!< Apply the contrast operations to a block of sites
+        size_t                                                              getBufferOffset(size_t node_index) const;                                               //!< The offset of the active values of the node in the flat buffers
+
+        std::vector<ContrastOperation>                                      contrast_operations;                                                                    //!< Work space for the contrast operations in post-order
+        std::vector<double>                                                 ln_site_rates;                                                                          //!< Work space for the log site rates
+        std::vector<double>                                                 inverse_squared_site_rates;                                                             //!< Work space for 1/rate^2 per site
+        
     };
     
 }
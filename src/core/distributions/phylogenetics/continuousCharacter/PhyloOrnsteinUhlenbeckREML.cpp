@@ -19,6 +19,7 @@
 #include "RbVector.h"
 #include "RbVectorImpl.h"
 #include "StringUtilities.h"
+#include "ThreadPool.h"
 #include "Tree.h"
 #include "TreeChangeEventHandler.h"
 #include "TypedDagNode.h"
@@ -30,10 +31,9 @@ namespace RevBayesCore { class RandomNumberGenerator; }
 using namespace RevBayesCore;
 
 PhyloOrnsteinUhlenbeckREML::PhyloOrnsteinUhlenbeckREML(const TypedDagNode<Tree> *t, size_t ns) : AbstractPhyloContinuousCharacterProcess( t, ns ),
-    partial_likelihoods( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
-    contrasts( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
+    partial_likelihoods( std::vector<double>(2 * this->num_nodes * this->num_sites, 0) ),
+    contrasts( std::vector<double>(2 * this->num_nodes * this->num_sites, 0) ),
     contrast_uncertainty( std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) ) ),
-    normalizing_constants( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 1.0) ) ) ),
     active_likelihood( std::vector<size_t>(this->num_nodes, 0) ),
     changed_nodes( std::vector<bool>(this->num_nodes, false) ),
     dirty_nodes( std::vector<bool>(this->num_nodes, true) )
@@ -176,9 +176,14 @@ double PhyloOrnsteinUhlenbeckREML::computeLnProbability( void )
     if ( this->dirty_nodes[rootIndex] )
     {
         
-        
+        // collect the contrast operations of all dirty nodes
+        contrast_operations.clear();
         recursiveComputeLnProbability( root, rootIndex );
         
+        // compute the contrasts, in parallel for blocks of sites if there are many sites
+        size_t site_block_size = 256;
+        parallelFor(0, this->num_sites, [this](size_t first_site, size_t last_site) { computeContrasts(first_site, last_site); }, site_block_size);
+        
         // sum the partials up
         this->ln_prob = sumRootLikelihood();
         
@@ -188,6 +193,67 @@ double PhyloOrnsteinUhlenbeckREML::computeLnProbability( void )
 
 
 
+/**
+ * Apply the contrast operations to the sites [first_site,last_site).
+ * The operations are in post-order, so the values of the children are computed before those of their parents.
+ * All exponentials and logarithms only depend on the branches and are precomputed per operation,
+ * so that the loop over the sites doesn't call any function.
+ */
+void PhyloOrnsteinUhlenbeckREML::computeContrasts(size_t first_site, size_t last_site)
+{
+    
+    for (size_t k = 0; k < contrast_operations.size(); ++k)
+    {
+        const ContrastOperation &op = contrast_operations[k];
+        
+        // a multifurcating node is its own left child, hence the node and its left child may be the same
+        double       *p_node   = partial_likelihoods.data() + op.node;
+        double       *mu_node  = contrasts.data() + op.node;
+        const double *p_left   = partial_likelihoods.data() + op.left;
+        const double *p_right  = partial_likelihoods.data() + op.right;
+        const double *mu_left  = contrasts.data() + op.left;
+        const double *mu_right = contrasts.data() + op.right;
+        
+        double scale_left          = op.scale_left;
+        double scale_right         = op.scale_right;
+        double theta_left          = op.theta_left;
+        double theta_right         = op.theta_right;
+        double var_left            = op.var_left;
+        double var_right           = op.var_right;
+        double var_sum             = var_left + var_right;
+        double half_precision      = 0.5 / var_sum;
+        double ln_norm             = op.ln_norm;
+        double root_ln_norm        = op.root_ln_norm;
+        double root_half_precision = op.root_half_precision;
+        double root_state          = op.root_state;
+        
+        for (size_t i = first_site; i < last_site; ++i)
+        {
+            
+            double m_left   = scale_left  * (mu_left[i]  - theta_left)  + theta_left;
+            double m_right  = scale_right * (mu_right[i] - theta_right) + theta_right;
+            double mu       = (m_left*var_right + m_right*var_left) / var_sum;
+            
+            // compute the contrasts for this site and node
+            double contrast = m_left - m_right;
+            
+            // compute the probability for the contrasts at this node
+            double lnl_node = ln_norm - half_precision * contrast * contrast;
+            
+            // the probability of the root state (both terms are 0 for all other nodes)
+            lnl_node += root_ln_norm - root_half_precision * (mu - root_state) * (mu - root_state);
+            
+            // sum up the probabilities of the contrasts
+            p_node[i]  = lnl_node + p_left[i] + p_right[i];
+            mu_node[i] = mu;
+            
+        }
+        
+    }
+    
+}
+
+
 void PhyloOrnsteinUhlenbeckREML::fireTreeChangeEvent( const TopologyNode &n, const unsigned& m )
 {
     
@@ -197,6 +263,13 @@ void PhyloOrnsteinUhlenbeckREML::fireTreeChangeEvent( const TopologyNode &n, con
 }
 
 
+size_t PhyloOrnsteinUhlenbeckREML::getBufferOffset(size_t node_index) const
+{
+    
+    return (this->active_likelihood[node_index] * this->num_nodes + node_index) * this->num_sites;
+}
+
+
 void PhyloOrnsteinUhlenbeckREML::keepSpecialization( DagNode* affecter )
 {
     
@@ -214,6 +287,10 @@ void PhyloOrnsteinUhlenbeckREML::keepSpecialization( DagNode* affecter )
 }
 
 
+/**
+ * Compute the propagated uncertainties and collect the contrast operations of all dirty nodes in post-order.
+ * The contrasts themselves are computed for all sites afterwards (see computeContrasts).
+ */
 void PhyloOrnsteinUhlenbeckREML::recursiveComputeLnProbability( const TopologyNode &node, size_t node_index )
 {
     
@@ -223,11 +300,6 @@ void PhyloOrnsteinUhlenbeckREML::recursiveComputeLnProbability( const TopologyNo
         // mark as computed
         dirty_nodes[node_index] = false;
         
-        std::vector<double> &p_node             = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &mu_node            = this->contrasts[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &norm_const_node    = this->normalizing_constants[this->active_likelihood[node_index]][node_index];
-        
-        
         // get the number of children
         size_t num_children = node.getNumberOfChildren();
         
@@ -247,17 +319,6 @@ void PhyloOrnsteinUhlenbeckREML::recursiveComputeLnProbability( const TopologyNo
             size_t right_index = right.getIndex();
             recursiveComputeLnProbability( right, right_index );
             
-            const std::vector<double> &p_left  = this->partial_likelihoods[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &p_right = this->partial_likelihoods[this->active_likelihood[right_index]][right_index];
-            
-            // get the per node and site contrasts
-            const std::vector<double> &mu_left  = this->contrasts[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &mu_right = this->contrasts[this->active_likelihood[right_index]][right_index];
-            
-            // get the per node and site normalizing constants
-            const std::vector<double> &norm_const_left  = this->normalizing_constants[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &norm_const_right = this->normalizing_constants[this->active_likelihood[right_index]][right_index];
-            
             // get the propagated uncertainties
             double delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
             double delta_right = this->contrast_uncertainty[this->active_likelihood[right_index]][right_index];
@@ -305,42 +366,33 @@ void PhyloOrnsteinUhlenbeckREML::recursiveComputeLnProbability( const TopologyNo
             double theta_left   = computeBranchTheta( left_index );
             double theta_right  = computeBranchTheta( right_index );
             
-            double stdev = sqrt(var_left+var_right);
-            for (int i=0; i<this->num_sites; i++)
+            ContrastOperation op;
+            op.node        = getBufferOffset( node_index );
+            op.left        = getBufferOffset( left_index );
+            op.right       = getBufferOffset( right_index );
+            op.scale_left  = exp(1.0 * bl_left  * alpha_left );
+            op.scale_right = exp(1.0 * bl_right * alpha_right);
+            op.theta_left  = theta_left;
+            op.theta_right = theta_right;
+            op.var_left    = var_left;
+            op.var_right   = var_right;
+            
+            // the ln of the density of the contrast, exp(alpha_l*t_l+alpha_r*t_r) * exp( -contrast^2 / (2*(var_l+var_r)) ) / sqrt(2pi*(var_l+var_r)),
+            // without the contrast itself
+            op.ln_norm     = alpha_left*bl_left + alpha_right*bl_right - RbConstants::LN_SQRT_2PI - 0.5 * log(var_left+var_right);
+            
+            op.root_ln_norm        = 0.0;
+            op.root_half_precision = 0.0;
+            op.root_state          = 0.0;
+            if ( node.isRoot() == true )
             {
-                
-                double m_left   = exp(1.0 * bl_left  * alpha_left ) * (mu_left[i]  - theta_left)  + theta_left;
-                double m_right  = exp(1.0 * bl_right * alpha_right) * (mu_right[i] - theta_right) + theta_right;
-                mu_node[i] = (m_left*var_right + m_right*var_left) / (var_left+var_right);
-                
-                // get the site specific rate of evolution
-                double standDev = this->computeSiteRate(i) * stdev;
-                
-                // compute the contrasts for this site and node
-                double contrast = m_left - m_right;
-                
-                // compute the probability for the contrasts at this node
-                double z_left  = norm_const_left[i];
-                double z_right = norm_const_right[i];
-                double z_node  = exp(alpha_left*bl_left+alpha_right*bl_right)/(z_left*z_right) * exp( -1.0 * contrast * contrast / ( 2.0 *(var_left+var_right) ) ) / RbConstants::SQRT_2PI / stdev;
-                norm_const_node[i] = 1.0;
-                
-                double lnl_node = log( z_node );
-//                lnl_node -= RbConstants::LN_SQRT_2PI - log( sqrt( var_node ) );
-//                lnl_node -= ( (contrast-mu_node[i])*(contrast-mu_node[i]) ) / (2.0*var_node);
-//                lnl_node -= ( mu_node[i]*mu_node[i] ) / (2.0*var_node);
-                
-                if ( node.isRoot() == true )
-                {
-                    double root_state = computeRootState();
-                    // dnorm(root.x, vals[1], sqrt(vals[2]), TRUE)
-                    lnl_node += RbStatistics::Normal::lnPdf( root_state, sqrt((var_left*var_right) / (var_left+var_right)), mu_node[i]);
-                }
-                
-                // sum up the probabilities of the contrasts
-                p_node[i] = lnl_node + p_left[i] + p_right[i];
-                
-            } // end for-loop over all sites
+                // dnorm(root.x, vals[1], sqrt(vals[2]), TRUE)
+                op.root_ln_norm        = - RbConstants::LN_SQRT_2PI - 0.5 * log(var_node);
+                op.root_half_precision = 0.5 / var_node;
+                op.root_state          = computeRootState();
+            }
+            contrast_operations.push_back( op );
+            
             
         } // end for-loop over all children
         
@@ -384,10 +436,9 @@ void PhyloOrnsteinUhlenbeckREML::resetValue( void )
 {
     
     // check if the vectors need to be resized
-    partial_likelihoods = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
-    contrasts = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
+    partial_likelihoods = std::vector<double>(2 * this->num_nodes * this->num_sites, 0);
+    contrasts = std::vector<double>(2 * this->num_nodes * this->num_sites, 0);
     contrast_uncertainty = std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) );
-    normalizing_constants = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 1.0) ) );
 
     // create a vector with the correct site indices
     // some of the sites may have been excluded
@@ -417,12 +468,10 @@ void PhyloOrnsteinUhlenbeckREML::resetValue( void )
             {
                 ContinuousTaxonData& taxon = this->value->getTaxonData( (*it)->getName() );
                 double &c = taxon.getCharacter(site_indices[site]);
-                contrasts[0][(*it)->getIndex()][site] = c;
-                contrasts[1][(*it)->getIndex()][site] = c;
+                contrasts[((*it)->getIndex()) * this->num_sites + site] = c;
+                contrasts[(this->num_nodes + (*it)->getIndex()) * this->num_sites + site] = c;
                 contrast_uncertainty[0][(*it)->getIndex()] = 0;
                 contrast_uncertainty[1][(*it)->getIndex()] = 0;
-                normalizing_constants[0][(*it)->getIndex()][site] = 1.0;
-                normalizing_constants[1][(*it)->getIndex()][site] = 1.0;
             }
         }
     }
@@ -739,7 +788,7 @@ double PhyloOrnsteinUhlenbeckREML::sumRootLikelihood( void )
     size_t node_index = root.getIndex();
     
     // get the pointers to the partial likelihoods of the left and right subtree
-    std::vector<double> &p_node = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
+    const double *p_node = this->partial_likelihoods.data() + getBufferOffset( node_index );
     
     // sum the log-likelihoods for all sites together
     double sum_partial_probs = 0.0;
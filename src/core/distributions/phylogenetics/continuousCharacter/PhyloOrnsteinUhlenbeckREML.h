@@ -9,7 +9,8 @@ namespace RevBayesCore {
     /**
      * @brief Homogeneous distribution of character state evolution along a tree class (PhyloCTMC).
      *
-     *
+     * As in PhyloBrownianProcessREML, the partial likelihoods and contrasts are stored in flat buffers as [active][node][site]
+     * and are computed by applying the contrast operations collected during the tree traversal to blocks of sites.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -41,7 +42,7 @@ namespace RevBayesCore {
         
         // virtual methods that may be overwritten, but then the derived class should call this methods
         virtual void                                                        keepSpecialization(DagNode* affecter);
-        void                                                                recursiveComputeLnProbability( const TopologyNode &node, size_t node_index );
+        void                                                                recursiveComputeLnProbability( const TopologyNode &node, size_t node_index );  //!< Collect the contrast operations of the dirty nodes
         void                                                                recursivelyFlagNodeDirty(const TopologyNode& n);
         void                                                                resetValue( void );
         virtual void                                                        restoreSpecialization(DagNode *restorer);
@@ -53,11 +54,10 @@ namespace RevBayesCore {
         // Parameter management functions.
         virtual void                                                        swapParameterInternal(const DagNode *oldP, const DagNode *newP);                         //!< Swap a parameter
         
-        // the likelihoods
-        std::vector<std::vector<std::vector<double> > >                     partial_likelihoods;
-        std::vector<std::vector<std::vector<double> > >                     contrasts;
+        // the likelihoods, stored as [active][node][site]
+        std::vector<double>                                                 partial_likelihoods;
+        std::vector<double>                                                 contrasts;
         std::vector<std::vector<double> >                                   contrast_uncertainty;
-        std::vector<std::vector<std::vector<double> > >                     normalizing_constants;
         std::vector<size_t>                                                 active_likelihood;
         
         // convenience variables available for derived classes too
@@ -65,6 +65,29 @@ namespace RevBayesCore {
         std::vector<bool>                                                   dirty_nodes;
         
     private:
+
+        /**
+         * The contrast between the left and right child of a node after the OU process moved their means towards the optima.
+         * A multifurcating node has more than one contrast operation and uses itself as the left child of all but the first.
+         */
+        struct ContrastOperation {
+            size_t                                                          node;                                                                                   //!< The offset of the node in the flat buffers
+            size_t                                                          left;                                                                                   //!< The offset of the left child in the flat buffers
+            size_t                                                          right;                                                                                  //!< The offset of the right child in the flat buffers
+            double                                                          scale_left;                                                                             //!< exp(alpha*t) of the left branch
+            double                                                          scale_right;                                                                            //!< exp(alpha*t) of the right branch
+            double                                                          theta_left;                                                                             //!< The optimum of the left branch
+            double                                                          theta_right;                                                                            //!< The optimum of the right branch
+            double                                                          var_left;                                                                               //!< The variance of the left branch including the propagated uncertainty
+            double                                                          var_right;                                                                              //!< The variance of the right branch including the propagated uncertainty
+            double                                                          ln_norm;                                                                                //!< The site independent part of the ln density of the contrast
+            double                                                          root_ln_norm;                                                                           //!< The site independent part of the ln density of the root state (0 if not the root)
+            double                                                          root_half_precision;                                                                    //!< 1/(2*variance) of the root state (0 if not the root)
+            double                                                          root_state;                                                                             //!< The root state
+        };
+
+        void                                                                computeContrasts(size_t first_site, size_t last_site);                                  //!< Apply the contrast operations to a block of sites
+        size_t                                                              getBufferOffset(size_t node_index) const;                                               //!< The offset of the active values of the node in the flat buffers
         double                                                              computeRootState(void) const;
         double                                                              computeBranchAlpha(size_t idx) const;
         double                                                              computeBranchSigma(size_t idx) const;
@@ -78,6 +101,8 @@ namespace RevBayesCore {
         const TypedDagNode< RbVector< double > >*                           heterogeneous_sigma;
         const TypedDagNode< RbVector< double > >*                           heterogeneous_theta;
 
+        std::vector<ContrastOperation>                                      contrast_operations;                                                                    //!< Work space for the contrast operations in post-order
+
     };
     
 }
@@ -2,23 +2,33 @@
 #define AbstractPhyloCTMCSiteHomogeneous_H
 
 #include "AbstractHomologousDiscreteCharacterData.h"
+#include "AliasTable.h"
+#include "BranchLengthLikelihoodEvaluator.h"
+#include "CompactTree.h"
 #include "ConstantNode.h"
+#include "CopyOnWriteVector.h"
 #include "DiscreteTaxonData.h"
 #include "DnaState.h"
 #include "MatrixReal.h"
 #include "MemberObject.h"
+#include "Profiler.h"
 #include "RbConstants.h"
 #include "RbMathLogic.h"
 #include "RbSettings.h"
 #include "RbVector.h"
 #include "RateGenerator.h"
+#include "RegraftLikelihoodEvaluator.h"
 #include "Simplex.h"
+#include "StochasticCharacterMapBuffer.h"
+#include "ThreadPool.h"
 #include "TopologyNode.h"
 #include "TransitionProbabilityMatrix.h"
 #include "Tree.h"
 #include "TreeChangeEventListener.h"
+#include "TreeChangeEventMessage.h"
 #include "TypedDistribution.h"
 
+#include <functional>
 #include <memory.h>
 
 namespace RevBayesCore {
@@ -66,7 +76,7 @@ namespace RevBayesCore {
      *
      */
     template<class charType>
-    class AbstractPhyloCTMCSiteHomogeneous : public TypedDistribution< AbstractHomologousDiscreteCharacterData >, public MemberObject< RbVector<double> >, public MemberObject < MatrixReal >, public TreeChangeEventListener {
+    class AbstractPhyloCTMCSiteHomogeneous : public TypedDistribution< AbstractHomologousDiscreteCharacterData >, public MemberObject< RbVector<double> >, public MemberObject < MatrixReal >, public TreeChangeEventListener, public RegraftLikelihoodEvaluator, public BranchLengthLikelihoodEvaluator {
 
     public:
         // Note, we need the size of the alignment in the constructor to correctly simulate an initial state
@@ -80,15 +90,24 @@ namespace RevBayesCore {
 
         // non-virtual
         void                                                                bootstrap(void);
+        virtual void                                                        computeBranchLengthDerivatives(double branch_length, double &ln_likelihood, double &first, double &second);   //!< The ln likelihood and its first two derivatives for a length of the prepared branch
+        std::vector<double>                                                 computeBranchLengthGradient(void);                                                          //!< Derivatives of the log-likelihood with respect to the branch lengths (indexed by node)
+        std::vector<double>                                                 computeClockRateGradient(void);                                                             //!< Derivatives of the log-likelihood with respect to the clock rate(s)
         virtual double                                                      computeLnProbability(void);
+        virtual bool                                                        computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);                      //!< Gradient with respect to the clock rate(s), site rates or branch lengths
+        virtual bool                                                        computeRegraftLnLikelihoods(const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods);   //!< The ln likelihood for every regraft point of a pruned subtree
+        std::vector<double>                                                 computeSiteRateGradient(void);                                                              //!< Derivatives of the log-likelihood with respect to the site rates
         virtual std::vector<charType>                                       drawAncestralStatesForNode(const TopologyNode &n);
         virtual void                                                        drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates);
+        virtual void                                                        drawJointConditionalAncestralStateIndices(std::vector<size_t>& start_states, std::vector<size_t>& end_states);   //!< Draw ancestral states of all sites into compact (node-major) state-index matrices
         virtual void                                                        drawStochasticCharacterMap(std::vector<std::string>& character_histories, size_t site, bool use_simmap_default=true);
+        virtual void                                                        drawStochasticCharacterMaps(const std::vector<size_t>& sites, StochasticCharacterMapBuffer& maps);    //!< Draw the character histories of several sites from one draw of ancestral states
         void                                                                executeMethod(const std::string &n, const std::vector<const DagNode*> &args, RbVector<double> &rv) const;     //!< Map the member methods to internal function calls
         void                                                                executeMethod(const std::string &n, const std::vector<const DagNode*> &args, MatrixReal &rv) const;     //!< Map the member methods to internal function calls
         void                                                                fireTreeChangeEvent(const TopologyNode &n, const unsigned& m=0);                                                 //!< The tree has changed and we want to know which part.
         virtual void                                                        recursivelyDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates, const std::vector<size_t>& sampledSiteRates);
         virtual bool                                                        recursivelyDrawStochasticCharacterMap(const TopologyNode &node, std::vector<std::string>& character_histories, std::vector<std::vector<charType> >& start_states, std::vector<std::vector<charType> >& end_states, size_t site, bool use_simmap_default);
+        virtual void                                                        prepareLnProbability(void);                                                                 //!< Listen to the tree again if it was replaced (before the likelihood is computed concurrently)
         virtual void                                                        redrawValue(void);
         void                                                                reInitialized(void);
         void                                                                setMcmcMode(bool tf);                                                                       //!< Change the likelihood computation to or from MCMC mode.
@@ -112,17 +131,29 @@ namespace RevBayesCore {
         bool                                                                hasSiteRateMixture();
         bool                                                                hasSiteMatrixMixture();
         void                                                                getSampledMixtureComponents(size_t &site_index, size_t &rate_component, size_t &matrix_component );
+        virtual bool                                                        prepareBranchLengthOptimization(const TopologyNode &node);                                  //!< Cache the partial likelihoods at both ends of the branch above the node
 
     protected:
 
         // helper method for this and derived classes
+        virtual void                                                        computeBranchTimeDerivatives(std::vector<std::vector<double> > &d);                          //!< Derivatives of the log-likelihood with respect to the time of each branch and site rate
+        double                                                              getBranchClockRate(size_t node_index) const;                                                //!< The clock rate of the branch, including the correction for invariant sites
+        std::vector<double>                                                 getInvariantSiteFrequencies(void) const;                                                    //!< The (mean) root frequencies used for the invariant sites
+        double                                                              getSiteRate(size_t rate_index) const;                                                       //!< The rate of the site rate category
+        void                                                                recursivelyComputeBranchTimeDerivatives(const TopologyNode &node, std::vector<double> &pre_partials, const std::vector<double> &site_weights, std::vector<std::vector<double> > &d);
+        void                                                                recursivelyDrawJointConditionalAncestralStateIndices(const TopologyNode &node, std::vector<size_t>& start_states, std::vector<size_t>& end_states);
         void                                                                recursivelyFlagNodeDirty(const TopologyNode& n);
         virtual void                                                        resizeLikelihoodVectors(void);
         virtual void                                                        setActivePIDSpecialized(size_t i, size_t n);                                                          //!< Set the number of processes for this distribution.
+        void                                                                computeTransitionProbabilities(size_t node_idx, double start_age, double end_age, std::vector<TransitionProbabilityMatrix> &tp) const;   //!< Transition probabilities of (part of) the branch above the node
         virtual void                                                        updateTransitionProbabilities(size_t node_idx);
         virtual std::vector<double>                                         getRootFrequencies( size_t mixture = 0 ) const;
+        void                                                                computeForPatternBlocks(const std::function<void(size_t, size_t)> &f) const;                 //!< Apply f to blocks [first,last) of the patterns, using several threads if allowed
         virtual void                                                        getRootFrequencies( std::vector<std::vector<double> >& ) const;
+        const AbstractHomologousDiscreteCharacterData&                      getCharacterData(void) const;                                                                //!< The current value for reading (does not unshare the characters)
         virtual std::vector<double>                                         getMixtureProbs( void ) const;
+        double                                                              getStochasticMappingClockRate(size_t node_index, size_t rate_component) const;
+        const RateGenerator*                                                getStochasticMappingRateGenerator(size_t node_index, size_t matrix_component, const RateGenerator *default_rate_generator) const;
         virtual double                                                      getPInv(void) const;
 
 
@@ -172,22 +203,25 @@ namespace RevBayesCore {
 
         std::vector< std::vector< std::vector<double> > >                   perNodeSiteLogScalingFactors;
 
-        // the data
-        std::vector<std::vector<RbBitSet> >                                 ambiguous_char_matrix;
-        std::vector<std::vector<unsigned long> >                            char_matrix;
-        std::vector<std::vector<bool> >                                     gap_matrix;
-        std::vector<size_t>                                                 pattern_counts;
+        // the data (shared with the clones of this distribution until one of them compresses its data again)
+        CopyOnWriteVector<std::vector<RbBitSet> >                           ambiguous_char_matrix;
+        CopyOnWriteVector<std::vector<unsigned long> >                      char_matrix;
+        CopyOnWriteVector<std::vector<bool> >                               gap_matrix;
+        CopyOnWriteVector<size_t>                                           pattern_counts;
         std::vector<bool>                                                   site_invariant;
         std::vector<size_t>                                                 invariant_site_index;
         size_t                                                              num_patterns;
         bool                                                                compressed;
-        std::vector<size_t>                                                 site_pattern;    // an array that keeps track of which pattern is used for each site
+        CopyOnWriteVector<size_t>                                           site_pattern;    // an array that keeps track of which pattern is used for each site
         std::map<std::string,size_t>                                        taxon_name_2_tip_index_map;
 
         // flags for likelihood recomputation
         bool                                                                touched;
         std::vector<bool>                                                   changed_nodes;
         mutable std::vector<bool>                                           dirty_nodes;
+        CompactTree                                                         traversal_tree;             //!< Compact copy of the topology for the post-order traversal
+        bool                                                                traversal_stale;            //!< Does the compact topology need to be rebuilt?
+        bool                                                                topology_touched;           //!< Did the topology change since the last keep/restore?
 
         // offsets for nodes
         size_t                                                              activeLikelihoodOffset;
@@ -238,15 +272,20 @@ namespace RevBayesCore {
         size_t                                                              sampled_site_rate_component;
         size_t                                                              sampled_site_matrix_component;
 
+        // cached partial likelihoods for the optimization of a single branch length
+        const TopologyNode*                                                 branch_optimization_node;
+        std::vector<double>                                                 branch_outside_partials;
+        std::vector<double>                                                 branch_inside_partials;
+        std::vector<double>                                                 branch_ln_scaling;
+
     private:
 
         // private methods
-        void                                                                fillLikelihoodVector(const TopologyNode &n, size_t nIdx);
         void                                                                recursiveMarginalLikelihoodComputation(size_t nIdx);
         virtual void                                                        scale(size_t i);
         virtual void                                                        scale(size_t i, size_t l, size_t r);
         virtual void                                                        scale(size_t i, size_t l, size_t r, size_t m);
-        virtual void                                                        simulate(const TopologyNode& node, std::vector< DiscreteTaxonData< charType > > &t, const std::vector<bool> &inv, const std::vector<size_t> &perSiteRates);
+        virtual void                                                        simulate(const TopologyNode& node, std::vector< std::vector<unsigned int> > &states, const std::vector<bool> &inv, const std::vector<size_t> &perSiteRates, std::vector<AliasTable> &tables);
         
         
         
@@ -263,7 +302,9 @@ namespace RevBayesCore {
 #include "RateMatrix_JC.h"
 #include "StochasticNode.h"
 
+#include <algorithm>
 #include <cmath>
+#include <utility>
 
 #ifdef RB_MPI
 #include <mpi.h>
@@ -302,6 +343,9 @@ taxon_name_2_tip_index_map(),
 touched( false ),
 changed_nodes( std::vector<bool>(num_nodes, false) ),
 dirty_nodes( std::vector<bool>(num_nodes, true) ),
+traversal_tree(),
+traversal_stale( true ),
+topology_touched( false ),
 using_ambiguous_characters( amb ),
 treatUnknownAsGap( true ),
 treatAmbiguousAsGaps( false ),
@@ -316,7 +360,8 @@ gap_match_clamped( gapmatch ),
 template_state(),
 has_ancestral_states(false),
 sampled_site_rate_component( 0 ),
-sampled_site_matrix_component( 0 )
+sampled_site_matrix_component( 0 ),
+branch_optimization_node( NULL )
 
 {
 
@@ -397,6 +442,9 @@ taxon_name_2_tip_index_map( n.taxon_name_2_tip_index_map ),
 touched( false ),
 changed_nodes( n.changed_nodes ),
 dirty_nodes( n.dirty_nodes ),
+traversal_tree(),
+traversal_stale( true ),
+topology_touched( false ),
 using_ambiguous_characters( n.using_ambiguous_characters ),
 treatUnknownAsGap( n.treatUnknownAsGap ),
 treatAmbiguousAsGaps( n.treatAmbiguousAsGaps ),
@@ -411,7 +459,8 @@ gap_match_clamped( n.gap_match_clamped ),
 template_state( n.template_state ),
 has_ancestral_states( n.has_ancestral_states ),
 sampled_site_rate_component( n.sampled_site_rate_component ),
-sampled_site_matrix_component( n.sampled_site_matrix_component )
+sampled_site_matrix_component( n.sampled_site_matrix_component ),
+branch_optimization_node( NULL )
 {
 
     // initialize with default parameters
@@ -515,17 +564,19 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
         return;
     }
 
-    ambiguous_char_matrix.clear();
-    char_matrix.clear();
-    gap_matrix.clear();
-    pattern_counts.clear();
     num_patterns = 0;
 
-    // resize the matrices
+    // we build the new matrices and patterns in local vectors and only assign them at the end,
+    // so that we never copy the old ones if they are shared with other clones
     size_t tips = tau->getValue().getNumberOfTips();
-    ambiguous_char_matrix.resize(tips);
-    char_matrix.resize(tips);
-    gap_matrix.resize(tips);
+    std::vector<std::vector<RbBitSet> >         ambiguous_chars = std::vector<std::vector<RbBitSet> >( tips );
+    std::vector<std::vector<unsigned long> >    chars           = std::vector<std::vector<unsigned long> >( tips );
+    std::vector<std::vector<bool> >             gaps            = std::vector<std::vector<bool> >( tips );
+    std::vector<size_t>                         counts;
+
+    // we only read the data, unless we need to turn characters into gaps,
+    // so that we don't make a copy of data that is shared with other clones
+    const AbstractHomologousDiscreteCharacterData &data = getCharacterData();
 
     // create a vector with the correct site indices
     // some of the sites may have been excluded
@@ -543,18 +594,17 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
         {
             if ( (*it)->isTip() )
             {
-                AbstractDiscreteTaxonData& taxon = value->getTaxonData( (*it)->getName() );
-                DiscreteCharacterState &c = taxon.getCharacter(site_indices[site]);
+                const DiscreteCharacterState &c = data.getTaxonData( (*it)->getName() ).getCharacter(site_indices[site]);
 
                 // if we treat unknown characters as gaps and this is an unknown character then we change it
                 // because we might then have a pattern more
                 if ( treatAmbiguousAsGaps && (c.isAmbiguous() || c.isMissingState()) )
                 {
-                    c.setGapState( true );
+                    value->getTaxonData( (*it)->getName() ).getCharacter(site_indices[site]).setGapState( true );
                 }
                 else if ( treatUnknownAsGap && (c.getNumberOfStates() == c.getNumberObservedStates() || c.isMissingState()) )
                 {
-                    c.setGapState( true );
+                    value->getTaxonData( (*it)->getName() ).getCharacter(site_indices[site]).setGapState( true );
                 }
                 else if ( !c.isGapState() && (c.isAmbiguous() || c.isMissingState()) )
                 {
@@ -584,8 +634,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
         {
             if ( (*it)->isTip() )
             {
-                AbstractDiscreteTaxonData& taxon = value->getTaxonData( (*it)->getName() );
-                DiscreteCharacterState &c = taxon.getCharacter(site_indices[site]);
+                const DiscreteCharacterState &c = data.getTaxonData( (*it)->getName() ).getCharacter(site_indices[site]);
 
                 if ( c.isWeighted() )
                 {
@@ -613,6 +662,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
     {
         // find the unique site patterns and compute their respective frequencies
         std::map<std::string,size_t> patterns;
+        std::vector<size_t> patterns_of_sites = std::vector<size_t>(num_sites, 0);
         for (size_t site = 0; site < num_sites; ++site)
         {
             // create the site pattern
@@ -621,8 +671,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
             {
                 if ( (*it)->isTip() )
                 {
-                    AbstractDiscreteTaxonData& taxon = value->getTaxonData( (*it)->getName() );
-                    CharacterState &c = taxon.getCharacter(site_indices[site]);
+                    const CharacterState &c = data.getTaxonData( (*it)->getName() ).getCharacter(site_indices[site]);
                     pattern += c.getStringValue();
                 }
             }
@@ -632,24 +681,24 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
             {
                 // we have already seen this pattern
                 // increase the frequency counter
-                pattern_counts[ index->second ]++;
+                counts[ index->second ]++;
 
                 // obviously this site isn't unique nor the first encounter
                 unique[site] = false;
 
                 // remember which pattern this site uses
-                site_pattern[site] = index->second;
+                patterns_of_sites[site] = index->second;
             }
             else
             {
                 // create a new pattern frequency counter for this pattern
-                pattern_counts.push_back(1);
+                counts.push_back(1);
 
                 // insert this pattern with the corresponding index in the map
                 patterns.insert( std::pair<std::string,size_t>(pattern,num_patterns) );
 
                 // remember which pattern this site uses
-                site_pattern[site] = num_patterns;
+                patterns_of_sites[site] = num_patterns;
 
                 // increase the pattern counter
                 num_patterns++;
@@ -661,12 +710,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
                 unique[site] = true;
             }
         }
+        site_pattern = std::move( patterns_of_sites );
     }
     else
     {
         // we do not compress
         num_patterns = num_sites;
-        pattern_counts     = std::vector<size_t>(num_sites,1);
+        counts             = std::vector<size_t>(num_sites,1);
         indexOfSitePattern = std::vector<size_t>(num_sites,1);
         for (size_t i = 0; i < this->num_sites; i++)
         {
@@ -691,36 +741,36 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
         {
             size_t node_index = the_node->getIndex();
             taxon_name_2_tip_index_map.insert( std::pair<std::string,size_t>(the_node->getName(), node_index) );
-            AbstractDiscreteTaxonData& taxon = value->getTaxonData( the_node->getName() );
+            const AbstractDiscreteTaxonData& taxon = data.getTaxonData( the_node->getName() );
 
             // resize the column
-            ambiguous_char_matrix[node_index].resize(pattern_block_size);
-            char_matrix[node_index].resize(pattern_block_size);
-            gap_matrix[node_index].resize(pattern_block_size);
+            ambiguous_chars[node_index].resize(pattern_block_size);
+            chars[node_index].resize(pattern_block_size);
+            gaps[node_index].resize(pattern_block_size);
             for (size_t patternIndex = 0; patternIndex < pattern_block_size; ++patternIndex)
             {
                 // set the counts for this patter
-                process_pattern_counts[patternIndex] = pattern_counts[patternIndex+pattern_block_start];
+                process_pattern_counts[patternIndex] = counts[patternIndex+pattern_block_start];
 
-                charType &c = static_cast<charType &>( taxon.getCharacter(site_indices[indexOfSitePattern[patternIndex+pattern_block_start]]) );
-                gap_matrix[node_index][patternIndex] = c.isGapState();
+                const charType &c = static_cast<const charType &>( taxon.getCharacter(site_indices[indexOfSitePattern[patternIndex+pattern_block_start]]) );
+                gaps[node_index][patternIndex] = c.isGapState();
 
                 if ( using_ambiguous_characters == true )
                 {
                     // we use the actual state
-                    ambiguous_char_matrix[node_index][patternIndex] = c.getState();
+                    ambiguous_chars[node_index][patternIndex] = c.getState();
                 }
                 else if ( c.isGapState() == false )
                 {
                     // we use the index of the state
-                    char_matrix[node_index][patternIndex] = c.getStateIndex();
+                    chars[node_index][patternIndex] = c.getStateIndex();
                     if ( c.getStateIndex() >= this->num_chars )
                         throw RbException("Problem with state index in PhyloCTMC!");
                 }
                 else
                 {
                     // just to be safe
-                    char_matrix[node_index][patternIndex] = -1;
+                    chars[node_index][patternIndex] = -1;
                 }
 
             }
@@ -729,8 +779,11 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
 
     }
 
-    // now copy back the pattern count vector
-    pattern_counts = process_pattern_counts;
+    // now store the pattern counts and the matrices
+    pattern_counts          = std::move( process_pattern_counts );
+    ambiguous_char_matrix   = std::move( ambiguous_chars );
+    char_matrix             = std::move( chars );
+    gap_matrix              = std::move( gaps );
 
     // reset the vector if a site is invariant
     site_invariant.resize( pattern_block_size );
@@ -808,1319 +861,3282 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::compress( void )
 }
 
 
+/**
+ * Compute the ln likelihood and its first and second derivative with respect to the length of the branch
+ * prepared by prepareBranchLengthOptimization, with all other branches and parameters fixed.
+ *
+ * With the cached outside partial likelihoods u and inside partial likelihoods d of the branch, we have for each site and mixture category
+ *   L = u' P(r t) d,   dL/dt = r u' Q P(r t) d,   d^2L/dt^2 = r^2 u' Q^2 P(r t) d,
+ * where r is the clock rate times the site rate. Hence, every length only costs the transition probabilities of one branch
+ * and one pass over the patterns, which is what a Newton-Raphson optimization of the branch length needs.
+ */
 template<class charType>
-double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbability( void )
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeBranchLengthDerivatives(double branch_length, double &ln_likelihood, double &first, double &second)
 {
-    // @todo: #thread
-    // This part should be done on several threads if possible
-    // That means we should probabily call this function as a job,
-    // where a job is defined as computing the lnProbability for a subset of the data (block)
-    // Sebastian: this call is very slow; a lot of work happens in nextCycle()
-    
 
-    // we need to check here if we still are listining to this tree for change events
-    // the tree could have been replaced without telling us
-    if ( tau->getValue().getTreeChangeEventHandler().isListening( this ) == false )
+    if ( branch_optimization_node == NULL )
     {
-        tau->getValue().getTreeChangeEventHandler().addListener( this );
-        dirty_nodes = std::vector<bool>(num_nodes, true);
+        throw RbException("We need to prepare a branch before we can compute the derivatives of its length.");
     }
 
+    const TopologyNode &node = *branch_optimization_node;
+    size_t node_index = node.getIndex();
 
-    // if we are not in MCMC mode, then we need to (temporarily) allocate memory
-    if ( in_mcmc_mode == false )
+    double end_age = node.getAge();
+
+    // if the tree is not a time tree, then the age will be not a number
+    if ( RbMath::isFinite(end_age) == false )
     {
-        partialLikelihoods = new double[2*activeLikelihoodOffset];
+        // we assume by default that the end is at time 0
+        end_age = 0.0;
     }
+    double start_age = end_age + branch_length;
 
-    // compute the ln probability by recursively calling the probability calculation for each node
-    const TopologyNode &root = tau->getValue().getRoot();
-
-    // we start with the root and then traverse down the tree
-    size_t root_index = root.getIndex();
+    std::vector<TransitionProbabilityMatrix> tp = std::vector<TransitionProbabilityMatrix>( num_site_mixtures, TransitionProbabilityMatrix(num_chars) );
+    computeTransitionProbabilities( node_index, start_age, end_age, tp );
 
-    // only necessary if the root is actually dirty
-    if ( dirty_nodes[root_index] == true )
+    // get the rate matrices for this branch, using the same matrices as for the transition probabilities
+    size_t num_site_matrices = num_site_mixtures / num_site_rates;
+    std::vector<double> rate_matrices = std::vector<double>(num_site_matrices*num_chars*num_chars, 0.0);
+    RateMatrix_JC jc(this->num_chars);
+    for (size_t matrix = 0; matrix < num_site_matrices; ++matrix)
     {
-
-        // start by filling the likelihood vector for the children of the root
-        if ( root.getNumberOfChildren() == 2 ) // rooted trees have two children for the root
+        const RateGenerator *rm = &jc;
+        if ( this->heterogeneous_rate_matrices != NULL )
         {
-            const TopologyNode &left = root.getChild(0);
-            size_t left_index = left.getIndex();
-            fillLikelihoodVector( left, left_index );
-            const TopologyNode &right = root.getChild(1);
-            size_t right_index = right.getIndex();
-            fillLikelihoodVector( right, right_index );
-
-            computeRootLikelihood( root_index, left_index, right_index );
-            scale(root_index, left_index, right_index);
-
+            rm = &this->heterogeneous_rate_matrices->getValue()[ (this->branch_heterogeneous_substitution_matrices == true ? node_index : matrix) ];
         }
-        else if ( root.getNumberOfChildren() == 3 ) // unrooted trees have three children for the root
+        else if ( this->homogeneous_rate_matrix != NULL )
         {
-            const TopologyNode &left = root.getChild(0);
-            size_t left_index = left.getIndex();
-            fillLikelihoodVector( left, left_index );
-            const TopologyNode &right = root.getChild(1);
-            size_t right_index = right.getIndex();
-            fillLikelihoodVector( right, right_index );
-            const TopologyNode &middle = root.getChild(2);
-            size_t middleIndex = middle.getIndex();
-            fillLikelihoodVector( middle, middleIndex );
+            rm = &this->homogeneous_rate_matrix->getValue();
+        }
 
-            computeRootLikelihood( root_index, left_index, right_index, middleIndex );
-            scale(root_index, left_index, right_index, middleIndex);
+        double* q = &rate_matrices[matrix*num_chars*num_chars];
+        for (size_t c1 = 0; c1 < num_chars; ++c1)
+        {
+            for (size_t c2 = 0; c2 < num_chars; ++c2)
+            {
+                q[c1*num_chars + c2] = rm->getRate( c1, c2, start_age, 1.0 );
+            }
+        }
+    }
 
+    // the first and second derivatives of the transition probabilities with respect to the branch length
+    double clock_rate = getBranchClockRate( node_index );
+    std::vector<double> dtp  = std::vector<double>(num_site_mixtures*num_chars*num_chars, 0.0);
+    std::vector<double> d2tp = std::vector<double>(num_site_mixtures*num_chars*num_chars, 0.0);
+    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+    {
+        double r = clock_rate * getSiteRate( mixture / num_site_matrices );
+        const double* q      = &rate_matrices[(mixture % num_site_matrices)*num_chars*num_chars];
+        const double* tp_m   = tp[mixture].theMatrix;
+        double*       dtp_m  = &dtp[mixture*num_chars*num_chars];
+        double*       d2tp_m = &d2tp[mixture*num_chars*num_chars];
+        for (size_t c1 = 0; c1 < num_chars; ++c1)
+        {
+            for (size_t c2 = 0; c2 < num_chars; ++c2)
+            {
+                double tmp = 0.0;
+                for (size_t l = 0; l < num_chars; ++l)
+                {
+                    tmp += q[c1*num_chars + l] * tp_m[l*num_chars + c2];
+                }
+                dtp_m[c1*num_chars + c2] = tmp;
+            }
         }
-        else
+        for (size_t c1 = 0; c1 < num_chars; ++c1)
         {
-            throw RbException("The root node has an unexpected number of children. Only 2 (for rooted trees) or 3 (for unrooted trees) are allowed.");
+            for (size_t c2 = 0; c2 < num_chars; ++c2)
+            {
+                double tmp = 0.0;
+                for (size_t l = 0; l < num_chars; ++l)
+                {
+                    tmp += q[c1*num_chars + l] * dtp_m[l*num_chars + c2];
+                }
+                d2tp_m[c1*num_chars + c2] = r * r * tmp;
+            }
+        }
+        for (size_t k = 0; k < num_chars*num_chars; ++k)
+        {
+            dtp_m[k] *= r;
         }
-
-        // sum the partials up
-        this->lnProb = sumRootLikelihood();
-
     }
 
-    // if we are not in MCMC mode, then we need to (temporarily) free memory
-    if ( in_mcmc_mode == false )
+    std::vector<double> mixture_probs = getMixtureProbs();
+    double prob_invariant = getPInv();
+    double one_minus_p_inv = 1.0 - prob_invariant;
+    std::vector<double> f_invariant;
+    if ( prob_invariant > 0.0 )
     {
-        // free the partial likelihoods
-        delete [] partialLikelihoods;
-        partialLikelihoods = NULL;
+        f_invariant = getInvariantSiteFrequencies();
     }
 
-    // set the ancestral states as stale
-    has_ancestral_states = false;
-
-    return this->lnProb;
-}
+    std::vector<double> site_ln_likelihoods = std::vector<double>(pattern_block_size, 0.0);
+    std::vector<double> site_first          = std::vector<double>(pattern_block_size, 0.0);
+    std::vector<double> site_second         = std::vector<double>(pattern_block_size, 0.0);
 
+    this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
+    {
+        for (size_t site = first_pattern; site < last_pattern; ++site)
+        {
+            double likelihood = 0.0;
+            double derivative = 0.0;
+            double second_derivative = 0.0;
+            for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+            {
+                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                const double* u      = &branch_outside_partials[offset];
+                const double* d      = &branch_inside_partials[offset];
+                const double* tp_m   = tp[mixture].theMatrix;
+                const double* dtp_m  = &dtp[mixture*num_chars*num_chars];
+                const double* d2tp_m = &d2tp[mixture*num_chars*num_chars];
+                double tmp_likelihood = 0.0;
+                double tmp_derivative = 0.0;
+                double tmp_second_derivative = 0.0;
+                for (size_t c1 = 0; c1 < num_chars; ++c1)
+                {
+                    double tmp_0 = 0.0;
+                    double tmp_1 = 0.0;
+                    double tmp_2 = 0.0;
+                    for (size_t c2 = 0; c2 < num_chars; ++c2)
+                    {
+                        tmp_0 += tp_m[c1*num_chars + c2] * d[c2];
+                        tmp_1 += dtp_m[c1*num_chars + c2] * d[c2];
+                        tmp_2 += d2tp_m[c1*num_chars + c2] * d[c2];
+                    }
+                    tmp_likelihood        += u[c1] * tmp_0;
+                    tmp_derivative        += u[c1] * tmp_1;
+                    tmp_second_derivative += u[c1] * tmp_2;
+                }
+                likelihood        += mixture_probs[mixture] * tmp_likelihood;
+                derivative        += mixture_probs[mixture] * tmp_derivative;
+                second_derivative += mixture_probs[mixture] * tmp_second_derivative;
+            }
 
-template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalNodeLikelihood( size_t node_index, size_t parentnode_index )
-{
+            // the same treatment of the invariant sites as in computeRootLikelihoods,
+            // where the invariant component does not depend on the branch length
+            double ln_variable_likelihood = log( one_minus_p_inv * likelihood ) - branch_ln_scaling[site];
+            double ln_site_likelihood = ln_variable_likelihood;
+            if ( prob_invariant > 0.0 && this->site_invariant[site] == true )
+            {
+                if ( this->invariant_site_index[site] < num_chars )
+                {
+                    double ln_invariant_likelihood = log( prob_invariant * f_invariant[ this->invariant_site_index[site] ] );
+                    double max = ( ln_invariant_likelihood > ln_variable_likelihood ? ln_invariant_likelihood : ln_variable_likelihood );
+                    ln_site_likelihood = max + log( exp(ln_invariant_likelihood - max) + exp(ln_variable_likelihood - max) );
+                }
+                else
+                {
+                    continue;
+                }
+            }
 
-    // compute the transition probability matrix
-    this->updateTransitionProbabilities( node_index );
+            // the fraction of the site likelihood coming from the variable component
+            double w = exp( ln_variable_likelihood - ln_site_likelihood );
+            double count = double( this->pattern_counts[site] );
+            if ( likelihood > 0.0 )
+            {
+                double ratio_first  = w * derivative / likelihood;
+                double ratio_second = w * second_derivative / likelihood;
+                site_first[site]  = count * ratio_first;
+                site_second[site] = count * (ratio_second - ratio_first * ratio_first);
+            }
+            site_ln_likelihoods[site] = count * ln_site_likelihood;
+        }
+    });
 
-    // get the pointers to the partial likelihoods and the marginal likelihoods
-    const double*   p_node                  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    double*         p_node_marginal         = this->marginalLikelihoods + node_index*this->nodeOffset;
-    const double*   p_parent_node_marginal  = this->marginalLikelihoods + parentnode_index*this->nodeOffset;
+    double values[3] = { 0.0, 0.0, 0.0 };
+    for (size_t site = 0; site < pattern_block_size; ++site)
+    {
+        values[0] += site_ln_likelihoods[site];
+        values[1] += site_first[site];
+        values[2] += site_second[site];
+    }
 
-    // get pointers the likelihood for both subtrees
-    const double*   p_mixture                   = p_node;
-    double*         p_mixture_marginal          = p_node_marginal;
-    const double*   p_parent_mixture_marginal   = p_parent_node_marginal;
+#ifdef RB_MPI
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // we only need to send message if there is more than one process
+    if ( num_processes > 1 )
     {
-        // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
 
-        // get pointers to the likelihood for this mixture category
-        const double*   p_site_mixture                  = p_mixture;
-        double*         p_site_mixture_marginal         = p_mixture_marginal;
-        const double*   p_parent_site_mixture_marginal  = p_parent_mixture_marginal;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        // send the values from the helpers to the master
+        if ( process_active == false )
         {
-            // get the pointers to the likelihoods for this site and mixture category
-            const double*   p_site_j                    = p_site_mixture;
-            double*         p_site_marginal_j           = p_site_mixture_marginal;
-            // iterate over all end states
-            for (size_t j=0; j<num_chars; ++j)
-            {
-                const double*   p_parent_site_marginal_k    = p_parent_site_mixture_marginal;
-                *p_site_marginal_j = 0.0;
+            MPI_Send(values, 3, MPI_DOUBLE, active_PID, 0, MPI_COMM_WORLD);
+        }
 
-                // iterator over all start states
-                for (size_t k=0; k<num_chars; ++k)
+        // receive the values from the helpers
+        if ( process_active == true )
+        {
+            for (size_t i=active_PID+1; i<active_PID+num_processes; ++i)
+            {
+                double tmp[3];
+                MPI_Status status;
+                MPI_Recv(tmp, 3, MPI_DOUBLE, int(i), 0, MPI_COMM_WORLD, &status);
+                for (size_t k = 0; k < 3; ++k)
                 {
-                    // transition probability for k->j
-                    const double tp_kj = *p_parent_site_marginal_k * tp_begin[ k * num_chars + j ];
-
-                    // add the probability of starting from this state
-                    *p_site_marginal_j += *p_site_j * tp_kj;
-
-                    // next parent state
-                    ++p_parent_site_marginal_k;
+                    values[k] += tmp[k];
                 }
-
-                // increment pointers
-                ++p_site_j; ++p_site_marginal_j;
             }
+        }
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset; p_parent_site_mixture_marginal+=this->siteOffset;
-
-        } // end-for over all sites (=patterns)
+        // now send back the combined values to the helpers
+        if ( process_active == true )
+        {
+            for (size_t i=active_PID+1; i<active_PID+num_processes; ++i)
+            {
+                MPI_Send(values, 3, MPI_DOUBLE, int(i), 0, MPI_COMM_WORLD);
+            }
+        }
+        else
+        {
+            MPI_Status status;
+            MPI_Recv(values, 3, MPI_DOUBLE, active_PID, 0, MPI_COMM_WORLD, &status);
+        }
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset; p_parent_mixture_marginal+=this->mixtureOffset;
+    }
 
-    } // end-for over all mixtures (=rate categories)
+#endif
 
+    ln_likelihood = values[0];
+    first         = values[1];
+    second        = values[2];
 }
 
 
-
+/**
+ * Compute the derivatives of the log-likelihood with respect to the branch lengths.
+ * The vector is indexed by the node index; the entry for the root is 0.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalRootLikelihood( void )
+std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeBranchLengthGradient( void )
 {
-    // get the root node
-    const TopologyNode &root = tau->getValue().getRoot();
-
-    // get root frequencies
-    std::vector<std::vector<double> >   ff;
-    getRootFrequencies(ff);
-
-    // get the index of the root node
-    size_t node_index = root.getIndex();
-
-    // get the pointers to the partial likelihoods and the marginal likelihoods
-    const double*   p_node           = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    double*         p_node_marginal  = this->marginalLikelihoods + node_index*this->nodeOffset;
 
-    // get pointers the likelihood for both subtrees
-    const double*   p_mixture           = p_node;
-    double*         p_mixture_marginal  = p_node_marginal;
+    std::vector<std::vector<double> > d;
+    computeBranchTimeDerivatives( d );
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    std::vector<double> gradient = std::vector<double>(num_nodes, 0.0);
+    for (size_t node_index = 0; node_index < num_nodes; ++node_index)
     {
-        // get root frequencies
-        const std::vector<double>&          f           = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
-
-        // get pointers to the likelihood for this mixture category
-        const double*   p_site_mixture          = p_mixture;
-        double*         p_site_mixture_marginal = p_mixture_marginal;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        double clock_rate = getBranchClockRate( node_index );
+        for (size_t j = 0; j < num_site_rates; ++j)
         {
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j             = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-            const double*   p_site_j            = p_site_mixture;
-            double*         p_site_marginal_j   = p_site_mixture_marginal;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
-            {
-                // add the probability of starting from this state
-                *p_site_marginal_j = *p_site_j * *f_j;
-
-                // increment pointers
-                ++p_site_j; ++p_site_marginal_j;
-            }
-
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset;
-
-        } // end-for over all sites (=patterns)
-
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset;
-
-    } // end-for over all mixtures (=rate categories)
+            gradient[node_index] += clock_rate * getSiteRate( j ) * d[node_index][j];
+        }
+    }
 
+    return gradient;
 }
 
 
 /**
- * Draw a vector of ancestral states from the marginal distribution (non-conditional of the other ancestral states).
- * Here we assume that the marginal likelihoods have been updated.
+ * Compute the derivatives of the log-likelihood with respect to the expected number of substitutions
+ * along each branch for each site rate category, i.e., with respect to t = clock rate * site rate * branch length.
+ *
+ * We use the pre-order (outside) partial likelihoods: one post-order traversal computes the usual partial likelihoods,
+ * and one pre-order traversal computes for every branch the probability of the data outside the subtree.
+ * Since dP(t)/dt = Q P(t), the derivative for a branch is then a product of the outside partials,
+ * Q P(t) and the inside partials. Thus, the gradient for all branches costs about two likelihood evaluations,
+ * instead of two likelihood evaluations per branch for finite differences.
+ * The transition probabilities P(t) are reused from the likelihood computation, so we never need the eigensystem directly.
+ *
+ * The result d[node][rate_category] is summed over all patterns (and MPI processes).
  */
 template<class charType>
-std::vector<charType> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawAncestralStatesForNode(const TopologyNode &node)
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeBranchTimeDerivatives( std::vector<std::vector<double> > &d )
 {
 
-    size_t node_index = node.getIndex();
-
-    // get the marginal likelihoods
-    std::vector< std::vector<double> >* marginals = sumMarginalLikelihoods(node_index);
+    if ( using_weighted_characters == true )
+    {
+        throw RbException("Gradients of the phylogenetic CTMC are not implemented for weighted characters.");
+    }
 
-    RandomNumberGenerator* rng = GLOBAL_RNG;
-    std::vector< charType > ancestralSeq = std::vector<charType>();
+    bool delete_partial_likelihoods = false;
 
-    for ( size_t i = 0; i < num_sites; ++i )
+    // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+    if ( in_mcmc_mode == false )
     {
-		size_t pattern = i;
-		// if the matrix is compressed use the pattern for this site
-		if ( compressed == true )
+        delete_partial_likelihoods = true;
+        partialLikelihoods = new double[2*activeLikelihoodOffset];
+        in_mcmc_mode = true;
+
+        for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
         {
-            pattern = site_pattern[i];
+            (*it) = true;
         }
+    }
 
-        // create the character
-        charType c = charType( num_chars );
-        c.setToFirstState();
+    // make sure the partial likelihoods are up-to-date
+    computeLnProbability();
 
-        // sum the likelihoods for each character state
-        const std::vector<double> siteMarginals = (*marginals)[pattern];
-        double sumMarginals = 0.0;
-        for (int j = 0; j < siteMarginals.size(); j++)
+    d = std::vector<std::vector<double> >(num_nodes, std::vector<double>(num_site_rates, 0.0) );
+
+    const TopologyNode &root = tau->getValue().getRoot();
+    size_t root_index = root.getIndex();
+    const double* p_root = this->partialLikelihoods + this->activeLikelihood[root_index]*this->activeLikelihoodOffset + root_index*this->nodeOffset;
+
+    // the log-likelihood of each pattern, including the invariant sites
+    std::vector<double> site_likelihoods = std::vector<double>(pattern_block_size, 0.0);
+    computeRootLikelihoods( site_likelihoods );
+
+    // the weight of each pattern is its count times the probability of being a variable site given the data,
+    // because the invariant-site component does not depend on the branch lengths
+    std::vector<double> mixture_probs = getMixtureProbs();
+    double one_minus_p_inv = 1.0 - getPInv();
+    bool use_scaling = RbSettings::userSettings().getUseScaling();
+    std::vector<double> site_weights = std::vector<double>(pattern_block_size, 0.0);
+    for (size_t site = 0; site < pattern_block_size; ++site)
+    {
+        double variable_likelihood = 0.0;
+        for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
         {
-            sumMarginals += siteMarginals[j];
+            const double* p_site_mixture = p_root + mixture*this->mixtureOffset + site*this->siteOffset;
+            for (size_t c = 0; c < num_chars; ++c)
+            {
+                variable_likelihood += mixture_probs[mixture] * p_site_mixture[c];
+            }
         }
 
-        double u = rng->uniform01();
-        if (sumMarginals == 0.0)
+        double ln_variable_likelihood = log( one_minus_p_inv * variable_likelihood );
+        if ( use_scaling == true )
         {
+            ln_variable_likelihood -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[root_index]][root_index][site];
+        }
 
-            // randomly draw state if all states have 0 probability
-            c.setStateByIndex((size_t)(u*c.getNumberOfStates()));
-
+        double count = double(pattern_counts[site]);
+        if ( count > 0.0 )
+        {
+            site_weights[site] = count * exp( ln_variable_likelihood - site_likelihoods[site] / count );
         }
-        else
+    }
+
+    // the outside partial likelihoods at the root are the root frequencies
+    std::vector<std::vector<double> > ff;
+    getRootFrequencies( ff );
+    std::vector<double> pre_partials = std::vector<double>(num_nodes*this->nodeOffset, 0.0);
+    double* w_root = &pre_partials[root_index*this->nodeOffset];
+    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+    {
+        const std::vector<double> &f = ff[mixture % ff.size()];
+        for (size_t site = 0; site < pattern_block_size; ++site)
         {
+            double* w_site_mixture = w_root + mixture*this->mixtureOffset + site*this->siteOffset;
+            for (size_t c = 0; c < num_chars; ++c)
+            {
+                w_site_mixture[c] = f[c];
+            }
+        }
+    }
 
-            // the marginals don't add up to 1, so rescale u
-            u *= sumMarginals;
+    recursivelyComputeBranchTimeDerivatives( root, pre_partials, site_weights, d );
 
-            // draw the character state
-            size_t stateIndex = 0;
-            while ( true )
-            {
+    // if we are not in MCMC mode, then we need to (temporarily) free memory
+    if ( delete_partial_likelihoods == true )
+    {
+        // free the partial likelihoods
+        delete [] partialLikelihoods;
+        partialLikelihoods = NULL;
+        in_mcmc_mode = false;
+    }
 
-                u -= siteMarginals[stateIndex];
+#ifdef RB_MPI
 
-                if ( u > 0.0 )
-                {
+    // we only need to send message if there is more than one process
+    if ( num_processes > 1 )
+    {
 
-                    if (c.getStateIndex() + 1 >= c.getNumberOfStates())
-                    {
-                        stateIndex = 0;
-                        c.setToFirstState();
-                    }
-                    else
-                    {
-                        c++;
-                        stateIndex++;
-                    }
+        std::vector<double> flat_d = std::vector<double>(num_nodes*num_site_rates, 0.0);
+        for (size_t node_index = 0; node_index < num_nodes; ++node_index)
+        {
+            for (size_t j = 0; j < num_site_rates; ++j)
+            {
+                flat_d[node_index*num_site_rates + j] = d[node_index][j];
+            }
+        }
 
-                }
-                else
+        // send the derivatives from the helpers to the master
+        if ( process_active == false )
+        {
+            MPI_Send(&flat_d[0], int(flat_d.size()), MPI_DOUBLE, active_PID, 0, MPI_COMM_WORLD);
+        }
+
+        // receive the derivatives from the helpers
+        if ( process_active == true )
+        {
+            std::vector<double> tmp = std::vector<double>(flat_d.size(), 0.0);
+            for (size_t i=active_PID+1; i<active_PID+num_processes; ++i)
+            {
+                MPI_Status status;
+                MPI_Recv(&tmp[0], int(tmp.size()), MPI_DOUBLE, int(i), 0, MPI_COMM_WORLD, &status);
+                for (size_t k = 0; k < flat_d.size(); ++k)
                 {
-                    break;
+                    flat_d[k] += tmp[k];
                 }
             }
         }
 
-        // add the character to the sequence
-        ancestralSeq.push_back( c );
+        // now send back the combined derivatives to the helpers
+        if ( process_active == true )
+        {
+            for (size_t i=active_PID+1; i<active_PID+num_processes; ++i)
+            {
+                MPI_Send(&flat_d[0], int(flat_d.size()), MPI_DOUBLE, int(i), 0, MPI_COMM_WORLD);
+            }
+        }
+        else
+        {
+            MPI_Status status;
+            MPI_Recv(&flat_d[0], int(flat_d.size()), MPI_DOUBLE, active_PID, 0, MPI_COMM_WORLD, &status);
+        }
+
+        for (size_t node_index = 0; node_index < num_nodes; ++node_index)
+        {
+            for (size_t j = 0; j < num_site_rates; ++j)
+            {
+                d[node_index][j] = flat_d[node_index*num_site_rates + j];
+            }
+        }
+
     }
 
-    // we need to free the vector
-    delete marginals;
+#endif
 
-    return ancestralSeq;
 }
 
 
 /**
- * Draw a vector of ancestral states from the joint-conditional distribution of states.
+ * Compute the derivatives of the log-likelihood with respect to the clock rate.
+ * For a global clock the vector has a single element, otherwise there is one element per branch (indexed by node).
  */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates)
+std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeClockRateGradient( void )
 {
 
-	// if we already have ancestral states, don't make new ones
-    
-    // MJL 181028: Disabling this flag to allow multiple monitors to work for same dnPhyloCTMC (e.g. ancestral states + stochastic mapping)
-//	if ( has_ancestral_states == true )
-//    {
-//		return;
-//    }
-    
-    RandomNumberGenerator* rng = GLOBAL_RNG;
+    std::vector<std::vector<double> > d;
+    computeBranchTimeDerivatives( d );
 
-    // get working variables
-    std::vector<double> siteProbVector = getMixtureProbs();
+    const std::vector<TopologyNode*> &nodes = tau->getValue().getNodes();
+    double one_minus_p_inv = 1.0 - getPInv();
 
-    const TopologyNode &root = tau->getValue().getRoot();
-    size_t node_index = root.getIndex();
+    std::vector<double> gradient = std::vector<double>( (branch_heterogeneous_clock_rates == true ? num_nodes : 1), 0.0);
+    for (size_t node_index = 0; node_index < num_nodes; ++node_index)
+    {
+        if ( nodes[node_index]->isRoot() == true )
+        {
+            continue;
+        }
 
-    // get the pointers to the partial likelihoods and the marginal likelihoods
-    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+        double branch_length = nodes[node_index]->getBranchLength();
+        double tmp = 0.0;
+        for (size_t j = 0; j < num_site_rates; ++j)
+        {
+            tmp += getSiteRate( j ) * d[node_index][j];
+        }
 
-    // get pointers the likelihood for both subtrees
-    const double*   p_site           = p_node;
+        gradient[ (branch_heterogeneous_clock_rates == true ? node_index : 0) ] += branch_length / one_minus_p_inv * tmp;
+    }
 
-    // sample root states
-    std::vector<double> p( this->num_site_mixtures*this->num_chars, 0.0);
+    return gradient;
+}
 
-    // clear the container for sampling the site-rates
-    sampled_site_mixtures.resize(this->num_sites);
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::prepareLnProbability( void )
+{
     
-    for (size_t i = 0; i < this->num_sites; ++i)
-//    for (size_t i = pattern_block_start; i < this->pattern_block_end; ++i)
+    // the tree could have been replaced without telling us
+    // several likelihoods may listen to the same tree, so we only register here and not concurrently
+    if ( tau->getValue().getTreeChangeEventHandler().isListening( this ) == false )
     {
+        tau->getValue().getTreeChangeEventHandler().addListener( this );
+        dirty_nodes = std::vector<bool>(num_nodes, true);
+        traversal_stale = true;
+    }
+    
+}
 
-        // create the character
-        charType c = charType( template_state );
-
-        // sum to sample
-        double sum = 0.0;
 
-        // if the matrix is compressed use the pattern for this site
-        size_t pattern = i - pattern_block_start;
-        if ( compressed == true )
-        {
-            pattern = site_pattern[i - pattern_block_start];
-        }
+template<class charType>
+double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbability( void )
+{
+    // @todo: #thread
+    // This part should be done on several threads if possible
+    // That means we should probabily call this function as a job,
+    // where a job is defined as computing the lnProbability for a subset of the data (block)
+    // Sebastian: this call is very slow; a lot of work happens in nextCycle()
+    
 
-        // get ptr to first mixture cat for site
-        p_site          = p_node  + pattern * this->siteOffset;
+    // we need to check here if we still are listining to this tree for change events
+    prepareLnProbability();
 
-        // iterate over all mixture categories
-        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
-        {
 
-            // get pointers to the likelihood for this mixture category
-            const double* p_site_mixture_j       = p_site;
+    // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+    if ( in_mcmc_mode == false )
+    {
+        partialLikelihoods = new double[2*activeLikelihoodOffset];
+    }
 
-            // iterate over all starting states
-            for (size_t state = 0; state < this->num_chars; ++state)
-            {
-                size_t k = this->num_chars*mixture + state;
-                p[k] = *p_site_mixture_j * siteProbVector[mixture];
-                sum += p[k];
+    // the compact copy of the topology gives us the post-order traversal
+    if ( traversal_stale == true )
+    {
+        traversal_tree.assign( tau->getValue(), false );
+        traversal_stale = false;
+    }
 
-                // increment the pointers to the next state for (site,rate)
-                p_site_mixture_j++;
-            }
+    const TopologyNode &root = tau->getValue().getRoot();
+    const std::vector<TopologyNode*> &nodes = tau->getValue().getNodes();
 
-            // increment the pointers to the next mixture category for given site
-            p_site       += this->mixtureOffset;
+    // we start with the root and then traverse down the tree
+    size_t root_index = root.getIndex();
 
-        } // end-for over all mixtures (=rate categories)
+    // only necessary if the root is actually dirty
+    if ( dirty_nodes[root_index] == true )
+    {
 
-        // sample char from p
-        bool stop = false;
-        double u = rng->uniform01() * sum;
-        for (size_t mixture = 0; mixture < this->num_site_mixtures; mixture++)
+        // compute the likelihoods of all dirty nodes below the root, children before their parents
+        // the dirty flags were set for whole paths to the root, so the children of a dirty node are up-to-date once we reach it
+        const std::vector<size_t> &post_order = traversal_tree.getPostOrder();
+        for (size_t i = 0; i < post_order.size(); ++i)
         {
-            c.setToFirstState();
-            for (size_t state = 0; state < this->num_chars; state++)
+            size_t node_index = post_order[i];
+            if ( node_index == root_index || dirty_nodes[node_index] == false )
             {
-                size_t k = this->num_chars * mixture + state;
-                u -= p[k];
-                if (u < 0.0)
-                {
-                    startStates[root.getIndex()][i] = c;
-                    sampled_site_mixtures[i] = mixture;
-                    stop = true;
-                    break;
-                }
-                if (c.getStateIndex() + 1 >= c.getNumberOfStates())
+                continue;
+            }
+
+            // mark as computed
+            dirty_nodes[node_index] = false;
+
+            const TopologyNode &node = *nodes[node_index];
+            if ( traversal_tree.getNumberOfChildren(node_index) == 0 )
+            {
+                // this is a tip node
+                // compute the likelihood for the tip and we are done
                 {
-                    c.setToFirstState();
+                    Profiler::Timer timer( Profiler::LIKELIHOOD, "partial likelihoods" );
+                    computeTipLikelihood(node, node_index);
                 }
-                else
+
+                // rescale likelihood vector
+                Profiler::Timer timer( Profiler::LIKELIHOOD, "scaling" );
+                scale(node_index);
+            }
+            else
+            {
+                // this is an internal node
+                size_t left_index  = traversal_tree.getChildIndex(node_index, 0);
+                size_t right_index = traversal_tree.getChildIndex(node_index, 1);
+
+                // now compute the likelihoods of this internal node
                 {
-                    c++;
+                    Profiler::Timer timer( Profiler::LIKELIHOOD, "partial likelihoods" );
+                    computeInternalNodeLikelihood(node,node_index,left_index,right_index);
                 }
+
+                // rescale likelihood vector
+                Profiler::Timer timer( Profiler::LIKELIHOOD, "scaling" );
+                scale(node_index,left_index,right_index);
             }
-            if (stop) break;
         }
 
-        endStates[node_index][i] = startStates[node_index][i];
-    }
+        // finally the root
+        Profiler::Timer timer( Profiler::LIKELIHOOD, "root likelihood" );
+        if ( root.getNumberOfChildren() == 2 ) // rooted trees have two children for the root
+        {
+            size_t left_index  = traversal_tree.getChildIndex(root_index, 0);
+            size_t right_index = traversal_tree.getChildIndex(root_index, 1);
 
-    // recurse
-    std::vector<TopologyNode*> children = root.getChildren();
-    for (size_t i = 0; i < children.size(); i++)
-    {
-        // daughters identically inherit ancestral state
-        startStates[ children[i]->getIndex() ] = endStates[ root.getIndex() ];
+            computeRootLikelihood( root_index, left_index, right_index );
+            scale(root_index, left_index, right_index);
 
-        // recurse towards tips
-        if ( children[i]->isTip() == false )
+        }
+        else if ( root.getNumberOfChildren() == 3 ) // unrooted trees have three children for the root
         {
-            recursivelyDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampled_site_mixtures);
+            size_t left_index  = traversal_tree.getChildIndex(root_index, 0);
+            size_t right_index = traversal_tree.getChildIndex(root_index, 1);
+            size_t middleIndex = traversal_tree.getChildIndex(root_index, 2);
+
+            computeRootLikelihood( root_index, left_index, right_index, middleIndex );
+            scale(root_index, left_index, right_index, middleIndex);
+
         }
         else
         {
-            tipDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampled_site_mixtures);
+            throw RbException("The root node has an unexpected number of children. Only 2 (for rooted trees) or 3 (for unrooted trees) are allowed.");
         }
 
+        // sum the partials up
+        this->lnProb = sumRootLikelihood();
+
     }
 
-    // flag the ancestral states as sampled
-    has_ancestral_states = true;
+    // if we are not in MCMC mode, then we need to (temporarily) free memory
+    if ( in_mcmc_mode == false )
+    {
+        // free the partial likelihoods
+        delete [] partialLikelihoods;
+        partialLikelihoods = NULL;
+    }
 
+    // set the ancestral states as stale
+    has_ancestral_states = false;
+
+    return this->lnProb;
 }
 
 
+/**
+ * Compute the gradient of the ln probability with respect to one of our parameters.
+ * We support the clock rate (global or per branch), the site rates and, for a tree, the branch lengths (indexed by node).
+ * Any other parameter, or a parameter that is used for several roles, is left to numerical derivatives by the caller.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawStochasticCharacterMap(std::vector<std::string>& character_histories, size_t site, bool use_simmap_default)
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
 {
 
-    bool success = false;
-    size_t max_draws = 10;
-    size_t n_draws = 0;
-
-    while (!success && n_draws != max_draws) {
-        // first draw joint ancestral states
-        std::vector<std::vector<charType> > start_states(this->num_nodes, std::vector<charType>(this->num_sites, template_state));
-        std::vector<std::vector<charType> > end_states(this->num_nodes, std::vector<charType>(this->num_sites, template_state));
-        this->drawJointConditionalAncestralStates( start_states, end_states );
-
-        // save the character history for the root
-        const TopologyNode &root = this->tau->getValue().getRoot();
-        size_t root_index = root.getIndex();
-        std::string simmap_string = "{" + end_states[root_index][site].getStringValue() + "," + StringUtilities::toString( root.getBranchLength() ) + "}";
-        character_histories[root_index] = simmap_string;
-
-        // the mixture components are in a vector that is a flattened version of a
-        // matrix with rate components in columns and matrix components in rows.
-        // the matrix is in row-major order.
-        // here, we compute the row and column indices from the vector index.
-
-        size_t mixture_component_index = this->sampled_site_mixtures[site];
-
-        // get the number of rate categories
-        size_t num_site_rates = 1;
-        if (this->site_rates != NULL)
-        {
-        	num_site_rates = this->site_rates->getValue().size();
-        }
-
-        // determine the rate (column index)
-        sampled_site_rate_component = 0;
-        if (this->site_rates != NULL)
-        {
-        	sampled_site_rate_component = mixture_component_index % num_site_rates;
-        }
+    if ( p == NULL || using_weighted_characters == true || p == p_inv )
+    {
+        return false;
+    }
 
-        // determine the matrix (row index)
-        sampled_site_matrix_component = 0;
-        if (this->site_matrix_probs != NULL)
+    if ( p == homogeneous_clock_rate )
+    {
+        g = computeClockRateGradient();
+        return true;
+    }
+    else if ( p == heterogeneous_clock_rates && branch_heterogeneous_clock_rates == true )
+    {
+        std::vector<double> tmp = computeClockRateGradient();
+        g = std::vector<double>(heterogeneous_clock_rates->getValue().size(), 0.0);
+        for (size_t i = 0; i < g.size() && i < tmp.size(); ++i)
         {
-        	sampled_site_matrix_component = (mixture_component_index - sampled_site_rate_component) / num_site_rates;
+            g[i] = tmp[i];
         }
-
-        // recurse towards tips
-        const TopologyNode &right = root.getChild(0);
-        const TopologyNode &left = root.getChild(1);
-        success = recursivelyDrawStochasticCharacterMap(left,  character_histories, start_states, end_states, site, use_simmap_default);
-        success &= recursivelyDrawStochasticCharacterMap(right, character_histories, start_states, end_states, site, use_simmap_default);
-
-        if (n_draws != 0) {
-            std::cout << "Warning: numerical instability in P(t)=exp(Qt) caused stochastic mapping to fail (attempt: " << n_draws << "/" << max_draws << ")\n";
-        }
-        n_draws++;
+        return true;
     }
-
-    if (n_draws == max_draws) {
-        throw RbException("Stochastic mapping failed due to numerical instability.");
+    else if ( p == site_rates && rate_variation_across_sites == true )
+    {
+        g = computeSiteRateGradient();
+        return true;
+    }
+    else if ( p == tau )
+    {
+        g = computeBranchLengthGradient();
+        return true;
     }
 
+    return false;
 }
 
-template<class charType>
-bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::hasSiteRateMixture()
-{
-	bool ret = this->num_site_rates > 1;
-	return ret;
-}
-
-template<class charType>
-bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::hasSiteMatrixMixture()
-{
-	bool ret = false;
-
-	if ( this->site_matrix_probs != NULL ) {
-		ret = this->site_matrix_probs->getValue().size() > 1;
-	}
 
-	return ret;
-}
+/**
+ * Compute the ln likelihood for every candidate regraft point of the subtree below 'pruned' (see RegraftLikelihoodEvaluator).
+ *
+ * Let p be the parent of the pruned node. We work on the tree without the pruned subtree, i.e., p is removed and the sibling of the
+ * pruned node is attached to the grandparent. Only the partial likelihoods of the sibling and of the ancestors of p differ from the
+ * current partial likelihoods. One pre-order traversal gives the outside (pre-order) partial likelihoods of the nodes older than p,
+ * see computeBranchTimeDerivatives. Attaching p (with its age t_p) to the branch above a candidate b with parent g then gives
+ *   L = sum_x [ sum_z u_g(z) P_p(t_g - t_p)[z,x] ] * [ sum_y P_b(t_p - t_b)[x,y] inside_b(y) ] * partial_pruned(x)
+ * for each site and mixture category, where u_g is the outside partial likelihood of g times the partial likelihoods of the other children of g.
+ * Thus, all candidates together cost about one likelihood computation plus two transition probability matrices per candidate,
+ * instead of a likelihood computation along the path to the root for each candidate.
+ *
+ * The branches keep the clock rates and rate matrices of the node below them, exactly as if the subtree were regrafted.
+ * We only support trees with node ages, without data at internal nodes and without weighted characters.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getSampledMixtureComponents(size_t &site_index, size_t &rate_component, size_t &matrix_component )
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRegraftLnLikelihoods(const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods)
 {
 
-	// get the mixture component (in vector form)
-	size_t mixture_component_index = this->sampled_site_mixtures[site_index];
-
-	rate_component = 0;
-    if (this->site_rates != NULL)
+    const Tree &tree = tau->getValue();
+    if ( using_weighted_characters == true || store_internal_nodes == true || pruned.getIndex() >= num_nodes || &tree.getNode( pruned.getIndex() ) != &pruned )
     {
-    	rate_component = mixture_component_index % num_site_rates;
+        return false;
     }
-
-    // determine the matrix (row index)
-    matrix_component = 0;
-    if (this->site_matrix_probs != NULL)
+    if ( pruned.isRoot() == true || pruned.getParent().isRoot() == true || pruned.getParent().getNumberOfChildren() != 2 || RbMath::isFinite( tree.getRoot().getAge() ) == false )
     {
-    	matrix_component = (mixture_component_index - rate_component) / num_site_rates;
+        return false;
     }
 
+    const TopologyNode &parent      = pruned.getParent();
+    const TopologyNode &grandparent = parent.getParent();
+    const TopologyNode &brother     = ( &parent.getChild(0) == &pruned ? parent.getChild(1) : parent.getChild(0) );
+    double parent_age = parent.getAge();
 
-}
-
-
-template<class charType>
-bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyDrawStochasticCharacterMap(const TopologyNode &node, std::vector<std::string>& character_histories, std::vector<std::vector<charType> >& start_states, std::vector<std::vector<charType> >& end_states, size_t site, bool use_simmap_default)
-{
-
-    bool success = false;
-
-    // get the start and end states
-    size_t node_index = node.getIndex();
-    size_t start_state = start_states[node_index][site].getStateIndex();
-    size_t end_state = start_state;
-
-    // NOTE: ambiguous tip states are sampled along with internal node states
-    end_state = end_states[node_index][site].getStateIndex();
-
-    // set up vectors to hold the character transition events
-    std::vector<size_t> transition_states;
-    std::vector<double> transition_times;
-    transition_states.push_back(start_state);
-
-    // get the rate matrix for this branch (or site if using a mixture of matrices over sites)
-    RateMatrix_JC jc(this->num_chars);
-    const RateGenerator *rate_matrix = &jc;
-    if ( this->branch_heterogeneous_substitution_matrices == true )
+    // the children of each node in the tree without the pruned subtree
+    std::vector<std::vector<const TopologyNode*> > pruned_children = std::vector<std::vector<const TopologyNode*> >( num_nodes );
+    for (size_t i = 0; i < num_nodes; ++i)
     {
-        if (this->heterogeneous_rate_matrices != NULL)
-        {
-            rate_matrix = &this->heterogeneous_rate_matrices->getValue()[node_index];
-        }
-        else if (this->homogeneous_rate_matrix != NULL)
+        const TopologyNode &n = tree.getNode( i );
+        for (size_t j = 0; j < n.getNumberOfChildren(); ++j)
         {
-            rate_matrix = &this->homogeneous_rate_matrix->getValue();
+            const TopologyNode *child = &n.getChild( j );
+            pruned_children[i].push_back( child == &parent ? &brother : child );
         }
     }
-    else
+
+    // the parent of each candidate in the tree without the pruned subtree
+    std::vector<const TopologyNode*> candidate_parents;
+    for (size_t i = 0; i < candidates.size(); ++i)
     {
-        if (this->homogeneous_rate_matrix != NULL)
+        const TopologyNode *b = candidates[i];
+        if ( b->isRoot() == true || b == &parent || b->getAge() >= parent_age )
         {
-            rate_matrix = &this->homogeneous_rate_matrix->getValue();
+            return false;
         }
-        else if (this->site_matrix_probs != NULL)
+        const TopologyNode *g = ( b == &brother ? &grandparent : &b->getParent() );
+        if ( g == &parent || g->getAge() <= parent_age )
         {
-        	rate_matrix = &this->heterogeneous_rate_matrices->getValue()[this->sampled_site_matrix_component];
+            return false;
         }
+        candidate_parents.push_back( g );
     }
 
-    // get the clock rate for the branch
-    double clock_rate = 1.0;
-    if ( this->branch_heterogeneous_clock_rates == true )
+    bool delete_partial_likelihoods = false;
+
+    // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+    if ( in_mcmc_mode == false )
     {
-        if (this->heterogeneous_clock_rates != NULL)
+        delete_partial_likelihoods = true;
+        partialLikelihoods = new double[2*activeLikelihoodOffset];
+        in_mcmc_mode = true;
+
+        for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
         {
-            clock_rate = this->heterogeneous_clock_rates->getValue()[node_index];
+            (*it) = true;
         }
     }
-    else
+
+    // make sure the partial likelihoods are up-to-date
+    computeLnProbability();
+
+    std::vector<double> mixture_probs = getMixtureProbs();
+    bool use_scaling = RbSettings::userSettings().getUseScaling();
+
+    // the partial likelihoods at the top of each branch (as computed by the pruning algorithm) and their ln scaling factors,
+    // so that the partial likelihood is the stored value times exp(-ln_scaling)
+    std::vector<const double*> top_partials = std::vector<const double*>( num_nodes, NULL );
+    std::vector<std::vector<double> > ln_scaling = std::vector<std::vector<double> >( num_nodes, std::vector<double>(pattern_block_size, 0.0) );
+    std::vector<size_t> data_tip_indices = std::vector<size_t>( num_nodes, 0 );
+    for (size_t i = 0; i < num_nodes; ++i)
     {
-        if (this->homogeneous_clock_rate != NULL)
+        top_partials[i] = this->partialLikelihoods + this->activeLikelihood[i]*this->activeLikelihoodOffset + i*this->nodeOffset;
+        if ( use_scaling == true )
         {
-            clock_rate = this->homogeneous_clock_rate->getValue();
+            ln_scaling[i] = this->perNodeSiteLogScalingFactors[this->activeLikelihood[i]][i];
+        }
+        if ( tree.getNode( i ).isTip() == true )
+        {
+            data_tip_indices[i] = this->taxon_name_2_tip_index_map[ tree.getNode( i ).getName() ];
         }
     }
 
-    // multiply by the clock-rate for the site
-    if (this->site_rates != NULL)
+    // the partial likelihoods at the bottom of the branch above a node, i.e., the product over the children,
+    // and the sum of the ln scaling factors of the children
+    auto computeInside = [&](const TopologyNode &n, size_t site, size_t offset, std::vector<double> &inside) -> double
     {
-    	// there is a mixture over site rates
-    	clock_rate *= this->site_rates->getValue()[this->sampled_site_rate_component];
-    }
+        size_t node_index = n.getIndex();
+        double ln_scaling_children = 0.0;
+        if ( n.isTip() == true )
+        {
+            size_t data_tip_index = data_tip_indices[node_index];
+            for (size_t c = 0; c < num_chars; ++c)
+            {
+                if ( this->gap_matrix[data_tip_index][site] == true )
+                {
+                    inside[c] = 1.0;
+                }
+                else if ( using_ambiguous_characters == true )
+                {
+                    inside[c] = ( this->ambiguous_char_matrix[data_tip_index][site].isSet(c) == true ? 1.0 : 0.0 );
+                }
+                else
+                {
+                    inside[c] = ( this->char_matrix[data_tip_index][site] == c ? 1.0 : 0.0 );
+                }
+            }
+        }
+        else
+        {
+            std::fill( inside.begin(), inside.end(), 1.0 );
+            const std::vector<const TopologyNode*> &children = pruned_children[node_index];
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                size_t child_index = children[i]->getIndex();
+                const double* p_child = top_partials[child_index] + offset;
+                for (size_t c = 0; c < num_chars; ++c)
+                {
+                    inside[c] *= p_child[c];
+                }
+                ln_scaling_children += ln_scaling[child_index][site];
+            }
+        }
+        return ln_scaling_children;
+    };
 
-    // now sample a character history for the branch leading to this node
-    double start_age;
-    double end_age;
-    if (RbMath::isFinite( node.getAge() ) == true)
+    std::vector<TransitionProbabilityMatrix> tp = std::vector<TransitionProbabilityMatrix>( num_site_mixtures, TransitionProbabilityMatrix(num_chars) );
+
+    // first, we recompute the partial likelihoods of the sibling (which now has the branch from the grandparent) and of the ancestors
+    std::vector<const TopologyNode*> path;
+    path.push_back( &brother );
+    for (const TopologyNode *n = &grandparent; n->isRoot() == false; n = &n->getParent())
     {
-        start_age = node.getParent().getAge();
-        end_age = node.getAge();
+        path.push_back( n );
     }
-    else
+    std::vector<std::vector<double> > path_partials = std::vector<std::vector<double> >( path.size(), std::vector<double>(this->nodeOffset, 0.0) );
+    for (size_t k = 0; k < path.size(); ++k)
     {
-        double branch_length = node.getBranchLength();
-        if (branch_length < 0.0)
+        const TopologyNode &n = *path[k];
+        size_t node_index = n.getIndex();
+        double start_age = ( &n == &brother ? grandparent.getAge() : n.getParent().getAge() );
+        computeTransitionProbabilities( node_index, start_age, n.getAge(), tp );
+
+        double* p_node = &path_partials[k][0];
+        this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
         {
-            branch_length = 1.0;
-        }
-        start_age = branch_length;
-        end_age = 0.0;
-    }
+            std::vector<double> inside = std::vector<double>(num_chars, 0.0);
+            for (size_t site = first_pattern; site < last_pattern; ++site)
+            {
+                double ln_scaling_children = 0.0;
+                double max = 0.0;
+                for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+                {
+                    size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                    ln_scaling_children = computeInside( n, site, offset, inside );
 
+                    const double* tp_m = tp[mixture].theMatrix;
+                    for (size_t c1 = 0; c1 < num_chars; ++c1)
+                    {
+                        double tmp = 0.0;
+                        for (size_t c2 = 0; c2 < num_chars; ++c2)
+                        {
+                            tmp += tp_m[c1*num_chars + c2] * inside[c2];
+                        }
+                        p_node[offset + c1] = tmp;
+                        max = ( tmp > max ? tmp : max );
+                    }
+                }
 
-    // simulate stochastic map
-    transition_states.push_back(end_state);
-    success = const_cast<RateGenerator*>(rate_matrix)->simulateStochasticMapping(start_age, end_age, clock_rate, transition_states, transition_times);
+                // rescale to avoid underflow
+                ln_scaling[node_index][site] = ln_scaling_children;
+                if ( max > 0.0 )
+                {
+                    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+                    {
+                        double* p_site_mixture = p_node + mixture*this->mixtureOffset + site*this->siteOffset;
+                        for (size_t c = 0; c < num_chars; ++c)
+                        {
+                            p_site_mixture[c] /= max;
+                        }
+                    }
+                    ln_scaling[node_index][site] -= log(max);
+                }
+            }
+        });
 
-    // make SIMMAP string
-    std::string simmap_string = "{";
+        top_partials[node_index] = p_node;
+    }
 
-    if (use_simmap_default == true)
+    // second, we compute the outside partial likelihoods of all nodes older than p in one pre-order traversal
+    const TopologyNode &root = tree.getRoot();
+    std::vector<double> pre_partials = std::vector<double>( num_nodes*this->nodeOffset, 0.0 );
+    std::vector<std::vector<double> > ln_pre_scaling = std::vector<std::vector<double> >( num_nodes, std::vector<double>(pattern_block_size, 0.0) );
+
+    std::vector<std::vector<double> > ff;
+    getRootFrequencies( ff );
+    double* w_root = &pre_partials[root.getIndex()*this->nodeOffset];
+    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
     {
-        for (size_t i = transition_times.size(); i > 0; i--)
+        const std::vector<double> &f = ff[mixture % ff.size()];
+        for (size_t site = 0; site < pattern_block_size; ++site)
         {
-            simmap_string = simmap_string + StringUtilities::toString(transition_states[i - 1]) + "," + StringUtilities::toString(transition_times[i - 1]);
-            if (i != 1)
+            double* w_site_mixture = w_root + mixture*this->mixtureOffset + site*this->siteOffset;
+            for (size_t c = 0; c < num_chars; ++c)
             {
-                simmap_string = simmap_string + ":";
+                w_site_mixture[c] = f[c];
             }
         }
     }
-    else
+
+    // the outside partial likelihoods at the top of the branch above child, i.e., of the parent times the siblings,
+    // and the sum of the corresponding ln scaling factors
+    auto computeOutside = [&](const TopologyNode &n, const TopologyNode &child, size_t site, size_t offset, std::vector<double> &u) -> double
     {
-        for (size_t i = 0; i < transition_times.size(); i++)
+        size_t node_index = n.getIndex();
+        const double* w_node = &pre_partials[node_index*this->nodeOffset] + offset;
+        double ln_scaling_outside = ln_pre_scaling[node_index][site];
+        for (size_t c = 0; c < num_chars; ++c)
         {
-            if (i != 0)
+            u[c] = w_node[c];
+        }
+        const std::vector<const TopologyNode*> &children = pruned_children[node_index];
+        for (size_t i = 0; i < children.size(); ++i)
+        {
+            if ( children[i] != &child )
             {
-                simmap_string = simmap_string + ":";
+                size_t sibling_index = children[i]->getIndex();
+                const double* p_sibling = top_partials[sibling_index] + offset;
+                for (size_t c = 0; c < num_chars; ++c)
+                {
+                    u[c] *= p_sibling[c];
+                }
+                ln_scaling_outside += ln_scaling[sibling_index][site];
             }
-            simmap_string = simmap_string + StringUtilities::toString(transition_states[i]) + "," + StringUtilities::toString(transition_times[i]);
         }
-    }
-    simmap_string = simmap_string + "}";
-
-    // save the character history for this branch
-    character_histories[node_index] = simmap_string;
+        return ln_scaling_outside;
+    };
 
-    // recurse towards tips
-    if ( node.isTip() == false )
+    std::vector<const TopologyNode*> stack = std::vector<const TopologyNode*>( 1, &root );
+    while ( stack.empty() == false )
     {
-        const TopologyNode &right = node.getChild(0);
-        const TopologyNode &left = node.getChild(1);
-        success &= recursivelyDrawStochasticCharacterMap(left, character_histories, start_states, end_states, site, use_simmap_default);
-        success &= recursivelyDrawStochasticCharacterMap(right, character_histories, start_states, end_states, site, use_simmap_default);
-    }
-
-    return success;
-}
+        const TopologyNode &n = *stack.back();
+        stack.pop_back();
 
+        const std::vector<const TopologyNode*> &children = pruned_children[n.getIndex()];
+        for (size_t i = 0; i < children.size(); ++i)
+        {
+            const TopologyNode &child = *children[i];
 
-template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(const std::string &n, const std::vector<const DagNode *> &args, RbVector<double> &rv) const
-{
+            // only the nodes older than p can be the parent of a regraft point
+            if ( child.isTip() == true || child.getAge() <= parent_age )
+            {
+                continue;
+            }
 
-    if ( n == "siteLikelihoods" )
+            size_t child_index = child.getIndex();
+            computeTransitionProbabilities( child_index, n.getAge(), child.getAge(), tp );
+
+            double* w_child = &pre_partials[child_index*this->nodeOffset];
+            this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
+            {
+                std::vector<double> u = std::vector<double>(num_chars, 0.0);
+                for (size_t site = first_pattern; site < last_pattern; ++site)
+                {
+                    double ln_scaling_outside = 0.0;
+                    double max = 0.0;
+                    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+                    {
+                        size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                        ln_scaling_outside = computeOutside( n, child, site, offset, u );
+
+                        const double* tp_m = tp[mixture].theMatrix;
+                        for (size_t c2 = 0; c2 < num_chars; ++c2)
+                        {
+                            double tmp = 0.0;
+                            for (size_t c1 = 0; c1 < num_chars; ++c1)
+                            {
+                                tmp += u[c1] * tp_m[c1*num_chars + c2];
+                            }
+                            w_child[offset + c2] = tmp;
+                            max = ( tmp > max ? tmp : max );
+                        }
+                    }
+
+                    // rescale to avoid underflow
+                    ln_pre_scaling[child_index][site] = ln_scaling_outside;
+                    if ( max > 0.0 )
+                    {
+                        for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+                        {
+                            double* w_site_mixture = w_child + mixture*this->mixtureOffset + site*this->siteOffset;
+                            for (size_t c = 0; c < num_chars; ++c)
+                            {
+                                w_site_mixture[c] /= max;
+                            }
+                        }
+                        ln_pre_scaling[child_index][site] -= log(max);
+                    }
+                }
+            });
+
+            stack.push_back( &child );
+        }
+    }
+
+    // finally, we combine the outside partial likelihoods, the inside partial likelihoods of the candidate and the pruned subtree
+    double prob_invariant = getPInv();
+    double one_minus_p_inv = 1.0 - prob_invariant;
+    std::vector<double> f_invariant;
+    if ( prob_invariant > 0.0 )
     {
+        f_invariant = getInvariantSiteFrequencies();
+    }
 
-        bool delete_partial_likelihoods = false;
+    size_t pruned_index = pruned.getIndex();
+    std::vector<TransitionProbabilityMatrix> tp_bottom = tp;
+    std::vector<double> site_ln_likelihoods = std::vector<double>( pattern_block_size, 0.0 );
+    ln_likelihoods = std::vector<double>( candidates.size(), 0.0 );
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        const TopologyNode &b = *candidates[i];
+        const TopologyNode &g = *candidate_parents[i];
+        computeTransitionProbabilities( parent.getIndex(), g.getAge(), parent_age, tp );
+        computeTransitionProbabilities( b.getIndex(), parent_age, b.getAge(), tp_bottom );
 
-        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
-        if ( in_mcmc_mode == false )
+        this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
         {
-            delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
-            in_mcmc_mode = true;
-
-            for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+            std::vector<double> u       = std::vector<double>(num_chars, 0.0);
+            std::vector<double> inside  = std::vector<double>(num_chars, 0.0);
+            std::vector<double> outside = std::vector<double>(num_chars, 0.0);
+            for (size_t site = first_pattern; site < last_pattern; ++site)
             {
-                (*it) = true;
+                double ln_scaling_site = 0.0;
+                double likelihood = 0.0;
+                for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+                {
+                    size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                    ln_scaling_site  = computeOutside( g, b, site, offset, u );
+                    ln_scaling_site += computeInside( b, site, offset, inside );
+                    ln_scaling_site += ln_scaling[pruned_index][site];
+
+                    const double* tp_top_m    = tp[mixture].theMatrix;
+                    const double* tp_bottom_m = tp_bottom[mixture].theMatrix;
+                    const double* p_pruned    = top_partials[pruned_index] + offset;
+                    double tmp_likelihood = 0.0;
+                    for (size_t c1 = 0; c1 < num_chars; ++c1)
+                    {
+                        double tmp_outside = 0.0;
+                        double tmp_inside  = 0.0;
+                        for (size_t c2 = 0; c2 < num_chars; ++c2)
+                        {
+                            tmp_outside += u[c2] * tp_top_m[c2*num_chars + c1];
+                            tmp_inside  += tp_bottom_m[c1*num_chars + c2] * inside[c2];
+                        }
+                        tmp_likelihood += tmp_outside * tmp_inside * p_pruned[c1];
+                    }
+                    likelihood += mixture_probs[mixture] * tmp_likelihood;
+                }
+
+                // the same treatment of the invariant sites as in computeRootLikelihoods
+                double ln_variable_likelihood = log( one_minus_p_inv * likelihood ) - ln_scaling_site;
+                if ( prob_invariant > 0.0 && this->site_invariant[site] == true )
+                {
+                    if ( this->invariant_site_index[site] < num_chars )
+                    {
+                        double ln_invariant_likelihood = log( prob_invariant * f_invariant[ this->invariant_site_index[site] ] );
+                        double max = ( ln_invariant_likelihood > ln_variable_likelihood ? ln_invariant_likelihood : ln_variable_likelihood );
+                        site_ln_likelihoods[site] = max + log( exp(ln_invariant_likelihood - max) + exp(ln_variable_likelihood - max) );
+                    }
+                    else
+                    {
+                        site_ln_likelihoods[site] = 0.0;
+                    }
+                }
+                else
+                {
+                    site_ln_likelihoods[site] = ln_variable_likelihood;
+                }
+                site_ln_likelihoods[site] *= this->pattern_counts[site];
             }
+        });
+
+        for (size_t site = 0; site < pattern_block_size; ++site)
+        {
+            ln_likelihoods[i] += site_ln_likelihoods[site];
         }
+    }
 
-        // make sure the likelihoods are updated
-        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+    // if we are not in MCMC mode, then we need to (temporarily) free memory
+    if ( delete_partial_likelihoods == true )
+    {
+        // free the partial likelihoods
+        delete [] partialLikelihoods;
+        partialLikelihoods = NULL;
+        in_mcmc_mode = false;
+    }
 
-        // get the per site likelihood
-        RbVector<double> tmp = RbVector<double>(num_patterns, 0.0);
-        computeRootLikelihoods( tmp );
+#ifdef RB_MPI
 
-        // if we are not in MCMC mode, then we need to (temporarily) free memory
-        if ( delete_partial_likelihoods == true )
+    // we only need to send message if there is more than one process
+    if ( num_processes > 1 && candidates.size() > 0 )
+    {
+
+        // send the ln likelihoods from the helpers to the master
+        if ( process_active == false )
         {
-            // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
-            in_mcmc_mode = false;
+            MPI_Send(&ln_likelihoods[0], int(ln_likelihoods.size()), MPI_DOUBLE, active_PID, 0, MPI_COMM_WORLD);
         }
 
-        // now match it back to the actual sites
-        if ( this->compressed == true && num_sites > num_patterns )
+        // receive the ln likelihoods from the helpers
+        if ( process_active == true )
         {
-            rv = RbVector<double>(num_sites, 0.0);
+            std::vector<double> tmp = std::vector<double>(ln_likelihoods.size(), 0.0);
+            for (size_t i=active_PID+1; i<active_PID+num_processes; ++i)
+            {
+                MPI_Status status;
+                MPI_Recv(&tmp[0], int(tmp.size()), MPI_DOUBLE, int(i), 0, MPI_COMM_WORLD, &status);
+                for (size_t k = 0; k < ln_likelihoods.size(); ++k)
+                {
+                    ln_likelihoods[k] += tmp[k];
+                }
+            }
+        }
 
-            for (size_t i=0; i<num_sites; ++i)
+        // now send back the combined ln likelihoods to the helpers
+        if ( process_active == true )
+        {
+            for (size_t i=active_PID+1; i<active_PID+num_processes; ++i)
             {
-                size_t pattern_index = site_pattern[i];
-                rv[i] = tmp[pattern_index] / pattern_counts[pattern_index];
+                MPI_Send(&ln_likelihoods[0], int(ln_likelihoods.size()), MPI_DOUBLE, int(i), 0, MPI_COMM_WORLD);
             }
         }
         else
         {
-            rv = tmp;
+            MPI_Status status;
+            MPI_Recv(&ln_likelihoods[0], int(ln_likelihoods.size()), MPI_DOUBLE, active_PID, 0, MPI_COMM_WORLD, &status);
         }
 
     }
-    else if ( n == "siteRates" )
-    {
 
-        bool delete_partial_likelihoods = false;
+#endif
 
-        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
-        if ( in_mcmc_mode == false )
-        {
-            delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
-            in_mcmc_mode = true;
+    return true;
+}
 
-            for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
-            {
-                (*it) = true;
-            }
-        }
 
-        // make sure the likelihoods are updated
-        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+/**
+ * Cache the outside and inside partial likelihoods of the branch above the node (see BranchLengthLikelihoodEvaluator).
+ *
+ * The inside partial likelihoods are the product of the partial likelihoods of the children (or the observed states at a tip).
+ * The outside partial likelihoods are computed along the path from the root to the parent of the node, as in the pre-order
+ * traversal of computeBranchTimeDerivatives, and are multiplied by the partial likelihoods of the siblings.
+ * Thus, preparing a branch costs about as much as recomputing the likelihoods along the path to the root.
+ *
+ * \return False for weighted characters, data at internal nodes or the root.
+ */
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::prepareBranchLengthOptimization(const TopologyNode &node)
+{
 
-        // get the site rates
-        std::vector<double> r;
-        if ( this->rate_variation_across_sites == true )
-        {
-            r = this->site_rates->getValue();
-        }
-        else
+    branch_optimization_node = NULL;
+
+    const Tree &tree = tau->getValue();
+    if ( using_weighted_characters == true || store_internal_nodes == true || node.getIndex() >= num_nodes || &tree.getNode( node.getIndex() ) != &node || node.isRoot() == true )
+    {
+        return false;
+    }
+
+    bool delete_partial_likelihoods = false;
+
+    // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+    if ( in_mcmc_mode == false )
+    {
+        delete_partial_likelihoods = true;
+        partialLikelihoods = new double[2*activeLikelihoodOffset];
+        in_mcmc_mode = true;
+
+        for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
         {
-            r.push_back(1.0);
+            (*it) = true;
         }
+    }
 
-        size_t num_site_rates_withInv = num_site_rates;
-        double prob_invariant = getPInv();
-        if (prob_invariant > 0.0)
+    // make sure the partial likelihoods are up-to-date
+    computeLnProbability();
+
+    bool use_scaling = RbSettings::userSettings().getUseScaling();
+    auto topPartials = [&](size_t i) -> const double*
+    {
+        return this->partialLikelihoods + this->activeLikelihood[i]*this->activeLikelihoodOffset + i*this->nodeOffset;
+    };
+    auto lnScaling = [&](size_t i, size_t site) -> double
+    {
+        return ( use_scaling == true ? this->perNodeSiteLogScalingFactors[this->activeLikelihood[i]][i][site] : 0.0 );
+    };
+
+    // the outside partial likelihoods at the root are the root frequencies
+    std::vector<std::vector<double> > ff;
+    getRootFrequencies( ff );
+    std::vector<double> w = std::vector<double>(this->nodeOffset, 0.0);
+    std::vector<double> ln_w_scaling = std::vector<double>(pattern_block_size, 0.0);
+    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+    {
+        const std::vector<double> &f = ff[mixture % ff.size()];
+        for (size_t site = 0; site < pattern_block_size; ++site)
         {
-            num_site_rates_withInv++;
-            r.insert(r.begin(), 0.0);
+            for (size_t c = 0; c < num_chars; ++c)
+            {
+                w[mixture*this->mixtureOffset + site*this->siteOffset + c] = f[c];
+            }
         }
+    }
 
-        // get the per site rate likelihood
-        MatrixReal tmp = MatrixReal(num_patterns, num_site_rates_withInv, 0.0);
-        computeRootLikelihoodsPerSiteRate( tmp );
+    // the path from the root to the node
+    std::vector<const TopologyNode*> path;
+    for (const TopologyNode *n = &node; n->isRoot() == false; n = &n->getParent())
+    {
+        path.push_back( n );
+    }
+    path.push_back( &tree.getRoot() );
+    std::reverse( path.begin(), path.end() );
 
-        // if we are not in MCMC mode, then we need to (temporarily) free memory
-        if ( delete_partial_likelihoods == true )
+    // the outside partial likelihoods at the top of the branch above child
+    auto computeOutside = [&](const TopologyNode &n, const TopologyNode &child, size_t site, size_t offset, double *u) -> double
+    {
+        double ln_scaling_outside = ln_w_scaling[site];
+        for (size_t c = 0; c < num_chars; ++c)
         {
-            // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
-            in_mcmc_mode = false;
+            u[c] = w[offset + c];
         }
-
-        // now match it back to the actual sites
-        MatrixReal siteRateConditionalProb = MatrixReal(num_sites, num_site_rates_withInv, 0.0);
-        for (size_t i=0; i<num_sites; ++i)
+        for (size_t i = 0; i < n.getNumberOfChildren(); ++i)
         {
-            size_t pattern_index = site_pattern[i];
-            double siteLikelihoods = 0.0;
-
-            for (size_t j=0; j<num_site_rates_withInv; ++j)
-            {
-                siteRateConditionalProb[i][j] = exp(tmp[pattern_index][j] / pattern_counts[pattern_index]);
-                siteLikelihoods += siteRateConditionalProb[i][j];
-            }
-            for (size_t j=0; j<num_site_rates_withInv; ++j)
+            const TopologyNode &sibling = n.getChild( i );
+            if ( &sibling != &child )
             {
-                siteRateConditionalProb[i][j] = siteRateConditionalProb[i][j] / siteLikelihoods;
+                const double* p_sibling = topPartials( sibling.getIndex() ) + offset;
+                for (size_t c = 0; c < num_chars; ++c)
+                {
+                    u[c] *= p_sibling[c];
+                }
+                ln_scaling_outside += lnScaling( sibling.getIndex(), site );
             }
         }
+        return ln_scaling_outside;
+    };
 
-        rv = RbVector<double>(num_sites, 0.0);
-
-        // now either sample the site rates according to the conditional posterior probability of each rate category
-        // or compute them as the posterior mean
-        std::string method = static_cast<const TypedDagNode<std::string>* >( args[0] )->getValue();
+    for (size_t k = 1; k + 1 < path.size(); ++k)
+    {
+        const TopologyNode &n = *path[k-1];
+        const TopologyNode &child = *path[k];
+        size_t child_index = child.getIndex();
+        updateTransitionProbabilities( child_index );
 
-        if (method == "sampling")
+        std::vector<double> w_child = std::vector<double>(this->nodeOffset, 0.0);
+        this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
         {
-            RandomNumberGenerator* rng = GLOBAL_RNG;
-            for (size_t i=0; i<num_sites; ++i)
+            std::vector<double> u = std::vector<double>(num_chars, 0.0);
+            for (size_t site = first_pattern; site < last_pattern; ++site)
             {
-                size_t rateIndex = 0;
-                double u = rng->uniform01();
-
-                while ( true )
+                double ln_scaling_outside = 0.0;
+                double max = 0.0;
+                for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
                 {
-                    u -= siteRateConditionalProb[i][rateIndex];
+                    size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                    ln_scaling_outside = computeOutside( n, child, site, offset, &u[0] );
 
-                    if ( u > 0.0 )
+                    const double* tp_m = this->transition_prob_matrices[mixture].theMatrix;
+                    for (size_t c2 = 0; c2 < num_chars; ++c2)
                     {
-                        ++rateIndex;
+                        double tmp = 0.0;
+                        for (size_t c1 = 0; c1 < num_chars; ++c1)
+                        {
+                            tmp += u[c1] * tp_m[c1*num_chars + c2];
+                        }
+                        w_child[offset + c2] = tmp;
+                        max = ( tmp > max ? tmp : max );
                     }
-                    else
+                }
+
+                // rescale to avoid underflow
+                if ( max > 0.0 )
+                {
+                    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
                     {
-                        break;
+                        double* w_site_mixture = &w_child[mixture*this->mixtureOffset + site*this->siteOffset];
+                        for (size_t c = 0; c < num_chars; ++c)
+                        {
+                            w_site_mixture[c] /= max;
+                        }
                     }
+                    ln_scaling_outside -= log(max);
                 }
 
-                rv[i] = r[rateIndex];
-
+                // the scaling of the parent is not needed anymore once all mixture categories of this site are done
+                ln_w_scaling[site] = ln_scaling_outside;
             }
+        });
+        w = w_child;
+    }
 
-        }
-        else if (method == "weightedAverage")
+    // finally, the outside partial likelihoods of the branch and the inside partial likelihoods of the node
+    const TopologyNode &parent = node.getParent();
+    bool is_tip = node.isTip();
+    size_t data_tip_index = ( is_tip == true ? this->taxon_name_2_tip_index_map[ node.getName() ] : 0 );
+    branch_outside_partials = std::vector<double>(this->nodeOffset, 0.0);
+    branch_inside_partials  = std::vector<double>(this->nodeOffset, 1.0);
+    branch_ln_scaling       = std::vector<double>(pattern_block_size, 0.0);
+    this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
+    {
+        for (size_t site = first_pattern; site < last_pattern; ++site)
         {
-            for (size_t i=0; i<num_sites; ++i)
+            double ln_scaling_site = 0.0;
+            for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
             {
-                for (size_t rateIndex=0; rateIndex < num_site_rates_withInv; ++rateIndex)
+                size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+                ln_scaling_site = computeOutside( parent, node, site, offset, &branch_outside_partials[offset] );
+
+                double* inside = &branch_inside_partials[offset];
+                if ( is_tip == true )
                 {
-                    rv[i] += r[rateIndex] * siteRateConditionalProb[i][rateIndex];
+                    for (size_t c = 0; c < num_chars; ++c)
+                    {
+                        if ( this->gap_matrix[data_tip_index][site] == true )
+                        {
+                            inside[c] = 1.0;
+                        }
+                        else if ( using_ambiguous_characters == true )
+                        {
+                            inside[c] = ( this->ambiguous_char_matrix[data_tip_index][site].isSet(c) == true ? 1.0 : 0.0 );
+                        }
+                        else
+                        {
+                            inside[c] = ( this->char_matrix[data_tip_index][site] == c ? 1.0 : 0.0 );
+                        }
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
+                    {
+                        size_t child_index = node.getChild( i ).getIndex();
+                        const double* p_child = topPartials( child_index ) + offset;
+                        for (size_t c = 0; c < num_chars; ++c)
+                        {
+                            inside[c] *= p_child[c];
+                        }
+                    }
+                }
+            }
+            if ( is_tip == false )
+            {
+                for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
+                {
+                    ln_scaling_site += lnScaling( node.getChild( i ).getIndex(), site );
                 }
             }
+            branch_ln_scaling[site] = ln_scaling_site;
         }
+    });
 
+    // if we are not in MCMC mode, then we need to (temporarily) free memory
+    if ( delete_partial_likelihoods == true )
+    {
+        // free the partial likelihoods
+        delete [] partialLikelihoods;
+        partialLikelihoods = NULL;
+        in_mcmc_mode = false;
+    }
+
+    branch_optimization_node = &node;
+
+    return true;
+}
+
+
+/**
+ * Apply the function f to blocks [first,last) of the patterns of this process.
+ * The patterns are independent given the transition probabilities, so the blocks can be computed by different threads.
+ * Together with the MPI split of the patterns (see compress), an MPI rank can thus use all the cores of a machine
+ * for a single likelihood, without holding a copy of the model and data per core.
+ * Small blocks are computed by the calling thread alone because the work would not outweigh the synchronization.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeForPatternBlocks(const std::function<void(size_t, size_t)> &f) const
+{
+
+    size_t n_threads = this->getNumberOfThreads();
+
+    // roughly the number of floating point operations that a thread should get at least
+    size_t min_work_per_block = 32768;
+    size_t work_per_pattern   = num_site_mixtures * num_chars * num_chars;
+    size_t min_block_size     = std::max( size_t(1), min_work_per_block / std::max( size_t(1), work_per_pattern ) );
+
+    if ( n_threads <= 1 || pattern_block_size < 2 * min_block_size )
+    {
+        f(0, pattern_block_size);
     }
     else
     {
-        throw RbException("The PhyloCTMC process does not have a member method called '" + n + "'.");
+        // one block per thread, so that we never use more threads than we are allowed to
+        size_t block_size = std::max( min_block_size, (pattern_block_size + n_threads - 1) / n_threads );
+        parallelFor(0, pattern_block_size, f, block_size);
     }
 
 }
 
 
+/**
+ * Compute the derivatives of the log-likelihood with respect to the rates of the site rate categories.
+ * The derivatives with respect to the parameters of the rate distribution (e.g., the shape of a discretized gamma)
+ * follow from the chain rule.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(const std::string &n, const std::vector<const DagNode *> &args, MatrixReal &rv) const
+std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeSiteRateGradient( void )
 {
 
-    if ( n == "siteRateLikelihoods" )
-    {
+    std::vector<std::vector<double> > d;
+    computeBranchTimeDerivatives( d );
 
-        bool delete_partial_likelihoods = false;
+    const std::vector<TopologyNode*> &nodes = tau->getValue().getNodes();
 
-        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
-        if ( in_mcmc_mode == false )
+    std::vector<double> gradient = std::vector<double>(num_site_rates, 0.0);
+    for (size_t node_index = 0; node_index < num_nodes; ++node_index)
+    {
+        if ( nodes[node_index]->isRoot() == true )
         {
-            delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
-            in_mcmc_mode = true;
+            continue;
+        }
+
+        double t = getBranchClockRate( node_index ) * nodes[node_index]->getBranchLength();
+        for (size_t j = 0; j < num_site_rates; ++j)
+        {
+            gradient[j] += t * d[node_index][j];
+        }
+    }
+
+    return gradient;
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalNodeLikelihood( size_t node_index, size_t parentnode_index )
+{
+
+    // compute the transition probability matrix
+    this->updateTransitionProbabilities( node_index );
+
+    // get the pointers to the partial likelihoods and the marginal likelihoods
+    const double*   p_node                  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    double*         p_node_marginal         = this->marginalLikelihoods + node_index*this->nodeOffset;
+    const double*   p_parent_node_marginal  = this->marginalLikelihoods + parentnode_index*this->nodeOffset;
+
+    // get pointers the likelihood for both subtrees
+    const double*   p_mixture                   = p_node;
+    double*         p_mixture_marginal          = p_node_marginal;
+    const double*   p_parent_mixture_marginal   = p_parent_node_marginal;
+
+    // iterate over all mixture categories
+    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    {
+        // the transition probability matrix for this mixture category
+        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+
+        // get pointers to the likelihood for this mixture category
+        const double*   p_site_mixture                  = p_mixture;
+        double*         p_site_mixture_marginal         = p_mixture_marginal;
+        const double*   p_parent_site_mixture_marginal  = p_parent_mixture_marginal;
+        // iterate over all sites
+        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        {
+            // get the pointers to the likelihoods for this site and mixture category
+            const double*   p_site_j                    = p_site_mixture;
+            double*         p_site_marginal_j           = p_site_mixture_marginal;
+            // iterate over all end states
+            for (size_t j=0; j<num_chars; ++j)
+            {
+                const double*   p_parent_site_marginal_k    = p_parent_site_mixture_marginal;
+                *p_site_marginal_j = 0.0;
+
+                // iterator over all start states
+                for (size_t k=0; k<num_chars; ++k)
+                {
+                    // transition probability for k->j
+                    const double tp_kj = *p_parent_site_marginal_k * tp_begin[ k * num_chars + j ];
+
+                    // add the probability of starting from this state
+                    *p_site_marginal_j += *p_site_j * tp_kj;
+
+                    // next parent state
+                    ++p_parent_site_marginal_k;
+                }
+
+                // increment pointers
+                ++p_site_j; ++p_site_marginal_j;
+            }
+
+            // increment the pointers to the next site
+            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset; p_parent_site_mixture_marginal+=this->siteOffset;
+
+        } // end-for over all sites (=patterns)
+
+        // increment the pointers to the next mixture category
+        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset; p_parent_mixture_marginal+=this->mixtureOffset;
+
+    } // end-for over all mixtures (=rate categories)
+
+}
+
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeMarginalRootLikelihood( void )
+{
+    // get the root node
+    const TopologyNode &root = tau->getValue().getRoot();
+
+    // get root frequencies
+    std::vector<std::vector<double> >   ff;
+    getRootFrequencies(ff);
+
+    // get the index of the root node
+    size_t node_index = root.getIndex();
+
+    // get the pointers to the partial likelihoods and the marginal likelihoods
+    const double*   p_node           = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    double*         p_node_marginal  = this->marginalLikelihoods + node_index*this->nodeOffset;
+
+    // get pointers the likelihood for both subtrees
+    const double*   p_mixture           = p_node;
+    double*         p_mixture_marginal  = p_node_marginal;
+
+    // iterate over all mixture categories
+    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    {
+        // get root frequencies
+        const std::vector<double>&          f           = ff[mixture % ff.size()];
+        std::vector<double>::const_iterator f_end       = f.end();
+        std::vector<double>::const_iterator f_begin     = f.begin();
+
+        // get pointers to the likelihood for this mixture category
+        const double*   p_site_mixture          = p_mixture;
+        double*         p_site_mixture_marginal = p_mixture_marginal;
+        // iterate over all sites
+        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        {
+            // get the pointer to the stationary frequencies
+            std::vector<double>::const_iterator f_j             = f_begin;
+            // get the pointers to the likelihoods for this site and mixture category
+            const double*   p_site_j            = p_site_mixture;
+            double*         p_site_marginal_j   = p_site_mixture_marginal;
+            // iterate over all starting states
+            for (; f_j != f_end; ++f_j)
+            {
+                // add the probability of starting from this state
+                *p_site_marginal_j = *p_site_j * *f_j;
+
+                // increment pointers
+                ++p_site_j; ++p_site_marginal_j;
+            }
+
+            // increment the pointers to the next site
+            p_site_mixture+=this->siteOffset; p_site_mixture_marginal+=this->siteOffset;
+
+        } // end-for over all sites (=patterns)
+
+        // increment the pointers to the next mixture category
+        p_mixture+=this->mixtureOffset; p_mixture_marginal+=this->mixtureOffset;
+
+    } // end-for over all mixtures (=rate categories)
+
+}
+
+
+/**
+ * Draw a vector of ancestral states from the marginal distribution (non-conditional of the other ancestral states).
+ * Here we assume that the marginal likelihoods have been updated.
+ */
+template<class charType>
+std::vector<charType> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawAncestralStatesForNode(const TopologyNode &node)
+{
+
+    size_t node_index = node.getIndex();
+
+    // get the marginal likelihoods
+    std::vector< std::vector<double> >* marginals = sumMarginalLikelihoods(node_index);
+
+    RandomNumberGenerator* rng = GLOBAL_RNG;
+    std::vector< charType > ancestralSeq = std::vector<charType>();
+
+    for ( size_t i = 0; i < num_sites; ++i )
+    {
+		size_t pattern = i;
+		// if the matrix is compressed use the pattern for this site
+		if ( compressed == true )
+        {
+            pattern = site_pattern[i];
+        }
+
+        // create the character
+        charType c = charType( num_chars );
+        c.setToFirstState();
+
+        // sum the likelihoods for each character state
+        const std::vector<double> siteMarginals = (*marginals)[pattern];
+        double sumMarginals = 0.0;
+        for (int j = 0; j < siteMarginals.size(); j++)
+        {
+            sumMarginals += siteMarginals[j];
+        }
+
+        double u = rng->uniform01();
+        if (sumMarginals == 0.0)
+        {
+
+            // randomly draw state if all states have 0 probability
+            c.setStateByIndex((size_t)(u*c.getNumberOfStates()));
+
+        }
+        else
+        {
+
+            // the marginals don't add up to 1, so rescale u
+            u *= sumMarginals;
+
+            // draw the character state
+            size_t stateIndex = 0;
+            while ( true )
+            {
+
+                u -= siteMarginals[stateIndex];
+
+                if ( u > 0.0 )
+                {
+
+                    if (c.getStateIndex() + 1 >= c.getNumberOfStates())
+                    {
+                        stateIndex = 0;
+                        c.setToFirstState();
+                    }
+                    else
+                    {
+                        c++;
+                        stateIndex++;
+                    }
+
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        // add the character to the sequence
+        ancestralSeq.push_back( c );
+    }
+
+    // we need to free the vector
+    delete marginals;
+
+    return ancestralSeq;
+}
+
+
+/**
+ * Draw a vector of ancestral states from the joint-conditional distribution of states.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates)
+{
+
+	// if we already have ancestral states, don't make new ones
+    
+    // MJL 181028: Disabling this flag to allow multiple monitors to work for same dnPhyloCTMC (e.g. ancestral states + stochastic mapping)
+//	if ( has_ancestral_states == true )
+//    {
+//		return;
+//    }
+    
+    RandomNumberGenerator* rng = GLOBAL_RNG;
+
+    // get working variables
+    std::vector<double> siteProbVector = getMixtureProbs();
+
+    const TopologyNode &root = tau->getValue().getRoot();
+    size_t node_index = root.getIndex();
+
+    // get the pointers to the partial likelihoods and the marginal likelihoods
+    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+
+    // get pointers the likelihood for both subtrees
+    const double*   p_site           = p_node;
+
+    // sample root states
+    std::vector<double> p( this->num_site_mixtures*this->num_chars, 0.0);
+
+    // clear the container for sampling the site-rates
+    sampled_site_mixtures.resize(this->num_sites);
+    
+    for (size_t i = 0; i < this->num_sites; ++i)
+//    for (size_t i = pattern_block_start; i < this->pattern_block_end; ++i)
+    {
+
+        // create the character
+        charType c = charType( template_state );
+
+        // sum to sample
+        double sum = 0.0;
+
+        // if the matrix is compressed use the pattern for this site
+        size_t pattern = i - pattern_block_start;
+        if ( compressed == true )
+        {
+            pattern = site_pattern[i - pattern_block_start];
+        }
+
+        // get ptr to first mixture cat for site
+        p_site          = p_node  + pattern * this->siteOffset;
+
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
+
+            // get pointers to the likelihood for this mixture category
+            const double* p_site_mixture_j       = p_site;
+
+            // iterate over all starting states
+            for (size_t state = 0; state < this->num_chars; ++state)
+            {
+                size_t k = this->num_chars*mixture + state;
+                p[k] = *p_site_mixture_j * siteProbVector[mixture];
+                sum += p[k];
+
+                // increment the pointers to the next state for (site,rate)
+                p_site_mixture_j++;
+            }
+
+            // increment the pointers to the next mixture category for given site
+            p_site       += this->mixtureOffset;
+
+        } // end-for over all mixtures (=rate categories)
+
+        // sample char from p
+        bool stop = false;
+        double u = rng->uniform01() * sum;
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; mixture++)
+        {
+            c.setToFirstState();
+            for (size_t state = 0; state < this->num_chars; state++)
+            {
+                size_t k = this->num_chars * mixture + state;
+                u -= p[k];
+                if (u < 0.0)
+                {
+                    startStates[root.getIndex()][i] = c;
+                    sampled_site_mixtures[i] = mixture;
+                    stop = true;
+                    break;
+                }
+                if (c.getStateIndex() + 1 >= c.getNumberOfStates())
+                {
+                    c.setToFirstState();
+                }
+                else
+                {
+                    c++;
+                }
+            }
+            if (stop) break;
+        }
+
+        endStates[node_index][i] = startStates[node_index][i];
+    }
+
+    // recurse
+    std::vector<TopologyNode*> children = root.getChildren();
+    for (size_t i = 0; i < children.size(); i++)
+    {
+        // daughters identically inherit ancestral state
+        startStates[ children[i]->getIndex() ] = endStates[ root.getIndex() ];
+
+        // recurse towards tips
+        if ( children[i]->isTip() == false )
+        {
+            recursivelyDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampled_site_mixtures);
+        }
+        else
+        {
+            tipDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampled_site_mixtures);
+        }
+
+    }
+
+    // flag the ancestral states as sampled
+    has_ancestral_states = true;
+
+}
+
+
+/**
+ * Draw a vector of ancestral states from the joint-conditional distribution of states.
+ * In contrast to drawJointConditionalAncestralStates(), the states of all sites are stored as state indices
+ * in two flat matrices with the layout [node_index * num_sites + site], so that no character objects need to be created.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawJointConditionalAncestralStateIndices(std::vector<size_t>& start_states, std::vector<size_t>& end_states)
+{
+
+    start_states.resize( this->num_nodes * this->num_sites );
+    end_states.resize( this->num_nodes * this->num_sites );
+
+    // the compact tip data only contain the patterns of this process
+    // so we need to use the character states if the patterns are split among processes
+    if ( this->pattern_block_size != this->num_patterns )
+    {
+        std::vector<std::vector<charType> > start_chars(this->num_nodes, std::vector<charType>(this->num_sites, template_state));
+        std::vector<std::vector<charType> > end_chars(this->num_nodes, std::vector<charType>(this->num_sites, template_state));
+        this->drawJointConditionalAncestralStates( start_chars, end_chars );
+
+        for (size_t n = 0; n < this->num_nodes; ++n)
+        {
+            for (size_t i = 0; i < this->num_sites; ++i)
+            {
+                start_states[n*this->num_sites + i] = start_chars[n][i].getStateIndex();
+                end_states[n*this->num_sites + i]   = end_chars[n][i].getStateIndex();
+            }
+        }
+
+        return;
+    }
+
+    RandomNumberGenerator* rng = GLOBAL_RNG;
+
+    // get working variables
+    std::vector<double> site_mixture_probs = getMixtureProbs();
+
+    const TopologyNode &root = tau->getValue().getRoot();
+    size_t root_index = root.getIndex();
+    size_t root_offset = root_index * this->num_sites;
+
+    // get the pointers to the partial likelihoods of the root
+    const double* p_node = this->partialLikelihoods + this->activeLikelihood[root_index]*this->activeLikelihoodOffset + root_index*this->nodeOffset;
+
+    // clear the container for sampling the site-rates
+    sampled_site_mixtures.resize(this->num_sites);
+
+    // sample the root states and the mixture categories jointly
+    std::vector<double> p( this->num_site_mixtures*this->num_chars, 0.0);
+    for (size_t i = 0; i < this->num_sites; ++i)
+    {
+
+        // if the matrix is compressed use the pattern for this site
+        size_t pattern = ( compressed == true ? site_pattern[i] : i );
+        const double* p_site = p_node + pattern * this->siteOffset;
+
+        double sum = 0.0;
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+        {
+            const double* p_site_mixture = p_site + mixture * this->mixtureOffset;
+            for (size_t state = 0; state < this->num_chars; ++state)
+            {
+                size_t k = this->num_chars*mixture + state;
+                p[k] = p_site_mixture[state] * site_mixture_probs[mixture];
+                sum += p[k];
+            }
+        }
+
+        double u = rng->uniform01() * sum;
+        size_t k = 0;
+        for (; k < p.size()-1; ++k)
+        {
+            u -= p[k];
+            if (u < 0.0)
+            {
+                break;
+            }
+        }
+
+        sampled_site_mixtures[i]       = k / this->num_chars;
+        start_states[root_offset + i]  = k % this->num_chars;
+        end_states[root_offset + i]    = k % this->num_chars;
+    }
+
+    // recurse
+    const std::vector<TopologyNode*> &children = root.getChildren();
+    for (size_t i = 0; i < children.size(); i++)
+    {
+        // daughters identically inherit ancestral state
+        size_t child_offset = children[i]->getIndex() * this->num_sites;
+        std::copy( end_states.begin() + root_offset, end_states.begin() + root_offset + this->num_sites, start_states.begin() + child_offset );
+
+        recursivelyDrawJointConditionalAncestralStateIndices( *children[i], start_states, end_states );
+    }
+
+    // flag the ancestral states as sampled
+    has_ancestral_states = true;
+
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawStochasticCharacterMap(std::vector<std::string>& character_histories, size_t site, bool use_simmap_default)
+{
+
+    bool success = false;
+    size_t max_draws = 10;
+    size_t n_draws = 0;
+
+    while (!success && n_draws != max_draws) {
+        // first draw joint ancestral states
+        std::vector<std::vector<charType> > start_states(this->num_nodes, std::vector<charType>(this->num_sites, template_state));
+        std::vector<std::vector<charType> > end_states(this->num_nodes, std::vector<charType>(this->num_sites, template_state));
+        this->drawJointConditionalAncestralStates( start_states, end_states );
+
+        // save the character history for the root
+        const TopologyNode &root = this->tau->getValue().getRoot();
+        size_t root_index = root.getIndex();
+        std::string simmap_string = "{" + end_states[root_index][site].getStringValue() + "," + StringUtilities::toString( root.getBranchLength() ) + "}";
+        character_histories[root_index] = simmap_string;
+
+        // the mixture components are in a vector that is a flattened version of a
+        // matrix with rate components in columns and matrix components in rows.
+        // the matrix is in row-major order.
+        // here, we compute the row and column indices from the vector index.
+
+        size_t mixture_component_index = this->sampled_site_mixtures[site];
+
+        // get the number of rate categories
+        size_t num_site_rates = 1;
+        if (this->site_rates != NULL)
+        {
+        	num_site_rates = this->site_rates->getValue().size();
+        }
+
+        // determine the rate (column index)
+        sampled_site_rate_component = 0;
+        if (this->site_rates != NULL)
+        {
+        	sampled_site_rate_component = mixture_component_index % num_site_rates;
+        }
+
+        // determine the matrix (row index)
+        sampled_site_matrix_component = 0;
+        if (this->site_matrix_probs != NULL)
+        {
+        	sampled_site_matrix_component = (mixture_component_index - sampled_site_rate_component) / num_site_rates;
+        }
+
+        // recurse towards tips
+        const TopologyNode &right = root.getChild(0);
+        const TopologyNode &left = root.getChild(1);
+        success = recursivelyDrawStochasticCharacterMap(left,  character_histories, start_states, end_states, site, use_simmap_default);
+        success &= recursivelyDrawStochasticCharacterMap(right, character_histories, start_states, end_states, site, use_simmap_default);
+
+        if (n_draws != 0) {
+            std::cout << "Warning: numerical instability in P(t)=exp(Qt) caused stochastic mapping to fail (attempt: " << n_draws << "/" << max_draws << ")\n";
+        }
+        n_draws++;
+    }
+
+    if (n_draws == max_draws) {
+        throw RbException("Stochastic mapping failed due to numerical instability.");
+    }
+
+}
+
+/**
+ * Draw the character histories of several sites along all branches.
+ * The ancestral states of all sites are drawn only once and stored as state indices,
+ * and the histories are written into a flat buffer that can be reused between draws.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::drawStochasticCharacterMaps(const std::vector<size_t>& sites, StochasticCharacterMapBuffer& maps)
+{
+
+    // first draw joint ancestral states
+    std::vector<size_t> start_states;
+    std::vector<size_t> end_states;
+    this->drawJointConditionalAncestralStateIndices( start_states, end_states );
+
+    const std::vector<TopologyNode*> &nodes = this->tau->getValue().getNodes();
+    maps.reset( this->num_nodes, sites );
+
+    // get the number of rate categories
+    size_t num_rates = 1;
+    if (this->site_rates != NULL)
+    {
+        num_rates = this->site_rates->getValue().size();
+    }
+
+    RateMatrix_JC jc(this->num_chars);
+    std::vector<size_t> transition_states;
+    std::vector<double> transition_times;
+    size_t max_draws = 10;
+
+    for (size_t s = 0; s < sites.size(); ++s)
+    {
+        size_t site = sites[s];
+        if ( site >= this->num_sites )
+        {
+            throw RbException("Cannot draw a stochastic character map for site " + StringUtilities::toString(site+1) + " because there are only " + StringUtilities::toString(this->num_sites) + " sites.");
+        }
+
+        // the mixture components are in a vector that is a flattened version of a
+        // matrix with rate components in columns and matrix components in rows.
+        size_t mixture_component_index = this->sampled_site_mixtures[site];
+        size_t rate_component   = ( this->site_rates        != NULL ? mixture_component_index % num_rates : 0 );
+        size_t matrix_component = ( this->site_matrix_probs != NULL ? (mixture_component_index - rate_component) / num_rates : 0 );
+
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            const TopologyNode &node = *nodes[i];
+            size_t node_index  = node.getIndex();
+            size_t start_state = start_states[node_index * this->num_sites + site];
+            size_t end_state   = end_states[node_index * this->num_sites + site];
+
+            // the root branch has no history, only the label of its state
+            if ( node.isRoot() == true )
+            {
+                charType c = charType( template_state );
+                c.setStateByIndex( end_state );
+                maps.addRootHistory( s, node_index, end_state, c.getStringValue(), node.getBranchLength() );
+                continue;
+            }
+
+            const RateGenerator *rate_matrix = getStochasticMappingRateGenerator( node_index, matrix_component, &jc );
+            double clock_rate = getStochasticMappingClockRate( node_index, rate_component );
+
+            double start_age;
+            double end_age;
+            if (RbMath::isFinite( node.getAge() ) == true)
+            {
+                start_age = node.getParent().getAge();
+                end_age = node.getAge();
+            }
+            else
+            {
+                double branch_length = node.getBranchLength();
+                if (branch_length < 0.0)
+                {
+                    branch_length = 1.0;
+                }
+                start_age = branch_length;
+                end_age = 0.0;
+            }
+
+            // the end states are fixed, so we only need to repeat the branch if it fails numerically
+            bool success = false;
+            for (size_t n_draws = 0; success == false && n_draws < max_draws; ++n_draws)
+            {
+                transition_states.assign( 1, start_state );
+                transition_states.push_back( end_state );
+                transition_times.clear();
+                success = const_cast<RateGenerator*>(rate_matrix)->simulateStochasticMapping(start_age, end_age, clock_rate, transition_states, transition_times);
+            }
+
+            if ( success == false )
+            {
+                throw RbException("Stochastic mapping failed due to numerical instability.");
+            }
+
+            maps.addBranchHistory( s, node_index, transition_states, transition_times );
+        }
+
+    }
+
+}
+
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::hasSiteRateMixture()
+{
+	bool ret = this->num_site_rates > 1;
+	return ret;
+}
+
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::hasSiteMatrixMixture()
+{
+	bool ret = false;
+
+	if ( this->site_matrix_probs != NULL ) {
+		ret = this->site_matrix_probs->getValue().size() > 1;
+	}
+
+	return ret;
+}
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getSampledMixtureComponents(size_t &site_index, size_t &rate_component, size_t &matrix_component )
+{
+
+	// get the mixture component (in vector form)
+	size_t mixture_component_index = this->sampled_site_mixtures[site_index];
+
+	rate_component = 0;
+    if (this->site_rates != NULL)
+    {
+    	rate_component = mixture_component_index % num_site_rates;
+    }
+
+    // determine the matrix (row index)
+    matrix_component = 0;
+    if (this->site_matrix_probs != NULL)
+    {
+    	matrix_component = (mixture_component_index - rate_component) / num_site_rates;
+    }
+
+
+}
+
+
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyDrawStochasticCharacterMap(const TopologyNode &node, std::vector<std::string>& character_histories, std::vector<std::vector<charType> >& start_states, std::vector<std::vector<charType> >& end_states, size_t site, bool use_simmap_default)
+{
+
+    bool success = false;
+
+    // get the start and end states
+    size_t node_index = node.getIndex();
+    size_t start_state = start_states[node_index][site].getStateIndex();
+    size_t end_state = start_state;
+
+    // NOTE: ambiguous tip states are sampled along with internal node states
+    end_state = end_states[node_index][site].getStateIndex();
+
+    // set up vectors to hold the character transition events
+    std::vector<size_t> transition_states;
+    std::vector<double> transition_times;
+    transition_states.push_back(start_state);
+
+    // get the rate matrix for this branch (or site if using a mixture of matrices over sites)
+    RateMatrix_JC jc(this->num_chars);
+    const RateGenerator *rate_matrix = getStochasticMappingRateGenerator( node_index, this->sampled_site_matrix_component, &jc );
+
+    // get the clock rate for the branch (multiplied by the rate for the site)
+    double clock_rate = getStochasticMappingClockRate( node_index, this->sampled_site_rate_component );
+
+    // now sample a character history for the branch leading to this node
+    double start_age;
+    double end_age;
+    if (RbMath::isFinite( node.getAge() ) == true)
+    {
+        start_age = node.getParent().getAge();
+        end_age = node.getAge();
+    }
+    else
+    {
+        double branch_length = node.getBranchLength();
+        if (branch_length < 0.0)
+        {
+            branch_length = 1.0;
+        }
+        start_age = branch_length;
+        end_age = 0.0;
+    }
+
+
+    // simulate stochastic map
+    transition_states.push_back(end_state);
+    success = const_cast<RateGenerator*>(rate_matrix)->simulateStochasticMapping(start_age, end_age, clock_rate, transition_states, transition_times);
+
+    // make SIMMAP string
+    std::string simmap_string = "{";
+
+    if (use_simmap_default == true)
+    {
+        for (size_t i = transition_times.size(); i > 0; i--)
+        {
+            simmap_string = simmap_string + StringUtilities::toString(transition_states[i - 1]) + "," + StringUtilities::toString(transition_times[i - 1]);
+            if (i != 1)
+            {
+                simmap_string = simmap_string + ":";
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < transition_times.size(); i++)
+        {
+            if (i != 0)
+            {
+                simmap_string = simmap_string + ":";
+            }
+            simmap_string = simmap_string + StringUtilities::toString(transition_states[i]) + "," + StringUtilities::toString(transition_times[i]);
+        }
+    }
+    simmap_string = simmap_string + "}";
+
+    // save the character history for this branch
+    character_histories[node_index] = simmap_string;
+
+    // recurse towards tips
+    if ( node.isTip() == false )
+    {
+        const TopologyNode &right = node.getChild(0);
+        const TopologyNode &left = node.getChild(1);
+        success &= recursivelyDrawStochasticCharacterMap(left, character_histories, start_states, end_states, site, use_simmap_default);
+        success &= recursivelyDrawStochasticCharacterMap(right, character_histories, start_states, end_states, site, use_simmap_default);
+    }
+
+    return success;
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(const std::string &n, const std::vector<const DagNode *> &args, RbVector<double> &rv) const
+{
+
+    if ( n == "siteLikelihoods" )
+    {
+
+        bool delete_partial_likelihoods = false;
+
+        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+        if ( in_mcmc_mode == false )
+        {
+            delete_partial_likelihoods = true;
+            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            in_mcmc_mode = true;
+
+            for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+            {
+                (*it) = true;
+            }
+        }
+
+        // make sure the likelihoods are updated
+        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+
+        // get the per site likelihood
+        RbVector<double> tmp = RbVector<double>(num_patterns, 0.0);
+        computeRootLikelihoods( tmp );
+
+        // if we are not in MCMC mode, then we need to (temporarily) free memory
+        if ( delete_partial_likelihoods == true )
+        {
+            // free the partial likelihoods
+            delete [] partialLikelihoods;
+            partialLikelihoods = NULL;
+            in_mcmc_mode = false;
+        }
+
+        // now match it back to the actual sites
+        if ( this->compressed == true && num_sites > num_patterns )
+        {
+            rv = RbVector<double>(num_sites, 0.0);
+
+            for (size_t i=0; i<num_sites; ++i)
+            {
+                size_t pattern_index = site_pattern[i];
+                rv[i] = tmp[pattern_index] / pattern_counts[pattern_index];
+            }
+        }
+        else
+        {
+            rv = tmp;
+        }
+
+    }
+    else if ( n == "siteRates" )
+    {
+
+        bool delete_partial_likelihoods = false;
+
+        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+        if ( in_mcmc_mode == false )
+        {
+            delete_partial_likelihoods = true;
+            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            in_mcmc_mode = true;
+
+            for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+            {
+                (*it) = true;
+            }
+        }
+
+        // make sure the likelihoods are updated
+        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+
+        // get the site rates
+        std::vector<double> r;
+        if ( this->rate_variation_across_sites == true )
+        {
+            r = this->site_rates->getValue();
+        }
+        else
+        {
+            r.push_back(1.0);
+        }
+
+        size_t num_site_rates_withInv = num_site_rates;
+        double prob_invariant = getPInv();
+        if (prob_invariant > 0.0)
+        {
+            num_site_rates_withInv++;
+            r.insert(r.begin(), 0.0);
+        }
+
+        // get the per site rate likelihood
+        MatrixReal tmp = MatrixReal(num_patterns, num_site_rates_withInv, 0.0);
+        computeRootLikelihoodsPerSiteRate( tmp );
+
+        // if we are not in MCMC mode, then we need to (temporarily) free memory
+        if ( delete_partial_likelihoods == true )
+        {
+            // free the partial likelihoods
+            delete [] partialLikelihoods;
+            partialLikelihoods = NULL;
+            in_mcmc_mode = false;
+        }
+
+        // now match it back to the actual sites
+        MatrixReal siteRateConditionalProb = MatrixReal(num_sites, num_site_rates_withInv, 0.0);
+        for (size_t i=0; i<num_sites; ++i)
+        {
+            size_t pattern_index = site_pattern[i];
+            double siteLikelihoods = 0.0;
+
+            for (size_t j=0; j<num_site_rates_withInv; ++j)
+            {
+                siteRateConditionalProb[i][j] = exp(tmp[pattern_index][j] / pattern_counts[pattern_index]);
+                siteLikelihoods += siteRateConditionalProb[i][j];
+            }
+            for (size_t j=0; j<num_site_rates_withInv; ++j)
+            {
+                siteRateConditionalProb[i][j] = siteRateConditionalProb[i][j] / siteLikelihoods;
+            }
+        }
+
+        rv = RbVector<double>(num_sites, 0.0);
+
+        // now either sample the site rates according to the conditional posterior probability of each rate category
+        // or compute them as the posterior mean
+        std::string method = static_cast<const TypedDagNode<std::string>* >( args[0] )->getValue();
+
+        if (method == "sampling")
+        {
+            RandomNumberGenerator* rng = GLOBAL_RNG;
+            for (size_t i=0; i<num_sites; ++i)
+            {
+                size_t rateIndex = 0;
+                double u = rng->uniform01();
+
+                while ( true )
+                {
+                    u -= siteRateConditionalProb[i][rateIndex];
+
+                    if ( u > 0.0 )
+                    {
+                        ++rateIndex;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+
+                rv[i] = r[rateIndex];
+
+            }
+
+        }
+        else if (method == "weightedAverage")
+        {
+            for (size_t i=0; i<num_sites; ++i)
+            {
+                for (size_t rateIndex=0; rateIndex < num_site_rates_withInv; ++rateIndex)
+                {
+                    rv[i] += r[rateIndex] * siteRateConditionalProb[i][rateIndex];
+                }
+            }
+        }
+
+    }
+    else
+    {
+        throw RbException("The PhyloCTMC process does not have a member method called '" + n + "'.");
+    }
+
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::executeMethod(const std::string &n, const std::vector<const DagNode *> &args, MatrixReal &rv) const
+{
+
+    if ( n == "siteRateLikelihoods" )
+    {
+
+        bool delete_partial_likelihoods = false;
+
+        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+        if ( in_mcmc_mode == false )
+        {
+            delete_partial_likelihoods = true;
+            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            in_mcmc_mode = true;
+
+            for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+            {
+                (*it) = true;
+            }
+        }
+
+        // make sure the likelihoods are updated
+        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+
+        // get the per site rate likelihood
+        size_t num_site_rates_withInv = num_site_rates;
+        double prob_invariant = getPInv();
+        if (prob_invariant > 0.0)
+        {
+            num_site_rates_withInv++;
+        }
+
+        // get the per site rate likelihood
+        MatrixReal tmp = MatrixReal(num_patterns, num_site_rates_withInv, 0.0);
+        computeRootLikelihoodsPerSiteRate( tmp );
+
+        // if we are not in MCMC mode, then we need to (temporarily) free memory
+        if ( delete_partial_likelihoods == true )
+        {
+            // free the partial likelihoods
+            delete [] partialLikelihoods;
+            partialLikelihoods = NULL;
+            in_mcmc_mode = false;
+        }
+
+        // now match it back to the actual sites
+        rv = MatrixReal(num_sites, num_site_rates_withInv, 0.0);
+        for (size_t i=0; i<num_sites; ++i)
+        {
+            size_t pattern_index = site_pattern[i];
+            for (size_t j=0; j<num_site_rates_withInv; ++j)
+            {
+                rv[i][j] = tmp[pattern_index][j] / pattern_counts[pattern_index];
+            }
+        }
+
+    }
+    else if ( n == "siteMixtureLikelihoods" )
+    {
+
+        bool delete_partial_likelihoods = false;
+
+        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
+        if ( in_mcmc_mode == false )
+        {
+            delete_partial_likelihoods = true;
+            partialLikelihoods = new double[2*activeLikelihoodOffset];
+            in_mcmc_mode = true;
 
             for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
             {
-                (*it) = true;
+                (*it) = true;
+            }
+        }
+
+        // make sure the likelihoods are updated
+        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+
+        // get the per site rate likelihood
+        size_t num_site_mixture_withInv = num_site_mixtures;
+        double prob_invariant = getPInv();
+        if (prob_invariant > 0.0)
+        {
+            num_site_mixture_withInv += size_t(num_site_mixtures/num_site_rates);
+        }
+
+        // get the per site rate likelihood
+        MatrixReal tmp = MatrixReal(num_patterns, num_site_mixture_withInv, 0.0);
+        computeRootLikelihoodsPerSiteMixture( tmp );
+
+        // if we are not in MCMC mode, then we need to (temporarily) free memory
+        if ( delete_partial_likelihoods == true )
+        {
+            // free the partial likelihoods
+            delete [] partialLikelihoods;
+            partialLikelihoods = NULL;
+            in_mcmc_mode = false;
+        }
+
+        // now match it back to the actual sites
+        rv = MatrixReal(num_sites, num_site_mixture_withInv, 0.0);
+        for (size_t i=0; i<num_sites; ++i)
+        {
+            size_t pattern_index = site_pattern[i];
+            for (size_t j=0; j<num_site_mixture_withInv; ++j)
+            {
+                rv[i][j] = tmp[pattern_index][j] / pattern_counts[pattern_index];
+            }
+        }
+
+    }
+    else
+    {
+        throw RbException("The PhyloCTMC process does not have a member method called '" + n + "'.");
+    }
+
+}
+
+
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates, const std::vector<size_t>& sampledSiteRates)
+{
+    RandomNumberGenerator* rng = GLOBAL_RNG;
+
+    // get working variables
+    size_t node_index = node.getIndex();
+    size_t left = node.getChild(0).getIndex();
+    size_t right = node.getChild(1).getIndex();
+    //    size_t parentIndex = node.getParent().getIndex();
+
+    // get transition probabilities
+    this->updateTransitionProbabilities( node_index );
+
+    // get the pointers to the partial likelihoods and the marginal likelihoods
+    //    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
+    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
+
+    // get pointers the likelihood for both subtrees
+    //    const double*   p_site           = p_node;
+    //    const double*   p_left_site      = p_left;
+    //    const double*   p_right_site     = p_right;
+
+    // sample characters conditioned on start states, going to end states
+    std::vector<double> p(this->num_chars, 0.0);
+    for (size_t i = 0; i < this->num_sites; i++)
+    {
+        size_t cat = sampledSiteRates[i];
+        size_t k = startStates[node_index][i].getStateIndex();
+
+
+        // sum to sample
+        double sum = 0.0;
+
+        // if the matrix is compressed use the pattern for this site
+        size_t pattern = i;
+        if ( compressed == true )
+        {
+            pattern = site_pattern[i];
+        }
+
+        // get ptr to first mixture cat for site
+        //        p_site          = p_node  + cat * this->mixtureOffset + pattern * this->siteOffset;
+        const double* p_left_site_mixture_j     = p_left  + cat * this->mixtureOffset + pattern * this->siteOffset;
+        const double* p_right_site_mixture_j    = p_right + cat * this->mixtureOffset + pattern * this->siteOffset;
+
+        // iterate over possible end states for each site given start state
+        for (size_t j = 0; j < this->num_chars; j++)
+        {
+            double tp_kj = this->transition_prob_matrices[cat][k][j];
+            p[j] = tp_kj * *p_left_site_mixture_j * *p_right_site_mixture_j;
+            sum += p[j];
+
+            //            p_site_mixture_j++;
+            p_left_site_mixture_j++;
+            p_right_site_mixture_j++;
+        }
+
+        // sample char from p
+        charType c = charType( template_state );
+        double u = rng->uniform01() * sum;
+        for (size_t state = 0; state < this->num_chars; state++)
+        {
+            u -= p[state];
+            if (u < 0.0)
+            {
+                endStates[node_index][i] = c;
+                break;
+            }
+            if (c.getStateIndex() + 1 >= c.getNumberOfStates())
+            {
+                c.setToFirstState();
+            }
+            else
+            {
+                c++;
             }
         }
+    }
 
-        // make sure the likelihoods are updated
-        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+    // recurse
+    std::vector<TopologyNode*> children = node.getChildren();
+    for (size_t i = 0; i < children.size(); i++)
+    {
+        // daughters identically inherit ancestral state
+        startStates[ children[i]->getIndex() ] = endStates[ node.getIndex() ];
 
-        // get the per site rate likelihood
-        size_t num_site_rates_withInv = num_site_rates;
-        double prob_invariant = getPInv();
-        if (prob_invariant > 0.0)
+        // recurse towards tips
+        if ( children[i]->isTip() == false )
         {
-            num_site_rates_withInv++;
+            recursivelyDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampledSiteRates);
+        }
+        else
+        {
+            tipDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampledSiteRates);
         }
 
-        // get the per site rate likelihood
-        MatrixReal tmp = MatrixReal(num_patterns, num_site_rates_withInv, 0.0);
-        computeRootLikelihoodsPerSiteRate( tmp );
+    }
 
-        // if we are not in MCMC mode, then we need to (temporarily) free memory
-        if ( delete_partial_likelihoods == true )
+}
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::tipDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates, const std::vector<size_t>& sampledSiteRates)
+{
+
+    // get working variables
+    size_t node_index = node.getIndex();
+
+    // get transition probabilities
+    this->updateTransitionProbabilities( node_index );
+
+    const AbstractHomologousDiscreteCharacterData& d = this->getValue();
+    const HomologousDiscreteCharacterData<charType>& dd = static_cast<const HomologousDiscreteCharacterData<charType>& >( d );
+    const DiscreteTaxonData<charType>& td = dd.getTaxonData( node.getName() );
+
+    // ideally sample ambiguous tip states given the underlying process and ancestral state
+    // for now, always sample the clamped character
+
+    // sample characters conditioned on start states, going to end states
+    std::vector<double> p(this->num_chars, 0.0);
+    for (size_t i = 0; i < this->num_sites; i++)
+    {
+
+        charType c = td.getCharacter(i);
+
+
+        if ( c.isAmbiguous() == false )
         {
-            // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
-            in_mcmc_mode = false;
+            // we know the tip state for unambiguous characters
+            endStates[node_index][i] = c;
         }
-
-        // now match it back to the actual sites
-        rv = MatrixReal(num_sites, num_site_rates_withInv, 0.0);
-        for (size_t i=0; i<num_sites; ++i)
+        else
         {
-            size_t pattern_index = site_pattern[i];
-            for (size_t j=0; j<num_site_rates_withInv; ++j)
+            // we sample the tip state for ambiguous characters
+            size_t cat = sampledSiteRates[i];
+            size_t k = startStates[node_index][i].getStateIndex();
+
+            // sum to sample
+            double sum = 0.0;
+
+            // if the matrix is compressed use the pattern for this site
+            size_t pattern = i;
+            if ( compressed == true )
             {
-                rv[i][j] = tmp[pattern_index][j] / pattern_counts[pattern_index];
+                pattern = site_pattern[i];
+            }
+
+            // get the ambiguous character's bitset for the tip taxon
+            RbBitSet bs = RbBitSet(this->num_chars, true);
+            if ( c.isMissingState() == false )
+            {
+                bs = c.getState();
+            }
+
+            // iterate over possible end states for each site given start state
+            for (size_t j = 0; j < this->num_chars; j++)
+            {
+                double tp_kj = this->transition_prob_matrices[cat][k][j] * bs[j];
+                p[j] = tp_kj;
+                sum += p[j];
             }
-        }
 
+            // sample char from p
+            charType c = charType( template_state );
+            double u = GLOBAL_RNG->uniform01() * sum;
+            for (size_t state = 0; state < this->num_chars; state++)
+            {
+                u -= p[state];
+                if (u < 0.0)
+                {
+                    endStates[node_index][i] = c;
+                    break;
+                }
+                if (c.getStateIndex() + 1 >= c.getNumberOfStates())
+                {
+                    c.setToFirstState();
+                }
+                else
+                {
+                    c++;
+                }
+            }
+        }
     }
-    else if ( n == "siteMixtureLikelihoods" )
+
+    // no further recursion
+
+}
+
+
+/**
+ * Compute the derivatives for the branches of all children of this node and recurse into the subtrees.
+ * The pre-order partial likelihoods W of this node must already be set. For a child k with transition probabilities P,
+ * the outside partial is U = W * (product of the partials of the siblings of k) and the inside partial D is the product of the
+ * partials of the children of k (or the observation at a tip). Then L = U' P D, dL/dt = U' Q P D, and the
+ * pre-order partial of k is U' P.
+ * We compute L from D instead of taking the stored partial of k because the latter may have been rescaled.
+ * The pre-order partials are rescaled per site, which cancels in dL/L.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyComputeBranchTimeDerivatives(const TopologyNode &node, std::vector<double> &pre_partials, const std::vector<double> &site_weights, std::vector<std::vector<double> > &d)
+{
+
+    const std::vector<TopologyNode*> &children = node.getChildren();
+    size_t node_index = node.getIndex();
+    const double* w_node = &pre_partials[node_index*this->nodeOffset];
+
+    size_t num_site_matrices = num_site_mixtures / num_site_rates;
+    std::vector<double> mixture_probs = getMixtureProbs();
+
+    std::vector<double> branch_likelihoods  = std::vector<double>(pattern_block_size, 0.0);
+    std::vector<double> branch_derivatives  = std::vector<double>(num_site_rates*pattern_block_size, 0.0);
+    std::vector<double> rate_matrices       = std::vector<double>(num_site_matrices*num_chars*num_chars, 0.0);
+    std::vector<double> dtp                 = std::vector<double>(num_site_mixtures*num_chars*num_chars, 0.0);
+
+    for (size_t k = 0; k < children.size(); ++k)
     {
+        const TopologyNode &child = *children[k];
+        size_t child_index = child.getIndex();
 
-        bool delete_partial_likelihoods = false;
+        // compute the transition probabilities
+        updateTransitionProbabilities( child_index );
 
-        // if we are not in MCMC mode, then we need to (temporarily) allocate memory
-        if ( in_mcmc_mode == false )
+        double end_age = child.getAge();
+
+        // if the tree is not a time tree, then the age will be not a number
+        if ( RbMath::isFinite(end_age) == false )
         {
-            delete_partial_likelihoods = true;
-            partialLikelihoods = new double[2*activeLikelihoodOffset];
-            in_mcmc_mode = true;
+            // we assume by default that the end is at time 0
+            end_age = 0.0;
+        }
+        double start_age = end_age + child.getBranchLength();
 
-            for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+        // get the rate matrices for this branch, using the same matrices as for the transition probabilities
+        RateMatrix_JC jc(this->num_chars);
+        for (size_t matrix = 0; matrix < num_site_matrices; ++matrix)
+        {
+            const RateGenerator *rm = &jc;
+            if ( this->heterogeneous_rate_matrices != NULL )
             {
-                (*it) = true;
+                rm = &this->heterogeneous_rate_matrices->getValue()[ (this->branch_heterogeneous_substitution_matrices == true ? child_index : matrix) ];
+            }
+            else if ( this->homogeneous_rate_matrix != NULL )
+            {
+                rm = &this->homogeneous_rate_matrix->getValue();
+            }
+
+            double* q = &rate_matrices[matrix*num_chars*num_chars];
+            for (size_t c1 = 0; c1 < num_chars; ++c1)
+            {
+                for (size_t c2 = 0; c2 < num_chars; ++c2)
+                {
+                    q[c1*num_chars + c2] = rm->getRate( c1, c2, start_age, 1.0 );
+                }
             }
         }
 
-        // make sure the likelihoods are updated
-        const_cast<AbstractPhyloCTMCSiteHomogeneous<charType> *>( this )->computeLnProbability();
+        // the derivatives of the transition probabilities, dP(t)/dt = Q P(t)
+        for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+        {
+            const double* q     = &rate_matrices[(mixture % num_site_matrices)*num_chars*num_chars];
+            const double* tp    = this->transition_prob_matrices[mixture].theMatrix;
+            double*       dtp_m = &dtp[mixture*num_chars*num_chars];
+            for (size_t c1 = 0; c1 < num_chars; ++c1)
+            {
+                for (size_t c2 = 0; c2 < num_chars; ++c2)
+                {
+                    double tmp = 0.0;
+                    for (size_t l = 0; l < num_chars; ++l)
+                    {
+                        tmp += q[c1*num_chars + l] * tp[l*num_chars + c2];
+                    }
+                    dtp_m[c1*num_chars + c2] = tmp;
+                }
+            }
+        }
 
-        // get the per site rate likelihood
-        size_t num_site_mixture_withInv = num_site_mixtures;
-        double prob_invariant = getPInv();
-        if (prob_invariant > 0.0)
+        // collect the partials of the siblings and of the children of this child
+        std::vector<const double*> p_siblings;
+        for (size_t i = 0; i < children.size(); ++i)
         {
-            num_site_mixture_withInv += size_t(num_site_mixtures/num_site_rates);
+            if ( i != k )
+            {
+                size_t sibling_index = children[i]->getIndex();
+                p_siblings.push_back( this->partialLikelihoods + this->activeLikelihood[sibling_index]*this->activeLikelihoodOffset + sibling_index*this->nodeOffset );
+            }
+        }
+        std::vector<const double*> p_grandchildren;
+        for (size_t i = 0; i < child.getNumberOfChildren(); ++i)
+        {
+            size_t grandchild_index = child.getChild(i).getIndex();
+            p_grandchildren.push_back( this->partialLikelihoods + this->activeLikelihood[grandchild_index]*this->activeLikelihoodOffset + grandchild_index*this->nodeOffset );
         }
 
-        // get the per site rate likelihood
-        MatrixReal tmp = MatrixReal(num_patterns, num_site_mixture_withInv, 0.0);
-        computeRootLikelihoodsPerSiteMixture( tmp );
+        bool is_tip = child.isTip();
+        size_t data_tip_index = ( is_tip == true ? this->taxon_name_2_tip_index_map[ child.getName() ] : 0 );
+        double* w_child = &pre_partials[child_index*this->nodeOffset];
 
-        // if we are not in MCMC mode, then we need to (temporarily) free memory
-        if ( delete_partial_likelihoods == true )
+        // the patterns are independent, so we can compute blocks of patterns in parallel
+        this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
         {
-            // free the partial likelihoods
-            delete [] partialLikelihoods;
-            partialLikelihoods = NULL;
-            in_mcmc_mode = false;
-        }
+            std::vector<double> u = std::vector<double>(num_chars, 0.0);
+            std::vector<double> inside = std::vector<double>(num_chars, 0.0);
 
-        // now match it back to the actual sites
-        rv = MatrixReal(num_sites, num_site_mixture_withInv, 0.0);
-        for (size_t i=0; i<num_sites; ++i)
+            for (size_t site = first_pattern; site < last_pattern; ++site)
+            {
+                double site_likelihood = 0.0;
+                double max = 0.0;
+
+                for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+                {
+                    size_t offset = mixture*this->mixtureOffset + site*this->siteOffset;
+
+                    // the outside partial likelihoods
+                    for (size_t c = 0; c < num_chars; ++c)
+                    {
+                        u[c] = w_node[offset + c];
+                    }
+                    for (size_t i = 0; i < p_siblings.size(); ++i)
+                    {
+                        for (size_t c = 0; c < num_chars; ++c)
+                        {
+                            u[c] *= p_siblings[i][offset + c];
+                        }
+                    }
+
+                    // the inside partial likelihoods
+                    if ( is_tip == true )
+                    {
+                        for (size_t c = 0; c < num_chars; ++c)
+                        {
+                            if ( this->gap_matrix[data_tip_index][site] == true )
+                            {
+                                inside[c] = 1.0;
+                            }
+                            else if ( using_ambiguous_characters == true )
+                            {
+                                inside[c] = ( this->ambiguous_char_matrix[data_tip_index][site].isSet(c) == true ? 1.0 : 0.0 );
+                            }
+                            else
+                            {
+                                inside[c] = ( this->char_matrix[data_tip_index][site] == c ? 1.0 : 0.0 );
+                            }
+                        }
+                    }
+                    else
+                    {
+                        for (size_t c = 0; c < num_chars; ++c)
+                        {
+                            inside[c] = 1.0;
+                        }
+                        for (size_t i = 0; i < p_grandchildren.size(); ++i)
+                        {
+                            for (size_t c = 0; c < num_chars; ++c)
+                            {
+                                inside[c] *= p_grandchildren[i][offset + c];
+                            }
+                        }
+                    }
+
+                    const double* tp    = this->transition_prob_matrices[mixture].theMatrix;
+                    const double* dtp_m = &dtp[mixture*num_chars*num_chars];
+                    double likelihood = 0.0;
+                    double derivative = 0.0;
+                    for (size_t c1 = 0; c1 < num_chars; ++c1)
+                    {
+                        double tmp_likelihood = 0.0;
+                        double tmp_derivative = 0.0;
+                        for (size_t c2 = 0; c2 < num_chars; ++c2)
+                        {
+                            tmp_likelihood += tp[c1*num_chars + c2] * inside[c2];
+                            tmp_derivative += dtp_m[c1*num_chars + c2] * inside[c2];
+                        }
+                        likelihood += u[c1] * tmp_likelihood;
+                        derivative += u[c1] * tmp_derivative;
+                    }
+
+                    site_likelihood += mixture_probs[mixture] * likelihood;
+                    branch_derivatives[(mixture / num_site_matrices)*pattern_block_size + site] += mixture_probs[mixture] * derivative;
+
+                    // the pre-order partial likelihoods of the child
+                    if ( is_tip == false )
+                    {
+                        for (size_t c2 = 0; c2 < num_chars; ++c2)
+                        {
+                            double tmp = 0.0;
+                            for (size_t c1 = 0; c1 < num_chars; ++c1)
+                            {
+                                tmp += u[c1] * tp[c1*num_chars + c2];
+                            }
+                            w_child[offset + c2] = tmp;
+                            max = ( tmp > max ? tmp : max );
+                        }
+                    }
+                }
+
+                branch_likelihoods[site] = site_likelihood;
+
+                // rescale the pre-order partial likelihoods to avoid underflow
+                if ( is_tip == false && max > 0.0 )
+                {
+                    for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+                    {
+                        double* w_site_mixture = w_child + mixture*this->mixtureOffset + site*this->siteOffset;
+                        for (size_t c = 0; c < num_chars; ++c)
+                        {
+                            w_site_mixture[c] /= max;
+                        }
+                    }
+                }
+            }
+        });
+
+        // sum the derivatives over the patterns
+        for (size_t site = 0; site < pattern_block_size; ++site)
         {
-            size_t pattern_index = site_pattern[i];
-            for (size_t j=0; j<num_site_mixture_withInv; ++j)
+            if ( site_weights[site] > 0.0 && branch_likelihoods[site] > 0.0 )
             {
-                rv[i][j] = tmp[pattern_index][j] / pattern_counts[pattern_index];
+                for (size_t j = 0; j < num_site_rates; ++j)
+                {
+                    d[child_index][j] += site_weights[site] * branch_derivatives[j*pattern_block_size + site] / branch_likelihoods[site];
+                }
             }
         }
+        std::fill( branch_derivatives.begin(), branch_derivatives.end(), 0.0 );
 
-    }
-    else
-    {
-        throw RbException("The PhyloCTMC process does not have a member method called '" + n + "'.");
+        if ( is_tip == false )
+        {
+            recursivelyComputeBranchTimeDerivatives( child, pre_partials, site_weights, d );
+        }
     }
 
 }
 
 
-
-
+/**
+ * Draw the end states of the branch leading to this node for all sites, given the start states, and recurse towards the tips.
+ * Tip states are taken from the compact data matrices; ambiguous and missing tip states are sampled.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates, const std::vector<size_t>& sampledSiteRates)
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursivelyDrawJointConditionalAncestralStateIndices(const TopologyNode &node, std::vector<size_t>& start_states, std::vector<size_t>& end_states)
 {
     RandomNumberGenerator* rng = GLOBAL_RNG;
 
-    // get working variables
-    size_t node_index = node.getIndex();
-    size_t left = node.getChild(0).getIndex();
-    size_t right = node.getChild(1).getIndex();
-    //    size_t parentIndex = node.getParent().getIndex();
-
-    // get transition probabilities
-    this->updateTransitionProbabilities( node_index );
-
-    // get the pointers to the partial likelihoods and the marginal likelihoods
-    //    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
+    // get working variables
+    size_t node_index = node.getIndex();
+    size_t node_offset = node_index * this->num_sites;
 
-    // get pointers the likelihood for both subtrees
-    //    const double*   p_site           = p_node;
-    //    const double*   p_left_site      = p_left;
-    //    const double*   p_right_site     = p_right;
+    // get transition probabilities
+    this->updateTransitionProbabilities( node_index );
 
-    // sample characters conditioned on start states, going to end states
     std::vector<double> p(this->num_chars, 0.0);
+    const std::vector<TopologyNode*> &children = node.getChildren();
     for (size_t i = 0; i < this->num_sites; i++)
     {
-        size_t cat = sampledSiteRates[i];
-        size_t k = startStates[node_index][i].getStateIndex();
+        size_t cat = sampled_site_mixtures[i];
+        size_t k = start_states[node_offset + i];
 
+        // if the matrix is compressed use the pattern for this site
+        size_t pattern = ( compressed == true ? site_pattern[i] : i );
 
-        // sum to sample
-        double sum = 0.0;
+        const TransitionProbabilityMatrix &tp = this->transition_prob_matrices[cat];
+        for (size_t j = 0; j < this->num_chars; j++)
+        {
+            p[j] = tp[k][j];
+        }
 
-        // if the matrix is compressed use the pattern for this site
-        size_t pattern = i;
-        if ( compressed == true )
+        if ( node.isTip() == false )
         {
-            pattern = site_pattern[i];
+            // condition on the data below each child
+            for (size_t c = 0; c < children.size(); ++c)
+            {
+                size_t child_index = children[c]->getIndex();
+                const double* p_child_site_mixture = this->partialLikelihoods + this->activeLikelihood[child_index]*this->activeLikelihoodOffset + child_index*this->nodeOffset + cat*this->mixtureOffset + pattern*this->siteOffset;
+                for (size_t j = 0; j < this->num_chars; j++)
+                {
+                    p[j] *= p_child_site_mixture[j];
+                }
+            }
         }
+        else if ( gap_matrix[node_index][pattern] == false )
+        {
+            if ( using_ambiguous_characters == false )
+            {
+                // we know the tip state for unambiguous characters
+                end_states[node_offset + i] = char_matrix[node_index][pattern];
+                continue;
+            }
 
-        // get ptr to first mixture cat for site
-        //        p_site          = p_node  + cat * this->mixtureOffset + pattern * this->siteOffset;
-        const double* p_left_site_mixture_j     = p_left  + cat * this->mixtureOffset + pattern * this->siteOffset;
-        const double* p_right_site_mixture_j    = p_right + cat * this->mixtureOffset + pattern * this->siteOffset;
+            // we sample the tip state for ambiguous characters
+            const RbBitSet &bs = ambiguous_char_matrix[node_index][pattern];
+            for (size_t j = 0; j < this->num_chars; j++)
+            {
+                p[j] *= bs.isSet(j);
+            }
+        }
 
-        // iterate over possible end states for each site given start state
+        // sample the state from p
+        double sum = 0.0;
         for (size_t j = 0; j < this->num_chars; j++)
         {
-            double tp_kj = this->transition_prob_matrices[cat][k][j];
-            p[j] = tp_kj * *p_left_site_mixture_j * *p_right_site_mixture_j;
             sum += p[j];
-
-            //            p_site_mixture_j++;
-            p_left_site_mixture_j++;
-            p_right_site_mixture_j++;
         }
 
-        // sample char from p
-        charType c = charType( template_state );
         double u = rng->uniform01() * sum;
-        for (size_t state = 0; state < this->num_chars; state++)
+        size_t state = 0;
+        for (; state < this->num_chars-1; ++state)
         {
             u -= p[state];
             if (u < 0.0)
             {
-                endStates[node_index][i] = c;
                 break;
             }
-            if (c.getStateIndex() + 1 >= c.getNumberOfStates())
-            {
-                c.setToFirstState();
-            }
-            else
-            {
-                c++;
-            }
         }
+
+        end_states[node_offset + i] = state;
     }
 
     // recurse
-    std::vector<TopologyNode*> children = node.getChildren();
     for (size_t i = 0; i < children.size(); i++)
     {
         // daughters identically inherit ancestral state
-        startStates[ children[i]->getIndex() ] = endStates[ node.getIndex() ];
-
-        // recurse towards tips
-        if ( children[i]->isTip() == false )
-        {
-            recursivelyDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampledSiteRates);
-        }
-        else
-        {
-            tipDrawJointConditionalAncestralStates(*children[i], startStates, endStates, sampledSiteRates);
-        }
+        size_t child_offset = children[i]->getIndex() * this->num_sites;
+        std::copy( end_states.begin() + node_offset, end_states.begin() + node_offset + this->num_sites, start_states.begin() + child_offset );
 
+        recursivelyDrawJointConditionalAncestralStateIndices( *children[i], start_states, end_states );
     }
 
 }
 
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::tipDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates, const std::vector<size_t>& sampledSiteRates)
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::fireTreeChangeEvent( const RevBayesCore::TopologyNode &n, const unsigned& m )
 {
 
-    // get working variables
-    size_t node_index = node.getIndex();
-
-    // get transition probabilities
-    this->updateTransitionProbabilities( node_index );
-
-    const AbstractHomologousDiscreteCharacterData& d = this->getValue();
-    const HomologousDiscreteCharacterData<charType>& dd = static_cast<const HomologousDiscreteCharacterData<charType>& >( d );
-    const DiscreteTaxonData<charType>& td = dd.getTaxonData( node.getName() );
-
-    // ideally sample ambiguous tip states given the underlying process and ancestral state
-    // for now, always sample the clamped character
+    // call a recursive flagging of all node above (closer to the root) and including this node
+    recursivelyFlagNodeDirty( n );
 
-    // sample characters conditioned on start states, going to end states
-    std::vector<double> p(this->num_chars, 0.0);
-    for (size_t i = 0; i < this->num_sites; i++)
+    // the traversal order needs to be recomputed if the topology has changed
+    if ( m == TreeChangeEventMessage::DEFAULT || m == TreeChangeEventMessage::TOPOLOGY )
     {
+        traversal_stale = true;
+        topology_touched = true;
+    }
 
-        charType c = td.getCharacter(i);
-
+}
 
-        if ( c.isAmbiguous() == false )
-        {
-            // we know the tip state for unambiguous characters
-            endStates[node_index][i] = c;
-        }
-        else
-        {
-            // we sample the tip state for ambiguous characters
-            size_t cat = sampledSiteRates[i];
-            size_t k = startStates[node_index][i].getStateIndex();
 
-            // sum to sample
-            double sum = 0.0;
+template<class charType>
+std::vector<size_t> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getIncludedSiteIndices( void )
+{
+    return this->value->getIncludedSiteIndices();
+}
 
-            // if the matrix is compressed use the pattern for this site
-            size_t pattern = i;
-            if ( compressed == true )
-            {
-                pattern = site_pattern[i];
-            }
 
-            // get the ambiguous character's bitset for the tip taxon
-            RbBitSet bs = RbBitSet(this->num_chars, true);
-            if ( c.isMissingState() == false )
-            {
-                bs = c.getState();
-            }
 
-            // iterate over possible end states for each site given start state
-            for (size_t j = 0; j < this->num_chars; j++)
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getRootFrequencies( std::vector<std::vector<double> >& rf ) const
+{
+    if ( root_frequencies != NULL )
+    {
+        std::vector<double> f = root_frequencies->getValue();
+        rf.push_back( f );
+    }
+    else if (heterogeneous_rate_matrices !=  NULL)
+    {
+        if ( this->branch_heterogeneous_substitution_matrices == true)
+        {
+            if (root_frequencies == NULL)
             {
-                double tp_kj = this->transition_prob_matrices[cat][k][j] * bs[j];
-                p[j] = tp_kj;
-                sum += p[j];
+                throw RbException("Using branch-heterogeneous rate matrices, but no root frequencies have been specified");
             }
 
-            // sample char from p
-            charType c = charType( template_state );
-            double u = GLOBAL_RNG->uniform01() * sum;
-            for (size_t state = 0; state < this->num_chars; state++)
+            std::vector<double> f = root_frequencies->getValue();
+            rf.push_back( f );
+        }
+        else
+        {
+            for (size_t matrix = 0; matrix < this->num_matrices; matrix++)
             {
-                u -= p[state];
-                if (u < 0.0)
-                {
-                    endStates[node_index][i] = c;
-                    break;
-                }
-                if (c.getStateIndex() + 1 >= c.getNumberOfStates())
+                const RateMatrix *rm = dynamic_cast<const RateMatrix *>(&heterogeneous_rate_matrices->getValue()[matrix]);
+                if ( rm != NULL )
                 {
-                    c.setToFirstState();
+                    rf.push_back( rm->getStationaryFrequencies() );
                 }
                 else
                 {
-                    c++;
+                    throw RbException("If you want to use RateGenerators that are not RateMatrices then you need to specify the root frequencies directly.");
                 }
             }
         }
     }
+    else if (homogeneous_rate_matrix != NULL)
+    {
+        const RateMatrix *rm = dynamic_cast<const RateMatrix *>(&homogeneous_rate_matrix->getValue());
+        if ( rm != NULL )
+        {
+            rf.push_back( rm->getStationaryFrequencies() );
+        }
+        else
+        {
+            throw RbException("If you want to use RateGenerators that are not RateMatrices then you need to specify the root frequencies directly.");
+        }
 
-    // no further recursion
+    }
+    else
+    {
+        rf.push_back( std::vector<double>(num_chars, 1.0/num_chars) );
+    }
+}
+
+template<class charType>
+std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getRootFrequencies( size_t mixture ) const
+{
+    if (mixture > this->num_site_mixtures)
+    {
+        throw(RbException("Site mixture index out of bounds"));
+    }
+
+    std::vector<std::vector<double> > rf;
+    getRootFrequencies(rf);
 
+    return rf[mixture % rf.size()];
 }
 
+/**
+ * Get the clock rate of a branch as used for the transition probabilities,
+ * i.e., rescaled by the inverse of the proportion of variable sites.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::fillLikelihoodVector(const TopologyNode &node, size_t node_index)
+double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getBranchClockRate(size_t node_index) const
 {
 
-    // check for recomputation
-    if ( dirty_nodes[node_index] == true )
+    double rate = 1.0;
+    if ( this->branch_heterogeneous_clock_rates == true )
+    {
+        rate = this->heterogeneous_clock_rates->getValue()[node_index];
+    }
+    else if (homogeneous_clock_rate != NULL)
     {
-        // mark as computed
-        dirty_nodes[node_index] = false;
+        rate = this->homogeneous_clock_rate->getValue();
+    }
 
-        if ( node.isTip() == true )
-        {
-            // this is a tip node
-            // compute the likelihood for the tip and we are done
-            computeTipLikelihood(node, node_index);
+    return rate / ( 1.0 - getPInv() );
+}
 
-            // rescale likelihood vector
-            scale(node_index);
-        }
-        else
-        {
-            // this is an internal node
-            const TopologyNode     &left        = node.getChild(0);
-            size_t                  left_index  = left.getIndex();
-            fillLikelihoodVector( left, left_index );
-            const TopologyNode     &right       = node.getChild(1);
-            size_t                  right_index = right.getIndex();
-            fillLikelihoodVector( right, right_index );
 
-            // now compute the likelihoods of this internal node
-            computeInternalNodeLikelihood(node,node_index,left_index,right_index);
+/**
+ * Get the root frequencies for the invariant sites, i.e., the mean root frequencies over the site matrices.
+ */
+template<class charType>
+std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getInvariantSiteFrequencies( void ) const
+{
+
+    std::vector<double> f;
+    if (this->branch_heterogeneous_substitution_matrices == true)
+    {
+        f = this->getRootFrequencies(0);
+    }
+    else
+    {
+        std::vector<std::vector<double> > ff;
+        getRootFrequencies(ff);
+
+        std::vector<double> matrix_probs(num_matrices, 1.0/num_matrices);
 
-            // rescale likelihood vector
-            scale(node_index,left_index,right_index);
+        if (site_matrix_probs != NULL)
+        {
+            matrix_probs = site_matrix_probs->getValue();
         }
 
+        f = std::vector<double>(ff[0].size(), 0.0);
+
+        for (size_t matrix = 0; matrix < ff.size(); matrix++)
+        {
+            // get the root frequencies
+            const std::vector<double> &fm = ff[matrix];
+
+            for (size_t i = 0; i < fm.size(); i++)
+            {
+                f[i] += fm[i] * matrix_probs[matrix];
+            }
+        }
     }
 
+    return f;
 }
 
 
-
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::fireTreeChangeEvent( const RevBayesCore::TopologyNode &n, const unsigned& m )
+double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getSiteRate(size_t rate_index) const
 {
 
-    // call a recursive flagging of all node above (closer to the root) and including this node
-    recursivelyFlagNodeDirty( n );
+    double r = 1.0;
+    if ( this->rate_variation_across_sites == true )
+    {
+        r = this->site_rates->getValue()[rate_index];
+    }
 
+    return r;
 }
 
 
-template<class charType>
-std::vector<size_t> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getIncludedSiteIndices( void )
-{
-    return this->value->getIncludedSiteIndices();
+/**
+ * Get the clock rate of a branch for stochastic mapping, multiplied by the rate of the site rate category.
+ */
+template<class charType>
+double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getStochasticMappingClockRate(size_t node_index, size_t rate_component) const
+{
+
+    double clock_rate = 1.0;
+    if ( this->branch_heterogeneous_clock_rates == true )
+    {
+        if (this->heterogeneous_clock_rates != NULL)
+        {
+            clock_rate = this->heterogeneous_clock_rates->getValue()[node_index];
+        }
+    }
+    else
+    {
+        if (this->homogeneous_clock_rate != NULL)
+        {
+            clock_rate = this->homogeneous_clock_rate->getValue();
+        }
+    }
+
+    // multiply by the clock-rate for the site
+    if (this->site_rates != NULL)
+    {
+        // there is a mixture over site rates
+        clock_rate *= this->site_rates->getValue()[rate_component];
+    }
+
+    return clock_rate;
 }
 
 
-
+/**
+ * Get the rate matrix of a branch for stochastic mapping (or of the site if using a mixture of matrices over sites).
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getRootFrequencies( std::vector<std::vector<double> >& rf ) const
+const RevBayesCore::RateGenerator* RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getStochasticMappingRateGenerator(size_t node_index, size_t matrix_component, const RateGenerator *default_rate_generator) const
 {
-    if ( root_frequencies != NULL )
-    {
-        std::vector<double> f = root_frequencies->getValue();
-        rf.push_back( f );
-    }
-    else if (heterogeneous_rate_matrices !=  NULL)
+
+    const RateGenerator *rate_matrix = default_rate_generator;
+    if ( this->branch_heterogeneous_substitution_matrices == true )
     {
-        if ( this->branch_heterogeneous_substitution_matrices == true)
+        if (this->heterogeneous_rate_matrices != NULL)
         {
-            if (root_frequencies == NULL)
-            {
-                throw RbException("Using branch-heterogeneous rate matrices, but no root frequencies have been specified");
-            }
-
-            std::vector<double> f = root_frequencies->getValue();
-            rf.push_back( f );
+            rate_matrix = &this->heterogeneous_rate_matrices->getValue()[node_index];
         }
-        else
+        else if (this->homogeneous_rate_matrix != NULL)
         {
-            for (size_t matrix = 0; matrix < this->num_matrices; matrix++)
-            {
-                const RateMatrix *rm = dynamic_cast<const RateMatrix *>(&heterogeneous_rate_matrices->getValue()[matrix]);
-                if ( rm != NULL )
-                {
-                    rf.push_back( rm->getStationaryFrequencies() );
-                }
-                else
-                {
-                    throw RbException("If you want to use RateGenerators that are not RateMatrices then you need to specify the root frequencies directly.");
-                }
-            }
+            rate_matrix = &this->homogeneous_rate_matrix->getValue();
         }
     }
-    else if (homogeneous_rate_matrix != NULL)
+    else
     {
-        const RateMatrix *rm = dynamic_cast<const RateMatrix *>(&homogeneous_rate_matrix->getValue());
-        if ( rm != NULL )
+        if (this->homogeneous_rate_matrix != NULL)
         {
-            rf.push_back( rm->getStationaryFrequencies() );
+            rate_matrix = &this->homogeneous_rate_matrix->getValue();
         }
-        else
+        else if (this->site_matrix_probs != NULL)
         {
-            throw RbException("If you want to use RateGenerators that are not RateMatrices then you need to specify the root frequencies directly.");
+            rate_matrix = &this->heterogeneous_rate_matrices->getValue()[matrix_component];
         }
-
-    }
-    else
-    {
-        rf.push_back( std::vector<double>(num_chars, 1.0/num_chars) );
     }
+
+    return rate_matrix;
 }
 
+
+
+/**
+ * Get the current value for reading.
+ * Going through the const interface makes sure that we don't unshare the characters, which may be shared with clones of the model.
+ */
 template<class charType>
-std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getRootFrequencies( size_t mixture ) const
+const RevBayesCore::AbstractHomologousDiscreteCharacterData& RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getCharacterData( void ) const
 {
-    if (mixture > this->num_site_mixtures)
-    {
-        throw(RbException("Site mixture index out of bounds"));
-    }
-
-    std::vector<std::vector<double> > rf;
-    getRootFrequencies(rf);
 
-    return rf[mixture % rf.size()];
+    return *this->value;
 }
 
+
 template<class charType>
 std::vector<double> RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getMixtureProbs( void ) const
 {
@@ -2173,6 +4189,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::keepSpecializatio
 
     // reset flags for likelihood computation
     touched = false;
+    topology_touched = false;
 
     // reset the ln probability
     this->storedLnProb = this->lnProb;
@@ -2246,6 +4263,12 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::recursiveMarginal
 
 
 
+/**
+ * Simulate a new alignment along the tree.
+ * The mixture categories and the states are drawn from alias tables with one uniform random number each.
+ * Note that this uses the random numbers differently than the linear scan of the cumulative probabilities
+ * used before version 1.1, so the same seed now gives a different (but equally distributed) alignment.
+ */
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void )
 {
@@ -2267,7 +4290,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
             std::vector<bool> taxon_mask_missing    = std::vector<bool>(num_sites,false);
 
             const std::string &taxon_name = tau->getValue().getNode( i ).getName();
-            AbstractDiscreteTaxonData& taxon = value->getTaxonData( taxon_name );
+            const AbstractDiscreteTaxonData& taxon = this->getCharacterData().getTaxonData( taxon_name );
 
             for ( size_t site=0; site<site_indices.size(); ++site)
             {
@@ -2288,14 +4311,21 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
     // create a new character data object
     this->value = new HomologousDiscreteCharacterData<charType>();
 
-    // create a vector of taxon data
-    std::vector< DiscreteTaxonData<charType> > taxa = std::vector< DiscreteTaxonData< charType > >( num_nodes, DiscreteTaxonData<charType>( Taxon("") ) );
+    // we simulate the states as integers and only create the character data at the end
+    // the states of the internal nodes are freed as soon as their children are simulated, unless we store them
+    std::vector< std::vector<unsigned int> > states = std::vector< std::vector<unsigned int> >( num_nodes );
 
     // first, simulate the per site rates
     RandomNumberGenerator* rng = GLOBAL_RNG;
     std::vector<size_t> perSiteMixtures = std::vector<size_t>(num_sites,0);
     std::vector<bool> inv = std::vector<bool>(num_sites,false);
     double prob_invariant = getPInv();
+    AliasTable mixture_table;
+    if ( num_site_mixtures > 1 )
+    {
+        std::vector<double> mixture_probs = getMixtureProbs();
+        mixture_table.build( &mixture_probs[0], mixture_probs.size() );
+    }
     for ( size_t i = 0; i < num_sites; ++i )
     {
         // draw if this site is invariant
@@ -2309,28 +4339,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
         else if ( num_site_mixtures  > 1 )
         {
             // draw the rate for this site
-            u = rng->uniform01();
-            size_t mixtureIndex = 0;
-
-            std::vector<double> mixtureProbs = getMixtureProbs();
-
-            std::vector< double >::const_iterator freq = mixtureProbs.begin();
-            while ( true )
-            {
-                u -= *freq;
-
-                if ( u > 0.0 )
-                {
-                    ++mixtureIndex;
-                    ++freq;
-                }
-                else
-                {
-                    break;
-                }
-            }
-
-            perSiteMixtures[i] = mixtureIndex;
+            perSiteMixtures[i] = mixture_table.draw( rng );
         }
         else
         {
@@ -2341,63 +4350,59 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
 
     }
 
+    // simulate the root sequence
     std::vector<std::vector<double> > freqs;
     getRootFrequencies(freqs);
-    // simulate the root sequence
-    DiscreteTaxonData< charType > &root = taxa[ tau->getValue().getRoot().getIndex() ];
+    std::vector<AliasTable> root_tables = std::vector<AliasTable>( freqs.size() );
+    for (size_t j = 0; j < freqs.size(); ++j)
+    {
+        root_tables[j].build( &freqs[j][0], num_chars );
+    }
+    size_t root_index = tau->getValue().getRoot().getIndex();
+    std::vector<unsigned int> &root = states[ root_index ];
+    root.resize( num_sites );
     for ( size_t i = 0; i < num_sites; ++i )
     {
-        const std::vector< double > &stationary_freqs = freqs[perSiteMixtures[i] % freqs.size()];
-
-        // create the character
-        charType c = charType( num_chars );
-        c.setToFirstState();
-
-        // draw the state
-        double u = rng->uniform01();
-        std::vector< double >::const_iterator freq = stationary_freqs.begin();
-        while ( true )
-        {
-            u -= *freq;
-            if ( u > 0.0 )
-            {
-                ++c;
-                ++freq;
-            }
-            else
-            {
-                break;
-            }
-
-        }
-
-        // add the character to the sequence
-        root.addCharacter( c );
+        root[i] = (unsigned int)root_tables[ perSiteMixtures[i] % freqs.size() ].draw( rng );
     }
-    // recursively simulate the sequences
-    root.setTaxon( Taxon("Root") );
 
     // recursively simulate the sequences
-    simulate( tau->getValue().getRoot(), taxa, inv, perSiteMixtures );
+    std::vector<AliasTable> tables = std::vector<AliasTable>( num_site_mixtures * num_chars );
+    simulate( tau->getValue().getRoot(), states, inv, perSiteMixtures, tables );
 
     // add the taxon data to the character data
+    charType c = charType( num_chars );
+    c.setToFirstState();
     for (size_t i = 0; i < this->tau->getValue().getNumberOfNodes(); ++i)
     {
 
         const TopologyNode& node = this->tau->getValue().getNode(i);
         size_t node_index = node.getIndex();
 
-        if (node.isTip() == true)
+        if ( node.isTip() == false && store_internal_nodes == false )
+        {
+            continue;
+        }
+
+        DiscreteTaxonData<charType> taxon = DiscreteTaxonData<charType>( Taxon("") );
+        if ( node.isTip() == true )
         {
-            this->value->addTaxonData( taxa[node_index] );
+            taxon.setTaxon( node.getTaxon() );
         }
-        else if (store_internal_nodes == true)
+        else
         {
             std::stringstream ss;
             ss << "Index_" << node_index + 1;
-            taxa[node_index].setTaxon( Taxon(ss.str()) );
-            this->value->addTaxonData( taxa[node_index] );
+            taxon.setTaxon( Taxon(ss.str()) );
+        }
+
+        const std::vector<unsigned int> &node_states = states[node_index];
+        for ( size_t site = 0; site < num_sites; ++site )
+        {
+            c.setStateByIndex( node_states[site] );
+            taxon.addCharacter( c );
         }
+        this->value->addTaxonData( taxon );
 
     }
 
@@ -2520,6 +4525,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::restoreSpecializa
     // reset flags for likelihood computation
     touched = false;
 
+    // the topology may have been restored without telling us
+    if ( topology_touched == true )
+    {
+        traversal_stale = true;
+        topology_touched = false;
+    }
+
     // reset the ln probability
     this->lnProb = this->storedLnProb;
 
@@ -2775,14 +4787,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::setValue(Abstract
     // reset the number of sites
     this->num_sites = v->getNumberOfIncludedCharacters();
 
-    site_pattern.clear();
-    site_pattern.resize(num_sites);
+    site_pattern = std::vector<size_t>(num_sites, 0);
 
     // now compress the data and resize the likelihood vectors
     this->compress();
 
     // now we also set the template state
-    template_state = charType( static_cast<const charType&>( this->value->getTaxonData(0).getCharacter(0) ) );
+    template_state = charType( static_cast<const charType&>( this->getCharacterData().getTaxonData(0).getCharacter(0) ) );
     template_state.setToFirstState();
     template_state.setGapState( false );
     template_state.setMissingState( false );
@@ -2790,8 +4801,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::setValue(Abstract
 }
 
 
+/**
+ * Simulate the states of all sites for the children of the node, and recursively for their descendants.
+ * For every branch we build an alias table per mixture category and ancestral state from the rows of the
+ * transition probability matrices, so that each site needs a single random number.
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::simulate( const TopologyNode &node, std::vector< DiscreteTaxonData< charType > > &taxa, const std::vector<bool> &invariant, const std::vector<size_t> &perSiteMixtures)
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::simulate( const TopologyNode &node, std::vector< std::vector<unsigned int> > &states, const std::vector<bool> &invariant, const std::vector<size_t> &perSiteMixtures, std::vector<AliasTable> &tables)
 {
 
     // get the children of the node
@@ -2799,7 +4815,6 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::simulate( const T
 
     // get the sequence of this node
     size_t node_index = node.getIndex();
-    const DiscreteTaxonData< charType > &parent = taxa[ node_index ];
 
     // simulate the sequence for each child
     RandomNumberGenerator* rng = GLOBAL_RNG;
@@ -2809,68 +4824,45 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::simulate( const T
 
         // update the transition probability matrix
         updateTransitionProbabilities( child.getIndex() );
+        for (size_t mixture = 0; mixture < num_site_mixtures; ++mixture)
+        {
+            for (size_t state = 0; state < num_chars; ++state)
+            {
+                tables[mixture * num_chars + state].build( transition_prob_matrices[mixture][state], num_chars );
+            }
+        }
 
-        DiscreteTaxonData< charType > &taxon = taxa[ child.getIndex() ];
+        const std::vector<unsigned int> &parent = states[ node_index ];
+        std::vector<unsigned int> &taxon = states[ child.getIndex() ];
+        taxon.resize( num_sites );
         for ( size_t i = 0; i < num_sites; ++i )
         {
 
             if ( invariant[i] == true )
             {
-
-                // add the character to the sequence
-                taxon.addCharacter( parent.getCharacter( i ) );
+                taxon[i] = parent[i];
             }
             else
             {
-                // get the ancestral character for this site
-                unsigned long parentState = parent.getCharacter( i ).getStateIndex();
-
-                double *freqs = transition_prob_matrices[ perSiteMixtures[i] ][ parentState ];
-
-                // create the character
-                charType c = charType( num_chars );
-                c.setToFirstState();
-                // draw the state
-                double u = rng->uniform01();
-                size_t stateIndex = 0;
-                while ( true )
-                {
-                    u -= *freqs;
-                    ++stateIndex;
-
-                    if ( u > 0.0 && stateIndex < this->num_chars)
-                    {
-                        ++c;
-                        ++freqs;
-                    }
-                    else
-                    {
-                        break;
-                    }
-
-                }
-
-                // add the character to the sequence
-                taxon.addCharacter( c );
+                taxon[i] = (unsigned int)tables[ perSiteMixtures[i] * num_chars + parent[i] ].draw( rng );
             }
 
         }
 
-        if ( child.isTip() )
-        {
-            taxon.setTaxon( child.getTaxon() );
-        }
-        else
+        if ( child.isTip() == false )
         {
             // recursively simulate the sequences
-            std::stringstream ss;
-            ss << "Node" << child.getIndex();
-            taxon.setTaxon( Taxon(ss.str()) );
-            simulate( child, taxa, invariant, perSiteMixtures );
+            simulate( child, states, invariant, perSiteMixtures, tables );
         }
 
     }
 
+    // we do not need the states of this node anymore
+    if ( node.isTip() == false && store_internal_nodes == false )
+    {
+        std::vector<unsigned int>().swap( states[node_index] );
+    }
+
 }
 
 
@@ -3333,36 +5325,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     if ( prob_invariant > 0.0 )
     {
         // get the mean root frequency vector
-        std::vector<double> f;
-        if (this->branch_heterogeneous_substitution_matrices == true)
-        {
-            f = this->getRootFrequencies(0);
-        }
-        else
-        {
-            std::vector<std::vector<double> > ff;
-            getRootFrequencies(ff);
-
-            std::vector<double> matrix_probs(num_matrices, 1.0/num_matrices);
-
-            if (site_matrix_probs != NULL)
-            {
-                matrix_probs = site_matrix_probs->getValue();
-            }
-
-            f = std::vector<double>(ff[0].size(), 0.0);
-
-            for (size_t matrix = 0; matrix < ff.size(); matrix++)
-            {
-                // get the root frequencies
-                const std::vector<double> &fm = ff[matrix];
-
-                for (size_t i = 0; i < fm.size(); i++)
-                {
-                    f[i] += fm[i] * matrix_probs[matrix];
-                }
-            }
-        }
+        std::vector<double> f = getInvariantSiteFrequencies();
 
         for (size_t site = 0; site < pattern_block_size; ++site, ++patterns)
         {
@@ -3632,36 +5595,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     if ( prob_invariant > 0.0 )
     {
         // get the mean root frequency vector
-        std::vector<double> f;
-        if (this->branch_heterogeneous_substitution_matrices == true)
-        {
-            f = this->getRootFrequencies(0);
-        }
-        else
-        {
-            std::vector<std::vector<double> > ff;
-            getRootFrequencies(ff);
-
-            std::vector<double> matrix_probs(num_matrices, 1.0/num_matrices);
-
-            if (site_matrix_probs != NULL)
-            {
-                matrix_probs = site_matrix_probs->getValue();
-            }
-
-            f = std::vector<double>(ff[0].size(), 0.0);
-
-            for (size_t matrix = 0; matrix < ff.size(); matrix++)
-            {
-                // get the root frequencies
-                const std::vector<double> &fm = ff[matrix];
-
-                for (size_t i = 0; i < fm.size(); i++)
-                {
-                    f[i] += fm[i] * matrix_probs[matrix];
-                }
-            }
-        }
+        std::vector<double> f = getInvariantSiteFrequencies();
 
         size_t num_site_rates_withInv = num_site_rates + 1;
 
@@ -3837,6 +5771,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::swapParameterInte
         tau->getValue().getTreeChangeEventHandler().addListener( this );
 
         num_nodes = tau->getValue().getNumberOfNodes();
+        traversal_stale = true;
     }
 
 }
@@ -3911,6 +5846,12 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::touchSpecializati
     if ( touch_all == true )
     {
 
+        // the tree may have been replaced as a whole
+        if ( affecter == tau )
+        {
+            traversal_stale = true;
+        }
+
         for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
         {
             (*it) = true;
@@ -3949,36 +5890,19 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateMarginalNod
 /*
  * Update the transition probability matrices for the branch attached to the given node index.
  */
+/**
+ * Compute the transition probabilities for the interval from start_age to end_age on the branch above the node with index node_idx.
+ * We use the clock rate and the rate matrices of this branch, so the interval can also be only a part of the branch
+ * (e.g., when we evaluate a regraft point, see computeRegraftLnLikelihoods).
+ */
 template<class charType>
-void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionProbabilities(size_t node_idx)
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeTransitionProbabilities(size_t node_idx, double start_age, double end_age, std::vector<TransitionProbabilityMatrix> &tp) const
 {
-    const TopologyNode* node = tau->getValue().getNodes()[node_idx];
 
-    if (node->isRoot()) throw RbException("dnPhyloCTMC called updateTransitionProbabilities for the root node\n");
-
-    // second, get the clock rate for the branch
-    double rate = 1.0;
-    if ( this->branch_heterogeneous_clock_rates == true )
-    {
-        rate = this->heterogeneous_clock_rates->getValue()[node_idx];
-    }
-    else if (homogeneous_clock_rate != NULL)
-    {
-        rate = this->homogeneous_clock_rate->getValue();
-    }
-
-    // we rescale the rate by the inverse of the proportion of invariant sites
-    rate /= ( 1.0 - getPInv() );
-
-    double end_age = node->getAge();
+    Profiler::Timer timer( Profiler::LIKELIHOOD, "transition probabilities" );
 
-    // if the tree is not a time tree, then the age will be not a number
-    if ( RbMath::isFinite(end_age) == false )
-    {
-        // we assume by default that the end is at time 0
-        end_age = 0.0;
-    }
-    double start_age = end_age + node->getBranchLength();
+    // get the clock rate for the branch, rescaled by the inverse of the proportion of invariant sites
+    double rate = getBranchClockRate( node_idx );
 
     // first, get the rate matrix for this branch
     RateMatrix_JC jc(this->num_chars);
@@ -3999,13 +5923,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
 
             for (size_t j = 0; j < this->num_site_rates; ++j)
             {
-                double r = 1.0;
-                if ( this->rate_variation_across_sites == true )
-                {
-                    r = this->site_rates->getValue()[j];
-                }
-
-                rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->transition_prob_matrices[j*this->num_matrices + matrix] );
+                rm->calculateTransitionProbabilities( start_age, end_age,  rate * getSiteRate( j ), tp[j*this->num_matrices + matrix] );
             }
         }
     }
@@ -4022,15 +5940,32 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
 
         for (size_t j = 0; j < this->num_site_rates; ++j)
         {
-            double r = 1.0;
-            if ( this->rate_variation_across_sites == true )
-            {
-                r = this->site_rates->getValue()[j];
-            }
-
-            rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->transition_prob_matrices[j] );
+            rm->calculateTransitionProbabilities( start_age, end_age,  rate * getSiteRate( j ), tp[j] );
         }
     }
+
+}
+
+
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionProbabilities(size_t node_idx)
+{
+    const TopologyNode* node = tau->getValue().getNodes()[node_idx];
+
+    if (node->isRoot()) throw RbException("dnPhyloCTMC called updateTransitionProbabilities for the root node\n");
+
+    double end_age = node->getAge();
+
+    // if the tree is not a time tree, then the age will be not a number
+    if ( RbMath::isFinite(end_age) == false )
+    {
+        // we assume by default that the end is at time 0
+        end_age = 0.0;
+    }
+    double start_age = end_age + node->getBranchLength();
+
+    computeTransitionProbabilities( node_idx, start_age, end_age, this->transition_prob_matrices );
+
 }
 
 #endif
@@ -0,0 +1,33 @@
+#ifndef BranchLengthLikelihoodEvaluator_H
+#define BranchLengthLikelihoodEvaluator_H
+
+namespace RevBayesCore {
+
+    class TopologyNode;
+
+    /**
+     * @brief Interface for likelihoods that can evaluate the length of a single branch while the rest of the tree is fixed.
+     *
+     * Optimizing a branch length by Newton-Raphson needs the ln likelihood and its first two derivatives for several lengths
+     * of the same branch. Everything except the transition probabilities of this branch stays the same, so we first cache the
+     * partial likelihoods at both ends of the branch (prepareBranchLengthOptimization) and then evaluate any number of lengths
+     * for the cost of a single branch each (computeBranchLengthDerivatives).
+     * The tree itself is not changed; the cache is invalid as soon as the tree or any other parameter changes.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class BranchLengthLikelihoodEvaluator {
+
+    public:
+        virtual                                    ~BranchLengthLikelihoodEvaluator(void) {}
+
+        virtual void                                computeBranchLengthDerivatives(double branch_length, double &ln_likelihood, double &first, double &second) = 0;   //!< The ln likelihood and its first two derivatives for this length of the prepared branch
+        virtual bool                                prepareBranchLengthOptimization(const TopologyNode &node) = 0;                                                      //!< Cache the partial likelihoods at both ends of the branch above the node (false if not available for this model)
+
+    };
+
+}
+
+#endif
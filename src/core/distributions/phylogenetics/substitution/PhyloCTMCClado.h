@@ -35,7 +35,11 @@ namespace RevBayesCore {
         // public member functions
         PhyloCTMCClado*                                     clone(void) const;                                                                          //!< Create an independent clone
         virtual double                                      computeLnProbability(void);
+        virtual bool                                        computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);
+        virtual bool                                        computeRegraftLnLikelihoods(const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods);
+        virtual bool                                        prepareBranchLengthOptimization(const TopologyNode &node);
         virtual std::vector<charType>						drawAncestralStatesForNode(const TopologyNode &n);
+        virtual void                                        drawJointConditionalAncestralStateIndices(std::vector<size_t>& startStates, std::vector<size_t>& endStates);
         virtual void                                        drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates);
         virtual void                                        recursivelyDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates, const std::vector<size_t>& sampledSiteRates);
 
@@ -46,6 +50,7 @@ namespace RevBayesCore {
 
     protected:
 
+        virtual void                                        computeBranchTimeDerivatives(std::vector<std::vector<double> > &d);
         virtual void                                        resizeLikelihoodVectors(void);
 
         void                                                computeRootLikelihood(size_t root, size_t l, size_t r);
@@ -241,6 +246,50 @@ RevBayesCore::PhyloCTMCClado<charType>* RevBayesCore::PhyloCTMCClado<charType>::
     return new PhyloCTMCClado<charType>( *this );
 }
 
+/**
+ * We do not provide analytic gradients for this model (see computeBranchTimeDerivatives).
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCClado<charType>::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    return false;
+}
+
+
+/**
+ * We do not provide the likelihoods of the regraft points for this model, because of the cladogenetic events at the nodes.
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCClado<charType>::computeRegraftLnLikelihoods(const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods)
+{
+
+    return false;
+}
+
+
+/**
+ * We do not optimize single branch lengths for this model, because of the cladogenetic events at the nodes.
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCClado<charType>::prepareBranchLengthOptimization(const TopologyNode &node)
+{
+
+    return false;
+}
+
+
+/**
+ * The pre-order traversal does not know about the cladogenetic events, so we do not support gradients for this model.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCClado<charType>::computeBranchTimeDerivatives( std::vector<std::vector<double> > &d )
+{
+
+    throw RbException("Gradients are not implemented for the phylogenetic CTMC with cladogenetic events.");
+}
+
+
 template<class charType>
 double RevBayesCore::PhyloCTMCClado<charType>::computeLnProbability( void )
 {
@@ -719,7 +768,7 @@ void RevBayesCore::PhyloCTMCClado<charType>::computeTipLikelihood(const Topology
                         const double* d  = tp_begin+(this->num_chars*c1);
                         
                         double tmp = 0.0;
-                        std::vector< double > weights = this->value->getCharacter(node_index, site).getWeights();
+                        std::vector< double > weights = this->getCharacterData().getCharacter(node_index, site).getWeights();
                         for ( size_t i=0; i<val.size(); ++i )
                         {
                             // check whether we observed this state
@@ -853,6 +902,33 @@ std::vector<charType> RevBayesCore::PhyloCTMCClado<charType>::drawAncestralState
 }
 
 
+/**
+ * Draw the ancestral states as state indices.
+ * The start states of the branches differ from the end states of the parents because of the cladogenetic events,
+ * so we draw the character states and convert them.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCClado<charType>::drawJointConditionalAncestralStateIndices(std::vector<size_t>& startStates, std::vector<size_t>& endStates)
+{
+
+    std::vector<std::vector<charType> > start_chars(this->num_nodes, std::vector<charType>(this->num_sites, this->template_state));
+    std::vector<std::vector<charType> > end_chars(this->num_nodes, std::vector<charType>(this->num_sites, this->template_state));
+    drawJointConditionalAncestralStates( start_chars, end_chars );
+
+    startStates.resize( this->num_nodes * this->num_sites );
+    endStates.resize( this->num_nodes * this->num_sites );
+    for (size_t n = 0; n < this->num_nodes; ++n)
+    {
+        for (size_t i = 0; i < this->num_sites; ++i)
+        {
+            startStates[n*this->num_sites + i] = start_chars[n][i].getStateIndex();
+            endStates[n*this->num_sites + i]   = end_chars[n][i].getStateIndex();
+        }
+    }
+
+}
+
+
 /**
  * Draw a vector of ancestral states from the joint-conditional distribution of states.
  */
@@ -1712,7 +1788,7 @@ void RevBayesCore::PhyloCTMCClado<charType>::redrawValue( void )
             std::vector<bool> taxon_mask = std::vector<bool>(this->num_sites,false);
             
             const std::string &taxon_name = this->tau->getValue().getNode( i ).getName();
-            AbstractDiscreteTaxonData& taxon = this->value->getTaxonData( taxon_name );
+            const AbstractDiscreteTaxonData& taxon = this->getCharacterData().getTaxonData( taxon_name );
             
             for ( size_t site=0; site<this->num_sites; ++site)
             {
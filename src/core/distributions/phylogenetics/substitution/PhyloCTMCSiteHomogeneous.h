@@ -86,55 +86,59 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( si
     // we need this vector to sum over the different mixture likelihoods
     std::vector<double> per_mixture_Likelihoods = std::vector<double>(this->num_patterns,0.0);
 
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
-
     // get the root frequencies
     std::vector<std::vector<double> >   ff;
     this->getRootFrequencies(ff);
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // the patterns are independent, so we can compute blocks of patterns in parallel
+    this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
     {
-        // get the root frequencies
-        const std::vector<double> &f                    = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        // get pointers the likelihood for both subtrees
+              double*   p_mixture          = p + first_pattern*this->siteOffset;
+        const double*   p_mixture_left     = p_left + first_pattern*this->siteOffset;
+        const double*   p_mixture_right    = p_right + first_pattern*this->siteOffset;
+
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j             = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
+            // get the root frequencies
+            const std::vector<double> &f                    = ff[mixture % ff.size()];
+            std::vector<double>::const_iterator f_end       = f.end();
+            std::vector<double>::const_iterator f_begin     = f.begin();
+
+            // get pointers to the likelihood for this mixture category
+                  double*   p_site_mixture          = p_mixture;
+            const double*   p_site_mixture_left     = p_mixture_left;
+            const double*   p_site_mixture_right    = p_mixture_right;
+            // iterate over all sites
+            for (size_t site = first_pattern; site < last_pattern; ++site)
             {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *f_j;
+                // get the pointer to the stationary frequencies
+                std::vector<double>::const_iterator f_j             = f_begin;
+                // get the pointers to the likelihoods for this site and mixture category
+                      double* p_site_j        = p_site_mixture;
+                const double* p_site_left_j   = p_site_mixture_left;
+                const double* p_site_right_j  = p_site_mixture_right;
+                // iterate over all starting states
+                for (; f_j != f_end; ++f_j)
+                {
+                    // add the probability of starting from this state
+                    *p_site_j = *p_site_left_j * *p_site_right_j * *f_j;
 
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j;
-            }
+                    // increment pointers
+                    ++p_site_j; ++p_site_left_j; ++p_site_right_j;
+                }
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
+                // increment the pointers to the next site
+                p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
+            } // end-for over all sites (=patterns)
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset;
+            // increment the pointers to the next mixture category
+            p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset;
 
-    } // end-for over all mixtures (=rate categories)
+        } // end-for over all mixtures (=rate categories)
+    });
 
 
 }
@@ -150,62 +154,66 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( si
     const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right]  * this->activeLikelihoodOffset + right  * this->nodeOffset;
     const double* p_middle = this->partialLikelihoods + this->activeLikelihood[middle] * this->activeLikelihoodOffset + middle * this->nodeOffset;
 
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
-    const double*   p_mixture_middle   = p_middle;
-
     // get the root frequencies
     std::vector<std::vector<double> >   ff;
     this->getRootFrequencies(ff);
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // the patterns are independent, so we can compute blocks of patterns in parallel
+    this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
     {
-        
-        // get the root frequencies
-        const std::vector<double> &f                    = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        const double*   p_site_mixture_middle   = p_mixture_middle;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        // get pointers the likelihood for both subtrees
+              double*   p_mixture          = p + first_pattern*this->siteOffset;
+        const double*   p_mixture_left     = p_left + first_pattern*this->siteOffset;
+        const double*   p_mixture_right    = p_right + first_pattern*this->siteOffset;
+        const double*   p_mixture_middle   = p_middle + first_pattern*this->siteOffset;
+
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
-
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            const double* p_site_middle_j = p_site_mixture_middle;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
+        
+            // get the root frequencies
+            const std::vector<double> &f                    = ff[mixture % ff.size()];
+            std::vector<double>::const_iterator f_end       = f.end();
+            std::vector<double>::const_iterator f_begin     = f.begin();
+
+            // get pointers to the likelihood for this mixture category
+                  double*   p_site_mixture          = p_mixture;
+            const double*   p_site_mixture_left     = p_mixture_left;
+            const double*   p_site_mixture_right    = p_mixture_right;
+            const double*   p_site_mixture_middle   = p_mixture_middle;
+            // iterate over all sites
+            for (size_t site = first_pattern; site < last_pattern; ++site)
             {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *p_site_middle_j * *f_j;
 
-                assert(0.0 <= *p_site_j and *p_site_j <= 1.00000000001);
+                // get the pointer to the stationary frequencies
+                std::vector<double>::const_iterator f_j = f_begin;
+                // get the pointers to the likelihoods for this site and mixture category
+                      double* p_site_j        = p_site_mixture;
+                const double* p_site_left_j   = p_site_mixture_left;
+                const double* p_site_right_j  = p_site_mixture_right;
+                const double* p_site_middle_j = p_site_mixture_middle;
+                // iterate over all starting states
+                for (; f_j != f_end; ++f_j)
+                {
+                    // add the probability of starting from this state
+                    *p_site_j = *p_site_left_j * *p_site_right_j * *p_site_middle_j * *f_j;
+
+                    assert(0.0 <= *p_site_j and *p_site_j <= 1.00000000001);
 
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j; ++p_site_middle_j;
-            }
+                    // increment pointers
+                    ++p_site_j; ++p_site_left_j; ++p_site_right_j; ++p_site_middle_j;
+                }
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
+                // increment the pointers to the next site
+                p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
+            } // end-for over all sites (=patterns)
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset; p_mixture_middle+=this->mixtureOffset;
+            // increment the pointers to the next mixture category
+            p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset; p_mixture_middle+=this->mixtureOffset;
 
-    } // end-for over all mixtures (=rate categories)
+        } // end-for over all mixtures (=rate categories)
+    });
 
 }
 
@@ -222,52 +230,56 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
     const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
     double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // the patterns are independent, so we can compute blocks of patterns in parallel
+    this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
     {
-        // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
-
-        // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
-
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+            // the transition probability matrix for this mixture category
+            const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+
+            // get the pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + first_pattern*this->siteOffset;
+            double*          p_site_mixture          = p_node + offset;
+            const double*    p_site_mixture_left     = p_left + offset;
+            const double*    p_site_mixture_right    = p_right + offset;
+            // compute the per site probabilities
+            for (size_t site = first_pattern; site < last_pattern; ++site)
             {
-                // temporary variable
-                double sum = 0.0;
 
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                // get the pointers for this mixture category and this site
+                const double*       tp_a    = tp_begin;
+                // iterate over the possible starting states
+                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
                 {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_right[c2] * tp_a[c2];
+                    // temporary variable
+                    double sum = 0.0;
+
+                    // iterate over all possible terminal states
+                    for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                    {
+                        sum += p_site_mixture_left[c2] * p_site_mixture_right[c2] * tp_a[c2];
 
-                } // end-for over all distination character
+                    } // end-for over all distination character
 
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
+                    // store the likelihood for this starting state
+                    p_site_mixture[c1] = sum;
                 
-                assert(0.0 <= sum and sum <= 1.00000000001);
+                    assert(0.0 <= sum and sum <= 1.00000000001);
 
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
+                    // increment the pointers to the next starting state
+                    tp_a+=this->num_chars;
 
-            } // end-for over all initial characters
+                } // end-for over all initial characters
 
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
+                // increment the pointers to the next site
+                p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
+            } // end-for over all sites (=patterns)
 
-    } // end-for over all mixtures (=rate-categories)
+        } // end-for over all mixtures (=rate-categories)
+    });
 
 }
 
@@ -285,53 +297,57 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
     const double*   p_right     = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
     double*         p_node      = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
 
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // the patterns are independent, so we can compute blocks of patterns in parallel
+    this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
     {
-        // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
-
-        // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_middle   = p_middle + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
-
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+            // the transition probability matrix for this mixture category
+            const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+
+            // get the pointers to the likelihood for this mixture category
+            size_t offset = mixture*this->mixtureOffset + first_pattern*this->siteOffset;
+            double*          p_site_mixture          = p_node + offset;
+            const double*    p_site_mixture_left     = p_left + offset;
+            const double*    p_site_mixture_middle   = p_middle + offset;
+            const double*    p_site_mixture_right    = p_right + offset;
+            // compute the per site probabilities
+            for (size_t site = first_pattern; site < last_pattern; ++site)
             {
-                // temporary variable
-                double sum = 0.0;
 
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                // get the pointers for this mixture category and this site
+                const double*       tp_a    = tp_begin;
+                // iterate over the possible starting states
+                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
                 {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_middle[c2] * p_site_mixture_right[c2] * tp_a[c2];
+                    // temporary variable
+                    double sum = 0.0;
 
-                } // end-for over all distination character
+                    // iterate over all possible terminal states
+                    for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
+                    {
+                        sum += p_site_mixture_left[c2] * p_site_mixture_middle[c2] * p_site_mixture_right[c2] * tp_a[c2];
+
+                    } // end-for over all distination character
                 
-                assert(0 <= sum and sum <= 1.00000000001);
+                    assert(0 <= sum and sum <= 1.00000000001);
 
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
+                    // store the likelihood for this starting state
+                    p_site_mixture[c1] = sum;
 
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
+                    // increment the pointers to the next starting state
+                    tp_a+=this->num_chars;
 
-            } // end-for over all initial characters
+                } // end-for over all initial characters
 
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
+                // increment the pointers to the next site
+                p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
 
-        } // end-for over all sites (=patterns)
+            } // end-for over all sites (=patterns)
 
-    } // end-for over all mixtures (=rate-categories)
+        } // end-for over all mixtures (=rate-categories)
+    });
 
 }
 
@@ -358,122 +374,126 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(cons
     // compute the transition probabilities
     this->updateTransitionProbabilities( node_index );
 
-    double* p_mixture = p_node;
-
-    // iterate over all mixture categories
-    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    // the patterns are independent, so we can compute blocks of patterns in parallel
+    this->computeForPatternBlocks( [&](size_t first_pattern, size_t last_pattern)
     {
-        // the transition probability matrix for this mixture category
-        const double* tp_begin = this->transition_prob_matrices[mixture].theMatrix;
-
-        // get the pointer to the likelihoods for this site and mixture category
-        double* p_site_mixture = p_mixture;
+        double* p_mixture = p_node + first_pattern*this->siteOffset;
 
-        // iterate over all sites
-        for (size_t site = 0; site != this->pattern_block_size; ++site)
+        // iterate over all mixture categories
+        for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
         {
+            // the transition probability matrix for this mixture category
+            const double* tp_begin = this->transition_prob_matrices[mixture].theMatrix;
 
-            // is this site a gap?
-            if ( gap_node[site] )
+            // get the pointer to the likelihoods for this site and mixture category
+            double* p_site_mixture = p_mixture;
+
+            // iterate over all sites
+            for (size_t site = first_pattern; site < last_pattern; ++site)
             {
-                // since this is a gap we need to assume that the actual state could have been any state
 
-                // iterate over all initial states for the transitions
-                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+                // is this site a gap?
+                if ( gap_node[site] )
                 {
+                    // since this is a gap we need to assume that the actual state could have been any state
 
-                    // store the likelihood
-                    p_site_mixture[c1] = 1.0;
+                    // iterate over all initial states for the transitions
+                    for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+                    {
 
-                }
-            }
-            else // we have observed a character
-            {
+                        // store the likelihood
+                        p_site_mixture[c1] = 1.0;
 
-                // iterate over all possible initial states
-                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+                    }
+                }
+                else // we have observed a character
                 {
 
-                    if ( this->using_ambiguous_characters == true && this->using_weighted_characters == false)
+                    // iterate over all possible initial states
+                    for (size_t c1 = 0; c1 < this->num_chars; ++c1)
                     {
-                        // compute the likelihood that we had a transition from state c1 to the observed state org_val
-                        // note, the observed state could be ambiguous!
-                        const RbBitSet &val = amb_char_node[site];
-
-                        // get the pointer to the transition probabilities for the terminal states
-                        const double* d  = tp_begin+(this->num_chars*c1);
-
-                        double tmp = 0.0;
 
-                        for ( size_t i=0; i<this->num_chars; ++i )
+                        if ( this->using_ambiguous_characters == true && this->using_weighted_characters == false)
                         {
-                            // check whether we observed this state
-                            if ( val.isSet(i) == true )
-                            {
-                                // add the probability
-                                tmp += *d;
-                            }
+                            // compute the likelihood that we had a transition from state c1 to the observed state org_val
+                            // note, the observed state could be ambiguous!
+                            const RbBitSet &val = amb_char_node[site];
 
-                            // increment the pointer to the next transition probability
-                            ++d;
-                        } // end-while over all observed states for this character
+                            // get the pointer to the transition probabilities for the terminal states
+                            const double* d  = tp_begin+(this->num_chars*c1);
 
-                        // store the likelihood
-                        p_site_mixture[c1] = tmp;
+                            double tmp = 0.0;
+
+                            for ( size_t i=0; i<this->num_chars; ++i )
+                            {
+                                // check whether we observed this state
+                                if ( val.isSet(i) == true )
+                                {
+                                    // add the probability
+                                    tmp += *d;
+                                }
+
+                                // increment the pointer to the next transition probability
+                                ++d;
+                            } // end-while over all observed states for this character
+
+                            // store the likelihood
+                            p_site_mixture[c1] = tmp;
                         
-                    }
-                    else if ( this->using_weighted_characters == true )
-                    {
-                        // compute the likelihood that we had a transition from state c1 to the observed state org_val
-                        // note, the observed state could be ambiguous!
-//                        const RbBitSet &val = amb_char_node[site];
-                        size_t this_site_index = site_indices[site];
-                        const RbBitSet &val = this->value->getCharacter(char_data_node_index, this_site_index).getState();
-
-                        // get the pointer to the transition probabilities for the terminal states
-                        const double* d = tp_begin+(this->num_chars*c1);
-
-                        double tmp = 0.0;
-                        const std::vector< double >& weights = this->value->getCharacter(char_data_node_index, this_site_index).getWeights();
-                        for ( size_t i=0; i<this->num_chars; ++i )
+                        }
+                        else if ( this->using_weighted_characters == true )
                         {
-                            // check whether we observed this state
-                            if ( val.isSet(i) == true )
+                            // compute the likelihood that we had a transition from state c1 to the observed state org_val
+                            // note, the observed state could be ambiguous!
+    //                        const RbBitSet &val = amb_char_node[site];
+                            size_t this_site_index = site_indices[site];
+                            const RbBitSet &val = this->getCharacterData().getCharacter(char_data_node_index, this_site_index).getState();
+
+                            // get the pointer to the transition probabilities for the terminal states
+                            const double* d = tp_begin+(this->num_chars*c1);
+
+                            double tmp = 0.0;
+                            const std::vector< double >& weights = this->getCharacterData().getCharacter(char_data_node_index, this_site_index).getWeights();
+                            for ( size_t i=0; i<this->num_chars; ++i )
                             {
-                                // add the probability
-                                tmp += *d * weights[i] ;
-                            }
-
-                            // increment the pointer to the next transition probability
-                            ++d;
-                        } // end-while over all observed states for this character
-
-                        // store the likelihood
-                        p_site_mixture[c1] = tmp;
+                                // check whether we observed this state
+                                if ( val.isSet(i) == true )
+                                {
+                                    // add the probability
+                                    tmp += *d * weights[i] ;
+                                }
+
+                                // increment the pointer to the next transition probability
+                                ++d;
+                            } // end-while over all observed states for this character
+
+                            // store the likelihood
+                            p_site_mixture[c1] = tmp;
                         
-                    }
-                    else // no ambiguous characters in use
-                    {
-                        unsigned long org_val = char_node[site];
+                        }
+                        else // no ambiguous characters in use
+                        {
+                            unsigned long org_val = char_node[site];
 
-                        // store the likelihood
-                        p_site_mixture[c1] = tp_begin[c1*this->num_chars+org_val];
+                            // store the likelihood
+                            p_site_mixture[c1] = tp_begin[c1*this->num_chars+org_val];
 
-                    }
+                        }
 
-                } // end-for over all possible initial character for the branch
+                    } // end-for over all possible initial character for the branch
 
-            } // end-if a gap state
+                } // end-if a gap state
 
-            // increment the pointers to next site
-            p_site_mixture+=this->siteOffset;
+                // increment the pointers to next site
+                p_site_mixture+=this->siteOffset;
 
-        } // end-for over all sites/patterns in the sequence
+            } // end-for over all sites/patterns in the sequence
 
-        // increment the pointers to next mixture category
-        p_mixture+=this->mixtureOffset;
+            // increment the pointers to next mixture category
+            p_mixture+=this->mixtureOffset;
 
-    } // end-for over all mixture categories
+        } // end-for over all mixture categories
+    });
 
 }
 
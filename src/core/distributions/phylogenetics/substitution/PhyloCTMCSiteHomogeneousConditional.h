@@ -30,9 +30,13 @@ namespace RevBayesCore {
         PhyloCTMCSiteHomogeneousConditional*                clone(void) const;                                                                        //!< Create an independent clone
         void                                                setValue(AbstractHomologousDiscreteCharacterData *v, bool f=false);
         virtual void                                        redrawValue(void);
+        virtual bool                                        computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g);
+        virtual bool                                        computeRegraftLnLikelihoods(const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods);
+        virtual bool                                        prepareBranchLengthOptimization(const TopologyNode &node);
 
     protected:
 
+        virtual void                                        computeBranchTimeDerivatives(std::vector<std::vector<double> > &d);
         virtual void                                        computeRootLikelihood(size_t root, size_t l, size_t r);
         virtual void                                        computeRootLikelihood(size_t root, size_t l, size_t r, size_t m);
         virtual void                                        computeInternalNodeLikelihood(const TopologyNode &n, size_t nIdx, size_t l, size_t r);
@@ -207,8 +211,8 @@ std::vector<size_t> RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>:
         {
             if ( (*it)->isTip() )
             {
-                AbstractDiscreteTaxonData& taxon = this->value->getTaxonData( (*it)->getName() );
-                DiscreteCharacterState &c = taxon.getCharacter(siteIndex);
+                const AbstractDiscreteTaxonData& taxon = this->getCharacterData().getTaxonData( (*it)->getName() );
+                const DiscreteCharacterState &c = taxon.getCharacter(siteIndex);
 
                 bool gap = c.isGapState();
                 // if we treat unknown characters as gaps and this is an unknown character then we change it
@@ -295,8 +299,7 @@ std::vector<size_t> RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>:
 
         // resize our datset to account for the newly excluded characters
         this->num_sites = siteIndices.size();
-        this->site_pattern.clear();
-        this->site_pattern.resize(this->num_sites);
+        this->site_pattern = std::vector<size_t>(this->num_sites, 0);
     }
 
     // readjust the number of correction sites to account for masked sites
@@ -403,6 +406,50 @@ bool RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::isSitePatternC
 }
 
 
+/**
+ * We do not provide analytic gradients for this model (see computeBranchTimeDerivatives).
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::computeLnProbabilityGradient(const DagNode *p, std::vector<double> &g)
+{
+
+    return false;
+}
+
+
+/**
+ * We do not provide the likelihoods of the regraft points for this model, because the coding correction also depends on the topology.
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::computeRegraftLnLikelihoods(const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods)
+{
+
+    return false;
+}
+
+
+/**
+ * We do not optimize single branch lengths for this model, because the coding correction also depends on the branch lengths.
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::prepareBranchLengthOptimization(const TopologyNode &node)
+{
+
+    return false;
+}
+
+
+/**
+ * The gradient would need the derivative of the coding correction as well, which we do not compute yet.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::computeBranchTimeDerivatives( std::vector<std::vector<double> > &d )
+{
+
+    throw RbException("Gradients are not implemented for the phylogenetic CTMC conditioned on the coding of the characters.");
+}
+
+
 template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneousConditional<charType>::computeRootLikelihood( size_t root, size_t left, size_t right)
 {
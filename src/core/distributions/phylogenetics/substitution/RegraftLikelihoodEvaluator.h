@@ -0,0 +1,37 @@
+#ifndef RegraftLikelihoodEvaluator_H
+#define RegraftLikelihoodEvaluator_H
+
+#include <vector>
+
+namespace RevBayesCore {
+
+    class TopologyNode;
+
+    /**
+     * @brief Interface for likelihoods that can evaluate all regraft points of a pruned subtree at once.
+     *
+     * Tree proposals that prune a subtree and consider every possible re-attachment point (e.g., the Gibbs prune-and-regraft proposal)
+     * would otherwise need to regraft, touch and recompute the likelihood for each candidate.
+     * A likelihood implementing this interface computes the ln likelihood for all candidates from one pass of partial likelihoods
+     * through the tree without the pruned subtree.
+     *
+     * The pruned subtree is the subtree below 'pruned'. The parent of 'pruned' keeps its age and is attached to the branch above each
+     * candidate node, i.e., the candidate becomes the sibling of 'pruned'. The current sibling of 'pruned' is a valid candidate
+     * and gives the current tree. The tree itself is not changed.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class RegraftLikelihoodEvaluator {
+
+    public:
+        virtual                                    ~RegraftLikelihoodEvaluator(void) {}
+
+        virtual bool                                computeRegraftLnLikelihoods(const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods) = 0;    //!< The ln likelihood for each candidate (false if not available for this model)
+
+    };
+
+}
+
+#endif
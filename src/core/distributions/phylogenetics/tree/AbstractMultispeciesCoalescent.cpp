@@ -15,6 +15,7 @@
 #include "RbMathCombinatorialFunctions.h"
 #include "TopologyNode.h"
 #include "RbException.h"
+#include "StochasticNode.h"
 #include "Taxon.h"
 #include "Tree.h"
 #include "TypedDagNode.h"
@@ -28,7 +29,8 @@ AbstractMultispeciesCoalescent::AbstractMultispeciesCoalescent(const TypedDagNod
     taxa(t),
     species_tree( sp ),
     num_taxa( taxa.size() ),
-    log_tree_topology_prob (0.0)
+    log_tree_topology_prob (0.0),
+    gene_tree_dirty( true )
 {
     // add the parameters to our set (in the base class)
     // in that way other class can easily access the set of our parameters
@@ -129,17 +131,170 @@ void AbstractMultispeciesCoalescent::buildRandomBinaryTree(std::vector<TopologyN
 }
 
 
-double AbstractMultispeciesCoalescent::computeLnProbability( void )
+/**
+ * Map the gene lineages through the species tree branch above the species node n.
+ * The lineages entering the branch are the gene tree tips of the species or the lineages leaving the child branches.
+ * We then coalesce the lineages in the order of the coalescent events until the next event is older than the branch.
+ */
+void AbstractMultispeciesCoalescent::computeBranchStatistics( const TopologyNode &species_node )
 {
-    resetTipAllocations();
     
-    // variable declarations and initialization
-    double ln_prob_coal = 0;
+    size_t index = species_node.getIndex();
+    
+    // store the statistics, in case the change gets rejected
+    if ( branch_statistics_stored[index] == false )
+    {
+        stored_branch_statistics[index] = branch_statistics[index];
+        branch_statistics_stored[index] = true;
+        stored_branches.push_back( index );
+    }
+    
+    BranchStatistics &stats = branch_statistics[index];
+    stats.age           = species_node.getAge();
+    stats.parent        = ( species_node.isRoot() == true ? -1 : long(species_node.getParent().getIndex()) );
+    stats.parent_age    = ( species_node.isRoot() == true ? RbConstants::Double::inf : species_node.getParent().getAge() );
+    stats.valid         = true;
+    stats.coalescent_times.clear();
+    stats.outgoing_lineages.clear();
+    
+    // collect the incoming lineages
+    if ( species_node.isTip() == true )
+    {
+        lineages.assign( individuals_per_branch[index].begin(), individuals_per_branch[index].end() );
+    }
+    else
+    {
+        lineages.clear();
+        for (size_t i=0; i<species_node.getNumberOfChildren(); ++i)
+        {
+            const std::vector<size_t> &child_lineages = branch_statistics[ species_node.getChild(i).getIndex() ].outgoing_lineages;
+            lineages.insert( lineages.end(), child_lineages.begin(), child_lineages.end() );
+        }
+    }
+    stats.num_lineages = lineages.size();
+    
+    // get all coalescent events among the individuals
+    coalescent_events.clear();
+    for (size_t i=0; i<lineages.size(); ++i)
+    {
+        in_branch[ lineages[i] ] = true;
+        const TopologyNode &ind = value->getNode( lineages[i] );
+        if ( ind.isRoot() == false )
+        {
+            const TopologyNode &parent = ind.getParent();
+            coalescent_events[ parent.getAge() ] = parent.getIndex();
+        }
+    }
+    
+    while ( coalescent_events.empty() == false && coalescent_events.begin()->first < stats.parent_age )
+    {
+        //Coalescence in the species tree branch
+        const TopologyNode &parent = value->getNode( coalescent_events.begin()->second );
+        
+        // get the left and right child of the parent
+        size_t left  = parent.getChild( 0 ).getIndex();
+        size_t right = parent.getChild( 1 ).getIndex();
+        if ( in_branch[left] == false || in_branch[right] == false )
+        {
+            // one of the children does not belong to this species tree branch
+            stats.valid = false;
+            break;
+        }
+        
+        //We remove the coalescent event and the coalesced lineages
+        coalescent_events.erase( coalescent_events.begin() );
+        in_branch[left]  = false;
+        in_branch[right] = false;
+        
+        //We insert the parent in the vector of lineages in this branch
+        in_branch[ parent.getIndex() ] = true;
+        lineages.push_back( parent.getIndex() );
+        if ( parent.isRoot() == false )
+        {
+            const TopologyNode &grand_parent = parent.getParent();
+            coalescent_events[ grand_parent.getAge() ] = grand_parent.getIndex();
+        }
+        
+        stats.coalescent_times.push_back( parent.getAge() );
+        
+    }
+    
+    // the remaining lineages go into the next species
+    for (size_t i=0; i<lineages.size(); ++i)
+    {
+        if ( in_branch[ lineages[i] ] == true )
+        {
+            stats.outgoing_lineages.push_back( lineages[i] );
+            in_branch[ lineages[i] ] = false;
+        }
+    }
+    
+}
+
+
+/**
+ * Compute the probability of the gene tree from the statistics of the species tree branches.
+ * We first update the statistics of the branches that changed since the last computation.
+ */
+double AbstractMultispeciesCoalescent::computeLnProbability( void )
+{
     
     const Tree &sp = species_tree->getValue();
+    const std::vector<TopologyNode*> &species_nodes = sp.getNodes();
+    size_t num_species_nodes = species_nodes.size();
+    
+    bool all = gene_tree_dirty;
+    if ( branch_statistics.size() != num_species_nodes )
+    {
+        branch_statistics.resize( num_species_nodes );
+        stored_branch_statistics.resize( num_species_nodes );
+        branch_statistics_stored.assign( num_species_nodes, false );
+        stored_branches.clear();
+        all = true;
+    }
+    
+    // a branch changed if its age or its parent changed, or its parent's age, which is the end of the branch
+    species_node_dirty.assign( num_species_nodes, false );
+    for (size_t i=0; i<num_species_nodes && all == false; ++i)
+    {
+        const TopologyNode &n = *species_nodes[i];
+        const BranchStatistics &stats = branch_statistics[ n.getIndex() ];
+        long parent = ( n.isRoot() == true ? -1 : long(n.getParent().getIndex()) );
+        if ( parent != stats.parent )
+        {
+            // the species tree topology changed, which may also change the species of the tips
+            all = true;
+        }
+        else if ( stats.age != n.getAge() || ( parent >= 0 && stats.parent_age != n.getParent().getAge() ) )
+        {
+            species_node_dirty[ n.getIndex() ] = true;
+        }
+    }
+    
+    if ( all == true )
+    {
+        resetTipAllocations();
+    }
+    in_branch.assign( value->getNumberOfNodes(), false );
     
-    ln_prob_coal = recursivelyComputeLnProbability( sp.getRoot() );
+    recursivelyUpdateBranchStatistics( sp.getRoot(), all );
+    gene_tree_dirty = false;
     
+    // the probability is the product over the species tree branches
+    double ln_prob_coal = 0.0;
+    for (size_t i=0; i<num_species_nodes; ++i)
+    {
+        const TopologyNode &n = *species_nodes[i];
+        const BranchStatistics &stats = branch_statistics[ n.getIndex() ];
+        if ( stats.valid == false )
+        {
+            return RbConstants::Double::neginf;
+        }
+        if ( stats.num_lineages > 1 )
+        {
+            ln_prob_coal += computeLnCoalescentProbability(stats.num_lineages, stats.coalescent_times, stats.age, stats.parent_age, n.getIndex(), n.isRoot() == false);
+        }
+    }
     
     return ln_prob_coal; // + logTreeTopologyProb;
     
@@ -153,114 +308,46 @@ double AbstractMultispeciesCoalescent::drawNe( size_t index )
 }
 
 
-double AbstractMultispeciesCoalescent::recursivelyComputeLnProbability( const RevBayesCore::TopologyNode &species_node )
+/**
+ * Keep the recomputed statistics.
+ */
+void AbstractMultispeciesCoalescent::keepSpecialization( DagNode *affecter )
 {
-
-    double ln_prob_coal = 0;
-
-    if ( species_node.isTip() == false )
-    {
-        individuals_per_branch[ species_node.getIndex() ].clear();
-        
-        for (size_t i=0; i<species_node.getNumberOfChildren(); ++i)
-        {
-            ln_prob_coal += recursivelyComputeLnProbability( species_node.getChild(i) );
-        }
-    }
-    
-//    const TopologyNode *species_parent_node = NULL;
-    double species_age = species_node.getAge();
-    double parent_species_age = RbConstants::Double::inf;
     
-    //        double branchLength = RbConstants::Double::inf;
-    if ( species_node.isRoot() == false )
+    for (size_t i=0; i<stored_branches.size(); ++i)
     {
-        const TopologyNode &species_parent_node = species_node.getParent();
-        parent_species_age = species_parent_node.getAge();
+        branch_statistics_stored[ stored_branches[i] ] = false;
     }
+    stored_branches.clear();
     
-    // create a local copy of the individuals per branch
-    const std::set<const TopologyNode*> &initial_individuals = individuals_per_branch[species_node.getIndex()];
-    std::set<const TopologyNode*> remaining_individuals = initial_individuals;
+}
 
-    // get all coalescent events among the individuals
-    std::vector<double> coal_times;
-    
+
+/**
+ * Recompute the statistics of the branches below and including the species node n that changed.
+ * A branch also needs to be recomputed if one of its child branches was recomputed,
+ * because the lineages entering the branch might have changed.
+ *
+ * \return True if the branch of n was recomputed.
+ */
+bool AbstractMultispeciesCoalescent::recursivelyUpdateBranchStatistics( const TopologyNode &species_node, bool all )
+{
     
-    std::map<double, const TopologyNode *> coal_times_2_nodes;
-    for ( std::set<const TopologyNode*>::iterator it = remaining_individuals.begin(); it != remaining_individuals.end(); ++it)
+    bool recompute = ( all == true || species_node_dirty[ species_node.getIndex() ] == true );
+    for (size_t i=0; i<species_node.getNumberOfChildren(); ++i)
     {
-        const TopologyNode *ind = (*it);
-        if ( ind->isRoot() == false )
+        if ( recursivelyUpdateBranchStatistics( species_node.getChild(i), all ) == true )
         {
-            const TopologyNode &parent = ind->getParent();
-            double parent_age = parent.getAge();
-            coal_times_2_nodes[ parent_age ] = &parent;
+            recompute = true;
         }
     }
     
-    double current_time = species_age;
-    while ( current_time < parent_species_age && coal_times_2_nodes.size() > 0 )
+    if ( recompute == true )
     {
-        
-        const TopologyNode *parent = coal_times_2_nodes.begin()->second;
-        double parent_age = parent->getAge();
-        current_time = parent_age;
-        
-        if ( parent_age < parent_species_age )
-        { //Coalescence in the species tree branch
-            
-            // get the left and right child of the parent
-            const TopologyNode *left = &parent->getChild( 0 );
-            const TopologyNode *right = &parent->getChild( 1 );
-            if ( remaining_individuals.find( left ) == remaining_individuals.end() || remaining_individuals.find( right ) == remaining_individuals.end() )
-            {
-                // one of the children does not belong to this species tree branch
-                return RbConstants::Double::neginf;
-            }
-            
-            //We remove the coalescent event and the coalesced lineages
-            coal_times_2_nodes.erase( coal_times_2_nodes.begin() );
-            remaining_individuals.erase( remaining_individuals.find( left ) );
-            remaining_individuals.erase( remaining_individuals.find( right ) );
-            
-            //We insert the parent in the vector of lineages in this branch
-            remaining_individuals.insert( parent );
-            if ( parent->isRoot() == false )
-            {
-                const TopologyNode *grand_parent = &parent->getParent();
-                coal_times_2_nodes[ grand_parent->getAge() ] = grand_parent;
-            }
-            
-            coal_times.push_back( parent_age );
-            
-            
-        } //End if coalescence in the species tree branch
-        else
-        { //No more coalescences in this species tree branch
-            
-            // jump out of the while loop
-            //                currentTime = speciesAge;
-            break;
-        }
-        
-        
-    } // end of while loop
-    
-    if ( initial_individuals.size() > 1 )
-    {
-        ln_prob_coal += computeLnCoalescentProbability(initial_individuals.size(), coal_times, species_age, parent_species_age, species_node.getIndex(), species_node.isRoot() == false);
+        computeBranchStatistics( species_node );
     }
     
-    
-    // merge the two sets of individuals that go into the next species
-    if ( species_node.isRoot() == false )
-    {
-        std::set<const TopologyNode *> &incoming_lineages = individuals_per_branch[ species_node.getParent().getIndex() ];
-        incoming_lineages.insert( remaining_individuals.begin(), remaining_individuals.end());
-    }
-
-    return ln_prob_coal;
+    return recompute;
 }
 
 
@@ -298,7 +385,11 @@ void AbstractMultispeciesCoalescent::resetTipAllocations( void )
     }
     
     // create a map for the individuals to branches
-    individuals_per_branch = std::vector< std::set< const TopologyNode* > >(sp.getNumberOfNodes(), std::set< const TopologyNode* >() );
+    individuals_per_branch.resize( sp.getNumberOfNodes() );
+    for (size_t i=0; i<individuals_per_branch.size(); ++i)
+    {
+        individuals_per_branch[i].clear();
+    }
     for (size_t i=0; i<num_taxa; ++i)
     {
 //        const std::string &tip_name = it->getName();
@@ -307,13 +398,29 @@ void AbstractMultispeciesCoalescent::resetTipAllocations( void )
         const std::string &species_name = individual_names_2_species_names[ individual_name ];
         
         TopologyNode *species_node = species_names_2_species_nodes[species_name];
-        individuals_per_branch[ species_node->getIndex() ].insert( &n );
+        individuals_per_branch[ species_node->getIndex() ].push_back( n.getIndex() );
     }
 
     
 }
 
 
+/**
+ * Restore the statistics from before the rejected change.
+ */
+void AbstractMultispeciesCoalescent::restoreSpecialization( DagNode *restorer )
+{
+    
+    for (size_t i=0; i<stored_branches.size(); ++i)
+    {
+        std::swap( branch_statistics[ stored_branches[i] ], stored_branch_statistics[ stored_branches[i] ] );
+        branch_statistics_stored[ stored_branches[i] ] = false;
+    }
+    stored_branches.clear();
+    
+}
+
+
 /**
  * Set the current value.
  */
@@ -324,6 +431,7 @@ void AbstractMultispeciesCoalescent::setValue(Tree *v, bool f )
     TypedDistribution<Tree>::setValue(v, f);
     
     resetTipAllocations();
+    gene_tree_dirty = true;
     
 }
 
@@ -478,6 +586,7 @@ void AbstractMultispeciesCoalescent::simulateTree( void )
     value = psi;
     
     resetTipAllocations();
+    gene_tree_dirty = true;
 }
 
 
@@ -491,3 +600,19 @@ void AbstractMultispeciesCoalescent::swapParameterInternal(const DagNode *oldP,
     }
     
 }
+
+
+/**
+ * Touch the distribution. Only a change of the gene tree itself requires to recompute all branches.
+ * Changes of the species tree are found by comparing the ages and parents with those used for the statistics,
+ * and changes of the population sizes don't change the statistics at all.
+ */
+void AbstractMultispeciesCoalescent::touchSpecialization( DagNode *toucher, bool touchAll )
+{
+    
+    if ( touchAll == true || toucher == dag_node )
+    {
+        gene_tree_dirty = true;
+    }
+    
+}
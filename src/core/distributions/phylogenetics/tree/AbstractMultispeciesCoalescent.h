@@ -1,6 +1,9 @@
 #ifndef AbstractMultispeciesCoalescent_H
 #define AbstractMultispeciesCoalescent_H
 
+#include <map>
+#include <vector>
+
 #include "RbVector.h"
 #include "Tree.h"
 #include "TypedDagNode.h"
@@ -10,6 +13,21 @@ namespace RevBayesCore {
     
     class Clade;
     
+    /**
+     * @brief Base class of the multispecies coalescent for one locus (gene tree) within a species tree.
+     *
+     * The probability of the gene tree is a product over the species tree branches, and the factor of a branch
+     * only depends on the number of gene lineages entering the branch and the times of the coalescent events within it.
+     * We keep these statistics (and the lineages leaving the branch) per species tree branch, so that
+     * - a change of a population size or its prior only needs a sum over the branches without traversing the gene tree,
+     * - a change of the species tree only recomputes the branches whose age, parent age or parent changed,
+     *   and the branches above them, because the lineages entering them may have changed,
+     * - only a change of the gene tree itself recomputes all branches.
+     * The recomputed statistics are stored until the change is accepted or rejected.
+     *
+     * Every locus is a stochastic node of its own, so that the loci are evaluated concurrently by the MCMC
+     * (see LnProbabilityEvaluator) once they are expensive enough.
+     */
     class AbstractMultispeciesCoalescent : public TypedDistribution<Tree> {
         
     public:
@@ -29,21 +47,47 @@ namespace RevBayesCore {
         void                                                swapParameterInternal(const DagNode *oldP, const DagNode *newP);            //!< Swap a parameter
         virtual double                                      computeLnCoalescentProbability(size_t k, const std::vector<double> &t, double a, double b, size_t index, bool f) = 0;
         virtual double                                      drawNe(size_t index);
+        void                                                keepSpecialization(DagNode* affecter);
+        void                                                restoreSpecialization(DagNode *restorer);
+        void                                                touchSpecialization(DagNode *toucher, bool touchAll);
 
         // helper functions
         void                                                attachTimes(Tree *psi, std::vector<TopologyNode *> &tips, size_t index, const std::vector<double> &times);
         void                                                buildRandomBinaryTree(std::vector<TopologyNode *> &tips);
-        double                                              recursivelyComputeLnProbability(const TopologyNode &n);
+        void                                                computeBranchStatistics(const TopologyNode &n);                             //!< Map the gene lineages through the species tree branch
+        bool                                                recursivelyUpdateBranchStatistics(const TopologyNode &n, bool all);         //!< Recompute the statistics of the changed branches (returns true if n was recomputed)
         void                                                resetTipAllocations(void);
         void                                                simulateTree(void);
         
+        /**
+         * The gene lineages within one species tree branch.
+         */
+        struct BranchStatistics {
+            double                                          age;                                                                        //!< The age of the species node
+            double                                          parent_age;                                                                 //!< The age of its parent (infinite for the root)
+            long                                            parent;                                                                     //!< The index of its parent (-1 for the root)
+            size_t                                          num_lineages;                                                               //!< The number of lineages entering the branch
+            std::vector<double>                             coalescent_times;                                                           //!< The ages of the coalescent events within the branch
+            std::vector<size_t>                             outgoing_lineages;                                                          //!< The indices of the gene tree nodes leaving the branch
+            bool                                            valid;                                                                      //!< False if a coalescent event joins lineages of different branches
+        };
+        
         // members
         std::vector<Taxon>                                  taxa;
         const TypedDagNode<Tree>*                           species_tree;
         size_t                                              num_taxa;
         double                                              log_tree_topology_prob;
         
-        std::vector< std::set< const TopologyNode* > >      individuals_per_branch;
+        std::vector< std::vector<size_t> >                  individuals_per_branch;                                                     //!< The gene tree tips per species tree tip
+        std::vector<BranchStatistics>                       branch_statistics;                                                          //!< The statistics per species tree branch
+        std::vector<BranchStatistics>                       stored_branch_statistics;                                                   //!< The statistics before the current change
+        std::vector<bool>                                   branch_statistics_stored;                                                   //!< Did we store the statistics of the branch?
+        std::vector<size_t>                                 stored_branches;                                                            //!< The branches with stored statistics
+        bool                                                gene_tree_dirty;                                                            //!< Do we need to recompute all statistics?
+        std::vector<bool>                                   species_node_dirty;                                                         //!< Work space for the changed species tree nodes
+        std::vector<bool>                                   in_branch;                                                                  //!< Work space flagging the gene lineages in the current branch
+        std::vector<size_t>                                 lineages;                                                                   //!< Work space for the lineages in the current branch
+        std::map<double, size_t>                            coalescent_events;                                                          //!< Work space for the next coalescent events by age
 
     };
     
@@ -23,6 +23,7 @@
 #include "StringUtilities.h"
 #include "TimeInterval.h"
 #include "Tree.h"
+#include "TreeBipartitionIndex.h"
 #include "TreeChangeEventHandler.h"
 #include "TreeChangeEventMessage.h"
 #include "TypedDagNode.h"
@@ -193,7 +194,12 @@ TopologyConstrainedTreeDistribution* TopologyConstrainedTreeDistribution::clone(
  */
 double TopologyConstrainedTreeDistribution::computeLnProbability( void )
 {
-    recursivelyUpdateClades( value->getRoot() );
+    // the active clades are only needed for the backbone constraints,
+    // the monophyly constraints are looked up in the clade index of the tree
+    if ( num_backbones > 0 )
+    {
+        recursivelyUpdateClades( value->getRoot() );
+    }
     
     // first check if the current tree matches the clade constraints
     if ( matchesConstraints() == false )
@@ -212,6 +218,19 @@ double TopologyConstrainedTreeDistribution::computeLnProbability( void )
 }
 
 
+/**
+ * The clade index is created lazily and registers itself as a listener of the tree,
+ * which must not happen while other distributions of the tree compute their probability.
+ */
+void TopologyConstrainedTreeDistribution::prepareLnProbability( void )
+{
+    
+    value->getBipartitionIndex().update();
+    base_distribution->prepareLnProbability();
+    
+}
+
+
 void TopologyConstrainedTreeDistribution::initializeBitSets(void)
 {
     // fill the monophyly constraints bitsets
@@ -372,6 +391,8 @@ bool TopologyConstrainedTreeDistribution::matchesBackbone( void )
  */
 bool TopologyConstrainedTreeDistribution::matchesConstraints( void )
 {
+    TreeBipartitionIndex &clade_index = value->getBipartitionIndex();
+    
     for (size_t i = 0; i < monophyly_constraints.size(); i++)
     {
         
@@ -389,13 +410,15 @@ bool TopologyConstrainedTreeDistribution::matchesConstraints( void )
         for (size_t j = 0; j < constraints.size(); j++)
         {
             
-            std::vector<RbBitSet>::iterator it = std::find(active_clades.begin(), active_clades.end(), constraints[j].getBitRepresentation() );
+            // only interior non-root nodes count as clades
+            const TopologyNode *node = clade_index.getNode( constraints[j].getBitRepresentation() );
+            bool found = ( node != NULL && node->isInternal() == true && node->isRoot() == false );
             
-            if (it != active_clades.end() && constraints[j].isNegativeConstraint() == false )
+            if ( found == true && constraints[j].isNegativeConstraint() == false )
             {
                 constraint_satisfied[j] = true;
             }
-            else if (it == active_clades.end() && constraints[j].isNegativeConstraint() )
+            else if ( found == false && constraints[j].isNegativeConstraint() )
             {
                 constraint_satisfied[j] = true;
             }
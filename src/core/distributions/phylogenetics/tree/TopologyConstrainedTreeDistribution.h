@@ -39,6 +39,7 @@ namespace RevBayesCore {
         // public member functions you may want to override
         double                                              computeLnProbability(void);                                                                         //!< Compute the log-transformed probability of the current value.
         void                                                fireTreeChangeEvent(const TopologyNode &n, const unsigned& m=0);                                                 //!< The tree has changed and we want to know which part.
+        void                                                prepareLnProbability(void);                                                                         //!< Create and update the clade index of the tree in this thread
         virtual void                                        redrawValue(void);                                                                                  //!< Draw a new random value from the distribution
         void                                                setBackbone( const TypedDagNode<Tree> *backbone_one=NULL, const TypedDagNode<RbVector<Tree> > *backbone_many=NULL);
         virtual void                                        setStochasticNode(StochasticNode<Tree> *n);                                                         //!< Set the stochastic node holding this distribution
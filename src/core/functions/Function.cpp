@@ -107,6 +107,22 @@ void Function::addParameter(const DagNode *p)
 
 
 
+/**
+ * Reverse-mode differentiation: given the gradient (adjoint) of some function L with respect to our value,
+ * compute the gradient of L with respect to the parameter p, i.e., the product of the adjoint with the Jacobian of this function.
+ * The values are flattened into vectors of doubles: a real number has a single element, vectors and simplices
+ * their elements, and rate matrices their n*n rates in row-major order.
+ * If p occurs several times as a parameter, the contributions are summed.
+ *
+ * Functions implement this method to take part in automatic differentiation (see DagGradient).
+ * The base class returns false, i.e., the gradient is not available.
+ */
+bool Function::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+    return false;
+}
+
+
 /**
  * Does this method forces the DAG node to always call update even if not touched?
  */
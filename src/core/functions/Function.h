@@ -19,6 +19,7 @@ namespace RevBayesCore {
         virtual                                    ~Function(void);
                
         // public methods
+        virtual bool                                computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);  //!< Propagate the gradient with respect to the value back to the parameter p, if implemented
         bool                                        forceUpdates(void) const;                                               //!< Does this method forces the DAG node to always call update even if not touched?
         virtual void                                getAffected(RbOrderedSet<DagNode *>& affected, DagNode* affecter);          //!< get affected nodes
         const std::vector<const DagNode*>&          getParameters(void) const;                                              //!< get the parameters of the function
@@ -1,5 +1,7 @@
 #include "SumFunction.h"
 
+#include <vector>
+
 #include "RbConstIterator.h"
 #include "RbConstIteratorImpl.h"
 #include "RbVector.h"
@@ -34,6 +36,23 @@ SumFunction* SumFunction::clone( void ) const
 }
 
 
+/**
+ * The gradient of the sum with respect to each element is one.
+ */
+bool SumFunction::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    if ( p != vals || adjoint.size() != 1 )
+    {
+        return false;
+    }
+
+    g = std::vector<double>( vals->getValue().size(), adjoint[0] );
+
+    return true;
+}
+
+
 void SumFunction::update( void )
 {
     
@@ -23,6 +23,7 @@ template <class valueType> class TypedDagNode;
         
         // public member functions
         SumFunction*                                        clone(void) const;                                                          //!< Create an independent clone
+        bool                                                computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to the elements
         void                                                update(void);
         
     protected:
@@ -0,0 +1,65 @@
+#include "ArithmeticGradient.h"
+
+#include <stddef.h>
+
+using namespace RevBayesCore;
+
+
+/**
+ * Compute the gradient of an element-wise binary operation y = a op b with respect to a and/or b,
+ * given the gradient (adjoint) with respect to y.
+ * A single element is recycled for all elements of the other argument, as in a scalar times a vector.
+ * If we differentiate with respect to both arguments (e.g., x*x), the two contributions are summed.
+ *
+ * \return False if the dimensions do not match.
+ */
+bool ArithmeticGradient::computeBinaryVectorJacobianProduct(OPERATOR op, const std::vector<double> &a, const std::vector<double> &b, bool wrt_a, bool wrt_b, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    size_t n = adjoint.size();
+    if ( (a.size() != 1 && a.size() != n) || (b.size() != 1 && b.size() != n) )
+    {
+        return false;
+    }
+    if ( wrt_a == true && wrt_b == true && a.size() != b.size() )
+    {
+        return false;
+    }
+
+    g = std::vector<double>( (wrt_a == true ? a.size() : b.size()), 0.0 );
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t index_a = ( a.size() == 1 ? 0 : i );
+        size_t index_b = ( b.size() == 1 ? 0 : i );
+        double a_i = a[index_a];
+        double b_i = b[index_b];
+
+        double da = 1.0;
+        double db = 1.0;
+        if ( op == SUBTRACTION )
+        {
+            db = -1.0;
+        }
+        else if ( op == MULTIPLICATION )
+        {
+            da = b_i;
+            db = a_i;
+        }
+        else if ( op == DIVISION )
+        {
+            da = 1.0 / b_i;
+            db = -a_i / (b_i * b_i);
+        }
+
+        if ( wrt_a == true )
+        {
+            g[index_a] += adjoint[i] * da;
+        }
+        if ( wrt_b == true )
+        {
+            g[index_b] += adjoint[i] * db;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef ArithmeticGradient_H
+#define ArithmeticGradient_H
+
+#include <vector>
+
+#include "RbVector.h"
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Helper functions for the gradients of the arithmetic functions (see Function::computeVectorJacobianProduct).
+     *
+     * The arithmetic functions are templates for many value types (numbers, vectors, strings, ...).
+     * The overloaded flatten functions give the elements of real-valued arguments and return false for all other types,
+     * so that the gradient is only available for real numbers and real vectors.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    namespace ArithmeticGradient {
+
+        enum OPERATOR { ADDITION, SUBTRACTION, MULTIPLICATION, DIVISION };
+
+        template <class valueType>
+        bool                    flatten(const valueType &x, std::vector<double> &v) { return false; }                         //!< Values of other types are not differentiable
+        inline bool             flatten(const double &x, std::vector<double> &v) { v.assign(1, x); return true; }
+        inline bool             flatten(const RbVector<double> &x, std::vector<double> &v) { v = x; return true; }
+
+        bool                    computeBinaryVectorJacobianProduct(OPERATOR op, const std::vector<double> &a, const std::vector<double> &b, bool wrt_a, bool wrt_b, const std::vector<double> &adjoint, std::vector<double> &g);  //!< Gradient of the element-wise operation a op b
+
+    }
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef BinaryAddition_H
 #define BinaryAddition_H
 
+#include "ArithmeticGradient.h"
 #include "StringUtilities.h"    // For string concatenation through addition
 #include "TypedFunction.h"
 #include "TypedDagNode.h"
@@ -21,6 +22,7 @@ namespace RevBayesCore {
         BinaryAddition(const TypedDagNode<firstValueType> *a, const TypedDagNode<secondValueType> *b);
         
         BinaryAddition*                         clone(void) const;                                                  //!< Create a clon.
+        bool                                    computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to a or b
         void                                    update(void);                                                       //!< Recompute the value
         
     protected:
@@ -54,6 +56,24 @@ RevBayesCore::BinaryAddition<firstValueType, secondValueType, return_type>* RevB
 }
 
 
+/**
+ * The gradient with respect to a and/or b for real numbers and real vectors (element-wise).
+ */
+template<class firstValueType, class secondValueType, class return_type>
+bool RevBayesCore::BinaryAddition<firstValueType, secondValueType, return_type>::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    std::vector<double> a_values;
+    std::vector<double> b_values;
+    if ( (p != a && p != b) || ArithmeticGradient::flatten(a->getValue(), a_values) == false || ArithmeticGradient::flatten(b->getValue(), b_values) == false )
+    {
+        return false;
+    }
+
+    return ArithmeticGradient::computeBinaryVectorJacobianProduct(ArithmeticGradient::ADDITION, a_values, b_values, p == a, p == b, adjoint, g);
+}
+
+
 template<class firstValueType, class secondValueType, class return_type>
 void RevBayesCore::BinaryAddition<firstValueType, secondValueType, return_type>::swapParameterInternal(const DagNode *oldP, const DagNode *newP) 
 {
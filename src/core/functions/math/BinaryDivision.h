@@ -1,6 +1,7 @@
 #ifndef BinaryDivision_H
 #define BinaryDivision_H
 
+#include "ArithmeticGradient.h"
 #include "TypedFunction.h"
 #include "TypedDagNode.h"
 
@@ -20,6 +21,7 @@ namespace RevBayesCore {
         BinaryDivision(const TypedDagNode<firstValueType> *a, const TypedDagNode<secondValueType> *b);
         
         BinaryDivision*                         clone(void) const;                                                  //!< Create a clon.
+        bool                                    computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to a or b
         void                                    update(void);                                                       //!< Recompute the value
         
     protected:
@@ -48,6 +50,24 @@ RevBayesCore::BinaryDivision<firstValueType, secondValueType, return_type>* RevB
     return new BinaryDivision(*this);
 }
 
+/**
+ * The gradient with respect to a and/or b for real numbers and real vectors (element-wise).
+ */
+template<class firstValueType, class secondValueType, class return_type>
+bool RevBayesCore::BinaryDivision<firstValueType, secondValueType, return_type>::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    std::vector<double> a_values;
+    std::vector<double> b_values;
+    if ( (p != a && p != b) || ArithmeticGradient::flatten(a->getValue(), a_values) == false || ArithmeticGradient::flatten(b->getValue(), b_values) == false )
+    {
+        return false;
+    }
+
+    return ArithmeticGradient::computeBinaryVectorJacobianProduct(ArithmeticGradient::DIVISION, a_values, b_values, p == a, p == b, adjoint, g);
+}
+
+
 template<class firstValueType, class secondValueType, class return_type>
 void RevBayesCore::BinaryDivision<firstValueType, secondValueType, return_type>::swapParameterInternal(const DagNode *oldP, const DagNode *newP)
 {
@@ -28,6 +28,23 @@ ExponentialFunction* ExponentialFunction::clone( void ) const
 }
 
 
+/**
+ * The gradient with respect to x is the adjoint times e^x.
+ */
+bool ExponentialFunction::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    if ( p != a || adjoint.size() != 1 )
+    {
+        return false;
+    }
+
+    g = std::vector<double>(1, adjoint[0] * exp( a->getValue() ));
+
+    return true;
+}
+
+
 void ExponentialFunction::swapParameterInternal(const DagNode *oldP, const DagNode *newP)
 {
     
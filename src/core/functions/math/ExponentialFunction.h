@@ -21,6 +21,7 @@ template <class valueType> class TypedDagNode;
         ExponentialFunction(const TypedDagNode<double> *a);
         
         ExponentialFunction*                clone(void) const;                                                  //!< Create a clone
+        bool                                computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to x
         void                                update(void);                                                       //!< Recompute the value
         
     protected:
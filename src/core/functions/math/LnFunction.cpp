@@ -26,6 +26,23 @@ LnFunction* LnFunction::clone( void ) const
 }
 
 
+/**
+ * The gradient with respect to x is the adjoint divided by x.
+ */
+bool LnFunction::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    if ( p != a || adjoint.size() != 1 )
+    {
+        return false;
+    }
+
+    g = std::vector<double>(1, adjoint[0] / a->getValue());
+
+    return true;
+}
+
+
 void LnFunction::swapParameterInternal(const DagNode *oldP, const DagNode *newP)
 {
     if (oldP == a)
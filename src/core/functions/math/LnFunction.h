@@ -23,6 +23,7 @@ template <class valueType> class TypedDagNode;
         LnFunction(const TypedDagNode<double> *a);
         
         LnFunction*                         clone(void) const;                                                  //!< Create a clon.
+        bool                                computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to x
         void                                update(void);                                                       //!< Recompute the value
         
     protected:
@@ -29,6 +29,7 @@ namespace RevBayesCore {
         UnaryMinus(const TypedDagNode<valueType> *a);
         
         UnaryMinus*                             clone(void) const;                                                      //!< Create a clon.
+        bool                                    computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to a
         void                                    update(void);                                                           //!< Recompute the value
         
     protected:
@@ -55,6 +56,27 @@ RevBayesCore::UnaryMinus<valueType>* RevBayesCore::UnaryMinus<valueType>::clone(
     return new UnaryMinus(*this);
 }
 
+/**
+ * The gradient with respect to a is the negative adjoint (element-wise).
+ */
+template <class valueType>
+bool RevBayesCore::UnaryMinus<valueType>::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    if ( p != a )
+    {
+        return false;
+    }
+
+    g = adjoint;
+    for (size_t i = 0; i < g.size(); ++i)
+    {
+        g[i] = -g[i];
+    }
+
+    return true;
+}
+
 template <class valueType>
 void RevBayesCore::UnaryMinus<valueType>::swapParameterInternal(const DagNode *oldP, const DagNode *newP) {
     if (oldP == a) {
@@ -42,6 +42,37 @@ GtrRateMatrixFunction* GtrRateMatrixFunction::clone( void ) const
 }
 
 
+/**
+ * The gradient with respect to the exchangeability rates or the base frequencies, given the gradient
+ * with respect to the rates of the matrix. If both are the same node, the contributions are summed.
+ */
+bool GtrRateMatrixFunction::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    const RateMatrix_GTR* rm = static_cast< RateMatrix_GTR* >(value);
+    size_t n = rm->getNumberOfStates();
+    if ( (p != exchangeability_rates && p != base_frequencies) || adjoint.size() != n*n )
+    {
+        return false;
+    }
+
+    std::vector<double> er_gradient;
+    std::vector<double> f_gradient;
+    rm->computeRateGradient( exchangeability_rates->getValue(), adjoint, er_gradient, f_gradient );
+
+    g = ( p == exchangeability_rates ? er_gradient : f_gradient );
+    if ( p == exchangeability_rates && p == base_frequencies )
+    {
+        for (size_t i = 0; i < g.size(); ++i)
+        {
+            g[i] += f_gradient[i];
+        }
+    }
+
+    return true;
+}
+
+
 void GtrRateMatrixFunction::update( void )
 {
 
@@ -26,6 +26,7 @@ template <class valueType> class TypedDagNode;
         
         // public member functions
         GtrRateMatrixFunction*                              clone(void) const;                                                              //!< Create an independent clone
+        bool                                                computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to the exchangeabilities or base frequencies
         void                                                update(void);
         
     protected:
@@ -45,6 +45,40 @@ HkyRateMatrixFunction* HkyRateMatrixFunction::clone( void ) const
 }
 
 
+/**
+ * The gradient with respect to kappa or the base frequencies, given the gradient with respect to the rates of the matrix.
+ * Kappa is the exchangeability rate of the two transitions A<->G and C<->T.
+ */
+bool HkyRateMatrixFunction::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    if ( (p != kappa && p != base_frequencies) || adjoint.size() != 16 )
+    {
+        return false;
+    }
+
+    double k = kappa->getValue();
+    std::vector<double> er(6, 1.0);
+    er[1] = k;
+    er[4] = k;
+
+    std::vector<double> er_gradient;
+    std::vector<double> f_gradient;
+    static_cast< RateMatrix_HKY* >(value)->computeRateGradient( er, adjoint, er_gradient, f_gradient );
+
+    if ( p == kappa )
+    {
+        g = std::vector<double>(1, er_gradient[1] + er_gradient[4]);
+    }
+    else
+    {
+        g = f_gradient;
+    }
+
+    return true;
+}
+
+
 void HkyRateMatrixFunction::update( void )
 {
     // get the information from the arguments for reading the file
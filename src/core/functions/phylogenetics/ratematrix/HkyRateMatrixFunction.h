@@ -27,6 +27,7 @@ template <class valueType> class TypedDagNode;
         
         // public member functions
         HkyRateMatrixFunction*                              clone(void) const;                                                              //!< Create an independent clone
+        bool                                                computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to kappa or the base frequencies
         void                                                update(void);
         
     protected:
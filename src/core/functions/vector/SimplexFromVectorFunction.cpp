@@ -1,6 +1,7 @@
 #include "SimplexFromVectorFunction.h"
 
 #include <stddef.h>
+#include <vector>
 
 #include "TypedDagNode.h"
 #include "RbVector.h"
@@ -40,6 +41,36 @@ SimplexFromVectorFunction* SimplexFromVectorFunction::clone( void ) const
 }
 
 
+/**
+ * The gradient of y_i = x_i / sum(x) with respect to x_j is (delta_ij - y_i) / sum(x).
+ */
+bool SimplexFromVectorFunction::computeVectorJacobianProduct( const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g )
+{
+
+    const RbVector<double> &x = realPosVector->getValue();
+    if ( p != realPosVector || adjoint.size() != x.size() )
+    {
+        return false;
+    }
+
+    double sum = 0.0;
+    double weighted_adjoint = 0.0;
+    for ( size_t i = 0; i < x.size(); ++i )
+    {
+        sum += x[i];
+        weighted_adjoint += adjoint[i] * (*value)[i];
+    }
+
+    g.resize( x.size() );
+    for ( size_t i = 0; i < x.size(); ++i )
+    {
+        g[i] = (adjoint[i] - weighted_adjoint) / sum;
+    }
+
+    return true;
+}
+
+
 /** Compute the simplex from the vector. */
 void SimplexFromVectorFunction::update( void )
 {
@@ -24,6 +24,7 @@ template <class valueType> class TypedDagNode;
         
         // public member functions
         SimplexFromVectorFunction*                      clone(void) const;                                                      //!< Create a clone
+        bool                                            computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to the unnormalized values
         void                                            update(void);                                                           //!< Update the value of the function
         
     protected:
@@ -1,6 +1,7 @@
 #include "SimplexFunction.h"
 
 #include <stddef.h>
+#include <vector>
 
 #include "TypedDagNode.h"
 
@@ -35,6 +36,41 @@ SimplexFunction* SimplexFunction::clone( void ) const
 }
 
 
+/**
+ * The gradient of y_i = x_i / sum(x) with respect to x_j is (delta_ij - y_i) / sum(x).
+ * The same parameter can be used for several elements, e.g., v(a,a,b,a), and then we sum over these elements.
+ */
+bool SimplexFunction::computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g)
+{
+
+    if ( adjoint.size() != simplexParams.size() )
+    {
+        return false;
+    }
+
+    double sum = 0.0;
+    double weighted_adjoint = 0.0;
+    for (size_t i = 0; i < simplexParams.size(); ++i)
+    {
+        sum += simplexParams[i]->getValue();
+        weighted_adjoint += adjoint[i] * (*value)[i];
+    }
+
+    bool found = false;
+    g = std::vector<double>(1, 0.0);
+    for (size_t i = 0; i < simplexParams.size(); ++i)
+    {
+        if ( p == simplexParams[i] )
+        {
+            g[0] += (adjoint[i] - weighted_adjoint) / sum;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+
 void SimplexFunction::update( void )
 {
     
@@ -39,6 +39,7 @@ template <class valueType> class TypedDagNode;
         
         // public member functions
         SimplexFunction*                                    clone(void) const;                                                          //!< Create an independent clone
+        bool                                                computeVectorJacobianProduct(const DagNode *p, const std::vector<double> &adjoint, std::vector<double> &g);   //!< Gradient with respect to the unnormalized values
         void                                                update(void);
         
     protected:
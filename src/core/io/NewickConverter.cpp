@@ -2,7 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <sstream>
+#include <string.h>
 #include <vector>
 #include <string>
 
@@ -28,429 +28,301 @@ NewickConverter::~NewickConverter()
 Tree* NewickConverter::convertFromNewick(std::string const &n, bool reindex)
 {
 
-    // create and allocate the tree object
-    Tree *t = new Tree();
-
-    std::vector<TopologyNode*> nodes;
-    std::vector<double> brlens;
-
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
-
-    // ignore white spaces
-    std::string trimmed = "";
-    char c;
-    while ( ss.good() )
-    {
-        // check for EOF
-        int c_int = ss.get();
-        if (c_int != EOF)
-        {
-            c = char( c_int );
-            if ( c != ' ')
-            {
-                trimmed += c;
-            }
-
-        }
-
-    }
-
-    // construct the tree starting from the root
-    TopologyNode *root = createNode( trimmed, nodes, brlens );
-
-    // set up the tree
-    t->setRoot( root, reindex );
-
-    // set the branch lengths
-    for (size_t i = 0; i < nodes.size(); ++i)
-    {
-        t->getNode( nodes[i]->getIndex() ).setBranchLength( brlens[i] );
-    }
-
-    // make all internal nodes bifurcating
-    // this is important for fossil trees which have sampled ancestors
-    t->makeInternalNodesBifurcating( reindex, true );
-
-    // trees with 2-degree root nodes should not be rerooted
-    t->setRooted( root->getNumberOfChildren() == 2 );
-
-    // return the tree, the caller is responsible for destruction
-    return t;
+    return convertFromNewick( n.c_str(), n.c_str() + n.size(), reindex );
 }
 
 
+/**
+ * Convert the newick string in the range [b,e) into a tree.
+ * White spaces are ignored everywhere, also within labels, unless the label is quoted (e.g., 'Homo sapiens').
+ * We read the string from left to right: an opening parenthesis opens a new internal node,
+ * a closing parenthesis closes the last opened node, and everything else is a tip.
+ * After a node is closed (or a tip is read) follow its optional label, node comments, branch length and branch comments.
+ */
+Tree* NewickConverter::convertFromNewick(const char *b, const char *e, bool reindex)
+{
 
-TopologyNode* NewickConverter::createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens) {
-
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
-
-    char c = ' ';
-    ss.get(c);
+    current = b;
+    end     = e;
+    nodes.clear();
+    brlens.clear();
+    open_nodes.clear();
 
     // the initial character has to be '('
-    if ( c != '(')
+    if ( peek() != '(' )
     {
-        throw RbException("Error while converting Newick tree. We expected an opening parenthesis, but didn't get one. Problematic string: " + n);
+        throw RbException("Error while converting Newick tree. We expected an opening parenthesis, but didn't get one. Problematic string: " + std::string(b,e));
     }
 
-    TopologyNode *node = new TopologyNode();
-    while ( ss.good() && ss.peek() != ')' )
+    TopologyNode *root = NULL;
+    try
     {
 
-        TopologyNode *childNode;
-        if (ss.peek() == '(' )
+        while ( true )
         {
-            // we received an internal node
-            int depth = 0;
-            std::string child = "";
-            do
+
+            char c = peek();
+            if ( c == '(' )
             {
-                ss.get(c);
-                child += c;
-                if ( c == '(' )
+                // we received an internal node
+                ++current;
+                TopologyNode *node = new TopologyNode();
+                if ( root == NULL )
                 {
-                    depth++;
+                    root = node;
                 }
-                else if ( c == ')' )
+                else
                 {
-                    depth--;
+                    TopologyNode *parent = open_nodes.back();
+                    parent->addChild( node );
+                    node->setParent( parent );
                 }
-
-            } while ( ss.good() && depth > 0 );
-
-            // construct the child node
-            childNode = createNode( child, nodes, brlens );
-        }
-        else
-        {
-            // construct the node
-            childNode = new TopologyNode();
-        }
-
-        // set the parent child relationship
-        node->addChild( childNode );
-        childNode->setParent( node );
-
-        // read the optional label
-        std::string lbl = "";
-        while ( ss.good() && (c = char( ss.peek() ) ) != ':' && c != '[' && c != ';' && c != ',' && c != ')')
-        {
-            lbl += char( ss.get() );
-        }
-        childNode->setName( lbl );
-
-        // read the optional node parameters
-        if ( ss.peek() == '[' )
-        {
-
-            do
+                open_nodes.push_back( node );
+            }
+            else if ( c == ')' )
             {
+                // we finished the children of the last opened node
+                ++current;
+                TopologyNode *node = open_nodes.back();
+                open_nodes.pop_back();
 
-                ss.ignore();
-                // ignore the '&' before parameter name
-                if ( ss.peek() == '&')
+                if ( node->getNumberOfChildren() == 1 )
                 {
-                    ss.ignore();
+                    node->setSampledAncestor( true );
                 }
 
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != '=' && c != ',' && c != ']')
-                {
-                    paramName += char( ss.get() );
-                }
+                readNodeSuffix( node );
 
-                // ignore the equal sign between parameter name and value
-                if ( ss.peek() == '=')
+                if ( open_nodes.empty() == true )
                 {
-                    ss.ignore();
+                    break;
                 }
 
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != ']' && c != ',' && c != ':')
+                // skip comma
+                if ( peek() == ',' )
                 {
-                    paramValue += char( ss.get() );
-                }
-
-				if (paramName == "index")
-                {
-					// subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
-
+                    ++current;
                 }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-				}
-                else
-                {
-                    childNode->addNodeParameter(paramName, paramValue);
-                }
-
-            } while ( (c = char( ss.peek() ) ) == ',' );
-
-            // ignore the final ']'
-            if ( (c = char( ss.peek( ) ) ) == ']' )
-            {
-                ss.ignore();
             }
-
-        }
-
-        // read the optional branch length
-        if ( ss.peek() == ':' )
-        {
-            ss.ignore();
-            std::string time = "";
-            while ( ss.good() && (c = char( ss.peek( ) ) ) != ';' && c != ',' && c != ')' && c != '[' )
+            else if ( c == '\0' )
             {
-                time += char( ss.get() );
+                throw RbException("Error while converting Newick tree. We expected a closing parenthesis, but didn't get one. Problematic string: " + std::string(b,e));
             }
-
-            std::istringstream stm;
-            stm.str(time);
-            double d;
-            stm >> d;
-            nodes.push_back( childNode );
-            brlens.push_back( d );
-        }
-        else
-        {
-            nodes.push_back( childNode );
-            brlens.push_back( 0.0 );
-        }
-
-        // read the optional branch parameters
-        if ( char( ss.peek() ) == '[' )
-        {
-
-            do
+            else
             {
+                // we received a tip
+                TopologyNode *node = new TopologyNode();
+                TopologyNode *parent = open_nodes.back();
+                parent->addChild( node );
+                node->setParent( parent );
 
-                ss.ignore();
-
-                // ignore the '&' before parameter name
-                if ( char( ss.peek() ) == '&')
-                {
-                    ss.ignore();
-                }
+                readNodeSuffix( node );
 
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
+                // skip comma
+                if ( peek() == ',' )
                 {
-                    paramName += char( ss.get() );
+                    ++current;
                 }
+            }
 
-                // ignore the equal sign between parameter name and value
-                if ( char( ss.peek() ) == '=')
-                {
-                    ss.ignore();
-                }
+        }
 
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-                {
-                    paramValue += char( ss.get() );
-                }
+    }
+    catch (RbException &ex)
+    {
+        // the root owns all nodes that we created so far
+        delete root;
+        throw;
+    }
 
-                if (paramName=="index")
-                {
-                    // subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
-                }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-                }
-                else
-                {
-                    childNode->addBranchParameter(paramName, paramValue);
-                }
+    // create and allocate the tree object
+    Tree *t = new Tree();
 
+    // set up the tree
+    t->setRoot( root, reindex );
 
-            } while ( (c = char( ss.peek() )) != ']' );
+    // set the branch lengths
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        t->getNode( nodes[i]->getIndex() ).setBranchLength( brlens[i] );
+    }
 
-            ss.ignore();
+    // make all internal nodes bifurcating
+    // this is important for fossil trees which have sampled ancestors
+    t->makeInternalNodesBifurcating( reindex, true );
 
-        }
+    // trees with 2-degree root nodes should not be rerooted
+    t->setRooted( root->getNumberOfChildren() == 2 );
 
+    // return the tree, the caller is responsible for destruction
+    return t;
+}
 
-        // skip comma
-        if ( char( ss.peek() ) == ',' )
-        {
-            ss.ignore();
-        }
 
-    }
+char NewickConverter::peek( void )
+{
 
-    if (node->getNumberOfChildren() == 1)
+    // ignore white spaces
+    while ( current != end && *current == ' ' )
     {
-        node->setSampledAncestor( true );
+        ++current;
     }
 
-    // remove closing parenthesis
-    ss.ignore();
+    return ( current != end ? *current : '\0' );
+}
+
 
-    // read the optional label, checking for EOF = '\377'
-    std::string lbl = "";
-    while ( ss.good() && (c = char( ss.peek() )) != ':' && c != ';' && c != ',' && c != '[' && c != '\377')
+/**
+ * Read the optional label, node parameters, branch length and branch parameters of a node.
+ */
+void NewickConverter::readNodeSuffix(TopologyNode *node)
+{
+
+    // read the optional label
+    if ( peek() == '\'' )
+    {
+        readQuotedToken( token );
+    }
+    else
     {
-        lbl += char( ss.get() );
+        readToken( token, ":[;,)" );
     }
-    node->setName( lbl );
+    node->setName( token );
 
     // read the optional node parameters
-    if ( char( ss.peek() ) == '[' )
+    if ( peek() == '[' )
     {
+        readParameters( node, false );
+    }
 
-        do
-        {
-
-            ss.ignore();
-
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&')
-            {
-                ss.ignore();
-            }
-
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
+    // read the optional branch length
+    double d = 0.0;
+    if ( peek() == ':' )
+    {
+        ++current;
+        readToken( token, ";,)[" );
+        d = strtod( token.c_str(), NULL );
+    }
+    nodes.push_back( node );
+    brlens.push_back( d );
 
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=')
-            {
-                ss.ignore();
-            }
+    // read the optional branch parameters
+    if ( peek() == '[' )
+    {
+        readParameters( node, true );
+    }
 
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-            {
-                paramValue += char( ss.get() );
-            }
+}
 
-			if (paramName=="index")
-            {
-				// subtract by 1 to correct RevLanguage 1-based indexing
-				node->setIndex( atoi(paramValue.c_str()) - 1 );
 
-			}
-            else if (paramName=="species")
-            {
-				node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addNodeParameter(paramName, paramValue);
-            }
+/**
+ * Read the comments "[&name=value,...]" of a node or its branch.
+ */
+void NewickConverter::readParameters(TopologyNode *node, bool branch)
+{
 
+    char c = '\0';
+    do
+    {
 
-        } while ( (c = char( ss.peek() )) == ',' );
+        // ignore the '[' or ','
+        ++current;
 
-        // ignore the final ']'
-        if ( (c = char( ss.peek() )) == ']' )
+        // ignore the '&' before parameter name
+        if ( peek() == '&')
         {
-            ss.ignore();
+            ++current;
         }
 
-    }
+        // read the parameter name
+        readToken( parameter_name, "=,]" );
 
-    // read the optional branch length
-    if ( char( ss.peek() ) == ':' )
-    {
-        ss.ignore();
-        std::string time = "";
-        while ( ss.good() && (c = char( ss.peek() )) != ';' && c != ',' && c != '[' )
+        // ignore the equal sign between parameter name and value
+        if ( peek() == '=')
         {
-            time += char( ss.get() );
+            ++current;
         }
 
-        std::istringstream stm;
-        stm.str(time);
-        double d;
-        stm >> d;
-        nodes.push_back( node );
-        brlens.push_back( d );
-    }
-    else
-    {
-        nodes.push_back( node );
-        brlens.push_back( 0.0 );
-    }
+        // read the parameter value
+        readToken( token, "],:" );
 
+        if ( parameter_name == "index" )
+        {
+            // subtract by 1 to correct RevLanguage 1-based indexing
+            node->setIndex( atoi(token.c_str()) - 1 );
+        }
+        else if ( parameter_name == "species" )
+        {
+            node->setSpeciesName( token );
+        }
+        else if ( branch == true )
+        {
+            node->addBranchParameter( parameter_name, token );
+        }
+        else
+        {
+            node->addNodeParameter( parameter_name, token );
+        }
 
+    } while ( (c = peek()) != ']' && c != '\0' && ( c == ',' || branch == true ) );
 
-    // read the optional branch parameters
-    if ( char( ss.peek() ) == '[' )
+    // ignore the final ']'
+    if ( peek() == ']' )
     {
+        ++current;
+    }
 
-        do
-        {
-
-            ss.ignore();
+}
 
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&')
-            {
-                ss.ignore();
-            }
 
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
+/**
+ * Read a label in single quotes, which may contain white spaces and punctuation.
+ * Two single quotes within the label stand for one quote.
+ */
+void NewickConverter::readQuotedToken(std::string &t)
+{
 
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=')
-            {
-                ss.ignore();
-            }
+    t.clear();
 
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-            {
-                paramValue += char( ss.get() );
-            }
+    // skip the opening quote
+    ++current;
 
-            if (paramName=="index")
-            {
-                // subtract by 1 to correct RevLanguage 1-based indexing
-                node->setIndex( atoi(paramValue.c_str()) - 1 );
+    while ( current != end )
+    {
+        char c = *current;
+        ++current;
 
-            }
-            else if (paramName=="species")
-            {
-                node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addBranchParameter(paramName, paramValue);
-            }
+        if ( c != '\'' )
+        {
+            t += c;
+        }
+        else if ( current != end && *current == '\'' )
+        {
+            // two quotes are a quote within the label
+            t += c;
+            ++current;
+        }
+        else
+        {
+            return;
+        }
+    }
 
+    throw RbException("Error while converting Newick tree. We expected a closing quote, but didn't get one.");
+}
 
-        } while ( (c = char( ss.peek() )) != ']' );
 
-        ss.ignore();
+void NewickConverter::readToken(std::string &t, const char *stop)
+{
 
+    t.clear();
+    char c = '\0';
+    while ( (c = peek()) != '\0' && strchr( stop, c ) == NULL )
+    {
+        t += c;
+        ++current;
     }
 
-
-    return node;
 }
 
 
@@ -20,6 +20,7 @@
 #define NewickConverter_H
 
 
+#include <string>
 #include <vector>
 #include <iosfwd>
 
@@ -28,17 +29,39 @@ namespace RevBayesCore {
     class Tree;
     class TopologyNode;
 
+    /**
+     * @brief Converter of newick strings into trees.
+     *
+     * The newick string is read in a single pass from a character buffer without copying it.
+     * The nodes that are still open, i.e., whose closing parenthesis we haven't seen yet, are kept on a stack
+     * instead of parsing every subtree recursively, so that deep trees don't exhaust the call stack.
+     * The work space (stack, labels, branch lengths) belongs to the converter and is reused for every tree,
+     * so converting many trees with the same converter allocates memory only for the trees themselves.
+     */
     class NewickConverter {
 
     public:
         NewickConverter();
-        virtual                 ~NewickConverter();
+        virtual                     ~NewickConverter();
     
-        Tree*                   convertFromNewick(const std::string &n, bool reindex = true );
+        Tree*                       convertFromNewick(const std::string &n, bool reindex = true );
+        Tree*                       convertFromNewick(const char *b, const char *e, bool reindex = true );     //!< Convert the newick string in the range [b,e)
 //        AdmixtureTree*          getAdmixtureTreeFromNewick(const std::string &n);
 
     private:
-        TopologyNode*           createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens);
+        char                        peek(void);                                                                 //!< The next character which isn't a white space ('\0' at the end)
+        void                        readNodeSuffix(TopologyNode *node);                                         //!< Read the label, comments and branch length of a node
+        void                        readParameters(TopologyNode *node, bool branch);                            //!< Read the comments of a node or branch
+        void                        readQuotedToken(std::string &t);                                            //!< Read a label in single quotes literally
+        void                        readToken(std::string &t, const char *stop);                                //!< Read until one of the stop characters
+        
+        const char*                 current;                                                                    //!< The current position in the newick string
+        const char*                 end;                                                                        //!< The end of the newick string
+        std::vector<TopologyNode*>  nodes;                                                                      //!< The nodes in the order we read them
+        std::vector<double>         brlens;                                                                     //!< The branch lengths of the nodes
+        std::vector<TopologyNode*>  open_nodes;                                                                 //!< The internal nodes that haven't been closed yet
+        std::string                 token;                                                                      //!< Work space for labels, branch lengths and parameter values
+        std::string                 parameter_name;                                                             //!< Work space for parameter names
     };
 
 }
@@ -0,0 +1,99 @@
+#include "AliasTable.h"
+
+#include "RandomNumberGenerator.h"
+#include "RbException.h"
+
+using namespace RevBayesCore;
+
+/** Empty table */
+AliasTable::AliasTable( void )
+{
+
+}
+
+
+/** Table for the n probabilities p */
+AliasTable::AliasTable( const double *p, size_t n )
+{
+
+    build( p, n );
+}
+
+
+/**
+ * Build the table by Vose's method.
+ * We scale the probabilities so that their mean is 1. Then we repeatedly fill the column of an outcome with
+ * a scaled probability below 1 (small) with the remaining mass of an outcome above 1 (large).
+ */
+void AliasTable::build( const double *p, size_t n )
+{
+
+    if ( n == 0 )
+    {
+        throw RbException("Cannot build an alias table for an empty distribution.");
+    }
+
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        total += p[i];
+    }
+    if ( total <= 0.0 )
+    {
+        throw RbException("Cannot build an alias table for a distribution without mass.");
+    }
+
+    cutoff.resize( n );
+    alias.resize( n );
+    small.clear();
+    large.clear();
+
+    double scale = n / total;
+    for (size_t i = 0; i < n; ++i)
+    {
+        cutoff[i] = ( p[i] > 0.0 ? p[i] * scale : 0.0 );
+        alias[i]  = i;
+        if ( cutoff[i] < 1.0 )
+        {
+            small.push_back( i );
+        }
+        else
+        {
+            large.push_back( i );
+        }
+    }
+
+    while ( small.empty() == false && large.empty() == false )
+    {
+        size_t s = small.back();
+        small.pop_back();
+        size_t l = large.back();
+
+        alias[s] = l;
+        cutoff[l] -= 1.0 - cutoff[s];
+        if ( cutoff[l] < 1.0 )
+        {
+            large.pop_back();
+            small.push_back( l );
+        }
+    }
+
+    // the remaining columns are full up to rounding errors
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        cutoff[ large[i] ] = 1.0;
+    }
+    for (size_t i = 0; i < small.size(); ++i)
+    {
+        cutoff[ small[i] ] = 1.0;
+    }
+
+}
+
+
+/** Draw an outcome */
+size_t AliasTable::draw( RandomNumberGenerator *rng ) const
+{
+
+    return draw( rng->uniform01() );
+}
@@ -0,0 +1,54 @@
+#ifndef AliasTable_H
+#define AliasTable_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace RevBayesCore {
+
+    class RandomNumberGenerator;
+
+    /**
+     * @brief Alias table for drawing from a discrete distribution in constant time.
+     *
+     * A discrete distribution over n outcomes is split into n equally likely columns (Vose's method).
+     * Each column i keeps outcome i with probability cutoff[i] and otherwise returns its alias.
+     * Building the table takes O(n) and every draw needs a single uniform random number,
+     * instead of the linear scan through the cumulative probabilities.
+     * The probabilities need not be normalized.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class AliasTable {
+
+    public:
+                                                AliasTable(void);                                       //!< Empty table
+                                                AliasTable(const double *p, size_t n);                  //!< Table for the n probabilities p
+
+        void                                    build(const double *p, size_t n);                       //!< Rebuild the table for the n probabilities p (reusing the memory)
+        size_t                                  size(void) const { return cutoff.size(); }              //!< The number of outcomes
+
+        /** Draw an outcome using a single uniform random number. */
+        inline size_t                           draw(double u) const
+                                                {
+                                                    double x = u * cutoff.size();
+                                                    size_t i = size_t( x );
+                                                    if ( i >= cutoff.size() ) i = cutoff.size() - 1;
+                                                    return ( x - i < cutoff[i] ? i : alias[i] );
+                                                }
+        size_t                                  draw(RandomNumberGenerator *rng) const;                 //!< Draw an outcome
+
+    private:
+
+        std::vector<double>                     cutoff;                                                 //!< The probability to keep the outcome of the column
+        std::vector<size_t>                     alias;                                                  //!< The outcome of the column otherwise
+        std::vector<size_t>                     small;                                                  //!< Work space for building the table
+        std::vector<size_t>                     large;                                                  //!< Work space for building the table
+
+    };
+
+}
+
+#endif
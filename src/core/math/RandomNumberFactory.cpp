@@ -6,6 +6,8 @@
 
 using namespace RevBayesCore;
 
+thread_local RandomNumberGenerator* RandomNumberFactory::thread_generator = NULL;
+
 /** Default constructor */
 RandomNumberFactory::RandomNumberFactory(void)
 {
@@ -3,6 +3,7 @@
 #ifndef RandomNumberFactory_H
 #define RandomNumberFactory_H
 
+#include <stddef.h>
 #include <set>
 
 namespace RevBayesCore {
@@ -20,6 +21,10 @@ namespace RevBayesCore {
      * class has two seeds it manages: one is a global seed and the other is
      * is a so called local seed.
      *
+     * A thread can replace the global random number generator by its own generator
+     * (see setThreadRandomNumberGenerator), so that tasks running in parallel draw from
+     * independent streams without synchronization.
+     *
      */
     class RandomNumberFactory {
 
@@ -30,7 +35,9 @@ namespace RevBayesCore {
                                                         return singleRandomNumberFactory;
                                                     }
 		void                                        deleteRandomNumberGenerator(RandomNumberGenerator* r);                                 //!< Return a random number object to the pool
-		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void) { return seedGenerator; }                         //!< Return a pointer to the global random number object
+		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void) { return ( thread_generator != NULL ? thread_generator : seedGenerator ); }   //!< Return a pointer to the global random number object (or the one of this thread)
+		RandomNumberGenerator*                      getThreadRandomNumberGenerator(void) { return thread_generator; }                      //!< Return the random number object of the calling thread (NULL if it uses the global one)
+		void                                        setThreadRandomNumberGenerator(RandomNumberGenerator* r) { thread_generator = r; }    //!< Use this random number object in the calling thread (NULL resets to the global one)
 
 	private:
                                                     RandomNumberFactory(void);                                                             //!< Default constructor
@@ -39,6 +46,7 @@ namespace RevBayesCore {
                                                    ~RandomNumberFactory(void);                                                             //!< Destructor
 		RandomNumberGenerator*                      seedGenerator;                                                                         //!< A random number object that generates seeds
 		std::set<RandomNumberGenerator*>            allocatedRandomNumbers;                                                                //!< The pool of random number objects
+        static thread_local RandomNumberGenerator*  thread_generator;                                                                      //!< The random number object replacing the global one in this thread (not owned)
     };
 }
 
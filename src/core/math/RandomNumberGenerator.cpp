@@ -1,5 +1,8 @@
 #include "RandomNumberGenerator.h"
 #include "RbConstants.h"
+#include "RbException.h"
+
+#include <sstream>
 
 #include "boost/date_time/posix_time/posix_time.hpp" // IWYU pragma: keep
 #include <boost/random.hpp>
@@ -47,6 +50,20 @@ unsigned int RandomNumberGenerator::getSeed( void ) const
 }
 
 
+/**
+ * Get the complete internal state of the Mersenne twister as a string.
+ * A generator that continues from this state (see setState) produces exactly the same numbers as this generator.
+ */
+std::string RandomNumberGenerator::getState( void ) const
+{
+    
+    std::stringstream ss;
+    ss << seed << " " << zeroone.base();
+    
+    return ss.str();
+}
+
+
 /** Set the seed of the random number generator */
 void RandomNumberGenerator::setSeed(unsigned int s)
 {
@@ -59,6 +76,26 @@ void RandomNumberGenerator::setSeed(unsigned int s)
 }
 
 
+/** Continue from a state obtained by getState() */
+void RandomNumberGenerator::setState(const std::string &s)
+{
+    
+    // the generator sets the fail bit if its state ends the stream, so we add a separator
+    std::stringstream ss( s + " " );
+    unsigned int new_seed = 0;
+    boost::mt19937 rng;
+    ss >> new_seed >> rng;
+    if ( ss.fail() == true )
+    {
+        throw RbException("Could not restore the state of the random number generator.");
+    }
+    
+    seed = new_seed;
+    zeroone = boost::uniform_01<boost::mt19937>(rng);
+    
+}
+
+
 /*!
  *
  * \brief Uniform[0,1) random variable.
@@ -3,6 +3,7 @@
 
 #include <boost/random/uniform_01.hpp>
 #include <boost/random/mersenne_twister.hpp>
+#include <string>
 
 namespace RevBayesCore {
 
@@ -15,7 +16,9 @@ namespace RevBayesCore {
         // Regular functions
         unsigned int                                getNewSeed(void) const;                                 //!< Get the new seed values
         unsigned int                                getSeed(void) const;                                    //!< Get the seed values
+        std::string                                 getState(void) const;                                   //!< Get the complete internal state (e.g., for checkpointing)
         void                                        setSeed(unsigned int s);                                //!< Set the seeds of the RNG
+        void                                        setState(const std::string &s);                         //!< Continue from a state obtained by getState()
         double                                      uniform01(void);                                        //!< Get a random [0,1) var
 
     private:
@@ -161,6 +161,40 @@ double RbMath::chebyshev_eval(double x, const double *a, const int n)
     return (b0 - b2) * 0.5;
 }
 
+/*!
+ * This function calculates the digamma function psi(x) = d/dx lnGamma(x) for x > 0.
+ * We shift the argument up with the recurrence psi(x) = psi(x+1) - 1/x
+ * and use the asymptotic expansion for large arguments.
+ *
+ * \brief Digamma function.
+ * \param x is the argument.
+ * \return Returns the value of the digamma function.
+ * \throws Throws an RbException::ERROR for non-positive arguments.
+ */
+double RbMath::digamma(double x)
+{
+
+    if ( x <= 0.0 )
+    {
+        std::ostringstream s;
+        s << "Cannot compute the digamma function for x = " << x;
+        throw RbException(s.str());
+    }
+
+    double result = 0.0;
+    while ( x < 6.0 )
+    {
+        result -= 1.0 / x;
+        x += 1.0;
+    }
+
+    double f = 1.0 / (x * x);
+    double t = f * (-1.0/12.0 + f * (1.0/120.0 + f * (-1.0/252.0 + f * (1.0/240.0 + f * (-1.0/132.0)))));
+
+    return result + log(x) - 0.5 / x + t;
+}
+
+
 /**
  * C++ version of the expm1 function. We provide our own, since this
  * function is not available in the Microsoft cmath header
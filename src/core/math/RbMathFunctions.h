@@ -28,6 +28,7 @@ namespace RevBayesCore {
         double                      binomialDeviance(double x, double np);                                          //!< Evaluates the Deviance part
         int                         chebyshev_init(double *dos, int nos, double eta);
         double                      chebyshev_eval(double x, const double *a, const int n);
+        double                      digamma(double x);                                                              //!< Calculate the digamma function, the derivative of lnGamma
         double                      expm1(double x);                                                                //!< Compute exp(x) - 1 for small x
         double                      gamma(double x);                                                                //!< Calculate the Gamma function 
         double                      gamma_old(double x);                                                            //!< Calculate the Gamma function 
@@ -197,11 +197,10 @@ double RbStatistics::Beta::rv(double aa, double bb, RandomNumberGenerator& rng)
     double r, s, t, u1, u2, v, w, y, z;
 
     int qsame;
-    /* FIXME:  Keep Globals (properly) for threading */
-    /* Uses these GLOBALS to save time when many rv's are generated : */
-    static double beta, gamma, delta, k1, k2;
-    static double olda = -1.0;
-    static double oldb = -1.0;
+    /* Uses these thread-specific globals to save time when many rv's are generated : */
+    static thread_local double beta, gamma, delta, k1, k2;
+    static thread_local double olda = -1.0;
+    static thread_local double oldb = -1.0;
 
     if (aa <= 0. || bb <= 0. || (!RbMath::isFinite(aa) && !RbMath::isFinite(bb)))
     {
@@ -2,6 +2,7 @@
 
 #include <string>
 
+#include "RbException.h"
 #include "RbFileManager.h"
 #include "Cloneable.h"
 
@@ -15,6 +16,7 @@ AbstractFileMonitor::AbstractFileMonitor(DagNode *n, unsigned long g, const std:
     filename( fname ),
     working_file_name( fname ),
     append(ap),
+    append_offset( -1 ),
     flatten( true ),
     write_version( wv )
 {}
@@ -25,6 +27,7 @@ AbstractFileMonitor::AbstractFileMonitor(const std::vector<DagNode *> &n, unsign
     filename( fname ),
     working_file_name( fname ),
     append(ap),
+    append_offset( -1 ),
     flatten( true ),
     write_version( wv )
 {}
@@ -36,6 +39,7 @@ AbstractFileMonitor::AbstractFileMonitor(const AbstractFileMonitor &f) : Monitor
     filename            = f.filename;
     working_file_name   = f.working_file_name;
     append              = f.append;
+    append_offset       = f.append_offset;
     flatten             = f.flatten;
     write_version       = f.write_version;
     
@@ -79,6 +83,30 @@ void AbstractFileMonitor::closeStream()
 }
 
 
+/**
+ * Get the size of the file after flushing the stream, so that a checkpoint can record how much of the file belongs to it.
+ *
+ * \return The size in bytes or -1 if the file cannot be read.
+ */
+long AbstractFileMonitor::getFileSize( void ) const
+{
+    
+    if ( out_stream.is_open() == true )
+    {
+        out_stream.flush();
+    }
+    
+    RbFileManager f = RbFileManager(working_file_name);
+    std::ifstream in_stream( f.getFullFileName().c_str(), std::ios::in | std::ios::binary | std::ios::ate );
+    if ( in_stream.is_open() == false )
+    {
+        return -1;
+    }
+    
+    return long( in_stream.tellg() );
+}
+
+
 bool AbstractFileMonitor::isFileMonitor( void ) const
 {
     return true;
@@ -91,6 +119,16 @@ void AbstractFileMonitor::openStream( bool reopen )
     RbFileManager f = RbFileManager(working_file_name);
     f.createDirectoryForFile();
             
+    // drop what was written after the checkpoint we continue from
+    if ( append == true && append_offset >= 0 )
+    {
+        if ( f.truncateFile( size_t(append_offset) ) == false )
+        {
+            throw RbException( "Could not truncate the monitor file \"" + f.getFullFileName() + "\" to its size at the checkpoint." );
+        }
+        append_offset = -1;
+    }
+    
     // open the stream to the file
     if ( append == true || reopen == true )
     {
@@ -122,6 +160,18 @@ void AbstractFileMonitor::setAppend(bool tf)
  *
  * \param[in]   tf   new flag value
  */
+/**
+ * Set the size up to which the existing file is kept when we append to it.
+ * The rest of the file, i.e., the samples written after the last checkpoint, is removed when the stream is opened.
+ *
+ * \param[in]   s   the size in bytes (-1 keeps the whole file)
+ */
+void AbstractFileMonitor::setAppendOffset(long s)
+{
+    append_offset = s;
+}
+
+
 void AbstractFileMonitor::setPrintVersion(bool tf)
 {
     
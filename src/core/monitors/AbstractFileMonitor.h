@@ -32,21 +32,24 @@ class DagNode;
         virtual void                        printHeader(void) = 0;
         
         // FileMonitor functions
+        long                                getFileSize(void) const;  //!< Flush the stream and get the size of the file (-1 if it cannot be read)
         bool                                isFileMonitor( void ) const;
         void                                openStream(bool reopen);
         void                                setAppend(bool tf);   //!< Set if the monitor should append to an existing file
+        void                                setAppendOffset(long s);  //!< Set the size up to which the file is kept when we append (-1 keeps the whole file)
         void                                setPrintVersion(bool tf);  //!< Set flag whether to print the version
 
         // functions you may want to overwrite
         virtual void                        closeStream(void);
     
     protected:
-        std::fstream                        out_stream;  //!< output file stream
+        mutable std::fstream                out_stream;  //!< output file stream (flushed by getFileSize)
         
         // parameters
         std::string                         filename;  //!< input name of the output file
         std::string                         working_file_name;  //!< actual output file name, including extension if applicable
         bool                                append;  //!< whether to append to an existing file
+        long                                append_offset;  //!< the size up to which the existing file is kept, e.g., the size at the last checkpoint
         bool                                flatten;  //!< whether vectors should be flattened in the output (i.e each element treated as a separate variable)
         bool                                write_version;  //!< whether to write the version
         
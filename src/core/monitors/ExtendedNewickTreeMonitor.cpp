@@ -79,7 +79,8 @@ void ExtendedNewickTreeMonitor::monitorVariables(unsigned long gen)
         }
     }
 
-    out_stream << tree->getValue();
+    tree->getValue().getNewickRepresentation( newick );
+    out_stream << newick;
     out_stream.flush();
 
 }
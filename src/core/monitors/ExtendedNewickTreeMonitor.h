@@ -20,6 +20,7 @@
 #define ExtendedNewickTreeMonitor_H
 
 #include <fstream>
+#include <string>
 #include <vector>
 
 #include "VariableMonitor.h"
@@ -51,6 +52,7 @@ template <class valueType> class TypedDagNode;
         bool                                isNodeParameter;
         TypedDagNode<Tree>*                 tree;
         std::vector<DagNode*>               nodeVariables;        
+        std::string                         newick;                                             //!< Reusable buffer for the newick string of the tree
     };
     
 }
@@ -101,7 +101,8 @@ void NexusMonitor::monitor(unsigned long gen) {
         }
     }
 
-    out_stream << tree->getValue() << std::endl;
+    tree->getValue().getNewickRepresentation( newick );
+    out_stream << newick << std::endl;
     out_stream.flush();
 }
 
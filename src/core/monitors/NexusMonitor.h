@@ -2,6 +2,7 @@
 #define SRC_CORE_MONITORS_NEXUSMONITOR_H_
 
 #include <iosfwd>
+#include <string>
 #include <vector>
 
 #include "AbstractFileMonitor.h"
@@ -32,6 +33,7 @@ protected:
     bool writeTaxa;  //!< whether to write a taxa block
     TypedDagNode<Tree>* tree;  //!< monitored tree
     std::vector<DagNode*> nodeVariables;  //!< variables associated with the tree
+    std::string newick;  //!< reusable buffer for the newick string of the tree
 };
 
 } /* namespace RevBayesCore */
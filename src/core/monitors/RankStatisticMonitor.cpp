@@ -0,0 +1,174 @@
+#include "RankStatisticMonitor.h"
+
+#include <algorithm>
+
+#include "DagNode.h"
+#include "RbException.h"
+#include "RbVector.h"
+#include "Simplex.h"
+#include "TypedDagNode.h"
+
+using namespace RevBayesCore;
+
+/* Constructor */
+RankStatisticMonitor::RankStatisticMonitor(unsigned long g, const std::vector<DagNode *> &n) : Monitor(g,n),
+    num_samples( 0 )
+{
+
+    // the base class sorted the nodes by name
+    for (std::vector<DagNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        std::vector<double> v;
+        if ( getNumericValues( *it, v ) == false )
+        {
+            throw RbException("Cannot compute rank statistics for the non-numeric variable '" + (*it)->getName() + "'.");
+        }
+        true_values.push_back( v );
+        smaller_values_count.push_back( std::vector<double>( v.size(), 0.0 ) );
+        equal_values_count.push_back( std::vector<double>( v.size(), 0.0 ) );
+    }
+
+}
+
+
+/**
+ * Destructor.
+ */
+RankStatisticMonitor::~RankStatisticMonitor()
+{
+
+}
+
+
+/**
+ * The clone function is a convenience function to create proper copies of inherited objected.
+ * E.g. a.clone() will create a clone of the correct type even if 'a' is of derived type 'B'.
+ *
+ * \return A new copy of myself
+ */
+RankStatisticMonitor* RankStatisticMonitor::clone(void) const
+{
+
+    return new RankStatisticMonitor(*this);
+}
+
+
+const std::vector<double>& RankStatisticMonitor::getNumberOfEqualValues(size_t i) const
+{
+
+    return equal_values_count[i];
+}
+
+
+size_t RankStatisticMonitor::getNumberOfSamples(void) const
+{
+
+    return num_samples;
+}
+
+
+const std::vector<double>& RankStatisticMonitor::getNumberOfSmallerValues(size_t i) const
+{
+
+    return smaller_values_count[i];
+}
+
+
+/**
+ * Get the elements of the value of a numeric variable.
+ *
+ * \return False if the variable is not a real or integer number, a vector of these or a simplex.
+ */
+bool RankStatisticMonitor::getNumericValues(const DagNode *n, std::vector<double> &v)
+{
+
+    v.clear();
+    if ( const TypedDagNode<double> *d = dynamic_cast<const TypedDagNode<double>* >( n ) )
+    {
+        v.push_back( d->getValue() );
+    }
+    else if ( const TypedDagNode<long> *l = dynamic_cast<const TypedDagNode<long>* >( n ) )
+    {
+        v.push_back( double(l->getValue()) );
+    }
+    else if ( const TypedDagNode<RbVector<double> > *dv = dynamic_cast<const TypedDagNode<RbVector<double> >* >( n ) )
+    {
+        const RbVector<double> &x = dv->getValue();
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            v.push_back( x[i] );
+        }
+    }
+    else if ( const TypedDagNode<Simplex> *s = dynamic_cast<const TypedDagNode<Simplex>* >( n ) )
+    {
+        const Simplex &x = s->getValue();
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            v.push_back( x[i] );
+        }
+    }
+    else if ( const TypedDagNode<RbVector<long> > *lv = dynamic_cast<const TypedDagNode<RbVector<long> >* >( n ) )
+    {
+        const RbVector<long> &x = lv->getValue();
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            v.push_back( double(x[i]) );
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Compare the current values with the true values at generation gen.
+ */
+void RankStatisticMonitor::monitor(unsigned long gen)
+{
+
+    if ( gen % printgen != 0 )
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        getNumericValues( nodes[i], values );
+
+        // the dimension of the variable may change, but then we cannot rank its elements
+        size_t n = std::min( values.size(), true_values[i].size() );
+        for (size_t j = 0; j < n; ++j)
+        {
+            if ( values[j] < true_values[i][j] )
+            {
+                ++smaller_values_count[i][j];
+            }
+            else if ( values[j] == true_values[i][j] )
+            {
+                ++equal_values_count[i][j];
+            }
+        }
+    }
+    ++num_samples;
+
+}
+
+
+/**
+ * Forget all samples, e.g., from a previous run.
+ */
+void RankStatisticMonitor::reset(size_t numCycles)
+{
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        std::fill( smaller_values_count[i].begin(), smaller_values_count[i].end(), 0.0 );
+        std::fill( equal_values_count[i].begin(), equal_values_count[i].end(), 0.0 );
+    }
+    num_samples = 0;
+
+}
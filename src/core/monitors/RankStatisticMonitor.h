@@ -0,0 +1,62 @@
+#ifndef RankStatisticMonitor_H
+#define RankStatisticMonitor_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "Monitor.h"
+
+namespace RevBayesCore {
+class DagNode;
+
+    /**
+     * @brief A monitor that ranks the true values of numeric variables among the samples.
+     *
+     * The monitor records the values of the variables when it is created, e.g., the values simulated
+     * in a validation analysis, as the true values. For every sample it then counts, per element of each
+     * variable, how many sampled values are smaller than or equal to the true value.
+     * These counts give the quantile of the true value in the posterior (for coverage) and its rank
+     * statistic (for simulation-based calibration) without storing the samples.
+     * Only numeric variables (real and integer numbers, vectors of these and simplices) can be monitored.
+     *
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     *
+     */
+    class RankStatisticMonitor : public Monitor {
+
+    public:
+        // Constructors and Destructors
+        RankStatisticMonitor(unsigned long g, const std::vector<DagNode *> &n);                                         //!< Constructor, the current values are the true values
+        virtual ~RankStatisticMonitor(void);
+
+        // basic methods
+        RankStatisticMonitor*               clone(void) const;                                                          //!< Clone the object
+
+        // public (overloaded) methods
+        void                                monitor(unsigned long gen);                                                 //!< Monitor at generation gen
+        void                                reset(size_t numCycles);                                                    //!< Forget all samples
+
+        // getters
+        size_t                              getNumberOfSamples(void) const;                                             //!< The number of samples
+        const std::vector<double>&          getNumberOfEqualValues(size_t i) const;                                     //!< Number of samples equal to the true value, per element of the i-th variable
+        const std::vector<double>&          getNumberOfSmallerValues(size_t i) const;                                   //!< Number of samples smaller than the true value, per element of the i-th variable
+
+        static bool                         getNumericValues(const DagNode *n, std::vector<double> &v);                 //!< Get the elements of a numeric variable (false if it is not numeric)
+
+    private:
+
+        std::vector<std::vector<double> >   true_values;                                                                //!< The true values of the monitored variables
+        std::vector<std::vector<double> >   smaller_values_count;                                                       //!< Number of sampled values smaller than the true value
+        std::vector<std::vector<double> >   equal_values_count;                                                         //!< Number of sampled values equal to the true value
+        size_t                              num_samples;                                                                //!< The number of samples
+        std::vector<double>                 values;                                                                     //!< Work space for the current values
+
+    };
+
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "AbstractHomologousDiscreteCharacterData.h"
 #include "StateDependentSpeciationExtinctionProcess.h"
+#include "StochasticCharacterMapBuffer.h"
 #include "VariableMonitor.h"
 #include "TypedDagNode.h"
 #include "StochasticNode.h"
@@ -54,6 +55,7 @@ namespace RevBayesCore {
         bool                                            include_simmaps;                                                    //!< Should we print out SIMMAP/phytools compatible character histories?
         bool                                            use_simmap_default;
         size_t                                          index;
+        StochasticCharacterMapBuffer                    character_map_buffer;                                               //!< Reused storage for the sampled character histories
 
     };
 
@@ -155,48 +157,57 @@ template<class characterType>
 void StochasticCharacterMappingMonitor<characterType>::monitorVariables(unsigned long gen)
 {
 
-    size_t num_nodes;
+    const std::vector<TopologyNode*>& nds = tree->getValue().getNodes();
+    size_t num_nodes = tree->getValue().getNumberOfNodes();
+    std::vector<std::string> character_histories;
 
-    // get the distribution for the character
-    StateDependentSpeciationExtinctionProcess *sse_process = NULL;
-    AbstractPhyloCTMCSiteHomogeneous<characterType> *ctmc_dist = NULL;
-    if ( ctmc != NULL )
-    {
-        ctmc_dist = static_cast<AbstractPhyloCTMCSiteHomogeneous<characterType>* >( &ctmc->getDistribution() );
-        num_nodes = tree->getValue().getNumberOfNodes();
-    }
-    else
-    {
-        sse_process = dynamic_cast<StateDependentSpeciationExtinctionProcess*>( &nodes[0]->getDistribution() );
-        num_nodes = tree->getValue().getNumberOfNodes();
-    }
-        
-    std::vector<std::string> character_histories( num_nodes );
-    
-    // draw stochastic character map
     if ( ctmc != NULL )
     {
-        ctmc_dist->drawStochasticCharacterMap( character_histories, index, use_simmap_default );
+        // draw the stochastic character map into the flat buffer and print it without intermediate strings
+        AbstractPhyloCTMCSiteHomogeneous<characterType> *ctmc_dist = static_cast<AbstractPhyloCTMCSiteHomogeneous<characterType>* >( &ctmc->getDistribution() );
+        ctmc_dist->drawStochasticCharacterMaps( std::vector<size_t>(1, index), character_map_buffer );
+
+        for (int i = 0; i < nds.size(); i++)
+        {
+            // add a separator before every new element
+            out_stream << separator;
+
+            // print out this branch's character history in the format
+            // used by SIMMAP and phytools
+            character_map_buffer.writeSimmap( out_stream, 0, nds[i]->getIndex(), use_simmap_default );
+        }
+
+        if ( include_simmaps == true )
+        {
+            character_histories.resize( num_nodes );
+            for (size_t i = 0; i < num_nodes; i++)
+            {
+                character_histories[i] = character_map_buffer.getSimmapString( 0, i, use_simmap_default );
+            }
+        }
     }
     else
     {
+        StateDependentSpeciationExtinctionProcess *sse_process = dynamic_cast<StateDependentSpeciationExtinctionProcess*>( &nodes[0]->getDistribution() );
+
+        // draw stochastic character map
+        character_histories.resize( num_nodes );
         sse_process->drawStochasticCharacterMap( character_histories );
-    }
 
-    // print to monitor file
-    const std::vector<TopologyNode*>& nds = tree->getValue().getNodes();
-    for (int i = 0; i < nds.size(); i++)
-    {
+        // print to monitor file
+        for (int i = 0; i < nds.size(); i++)
+        {
 
-        size_t node_index = nds[i]->getIndex();
+            size_t node_index = nds[i]->getIndex();
 
-        // add a separator before every new element
-        out_stream << separator;
+            // add a separator before every new element
+            out_stream << separator;
+
+            // print out this branch's character history in the format
+            // used by SIMMAP and phytools
+            out_stream << character_histories[ node_index ];
 
-        // print out this branch's character history in the format
-        // used by SIMMAP and phytools
-        out_stream << character_histories[ node_index ];
-        
+        }
     }
 
     if ( include_simmaps == true )
@@ -23,6 +23,7 @@ AbstractMove::AbstractMove( double weight, bool tuning ) :
     affected_nodes(  ),
     weight( weight ),
     auto_tuning( tuning ),
+    adapting( false ),
     num_tried_current_period( 0 ),
     num_tried_total( 0 )
 {
@@ -44,6 +45,7 @@ AbstractMove::AbstractMove( const std::vector<DagNode*> &nodes, double weight, b
     affected_nodes( ),
     weight( weight ),
     auto_tuning( tuning ),
+    adapting( false ),
     num_tried_current_period( 0 ),
     num_tried_total( 0 )
 {
@@ -89,6 +91,7 @@ AbstractMove::AbstractMove( const AbstractMove &move ) : Move( move ),
     affected_nodes( move.affected_nodes ),
     weight( move.weight ),
     auto_tuning( move.auto_tuning  ),
+    adapting( move.adapting ),
     num_tried_current_period( move.num_tried_current_period ),
     num_tried_total( move.num_tried_total )
 {
@@ -166,6 +169,7 @@ AbstractMove& AbstractMove::operator=(const RevBayesCore::AbstractMove &move)
         
         affected_nodes              = move.affected_nodes;
         nodes                       = move.nodes;
+        adapting                    = move.adapting;
         num_tried_current_period    = move.num_tried_current_period;
         num_tried_total             = move.num_tried_total;
         
@@ -263,6 +267,18 @@ const RbOrderedSet<DagNode*>& AbstractMove::getAffectedNodes( void ) const
 }
 
 
+/**
+ * Get the state that the move learned during the adaptation phase besides its tuning parameter,
+ * e.g., an empirical covariance matrix, as a vector of numbers that we can store in a checkpoint.
+ * Most moves only have their tuning parameter, so by default the state is empty.
+ */
+std::vector<double> AbstractMove::getAdaptationState( void ) const
+{
+    
+    return std::vector<double>();
+}
+
+
 /**
  * Get the set of nodes on which this move is working on.
  *
@@ -513,6 +529,25 @@ void AbstractMove::swapNode(DagNode *old_node, DagNode *new_node)
 }
 
 
+/**
+ * Start or stop the adaptation phase, i.e., burnin.
+ * Moves that adapt more than their tuning parameter, e.g., by collecting samples, only do so during this phase.
+ */
+void AbstractMove::setAdaptation( bool tf )
+{
+    adapting = tf;
+}
+
+
+/**
+ * Restore the state returned by getAdaptationState (see there). By default there is nothing to restore.
+ */
+void AbstractMove::setAdaptationState( const std::vector<double> &s )
+{
+    
+}
+
+
 void AbstractMove::setNumberAcceptedCurrentPeriod( size_t na )
 {
     num_tried_current_period = na;
@@ -41,6 +41,7 @@ namespace RevBayesCore {
         void                                                    addNode(DagNode* p);                                                //!< add a node to the proposal
         void                                                    autoTune(void);                                                     //!< Automatic tuning of the move.
         void                                                    decrementTriedCounter(void);                                        //!< Get update weight of InferenceMove
+        virtual std::vector<double>                             getAdaptationState(void) const;                                     //!< Get what the move learned while adapting (for checkpoints)
         virtual size_t                                          getNumberAcceptedCurrentPeriod(void) const;                         //!< Get update weight of InferenceMove
         virtual size_t                                          getNumberAcceptedTotal(void) const;                                 //!< Get update weight of InferenceMove
         size_t                                                  getNumberTriedCurrentPeriod(void) const;                            //!< Get the number of tries for this move since the last reset
@@ -51,6 +52,8 @@ namespace RevBayesCore {
         void                                                    performHillClimbingStep(double lHeat, double pHeat);                //!< Perform the move.
         void                                                    removeNode(DagNode* p);                                             //!< remove a node from the proposal
         void                                                    resetCounters(void);                                                //!< Reset the counters such as numTried.
+        virtual void                                            setAdaptation(bool tf);                                             //!< Start or stop the adaptation phase (burnin)
+        virtual void                                            setAdaptationState(const std::vector<double> &s);                   //!< Restore what the move learned while adapting
         virtual void                                            setNumberAcceptedCurrentPeriod(size_t na);
         virtual void                                            setNumberAcceptedTotal(size_t na);
         void                                                    setNumberTriedCurrentPeriod(size_t nt);
@@ -78,6 +81,7 @@ namespace RevBayesCore {
         RbOrderedSet<DagNode*>                                  affected_nodes;                                                      //!< The affected nodes by this move.
         double                                                  weight;
         bool                                                    auto_tuning;
+        bool                                                    adapting;                                                            //!< Are we in the adaptation phase (burnin)?
         size_t                                                  num_tried_current_period;                                            //!< Number of times tried
         size_t                                                  num_tried_total;                                                     //!< Number of times tried
 
@@ -0,0 +1,385 @@
+#include "AdaptiveMoveSchedule.h"
+
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+
+#include "DagNode.h"
+#include "Move.h"
+#include "RbException.h"
+#include "RandomNumberFactory.h"
+#include "RandomNumberGenerator.h"
+#include "RbIterator.h"
+#include "RbIteratorImpl.h"
+#include "RbVector.h"
+#include "RbVectorImpl.h"
+#include "Simplex.h"
+#include "TypedDagNode.h"
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    /**
+     * Append at most m evenly spaced elements of x to v.
+     */
+    template <class valueType>
+    void appendElements(const std::vector<valueType> &x, size_t m, std::vector<double> &v)
+    {
+
+        size_t n = x.size();
+        size_t k = std::min( n, m );
+        for (size_t j = 0; j < k; ++j)
+        {
+            v.push_back( double( x[ (j * n) / k ] ) );
+        }
+
+    }
+
+
+    /**
+     * Append the numeric values of the node to v (nothing for other value types).
+     * Of a vector we append at most m elements.
+     */
+    void appendValues(const DagNode *n, size_t m, std::vector<double> &v)
+    {
+
+        if ( const TypedDagNode<double> *d = dynamic_cast<const TypedDagNode<double>* >( n ) )
+        {
+            v.push_back( d->getValue() );
+        }
+        else if ( const TypedDagNode<long> *l = dynamic_cast<const TypedDagNode<long>* >( n ) )
+        {
+            v.push_back( double( l->getValue() ) );
+        }
+        else if ( const TypedDagNode<RbVector<double> > *dv = dynamic_cast<const TypedDagNode<RbVector<double> >* >( n ) )
+        {
+            appendElements<double>( dv->getValue(), m, v );
+        }
+        else if ( const TypedDagNode<Simplex> *s = dynamic_cast<const TypedDagNode<Simplex>* >( n ) )
+        {
+            appendElements<double>( s->getValue(), m, v );
+        }
+        else if ( const TypedDagNode<RbVector<long> > *lv = dynamic_cast<const TypedDagNode<RbVector<long> >* >( n ) )
+        {
+            appendElements<long>( lv->getValue(), m, v );
+        }
+
+    }
+
+}
+
+
+AdaptiveMoveSchedule::AdaptiveMoveSchedule(RbVector<Move> *s, size_t mc, double min_f, double max_f, size_t ui, size_t mv) : MoveSchedule( s ),
+    min_calls( mc ),
+    min_factor( min_f ),
+    max_factor( max_f ),
+    update_interval( ui ),
+    max_values( mv ),
+    moves_per_iteration( 0.0 ),
+    adaptive( false ),
+    current_move( s->size() ),
+    accepted_before( 0 ),
+    num_measured_since_update( 0 )
+{
+
+    if ( min_factor <= 0.0 || min_factor > 1.0 || max_factor < 1.0 || update_interval == 0 || max_values == 0 )
+    {
+        throw RbException("The adaptive move schedule needs 0 < min_factor <= 1 <= max_factor and a positive update interval and number of values.");
+    }
+
+    for (RbIterator<Move> it = moves->begin(); it != moves->end(); ++it)
+    {
+        moves_per_iteration += it->getUpdateWeight();
+        user_weights.push_back( it->getUpdateWeight() );
+    }
+    weights = user_weights;
+
+    num_calls.resize( weights.size(), 0 );
+    num_accepted.resize( weights.size(), 0 );
+    total_time.resize( weights.size(), 0.0 );
+    total_gain.resize( weights.size(), 0.0 );
+    value_means.resize( weights.size() );
+    value_sums_of_squares.resize( weights.size() );
+
+}
+
+
+AdaptiveMoveSchedule::~AdaptiveMoveSchedule()
+{
+    // we own nothing
+}
+
+
+AdaptiveMoveSchedule* AdaptiveMoveSchedule::clone( void ) const
+{
+    return new AdaptiveMoveSchedule(*this);
+}
+
+
+void AdaptiveMoveSchedule::collectValues(size_t i, std::vector<double> &v) const
+{
+
+    v.clear();
+    const std::vector<DagNode*> &nodes = (*moves)[i].getDagNodes();
+    for (size_t j = 0; j < nodes.size(); ++j)
+    {
+        appendValues( nodes[j], max_values, v );
+    }
+
+}
+
+
+/**
+ * Get the adapted weights, so that a checkpoint can restore them.
+ */
+std::vector<double> AdaptiveMoveSchedule::getAdaptationState( void ) const
+{
+    return weights;
+}
+
+
+double AdaptiveMoveSchedule::getNumberMovesPerIteration( void ) const
+{
+    return moves_per_iteration;
+}
+
+
+const std::vector<double>& AdaptiveMoveSchedule::getWeights( void ) const
+{
+    return weights;
+}
+
+
+/**
+ * Measure the cost and the gain of the move that was picked last.
+ * We also update the running mean and variance of its values, which standardize the jumps.
+ * The gain of a move with numeric values only depends on how its values changed, so it doesn't matter whether the move counts its accepted calls.
+ */
+void AdaptiveMoveSchedule::moveFinished( void )
+{
+
+    if ( current_move >= weights.size() )
+    {
+        return;
+    }
+
+    size_t i = current_move;
+    current_move = weights.size();
+
+    double time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_time ).count();
+    bool accepted = (*moves)[i].getNumberAcceptedTotal() > accepted_before;
+
+    collectValues( i, values_after );
+
+    // the number of values may change (e.g., reversible jump), then we start over for this move
+    std::vector<double> &means = value_means[i];
+    std::vector<double> &sums_of_squares = value_sums_of_squares[i];
+    if ( means.size() != values_after.size() || values_before.size() != values_after.size() )
+    {
+        means.assign( values_after.size(), 0.0 );
+        sums_of_squares.assign( values_after.size(), 0.0 );
+        num_calls[i] = 0;
+        num_accepted[i] = 0;
+        total_time[i] = 0.0;
+        total_gain[i] = 0.0;
+    }
+
+    double gain = 0.0;
+    if ( values_after.empty() == true )
+    {
+        // without numeric values, all we know is whether the move was accepted
+        gain = ( accepted == true ? 1.0 : 0.0 );
+    }
+    else
+    {
+        // the mean standardized squared jump of the values whose variance we know
+        double sum = 0.0;
+        size_t num_standardized = 0;
+        bool changed = false;
+        for (size_t j = 0; j < values_after.size(); ++j)
+        {
+            double jump = values_after[j] - values_before[j];
+            changed |= ( jump != 0.0 );
+
+            double variance = ( num_calls[i] > 1 ? sums_of_squares[j] / (num_calls[i] - 1) : 0.0 );
+            if ( variance > 0.0 )
+            {
+                sum += jump * jump / variance;
+                ++num_standardized;
+            }
+        }
+        if ( num_standardized > 0 )
+        {
+            gain = sum / num_standardized;
+        }
+        else
+        {
+            gain = ( changed == true ? 1.0 : 0.0 );
+        }
+    }
+
+    ++num_calls[i];
+    if ( accepted == true )
+    {
+        ++num_accepted[i];
+    }
+    total_time[i] += time;
+    total_gain[i] += gain;
+    for (size_t j = 0; j < values_after.size(); ++j)
+    {
+        double delta = values_after[j] - means[j];
+        means[j] += delta / num_calls[i];
+        sums_of_squares[j] += delta * (values_after[j] - means[j]);
+    }
+
+    ++num_measured_since_update;
+    if ( num_measured_since_update >= update_interval * weights.size() )
+    {
+        updateWeights();
+        num_measured_since_update = 0;
+    }
+
+}
+
+
+Move& AdaptiveMoveSchedule::nextMove( unsigned long gen )
+{
+
+    double sum_of_weights = 0.0;
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        if ( (*moves)[i].isActive( gen ) )
+        {
+            sum_of_weights += weights[i];
+        }
+    }
+
+    RandomNumberGenerator* rng = GLOBAL_RNG;
+    double u = sum_of_weights * rng->uniform01();
+
+    size_t index = 0;
+    // only if the move is inactive or the weight of the move is smaller than u
+    while ( index < moves->size() && ( !(*moves)[index].isActive(gen) || weights[index] <= u ) )
+    {
+        // check if this move is active
+        // if not, then we just subtract the weight of this move
+        if ( (*moves)[index].isActive( gen ) )
+        {
+            u -= weights[index];
+        }
+        ++index;
+    }
+
+    if (index >= moves->size())
+    {
+        index = moves->size() - 1;
+    }
+
+    // remember the state before the move if we are going to measure it
+    if ( adaptive == true )
+    {
+        current_move = index;
+        accepted_before = (*moves)[index].getNumberAcceptedTotal();
+        collectValues( index, values_before );
+        start_time = std::chrono::steady_clock::now();
+    }
+
+    return (*moves)[index];
+}
+
+
+/**
+ * Restore the adapted weights from getAdaptationState.
+ */
+void AdaptiveMoveSchedule::setAdaptationState(const std::vector<double> &s)
+{
+
+    if ( s.size() != weights.size() )
+    {
+        throw RbException("The checkpointed weights of the adaptive move schedule don't match the number of moves.");
+    }
+
+    weights = s;
+
+}
+
+
+/**
+ * Start or stop adapting the weights.
+ * The weights we have when we stop are kept until we adapt again.
+ */
+void AdaptiveMoveSchedule::setAdaptive( bool tf )
+{
+
+    adaptive = tf;
+    if ( adaptive == false )
+    {
+        current_move = weights.size();
+    }
+
+}
+
+
+/**
+ * Set the weights from the efficiencies (gain per second) of the moves.
+ * Moves with too few measured calls keep their user weight, as do moves without numeric values that never counted an accepted call,
+ * because we cannot tell whether they don't count their accepted calls or were never accepted.
+ */
+void AdaptiveMoveSchedule::updateWeights( void )
+{
+
+    std::vector<double> efficiencies( weights.size(), -1.0 );
+    double sum_log_efficiencies = 0.0;
+    size_t num_efficiencies = 0;
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        bool measurable = ( value_means[i].empty() == false || num_accepted[i] > 0 );
+        if ( user_weights[i] > 0.0 && num_calls[i] >= min_calls && total_time[i] > 0.0 && measurable == true )
+        {
+            efficiencies[i] = total_gain[i] / total_time[i];
+            if ( efficiencies[i] > 0.0 )
+            {
+                sum_log_efficiencies += std::log( efficiencies[i] );
+                ++num_efficiencies;
+            }
+        }
+    }
+
+    if ( num_efficiencies == 0 )
+    {
+        return;
+    }
+    double mean_efficiency = std::exp( sum_log_efficiencies / num_efficiencies );
+
+    double sum_of_weights = 0.0;
+    double sum_of_user_weights = 0.0;
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        double factor = 1.0;
+        if ( efficiencies[i] == 0.0 )
+        {
+            // the move never changed its values
+            factor = min_factor;
+        }
+        else if ( efficiencies[i] > 0.0 )
+        {
+            factor = std::min( max_factor, std::max( min_factor, std::sqrt( efficiencies[i] / mean_efficiency ) ) );
+        }
+
+        weights[i] = user_weights[i] * factor;
+        sum_of_weights += weights[i];
+        sum_of_user_weights += user_weights[i];
+    }
+
+    // keep the number of moves per iteration
+    if ( sum_of_weights > 0.0 )
+    {
+        for (size_t i = 0; i < weights.size(); ++i)
+        {
+            weights[i] *= sum_of_user_weights / sum_of_weights;
+        }
+    }
+
+}
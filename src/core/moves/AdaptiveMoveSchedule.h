@@ -0,0 +1,92 @@
+#ifndef AdaptiveMoveSchedule_H
+#define AdaptiveMoveSchedule_H
+
+#include <stddef.h>
+#include <chrono>
+#include <vector>
+
+#include "MoveSchedule.h"
+
+namespace RevBayesCore {
+class Move;
+template <class valueType> class RbVector;
+
+    /**
+     * @brief Random move schedule whose weights are adapted during burnin to maximize the effective samples per second.
+     *
+     * The moves are picked randomly in proportion to their weights, as in the random move schedule.
+     * While adapting (during burnin), we measure for each move its cost, i.e., the wall time of a call, and its gain,
+     * i.e., how much a call decorrelates the values of its variables. The gain of a call is the mean squared
+     * jump of the numeric values of its variables, standardized by their variance. For a single value this is 2(1-r), where r is the
+     * lag-one autocorrelation under this move. Of a vector we only follow a few evenly spaced elements, so a measurement is cheap.
+     * Moves of variables without numeric values, e.g., trees, gain 1 per accepted call. If such a move doesn't count
+     * its accepted calls, we cannot measure its gain and it keeps its user weight.
+     *
+     * The efficiency of a move is its gain per second. Periodically, the weight of every move is set to its user weight
+     * times the square root of its efficiency relative to the (geometric) mean efficiency of all moves, but not less than
+     * the minimal and not more than the maximal factor times the user weight. Then all weights are rescaled such that
+     * the number of moves per iteration is unchanged, so the factors bound the weights relative to each other.
+     * Hence cheap, well mixing moves are used more often, while every move keeps a positive weight and the schedule stays irreducible.
+     *
+     * The schedule only adapts while the moves adapt, i.e., during burnin (see Mcmc::setAdaptation).
+     * Otherwise the weights are frozen, so that the sampling phase is a Markov chain with fixed transition
+     * probabilities and detailed balance holds.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class AdaptiveMoveSchedule : public MoveSchedule  {
+
+    public:
+        AdaptiveMoveSchedule(RbVector<Move> *m, size_t min_calls = 20, double min_factor = 0.25, double max_factor = 4.0, size_t update_interval = 10, size_t max_values = 16);   //!< Default constructor
+        virtual                                        ~AdaptiveMoveSchedule(void);                                 //!< Destructor
+
+        // public methods
+        AdaptiveMoveSchedule*                           clone(void) const;
+        std::vector<double>                             getAdaptationState(void) const;                             //!< Get the adapted weights
+        double                                          getNumberMovesPerIteration(void) const;
+        const std::vector<double>&                      getWeights(void) const;                                     //!< The current (adapted) weights of the moves
+        void                                            moveFinished(void);                                         //!< Measure the move returned by nextMove()
+        Move&                                           nextMove(unsigned long g);
+        void                                            setAdaptationState(const std::vector<double> &s);           //!< Restore the adapted weights
+        void                                            setAdaptive(bool tf);                                       //!< Adapt the weights to the following moves?
+
+    private:
+
+        void                                            collectValues(size_t i, std::vector<double> &v) const;      //!< The numeric values (or a subset of them) of the variables of the i-th move
+        void                                            updateWeights(void);                                        //!< Set the weights from the measured efficiencies
+
+        // the settings
+        size_t                                          min_calls;                                                  //!< The number of measured calls of a move before we change its weight
+        double                                          min_factor;                                                 //!< The smallest adapted weight relative to the user weight (before rescaling)
+        double                                          max_factor;                                                 //!< The largest adapted weight relative to the user weight (before rescaling)
+        size_t                                          update_interval;                                            //!< The number of measured calls per move between two updates of the weights
+        size_t                                          max_values;                                                 //!< The number of elements of a vector variable that we follow
+
+        // Hidden member variables
+        double                                          moves_per_iteration;
+        std::vector<double>                             user_weights;
+        std::vector<double>                             weights;
+        bool                                            adaptive;
+
+        // the move in progress
+        size_t                                          current_move;                                               //!< The index of the last picked move (the number of moves if none is measured)
+        size_t                                          accepted_before;                                            //!< The number of accepted calls of the current move before this call
+        std::vector<double>                             values_before;                                              //!< The values of the variables of the current move before this call
+        std::vector<double>                             values_after;                                               //!< Work space for the values after the call
+        std::chrono::steady_clock::time_point           start_time;
+
+        // the statistics per move
+        std::vector<size_t>                             num_calls;
+        std::vector<size_t>                             num_accepted;                                               //!< The number of calls that the move counted as accepted
+        std::vector<double>                             total_time;                                                 //!< Seconds
+        std::vector<double>                             total_gain;
+        std::vector<std::vector<double> >               value_means;                                                //!< Running means of the values of the variables of the move
+        std::vector<std::vector<double> >               value_sums_of_squares;                                      //!< Running sums of squared deviations (Welford)
+        size_t                                          num_measured_since_update;
+    };
+
+}
+
+#endif
@@ -0,0 +1,1383 @@
+#include "HamiltonianMonteCarloMove.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "DagNode.h"
+#include "DistributionNormal.h"
+#include "RandomNumberFactory.h"
+#include "RandomNumberGenerator.h"
+#include "RbConstants.h"
+#include "RbException.h"
+#include "RbMathLogic.h"
+#include "RbVector.h"
+#include "StochasticNode.h"
+#include "TopologyNode.h"
+#include "Tree.h"
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // the parameters of dual averaging for the step size (Hoffman & Gelman 2014)
+    const double    DUAL_AVERAGING_GAMMA = 0.05;
+    const double    DUAL_AVERAGING_T0    = 10.0;
+    const double    DUAL_AVERAGING_KAPPA = 0.75;
+
+    /**
+     * Compute log(exp(a) + exp(b)) without overflow.
+     */
+    double logSumExp(double a, double b)
+    {
+        if ( a == RbConstants::Double::neginf )
+        {
+            return b;
+        }
+        if ( b == RbConstants::Double::neginf )
+        {
+            return a;
+        }
+
+        return ( a > b ? a + log1p( exp(b - a) ) : b + log1p( exp(a - b) ) );
+    }
+
+}
+
+
+/**
+ * Constructor
+ *
+ * Here we simply allocate and initialize the move object. The variables are added afterwards.
+ *
+ * \param[in]    eps     The initial step size of the leapfrog integrator.
+ * \param[in]    d       The maximal depth of the trajectory tree (at most 2^d leapfrog steps).
+ * \param[in]    t       The target acceptance statistic for tuning the step size.
+ * \param[in]    w       The weight how often the proposal will be used (per iteration).
+ * \param[in]    at      If auto tuning should be used.
+ */
+HamiltonianMonteCarloMove::HamiltonianMonteCarloMove( double eps, size_t d, double t, double w, bool at ) : AbstractMove( std::vector<DagNode*>(), w, at ),
+    dim( 0 ),
+    affected_nodes_dirty( true ),
+    step_size( eps ),
+    max_tree_depth( d ),
+    target_acceptance( t ),
+    pr_heat( 1.0 ),
+    l_heat( 1.0 ),
+    p_heat( 1.0 ),
+    max_delta_h( 1000.0 ),
+    numerical_epsilon( 1E-5 ),
+    dual_averaging_mu( log( 10.0 * eps ) ),
+    dual_averaging_h_bar( 0.0 ),
+    dual_averaging_ln_step_size_bar( 0.0 ),
+    dual_averaging_iteration( 0 ),
+    sum_acceptance_statistic( 0.0 ),
+    num_leapfrog_steps( 0 ),
+    num_divergent( 0 ),
+    num_window_samples( 0 ),
+    window_size( 25 )
+{
+
+}
+
+
+/**
+ * Basic destructor doing nothing.
+ */
+HamiltonianMonteCarloMove::~HamiltonianMonteCarloMove( void )
+{
+
+}
+
+
+/**
+ * Add a scalar variable with the given bounds, which may be infinite.
+ * We shift the variable to a finite bound and log transform it, or logit transform it if both bounds are finite.
+ */
+void HamiltonianMonteCarloMove::addBoundedScalar(StochasticNode<double> *v, double lower, double upper)
+{
+
+    bool lower_finite = RbMath::isFinite(lower);
+    bool upper_finite = RbMath::isFinite(upper);
+    if ( lower_finite == true && upper_finite == true && lower >= upper )
+    {
+        throw RbException("The HMC move needs a variable whose lower bound is smaller than its upper bound.");
+    }
+
+    if ( lower_finite == true && upper_finite == true )
+    {
+        addVariable(v, SCALAR, LOGIT, lower, upper);
+    }
+    else if ( lower_finite == true )
+    {
+        addVariable(v, SCALAR, LOG_LOWER, lower, upper);
+    }
+    else if ( upper_finite == true )
+    {
+        addVariable(v, SCALAR, LOG_UPPER, lower, upper);
+    }
+    else
+    {
+        addVariable(v, SCALAR, UNTRANSFORMED, lower, upper);
+    }
+
+}
+
+
+void HamiltonianMonteCarloMove::addBranchLengths(StochasticNode<Tree> *v)
+{
+
+    addVariable(v, BRANCH_LENGTHS, LOG_LOWER, 0.0, RbConstants::Double::inf);
+
+}
+
+
+void HamiltonianMonteCarloMove::addLogVector(StochasticNode<RbVector<double> > *v)
+{
+
+    addVariable(v, VECTOR, LOG_LOWER, 0.0, RbConstants::Double::inf);
+
+}
+
+
+void HamiltonianMonteCarloMove::addNodeAges(StochasticNode<Tree> *v)
+{
+
+    if ( v->getValue().isRooted() == false )
+    {
+        throw RbException("The HMC move can only update the node ages of a rooted tree.");
+    }
+
+    addVariable(v, NODE_AGES, RATIO, 0.0, RbConstants::Double::inf);
+
+}
+
+
+/**
+ * Add the gradient g of the i-th variable on its own scale to the gradient on the unconstrained scale (chain rule),
+ * together with the gradient of the ln Jacobian. We use the current values of the variables, i.e., the position that was set last.
+ * For a tree, g is indexed by node and taken with respect to the branch lengths.
+ */
+void HamiltonianMonteCarloMove::addTransformedGradient(size_t i, const std::vector<double> &g, std::vector<double> &gradient) const
+{
+
+    size_t offset = offsets[i];
+
+    if ( variable_types[i] == BRANCH_LENGTHS )
+    {
+        const Tree &tree = static_cast<StochasticNode<Tree>* >( variables[i] )->getValue();
+        for (size_t k = 0; k < dimensions[i]; ++k)
+        {
+            size_t index = tree_nodes[i][k];
+            gradient[offset + k] += g[index] * tree.getNode( index ).getBranchLength() + 1.0;
+        }
+    }
+    else if ( variable_types[i] == NODE_AGES )
+    {
+        const Tree &tree = static_cast<StochasticNode<Tree>* >( variables[i] )->getValue();
+        const std::vector<size_t> &order = tree_nodes[i];
+        const std::vector<double> &anchor = anchor_ages[i];
+
+        // the gradient with respect to the ages, including the ln Jacobian terms ln(t_parent - anchor)
+        std::vector<double> g_age( tree.getNumberOfNodes(), 0.0 );
+        for (size_t k = 0; k < order.size(); ++k)
+        {
+            const TopologyNode &node = tree.getNode( order[k] );
+            for (size_t j = 0; j < node.getNumberOfChildren(); ++j)
+            {
+                g_age[ order[k] ] += g[ node.getChild( j ).getIndex() ];
+            }
+            g_age[ order[k] ] -= g[ order[k] ];
+            g_age[ node.getParent().getIndex() ] += 1.0 / (node.getParent().getAge() - anchor[ order[k] ]);
+        }
+
+        // back-propagate through the ratios, children before parents (the entry of the root is not used)
+        for (size_t k = order.size(); k > 0; --k)
+        {
+            size_t index = order[k - 1];
+            const TopologyNode &node = tree.getNode( index );
+            size_t parent_index = node.getParent().getIndex();
+            double width = node.getParent().getAge() - anchor[index];
+            double r = (node.getAge() - anchor[index]) / width;
+            gradient[offset + k - 1] += g_age[index] * width * r * (1.0 - r) + 1.0 - 2.0 * r;
+            g_age[parent_index] += g_age[index] * r;
+        }
+    }
+    else
+    {
+        for (size_t k = 0; k < dimensions[i]; ++k)
+        {
+            double x = 0.0;
+            if ( variable_types[i] == VECTOR )
+            {
+                x = static_cast<StochasticNode<RbVector<double> >* >( variables[i] )->getValue()[k];
+            }
+            else
+            {
+                x = static_cast<StochasticNode<double>* >( variables[i] )->getValue();
+            }
+
+            double &gradient_k = gradient[offset + k];
+            if ( transforms[i] == LOG_LOWER )
+            {
+                gradient_k += g[k] * (x - lower_bounds[i]) + 1.0;
+            }
+            else if ( transforms[i] == LOG_UPPER )
+            {
+                gradient_k += -g[k] * (upper_bounds[i] - x) + 1.0;
+            }
+            else if ( transforms[i] == LOGIT )
+            {
+                double width = upper_bounds[i] - lower_bounds[i];
+                double s = (x - lower_bounds[i]) / width;
+                gradient_k += g[k] * width * s * (1.0 - s) + 1.0 - 2.0 * s;
+            }
+            else
+            {
+                gradient_k += g[k];
+            }
+        }
+    }
+
+}
+
+
+void HamiltonianMonteCarloMove::addUntransformedScalar(StochasticNode<double> *v)
+{
+
+    addVariable(v, SCALAR, UNTRANSFORMED, RbConstants::Double::neginf, RbConstants::Double::inf);
+
+}
+
+
+void HamiltonianMonteCarloMove::addUntransformedVector(StochasticNode<RbVector<double> > *v)
+{
+
+    addVariable(v, VECTOR, UNTRANSFORMED, RbConstants::Double::neginf, RbConstants::Double::inf);
+
+}
+
+
+void HamiltonianMonteCarloMove::addVariable(DagNode *v, VARIABLE_TYPE vt, TRANSFORM t, double lower, double upper)
+{
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( variables[i] == v )
+        {
+            throw RbException("The variable '" + v->getName() + "' is already updated by this HMC move.");
+        }
+    }
+
+    if ( v->isClamped() == true )
+    {
+        throw RbException("Cannot update the clamped variable '" + v->getName() + "' with an HMC move.");
+    }
+
+    variables.push_back( v );
+    variable_types.push_back( vt );
+    transforms.push_back( t );
+    lower_bounds.push_back( lower );
+    upper_bounds.push_back( upper );
+
+    addNode( v );
+
+    affected_nodes_dirty = true;
+
+}
+
+
+/**
+ * Build a subtree of the trajectory by doubling (see Hoffman & Gelman 2014; Betancourt 2017).
+ * A tree of depth 0 is a single leapfrog step. The states of the subtree are weighted by exp(H0-H) and
+ * z_propose is drawn from the subtree with probability proportional to these weights.
+ * The function returns false if the subtree diverged or made a U-turn.
+ */
+bool HamiltonianMonteCarloMove::buildTree(PhasePoint &z, size_t depth, double direction, double h0, PhasePoint &z_propose, std::vector<double> &p_sharp_begin, std::vector<double> &p_sharp_end, std::vector<double> &rho, std::vector<double> &p_begin, std::vector<double> &p_end, double &ln_sum_weight, double &sum_metropolis_prob, size_t &n_leapfrog, bool &divergent)
+{
+
+    if ( depth == 0 )
+    {
+        leapfrog(z, direction * step_size);
+        ++n_leapfrog;
+
+        double h = getHamiltonian(z);
+        if ( h - h0 > max_delta_h )
+        {
+            divergent = true;
+        }
+
+        ln_sum_weight = logSumExp(ln_sum_weight, h0 - h);
+        sum_metropolis_prob += ( h0 - h > 0.0 ? 1.0 : exp(h0 - h) );
+
+        z_propose = z;
+
+        for (size_t i = 0; i < dim; ++i)
+        {
+            p_sharp_begin[i] = inverse_mass[i] * z.p[i];
+            rho[i] += z.p[i];
+        }
+        p_sharp_end = p_sharp_begin;
+        p_begin = z.p;
+        p_end = z.p;
+
+        return divergent == false;
+    }
+
+    // the first half of the subtree
+    double ln_sum_weight_init = RbConstants::Double::neginf;
+    std::vector<double> p_init_end( dim, 0.0 );
+    std::vector<double> p_sharp_init_end( dim, 0.0 );
+    std::vector<double> rho_init( dim, 0.0 );
+
+    bool valid_init = buildTree(z, depth - 1, direction, h0, z_propose, p_sharp_begin, p_sharp_init_end, rho_init, p_begin, p_init_end, ln_sum_weight_init, sum_metropolis_prob, n_leapfrog, divergent);
+    if ( valid_init == false )
+    {
+        return false;
+    }
+
+    // the second half of the subtree
+    PhasePoint z_propose_final = z;
+    double ln_sum_weight_final = RbConstants::Double::neginf;
+    std::vector<double> p_final_begin( dim, 0.0 );
+    std::vector<double> p_sharp_final_begin( dim, 0.0 );
+    std::vector<double> rho_final( dim, 0.0 );
+
+    bool valid_final = buildTree(z, depth - 1, direction, h0, z_propose_final, p_sharp_final_begin, p_sharp_end, rho_final, p_final_begin, p_end, ln_sum_weight_final, sum_metropolis_prob, n_leapfrog, divergent);
+    if ( valid_final == false )
+    {
+        return false;
+    }
+
+    // multinomial sample from the two halves
+    double ln_sum_weight_subtree = logSumExp(ln_sum_weight_init, ln_sum_weight_final);
+    ln_sum_weight = logSumExp(ln_sum_weight, ln_sum_weight_subtree);
+
+    double accept_prob = exp(ln_sum_weight_final - ln_sum_weight_subtree);
+    if ( GLOBAL_RNG->uniform01() < accept_prob )
+    {
+        z_propose = z_propose_final;
+    }
+
+    // check for a U-turn across the subtree and across the merged halves
+    std::vector<double> rho_subtree( dim, 0.0 );
+    std::vector<double> rho_extended_init( dim, 0.0 );
+    std::vector<double> rho_extended_final( dim, 0.0 );
+    for (size_t i = 0; i < dim; ++i)
+    {
+        rho_subtree[i]        = rho_init[i] + rho_final[i];
+        rho_extended_init[i]  = rho_init[i] + p_final_begin[i];
+        rho_extended_final[i] = rho_final[i] + p_init_end[i];
+        rho[i]               += rho_subtree[i];
+    }
+
+    bool persist = computeNoUTurnCriterion(p_sharp_begin, p_sharp_end, rho_subtree);
+    persist &= computeNoUTurnCriterion(p_sharp_begin, p_sharp_final_begin, rho_extended_init);
+    persist &= computeNoUTurnCriterion(p_sharp_init_end, p_sharp_end, rho_extended_final);
+
+    return persist;
+}
+
+
+/**
+ * The clone function is a convenience function to create proper copies of inherited objected.
+ * E.g. a.clone() will create a clone of the correct type even if 'a' is of derived type 'b'.
+ *
+ * \return A new copy of the move.
+ */
+HamiltonianMonteCarloMove* HamiltonianMonteCarloMove::clone( void ) const
+{
+
+    return new HamiltonianMonteCarloMove( *this );
+}
+
+
+/**
+ * Compute the heated ln posterior contribution of the given nodes.
+ * Clamped nodes contribute to the likelihood and all other nodes to the prior.
+ */
+double HamiltonianMonteCarloMove::computeLnPosterior(const RbOrderedSet<DagNode*> &n)
+{
+
+    double ln_prior = 0.0;
+    double ln_likelihood = 0.0;
+
+    for (RbOrderedSet<DagNode*>::const_iterator it = n.begin(); it != n.end(); ++it)
+    {
+        if ( (*it)->isClamped() == true )
+        {
+            ln_likelihood += (*it)->getLnProbability();
+        }
+        else
+        {
+            ln_prior += (*it)->getLnProbability();
+        }
+    }
+
+    return p_heat * (l_heat * ln_likelihood + pr_heat * ln_prior);
+}
+
+
+/**
+ * The generalized No-U-Turn criterion: the trajectory keeps going as long as the
+ * momenta at both ends point in the direction of the summed momenta.
+ */
+bool HamiltonianMonteCarloMove::computeNoUTurnCriterion(const std::vector<double> &p_sharp_minus, const std::vector<double> &p_sharp_plus, const std::vector<double> &rho) const
+{
+
+    double minus = 0.0;
+    double plus  = 0.0;
+    for (size_t i = 0; i < dim; ++i)
+    {
+        minus += p_sharp_minus[i] * rho[i];
+        plus  += p_sharp_plus[i] * rho[i];
+    }
+
+    return minus > 0.0 && plus > 0.0;
+}
+
+
+/**
+ * Set the variables to the position z.q and compute the ln target density,
+ * i.e., the heated ln posterior plus the ln Jacobian of the transformation.
+ * The new state is kept in the DAG.
+ *
+ * We first try to compute the gradient by reverse-mode differentiation through the DAG.
+ * For the variables where this is not possible, the gradient is assembled per node: we ask the variable itself and every stochastic node
+ * that depends on it for an analytic gradient and use central differences on the unconstrained scale for the nodes which cannot provide one.
+ */
+void HamiltonianMonteCarloMove::evaluate(PhasePoint &z, bool compute_gradient)
+{
+
+    double ln_jacobian = setValues( z.q );
+
+    touchVariables();
+
+    double ln_posterior = affected_nodes.size() > 0 ? computeLnPosterior(affected_nodes) : 0.0;
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        ln_posterior += p_heat * pr_heat * variables[i]->getLnProbability();
+    }
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        variables[i]->keep();
+    }
+
+    z.ln_target = ln_posterior + ln_jacobian;
+    if ( RbMath::isFinite( z.ln_target ) == false )
+    {
+        // the trajectory will be rejected as divergent anyways
+        z.ln_target = RbConstants::Double::neginf;
+        z.gradient.assign( dim, 0.0 );
+        return;
+    }
+
+    if ( compute_gradient == false )
+    {
+        return;
+    }
+
+    z.gradient.assign( dim, 0.0 );
+
+    std::vector<std::vector<double> > dag_g;
+    std::vector<bool> dag_g_available;
+    dag_gradient.computeGradient(pr_heat, l_heat, p_heat, dag_g, dag_g_available);
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        DagNode *v = variables[i];
+        size_t offset = offsets[i];
+        size_t n = dimensions[i];
+
+        // the gradient on the scale of the variable
+        std::vector<double> g_x( getGradientSize(i), 0.0 );
+
+        if ( dag_g_available[i] == true && (dag_g[i].size() == g_x.size() || dag_g[i].empty() == true) )
+        {
+            for (size_t k = 0; k < dag_g[i].size(); ++k)
+            {
+                g_x[k] = dag_g[i][k];
+            }
+            addTransformedGradient(i, g_x, z.gradient);
+            continue;
+        }
+
+        RbOrderedSet<DagNode*> numeric_nodes;
+
+        // the variable itself and all the stochastic nodes that depend on it
+        std::vector<DagNode*> nodes_to_differentiate( 1, v );
+        for (RbOrderedSet<DagNode*>::const_iterator it = variable_affected_nodes[i].begin(); it != variable_affected_nodes[i].end(); ++it)
+        {
+            nodes_to_differentiate.push_back( *it );
+        }
+
+        for (size_t j = 0; j < nodes_to_differentiate.size(); ++j)
+        {
+            DagNode *node = nodes_to_differentiate[j];
+            double heat = p_heat * ( node->isClamped() == true ? l_heat : pr_heat );
+
+            std::vector<double> g;
+            if ( node->getLnProbabilityGradient(v, g) == true && g.size() == g_x.size() )
+            {
+                for (size_t k = 0; k < g_x.size(); ++k)
+                {
+                    g_x[k] += heat * g[k];
+                }
+            }
+            else
+            {
+                numeric_nodes.insert( node );
+            }
+        }
+
+        if ( numeric_nodes.size() > 0 )
+        {
+            std::vector<double> q = z.q;
+
+            for (size_t k = 0; k < n; ++k)
+            {
+                q[offset + k] = z.q[offset + k] + numerical_epsilon;
+                setValues( q );
+                v->touch();
+                double ln_posterior_plus = computeLnPosterior(numeric_nodes);
+
+                q[offset + k] = z.q[offset + k] - numerical_epsilon;
+                setValues( q );
+                v->touch();
+                double ln_posterior_minus = computeLnPosterior(numeric_nodes);
+
+                z.gradient[offset + k] += (ln_posterior_plus - ln_posterior_minus) / (2.0 * numerical_epsilon);
+
+                // reset the value and restore the probabilities of the kept state
+                q[offset + k] = z.q[offset + k];
+                setValues( q );
+                v->restore();
+            }
+        }
+
+        addTransformedGradient(i, g_x, z.gradient);
+    }
+
+}
+
+
+/**
+ * Get the state of the adaptation: the step size, the dual averaging state, the statistics,
+ * the current adaptation window and the diagonal of the inverse mass matrix.
+ */
+std::vector<double> HamiltonianMonteCarloMove::getAdaptationState( void ) const
+{
+
+    std::vector<double> state;
+    state.push_back( step_size );
+    state.push_back( dual_averaging_mu );
+    state.push_back( dual_averaging_h_bar );
+    state.push_back( dual_averaging_ln_step_size_bar );
+    state.push_back( dual_averaging_iteration );
+    state.push_back( sum_acceptance_statistic );
+    state.push_back( num_leapfrog_steps );
+    state.push_back( num_divergent );
+    state.push_back( num_window_samples );
+    state.push_back( window_size );
+    state.push_back( inverse_mass.size() );
+    state.insert( state.end(), inverse_mass.begin(), inverse_mass.end() );
+    state.insert( state.end(), window_mean.begin(), window_mean.end() );
+    state.insert( state.end(), window_m2.begin(), window_m2.end() );
+
+    return state;
+}
+
+
+double HamiltonianMonteCarloMove::getHamiltonian(const PhasePoint &z) const
+{
+
+    if ( RbMath::isFinite( z.ln_target ) == false )
+    {
+        return RbConstants::Double::inf;
+    }
+
+    double kinetic_energy = 0.0;
+    for (size_t i = 0; i < dim; ++i)
+    {
+        kinetic_energy += inverse_mass[i] * z.p[i] * z.p[i];
+    }
+
+    return -z.ln_target + 0.5 * kinetic_energy;
+}
+
+
+/**
+ * Get moves' name of object
+ *
+ * \return The moves' name.
+ */
+const std::string& HamiltonianMonteCarloMove::getMoveName( void ) const
+{
+
+    static std::string name = "HamiltonianMonteCarlo";
+
+    return name;
+}
+
+
+double HamiltonianMonteCarloMove::getMoveTuningParameter( void ) const
+{
+
+    return step_size;
+}
+
+
+/**
+ * The size of the gradient of the i-th variable on its own scale.
+ * This is the number of nodes for a tree and the dimension otherwise.
+ */
+size_t HamiltonianMonteCarloMove::getGradientSize(size_t i) const
+{
+
+    if ( variable_types[i] == BRANCH_LENGTHS || variable_types[i] == NODE_AGES )
+    {
+        return static_cast<StochasticNode<Tree>* >( variables[i] )->getValue().getNumberOfNodes();
+    }
+
+    return dimensions[i];
+}
+
+
+/**
+ * Get the current values of the variables on the unconstrained scale.
+ */
+void HamiltonianMonteCarloMove::getValues(std::vector<double> &q) const
+{
+
+    q.resize( dim );
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( variable_types[i] == BRANCH_LENGTHS || variable_types[i] == NODE_AGES )
+        {
+            const Tree &tree = static_cast<StochasticNode<Tree>* >( variables[i] )->getValue();
+            for (size_t k = 0; k < dimensions[i]; ++k)
+            {
+                const TopologyNode &node = tree.getNode( tree_nodes[i][k] );
+                double &q_k = q[offsets[i] + k];
+                if ( variable_types[i] == BRANCH_LENGTHS )
+                {
+                    q_k = log( node.getBranchLength() );
+                }
+                else
+                {
+                    double anchor = anchor_ages[i][node.getIndex()];
+                    double r = (node.getAge() - anchor) / (node.getParent().getAge() - anchor);
+                    q_k = log( r ) - log1p( -r );
+                }
+            }
+            continue;
+        }
+
+        for (size_t k = 0; k < dimensions[i]; ++k)
+        {
+            double x = 0.0;
+            if ( variable_types[i] == VECTOR )
+            {
+                x = static_cast<StochasticNode<RbVector<double> >* >( variables[i] )->getValue()[k];
+            }
+            else
+            {
+                x = static_cast<StochasticNode<double>* >( variables[i] )->getValue();
+            }
+
+            double &q_k = q[offsets[i] + k];
+            if ( transforms[i] == LOG_LOWER )
+            {
+                q_k = log( x - lower_bounds[i] );
+            }
+            else if ( transforms[i] == LOG_UPPER )
+            {
+                q_k = log( upper_bounds[i] - x );
+            }
+            else if ( transforms[i] == LOGIT )
+            {
+                double s = (x - lower_bounds[i]) / (upper_bounds[i] - lower_bounds[i]);
+                q_k = log( s ) - log1p( -s );
+            }
+            else
+            {
+                q_k = x;
+            }
+        }
+    }
+
+}
+
+
+/**
+ * One step of the leapfrog integrator with step size eps.
+ * The position z.q is on the unconstrained scale and the momentum is scaled by the mass matrix.
+ */
+void HamiltonianMonteCarloMove::leapfrog(PhasePoint &z, double eps)
+{
+
+    for (size_t i = 0; i < dim; ++i)
+    {
+        z.p[i] += 0.5 * eps * z.gradient[i];
+    }
+
+    for (size_t i = 0; i < dim; ++i)
+    {
+        z.q[i] += eps * inverse_mass[i] * z.p[i];
+    }
+
+    evaluate(z, true);
+
+    for (size_t i = 0; i < dim; ++i)
+    {
+        z.p[i] += 0.5 * eps * z.gradient[i];
+    }
+
+}
+
+
+/**
+ * Perform one NUTS transition with multinomial sampling of the new state from the trajectory.
+ * The trajectory is extended in a random direction by doubling until it makes a U-turn,
+ * diverges, or reaches the maximal tree depth.
+ */
+void HamiltonianMonteCarloMove::performMcmcMove( double prHeat, double lHeat, double pHeat )
+{
+
+    if ( variables.empty() == true )
+    {
+        throw RbException("The HMC move has no variables to update.");
+    }
+
+    if ( affected_nodes_dirty == true )
+    {
+        updateAffectedNodes();
+    }
+
+    // other moves may have changed the topologies since the last call
+    updateTreeParameterization();
+
+    pr_heat = prHeat;
+    l_heat  = lHeat;
+    p_heat  = pHeat;
+
+    RandomNumberGenerator* rng = GLOBAL_RNG;
+
+    // the current state
+    PhasePoint z;
+    getValues( z.q );
+    z.p.resize( dim );
+    for (size_t i = 0; i < dim; ++i)
+    {
+        z.p[i] = RbStatistics::Normal::rv( *rng ) / sqrt( inverse_mass[i] );
+    }
+    evaluate(z, true);
+
+    double h0 = getHamiltonian( z );
+
+    PhasePoint z_forward = z;
+    PhasePoint z_backward = z;
+    PhasePoint z_sample = z;
+    PhasePoint z_propose = z;
+
+    std::vector<double> p_sharp( dim, 0.0 );
+    for (size_t i = 0; i < dim; ++i)
+    {
+        p_sharp[i] = inverse_mass[i] * z.p[i];
+    }
+
+    std::vector<double> p_forward_forward = z.p;
+    std::vector<double> p_sharp_forward_forward = p_sharp;
+    std::vector<double> p_forward_backward = z.p;
+    std::vector<double> p_sharp_forward_backward = p_sharp;
+    std::vector<double> p_backward_forward = z.p;
+    std::vector<double> p_sharp_backward_forward = p_sharp;
+    std::vector<double> p_backward_backward = z.p;
+    std::vector<double> p_sharp_backward_backward = p_sharp;
+
+    std::vector<double> rho = z.p;
+    double ln_sum_weight = 0.0;
+    double sum_metropolis_prob = 0.0;
+    size_t n_leapfrog = 0;
+    bool divergent = false;
+
+    for (size_t depth = 0; depth < max_tree_depth; ++depth)
+    {
+        std::vector<double> rho_forward( dim, 0.0 );
+        std::vector<double> rho_backward( dim, 0.0 );
+        double ln_sum_weight_subtree = RbConstants::Double::neginf;
+        bool valid_subtree = false;
+
+        if ( rng->uniform01() < 0.5 )
+        {
+            // extend the trajectory forward
+            rho_backward = rho;
+            p_backward_forward = p_forward_backward;
+            p_sharp_backward_forward = p_sharp_forward_backward;
+
+            z = z_forward;
+            valid_subtree = buildTree(z, depth, 1.0, h0, z_propose, p_sharp_forward_backward, p_sharp_forward_forward, rho_forward, p_forward_backward, p_forward_forward, ln_sum_weight_subtree, sum_metropolis_prob, n_leapfrog, divergent);
+            z_forward = z;
+        }
+        else
+        {
+            // extend the trajectory backward
+            rho_forward = rho;
+            p_forward_backward = p_backward_forward;
+            p_sharp_forward_backward = p_sharp_backward_forward;
+
+            z = z_backward;
+            valid_subtree = buildTree(z, depth, -1.0, h0, z_propose, p_sharp_backward_forward, p_sharp_backward_backward, rho_backward, p_backward_forward, p_backward_backward, ln_sum_weight_subtree, sum_metropolis_prob, n_leapfrog, divergent);
+            z_backward = z;
+        }
+
+        if ( valid_subtree == false )
+        {
+            break;
+        }
+
+        // sample from the new subtree, biased towards the new subtree
+        if ( ln_sum_weight_subtree > ln_sum_weight || rng->uniform01() < exp(ln_sum_weight_subtree - ln_sum_weight) )
+        {
+            z_sample = z_propose;
+        }
+        ln_sum_weight = logSumExp(ln_sum_weight, ln_sum_weight_subtree);
+
+        // check for a U-turn of the whole trajectory
+        std::vector<double> rho_extended_backward( dim, 0.0 );
+        std::vector<double> rho_extended_forward( dim, 0.0 );
+        for (size_t i = 0; i < dim; ++i)
+        {
+            rho[i] = rho_backward[i] + rho_forward[i];
+            rho_extended_backward[i] = rho_backward[i] + p_forward_backward[i];
+            rho_extended_forward[i]  = rho_forward[i] + p_backward_forward[i];
+        }
+
+        bool persist = computeNoUTurnCriterion(p_sharp_backward_backward, p_sharp_forward_forward, rho);
+        persist &= computeNoUTurnCriterion(p_sharp_backward_backward, p_sharp_forward_backward, rho_extended_backward);
+        persist &= computeNoUTurnCriterion(p_sharp_backward_forward, p_sharp_forward_forward, rho_extended_forward);
+
+        if ( persist == false )
+        {
+            break;
+        }
+    }
+
+    // set the DAG to the sampled state
+    evaluate(z_sample, false);
+
+    double acceptance_statistic = ( n_leapfrog > 0 ? sum_metropolis_prob / n_leapfrog : 0.0 );
+    sum_acceptance_statistic += acceptance_statistic;
+    num_leapfrog_steps += n_leapfrog;
+    if ( divergent == true )
+    {
+        ++num_divergent;
+    }
+
+    // adapt the step size and collect the samples for estimating the mass matrix, but only during burnin
+    if ( auto_tuning == true && adapting == true )
+    {
+        updateStepSize( acceptance_statistic );
+
+        ++num_window_samples;
+        for (size_t i = 0; i < dim; ++i)
+        {
+            double delta = z_sample.q[i] - window_mean[i];
+            window_mean[i] += delta / num_window_samples;
+            window_m2[i] += delta * (z_sample.q[i] - window_mean[i]);
+        }
+    }
+
+}
+
+
+/**
+ * Print the summary of the move.
+ *
+ * The summary contains the average acceptance statistic, trajectory length and number of divergent transitions.
+ * It is printed to the stream that it passed in.
+ *
+ * \param[in]     o     The stream to which we print the summary.
+ */
+void HamiltonianMonteCarloMove::printSummary(std::ostream &o, bool current_period) const
+{
+
+    std::streamsize previousPrecision = o.precision();
+    std::ios_base::fmtflags previousFlags = o.flags();
+
+    o << std::fixed;
+    o << std::setprecision(4);
+
+    // print the name
+    const std::string &n = getMoveName();
+    size_t spaces = 40 - (n.length() > 40 ? 40 : n.length());
+    o << n;
+    for (size_t i = 0; i < spaces; ++i)
+    {
+        o << " ";
+    }
+    o << " ";
+
+    // print the DagNode name
+    const std::string &dn_name = (*nodes.begin())->getName();
+    spaces = 20 - (dn_name.length() > 20 ? 20 : dn_name.length());
+    o << dn_name;
+    for (size_t i = 0; i < spaces; ++i)
+    {
+        o << " ";
+    }
+    o << " ";
+
+    // print the weight
+    int w_length = 4;
+    if (weight > 0) w_length -= (int)log10(weight);
+    for (int i = 0; i < w_length; ++i)
+    {
+        o << " ";
+    }
+    o << weight;
+    o << " ";
+
+    // print the number of tries
+    size_t num_tried = ( current_period == true ? num_tried_current_period : num_tried_total );
+    int t_length = 9;
+    if (num_tried > 0) t_length -= (int)log10(num_tried);
+    for (int i = 0; i < t_length; ++i)
+    {
+        o << " ";
+    }
+    o << num_tried;
+    o << " ";
+
+    o << std::endl;
+    if ( num_tried_current_period > 0 )
+    {
+        o << "  Ave. acceptance statistic = " << sum_acceptance_statistic / num_tried_current_period << std::endl;
+        o << "  Ave. # of leapfrog steps = " << double(num_leapfrog_steps) / num_tried_current_period << std::endl;
+        o << "  # of divergent transitions = " << num_divergent << std::endl;
+    }
+    o << "  step size = " << step_size << std::endl;
+
+    o << std::endl;
+
+    o.setf(previousFlags);
+    o.precision(previousPrecision);
+
+}
+
+
+/**
+ * Remove a variable from the move.
+ */
+void HamiltonianMonteCarloMove::removeVariable(DagNode *v)
+{
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( variables[i] == v )
+        {
+            variables.erase( variables.begin() + i );
+            variable_types.erase( variable_types.begin() + i );
+            transforms.erase( transforms.begin() + i );
+            lower_bounds.erase( lower_bounds.begin() + i );
+            upper_bounds.erase( upper_bounds.begin() + i );
+
+            // this may delete the node
+            removeNode( v );
+
+            affected_nodes_dirty = true;
+            break;
+        }
+    }
+
+}
+
+
+/**
+ * Reset the move counters. The adaptation window of the mass matrix is kept.
+ */
+void HamiltonianMonteCarloMove::resetMoveCounters( void )
+{
+
+    sum_acceptance_statistic = 0.0;
+    num_leapfrog_steps = 0;
+    num_divergent = 0;
+
+}
+
+
+/**
+ * Restart dual averaging, shrinking towards ten times the current step size (as in Stan).
+ */
+void HamiltonianMonteCarloMove::restartStepSizeAdaptation( void )
+{
+
+    dual_averaging_mu = log( 10.0 * step_size );
+    dual_averaging_h_bar = 0.0;
+    dual_averaging_ln_step_size_bar = 0.0;
+    dual_averaging_iteration = 0;
+
+}
+
+
+/**
+ * Start or stop the adaptation phase (burnin).
+ * When we stop, the step size is fixed to the averaged step size of dual averaging.
+ */
+void HamiltonianMonteCarloMove::setAdaptation(bool tf)
+{
+
+    if ( auto_tuning == true && tf == true && adapting == false )
+    {
+        restartStepSizeAdaptation();
+    }
+    else if ( auto_tuning == true && tf == false && adapting == true && dual_averaging_iteration > 0 )
+    {
+        step_size = exp( dual_averaging_ln_step_size_bar );
+    }
+
+    AbstractMove::setAdaptation( tf );
+
+}
+
+
+/**
+ * Restore the state from getAdaptationState.
+ * The mass matrix is kept by updateAffectedNodes as long as it matches the dimension of the variables.
+ */
+void HamiltonianMonteCarloMove::setAdaptationState(const std::vector<double> &s)
+{
+
+    if ( s.size() < 11 || s.size() != 11 + 3 * size_t( s[10] ) )
+    {
+        throw RbException("The checkpointed state of the HMC move is corrupt.");
+    }
+
+    step_size                       = s[0];
+    dual_averaging_mu               = s[1];
+    dual_averaging_h_bar            = s[2];
+    dual_averaging_ln_step_size_bar = s[3];
+    dual_averaging_iteration        = size_t( s[4] );
+    sum_acceptance_statistic        = s[5];
+    num_leapfrog_steps              = size_t( s[6] );
+    num_divergent                   = size_t( s[7] );
+    num_window_samples              = size_t( s[8] );
+    window_size                     = size_t( s[9] );
+
+    size_t n = size_t( s[10] );
+    inverse_mass.assign( s.begin() + 11, s.begin() + 11 + n );
+    window_mean.assign( s.begin() + 11 + n, s.begin() + 11 + 2 * n );
+    window_m2.assign( s.begin() + 11 + 2 * n, s.end() );
+
+}
+
+
+void HamiltonianMonteCarloMove::setMoveTuningParameter(double tp)
+{
+
+    step_size = tp;
+
+}
+
+
+/**
+ * Set the variables to the position q (on the unconstrained scale) and return the ln Jacobian of the transformation.
+ * The node ages are set in pre-order, so that the age of the parent is known when we apply the ratio.
+ */
+double HamiltonianMonteCarloMove::setValues(const std::vector<double> &q)
+{
+
+    double ln_jacobian = 0.0;
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( variable_types[i] == BRANCH_LENGTHS || variable_types[i] == NODE_AGES )
+        {
+            Tree &tree = static_cast<StochasticNode<Tree>* >( variables[i] )->getValue();
+            for (size_t k = 0; k < dimensions[i]; ++k)
+            {
+                double q_k = q[offsets[i] + k];
+                TopologyNode &node = tree.getNode( tree_nodes[i][k] );
+                if ( variable_types[i] == BRANCH_LENGTHS )
+                {
+                    node.setBranchLength( exp( q_k ) );
+                    ln_jacobian += q_k;
+                }
+                else
+                {
+                    double anchor = anchor_ages[i][node.getIndex()];
+                    double width = node.getParent().getAge() - anchor;
+                    double r = 1.0 / (1.0 + exp( -q_k ));
+                    node.setAge( anchor + r * width );
+                    ln_jacobian += log( width ) - log1p( exp( -q_k ) ) - log1p( exp( q_k ) );
+                }
+            }
+            continue;
+        }
+
+        for (size_t k = 0; k < dimensions[i]; ++k)
+        {
+            double q_k = q[offsets[i] + k];
+            double x = q_k;
+
+            if ( transforms[i] == LOG_LOWER )
+            {
+                x = lower_bounds[i] + exp( q_k );
+                ln_jacobian += q_k;
+            }
+            else if ( transforms[i] == LOG_UPPER )
+            {
+                x = upper_bounds[i] - exp( q_k );
+                ln_jacobian += q_k;
+            }
+            else if ( transforms[i] == LOGIT )
+            {
+                double width = upper_bounds[i] - lower_bounds[i];
+                double s = 1.0 / (1.0 + exp( -q_k ));
+                x = lower_bounds[i] + width * s;
+                ln_jacobian += log( width ) - log1p( exp( -q_k ) ) - log1p( exp( q_k ) );
+            }
+
+            if ( variable_types[i] == VECTOR )
+            {
+                static_cast<StochasticNode<RbVector<double> >* >( variables[i] )->getValue()[k] = x;
+            }
+            else
+            {
+                static_cast<StochasticNode<double>* >( variables[i] )->getValue() = x;
+            }
+        }
+    }
+
+    return ln_jacobian;
+}
+
+
+/**
+ * Swap the current variable for a new one.
+ *
+ * \param[in]     oldN     The old variable that needs to be replaced.
+ * \param[in]     newN     The new variable.
+ */
+void HamiltonianMonteCarloMove::swapNodeInternal(DagNode *oldN, DagNode *newN)
+{
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( variables[i] == oldN )
+        {
+            variables[i] = newN;
+        }
+    }
+
+    affected_nodes_dirty = true;
+
+}
+
+
+void HamiltonianMonteCarloMove::touchVariables( void )
+{
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        variables[i]->touch();
+    }
+
+}
+
+
+/**
+ * Tune the move.
+ * The step size is adapted after every transition during burnin (see updateStepSize). Here we only check whether the adaptation window is full.
+ * Then the diagonal inverse mass matrix is set to the (regularized) variance of the samples on the unconstrained scale,
+ * the next window is twice as long and dual averaging restarts for the new metric.
+ */
+void HamiltonianMonteCarloMove::tune( void )
+{
+
+    if ( num_window_samples >= window_size && num_window_samples > 1 )
+    {
+        double n = double(num_window_samples);
+        for (size_t i = 0; i < dim; ++i)
+        {
+            double variance = window_m2[i] / (n - 1.0);
+            inverse_mass[i] = (n / (n + 5.0)) * variance + 1E-3 * (5.0 / (n + 5.0));
+        }
+
+        num_window_samples = 0;
+        window_mean.assign( dim, 0.0 );
+        window_m2.assign( dim, 0.0 );
+        window_size *= 2;
+
+        restartStepSizeAdaptation();
+    }
+
+}
+
+
+/**
+ * Recompute the dimensions of the variables and the nodes affected by each variable.
+ * The affected nodes of the move are all nodes that depend on any variable, except the variables themselves.
+ */
+void HamiltonianMonteCarloMove::updateAffectedNodes( void )
+{
+
+    dimensions.clear();
+    offsets.clear();
+    dim = 0;
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        size_t n = 1;
+        if ( variable_types[i] == VECTOR )
+        {
+            n = static_cast<StochasticNode<RbVector<double> >* >( variables[i] )->getValue().size();
+        }
+        else if ( variable_types[i] == BRANCH_LENGTHS )
+        {
+            n = static_cast<StochasticNode<Tree>* >( variables[i] )->getValue().getNumberOfNodes() - 1;
+        }
+        else if ( variable_types[i] == NODE_AGES )
+        {
+            const Tree &tree = static_cast<StochasticNode<Tree>* >( variables[i] )->getValue();
+            n = tree.getNumberOfNodes() - tree.getNumberOfTips() - 1;
+        }
+        offsets.push_back( dim );
+        dimensions.push_back( n );
+        dim += n;
+    }
+
+    if ( inverse_mass.size() != dim )
+    {
+        inverse_mass.assign( dim, 1.0 );
+        num_window_samples = 0;
+        window_mean.assign( dim, 0.0 );
+        window_m2.assign( dim, 0.0 );
+    }
+
+    affected_nodes.clear();
+    variable_affected_nodes.clear();
+    variable_affected_nodes.resize( variables.size() );
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        variables[i]->initiateGetAffectedNodes( variable_affected_nodes[i] );
+        variable_affected_nodes[i].erase( variables[i] );
+
+        for (RbOrderedSet<DagNode*>::const_iterator it = variable_affected_nodes[i].begin(); it != variable_affected_nodes[i].end(); ++it)
+        {
+            affected_nodes.insert( *it );
+        }
+    }
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        affected_nodes.erase( variables[i] );
+    }
+
+    dag_gradient = DagGradient( variables );
+
+    affected_nodes_dirty = false;
+
+}
+
+
+/**
+ * One iteration of dual averaging (Hoffman & Gelman 2014, algorithm 5) with the acceptance statistic of the last transition.
+ */
+void HamiltonianMonteCarloMove::updateStepSize(double acceptance_statistic)
+{
+
+    ++dual_averaging_iteration;
+    double m = double(dual_averaging_iteration);
+
+    double eta = 1.0 / (m + DUAL_AVERAGING_T0);
+    dual_averaging_h_bar = (1.0 - eta) * dual_averaging_h_bar + eta * (target_acceptance - acceptance_statistic);
+
+    double ln_step_size = dual_averaging_mu - sqrt( m ) / DUAL_AVERAGING_GAMMA * dual_averaging_h_bar;
+    double weight_m = pow( m, -DUAL_AVERAGING_KAPPA );
+    dual_averaging_ln_step_size_bar = weight_m * ln_step_size + (1.0 - weight_m) * dual_averaging_ln_step_size_bar;
+
+    step_size = exp( ln_step_size );
+
+}
+
+
+/**
+ * Get the nodes of the tree variables for the current topologies.
+ * For branch lengths these are all nodes but the root. For node ages these are the interior nodes but the root in pre-order,
+ * and we also compute the age of the oldest tip descending from each node, which is the lower end of its ratio.
+ */
+void HamiltonianMonteCarloMove::updateTreeParameterization( void )
+{
+
+    tree_nodes.resize( variables.size() );
+    anchor_ages.resize( variables.size() );
+
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        if ( variable_types[i] != BRANCH_LENGTHS && variable_types[i] != NODE_AGES )
+        {
+            continue;
+        }
+
+        const Tree &tree = static_cast<StochasticNode<Tree>* >( variables[i] )->getValue();
+        std::vector<size_t> &order = tree_nodes[i];
+        order.clear();
+
+        if ( variable_types[i] == BRANCH_LENGTHS )
+        {
+            for (size_t j = 0; j < tree.getNumberOfNodes(); ++j)
+            {
+                if ( tree.getNode( j ).isRoot() == false )
+                {
+                    order.push_back( j );
+                }
+            }
+            continue;
+        }
+
+        // all nodes in pre-order
+        std::vector<const TopologyNode*> pre_order;
+        std::vector<const TopologyNode*> stack( 1, &tree.getRoot() );
+        while ( stack.empty() == false )
+        {
+            const TopologyNode *node = stack.back();
+            stack.pop_back();
+            pre_order.push_back( node );
+            for (size_t j = node->getNumberOfChildren(); j > 0; --j)
+            {
+                stack.push_back( &node->getChild( j - 1 ) );
+            }
+        }
+
+        std::vector<double> &anchor = anchor_ages[i];
+        anchor.assign( tree.getNumberOfNodes(), RbConstants::Double::neginf );
+        for (size_t j = pre_order.size(); j > 0; --j)
+        {
+            const TopologyNode *node = pre_order[j - 1];
+            if ( node->isTip() == true )
+            {
+                if ( node->isSampledAncestor() == true )
+                {
+                    throw RbException("The HMC move cannot update the node ages of a tree with sampled ancestors.");
+                }
+                anchor[node->getIndex()] = node->getAge();
+            }
+            if ( node->isRoot() == false )
+            {
+                double &parent_anchor = anchor[node->getParent().getIndex()];
+                parent_anchor = std::max( parent_anchor, anchor[node->getIndex()] );
+            }
+        }
+
+        for (size_t j = 0; j < pre_order.size(); ++j)
+        {
+            if ( pre_order[j]->isTip() == false && pre_order[j]->isRoot() == false )
+            {
+                order.push_back( pre_order[j]->getIndex() );
+            }
+        }
+    }
+
+}
@@ -0,0 +1,151 @@
+#ifndef HamiltonianMonteCarloMove_H
+#define HamiltonianMonteCarloMove_H
+
+#include <stddef.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "AbstractMove.h"
+#include "DagGradient.h"
+#include "RbOrderedSet.h"
+
+namespace RevBayesCore {
+
+    class DagNode;
+    class Tree;
+    template <class valueType> class RbVector;
+    template <class valueType> class StochasticNode;
+
+    /**
+     * @brief Hamiltonian Monte Carlo move with the No-U-Turn sampler (NUTS).
+     *
+     * The move updates a block of continuous variables jointly: scalars, vectors, the branch lengths of a tree or the node ages of a time tree.
+     * The variables are mapped to an unconstrained space and the trajectory is simulated with the leapfrog integrator.
+     * A scalar with one finite bound is shifted to this bound and log transformed, a scalar with two finite bounds is logit transformed.
+     * Branch lengths are log transformed. The node ages use the ratio transform (Ji et al. 2021): every interior node but the root is placed at a
+     * logit transformed ratio between the age of its oldest descending tip and the age of its parent. Thus, any position gives a valid tree with
+     * the same topology, tip ages and root age. The root age is left to other moves because the tree priors condition on it. The length of the trajectory
+     * is chosen by the No-U-Turn criterion and the new state is drawn from the trajectory with multinomial sampling,
+     * so the move is always "accepted" and we report the average acceptance statistic instead.
+     *
+     * The gradient of the (heated) posterior is computed by reverse-mode differentiation through the DAG (see DagGradient).
+     * If this is not possible for a variable, its gradient is assembled per stochastic node that depends on the variable:
+     * we use the analytic gradient (see Distribution::computeLnProbabilityGradient) when the variable is a direct parameter of a
+     * distribution that implements it and central differences for all other nodes. The gradient with respect to a tree is indexed by node
+     * and taken with respect to the branch lengths, e.g., the phylogenetic CTMC provides it.
+     *
+     * During burnin the step size is adapted after every transition by dual averaging towards the target acceptance statistic
+     * (Hoffman & Gelman 2014, as in Stan) and the diagonal mass matrix is estimated from the variance of the samples in windows of doubling length.
+     * The mass matrix is updated when the move is tuned (see Mcmc::tune) and the window is full. After burnin the step size is fixed to the
+     * averaged step size and no samples are collected.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class HamiltonianMonteCarloMove : public AbstractMove {
+
+    public:
+        HamiltonianMonteCarloMove(double eps, size_t d, double t, double w, bool autoTune = false);                      //!< Constructor
+        virtual                                                ~HamiltonianMonteCarloMove(void);                                   //!< Destructor
+
+        // public methods
+        void                                                    addBoundedScalar(StochasticNode<double> *v, double lower, double upper);    //!< Add a scalar variable with (possibly infinite) bounds
+        void                                                    addBranchLengths(StochasticNode<Tree> *v);                          //!< Add the branch lengths of a tree
+        void                                                    addLogVector(StochasticNode<RbVector<double> > *v);                 //!< Add a vector of positive variables
+        void                                                    addNodeAges(StochasticNode<Tree> *v);                               //!< Add the interior node ages (but the root age) of a time tree
+        void                                                    addUntransformedScalar(StochasticNode<double> *v);                  //!< Add an unbounded scalar variable
+        void                                                    addUntransformedVector(StochasticNode<RbVector<double> > *v);       //!< Add a vector of unbounded variables
+        virtual HamiltonianMonteCarloMove*                      clone(void) const;
+        std::vector<double>                                     getAdaptationState(void) const;                                     //!< Get the dual averaging state and the mass matrix (for checkpoints)
+        const std::string&                                      getMoveName(void) const;                                            //!< Get the name of the move for summary printing
+        double                                                  getMoveTuningParameter(void) const;
+        void                                                    printSummary(std::ostream &o, bool current_period) const;           //!< Print the move summary
+        void                                                    removeVariable(DagNode *v);                                         //!< Remove a variable from the move
+        void                                                    setAdaptation(bool tf);                                             //!< Start or stop adapting the step size and collecting samples
+        void                                                    setAdaptationState(const std::vector<double> &s);                   //!< Restore the dual averaging state and the mass matrix
+        void                                                    setMoveTuningParameter(double tp);
+        void                                                    tune(void);                                                         //!< Update the mass matrix if the window is full
+
+    protected:
+        //protected methods that are overwritten from the base class
+        void                                                    performMcmcMove(double prHeat, double lHeat, double pHeat);         //!< Perform the move.
+        void                                                    resetMoveCounters(void);                                            //!< Reset the counters such as numAccepted.
+        virtual void                                            swapNodeInternal(DagNode *oldN, DagNode *newN);                     //!< Swap the pointers to the variable on which the move works on.
+
+    private:
+
+        enum VARIABLE_TYPE { SCALAR, VECTOR, BRANCH_LENGTHS, NODE_AGES };
+        enum TRANSFORM { UNTRANSFORMED, LOG_LOWER, LOG_UPPER, LOGIT, RATIO };                                                       //!< LOG_LOWER is log(x - lower), LOG_UPPER is log(upper - x)
+
+        // a point of the trajectory in phase space
+        struct PhasePoint {
+            std::vector<double>                                 q;                                                                  //!< The position (unconstrained)
+            std::vector<double>                                 p;                                                                  //!< The momentum
+            std::vector<double>                                 gradient;                                                           //!< The gradient of the ln target density at q
+            double                                              ln_target;                                                          //!< The ln target density at q
+        };
+
+        void                                                    addTransformedGradient(size_t i, const std::vector<double> &g, std::vector<double> &gradient) const;    //!< Add the gradient g of variable i on its own scale to the gradient on the unconstrained scale
+        void                                                    addVariable(DagNode *v, VARIABLE_TYPE vt, TRANSFORM t, double lower, double upper);
+        bool                                                    buildTree(PhasePoint &z, size_t depth, double direction, double h0, PhasePoint &z_propose, std::vector<double> &p_sharp_begin, std::vector<double> &p_sharp_end, std::vector<double> &rho, std::vector<double> &p_begin, std::vector<double> &p_end, double &ln_sum_weight, double &sum_metropolis_prob, size_t &n_leapfrog, bool &divergent);   //!< Build a subtree of the trajectory with 2^depth leapfrog steps
+        double                                                  computeLnPosterior(const RbOrderedSet<DagNode*> &n);                //!< The heated ln posterior contribution of the nodes
+        bool                                                    computeNoUTurnCriterion(const std::vector<double> &p_sharp_minus, const std::vector<double> &p_sharp_plus, const std::vector<double> &rho) const;
+        void                                                    evaluate(PhasePoint &z, bool compute_gradient);                     //!< Set the variables to the position z.q and compute the ln target (and gradient)
+        double                                                  getHamiltonian(const PhasePoint &z) const;
+        size_t                                                  getGradientSize(size_t i) const;                                    //!< The size of the gradient of variable i on its own scale
+        void                                                    getValues(std::vector<double> &q) const;                            //!< Get the current values in unconstrained space
+        void                                                    leapfrog(PhasePoint &z, double eps);
+        void                                                    restartStepSizeAdaptation(void);
+        double                                                  setValues(const std::vector<double> &q);                            //!< Set the variables to the position q and return the ln Jacobian
+        void                                                    touchVariables(void);
+        void                                                    updateAffectedNodes(void);
+        void                                                    updateStepSize(double acceptance_statistic);                        //!< One iteration of dual averaging
+        void                                                    updateTreeParameterization(void);                                   //!< Get the node order and anchor ages for the current topologies
+
+        // the variables
+        std::vector<DagNode*>                                   variables;
+        std::vector<VARIABLE_TYPE>                              variable_types;
+        std::vector<TRANSFORM>                                  transforms;
+        std::vector<size_t>                                     offsets;                                                            //!< The index of the first element of each variable in the parameter vector
+        std::vector<size_t>                                     dimensions;
+        std::vector<double>                                     lower_bounds;                                                       //!< Lower bounds for the log and logit transforms
+        std::vector<double>                                     upper_bounds;                                                       //!< Upper bounds for the log and logit transforms
+        std::vector<std::vector<size_t> >                       tree_nodes;                                                         //!< The indices of the nodes of a tree variable in pre-order
+        std::vector<std::vector<double> >                       anchor_ages;                                                        //!< The age of the oldest descending tip of each node of a time tree variable
+        size_t                                                  dim;
+        std::vector<RbOrderedSet<DagNode*> >                    variable_affected_nodes;                                            //!< The stochastic nodes depending on each variable (including other variables of this move)
+        DagGradient                                             dag_gradient;                                                       //!< The backward sweep through the nodes depending on the variables
+        bool                                                    affected_nodes_dirty;
+
+        // the sampler
+        double                                                  step_size;
+        size_t                                                  max_tree_depth;
+        double                                                  target_acceptance;
+        std::vector<double>                                     inverse_mass;                                                       //!< The diagonal of the inverse mass matrix
+        double                                                  pr_heat;
+        double                                                  l_heat;
+        double                                                  p_heat;
+        double                                                  max_delta_h;                                                        //!< The energy error after which a trajectory is divergent
+        double                                                  numerical_epsilon;                                                  //!< The step for central differences (on the unconstrained scale)
+
+        // adaptation and statistics
+        double                                                  dual_averaging_mu;                                                  //!< The ln step size towards which dual averaging shrinks
+        double                                                  dual_averaging_h_bar;                                               //!< The averaged difference between the target and the acceptance statistic
+        double                                                  dual_averaging_ln_step_size_bar;                                    //!< The averaged ln step size
+        size_t                                                  dual_averaging_iteration;
+        double                                                  sum_acceptance_statistic;
+        size_t                                                  num_leapfrog_steps;
+        size_t                                                  num_divergent;
+        size_t                                                  num_window_samples;                                                 //!< Number of samples in the current adaptation window
+        size_t                                                  window_size;
+        std::vector<double>                                     window_mean;
+        std::vector<double>                                     window_m2;
+
+    };
+
+}
+
+
+#endif
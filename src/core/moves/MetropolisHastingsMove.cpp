@@ -45,7 +45,8 @@ MetropolisHastingsMove::MetropolisHastingsMove( Proposal *p, double w, bool t )
 MetropolisHastingsMove::MetropolisHastingsMove(const MetropolisHastingsMove &m) : AbstractMove(m),
     num_accepted_current_period( m.num_accepted_current_period ),
     num_accepted_total( m.num_accepted_total ),
-    proposal( m.proposal->clone() )
+    proposal( m.proposal->clone() ),
+    ln_probability_evaluator(  )
 {
     
     proposal->setMove( this );
@@ -115,6 +116,12 @@ const std::string& MetropolisHastingsMove::getMoveName( void ) const
 }
 
 
+std::vector<double> MetropolisHastingsMove::getAdaptationState( void ) const
+{
+    return proposal->getAdaptationState();
+}
+
+
 double MetropolisHastingsMove::getMoveTuningParameter( void ) const
 {
     return proposal->getProposalTuningParameter();
@@ -162,7 +169,7 @@ void MetropolisHastingsMove::performHillClimbingMove( double lHeat, double pHeat
     
     
     const RbOrderedSet<DagNode*> &affectedNodes = getAffectedNodes();
-    const std::vector<DagNode*> nodes = getDagNodes();
+    const std::vector<DagNode*> &nodes = getDagNodes();
     
     // first we touch all the nodes
     // that will set the flags for recomputation
@@ -258,16 +265,13 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
 {
     
     const RbOrderedSet<DagNode*> &affected_nodes = getAffectedNodes();
-    const std::vector<DagNode*> nodes = getDagNodes();
+    const std::vector<DagNode*> &touched_nodes = getDagNodes();
     
     // Propose a new value
     proposal->prepareProposal();
     double ln_hastings_ratio = proposal->doProposal();
     
     
-    // Identify nodes that proposal touches
-    std::vector<DagNode*> touched_nodes = nodes; //proposal->identifyNodesToTouch();
-    
     // first we touch all the nodes
     // that will set the flags for recomputation
     for (size_t i = 0; i < touched_nodes.size(); ++i)
@@ -289,45 +293,26 @@ void MetropolisHastingsMove::performMcmcMove( double prHeat, double lHeat, doubl
     double ln_prior_ratio = 0.0;
     double ln_likelihood_ratio = 0.0;
 
-    
-    // compute the probability of the current value for each node
-    for (size_t i = 0; i < touched_nodes.size(); ++i)
-    {
-        // get the pointer to the current node
-        DagNode* the_node = touched_nodes[i];
-        
-        if ( RbMath::isAComputableNumber(ln_prior_ratio) && RbMath::isAComputableNumber(ln_likelihood_ratio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
-        {
-            if ( the_node->isClamped() )
-            {
-                ln_likelihood_ratio += the_node->getLnProbabilityRatio();
-            }
-            else
-            {
-                ln_prior_ratio += the_node->getLnProbabilityRatio();
-            }
-            
-        }
-        
-    }
-    
-    // then we recompute the probability for all the affected nodes
-    for (RbOrderedSet<DagNode*>::const_iterator it = affected_nodes.begin(); it != affected_nodes.end(); ++it)
+    // compute the probability ratios of the touched nodes and then of all the affected nodes
+    // the nodes are independent given the new values, so the evaluator may compute the expensive ones concurrently
+    if ( RbMath::isAComputableNumber(ln_hastings_ratio) == true )
     {
-        DagNode *the_node = *it;
+        evaluated_nodes.assign( touched_nodes.begin(), touched_nodes.end() );
+        evaluated_nodes.insert( evaluated_nodes.end(), affected_nodes.begin(), affected_nodes.end() );
+        ln_probability_evaluator.computeLnProbabilities( evaluated_nodes, true, true, ln_probability_ratios );
 
-        if ( RbMath::isAComputableNumber(ln_prior_ratio) && RbMath::isAComputableNumber(ln_likelihood_ratio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
+        // we sum in the order of the nodes, so that the result doesn't depend on the number of threads
+        for (size_t i = 0; i < evaluated_nodes.size(); ++i)
         {
-            if ( the_node->isClamped() )
+            if ( evaluated_nodes[i]->isClamped() )
             {
-                ln_likelihood_ratio += the_node->getLnProbabilityRatio();
+                ln_likelihood_ratio += ln_probability_ratios[i];
             }
             else
             {
-                ln_prior_ratio += the_node->getLnProbabilityRatio();
+                ln_prior_ratio += ln_probability_ratios[i];
             }
         }
-
     }
     
     // exponentiate with the chain heat
@@ -552,6 +537,12 @@ void MetropolisHastingsMove::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+void MetropolisHastingsMove::setAdaptationState(const std::vector<double> &s)
+{
+    proposal->setAdaptationState(s);
+}
+
+
 void MetropolisHastingsMove::setMoveTuningParameter(double tp)
 {
     proposal->setProposalTuningParameter(tp);
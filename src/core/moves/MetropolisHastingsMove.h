@@ -2,6 +2,7 @@
 #define MetropolisHastingsMove_H
 
 #include "AbstractMove.h"
+#include "LnProbabilityEvaluator.h"
 
 #include <set>
 #include <vector>
@@ -35,11 +36,13 @@ namespace RevBayesCore {
         // pure virtual public methods
         virtual MetropolisHastingsMove*                         clone(void) const;
         const std::string&                                      getMoveName(void) const;                                //!< Get the name of the move for summary printing
+        std::vector<double>                                     getAdaptationState(void) const;                         //!< Get what the proposal learned while adapting
         double                                                  getMoveTuningParameter(void) const;
         size_t                                                  getNumberAcceptedCurrentPeriod(void) const;             //!< Get update weight of InferenceMove
         size_t                                                  getNumberAcceptedTotal(void) const;                     //!< Get update weight of InferenceMove
         Proposal&                                               getProposal(void);                                      //!< Get the proposal of the move
         void                                                    printSummary(std::ostream &o, bool current_period) const;                    //!< Print the move summary
+        void                                                    setAdaptationState(const std::vector<double> &s);       //!< Restore what the proposal learned while adapting
         void                                                    setMoveTuningParameter(double tp);
         void                                                    setNumberAcceptedCurrentPeriod(size_t na);
         void                                                    setNumberAcceptedTotal(size_t na);
@@ -59,6 +62,9 @@ namespace RevBayesCore {
         unsigned int                                            num_accepted_current_period;                            //!< Number of times accepted
         unsigned int                                            num_accepted_total;                                     //!< Number of times accepted
         Proposal*                                               proposal;                                               //!< The proposal distribution
+        LnProbabilityEvaluator                                  ln_probability_evaluator;                               //!< Computes the probability ratios of the nodes, possibly concurrently
+        std::vector<DagNode*>                                   evaluated_nodes;                                        //!< Work space for the touched and affected nodes
+        std::vector<double>                                     ln_probability_ratios;                                  //!< Work space for the probability ratios of the nodes
     };
     
 }
@@ -33,6 +33,7 @@ template <class valueType> class RbOrderedSet;
         virtual void                                            autoTune(void) = 0;                                         //!< Automatic tuning of the move.
         virtual Move*                                           clone(void) const = 0;                                      //!< Create a deep copy.
         virtual void                                            decrementTriedCounter(void) = 0;                            //!< Get update weight of InferenceMove
+        virtual std::vector<double>                             getAdaptationState(void) const = 0;                         //!< Get what the move learned while adapting (for checkpoints)
         virtual const RbOrderedSet<DagNode*>&                   getAffectedNodes(void) const = 0;                           //!< Get the nodes vector
         virtual const std::vector<DagNode*>&                    getDagNodes(void) const = 0;                                //!< Get the nodes vector
         virtual const std::string&                              getMoveName(void) const = 0;                                //!< Get the name of the move for summary printing
@@ -49,6 +50,8 @@ template <class valueType> class RbOrderedSet;
         virtual void                                            printSummary(std::ostream &o, bool current_period) const = 0;                    //!< Print the move summary
         virtual void                                            removeNode(DagNode* p) = 0;                                 //!< remove a node from the proposal
         virtual void                                            resetCounters(void) = 0;                                    //!< Reset the counters such as numTried and numAccepted.
+        virtual void                                            setAdaptation(bool tf) = 0;                                 //!< Start or stop the adaptation phase (burnin)
+        virtual void                                            setAdaptationState(const std::vector<double> &s) = 0;       //!< Restore what the move learned while adapting
         virtual void                                            setMoveTuningParameter(double tp) = 0;
         virtual void                                            setNumberAcceptedCurrentPeriod(size_t na) = 0;
         virtual void                                            setNumberAcceptedTotal(size_t na) = 0;
@@ -19,6 +19,46 @@ MoveSchedule::~MoveSchedule()
 }
 
 
+/**
+ * Get the state that the schedule learned while adapting, e.g., adapted weights, so that a checkpoint can restore it.
+ * Schedules with fixed weights have no such state.
+ */
+std::vector<double> MoveSchedule::getAdaptationState( void ) const
+{
+    
+    return std::vector<double>();
+}
+
+
+/**
+ * The move returned by the last call to nextMove() was performed.
+ * Schedules with fixed weights don't need to know this.
+ */
+void MoveSchedule::moveFinished( void )
+{
+    
+}
+
+
+/**
+ * Restore the state returned by getAdaptationState. Schedules with fixed weights have nothing to restore.
+ */
+void MoveSchedule::setAdaptationState( const std::vector<double> &s )
+{
+    
+}
+
+
+/**
+ * Set whether the schedule may adapt to the following moves.
+ * Schedules with fixed weights ignore this.
+ */
+void MoveSchedule::setAdaptive( bool tf )
+{
+    
+}
+
+
 
 void MoveSchedule::tune( void )
 {
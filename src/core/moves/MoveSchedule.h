@@ -1,7 +1,7 @@
 #ifndef MoveSchedule_H
 #define MoveSchedule_H
 
-
+#include <vector>
 
 namespace RevBayesCore {
 class Move;
@@ -18,6 +18,10 @@ template <class valueType> class RbVector;
         virtual Move&                                           nextMove(unsigned long g) = 0;
         
         // public methods
+        virtual std::vector<double>                             getAdaptationState(void) const;                                                                 //!< Get what the schedule learned while adapting (for checkpoints)
+        virtual void                                            moveFinished(void);                                                                             //!< The move returned by nextMove() was performed
+        virtual void                                            setAdaptationState(const std::vector<double> &s);                                               //!< Restore what the schedule learned while adapting
+        virtual void                                            setAdaptive(bool tf);                                                                           //!< Should the schedule adapt to the following moves (only during burnin)?
         void                                                    tune(void);                                                                                     //!< The the moves to achieve better performance.
         
     protected:
@@ -192,6 +192,41 @@ AVMVNProposal* AVMVNProposal::clone( void ) const
 }
 
 
+/**
+ * Get the learned state: the number of calls and updates, the averages, the empirical covariances
+ * and the Cholesky factor of the covariance matrix we currently propose from.
+ */
+std::vector<double> AVMVNProposal::getAdaptationState( void ) const
+{
+    
+    std::vector<double> state;
+    state.push_back( nTried );
+    state.push_back( updates );
+    state.push_back( ( nTried > 0 ? dim : 0 ) );
+    
+    if ( nTried > 0 )
+    {
+        state.insert( state.end(), x_bar.begin(), x_bar.end() );
+        for (size_t i=0; i<dim; ++i)
+        {
+            for (size_t j=0; j<dim; ++j)
+            {
+                state.push_back( C_emp[i][j] );
+            }
+        }
+        for (size_t i=0; i<dim; ++i)
+        {
+            for (size_t j=0; j<dim; ++j)
+            {
+                state.push_back( AVMVN_cholesky_L[i][j] );
+            }
+        }
+    }
+    
+    return state;
+}
+
+
 /**
  * Get Proposals' name of object
  *
@@ -626,6 +661,59 @@ void AVMVNProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Restore the state from getAdaptationState.
+ */
+void AVMVNProposal::setAdaptationState(const std::vector<double> &s)
+{
+    
+    if ( s.size() < 3 || s.size() != 3 + size_t(s[2]) * ( 1 + 2 * size_t(s[2]) ) )
+    {
+        throw RbException("The checkpointed state of the AVMVN proposal is corrupt.");
+    }
+    
+    size_t n = size_t( s[2] );
+    std::vector<double> x;
+    getAVMVNMemberVariableValues( &x );
+    if ( n > 0 && n != x.size() )
+    {
+        throw RbException("The checkpointed state of the AVMVN proposal does not match the dimension of its variables.");
+    }
+    
+    nTried  = size_t( s[0] );
+    updates = size_t( s[1] );
+    if ( nTried == 0 )
+    {
+        return;
+    }
+    
+    // the stored values are overwritten at the next proposal, but we need them in the right size
+    dim = n;
+    storedValues.assign( dim, 0.0 );
+    storedValuesUntransformed.assign( dim, 0.0 );
+    x_bar.assign( s.begin() + 3, s.begin() + 3 + dim );
+    
+    C_emp = MatrixReal( dim );
+    AVMVN_cholesky_L = MatrixReal( dim );
+    size_t k = 3 + dim;
+    for (size_t i=0; i<dim; ++i)
+    {
+        for (size_t j=0; j<dim; ++j)
+        {
+            C_emp[i][j] = s[k++];
+        }
+    }
+    for (size_t i=0; i<dim; ++i)
+    {
+        for (size_t j=0; j<dim; ++j)
+        {
+            AVMVN_cholesky_L[i][j] = s[k++];
+        }
+    }
+    
+}
+
+
 void AVMVNProposal::setProposalTuningParameter(double tp)
 {
     sigma = tp;
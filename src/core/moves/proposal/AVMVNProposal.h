@@ -41,6 +41,7 @@ template <class valueType> class StochasticNode;
         void                                        cleanProposal(void);                                                                //!< Clean up proposal
         AVMVNProposal*                              clone(void) const;                                                                  //!< Clone object
         double                                      doProposal(void);                                                                   //!< Perform proposal
+        std::vector<double>                         getAdaptationState(void) const;                                                     //!< Get the learned covariances
         const std::string&                          getProposalName(void) const;                                                        //!< Get the name of the proposal for summary printing
         double                                      getProposalTuningParameter(void) const;
         void                                        printParameterSummary(std::ostream &o, bool name_only) const;                                       //!< Print the parameter summary
@@ -50,6 +51,7 @@ template <class valueType> class StochasticNode;
         void                                        removeLogitScalar(ContinuousStochasticNode *v);                                    //!< Add an up-scaling variable
         void                                        removeUntransformedVector(StochasticNode<RbVector<double> > *v);                         //!< Add an up-scaling variable
         void                                        removeLogConstrainedSumVector(RevBayesCore::StochasticNode<RevBayesCore::Simplex> *v);                         //!< Add an up-scaling variable
+        void                                        setAdaptationState(const std::vector<double> &s);                                   //!< Restore the learned covariances
         void                                        setProposalTuningParameter(double tp);
         void                                        tune(double r);                                                                     //!< Tune the proposal to achieve a better acceptance/rejection ratio
         void                                        undoProposal(void);                                                                 //!< Reject the proposal
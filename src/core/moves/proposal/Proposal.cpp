@@ -119,6 +119,17 @@ void Proposal::addNode( DagNode *n )
 }
 
 
+/**
+ * Get the state that the proposal learned during the adaptation phase besides its tuning parameter,
+ * so that a checkpoint can restore it. By default there is no such state.
+ */
+std::vector<double> Proposal::getAdaptationState( void ) const
+{
+    
+    return std::vector<double>();
+}
+
+
 const Move* Proposal::getMove( void ) const
 {
     
@@ -175,6 +186,15 @@ void Proposal::removeNode( RevBayesCore::DagNode *n )
 }
 
 
+/**
+ * Restore the state returned by getAdaptationState. By default there is nothing to restore.
+ */
+void Proposal::setAdaptationState( const std::vector<double> &s )
+{
+    
+}
+
+
 void Proposal::setMove(Move *m)
 {
     
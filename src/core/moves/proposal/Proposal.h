@@ -28,7 +28,9 @@ namespace RevBayesCore {
         virtual                                                ~Proposal(void);                                                                         //!< Destructor
         
         // public methods
+        virtual std::vector<double>                             getAdaptationState(void) const;                                                         //!< Get what the proposal learned while adapting (for checkpoints)
         const std::vector<DagNode*>&                            getNodes(void) const;                                                                   //!< Get the vector of nodes for which the proposal is drawing new values.
+        virtual void                                            setAdaptationState(const std::vector<double> &s);                                       //!< Restore what the proposal learned while adapting
         void                                                    swapNode(DagNode *oldN, DagNode *newN);                                                 //!< Swap the pointers to the variable on which the move works on.
         void                                                    setMove(Move *m);                                                                       //!< Set the pointer to move object holding this proposal
         const Move*                                             getMove(void) const;                                                                    //!< Get the pointer to move object holding this proposal
@@ -3,12 +3,14 @@
 #include <stddef.h>
 #include <cmath>
 
+#include "AbstractHomologousDiscreteCharacterData.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
 #include "RbConstants.h"
 #include "Cloneable.h"
 #include "DagNode.h"
 #include "RbOrderedSet.h"
+#include "RegraftLikelihoodEvaluator.h"
 #include "StochasticNode.h"
 #include "TopologyNode.h"
 #include "Tree.h"
@@ -53,6 +55,46 @@ GibbsPruneAndRegraftProposal* GibbsPruneAndRegraftProposal::clone( void ) const
 
 
 
+/**
+ * Compute the ln likelihoods of all re-attachment points of the pruned subtree.
+ * This is only possible if every affected node is a character data likelihood that can evaluate all regraft points at once.
+ *
+ * \return False if we need to regraft and recompute the likelihoods for each re-attachment point.
+ */
+bool GibbsPruneAndRegraftProposal::computeRegraftLnLikelihoods(const RbOrderedSet<DagNode*> &affected, const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods)
+{
+
+    ln_likelihoods = std::vector<double>(candidates.size(), 0.0);
+    for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+    {
+        StochasticNode<AbstractHomologousDiscreteCharacterData> *n = dynamic_cast<StochasticNode<AbstractHomologousDiscreteCharacterData>* >( *it );
+        RegraftLikelihoodEvaluator *evaluator = ( n != NULL ? dynamic_cast<RegraftLikelihoodEvaluator*>( &n->getDistribution() ) : NULL );
+        if ( evaluator == NULL )
+        {
+            return false;
+        }
+
+        // clamped nodes do not contribute if we only sample from the prior
+        if ( n->isClamped() == true && n->isPriorOnly() == true )
+        {
+            continue;
+        }
+
+        std::vector<double> node_ln_likelihoods;
+        if ( evaluator->computeRegraftLnLikelihoods(pruned, candidates, node_ln_likelihoods) == false )
+        {
+            return false;
+        }
+        for (size_t i = 0; i < candidates.size(); ++i)
+        {
+            ln_likelihoods[i] += node_ln_likelihoods[i];
+        }
+    }
+
+    return true;
+}
+
+
 void GibbsPruneAndRegraftProposal::findNewBrothers(std::vector<TopologyNode *> &b, TopologyNode &p, TopologyNode *n)
 {
     // security check that I'm not a tip
@@ -138,14 +180,6 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
     RbOrderedSet<DagNode *> affected;
     variable->initiateGetAffectedNodes( affected );
     
-    double backwardLikelihood = variable->getLnProbability();
-    for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
-    {
-        backwardLikelihood += (*it)->getLnProbability();
-    }
-    int offset = (int) -backwardLikelihood;
-    double backward = exp(backwardLikelihood + offset);
-    
     // pick a random node which is not the root and neithor the direct descendant of the root
     TopologyNode* node;
     do {
@@ -156,11 +190,11 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
     
     TopologyNode* parent        = &node->getParent();
     TopologyNode& grandparent   = parent->getParent();
-    TopologyNode& brother       = parent->getChild( 0 );
+    TopologyNode* brother       = &parent->getChild( 0 );
     // check if we got the correct child
-    if ( &brother == node )
+    if ( brother == node )
     {
-        brother = parent->getChild( 1 );
+        brother = &parent->getChild( 1 );
     }
     
     // collect the possible reattachement points
@@ -174,6 +208,28 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
         return RbConstants::Double::neginf;
     }
     
+    // try to get the likelihoods of all re-attachement points (and of the current one, which is the last candidate) at once
+    std::vector<TopologyNode*> candidates = new_brothers;
+    candidates.push_back( brother );
+    std::vector<double> ln_likelihoods;
+    bool single_traversal = computeRegraftLnLikelihoods(affected, *node, candidates, ln_likelihoods);
+    
+    double backwardLikelihood = variable->getLnProbability();
+    if ( single_traversal == true )
+    {
+        // we use the same computation as for the other re-attachement points
+        backwardLikelihood += ln_likelihoods.back();
+    }
+    else
+    {
+        for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+        {
+            backwardLikelihood += (*it)->getLnProbability();
+        }
+    }
+    int offset = (int) -backwardLikelihood;
+    double backward = exp(backwardLikelihood + offset);
+    
     std::vector<double> weights = std::vector<double>(new_brothers.size(), 0.0);
     double sumOfWeights = 0.0;
     for (size_t i = 0; i<new_brothers.size(); ++i)
@@ -182,7 +238,7 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
         TopologyNode* newBro = new_brothers[i];
         
         // do the proposal
-        TopologyNode *newGrandparent = pruneAndRegraft(&brother, newBro, parent, grandparent);
+        TopologyNode *newGrandparent = pruneAndRegraft(brother, newBro, parent, grandparent);
         
         // flag for likelihood recomputation
         variable->touch();
@@ -190,15 +246,22 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
         // compute the likelihood of the new value
         double priorRatio = variable->getLnProbability();
         double likelihoodRatio = 0.0;
-        for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+        if ( single_traversal == true )
+        {
+            likelihoodRatio = ln_likelihoods[i];
+        }
+        else
         {
-            likelihoodRatio += (*it)->getLnProbability();
+            for (RbOrderedSet<DagNode*>::const_iterator it = affected.begin(); it != affected.end(); ++it)
+            {
+                likelihoodRatio += (*it)->getLnProbability();
+            }
         }
         weights[i] = exp(priorRatio + likelihoodRatio + offset);
         sumOfWeights += weights[i];
         
         // undo proposal
-        pruneAndRegraft(newBro, &brother, parent, *newGrandparent);
+        pruneAndRegraft(newBro, brother, parent, *newGrandparent);
         
         // restore the previous likelihoods;
         variable->restore();
@@ -227,10 +290,10 @@ double GibbsPruneAndRegraftProposal::doProposal( void )
     TopologyNode* newBro = new_brothers[index];
     
     // now we store all necessary values
-    storedBrother       = &brother;
+    storedBrother       = brother;
     storedNewBrother    = newBro;
     
-    pruneAndRegraft(&brother, newBro, parent, grandparent);
+    pruneAndRegraft(brother, newBro, parent, grandparent);
     
     double forward = weights[index];
     
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "Proposal.h"
+#include "RbOrderedSet.h"
 
 namespace RevBayesCore {
 class DagNode;
@@ -20,6 +21,9 @@ template <class variableType> class StochasticNode;
      * Then, we prune this node and try to attach it at all possible re-attachment points elsewhere in the tree at this node age.
      * Finally, we pick the re-attachment point according to the tree probability.
      *
+     * If all likelihoods depending on the tree can evaluate all re-attachment points at once (see RegraftLikelihoodEvaluator),
+     * we only regraft to compute the tree prior and get the likelihoods from a single traversal of the tree.
+     *
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -50,6 +54,7 @@ template <class variableType> class StochasticNode;
         
     private:
         // private helper methods
+        bool                                    computeRegraftLnLikelihoods(const RbOrderedSet<DagNode*> &affected, const TopologyNode &pruned, const std::vector<TopologyNode*> &candidates, std::vector<double> &ln_likelihoods);  //!< The ln likelihoods of all re-attachment points, if available
         void                                    findNewBrothers(std::vector<TopologyNode*> &b, TopologyNode &p, TopologyNode *n);
         TopologyNode*                           pruneAndRegraft(TopologyNode *brother, TopologyNode *newBrother, TopologyNode *parent, TopologyNode &grandparent);
         
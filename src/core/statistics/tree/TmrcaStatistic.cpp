@@ -12,6 +12,7 @@
 #include "RbBitSet.h"
 #include "Taxon.h"
 #include "Tree.h"
+#include "TreeBipartitionIndex.h"
 #include "TreeChangeEventMessage.h"
 #include "TypedDagNode.h"
 
@@ -85,8 +86,9 @@ void TmrcaStatistic::fireTreeChangeEvent(const TopologyNode &n, const unsigned&
 {
     if (m == TreeChangeEventMessage::DEFAULT || m == TreeChangeEventMessage::TOPOLOGY)
     {
-        // update clade in case topology move changed MRCA node
-        ; //recursivelyFlagNodesDirty(n);
+        // the MRCA node is looked up in the clade index of the tree,
+        // which gets flagged dirty by the tree itself
+        ;
     }
     else
     {
@@ -107,56 +109,11 @@ void TmrcaStatistic::initialize( void )
 void TmrcaStatistic::update( void )
 {
     
-    const std::vector<TopologyNode*> &n = tree->getValue().getNodes();
-    size_t min_clade_size = n.size() + 2;
-
-    bool found = false;
-    if ( index != -RbConstants::Integer::max )
-    {
-        TopologyNode *node = n[index];
-        size_t clade_size = size_t( (node->getNumberOfNodesInSubtree(true) + 1) / 2);
-        
-        if ( node->containsClade( clade, false ) == true )
-        {
-            
-            if ( taxa_count == clade_size )
-            {
-                found = true;
-            }
-            else
-            {
-                min_clade_size = clade_size;
-            }
-            
-        }
-        
-    }
-    
+    // the clade index of the tree is updated incrementally after topology changes,
+    // so we do not need to scan all nodes of the tree for the MRCA
+    const TopologyNode *mrca = tree->getValue().getBipartitionIndex().getMrca( clade, false );
+    index = ( mrca == NULL ? -RbConstants::Integer::max : int(mrca->getIndex()) );
     
-    if ( found == false )
-    {
-        // for each node
-        for (size_t i = 0; i < n.size(); ++i)
-        {
-            
-            TopologyNode *node = n[i];
-            size_t clade_size = size_t( (node->getNumberOfNodesInSubtree(true) + 1) / 2);
-            if ( clade_size < min_clade_size && clade_size >= taxa_count && node->containsClade( clade, false ) )
-            {
-                
-                index = int(node->getIndex());
-                min_clade_size = clade_size;
-                if ( taxa_count == clade_size )
-                {
-                    break;
-                }
-                
-            }
-            
-        }
-        
-    }
-
     if ( index == -RbConstants::Integer::max )
     {
         throw RbException("TMRCA-Statistics can only be applied if clade is present.");
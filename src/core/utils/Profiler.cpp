@@ -0,0 +1,285 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include "RbException.h"
+#include "RbFileManager.h"
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // the innermost running timer of this thread (NULL if there is none)
+    thread_local Profiler::Timer*   current_timer = NULL;
+
+
+    /**
+     * The measurements of a thread since its outermost timer started.
+     * The slots (and their strings) are reused, so buffering a measurement doesn't allocate memory.
+     */
+    struct ThreadBuffer {
+        ThreadBuffer(void) : num_used( 0 ) {}
+
+        struct Slot {
+            Profiler::Category          category;
+            std::string                 name;
+            size_t                      calls;
+            double                      total_time;
+            double                      self_time;
+            size_t                      touched_nodes;
+        };
+
+        std::vector<Slot>               slots;
+        size_t                          num_used;
+    };
+
+    thread_local ThreadBuffer           thread_buffer;
+
+
+    const char* categoryName( Profiler::Category c )
+    {
+
+        switch ( c )
+        {
+            case Profiler::MOVE:        return "move";
+            case Profiler::VARIABLE:    return "variable";
+            case Profiler::LIKELIHOOD:  return "likelihood";
+        }
+
+        return "";
+    }
+
+}
+
+
+Profiler::Profiler( void ) :
+    enabled( false )
+{
+
+}
+
+
+/**
+ * Get the global profiler.
+ */
+Profiler& Profiler::globalProfiler( void )
+{
+
+    static Profiler global_profiler;
+
+    return global_profiler;
+}
+
+
+void Profiler::clear( void )
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+    entries.clear();
+
+}
+
+
+/**
+ * Get the entries sorted by category and then by decreasing total time.
+ * The caller must hold the mutex.
+ */
+std::vector<Profiler::EntryMap::const_iterator> Profiler::getSortedEntries( void ) const
+{
+
+    std::vector<EntryMap::const_iterator> sorted;
+    for (EntryMap::const_iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        sorted.push_back( it );
+    }
+
+    std::stable_sort( sorted.begin(), sorted.end(), [](EntryMap::const_iterator a, EntryMap::const_iterator b)
+    {
+        if ( a->first.first != b->first.first )
+        {
+            return a->first.first < b->first.first;
+        }
+        return a->second.total_time > b->second.total_time;
+    } );
+
+    return sorted;
+}
+
+
+/**
+ * Print the entries in the layout of the operator summary.
+ * The touched nodes are given per call and only for moves.
+ */
+void Profiler::printSummary(std::ostream &o) const
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    std::streamsize previous_precision = o.precision();
+    std::ios_base::fmtflags previous_flags = o.flags();
+
+    o << std::endl;
+    o << "                  Name                  | Category   |    Calls   | Total [s]  |  Self [s]  | Mean [ms]  | Touched" << std::endl;
+    o << "===============================================================================================================================" << std::endl;
+
+    std::vector<EntryMap::const_iterator> sorted = getSortedEntries();
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        const std::string &n = sorted[i]->first.second;
+        const Entry &e = sorted[i]->second;
+
+        o << std::left << std::setw(40) << n.substr(0, 40) << " ";
+        o << std::left << std::setw(12) << categoryName( sorted[i]->first.first ) << " ";
+        o << std::right << std::setw(12) << e.calls << " ";
+        o << std::fixed << std::setprecision(3);
+        o << std::setw(12) << e.total_time << " ";
+        o << std::setw(12) << e.self_time << " ";
+        o << std::setprecision(4) << std::setw(12) << ( e.calls > 0 ? 1000.0 * e.total_time / e.calls : 0.0 ) << " ";
+        if ( sorted[i]->first.first == MOVE && e.calls > 0 )
+        {
+            o << std::setprecision(2) << std::setw(8) << double(e.touched_nodes) / e.calls;
+        }
+        o << std::endl;
+    }
+
+    o << std::endl;
+
+    o.precision( previous_precision );
+    o.flags( previous_flags );
+
+}
+
+
+/**
+ * Add the measurements of the given number of calls to the entry with the given category and name.
+ */
+void Profiler::record(Category c, const std::string &n, double total, double self, size_t touched, size_t calls)
+{
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    Entry &e = entries[ std::make_pair( c, n ) ];
+    e.calls         += calls;
+    e.total_time    += total;
+    e.self_time     += self;
+    e.touched_nodes += touched;
+
+}
+
+
+/**
+ * Start or stop recording. Starting removes the entries of a previous profile.
+ */
+void Profiler::setEnabled(bool tf)
+{
+
+    if ( tf == true && isEnabled() == false )
+    {
+        clear();
+    }
+    enabled.store( tf, std::memory_order_relaxed );
+
+}
+
+
+/**
+ * Write the entries as a tab-separated table with one row per entry.
+ */
+void Profiler::writeTable(const std::string &f) const
+{
+
+    RbFileManager fm = RbFileManager( f );
+    fm.createDirectoryForFile();
+
+    std::ofstream out( fm.getFullFileName().c_str() );
+    if ( out.is_open() == false )
+    {
+        throw RbException( "Could not open file '" + f + "' for writing the profile." );
+    }
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    out << "category\tname\tcalls\ttotal_time\tself_time\tmean_time\ttouched_nodes" << std::endl;
+    out << std::setprecision( 6 );
+
+    std::vector<EntryMap::const_iterator> sorted = getSortedEntries();
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        const Entry &e = sorted[i]->second;
+        out << categoryName( sorted[i]->first.first ) << "\t" << sorted[i]->first.second << "\t" << e.calls << "\t";
+        out << e.total_time << "\t" << e.self_time << "\t" << ( e.calls > 0 ? e.total_time / e.calls : 0.0 ) << "\t" << e.touched_nodes << std::endl;
+    }
+
+}
+
+
+void Profiler::Timer::start( void )
+{
+
+    active = true;
+    parent = current_timer;
+    current_timer = this;
+    start_time = std::chrono::steady_clock::now();
+
+}
+
+
+/**
+ * Record the time since start() and give it to the enclosing timer, which excludes it from its self time.
+ * The time goes to the buffer of the thread, which we add to the profile when the outermost timer stops.
+ */
+void Profiler::Timer::stop( void )
+{
+
+    double time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_time ).count();
+
+    current_timer = parent;
+    if ( parent != NULL )
+    {
+        parent->child_time += time;
+    }
+
+    // find the slot of this entry (there are only a few entries per outermost timer)
+    ThreadBuffer &buffer = thread_buffer;
+    size_t i = 0;
+    while ( i < buffer.num_used && ( buffer.slots[i].category != category || buffer.slots[i].name != name ) )
+    {
+        ++i;
+    }
+    if ( i == buffer.num_used )
+    {
+        if ( i == buffer.slots.size() )
+        {
+            buffer.slots.push_back( ThreadBuffer::Slot() );
+        }
+        ThreadBuffer::Slot &slot = buffer.slots[i];
+        slot.category       = category;
+        slot.name.assign( name );
+        slot.calls          = 0;
+        slot.total_time     = 0.0;
+        slot.self_time      = 0.0;
+        slot.touched_nodes  = 0;
+        ++buffer.num_used;
+    }
+
+    ThreadBuffer::Slot &slot = buffer.slots[i];
+    ++slot.calls;
+    slot.total_time     += time;
+    slot.self_time      += time - child_time;
+    slot.touched_nodes  += touched_nodes;
+
+    if ( parent == NULL )
+    {
+        Profiler &profiler = globalProfiler();
+        for (size_t j = 0; j < buffer.num_used; ++j)
+        {
+            const ThreadBuffer::Slot &s = buffer.slots[j];
+            profiler.record( s.category, s.name, s.total_time, s.self_time, s.touched_nodes, s.calls );
+        }
+        buffer.num_used = 0;
+    }
+
+}
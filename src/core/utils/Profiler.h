@@ -0,0 +1,111 @@
+#ifndef Profiler_H
+#define Profiler_H
+
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Opt-in runtime profiler for MCMC analyses.
+     *
+     * The profiler records the wall time spent per move, per stochastic variable (computing its ln probability)
+     * and per phase of the likelihood computation (transition probabilities, partial likelihoods, scaling, root likelihood).
+     * Each entry collects the number of calls, the total time, the self time (the total time minus the time of the
+     * entries nested inside it in the same thread) and, for moves, the number of touched DAG nodes.
+     * Hence the self time of a move is the time of the proposal and the bookkeeping, while the time of the
+     * probabilities it triggers is attributed to the variables and the likelihood phases.
+     *
+     * The code to be measured is wrapped in a Profiler::Timer. As long as the profiler is disabled, which is the default,
+     * a timer only checks a flag. A stopped timer adds its time to a buffer of its thread, which is only added to the
+     * entries (taking the lock) when the outermost timer of the thread stops, e.g., once per move.
+     * Timers may be used in several threads; entries computed by worker threads are not
+     * nested inside the entry that started the parallel computation.
+     *
+     * Only the phylogenetic CTMC (AbstractPhyloCTMCSiteHomogeneous and its derived classes) reports the phases of its likelihood.
+     * The time of all other distributions is only reported as a whole, by the entry of their variable.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class Profiler {
+
+    public:
+
+        enum Category { MOVE, VARIABLE, LIKELIHOOD };
+
+        /**
+         * @brief Measures the time of its scope and records it in the global profiler.
+         *
+         * The name must stay valid until the timer is destroyed.
+         */
+        class Timer {
+
+        public:
+            Timer(Category c, const char *n) : category( c ), name( n ), active( false ), parent( NULL ), child_time( 0.0 ), touched_nodes( 0 ) { if ( globalProfiler().isEnabled() == true ) start(); }
+            ~Timer(void)                                                                                    { if ( active == true ) stop(); }
+
+            void                                addTouchedNodes(size_t n)                                   { touched_nodes += n; }
+
+        private:
+
+            Timer(const Timer &t);                                                                          //!< Prevent copy
+            Timer&                              operator=(const Timer &t);                                  //!< Prevent assignment
+
+            void                                start(void);                                                //!< Start measuring and become the innermost timer of this thread
+            void                                stop(void);                                                 //!< Record the time
+
+            Category                            category;
+            const char*                         name;
+            bool                                active;                                                     //!< Was the profiler enabled when we started?
+            Timer*                              parent;                                                     //!< The enclosing timer in this thread
+            double                              child_time;                                                 //!< The time of the nested timers in seconds
+            size_t                              touched_nodes;
+            std::chrono::steady_clock::time_point   start_time;
+        };
+
+        static Profiler&                        globalProfiler(void);                                       //!< Get the profiler used by all timers
+
+        void                                    clear(void);                                                //!< Remove all entries
+        bool                                    isEnabled(void) const                                       { return enabled.load( std::memory_order_relaxed ); }
+        void                                    printSummary(std::ostream &o) const;                        //!< Print the entries as a formatted table
+        void                                    record(Category c, const std::string &n, double total, double self, size_t touched, size_t calls = 1);  //!< Add measurements
+        void                                    setEnabled(bool tf);                                        //!< Start or stop recording
+        void                                    writeTable(const std::string &f) const;                     //!< Write the entries as a tab-separated table
+
+    private:
+
+        Profiler(void);                                                                                     //!< Only the global profiler exists
+        Profiler(const Profiler &p);                                                                        //!< Prevent copy
+        Profiler&                               operator=(const Profiler &p);                               //!< Prevent assignment
+
+        struct Entry {
+            Entry(void) : calls( 0 ), total_time( 0.0 ), self_time( 0.0 ), touched_nodes( 0 ) {}
+
+            size_t                              calls;
+            double                              total_time;                                                 //!< Seconds including the nested entries
+            double                              self_time;                                                  //!< Seconds excluding the nested entries
+            size_t                              touched_nodes;
+        };
+
+        typedef std::map<std::pair<Category, std::string>, Entry>   EntryMap;
+
+        std::vector<EntryMap::const_iterator>   getSortedEntries(void) const;                               //!< The entries by category and decreasing total time
+
+        std::atomic<bool>                       enabled;
+        mutable std::mutex                      mutex;
+        EntryMap                                entries;
+
+    };
+
+}
+
+#endif
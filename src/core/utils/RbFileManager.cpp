@@ -1,6 +1,7 @@
 #include <sys/stat.h>
 #include <stdio.h>
 #include <sys/types.h> // IWYU pragma: keep
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <cstring>
@@ -11,6 +12,7 @@
 #include "RbFileManager.h"
 #include "RbSettings.h"
 #include "StringUtilities.h"
+#include "boost/filesystem/operations.hpp"
 #include "boost/filesystem/path.hpp"
 
 #ifdef RB_WIN
@@ -387,6 +389,15 @@ const std::string& RbFileManager::getPathSeparator( void ) const
 }
 
 
+/** Get the name of the previous version of the file, which writeFile keeps if requested
+ * @return file_path + file_name + ".prev"
+ */
+std::string RbFileManager::getPreviousFileName( void ) const
+{
+    return file_path + path_separator + file_name + ".prev";
+}
+
+
 /** Removes the last path component from a path
  * @note any trailing path separator is NOT removed, so x/y/z/ will return x/y/z
  * @return string without the last path component
@@ -651,6 +662,41 @@ bool RbFileManager::openFile(std::ifstream& strm)
 }
 
 
+/** Reads the whole file into a buffer with a single read
+ * @param buffer the string receiving the content of the file (its memory is reused)
+ * @return whether the operation was successful
+ */
+bool RbFileManager::readFile(std::string& buffer) const
+{
+    
+    // concatenate path and file name
+    std::string file_pathName = file_path + path_separator + file_name;
+    
+    std::ifstream strm( file_pathName.c_str(), std::ios::in | std::ios::binary );
+    if ( !strm )
+    {
+        return false;
+    }
+    
+    strm.seekg( 0, std::ios::end );
+    std::streamoff size = strm.tellg();
+    strm.seekg( 0, std::ios::beg );
+    if ( size < 0 )
+    {
+        return false;
+    }
+    
+    buffer.resize( size_t(size) );
+    if ( size > 0 )
+    {
+        strm.read( &buffer[0], size );
+    }
+    
+    // a short read sets the failbit
+    return !strm.fail();
+}
+
+
 /** Opens a file for output
  * @param strm stream to associate with the file
  * @return whether the operation was successful
@@ -942,3 +988,79 @@ bool RbFileManager::testFile(void)
 {   
     return isFilePresent(file_path, file_name);
 }
+
+
+/** Cuts the file after the first s bytes. Nothing happens if the file is not longer than that.
+ * @param s the new size of the file in bytes
+ * @return whether the operation was successful
+ */
+/** Replaces the file by its previous version kept by writeFile.
+ * @return whether the operation was successful
+ */
+bool RbFileManager::restorePreviousFile(void) const
+{
+    
+    boost::system::error_code ec;
+    boost::filesystem::rename( getPreviousFileName(), file_path + path_separator + file_name, ec );
+    
+    return !ec;
+}
+
+
+bool RbFileManager::truncateFile(size_t s) const
+{
+    
+    boost::system::error_code ec;
+    boost::filesystem::path p = boost::filesystem::path( file_path + path_separator + file_name );
+    
+    boost::uintmax_t size = boost::filesystem::file_size( p, ec );
+    if ( ec )
+    {
+        return false;
+    }
+    if ( size > s )
+    {
+        boost::filesystem::resize_file( p, s, ec );
+    }
+    
+    return !ec;
+}
+
+
+/** Replaces the file by the buffer. We first write a temporary file next to it and then rename it,
+ * which replaces the old file atomically, so that the file always is either the complete old or the complete new file.
+ * If we keep the previous version, the old file is renamed to getPreviousFileName() before it is replaced.
+ * @param buffer the new content of the file
+ * @param keep_previous whether to keep the old file as the previous version
+ * @return whether the operation was successful
+ */
+bool RbFileManager::writeFile(const std::string& buffer, bool keep_previous) const
+{
+    
+    std::string file_pathName = file_path + path_separator + file_name;
+    std::string tmp_file_pathName = file_pathName + ".tmp";
+    
+    std::ofstream strm( tmp_file_pathName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+    strm.write( buffer.data(), buffer.size() );
+    strm.close();
+    
+    // boost::filesystem::rename replaces an existing target on all platforms (std::rename fails on Windows)
+    boost::system::error_code ec;
+    if ( strm.fail() == false && keep_previous == true && isFile() == true )
+    {
+        boost::filesystem::rename( file_pathName, getPreviousFileName(), ec );
+    }
+    if ( strm.fail() == false && !ec )
+    {
+        boost::filesystem::rename( tmp_file_pathName, file_pathName, ec );
+    }
+    
+    if ( strm.fail() == true || ec )
+    {
+        boost::system::error_code ec_remove;
+        boost::filesystem::remove( tmp_file_pathName, ec_remove );
+        return false;
+    }
+    
+    return true;
+}
@@ -41,6 +41,7 @@ namespace RevBayesCore {
         std::string             getLastPathComponent(void);  //!< Get last component of the full_file_name
         const std::string&      getNewLine(void) const;
         const std::string&      getPathSeparator(void) const;
+        std::string             getPreviousFileName(void) const;  //!< Name of the previous version of the file kept by writeFile
         std::istream&           safeGetline(std::istream& is, std::string& t); //!< Gets one line from a stream
         std::string             getStringByDeletingLastPathComponent(const std::string& s);  //!< Get path by removing last component
         bool                    isDirectory(void) const;  //!< Is full_file_name an existing directory ?
@@ -50,12 +51,16 @@ namespace RevBayesCore {
         bool                    listDirectoryContents(void);  //!< Recursively lists the contents of the directory given by file_path
         bool                    openFile(std::ifstream& strm);  //!< Open file for input
         bool                    openFile(std::ofstream& strm);  //!< Open file for output
+        bool                    readFile(std::string& buffer) const;  //!< Read the whole file into a buffer
+        bool                    restorePreviousFile(void) const;  //!< Replace the file by the previous version kept by writeFile
         void                    setFileName(const std::string &s);
         void                    setFilePath(const std::string &s);
         bool                    setStringWithNamesOfFilesInDirectory(std::vector<std::string>& sv, bool recursive=true);  //!< Recursively fills in a string vector with the contents of the directory given by file_path
         bool                    setStringWithNamesOfFilesInDirectory(const std::string& dirpath, std::vector<std::string>& sv, bool recursive=true);  //!< Recursively fills in a string vector with the contents of the directory passed in argument
         bool                    testDirectory(void);  //!< Tests whether the directory given by file_path exists
         bool                    testFile(void);  //!< Tests whether the file given by file_path + file_name exists
+        bool                    truncateFile(size_t s) const;  //!< Cut the file after the first s bytes
+        bool                    writeFile(const std::string& buffer, bool keep_previous=false) const;  //!< Replace the file atomically by the buffer (and possibly keep the old file)
 
     private:
 
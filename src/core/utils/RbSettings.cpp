@@ -10,6 +10,7 @@
 #include "RbException.h"
 #include "RbFileManager.h"
 #include "StringUtilities.h"
+#include "ThreadPool.h"
 
 #	ifdef RB_WIN
 #include <windows.h>
@@ -40,12 +41,24 @@ size_t RbSettings::getLineWidth( void ) const
     return lineWidth;
 }
 
+size_t RbSettings::getNumberOfThreads( void ) const
+{
+    // return the internal value
+    return numThreads;
+}
+
 size_t RbSettings::getScalingDensity( void ) const
 {
     // return the internal value
     return scalingDensity;
 }
 
+bool RbSettings::getThreadAffinity( void ) const
+{
+    // return the internal value
+    return threadAffinity;
+}
+
 bool RbSettings::getUseScaling( void ) const
 {
     // return the internal value
@@ -92,6 +105,14 @@ std::string RbSettings::getOption(const std::string &key) const
     {
         return collapseSampledAncestors ? "true" : "false";
     }
+    else if ( key == "numThreads" )
+    {
+        return StringUtilities::to_string(numThreads);
+    }
+    else if ( key == "threadAffinity" )
+    {
+        return threadAffinity ? "true" : "false";
+    }
     else
     {
         std::cout << "Unknown user setting with key '" << key << "'." << std::endl;
@@ -141,6 +162,8 @@ void RbSettings::initializeUserSettings(void)
     outputPrecision = 7;
     printNodeIndex = true;      // print node indices of tree nodes as comments
     collapseSampledAncestors = true;
+    numThreads = 1;             // by default we run single-threaded
+    threadAffinity = false;     // by default the operating system places the threads
     
     std::string user_dir = RevBayesCore::RbFileManager::expandUserDir("~");
     
@@ -215,6 +238,8 @@ void RbSettings::listOptions() const
     std::cout << "useScaling = " << (useScaling ? "true" : "false") << std::endl;
     std::cout << "scalingDensity = " << scalingDensity << std::endl;
     std::cout << "collapseSampledAncestors = " << (collapseSampledAncestors ? "true" : "false") << std::endl;
+    std::cout << "numThreads = " << numThreads << std::endl;
+    std::cout << "threadAffinity = " << (threadAffinity ? "true" : "false") << std::endl;
 }
 
 
@@ -263,6 +288,28 @@ void RbSettings::setScalingDensity(size_t w)
 }
 
 
+void RbSettings::setNumberOfThreads(size_t n)
+{
+    // replace the internal value with this new value
+    numThreads = n;
+    RevBayesCore::ThreadPool::setGlobalNumberOfThreads( numThreads, threadAffinity );
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
+void RbSettings::setThreadAffinity(bool tf)
+{
+    // replace the internal value with this new value
+    threadAffinity = tf;
+    RevBayesCore::ThreadPool::setGlobalNumberOfThreads( numThreads, threadAffinity );
+
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
+
 void RbSettings::setCollapseSampledAncestors(bool w)
 {
     // replace the internal value with this new value
@@ -319,6 +366,20 @@ void RbSettings::setOption(const std::string &key, const std::string &v, bool wr
     {
         collapseSampledAncestors = value == "true";
     }
+    else if ( key == "numThreads" )
+    {
+        int n = atoi(value.c_str());
+        if (n < 0)
+            throw(RbException("numThreads must be a non-negative integer (0 means all available cores)"));
+
+        numThreads = n;
+        RevBayesCore::ThreadPool::setGlobalNumberOfThreads( numThreads, threadAffinity );
+    }
+    else if ( key == "threadAffinity" )
+    {
+        threadAffinity = value == "true";
+        RevBayesCore::ThreadPool::setGlobalNumberOfThreads( numThreads, threadAffinity );
+    }
     else
     {
         std::cout << "Unknown user setting with key '" << key << "'." << std::endl;
@@ -394,6 +455,8 @@ void RbSettings::writeUserSettings( void )
     writeStream << "useScaling=" << (useScaling ? "true" : "false") << std::endl;
     writeStream << "scalingDensity=" << scalingDensity << std::endl;
     writeStream << "collapseSampledAncestors=" << (collapseSampledAncestors ? "true" : "false") << std::endl;
+    writeStream << "numThreads=" << numThreads << std::endl;
+    writeStream << "threadAffinity=" << (threadAffinity ? "true" : "false") << std::endl;
     fm.closeFile( writeStream );
 
 }
@@ -21,10 +21,12 @@ class RbSettings {
         bool                        getCollapseSampledAncestors(void) const;            //!< Retrieve the whether to should display sampled ancestors as 2-degree nodes when printing
         size_t                      getLineWidth(void) const;                           //!< Retrieve the line width that will be used for the screen width when printing
         const std::string&          getModuleDir(void) const;                           //!< Retrieve the module directory name
+        size_t                      getNumberOfThreads(void) const;                     //!< Retrieve the number of threads used for parallel computations (0 means all cores)
         std::string                 getOption(const std::string &k) const;              //!< Retrieve a user option
         size_t                      getOutputPrecision(void) const;                     //!< Retrieve the default output precision width
         bool                        getPrintNodeIndex(void) const;                      //!< Retrieve the flag whether we should print node indices
         size_t                      getScalingDensity(void) const;                      //!< Retrieve the scaling density that determines how often to scale the likelihood in CTMC models
+        bool                        getThreadAffinity(void) const;                      //!< Retrieve the flag whether worker threads are pinned to cores
         double                      getTolerance(void) const;                           //!< Retrieve the tolerance for comparing doubles
         bool                        getUseScaling(void) const;                          //!< Retrieve the flag whether we should scale the likelihood in CTMC models
         const std::string&          getWorkingDirectory(void) const;                    //!< Retrieve the current working directory
@@ -34,10 +36,12 @@ class RbSettings {
         void                        setCollapseSampledAncestors(bool);                  //!< Set whether to should display sampled ancestors as 2-degree nodes when printing
         void                        setLineWidth(size_t w);                             //!< Set the line width that will be used for the screen width when printing
         void                        setModuleDir(const std::string &md);                //!< Set the module directory name
+        void                        setNumberOfThreads(size_t n);                       //!< Set the number of threads used for parallel computations (0 means all cores)
         void                        setOutputPrecision(size_t p);                       //!< Set the default output precision width
         void                        setOption(const std::string &k, const std::string &v, bool write);  //!< Set the key value pair.
         void                        setPrintNodeIndex(bool tf);                         //!< Set the flag whether we should print node indices
         void                        setScalingDensity(size_t w);                        //!< Set the scaling density n, where CTMC likelihoods are scaled every n-th node (min 1)
+        void                        setThreadAffinity(bool tf);                         //!< Set the flag whether worker threads are pinned to cores
         void                        setTolerance(double t);                             //!< Set the tolerance for comparing double
         void                        setUseScaling(bool s);                              //!< Set the flag whether we should scale the likelihood in CTMC models
         void                        setWorkingDirectory(const std::string &wd);         //!< Set the current working directory
@@ -55,9 +59,11 @@ class RbSettings {
         bool                        collapseSampledAncestors;
         size_t                      lineWidth;
         std::string                 moduleDir;
+        size_t                      numThreads;                                         //!< The number of threads used for parallel computations
         size_t                      outputPrecision;
         bool                        printNodeIndex;                                     //!< Should the node index of a tree be printed as a comment?
         size_t                      scalingDensity;
+        bool                        threadAffinity;                                     //!< Should worker threads be pinned to cores?
         double                      tolerance;                                          //!< Tolerance for comparison of doubles
         bool                        useScaling;
         std::string                 workingDirectory;
@@ -0,0 +1,511 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#include "RbException.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace RevBayesCore;
+
+
+namespace {
+
+    // the pool and index of the worker running in this thread (NULL for threads not owned by a pool)
+    thread_local const ThreadPool*  current_pool = NULL;
+    thread_local size_t             current_worker = 0;
+
+
+    /**
+     * Get the cores we are allowed to run on, ordered such that consecutive workers
+     * first fill the physical cores of one socket, then their hyperthreads, and only then the next socket.
+     */
+    std::vector<int> orderedCores( void )
+    {
+        std::vector<int> cores;
+
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO( &allowed );
+        if ( sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0 )
+        {
+            return cores;
+        }
+
+        // (socket, hyperthread rank, core, cpu)
+        std::vector< std::vector<int> > keys;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if ( CPU_ISSET(cpu, &allowed) == false )
+            {
+                continue;
+            }
+
+            std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            int socket = 0;
+            int core = cpu;
+            std::ifstream socket_file( (dir + "physical_package_id").c_str() );
+            socket_file >> socket;
+            std::ifstream core_file( (dir + "core_id").c_str() );
+            core_file >> core;
+
+            int rank = 0;
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                if ( keys[i][0] == socket && keys[i][2] == core )
+                {
+                    ++rank;
+                }
+            }
+
+            std::vector<int> key;
+            key.push_back( socket );
+            key.push_back( rank );
+            key.push_back( core );
+            key.push_back( cpu );
+            keys.push_back( key );
+        }
+
+        std::sort( keys.begin(), keys.end() );
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            cores.push_back( keys[i][3] );
+        }
+#endif
+
+        return cores;
+    }
+
+}
+
+
+ThreadPool::ThreadPool(size_t n, bool pin) :
+    num_queued( 0 ),
+    next_queue( 0 ),
+    stopping( false ),
+    pin_threads( pin )
+{
+
+    start( n );
+
+}
+
+
+ThreadPool::~ThreadPool( void )
+{
+
+    stop();
+
+}
+
+
+/**
+ * Get the global thread pool.
+ * The pool starts single-threaded and is sized by the user settings (see setGlobalNumberOfThreads).
+ */
+ThreadPool& ThreadPool::globalThreadPool( void )
+{
+
+    static ThreadPool global_pool( 1, false );
+
+    return global_pool;
+}
+
+
+/**
+ * Resize the global thread pool to n threads (0 means one per core).
+ * This is called by the user settings whenever the number of threads or the affinity changes.
+ * We never resize from within a worker, because the worker would need to join itself.
+ */
+void ThreadPool::setGlobalNumberOfThreads(size_t n, bool pin)
+{
+
+    if ( n == 0 )
+    {
+        n = std::max( size_t(1), size_t(std::thread::hardware_concurrency()) );
+    }
+
+    ThreadPool &global_pool = globalThreadPool();
+    if ( n != global_pool.getNumberOfThreads() || pin != global_pool.pin_threads )
+    {
+        if ( global_pool.isWorkerThread() == true )
+        {
+            throw RbException( "Cannot change the number of threads within a parallel computation." );
+        }
+        global_pool.resize( n, pin );
+    }
+
+}
+
+
+/**
+ * Compute the size of the chunks when splitting n work items among the threads.
+ * By default we create a few chunks per thread so that stealing can balance uneven chunks.
+ */
+size_t ThreadPool::computeChunkSize(size_t n, size_t grain_size) const
+{
+
+    if ( grain_size > 0 )
+    {
+        return grain_size;
+    }
+
+    size_t num_chunks = 4 * getNumberOfThreads();
+    size_t chunk_size = (n + num_chunks - 1) / num_chunks;
+
+    return std::max( size_t(1), chunk_size );
+}
+
+
+size_t ThreadPool::getNumberOfThreads( void ) const
+{
+
+    return workers.size() + 1;
+}
+
+
+bool ThreadPool::isWorkerThread( void ) const
+{
+
+    return current_pool == this;
+}
+
+
+void ThreadPool::pinWorker(size_t i)
+{
+
+#ifdef __linux__
+    if ( cores.empty() == true )
+    {
+        return;
+    }
+
+    // the calling thread is left to the operating system, the workers take the cores after the first one
+    cpu_set_t cpu_set;
+    CPU_ZERO( &cpu_set );
+    CPU_SET( cores[ (i + 1) % cores.size() ], &cpu_set );
+    pthread_setaffinity_np( pthread_self(), sizeof(cpu_set_t), &cpu_set );
+#endif
+
+}
+
+
+bool ThreadPool::popTask(size_t q, Task &t)
+{
+
+    WorkQueue &queue = *queues[q];
+    std::lock_guard<std::mutex> lock( queue.mutex );
+
+    if ( queue.tasks.empty() == true )
+    {
+        return false;
+    }
+
+    t = queue.tasks.back();
+    queue.tasks.pop_back();
+    --num_queued;
+
+    return true;
+}
+
+
+void ThreadPool::resize(size_t n, bool pin)
+{
+
+    if ( isWorkerThread() == true )
+    {
+        throw RbException("Cannot resize a thread pool from one of its own workers.");
+    }
+
+    stop();
+
+    pin_threads = pin;
+    start( n );
+
+}
+
+
+/**
+ * Run one queued task in the current thread.
+ * This is used by threads waiting for a task group so that they help instead of blocking.
+ */
+bool ThreadPool::runPendingTask( void )
+{
+
+    if ( queues.empty() == true )
+    {
+        return false;
+    }
+
+    Task t;
+    size_t thief = ( isWorkerThread() == true ? current_worker : next_queue % queues.size() );
+    if ( (isWorkerThread() == true && popTask(thief, t) == true) || stealTask(thief, t) == true )
+    {
+        t();
+        return true;
+    }
+
+    return false;
+}
+
+
+void ThreadPool::start(size_t n)
+{
+
+    stopping = false;
+    num_queued = 0;
+
+    if ( n < 1 )
+    {
+        n = 1;
+    }
+
+    if ( pin_threads == true )
+    {
+        cores = orderedCores();
+    }
+
+    for (size_t i = 0; i < n-1; ++i)
+    {
+        queues.push_back( new WorkQueue() );
+    }
+
+    for (size_t i = 0; i < n-1; ++i)
+    {
+        workers.push_back( std::thread( &ThreadPool::workerLoop, this, i ) );
+    }
+
+}
+
+
+bool ThreadPool::stealTask(size_t thief, Task &t)
+{
+
+    size_t num_queues = queues.size();
+    for (size_t i = 1; i <= num_queues; ++i)
+    {
+        WorkQueue &queue = *queues[ (thief + i) % num_queues ];
+        std::lock_guard<std::mutex> lock( queue.mutex );
+
+        if ( queue.tasks.empty() == false )
+        {
+            t = queue.tasks.front();
+            queue.tasks.pop_front();
+            --num_queued;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void ThreadPool::stop( void )
+{
+
+    {
+        std::lock_guard<std::mutex> lock( sleep_mutex );
+        stopping = true;
+    }
+    wake_up.notify_all();
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+
+    for (size_t i = 0; i < queues.size(); ++i)
+    {
+        delete queues[i];
+    }
+    queues.clear();
+
+}
+
+
+/**
+ * Queue a task.
+ * Without workers the task is executed right away by the calling thread.
+ */
+void ThreadPool::submit(const Task &t)
+{
+
+    if ( workers.empty() == true )
+    {
+        t();
+        return;
+    }
+
+    // workers keep their own tasks local, other threads distribute them round-robin
+    size_t q = ( isWorkerThread() == true ? current_worker : next_queue++ % queues.size() );
+    {
+        WorkQueue &queue = *queues[q];
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        queue.tasks.push_back( t );
+        ++num_queued;
+    }
+
+    // taking the lock makes sure that no worker misses the notification between checking and sleeping
+    {
+        std::lock_guard<std::mutex> lock( sleep_mutex );
+    }
+    wake_up.notify_one();
+
+}
+
+
+void ThreadPool::workerLoop(size_t i)
+{
+
+    current_pool   = this;
+    current_worker = i;
+
+    if ( pin_threads == true )
+    {
+        pinWorker( i );
+    }
+
+    Task t;
+    while ( true )
+    {
+        if ( popTask(i, t) == true || stealTask(i, t) == true )
+        {
+            t();
+            t = Task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock( sleep_mutex );
+        wake_up.wait( lock, [this] { return stopping == true || num_queued > 0; } );
+
+        if ( stopping == true && num_queued == 0 )
+        {
+            break;
+        }
+    }
+
+    current_pool = NULL;
+
+}
+
+
+TaskGroup::TaskGroup(ThreadPool &p) :
+    pool( p ),
+    num_unfinished( 0 )
+{
+
+}
+
+
+TaskGroup::~TaskGroup( void )
+{
+
+    // we must not leave tasks behind that refer to this group
+    while ( num_unfinished > 0 )
+    {
+        if ( pool.runPendingTask() == false )
+        {
+            std::this_thread::yield();
+        }
+    }
+
+}
+
+
+void TaskGroup::run(const ThreadPool::Task &t)
+{
+
+    ++num_unfinished;
+    pool.submit( [this, t]
+    {
+        try
+        {
+            t();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock( exception_mutex );
+            if ( exception == nullptr )
+            {
+                exception = std::current_exception();
+            }
+        }
+
+        // this must be the last access to the group
+        --num_unfinished;
+    });
+
+}
+
+
+void TaskGroup::wait( void )
+{
+
+    while ( num_unfinished > 0 )
+    {
+        if ( pool.runPendingTask() == false )
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if ( exception != nullptr )
+    {
+        std::exception_ptr e = exception;
+        exception = nullptr;
+        std::rethrow_exception( e );
+    }
+
+}
+
+
+/**
+ * Apply the function f to the range [begin,end) in parallel.
+ * The range is split into chunks [b,e) and f is called once per chunk.
+ * The calling thread executes the first chunk itself.
+ */
+void RevBayesCore::parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)> &f, size_t grain_size, ThreadPool &p)
+{
+
+    if ( end <= begin )
+    {
+        return;
+    }
+
+    size_t n = end - begin;
+    size_t chunk_size = p.computeChunkSize(n, grain_size);
+
+    if ( p.getNumberOfThreads() == 1 || chunk_size >= n )
+    {
+        f(begin, end);
+        return;
+    }
+
+    TaskGroup group( p );
+    for (size_t b = begin + chunk_size; b < end; b += chunk_size)
+    {
+        size_t e = ( b + chunk_size < end ? b + chunk_size : end );
+        group.run( [&f, b, e] { f(b, e); } );
+    }
+
+    // work on the first chunk while the workers take the others
+    try
+    {
+        f(begin, begin + chunk_size);
+    }
+    catch (...)
+    {
+        group.wait();
+        throw;
+    }
+
+    group.wait();
+
+}
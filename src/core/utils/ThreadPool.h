@@ -0,0 +1,163 @@
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * @brief Work-stealing thread pool.
+     *
+     * The thread pool owns n-1 worker threads; the thread that waits for a parallel computation
+     * works as the n-th thread. Every worker has its own task queue. A worker takes new tasks from
+     * the back of its own queue and, if its queue is empty, steals tasks from the front of the other queues.
+     * Tasks submitted by a worker (nested parallelism) go to the queue of this worker.
+     *
+     * The global thread pool is sized by the user setting "numThreads" (see RbSettings),
+     * which can also be given on the command line with --threads. With a single thread all tasks
+     * are executed directly by the calling thread, so that there is no overhead for serial runs.
+     * If the user setting "threadAffinity" is true, the workers are pinned to cores (Linux only).
+     * The cores are ordered by socket and physical core, so that the workers of one pool
+     * share a socket (and thus NUMA node) before spilling over to the next one and memory first touched
+     * by a worker stays local.
+     *
+     * Tasks must not use the global random number generator (GLOBAL_RNG) or other unsynchronized
+     * global state, unless they are serialized by the caller or set their own generator
+     * with RandomNumberFactory::setThreadRandomNumberGenerator.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     */
+    class ThreadPool {
+
+    public:
+        typedef std::function<void(void)>   Task;
+
+        ThreadPool(size_t n, bool pin = false);                                                     //!< Construct a pool with n threads (including the calling thread)
+        virtual                            ~ThreadPool(void);                                       //!< Destructor joins the workers
+
+        static ThreadPool&                  globalThreadPool(void);                                 //!< Get the thread pool sized by the user settings
+        static void                         setGlobalNumberOfThreads(size_t n, bool pin);           //!< Resize the global thread pool (0 means one thread per core)
+
+        // public methods
+        size_t                              computeChunkSize(size_t n, size_t grain_size) const;    //!< The size of the chunks when splitting n work items
+        size_t                              getNumberOfThreads(void) const;                         //!< The number of threads including the calling thread
+        bool                                isWorkerThread(void) const;                             //!< Is the current thread a worker of this pool?
+        void                                resize(size_t n, bool pin);                             //!< Change the number of threads (only while idle)
+        bool                                runPendingTask(void);                                   //!< Run one queued task in the current thread, if there is one
+        void                                submit(const Task &t);                                  //!< Queue a task
+
+    private:
+
+        ThreadPool(const ThreadPool &p);                                                            //!< Prevent copy
+        ThreadPool&                         operator=(const ThreadPool &p);                         //!< Prevent assignment
+
+        struct WorkQueue {
+            std::mutex                      mutex;
+            std::deque<Task>                tasks;
+        };
+
+        bool                                popTask(size_t q, Task &t);                             //!< Take the youngest task of queue q
+        void                                pinWorker(size_t i);                                    //!< Bind worker i to a core
+        void                                start(size_t n);                                        //!< Create n-1 workers
+        void                                stop(void);                                             //!< Finish all tasks and join the workers
+        bool                                stealTask(size_t thief, Task &t);                       //!< Take the oldest task of any other queue
+        void                                workerLoop(size_t i);                                   //!< The main loop of worker i
+
+        // members
+        std::vector<std::thread>            workers;
+        std::vector<WorkQueue*>             queues;                                                 //!< One queue per worker
+        std::vector<int>                    cores;                                                  //!< The cores for pinning, ordered by socket and physical core
+        std::mutex                          sleep_mutex;
+        std::condition_variable             wake_up;
+        std::atomic<size_t>                 num_queued;                                             //!< Number of tasks waiting in the queues
+        std::atomic<size_t>                 next_queue;                                             //!< Round-robin counter for tasks submitted from outside
+        bool                                stopping;
+        bool                                pin_threads;
+
+    };
+
+
+    /**
+     * @brief A group of tasks that is waited for as a whole.
+     *
+     * While waiting, the calling thread executes queued tasks itself, so that groups can be nested
+     * (e.g., a parallel loop inside a task) without blocking the pool. The first exception thrown by a
+     * task of the group is rethrown by wait().
+     */
+    class TaskGroup {
+
+    public:
+        TaskGroup(ThreadPool &p = ThreadPool::globalThreadPool());                                  //!< Constructor
+        virtual                            ~TaskGroup(void);                                        //!< Destructor waits for all tasks
+
+        void                                run(const ThreadPool::Task &t);                         //!< Run the task in the pool
+        void                                wait(void);                                             //!< Wait until all tasks of the group are finished
+
+    private:
+
+        TaskGroup(const TaskGroup &g);                                                              //!< Prevent copy
+        TaskGroup&                          operator=(const TaskGroup &g);                          //!< Prevent assignment
+
+        ThreadPool&                         pool;
+        std::atomic<size_t>                 num_unfinished;
+        std::mutex                          exception_mutex;
+        std::exception_ptr                  exception;
+
+    };
+
+
+    void                                    parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)> &f, size_t grain_size = 0, ThreadPool &p = ThreadPool::globalThreadPool());   //!< Apply f to chunks [b,e) of the range in parallel
+
+
+    /**
+     * Reduce the range [begin,end) in parallel.
+     * The function f computes the partial result of a chunk [b,e) and the function r combines two partial results.
+     * The partial results are combined in the order of the chunks, so that the result only depends
+     * on the chunk size and not on the scheduling of the threads.
+     */
+    template <class valueType, class rangeFunction, class reduceFunction>
+    valueType parallelReduce(size_t begin, size_t end, const valueType &identity, rangeFunction f, reduceFunction r, size_t grain_size = 0, ThreadPool &p = ThreadPool::globalThreadPool())
+    {
+
+        if ( end <= begin )
+        {
+            return identity;
+        }
+
+        size_t n = end - begin;
+        size_t chunk_size = p.computeChunkSize(n, grain_size);
+        size_t num_chunks = (n + chunk_size - 1) / chunk_size;
+
+        std::vector<valueType> partial_results(num_chunks, identity);
+        parallelFor(0, num_chunks, [&](size_t first_chunk, size_t last_chunk)
+        {
+            for (size_t c = first_chunk; c < last_chunk; ++c)
+            {
+                size_t b = begin + c * chunk_size;
+                size_t e = ( b + chunk_size < end ? b + chunk_size : end );
+                partial_results[c] = f(b, e);
+            }
+        }, 1, p);
+
+        valueType result = identity;
+        for (size_t c = 0; c < num_chunks; ++c)
+        {
+            result = r(result, partial_results[c]);
+        }
+
+        return result;
+    }
+
+}
+
+#endif
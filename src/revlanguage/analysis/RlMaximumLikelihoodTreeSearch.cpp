@@ -0,0 +1,217 @@
+#include <stddef.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ArgumentRule.h"
+#include "ArgumentRules.h"
+#include "MaximumLikelihoodTreeSearch.h"
+#include "Model.h"
+#include "ModelVector.h"
+#include "Natural.h"
+#include "RealPos.h"
+#include "RlBoolean.h"
+#include "RlBranchLengthTree.h"
+#include "RlMaximumLikelihoodTreeSearch.h"
+#include "RlModel.h"
+#include "RlString.h"
+#include "TypeSpec.h"
+#include "Argument.h"
+#include "MemberProcedure.h"
+#include "MethodTable.h"
+#include "RevObject.h"
+#include "RevPtr.h"
+#include "RevVariable.h"
+#include "Tree.h"
+#include "WorkspaceToCoreWrapperObject.h"
+
+
+using namespace RevLanguage;
+
+MaximumLikelihoodTreeSearch::MaximumLikelihoodTreeSearch() : WorkspaceToCoreWrapperObject<RevBayesCore::MaximumLikelihoodTreeSearch>()
+{
+    initializeMethods();
+}
+
+
+/**
+ * The clone function is a convenience function to create proper copies of inherited objected.
+ * E.g. a.clone() will create a clone of the correct type even if 'a' is of derived type 'b'.
+ *
+ * \return A new copy of the tree search.
+ */
+MaximumLikelihoodTreeSearch* MaximumLikelihoodTreeSearch::clone(void) const
+{
+    
+    return new MaximumLikelihoodTreeSearch(*this);
+}
+
+/** Construct a new internal object and sets value to it **/
+void MaximumLikelihoodTreeSearch::constructInternalObject( void )
+{
+    // we free the memory first
+    delete value;
+    
+    // now allocate a new tree search
+    const RevBayesCore::Model&  mdl = static_cast<const Model &>( model->getRevObject() ).getValue();
+    const std::string&          n   = static_cast<const RlString &>( tree->getRevObject() ).getValue();
+    
+    value = new RevBayesCore::MaximumLikelihoodTreeSearch( mdl, n );
+    
+}
+
+
+/**
+ * Get the Rev name for the constructor function.
+ *
+ * \return Rev name of constructor function.
+ */
+std::string MaximumLikelihoodTreeSearch::getConstructorFunctionName( void ) const
+{
+    // create a constructor function name variable that is the same for all instance of this class
+    std::string c_name = "treeSearch";
+    
+    return c_name;
+}
+
+
+/** Map calls to member methods
+* @return result of the call
+**/
+RevPtr<RevVariable> MaximumLikelihoodTreeSearch::executeMethod(std::string const &name, const std::vector<Argument> &args, bool &found)
+{
+    
+    if (name == "run")
+    {
+        found = true;
+        
+        double e        = static_cast<const RealPos &>( args[0].getVariable()->getRevObject() ).getValue();
+        long max_rounds = static_cast<const Natural &>( args[1].getVariable()->getRevObject() ).getValue();
+        long radius     = static_cast<const Natural &>( args[2].getVariable()->getRevObject() ).getValue();
+        bool verbose    = static_cast<const RlBoolean &>( args[3].getVariable()->getRevObject() ).getValue();
+        
+        value->run( e, size_t(max_rounds), size_t(radius), verbose );
+        
+        return new RevVariable( new BranchLengthTree( value->getTree() ) );
+    }
+    else if (name == "bootstrap")
+    {
+        found = true;
+        
+        long n          = static_cast<const Natural &>( args[0].getVariable()->getRevObject() ).getValue();
+        double e        = static_cast<const RealPos &>( args[1].getVariable()->getRevObject() ).getValue();
+        long max_rounds = static_cast<const Natural &>( args[2].getVariable()->getRevObject() ).getValue();
+        long radius     = static_cast<const Natural &>( args[3].getVariable()->getRevObject() ).getValue();
+        bool verbose    = static_cast<const RlBoolean &>( args[4].getVariable()->getRevObject() ).getValue();
+        
+        std::vector<RevBayesCore::Tree> trees = value->bootstrap( size_t(n), e, size_t(max_rounds), size_t(radius), verbose );
+        
+        ModelVector<BranchLengthTree> *rl_trees = new ModelVector<BranchLengthTree>;
+        for (size_t i=0; i<trees.size(); ++i)
+        {
+            rl_trees->push_back( trees[i] );
+        }
+        return new RevVariable( rl_trees );
+    }
+    
+    return RevObject::executeMethod( name, args, found );
+}
+
+
+/** Get Rev type of object */
+const std::string& MaximumLikelihoodTreeSearch::getClassType(void)
+{
+    
+    static std::string rev_type = "MaximumLikelihoodTreeSearch";
+    
+    return rev_type;
+}
+
+/** Get class type spec describing type of object */
+const TypeSpec& MaximumLikelihoodTreeSearch::getClassTypeSpec(void)
+{
+    
+    static TypeSpec rev_type_spec = TypeSpec( getClassType(), new TypeSpec( WorkspaceToCoreWrapperObject<RevBayesCore::MaximumLikelihoodTreeSearch>::getClassTypeSpec() ) );
+    
+    return rev_type_spec;
+}
+
+
+
+/** Return member rules */
+const MemberRules& MaximumLikelihoodTreeSearch::getParameterRules(void) const
+{
+    
+    static MemberRules memberRules;
+    static bool rules_set = false;
+    
+    if ( !rules_set )
+    {
+        
+        memberRules.push_back( new ArgumentRule("model", Model::getClassTypeSpec()   , "The model graph.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+        memberRules.push_back( new ArgumentRule("tree" , RlString::getClassTypeSpec(), "The name of the tree variable with free branch lengths.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+        
+        rules_set = true;
+    }
+    
+    return memberRules;
+}
+
+
+/** Get type spec */
+const TypeSpec& MaximumLikelihoodTreeSearch::getTypeSpec( void ) const
+{
+    
+    static TypeSpec type_spec = getClassTypeSpec();
+    
+    return type_spec;
+}
+
+
+/** Initialize the member methods */
+void MaximumLikelihoodTreeSearch::initializeMethods()
+{
+    
+    ArgumentRules* runArgRules = new ArgumentRules();
+    runArgRules->push_back( new ArgumentRule( "epsilon"  , RealPos::getClassTypeSpec()  , "The minimum improvement of the ln likelihood per round.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.001) ) );
+    runArgRules->push_back( new ArgumentRule( "maxRounds", Natural::getClassTypeSpec()  , "The maximum number of rounds of NNI, SPR and branch length optimization.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(100) ) );
+    runArgRules->push_back( new ArgumentRule( "sprRadius", Natural::getClassTypeSpec()  , "The maximum number of branches a subtree is moved by SPR (0 for NNI only).", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(5) ) );
+    runArgRules->push_back( new ArgumentRule( "verbose"  , RlBoolean::getClassTypeSpec(), "Print the ln likelihood after each round?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(true) ) );
+    methods.addFunction( new MemberProcedure( "run", BranchLengthTree::getClassTypeSpec(), runArgRules) );
+    
+    ArgumentRules* bootstrapArgRules = new ArgumentRules();
+    bootstrapArgRules->push_back( new ArgumentRule( "replicates", Natural::getClassTypeSpec()  , "The number of bootstrap replicates.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+    bootstrapArgRules->push_back( new ArgumentRule( "epsilon"   , RealPos::getClassTypeSpec()  , "The minimum improvement of the ln likelihood per round.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.001) ) );
+    bootstrapArgRules->push_back( new ArgumentRule( "maxRounds" , Natural::getClassTypeSpec()  , "The maximum number of rounds of NNI, SPR and branch length optimization.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(100) ) );
+    bootstrapArgRules->push_back( new ArgumentRule( "sprRadius" , Natural::getClassTypeSpec()  , "The maximum number of branches a subtree is moved by SPR (0 for NNI only).", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(5) ) );
+    bootstrapArgRules->push_back( new ArgumentRule( "verbose"   , RlBoolean::getClassTypeSpec(), "Print the progress of the replicates?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(true) ) );
+    methods.addFunction( new MemberProcedure( "bootstrap", ModelVector<BranchLengthTree>::getClassTypeSpec(), bootstrapArgRules) );
+    
+}
+
+
+void MaximumLikelihoodTreeSearch::printValue(std::ostream &o) const
+{
+    
+    o << "MaximumLikelihoodTreeSearch";
+}
+
+
+/** Set member variable */
+void MaximumLikelihoodTreeSearch::setConstParameter(const std::string& name, const RevPtr<const RevVariable> &var)
+{
+    
+    if ( name == "model")
+    {
+        model = var;
+    }
+    else if ( name == "tree")
+    {
+        tree = var;
+    }
+    else
+    {
+        RevObject::setConstParameter(name, var);
+    }
+    
+}
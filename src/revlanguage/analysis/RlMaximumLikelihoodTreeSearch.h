@@ -0,0 +1,50 @@
+#ifndef RlMaximumLikelihoodTreeSearch_H
+#define RlMaximumLikelihoodTreeSearch_H
+
+#include "MaximumLikelihoodTreeSearch.h"
+#include "WorkspaceToCoreWrapperObject.h"
+
+#include <ostream>
+#include <string>
+
+namespace RevLanguage {
+    
+    
+    /**
+     * @brief RevLanguage wrapper class for the maximum likelihood tree search.
+     *
+     * @copydetails RevBayesCore::MaximumLikelihoodTreeSearch
+     * @see RevBayesCore::MaximumLikelihoodTreeSearch for the internal object
+     */
+    class MaximumLikelihoodTreeSearch : public WorkspaceToCoreWrapperObject<RevBayesCore::MaximumLikelihoodTreeSearch> {
+        
+    public:
+        
+        MaximumLikelihoodTreeSearch(void);
+        
+        // Basic utility functions
+        virtual MaximumLikelihoodTreeSearch*        clone(void) const;                                                                      //!< Deep copy of the object
+        void                                        constructInternalObject(void);                                                          //!< Construct a new internal MaximumLikelihoodTreeSearch object.
+        std::string                                 getConstructorFunctionName(void) const;                                                 //!< Get the name used for the constructor function in Rev.
+        static const std::string&                   getClassType(void);                                                                     //!< Get Rev type
+        static const TypeSpec&                      getClassTypeSpec(void);                                                                 //!< Get class type spec
+        const MemberRules&                          getParameterRules(void) const;                                                          //!< Get member rules (const)
+        virtual const TypeSpec&                     getTypeSpec(void) const;                                                                //!< Get language type of the object
+        
+        // Member method inits
+        virtual RevPtr<RevVariable>                 executeMethod(const std::string& name, const std::vector<Argument>& args, bool &f);     //!< Map member methods to internal functions
+        
+    protected:
+        
+        void                                        initializeMethods(void);                                                                //!< Initialize the member methods
+        virtual void                                printValue(std::ostream& o) const;                                                      //!< Print value (for user)
+        void                                        setConstParameter(const std::string& name, const RevPtr<const RevVariable> &var);       //!< Set member variable
+        
+        RevPtr<const RevVariable>                   model;      //!< the model graph
+        RevPtr<const RevVariable>                   tree;       //!< the name of the tree variable
+        
+    };
+    
+}
+
+#endif
@@ -6,7 +6,9 @@
 #include "ArgumentRules.h"
 #include "MemberProcedure.h"
 #include "MethodTable.h"
+#include "ModelVector.h"
 #include "Natural.h"
+#include "RlBoolean.h"
 #include "RlModel.h"
 #include "RlString.h"
 #include "RlAncestralStateTrace.h"
@@ -31,6 +33,8 @@ PosteriorPredictiveSimulation::PosteriorPredictiveSimulation() : WorkspaceToCore
     
     ArgumentRules* runArgRules = new ArgumentRules();
     runArgRules->push_back( new ArgumentRule("thinning", Natural::getClassTypeSpec(), "The number of samples to jump over.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(1)) );
+    runArgRules->push_back( new ArgumentRule("statistics", ModelVector<RlString>::getClassTypeSpec(), "The test statistics computed on the simulated data ('lnL', 'siteLnL', 'multinomial', 'entropy').", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new ModelVector<RlString>()) );
+    runArgRules->push_back( new ArgumentRule("writeData", RlBoolean::getClassTypeSpec(), "Should we write the simulated data into one directory per simulation?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(true)) );
     this->methods.addFunction( new MemberProcedure( "run", RlUtils::Void, runArgRules) );
     
 }
@@ -41,6 +45,8 @@ PosteriorPredictiveSimulation::PosteriorPredictiveSimulation(const RevBayesCore:
     
     ArgumentRules* runArgRules = new ArgumentRules();
     runArgRules->push_back( new ArgumentRule("thinning", Natural::getClassTypeSpec(), "The number of samples to jump over.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(1)) );
+    runArgRules->push_back( new ArgumentRule("statistics", ModelVector<RlString>::getClassTypeSpec(), "The test statistics computed on the simulated data ('lnL', 'siteLnL', 'multinomial', 'entropy').", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new ModelVector<RlString>()) );
+    runArgRules->push_back( new ArgumentRule("writeData", RlBoolean::getClassTypeSpec(), "Should we write the simulated data into one directory per simulation?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(true)) );
     this->methods.addFunction( new MemberProcedure( "run", RlUtils::Void, runArgRules) );
     
     
@@ -105,7 +111,14 @@ RevPtr<RevLanguage::RevVariable> RevLanguage::PosteriorPredictiveSimulation::exe
         found = true;
         
         double t            = static_cast<const Natural &>( args[0].getVariable()->getRevObject() ).getValue();
-        this->value->run( t );
+        const RevBayesCore::RbVector<std::string> &tmp_s = static_cast<const ModelVector<RlString> &>( args[1].getVariable()->getRevObject() ).getValue();
+        bool w              = static_cast<const RlBoolean &>( args[2].getVariable()->getRevObject() ).getValue();
+        std::vector<std::string> s;
+        for (size_t i = 0; i < tmp_s.size(); ++i)
+        {
+            s.push_back( tmp_s[i] );
+        }
+        this->value->run( t, s, w );
         
         return NULL;
     }
@@ -94,11 +94,13 @@ void PowerPosteriorAnalysis::constructInternalObject( void )
     const double                                    alpha   = static_cast<const RealPos &>( alphaVal->getRevObject() ).getValue();
     const int                                       sf      = (int)static_cast<const Natural &>( sampFreq->getRevObject() ).getValue();
     const int                                       k       = (int)static_cast<const Natural &>( proc_per_lik->getRevObject() ).getValue();
+    const size_t                                    nt      = (size_t)static_cast<const Natural &>( threads_per_lik->getRevObject() ).getValue();
 
     RevBayesCore::Mcmc *m = new RevBayesCore::Mcmc(mdl, mvs, mntr);
     m->setScheduleType( "random" );
 
     value = new RevBayesCore::PowerPosteriorAnalysis( m, fn, size_t(k) );
+    value->setNumberOfThreads( nt );
 
     std::vector<double> beta;
     if ( powers->getRevObject() != RevNullObject::getInstance() )
@@ -210,6 +212,7 @@ const MemberRules& PowerPosteriorAnalysis::getParameterRules(void) const
         member_rules.push_back( new ArgumentRule("alpha"      , RealPos::getClassTypeSpec()                 , "The alpha parameter of the beta distribution if no powers are specified.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.2) ) );
         member_rules.push_back( new ArgumentRule("sampleFreq" , Natural::getClassTypeSpec()                 , "The sampling frequency of the likelihood values.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(100) ) );
         member_rules.push_back( new ArgumentRule("procPerLikelihood" , Natural::getClassTypeSpec()          , "Number of processors used to compute the likelihood.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(1) ) );
+        member_rules.push_back( new ArgumentRule("threadsPerLikelihood" , Natural::getClassTypeSpec()       , "Number of threads used to compute the likelihood (0 means the number of threads set by setOption(\"numThreads\")).", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(0L) ) );
 
         rules_set = true;
     }
@@ -276,6 +279,10 @@ void PowerPosteriorAnalysis::setConstParameter(const std::string& name, const Re
     {
         proc_per_lik = var;
     }
+    else if ( name == "threadsPerLikelihood" )
+    {
+        threads_per_lik = var;
+    }
     else
     {
         RevObject::setConstParameter(name, var);
@@ -7,6 +7,7 @@
 #include "ArgumentRules.h"
 #include "Natural.h"
 #include "Probability.h"
+#include "RlString.h"
 #include "ValidationAnalysis.h"
 #include "RlMonteCarloAnalysis.h"
 #include "RlValidationAnalysis.h"
@@ -106,8 +107,9 @@ RevPtr<RevVariable> ValidationAnalysis::executeMethod(std::string const &name, c
         found = true;
         
         double coverage = static_cast<const Probability &>( args[0].getVariable()->getRevObject() ).getValue();
+        const std::string &rank_file = static_cast<const RlString &>( args[1].getVariable()->getRevObject() ).getValue();
         
-        value->summarizeAll(coverage);
+        value->summarizeAll(coverage, rank_file);
         
         return NULL;
     }
@@ -181,6 +183,7 @@ void ValidationAnalysis::initializeMethods()
 
     ArgumentRules* summarizeArgRules = new ArgumentRules();
     summarizeArgRules->push_back( new ArgumentRule( "coverageProbability", Probability::getClassTypeSpec(), "The number of generations to run.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Probability(0.9) ) );
+    summarizeArgRules->push_back( new ArgumentRule( "rankFile", RlString::getClassTypeSpec(), "The file to which the rank statistics of the simulated values among the samples are written (simulation-based calibration).", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlString("") ) );
     methods.addFunction( new MemberProcedure( "summarize", RlUtils::Void, summarizeArgRules) );
     
 }
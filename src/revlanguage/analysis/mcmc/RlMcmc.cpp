@@ -72,6 +72,7 @@ void Mcmc::constructInternalObject( void )
     const std::string &                                     sched   = static_cast<const RlString &>( moveschedule->getRevObject() ).getValue();
     int                                                     nreps   = (int)static_cast<const Natural &>( num_runs->getRevObject() ).getValue();
     int                                                     ntries  = (int)static_cast<const Natural &>( num_init_attempts->getRevObject() ).getValue();
+    size_t                                                  nthreads = (size_t)static_cast<const Natural &>( threads_per_likelihood->getRevObject() ).getValue();
     const std::string &                                     comb    = static_cast<const RlString &>( combine_traces->getRevObject() ).getValue();
 
     RevBayesCore::MonteCarloAnalysisOptions::TraceCombinationTypes ct = RevBayesCore::MonteCarloAnalysisOptions::SEQUENTIAL;
@@ -109,6 +110,7 @@ void Mcmc::constructInternalObject( void )
     }
     
     value = new RevBayesCore::MonteCarloAnalysis(m,nreps,ct);
+    value->setNumberOfThreads( nthreads );
     
 }
 
@@ -87,6 +87,7 @@ void Mcmcmc::constructInternalObject( void )
     int                                                     nreps   = (int)static_cast<const Natural &>( num_runs->getRevObject() ).getValue();
     const std::string &                                     comb    = static_cast<const RlString &>( combine_traces->getRevObject() ).getValue();
     int                                                     ntries  = (int)static_cast<const Natural &>( num_init_attempts->getRevObject() ).getValue();
+    size_t                                                  nthreads = (size_t)static_cast<const Natural &>( threads_per_likelihood->getRevObject() ).getValue();
     
     bool                                                    th      = static_cast<const RlBoolean &>( tune_heat->getRevObject() ).getValue();
     double                                                  tht     = static_cast<const Probability &>( tune_heat_target->getRevObject() ).getValue();
@@ -145,6 +146,7 @@ void Mcmcmc::constructInternalObject( void )
     }
     
     value = new RevBayesCore::MonteCarloAnalysis(m,nreps,ct);
+    value->setNumberOfThreads( nthreads );
     
 }
 
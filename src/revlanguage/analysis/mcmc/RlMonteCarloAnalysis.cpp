@@ -10,6 +10,7 @@
 #include "MonteCarloAnalysis.h"
 #include "Natural.h"
 #include "OptionRule.h"
+#include "Profiler.h"
 #include "RbException.h"
 #include "RlMonteCarloAnalysis.h"
 #include "RlModel.h"
@@ -157,8 +158,19 @@ RevPtr<RevVariable> MonteCarloAnalysis::executeMethod(std::string const &name, c
         found = true;
         
         bool current_period = static_cast<const RlBoolean &>( args[0].getVariable()->getRevObject() ).getValue();
+        const std::string &profile_file = static_cast<const RlString &>( args[1].getVariable()->getRevObject() ).getValue();
         
-        value->printPerformanceSummary( current_period );
+        value->printPerformanceSummary( current_period, profile_file );
+        
+        return NULL;
+    }
+    else if ( name == "profile")
+    {
+        found = true;
+        
+        bool enable = static_cast<const RlBoolean &>( args[0].getVariable()->getRevObject() ).getValue();
+        
+        RevBayesCore::Profiler::globalProfiler().setEnabled( enable );
         
         return NULL;
     }
@@ -231,6 +243,7 @@ const MemberRules& MonteCarloAnalysis::getParameterRules(void) const
         options_schedule.push_back( "sequential" );
         options_schedule.push_back( "random" );
         options_schedule.push_back( "single" );
+        options_schedule.push_back( "adaptive" );
         
         member_rules.push_back( new OptionRule( "moveschedule", new RlString( "random" ), options_schedule, "The strategy how the moves are used." ) );
         
@@ -247,6 +260,9 @@ const MemberRules& MonteCarloAnalysis::getParameterRules(void) const
         // the number of tries to initialize the MCMC until it fails
         member_rules.push_back( new ArgumentRule("ntries"   , Natural::getClassTypeSpec(), "The number of initialization attempts.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(1000) ) );
 
+        // the number of threads that each replicate/chain uses for its likelihood (in addition to the MPI processes)
+        member_rules.push_back( new ArgumentRule("threadsPerLikelihood", Natural::getClassTypeSpec(), "The number of threads used to compute the likelihood of each run (0 means the number of threads set by setOption(\"numThreads\")).", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(0L) ) );
+
         rules_set = true;
     }
     
@@ -284,8 +300,13 @@ void MonteCarloAnalysis::initializeMethods()
     
     ArgumentRules* operatorSummaryArgRules = new ArgumentRules();
     operatorSummaryArgRules->push_back( new ArgumentRule( "currentPeriod" , RlBoolean::getClassTypeSpec(), "Should the operator summary (number of tries and acceptance, and the acceptance ratio) of only the current period (i.e., after the last tuning) be printed?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(false) ) );
+    operatorSummaryArgRules->push_back( new ArgumentRule( "profileFile" , RlString::getClassTypeSpec(), "The file to which the profile (the time spent per move, variable and likelihood phase) is written as a table, if profiling is enabled.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlString("") ) );
     methods.addFunction( new MemberProcedure( "operatorSummary", RlUtils::Void, operatorSummaryArgRules) );
     
+    ArgumentRules* profile_arg_rules = new ArgumentRules();
+    profile_arg_rules->push_back( new ArgumentRule( "enable" , RlBoolean::getClassTypeSpec(), "Should we record the time spent per move, variable and likelihood phase? Enabling removes the previous profile.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(true) ) );
+    methods.addFunction( new MemberProcedure( "profile", RlUtils::Void, profile_arg_rules) );
+    
     ArgumentRules* initialize_trace_arg_rules = new ArgumentRules();
     initialize_trace_arg_rules->push_back( new ArgumentRule("trace", WorkspaceVector<ModelTrace>::getClassTypeSpec(), "The sample trace object.", ArgumentRule::BY_CONSTANT_REFERENCE, ArgumentRule::ANY ) );
     methods.addFunction( new MemberProcedure( "initializeFromTrace", RlUtils::Void, initialize_trace_arg_rules) );
@@ -341,6 +362,10 @@ void MonteCarloAnalysis::setConstParameter(const std::string& name, const RevPtr
     {
         num_init_attempts = var;
     }
+    else if ( name == "threadsPerLikelihood")
+    {
+        threads_per_likelihood = var;
+    }
     else
     {
         WorkspaceToCoreWrapperObject<RevBayesCore::MonteCarloAnalysis>::setConstParameter(name, var);
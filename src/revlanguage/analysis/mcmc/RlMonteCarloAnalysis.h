@@ -53,6 +53,7 @@ namespace RevLanguage {
         RevPtr<const RevVariable>                   num_init_attempts;
         RevPtr<const RevVariable>                   combine_traces;
         RevPtr<const RevVariable>                   num_runs;
+        RevPtr<const RevVariable>                   threads_per_likelihood;
 
         
     };
@@ -340,15 +340,13 @@ bool UserFunctionNode<rlType>::isConstant( void ) const
 /**
  * Keep the current value of the node. We need not and should not change the touched
  * flag here. If we have not been updated, we should just leave the touched flag in
- * the dirty state. We pass on the message unconditionally, to be on the safe side
- * if the DAG is in an inconsistent state.
+ * the dirty state. The downstream nodes are kept unconditionally by the node that
+ * started the keep (see DagNode::keepAffected).
  */
 template<typename rlType>
 void UserFunctionNode<rlType>::keepMe( RevBayesCore::DagNode* affecter )
 {
     
-    // Pass the call to downstream nodes
-    this->keepAffected();
 }
 
 
@@ -402,8 +400,8 @@ void UserFunctionNode<rlType>::printStructureInfo( std::ostream& o, bool verbose
  * we rely on lazy evaluation, and update the value when somebody asks for
  * the value.
  *
- * The call is passed on unconditionally, to guard us against inconsistent
- * DAG states.
+ * The downstream nodes are restored unconditionally by the node that started
+ * the restore (see DagNode::restoreAffected).
  */
 template<typename rlType>
 void UserFunctionNode<rlType>::restoreMe( RevBayesCore::DagNode* restorer )
@@ -412,8 +410,6 @@ void UserFunctionNode<rlType>::restoreMe( RevBayesCore::DagNode* restorer )
     // We can no longer trust our value, so mark us as touched
     this->touched = true;
     
-    // Dispatch call to downstream nodes
-    this->restoreAffected();
 }
 
 
@@ -491,10 +487,8 @@ void UserFunctionNode<rlType>::swapParent(const RevBayesCore::DagNode* oldParent
 
 
 /**
- * Touch this node for recalculation. We only need to pass the message on
- * if we have not been touched before, conditional on all touched messages being
- * guaranteed to be followed either by a keep or a restore message so the DAG is
- * not in an inconsistent state. To be safe, we pass on the message regardless,
+ * Touch this node for recalculation. The node that started the touch passes the
+ * message on to the downstream nodes regardless of our state (see DagNode::touchAffected),
  * so that the touch propagates correctly regardless of the starting DAG state.
  */
 template<typename rlType>
@@ -504,8 +498,6 @@ void UserFunctionNode<rlType>::touchMe( RevBayesCore::DagNode* toucher, bool tou
     // Touch myself
     this->touched = true;
     
-    // Dispatch the touch message to downstream nodes
-    this->touchAffected( touchAll );
 }
 
 
@@ -456,15 +456,20 @@ double ArgumentRule::isArgumentValid( Argument &arg, bool once) const
             args.push_back( the_var );
             
             Environment& env = Workspace::globalWorkspace();
-            try
-            {
-                // we just want to check if the function exists and can be found
-                env.getFunction(function_name, args, once);
-                return 0.1;
-            }
-            catch (RbException& e)
+            
+            // most type pairs have no conversion function, and we don't want to pay for the exception then
+            if ( env.existsFunction( function_name ) == true )
             {
-                // we do nothing here
+                try
+                {
+                    // we just want to check if the function exists and can be found
+                    env.getFunction(function_name, args, once);
+                    return 0.1;
+                }
+                catch (RbException& e)
+                {
+                    // we do nothing here
+                }
             }
 
         }
@@ -119,6 +119,7 @@ bool Func_ls::matchAnalysisToken( std::string name ) const
     valid_tokens.insert("HillClimber");
     valid_tokens.insert("CorrespondenceAnalysis");
     valid_tokens.insert("BootstrapAnalysis");
+    valid_tokens.insert("treeSearch");
     
     if (valid_tokens.find( name ) != valid_tokens.end()) {
         match = true;
@@ -1,5 +1,6 @@
 #include <math.h>
 #include <stddef.h>
+#include <algorithm>
 #include <map>
 #include <set>
 #include <sstream>
@@ -318,6 +319,34 @@ const TypeSpec& Func_readTreeTrace::getReturnType( void ) const
 }
 
 
+/** Find the end of the line starting at b, i.e., the first newline character or the end of the buffer e */
+static const char* findLineEnd(const char *b, const char *e)
+{
+    while ( b != e && *b != '\n' && *b != '\r' )
+    {
+        ++b;
+    }
+    
+    return b;
+}
+
+
+/** Skip the newline at the end of a line (either "\n", "\r" or "\r\n") */
+static const char* skipLineEnd(const char *line_end, const char *e)
+{
+    if ( line_end == e )
+    {
+        return e;
+    }
+    if ( *line_end == '\r' && line_end+1 != e && *(line_end+1) == '\n' )
+    {
+        return line_end + 2;
+    }
+    
+    return line_end + 1;
+}
+
+
 WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<std::string> &vector_of_file_names, const std::string &delimitter, bool clock, long thinning)
 {
     
@@ -327,6 +356,10 @@ WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<std:
     // read all of the files in the string called "vectorOfFileNames" because some of them may not be in a format
     // that can be read.
     std::map<std::string,std::string> file_ap;
+    // the content of the current file, reused for all files
+    std::string buffer;
+    RevBayesCore::NewickConverter c;
+    
     for (std::vector<std::string>::const_iterator p = vector_of_file_names.begin(); p != vector_of_file_names.end(); ++p)
     {
         bool has_header_been_read = false;
@@ -334,42 +367,31 @@ WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<std:
         
         RevBayesCore::RbFileManager fm = RevBayesCore::RbFileManager(fn);
         
-        // let us quickly count the number of lines
-        size_t lines = 0;
-        std::ifstream tmp_in_file( fm.getFullFileName().c_str() );
-        
-        if ( !tmp_in_file )
+        // we read the file at once and convert the trees directly from the buffer without copying the lines
+        if ( fm.readFile( buffer ) == false )
         {
             throw RbException( "Could not open file \"" + fn + "\"" );
         }
-        while ( tmp_in_file.good() )
+        const char *file_begin = buffer.c_str();
+        const char *file_end   = file_begin + buffer.size();
+        
+        // let us quickly count the number of lines
+        size_t lines = 0;
+        for (const char *line_begin = file_begin; line_begin < file_end; )
         {
-            // Read a line
-            std::string line;
-            RevBayesCore::RbFileManager reader = RevBayesCore::RbFileManager();
-            reader.safeGetline(tmp_in_file, line);
-            if (line.length() == 0 || line[0] == '#')
+            const char *line_end = findLineEnd( line_begin, file_end );
+            if ( line_end != line_begin && *line_begin != '#' )
             {
-                continue;
+                ++lines;
             }
-            ++lines;
+            line_begin = skipLineEnd( line_end, file_end );
         }
-        tmp_in_file.close();
         
         RevBayesCore::ProgressBar progress = RevBayesCore::ProgressBar( lines, 0 );
 
         // now we actually process the input
         
-        /* Open file */
-        std::ifstream in_file( fm.getFullFileName().c_str() );
-        
-        if ( !in_file )
-        {
-            throw RbException( "Could not open file \"" + fn + "\"" );
-        }
-        
         /* Initialize */
-        std::string commandLine;
         RBOUT( "Processing file \"" + fn + "\"");
         
         size_t n_samples = 0;
@@ -380,38 +402,30 @@ WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<std:
         t.setFileName(fn);
 
         /* Command-processing loop */
-        while ( in_file.good() )
+        for (const char *line_begin = file_begin; line_begin < file_end; )
         {
             
             // Read a line
-            std::string line;
-            RevBayesCore::RbFileManager reader = RevBayesCore::RbFileManager();
-            reader.safeGetline(in_file, line);
-            
-            // skip empty lines
-            //line = StringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-            if (line.length() == 0)
-            {
-                continue;
-            }
+            const char *line_end = findLineEnd( line_begin, file_end );
+            const char *next_line = skipLineEnd( line_end, file_end );
             
-            
-            // removing comments
-            if (line[0] == '#')
+            // skip empty lines and comments
+            if ( line_end == line_begin || *line_begin == '#' )
             {
+                line_begin = next_line;
                 continue;
             }
             
-            // splitting every line into its columns
-            std::vector<std::string> columns;
-            
-            // we should provide other delimiters too
-            StringUtilities::stringSplit(line, delimitter, columns);
-            
             // we assume a header at the first line of the file
             if ( has_header_been_read == false )
             {
                 
+                // splitting the header into its columns
+                std::vector<std::string> columns;
+                
+                // we should provide other delimiters too
+                StringUtilities::stringSplit(std::string(line_begin, line_end), delimitter, columns);
+                
                 for (size_t j=1; j<columns.size(); j++)
                 {
                     
@@ -429,6 +443,7 @@ WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<std:
                 
                 has_header_been_read = true;
                 
+                line_begin = next_line;
                 continue;
             }
             
@@ -438,27 +453,39 @@ WorkspaceVector<TraceTree>* Func_readTreeTrace::readTrees(const std::vector<std:
             // we need to check if we skip this sample in case of thinning.
             if ( (n_samples-1) % thinning > 0 )
             {
+                line_begin = next_line;
                 continue;
             }
             
-            RevBayesCore::Tree *tau = NULL;
-            if ( clock == true )
+            // find the column with the tree
+            const char *column_begin = line_begin;
+            const char *column_end = line_end;
+            for (size_t j = 0; j <= index; ++j)
             {
-                RevBayesCore::NewickConverter c;
-                RevBayesCore::Tree *blTree = c.convertFromNewick( columns[index] );
-                tau = RevBayesCore::TreeUtilities::convertTree( *blTree );
+                if ( j > 0 )
+                {
+                    if ( column_end == line_end )
+                    {
+                        throw RbException( "Missing tree in line " + StringUtilities::toString(n_samples) + " of file \"" + fn + "\"" );
+                    }
+                    column_begin = column_end + delimitter.size();
+                }
+                column_end = std::search( column_begin, line_end, delimitter.begin(), delimitter.end() );
             }
-            else
+            
+            RevBayesCore::Tree *tau = c.convertFromNewick( column_begin, column_end );
+            if ( clock == true )
             {
-                RevBayesCore::NewickConverter c;
-                tau = c.convertFromNewick( columns[index] );
+                RevBayesCore::Tree *blTree = tau;
+                tau = RevBayesCore::TreeUtilities::convertTree( *blTree );
+                delete blTree;
             }
             
             t.addObject( tau );
             progress.update( n_samples );
             
+            line_begin = next_line;
         }
-        in_file.close();
         
         progress.finish();
 
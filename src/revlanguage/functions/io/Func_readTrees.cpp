@@ -1,5 +1,4 @@
 #include <stddef.h>
-#include <sstream>
 #include <string>
 #include <vector>
 
@@ -50,6 +49,29 @@ Func_readTrees* Func_readTrees::clone( void ) const
 }
 
 
+/**
+ * Find the next non-empty line in the text, starting at b.
+ * On return, [b,e) is the line.
+ */
+static bool nextLine(const char *&b, const char *&e, const char *text_end)
+{
+    
+    // skip the newline characters (and thereby empty lines)
+    while ( b != text_end && (*b == '\n' || *b == '\r') )
+    {
+        ++b;
+    }
+    
+    e = b;
+    while ( e != text_end && *e != '\n' && *e != '\r' )
+    {
+        ++e;
+    }
+    
+    return b != e;
+}
+
+
 /** Execute function */
 RevPtr<RevVariable> Func_readTrees::execute( void )
 {
@@ -94,35 +116,37 @@ RevPtr<RevVariable> Func_readTrees::execute( void )
     if (text != "")
     {
 
-        string aux;
-        std::istringstream iss(text);
+        // we convert the trees directly from the text, one per line
         RevBayesCore::NewickConverter c;
+        const char *line_begin = text.c_str();
+        const char *text_end   = line_begin + text.size();
+        const char *line_end   = NULL;
         
-        
-        RevBayesCore::RbFileManager file_reader = RevBayesCore::RbFileManager();
         if ( treetype == "clock" )
         {
             ModelVector<TimeTree> *trees = new ModelVector<TimeTree>();
-            while (file_reader.safeGetline(iss, aux))
+            while ( nextLine(line_begin, line_end, text_end) == true )
             {
-                RevBayesCore::Tree *blTree = c.convertFromNewick( aux );
+                RevBayesCore::Tree *blTree = c.convertFromNewick( line_begin, line_end );
                 trees->push_back( TimeTree(*blTree) );
                 
                 delete blTree;
                 
+                line_begin = line_end;
             }
             return new RevVariable( trees );
         }
         else if ( treetype == "non-clock" )
         {
             ModelVector<BranchLengthTree> *trees = new ModelVector<BranchLengthTree>();
-            while (file_reader.safeGetline(iss, aux))
+            while ( nextLine(line_begin, line_end, text_end) == true )
             {
-                RevBayesCore::Tree *blTree = c.convertFromNewick( aux );
+                RevBayesCore::Tree *blTree = c.convertFromNewick( line_begin, line_end );
                 trees->push_back( BranchLengthTree(*blTree) );
                 
                 delete blTree;
                 
+                line_begin = line_end;
             }
             return new RevVariable( trees );
             
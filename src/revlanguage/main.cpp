@@ -61,6 +61,7 @@ variables_map parse_cmd_line(int argc, char* argv[])
 	// composing means that --file can occur multiple times
         ("file",value<std::vector<std::string> >()->composing(),"File(s) to source.")
         ("setOption",value<std::vector<std::string> >()->composing(),"Set an option key=value.")
+        ("threads",value<size_t>(),"Number of threads per process used for parallel computations (0 means all cores).")
 	;
 
     // Treat all positional options as "file" options.
@@ -181,6 +182,11 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if ( args.count("threads") > 0 )
+    {
+        RbSettings::userSettings().setOption( "numThreads", StringUtilities::to_string( args["threads"].as<size_t>() ), false );
+    }
+
     /*default to interactive mode*/
     bool batch_mode = (args.count("batch") > 0);
     // FIXME -- the batch_mode variable appears to have no effect if true.
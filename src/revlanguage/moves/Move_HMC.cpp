@@ -0,0 +1,358 @@
+#include <stddef.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ArgumentRule.h"
+#include "ArgumentRules.h"
+#include "HamiltonianMonteCarloMove.h"
+#include "ModelVector.h"
+#include "Move_HMC.h"
+#include "Probability.h"
+#include "RbException.h"
+#include "RbConstants.h"
+#include "RealPos.h"
+#include "RevObject.h"
+#include "RlBoolean.h"
+#include "RlBranchLengthTree.h"
+#include "RlTimeTree.h"
+#include "TypedDagNode.h"
+#include "TypeSpec.h"
+#include "Argument.h"
+#include "ContinuousStochasticNode.h"
+#include "MemberProcedure.h"
+#include "MethodTable.h"
+#include "ModelObject.h"
+#include "Move.h"
+#include "Natural.h"
+#include "Real.h"
+#include "RevPtr.h"
+#include "RevVariable.h"
+#include "RlMove.h"
+#include "RlUtils.h"
+#include "StochasticNode.h"
+#include "Tree.h"
+
+namespace RevBayesCore { template <class valueType> class RbVector; }
+
+
+using namespace RevLanguage;
+
+/**
+ * Default constructor.
+ *
+ * The default constructor does nothing except allocating the object.
+ */
+Move_HMC::Move_HMC() : Move()
+{
+
+    // add member methods
+
+    // first, the argument rules
+    ArgumentRules* addScalarArgRules                = new ArgumentRules();
+    ArgumentRules* addPositiveVectorArgRules        = new ArgumentRules();
+    ArgumentRules* addModelVectorArgRules           = new ArgumentRules();
+    ArgumentRules* addTimeTreeArgRules              = new ArgumentRules();
+    ArgumentRules* addBranchLengthTreeArgRules      = new ArgumentRules();
+    ArgumentRules* removeScalarArgRules             = new ArgumentRules();
+    ArgumentRules* removePositiveVectorArgRules     = new ArgumentRules();
+    ArgumentRules* removeModelVectorArgRules        = new ArgumentRules();
+    ArgumentRules* removeTimeTreeArgRules           = new ArgumentRules();
+    ArgumentRules* removeBranchLengthTreeArgRules   = new ArgumentRules();
+
+
+    // next, set the specific arguments
+    addScalarArgRules->push_back(                   new ArgumentRule( "var"        , Real::getClassTypeSpec(),                 "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    addPositiveVectorArgRules->push_back(           new ArgumentRule( "var"        , ModelVector<RealPos>::getClassTypeSpec(), "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    addModelVectorArgRules->push_back(              new ArgumentRule( "var"        , ModelVector<Real>::getClassTypeSpec(),    "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    addTimeTreeArgRules->push_back(                 new ArgumentRule( "var"        , TimeTree::getClassTypeSpec(),             "The tree whose node ages to move" , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    addBranchLengthTreeArgRules->push_back(         new ArgumentRule( "var"        , BranchLengthTree::getClassTypeSpec(),     "The tree whose branch lengths to move", ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    removeScalarArgRules->push_back(                new ArgumentRule( "var"        , Real::getClassTypeSpec(),                 "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    removePositiveVectorArgRules->push_back(        new ArgumentRule( "var"        , ModelVector<RealPos>::getClassTypeSpec(), "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    removeModelVectorArgRules->push_back(           new ArgumentRule( "var"        , ModelVector<Real>::getClassTypeSpec(),    "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    removeTimeTreeArgRules->push_back(              new ArgumentRule( "var"        , TimeTree::getClassTypeSpec(),             "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+    removeBranchLengthTreeArgRules->push_back(      new ArgumentRule( "var"        , BranchLengthTree::getClassTypeSpec(),     "The variable to move"             , ArgumentRule::BY_REFERENCE, ArgumentRule::STOCHASTIC ) );
+
+
+    // finally, create the methods
+    methods.addFunction( new MemberProcedure( "addVariable",    RlUtils::Void, addScalarArgRules) );
+    methods.addFunction( new MemberProcedure( "addVariable",    RlUtils::Void, addPositiveVectorArgRules) );
+    methods.addFunction( new MemberProcedure( "addVariable",    RlUtils::Void, addModelVectorArgRules) );
+    methods.addFunction( new MemberProcedure( "addVariable",    RlUtils::Void, addTimeTreeArgRules) );
+    methods.addFunction( new MemberProcedure( "addVariable",    RlUtils::Void, addBranchLengthTreeArgRules) );
+    methods.addFunction( new MemberProcedure( "removeVariable", RlUtils::Void, removeScalarArgRules) );
+    methods.addFunction( new MemberProcedure( "removeVariable", RlUtils::Void, removePositiveVectorArgRules) );
+    methods.addFunction( new MemberProcedure( "removeVariable", RlUtils::Void, removeModelVectorArgRules) );
+    methods.addFunction( new MemberProcedure( "removeVariable", RlUtils::Void, removeTimeTreeArgRules) );
+    methods.addFunction( new MemberProcedure( "removeVariable", RlUtils::Void, removeBranchLengthTreeArgRules) );
+
+}
+
+
+/**
+ * The clone function is a convenience function to create proper copies of inherited objected.
+ * E.g. a.clone() will create a clone of the correct type even if 'a' is of derived type 'B'.
+ *
+ * \return A new copy of myself
+ */
+Move_HMC* Move_HMC::clone(void) const
+{
+
+    return new Move_HMC(*this);
+}
+
+
+/**
+ * Create a new internal move object.
+ *
+ * This function simply dynamically allocates a new internal move object.
+ * The variables are added afterwards with the member procedure addVariable().
+ */
+void Move_HMC::constructInternalObject( void )
+{
+
+    // we free the memory first
+    delete value;
+
+    // now allocate a new HMC move
+    double eps  = static_cast<const RealPos &>( step_size->getRevObject() ).getValue();
+    long   d    = static_cast<const Natural &>( max_tree_depth->getRevObject() ).getValue();
+    double p    = static_cast<const Probability &>( target_acceptance->getRevObject() ).getValue();
+    double w    = static_cast<const RealPos &>( weight->getRevObject() ).getValue();
+    bool t      = static_cast<const RlBoolean &>( tune->getRevObject() ).getValue();
+
+    value = new RevBayesCore::HamiltonianMonteCarloMove(eps, size_t(d), p, w, t);
+
+}
+
+
+RevPtr<RevVariable> Move_HMC::executeMethod(const std::string& name, const std::vector<Argument>& args, bool &found)
+{
+
+    if ( name == "addVariable" )
+    {
+        found = true;
+
+        RevBayesCore::HamiltonianMonteCarloMove *m = static_cast<RevBayesCore::HamiltonianMonteCarloMove*>(this->value);
+
+        Real* uReal = dynamic_cast<Real *>( &args[0].getVariable()->getRevObject() );
+        RealPos* upReal = dynamic_cast<RealPos *>( &args[0].getVariable()->getRevObject() );
+        ModelVector<RealPos>* upVector = dynamic_cast<ModelVector<RealPos> *>( &args[0].getVariable()->getRevObject() );
+        ModelVector<Real>* uVector = dynamic_cast<ModelVector<Real> *>( &args[0].getVariable()->getRevObject() );
+        TimeTree* time_tree = dynamic_cast<TimeTree *>( &args[0].getVariable()->getRevObject() );
+        BranchLengthTree* branch_length_tree = dynamic_cast<BranchLengthTree *>( &args[0].getVariable()->getRevObject() );
+
+        // Handle scalar variables with possible transforms
+        if ( upReal != NULL || uReal != NULL )
+        {
+            RevBayesCore::DagNode *the_node = ( upReal != NULL ? upReal->getDagNode() : uReal->getDagNode() );
+
+            // the bounds of the variable decide about the transform
+            RevBayesCore::ContinuousStochasticNode *n = dynamic_cast<RevBayesCore::ContinuousStochasticNode *>( the_node );
+            RevBayesCore::StochasticNode<double> *n2 = dynamic_cast<RevBayesCore::StochasticNode<double> *>( the_node );
+            if ( n2 == NULL )
+            {
+                throw RbException("Could not add the node because it isn't a stochastic nodes.");
+            }
+
+            double lower = ( n != NULL ? n->getMin() : RbConstants::Double::neginf );
+            double upper = ( n != NULL ? n->getMax() : RbConstants::Double::inf );
+            if ( upReal != NULL && (lower >= 0.0) == false )
+            {
+                lower = 0.0;
+            }
+            m->addBoundedScalar(n2, lower, upper);
+
+        }
+        else if ( upVector != NULL || uVector != NULL )
+        {
+            RevBayesCore::DagNode *the_node = ( upVector != NULL ? upVector->getDagNode() : uVector->getDagNode() );
+            RevBayesCore::StochasticNode<RevBayesCore::RbVector<double> > *n = dynamic_cast< RevBayesCore::StochasticNode<RevBayesCore::RbVector<double> > * >( the_node );
+
+            if ( n != NULL && upVector != NULL )
+            {
+                m->addLogVector( n );
+            }
+            else if ( n != NULL )
+            {
+                m->addUntransformedVector( n );
+            }
+            else
+            {
+                throw RbException("Could not add the node because it isn't a stochastic nodes.");
+            }
+        }
+        else if ( time_tree != NULL || branch_length_tree != NULL )
+        {
+            RevBayesCore::DagNode *the_node = ( time_tree != NULL ? time_tree->getDagNode() : branch_length_tree->getDagNode() );
+            RevBayesCore::StochasticNode<RevBayesCore::Tree> *n = dynamic_cast< RevBayesCore::StochasticNode<RevBayesCore::Tree> * >( the_node );
+
+            if ( n != NULL && time_tree != NULL )
+            {
+                m->addNodeAges( n );
+            }
+            else if ( n != NULL )
+            {
+                m->addBranchLengths( n );
+            }
+            else
+            {
+                throw RbException("Could not add the node because it isn't a stochastic nodes.");
+            }
+        }
+        else
+        {
+            throw RbException("A problem occured when trying to add " + args[0].getVariable()->getName() + " to the move.");
+        }
+
+        return NULL;
+    }
+    else if ( name == "removeVariable" )
+    {
+        found = true;
+
+        RevBayesCore::HamiltonianMonteCarloMove *m = static_cast<RevBayesCore::HamiltonianMonteCarloMove*>(this->value);
+        m->removeVariable( args[0].getVariable()->getRevObject().getDagNode() );
+
+        return NULL;
+    }
+
+    return Move::executeMethod( name, args, found );
+}
+
+
+/**
+ * Get Rev type of object
+ *
+ * \return The class' name.
+ */
+const std::string& Move_HMC::getClassType(void)
+{
+
+    static std::string rev_type = "Move_HMC";
+
+    return rev_type;
+}
+
+
+/**
+ * Get class type spec describing type of an object from this class (static).
+ *
+ * \return TypeSpec of this class.
+ */
+const TypeSpec& Move_HMC::getClassTypeSpec(void)
+{
+
+    static TypeSpec rev_type_spec = TypeSpec( getClassType(), new TypeSpec( Move::getClassTypeSpec() ) );
+
+    return rev_type_spec;
+}
+
+
+/**
+ * Get the Rev name for the constructor function.
+ *
+ * \return Rev name of constructor function.
+ */
+std::string Move_HMC::getMoveName( void ) const
+{
+    // create a constructor function name variable that is the same for all instance of this class
+    std::string c_name = "HMC";
+
+    return c_name;
+}
+
+
+/**
+ * Get the member rules used to create the constructor of this object.
+ *
+ * The member rules of the HMC move are:
+ * (1) the initial step size.
+ * (2) the maximal tree depth.
+ * (3) the target acceptance statistic.
+ * (4) a flag if we should tune.
+ *
+ * \return The member rules.
+ */
+const MemberRules& Move_HMC::getParameterRules(void) const
+{
+
+    static MemberRules memberRules;
+    static bool rules_set = false;
+
+    if ( !rules_set )
+    {
+        memberRules.push_back( new ArgumentRule( "stepSize"            , RealPos::getClassTypeSpec()    , "The initial step size of the leapfrog integrator.", ArgumentRule::BY_VALUE    , ArgumentRule::ANY, new RealPos(0.1) ) );
+        memberRules.push_back( new ArgumentRule( "maxTreeDepth"        , Natural::getClassTypeSpec()    , "The maximal depth of the trajectory tree, i.e., at most 2^maxTreeDepth leapfrog steps.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(10) ) );
+        memberRules.push_back( new ArgumentRule( "targetAcceptance"    , Probability::getClassTypeSpec(), "The target acceptance statistic when tuning the step size.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Probability(0.8) ) );
+        memberRules.push_back( new ArgumentRule( "tune"                , RlBoolean::getClassTypeSpec()  , "Should we tune the step size and mass matrix during burnin?", ArgumentRule::BY_VALUE    , ArgumentRule::ANY, new RlBoolean( true ) ) );
+
+        /* Inherit weight from Move, put it after variable */
+        const MemberRules& inheritedRules = Move::getParameterRules();
+        memberRules.insert( memberRules.end(), inheritedRules.begin(), inheritedRules.end() );
+
+        rules_set = true;
+    }
+
+    return memberRules;
+}
+
+
+/**
+ * Get type-specification on this object (non-static).
+ *
+ * \return The type spec of this object.
+ */
+const TypeSpec& Move_HMC::getTypeSpec( void ) const
+{
+
+    static TypeSpec type_spec = getClassTypeSpec();
+
+    return type_spec;
+}
+
+
+
+void Move_HMC::printValue(std::ostream &o) const
+{
+
+    o << "Move_HMC(?)";
+
+}
+
+
+/**
+ * Set a member variable.
+ *
+ * Sets a member variable with the given name and store the pointer to the variable.
+ * The value of the variable might still change but this function needs to be called again if the pointer to
+ * the variable changes. The current values will be used to create the distribution object.
+ *
+ * \param[in]    name     Name of the member variable.
+ * \param[in]    var      Pointer to the variable.
+ */
+void Move_HMC::setConstParameter(const std::string& name, const RevPtr<const RevVariable> &var)
+{
+
+    if ( name == "stepSize" )
+    {
+        step_size = var;
+    }
+    else if ( name == "maxTreeDepth" )
+    {
+        max_tree_depth = var;
+    }
+    else if ( name == "targetAcceptance" )
+    {
+        target_acceptance = var;
+    }
+    else if ( name == "tune" )
+    {
+        tune = var;
+    }
+    else
+    {
+        Move::setConstParameter(name, var);
+    }
+
+}
@@ -0,0 +1,60 @@
+#ifndef Move_HMC_H
+#define Move_HMC_H
+
+#include "RlMove.h"
+#include "TypedDagNode.h"
+
+#include <ostream>
+#include <string>
+
+namespace RevLanguage {
+
+
+    /**
+     * The RevLanguage wrapper of the Hamiltonian Monte Carlo (NUTS) move.
+     *
+     * The RevLanguage wrapper of the HMC move simply
+     * manages the interactions through the Rev with our core.
+     * That is, the internal move object can be constructed and the variables
+     * it works on are added with addVariable().
+     * See the HamiltonianMonteCarloMove.h for more details.
+     *
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2026-10-19, version 1.1.1
+     *
+     */
+    class Move_HMC : public Move {
+
+    public:
+
+        Move_HMC(void);                                                                                                                 //!< Default constructor
+
+        // Basic utility functions
+        virtual Move_HMC*                           clone(void) const;                                                                  //!< Clone object
+        void                                        constructInternalObject(void);                                                      //!< We construct the a new internal HMC move.
+        static const std::string&                   getClassType(void);                                                                 //!< Get Rev type
+        static const TypeSpec&                      getClassTypeSpec(void);                                                             //!< Get class type spec
+        std::string                                 getMoveName(void) const;                                                            //!< Get the name used for the constructor function in Rev.
+        const MemberRules&                          getParameterRules(void) const;                                                      //!< Get member rules (const)
+        virtual const TypeSpec&                     getTypeSpec(void) const;                                                            //!< Get language type of the object
+        virtual void                                printValue(std::ostream& o) const;                                                  //!< Print value (for user)
+
+        // Member method functions
+        virtual RevPtr<RevVariable>                 executeMethod(const std::string& name, const std::vector<Argument>& args, bool &f); //!< Map member methods to internal functions
+
+    protected:
+
+        void                                        setConstParameter(const std::string& name, const RevPtr<const RevVariable> &var);   //!< Set member variable
+
+        RevPtr<const RevVariable>                   step_size;                                                                          //!< The initial step size of the leapfrog integrator
+        RevPtr<const RevVariable>                   max_tree_depth;                                                                     //!< The maximal depth of the trajectory tree
+        RevPtr<const RevVariable>                   target_acceptance;                                                                  //!< The target acceptance statistic for tuning
+        RevPtr<const RevVariable>                   tune;                                                                               //!< Should we tune the step size and mass matrix
+
+    };
+
+}
+
+#endif
@@ -21,6 +21,7 @@ SyntaxForLoop::SyntaxForLoop( const std::string& identifier, SyntaxElement* inEx
     varName( identifier ),
     inExpression( inExpr ),
     stateSpace( NULL ),
+    stateSpaceVariable( NULL ),
     nextIndex( 0 )
 {
     if ( inExpression == NULL )
@@ -38,6 +39,7 @@ SyntaxForLoop::SyntaxForLoop( const SyntaxForLoop& x ) :
     varName                     = x.varName;
     inExpression                = x.inExpression->clone();
     stateSpace                  = NULL;
+    stateSpaceVariable          = NULL;
     nextIndex                   = 0;
 }
 
@@ -46,7 +48,6 @@ SyntaxForLoop::SyntaxForLoop( const SyntaxForLoop& x ) :
 SyntaxForLoop::~SyntaxForLoop()
 {
     delete inExpression;
-    delete stateSpace;
 }
 
 
@@ -58,11 +59,11 @@ SyntaxForLoop& SyntaxForLoop::operator=( const SyntaxForLoop& x )
         SyntaxElement::operator=(x);
 
         delete inExpression;
-        delete stateSpace;
 
         varName                     = x.varName;
         inExpression                = x.inExpression->clone();
         stateSpace                  = NULL;
+        stateSpaceVariable          = NULL;
         nextIndex                   = 0;
     }
 
@@ -84,10 +85,12 @@ RevPtr<RevVariable> SyntaxForLoop::evaluateContent( Environment& env, bool dynam
 }
 
 
-/** Finalize loop. */
+/** Finalize loop. We release the state space, which may be large. */
 void SyntaxForLoop::finalizeLoop( void )
 {
-    nextIndex = 0;
+    nextIndex           = 0;
+    stateSpace          = NULL;
+    stateSpaceVariable  = NULL;
 }
 
 
@@ -130,16 +133,24 @@ void SyntaxForLoop::initializeLoop( Environment& env )
     assert ( nextIndex == 0 );  // Check that we are not running already
 
     // Evaluate expression and check that we get a vector
-    const RevPtr<RevVariable>&      theVar   = inExpression->evaluateContent(env);
+    RevPtr<RevVariable>             theVar   = inExpression->evaluateContent(env);
     const RevObject&             theValue    = theVar->getRevObject();
 
     // Check that it is a container (the first dimension of which we will use)
-    stateSpace = dynamic_cast<Container*>( theValue.clone() );
-    if ( stateSpace == NULL )
+    if ( dynamic_cast<const Container*>( &theValue ) == NULL )
     {
        throw RbException( "The 'in' expression does not evaluate to a container" );
     }
     
+    // We only need our own copy if the variable is referenced by anyone else (e.g., the environment),
+    // otherwise the loop body cannot change the container and we iterate over the temporary itself
+    if ( theVar->getReferenceCount() > 1 || theVar->isReferenceVariable() == true || theVar->getName() != "" )
+    {
+        theVar = new RevVariable( theValue.clone() );
+    }
+    stateSpaceVariable = theVar;
+    stateSpace         = dynamic_cast<Container*>( &stateSpaceVariable->getRevObject() );
+    
     // Add the loop variable to the environment, if it is not already there
     if ( env.existsVariable( varName ) == false )
     {
@@ -32,6 +32,11 @@ namespace RevLanguage {
      * it from its first dimension. For a vector, this simply means that the
      * loop variable takes on each of the values of the vector in turn.
      *
+     * The values are taken from a copy of the container, so that changes
+     * of the container in the loop body do not change the loop. If the
+     * in-expression produces a temporary container that no one else can
+     * see, e.g. 1:n or v(a,b,c), we iterate over it directly instead.
+     *
      * Like in R, loops do not open up new local environment. All statements
      * in the for loop are executed in the outer environment, and the loop
      * variable remains there after the loop finishes, as in R.
@@ -65,6 +70,7 @@ namespace RevLanguage {
         std::string                 varName;                                                        //!< The name of the loop variable
         SyntaxElement*              inExpression;                                                   //!< The in expression (a vector of values)
         Container*                  stateSpace;                                                     //!< Vector result of 'in' expression
+        RevPtr<RevVariable>         stateSpaceVariable;                                             //!< The variable owning the state space
         size_t                      nextIndex;                                                      //!< Next element in vector
         RevPtr<RevVariable>         loopVariable;                                                   //!< Smart pointer to the loop variable in the environment
 
@@ -80,7 +80,7 @@ RevPtr<RevVariable> SyntaxVariable::evaluateContent( Environment& env, bool dyna
     
     
     // Get variable from the environment (no dynamic version of identifier)
-    the_var = curEnv->getVariable( identifier );
+    the_var = curEnv->getVariable( identifier, slot );
     
     // get a copy if this is a workspace variable
     if ( dynamic == true )
@@ -1,6 +1,7 @@
 #ifndef SyntaxVariable_H
 #define SyntaxVariable_H
 
+#include "Environment.h"
 #include "ModelVector.h"
 #include "Natural.h"
 #include "SyntaxElement.h"
@@ -25,6 +26,10 @@ namespace RevLanguage {
      * using evaluateLHSContent(). If it is part of a dynamic rhs expression,
      * it is evaluated using evaluateContent(dynamic=true), and if it is in a static
      * rhs expression, it is evaluated using evaluateContent().
+     *
+     * The rhs evaluation remembers where it found the variable, so that
+     * evaluating the same variable again, e.g. in a loop, does not search
+     * the variable tables as long as no variable was added or removed.
      */
     class SyntaxVariable : public SyntaxElement {
         
@@ -52,6 +57,7 @@ namespace RevLanguage {
 
         std::string                         identifier;                                                                             //!< The name of the variable, if identified by name
         std::vector<std::string>            namespaces;
+        VariableSlot                        slot;                                                                                   //!< Where we found the variable the last time
     };
     
 }
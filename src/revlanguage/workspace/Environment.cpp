@@ -1,6 +1,7 @@
 #include "Environment.h"
 
 #include <sstream> // IWYU pragma: keep
+#include <algorithm>
 #include <utility>
 
 #include "RbException.h"
@@ -15,12 +16,21 @@ namespace RevLanguage { class RevObject; }
 using namespace RevLanguage;
 
 
+namespace {
+
+    // the last version given to a variable table (of any environment)
+    size_t last_variable_table_version = 0;
+
+}
+
+
 /** Construct environment with NULL parent */
 Environment::Environment(const std::string &n) :
     function_table(),
     numUnnamedVariables(0),
     parentEnvironment(NULL),
     variableTable(),
+    variable_table_version( ++last_variable_table_version ),
     children(),
     name( n )
 {
@@ -34,6 +44,7 @@ Environment::Environment(Environment* parentEnv, const std::string &n) :
     numUnnamedVariables(0),
     parentEnvironment(parentEnv),
     variableTable(),
+    variable_table_version( ++last_variable_table_version ),
     children(),
     name( n )
 {
@@ -47,6 +58,7 @@ Environment::Environment(const Environment &x) :
     numUnnamedVariables( x.numUnnamedVariables ),
     parentEnvironment( x.parentEnvironment ),
     variableTable( x.variableTable ),
+    variable_table_version( ++last_variable_table_version ),
     children(),
     name( x.name )
 {
@@ -85,6 +97,7 @@ Environment& Environment::operator=(const Environment &x)
 
         // Copy parent environment pointer
         parentEnvironment = x.parentEnvironment;
+        touchVariableTable();
 
         // Make a deep copy of function table by using assignment operator in FunctionTable
         function_table = x.function_table;
@@ -114,6 +127,7 @@ void Environment::addAlias( const std::string& name, const RevPtr<RevVariable>&
     
     /* Insert new alias to variable in variable table (we do not and should not name it) */
     variableTable.insert( std::pair<std::string, RevPtr<RevVariable> >( name, the_var ) );
+    touchVariableTable();
     
 }
 
@@ -176,6 +190,7 @@ void Environment::addReference( const std::string& name, const RevPtr<RevVariabl
     RevPtr<RevVariable> theRef = new RevVariable( the_var );
     variableTable.insert( std::pair<std::string, RevPtr<RevVariable> >( name, theRef ) );
     theRef->setName( name );
+    touchVariableTable();
     
 }
 
@@ -201,6 +216,7 @@ void Environment::addVariable( const std::string& name, const RevPtr<RevVariable
     /* Insert new RevVariable in variable table */
     variableTable.insert( std::pair<std::string, RevPtr<RevVariable> >( name, the_var ) );
     the_var->setName( name );
+    touchVariableTable();
 
 }
 
@@ -233,6 +249,7 @@ void Environment::clear(void)
 
     // Empty the variable table. It is as easy as this because we use smart pointers...
     variableTable.clear();
+    touchVariableTable();
 
     // Empty the function table.
     function_table.clear();
@@ -253,6 +270,7 @@ void Environment::eraseVariable(const std::string& name)
         // Free the memory for the variable (smart pointer, so happens automatically) and
         // remove the variable from the map of variables
         variableTable.erase(it);
+        touchVariableTable();
     }
 }
 
@@ -431,6 +449,30 @@ const RevPtr<RevVariable>& Environment::getVariable(const std::string& name) con
 }
 
 
+/**
+ * Return a specific variable through the slot of a previous lookup of the same name in this environment.
+ * If no variable was added or removed since then, the slot still points to the right entry of the
+ * variable tables and we skip the search through the frames. Otherwise we search and fill the slot.
+ */
+RevPtr<RevVariable>& Environment::getVariable(const std::string& name, VariableSlot& slot)
+{
+    
+    size_t version = getVariableTableVersion();
+    if ( slot.environment == this && slot.version == version )
+    {
+        return *slot.variable;
+    }
+    
+    RevPtr<RevVariable>& the_var = getVariable( name );
+    
+    slot.environment = this;
+    slot.version     = version;
+    slot.variable    = &the_var;
+    
+    return the_var;
+}
+
+
 /** Return variable table */
 VariableTable& Environment::getVariableTable(void) {
     
@@ -447,6 +489,24 @@ const VariableTable& Environment::getVariableTable(void) const
 
 
 
+/**
+ * Get the version of the variable tables in which we look up names, i.e., of this frame and its parents.
+ * Versions are unique and increasing over all environments, so the largest one changes whenever
+ * any of these tables changes.
+ */
+size_t Environment::getVariableTableVersion(void) const
+{
+    
+    size_t version = variable_table_version;
+    for (const Environment* e = parentEnvironment; e != NULL; e = e->parentEnvironment)
+    {
+        version = std::max( version, e->variable_table_version );
+    }
+    
+    return version;
+}
+
+
 bool Environment::hasChildEnvironment(const std::string &name)
 {
     
@@ -506,3 +566,10 @@ void Environment::printValue(std::ostream& o) const
     o << std::endl;
 }
 
+
+/** A variable was added or removed, so lookups through a slot must search again. */
+void Environment::touchVariableTable(void)
+{
+    
+    variable_table_version = ++last_variable_table_version;
+}
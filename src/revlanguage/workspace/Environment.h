@@ -14,11 +14,28 @@
 
 namespace RevLanguage {
 class Argument;
+class Environment;
 class Function;
 class RevObject;
 
     typedef std::map<std::string, RevPtr<RevVariable> > VariableTable;                                                             //!< Typedef for convenience
 
+    /**
+     * @brief VariableSlot: Where a variable was found the last time
+     *
+     * A syntax element that looks up the same name in the same environment over and over,
+     * e.g. in the body of a loop or a function, keeps the slot of its last lookup and so
+     * resolves the name without searching the variable tables again. The slot is valid as
+     * long as no variable was added to or removed from the environment or its parents.
+     */
+    struct VariableSlot {
+        VariableSlot(void) : environment( NULL ), version( 0 ), variable( NULL ) {}
+
+        const Environment*                  environment;                                                                                //!< The environment in which we started the lookup
+        size_t                              version;                                                                                    //!< The variable table version of the environment at the lookup
+        RevPtr<RevVariable>*                variable;                                                                                   //!< The entry of the variable table
+    };
+
     /**
      * @brief Environment: Base class for frames
      *
@@ -74,9 +91,11 @@ class RevObject;
         const RevObject&                    getRevObject(const std::string& name) const;                                                //!< Convenient alternative for [name]->getValue()
         RevObject&                          getRevObject(const std::string& name);                                                      //!< Convenient alternative for [name]->getValue() (non-const to return non-const value)
         RevPtr<RevVariable>&                getVariable(const std::string& name);                                                       //!< Get variable
+        RevPtr<RevVariable>&                getVariable(const std::string& name, VariableSlot& slot);                                   //!< Get variable through the slot of a previous lookup
         const RevPtr<RevVariable>&          getVariable(const std::string& name) const;                                                 //!< Get variable (const)
         const VariableTable&                getVariableTable(void) const;                                                               //!< Get the table with the variables (const)
         VariableTable&                      getVariableTable(void);                                                                     //!< Get the table with the variables (non-const)
+        size_t                              getVariableTableVersion(void) const;                                                        //!< Get the version of the variable tables of this frame and its parents
         bool                                hasChildEnvironment(const std::string &name);                                               //!< Has a child environment with the name
         bool                                isProcedure(const std::string& fxnName) const;                                              //!< Is 'fxnName' a procedure?
         virtual bool                        isSameOrParentOf(const Environment& otherEnvironment) const;                                //!< Is the Environment same or parent of other Environment?
@@ -86,10 +105,13 @@ class RevObject;
 
     protected:
 
+        void                                touchVariableTable(void);                                                                   //!< Give the variable table a new version
+
         FunctionTable                       function_table;                                                                              //!< Table holding functions
         int                                 numUnnamedVariables;                                                                        //!< Current number of unnamed variables
         Environment*                        parentEnvironment;                                                                          //!< Pointer to enclosing Environment
         VariableTable                       variableTable;                                                                              //!< Variable table
+        size_t                              variable_table_version;                                                                     //!< Changes whenever a variable is added or removed (unique over all environments)
     
         std::map<std::string, Environment*> children;
         std::string                         name;
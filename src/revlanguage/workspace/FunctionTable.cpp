@@ -1,6 +1,8 @@
 #include <stddef.h>
 #include <sstream>
 #include <algorithm>
+#include <climits>
+#include <cmath>
 #include <functional>
 #include <map>
 #include <string>
@@ -9,8 +11,12 @@
 
 #include "ArgumentRule.h"
 #include "FunctionTable.h"
+#include "Integer.h"
 #include "RbException.h"
+#include "Real.h"
+#include "RlBoolean.h"
 #include "RlFunction.h"
+#include "RlString.h"
 #include "Argument.h"
 #include "ArgumentRules.h"
 #include "DagNode.h"
@@ -22,9 +28,104 @@
 
 using namespace RevLanguage;
 
+
+namespace {
+    
+    /**
+     * The value class of a number: where it lies relative to 0 and 1, and whether it is integral.
+     * The conversions between the number types (e.g., of a Real to a Probability) only depend on these properties.
+     */
+    int getNumberClass(double x)
+    {
+        
+        int value_class = 0;
+        if ( x < 0.0 )
+        {
+            value_class = 1;
+        }
+        else if ( x == 0.0 )
+        {
+            value_class = 2;
+        }
+        else if ( x < 1.0 )
+        {
+            value_class = 3;
+        }
+        else if ( x == 1.0 )
+        {
+            value_class = 4;
+        }
+        else if ( x > 1.0 )
+        {
+            value_class = 5;
+        }
+        
+        // the number types test x == int(x), which is only defined for x in the range of int
+        if ( x >= INT_MIN && x <= INT_MAX && x == std::floor(x) )
+        {
+            value_class += 8;
+        }
+        
+        return value_class;
+    }
+    
+    
+    /**
+     * Get the node type and the value class of a variable passed to a function.
+     * Only the values of arguments that are evaluated once matter for the match, and of these we only know the
+     * value classes of numbers, booleans and strings. We return false for other arguments that are evaluated once.
+     */
+    bool getDispatchClass(const RevVariable& v, bool once, char& node_type, int& value_class)
+    {
+        
+        const RevObject& the_object = v.getRevObject();
+        
+        node_type = '-';
+        if ( the_object.isModelObject() == true )
+        {
+            const RevBayesCore::DagNode* the_node = the_object.getDagNode();
+            if ( the_node == NULL )
+            {
+                return false;
+            }
+            switch ( the_node->getDagNodeType() )
+            {
+                case RevBayesCore::DagNode::CONSTANT:       node_type = 'c'; break;
+                case RevBayesCore::DagNode::DETERMINISTIC:  node_type = 'd'; break;
+                case RevBayesCore::DagNode::STOCHASTIC:     node_type = 's'; break;
+                default:                                    return false;
+            }
+        }
+        
+        value_class = 0;
+        if ( once == false && v.isWorkspaceVariable() == false && node_type != 'c' )
+        {
+            return true;
+        }
+        
+        const TypeSpec& type = the_object.getTypeSpec();
+        if ( const Real* r = dynamic_cast<const Real*>( &the_object ) )
+        {
+            value_class = getNumberClass( r->getValue() );
+        }
+        else if ( const Integer* i = dynamic_cast<const Integer*>( &the_object ) )
+        {
+            value_class = getNumberClass( double( i->getValue() ) );
+        }
+        else if ( &type != &RlBoolean::getClassTypeSpec() && &type != &RlString::getClassTypeSpec() )
+        {
+            return false;
+        }
+        
+        return true;
+    }
+    
+}
+
 /** Basic constructor, empty table with or without parent */
 FunctionTable::FunctionTable(FunctionTable* parent) : std::multimap<std::string, Function*>(),
-    parentTable(parent)
+    parentTable(parent),
+    dispatch_cache()
 {
 
 }
@@ -127,6 +228,9 @@ void FunctionTable::addFunction( Function *func )
         // Insert the function
         insert(std::pair<std::string, Function* >(a, func->clone() ));
     }
+    
+    // the new function may match better than the remembered ones
+    dispatch_cache.clear();
 
 }
 
@@ -146,6 +250,7 @@ void FunctionTable::clear(void)
     }
     
     std::multimap<std::string, Function*>::clear();
+    dispatch_cache.clear();
     
 }
 
@@ -176,6 +281,7 @@ void FunctionTable::eraseFunction(const std::string& name)
     }
     
     erase(ret_val.first, ret_val.second);
+    dispatch_cache.clear();
     
 }
 
@@ -380,6 +486,39 @@ const Function& FunctionTable::findFunction(const std::string& name, const std::
     }
     else 
     {
+        // first try the overload that matched arguments of the same kind the last time
+        std::map<std::string, DispatchCache>::iterator cached = dispatch_cache.find( name );
+        if ( cached != dispatch_cache.end() )
+        {
+            std::vector<DispatchEntry>& entries = cached->second.entries;
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                if ( isDispatchMatch( entries[i], args, once, cached->second.by_value ) == true )
+                {
+                    Function* cached_function = entries[i].function;
+                    bool found = false;
+                    for (std::multimap<std::string, Function *>::const_iterator it=ret_val.first; it!=ret_val.second; it++)
+                    {
+                        if ( it->second == cached_function )
+                        {
+                            found = true;
+                        }
+                        else
+                        {
+                            it->second->clear();
+                        }
+                    }
+                    
+                    if ( found == true && cached_function->checkArguments(args, NULL, once) == true )
+                    {
+                        return *cached_function;
+                    }
+                    entries.erase( entries.begin() + i );
+                    break;
+                }
+            }
+        }
+        
         std::vector<double>* match_score = new std::vector<double>();
         std::vector<double> best_score;
         Function* best_match = NULL;
@@ -474,6 +613,53 @@ const Function& FunctionTable::findFunction(const std::string& name, const std::
         }
         else 
         {
+            // remember the match for arguments of this kind
+            std::map<std::string, DispatchCache>::iterator cache = dispatch_cache.find( name );
+            if ( cache == dispatch_cache.end() )
+            {
+                DispatchCache new_cache;
+                new_cache.by_value = false;
+                for ( it = ret_val.first; it != ret_val.second; it++ )
+                {
+                    const ArgumentRules& rules = it->second->getArgumentRules();
+                    for (size_t i = 0; i < rules.size(); ++i)
+                    {
+                        new_cache.by_value |= ( rules[i].getEvaluationType() == ArgumentRule::BY_VALUE );
+                    }
+                }
+                cache = dispatch_cache.insert( std::make_pair( name, new_cache ) ).first;
+            }
+            
+            DispatchEntry entry;
+            entry.once = once;
+            entry.function = best_match;
+            bool known = true;
+            for (std::vector<Argument>::const_iterator a = args.begin(); a != args.end() && known == true; ++a)
+            {
+                RevPtr<const RevVariable> the_var = a->getVariable();
+                DispatchArgument d;
+                known = ( the_var != NULL && getDispatchClass( *the_var, once || cache->second.by_value, d.node_type, d.value_class ) == true );
+                if ( known == true )
+                {
+                    d.label         = a->getLabel();
+                    d.required_type = the_var->getRequiredTypeSpec().getType();
+                    d.type          = &the_var->getRevObject().getTypeSpec();
+                    d.workspace     = the_var->isWorkspaceVariable();
+                    entry.arguments.push_back( d );
+                }
+            }
+            
+            // we only keep a few kinds of calls per function, so that looking them up stays cheap
+            if ( known == true )
+            {
+                std::vector<DispatchEntry>& entries = cache->second.entries;
+                if ( entries.size() >= 8 )
+                {
+                    entries.erase( entries.begin() );
+                }
+                entries.push_back( entry );
+            }
+            
             return *best_match;
         }
         
@@ -482,6 +668,41 @@ const Function& FunctionTable::findFunction(const std::string& name, const std::
 }
 
 
+/**
+ * Are the arguments of the kind of the dispatch entry, so that the same overload matches them?
+ * The type specs of Rev objects are static, so we compare their addresses.
+ */
+bool FunctionTable::isDispatchMatch(const DispatchEntry& e, const std::vector<Argument>& args, bool once, bool by_value) const
+{
+    
+    if ( e.once != once || e.arguments.size() != args.size() )
+    {
+        return false;
+    }
+    
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        const DispatchArgument& d = e.arguments[i];
+        RevPtr<const RevVariable> the_var = args[i].getVariable();
+        
+        char node_type = '-';
+        int value_class = 0;
+        if ( the_var == NULL || getDispatchClass( *the_var, once || by_value, node_type, value_class ) == false )
+        {
+            return false;
+        }
+        
+        if ( d.type != &the_var->getRevObject().getTypeSpec() || d.node_type != node_type || d.value_class != value_class ||
+             d.workspace != the_var->isWorkspaceVariable() || d.label != args[i].getLabel() || d.required_type != the_var->getRequiredTypeSpec().getType() )
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
 /**
  * Get first function. This function will find the first function with a matching name without
  * throwing an error. Compare with the getFunction(name) function, which will throw an error
@@ -703,6 +924,8 @@ void FunctionTable::replaceFunction( const std::string& name, Function *func )
     // Test the function
     testFunctionValidity( name, func );
     
+    dispatch_cache.clear();
+    
     // Find the function to be replaced
     std::pair<std::multimap<std::string, Function *>::iterator,
               std::multimap<std::string, Function *>::iterator> range;
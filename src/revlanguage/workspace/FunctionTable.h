@@ -16,6 +16,7 @@ namespace RevLanguage {
     class Function;
     class RevObject;
     class RevVariable;
+    class TypeSpec;
 
     /**
      * @brief FunctionTable: A multimap from function names to functions
@@ -25,6 +26,13 @@ namespace RevLanguage {
      * is derived from. Function tables can be nested; each table defers
      * calls to its parent(s) when the task cannot be solved locally.
      *
+     * Resolving an overloaded function checks the arguments against every
+     * overload. We remember the best overload together with the labels,
+     * types, node types and, for numbers evaluated once, the value classes
+     * of the arguments, so later calls with arguments of the same kind only
+     * check that overload. Calls whose match may depend on other properties
+     * of the values, e.g. of constant vectors, are always resolved in full.
+     *
      */
     class FunctionTable : public std::multimap<std::string, Function*> {
         
@@ -66,8 +74,34 @@ namespace RevLanguage {
                                                              bool                         once) const;                                            //!< Find function, process args
         void                                    testFunctionValidity(const std::string& name, Function* func) const;                        //!< Test whether function can be added
         
+        // The kind of an argument that decides which overload matches it
+        struct DispatchArgument {
+            std::string                         label;                                                                                      //!< The label of the argument
+            std::string                         required_type;                                                                              //!< The required type of the variable
+            const TypeSpec*                     type;                                                                                       //!< The (static) type spec of the value
+            char                                node_type;                                                                                  //!< 'c', 'd' or 's' for model objects, '-' otherwise
+            bool                                workspace;                                                                                  //!< Is it a workspace variable?
+            int                                 value_class;                                                                                //!< Where a number evaluated once lies relative to 0 and 1, and whether it is integral
+        };
+        
+        // The overload that matched arguments of a given kind
+        struct DispatchEntry {
+            bool                                once;
+            std::vector<DispatchArgument>       arguments;
+            Function*                           function;
+        };
+        
+        // The remembered overloads of a function name
+        struct DispatchCache {
+            bool                                by_value;                                                                                   //!< Does any overload take an argument by value?
+            std::vector<DispatchEntry>          entries;
+        };
+        
+        bool                                    isDispatchMatch(const DispatchEntry& e, const std::vector<Argument>& args, bool once, bool by_value) const;  //!< Are the arguments of the kind of the entry?
+        
         // Member variables
         const FunctionTable*                    parentTable;                                                                                //!< Enclosing table
+        mutable std::map<std::string, DispatchCache>    dispatch_cache;                                                                     //!< The remembered overloads per function name
 
 };
     
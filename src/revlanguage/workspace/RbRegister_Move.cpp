@@ -89,6 +89,7 @@
 
 /* Compound Moves on Real Values */
 #include "Move_AVMVN.h"
+#include "Move_HMC.h"
 #include "Move_UpDownSlide.h"
 #include "Move_UpDownSlideBactrian.h"
 #include "Move_UpDownTreeScale.h"
@@ -260,6 +261,7 @@ void RevLanguage::Workspace::initializeMoveGlobalWorkspace(void)
         /* compound moves */
 //        addType("mvUpDownScale",         new Move_UpDownScale() );
         addType( new Move_AVMVN() );
+        addType( new Move_HMC() );
         addType( new Move_UpDownTreeScale() );
         addType( new Move_UpDownSlide() );
         addType( new Move_UpDownSlideBactrian() );
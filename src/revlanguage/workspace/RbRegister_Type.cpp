@@ -84,6 +84,7 @@
 #include "RlBootstrapAnalysis.h"
 #include "RlBurninEstimationConvergenceAssessment.h"
 #include "RlHillClimber.h"
+#include "RlMaximumLikelihoodTreeSearch.h"
 #include "RlMcmc.h"
 #include "RlMcmcmc.h"
 #include "RlModel.h"
@@ -145,6 +146,7 @@ void RevLanguage::Workspace::initializeTypeGlobalWorkspace(void)
         addType( new BootstrapAnalysis()                             );
         addType( new BurninEstimationConvergenceAssessment()         );
         addType( new HillClimber()                                   );
+        addType( new MaximumLikelihoodTreeSearch()                   );
         addType( new Mcmc()                                          );
         addType( new Mcmcmc()                                        );
         addType( new Model()                                         );